@@ -11,6 +11,7 @@
 
 #include "board.h"
 
+#include "crash_dump.h"
 #include "gpio.h"
 #include "leds.h"
 #include "log.h"
@@ -48,7 +49,9 @@ void vApplicationSetLogLevels( void )
 void vApplicationStartupCallback( void )
 {
 	WatchdogReboot_t *  pxRebootData;
+	xCrashDump_t *		pxCrashDump;
 	tdf_watchdog_info_t xWatchdogInfo;
+	tdf_task_stack_t	xStackInfo;
 	vLedsOn( LEDS_ALL );
 	/* Get Reboot reasons and clear */
 	pxRebootData = xWatchdogRebootReason();
@@ -57,6 +60,15 @@ void vApplicationStartupCallback( void )
 		vWatchdogPopulateTdf( pxRebootData, &xWatchdogInfo );
 
 		eTdfAddMulti( SERIAL_LOG, TDF_WATCHDOG_INFO_SMALL, TDF_TIMESTAMP_NONE, NULL, &xWatchdogInfo );
+		if ( bWatchdogPopulateStackTdf( pxRebootData, &xStackInfo ) ) {
+			eTdfAddMulti( SERIAL_LOG, TDF_TASK_STACK, TDF_TIMESTAMP_NONE, NULL, &xStackInfo );
+		}
+		eTdfFlushMulti( SERIAL_LOG );
+	}
+	/* Post-mortem record of a fault, assertion or watchdog reset */
+	pxCrashDump = pxCrashDumpRecord();
+	if ( pxCrashDump != NULL ) {
+		eCrashDumpLog( SERIAL_LOG, TDF_TIMESTAMP_NONE, NULL, pxCrashDump );
 		eTdfFlushMulti( SERIAL_LOG );
 	}
 
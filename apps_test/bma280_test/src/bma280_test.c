@@ -95,7 +95,7 @@ void vTestBma280( void *pvParams )
 	uint16_t				  usTdfId;
 	uint8_t					  ucTdfShift;
 	xTdfTime_t				  xTime;
-	uint32_t				  ulInterruptPeriod;
+	xFifoTimestamp_t		  xTiming;
 	bool					  bNoMotionActive = false;
 
 	const bool	bLogTdf	 = true;
@@ -171,7 +171,7 @@ void vTestBma280( void *pvParams )
 
 		switch ( eInterruptType ) {
 			case ACCELEROMETER_NEW_DATA:
-				if ( eBma280ReadData( pxData, &xTime, &ulInterruptPeriod, xConfig.ucFIFOLimit, pdMS_TO_TICKS( 10 ) ) != ERROR_NONE ) {
+				if ( eBma280ReadData( pxData, &xTiming, xConfig.ucFIFOLimit, pdMS_TO_TICKS( 10 ) ) != ERROR_NONE ) {
 					eLog( LOG_APPLICATION, LOG_ERROR, "Error while reading data from BMA280.\r\n" );
 				}
 				if ( bNoMotionActive ) {
@@ -180,16 +180,14 @@ void vTestBma280( void *pvParams )
 					bNoMotionActive = ( eInterruptType & ACCELEROMETER_NO_MOTION ) ? true : false;
 				}
 
-				xTdfTime_t xSampleDiff = { 0, 2 * ulInterruptPeriod / xConfig.ucFIFOLimit };
-
-				eLog( LOG_APPLICATION, LOG_VERBOSE, "Buffer %5d: %5d ticks\r\n", ulBufferIndex++, ulInterruptPeriod );
+				eLog( LOG_APPLICATION, LOG_VERBOSE, "Buffer %5d: spacing %5d us\r\n", ulBufferIndex++, (uint32_t) ( ( 1000000ull * xTiming.ulBurstSpacing ) >> 24 ) );
 
 				if ( bLogTdf ) {
 					uint8_t ucNumTdfs = MAX( 1, xConfig.ucFIFOLimit );
 					for ( uint8_t i = 0; i < ucNumTdfs; i++ ) {
 						tdf_acc_xyz_signed_t xTdf = { .x = ( pxData[i].lX >> ucTdfShift ), .y = ( pxData[i].lY >> ucTdfShift ), .z = ( pxData[i].lZ >> ucTdfShift ) };
+						vFifoTimestampSample( &xTiming, i, &xTime );
 						eTdfAddMulti( ucTdfLogger, usTdfId, TDF_TIMESTAMP_RELATIVE_OFFSET_MS, &xTime, &xTdf );
-						xTime = xRtcTdfTimeAdd( xTime, xSampleDiff );
 					}
 					eTdfFlushMulti( ucTdfLogger );
 				}
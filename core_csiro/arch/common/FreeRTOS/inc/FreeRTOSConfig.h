@@ -71,9 +71,19 @@ Ensure the tick rate is a multiple of the clock. */
 #define configUSE_TICKLESS_IDLE_SIMPLE_DEBUG			0
 #define configUSE_DISABLE_TICK_AUTO_CORRECTION_DEBUG 	0
 
+/* Trace recorder and run time statistics, see rtos_trace.h */
+#ifndef configUSE_RTOS_TRACE
+	#define configUSE_RTOS_TRACE			0
+#endif /* configUSE_RTOS_TRACE */
+
+/* Stack canaries and high water mark sampling, see stack_monitor.h */
+#ifndef configUSE_STACK_MONITOR
+	#define configUSE_STACK_MONITOR			0
+#endif /* configUSE_STACK_MONITOR */
+
 /* Hook function related definitions. */
 #define configUSE_TICK_HOOK				( 0 )
-#define configCHECK_FOR_STACK_OVERFLOW	( 0 )
+#define configCHECK_FOR_STACK_OVERFLOW	( configUSE_STACK_MONITOR ? 2 : 0 )
 #define configUSE_MALLOC_FAILED_HOOK	( 1 )
 #define configUSE_IDLE_HOOK				( 0 )
 
@@ -85,7 +95,7 @@ Ensure the tick rate is a multiple of the clock. */
 #define configMAX_PRIORITIES					( 6 )
 #define configMINIMAL_STACK_SIZE				(( unsigned short ) 256)
 #define configMAX_TASK_NAME_LEN				 	( 10 )
-#define configUSE_TRACE_FACILITY				( 0 )
+#define configUSE_TRACE_FACILITY				( configUSE_RTOS_TRACE )
 #define configUSE_16_BIT_TICKS					( 0 )
 #define configIDLE_SHOULD_YIELD					( 0 )
 #define configUSE_MUTEXES						( 1 )
@@ -96,7 +106,7 @@ Ensure the tick rate is a multiple of the clock. */
 #define configUSE_QUEUE_SETS					( 0 )
 
 /* Run time stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS			( 0 )
+#define configGENERATE_RUN_TIME_STATS			( configUSE_RTOS_TRACE )
 
 /* Co-routine related definitions. */
 #define configUSE_CO_ROUTINES					( 0 )
@@ -161,6 +171,11 @@ standard names. */
 /* For the linker. */
 #define fabs __builtin_fabs
 
+/* Kernel trace macros */
+#include "rtos_trace.h"
+/* Task stack registration */
+#include "stack_monitor.h"
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: rtos_trace.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * FreeRTOS trace recorder and run time statistics
+ *
+ * Enabled for an application with APP_CFLAGS += -DconfigUSE_RTOS_TRACE=1, which also enables
+ * configUSE_TRACE_FACILITY and configGENERATE_RUN_TIME_STATS. This header is included at the
+ * end of FreeRTOSConfig.h so that the kernel trace macros below are visible to the kernel sources.
+ *
+ * Timestamps come from the DWT cycle counter, extended in software to 64 bits and scaled to
+ * roughly 1 MHz. The cycle counter stops while the core sleeps, so the ticks stepped over by
+ * tickless idle are added back from the kernel's count.
+ *
+ * Events are written as fixed 8 byte records into a RAM ring, overwriting the oldest events.
+ * Recording an event is a constant time store with interrupts masked up to
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY, the measured cost is reported in the dump header.
+ * pyclasses/rtos_trace.py converts dumps to Chrome trace format JSON.
+ *
+ * Interrupts are traced by placing traceISR_ENTER() and traceISR_EXIT() at the start
+ * and end of a handler. Handlers above configMAX_SYSCALL_INTERRUPT_PRIORITY must not be traced.
+ *
+ */
+#ifndef __CSIRO_CORE_RTOS_TRACE
+#define __CSIRO_CORE_RTOS_TRACE
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "compiler_intrinsics.h"
+#include "core_types.h"
+
+/* Module Defines -------------------------------------------*/
+// clang-format off
+
+/* Number of events in the ring, must be a power of 2 */
+#ifndef RTOS_TRACE_EVENTS
+#define RTOS_TRACE_EVENTS           512
+#endif
+
+/* Maximum number of tasks reported by ucRtosTraceTaskStats and eRtosTraceDump */
+#ifndef RTOS_TRACE_MAX_TASKS
+#define RTOS_TRACE_MAX_TASKS        16
+#endif
+
+#define RTOS_TRACE_MAGIC            "RTRC"
+#define RTOS_TRACE_VERSION          1
+
+/* Set in the parameter of queue events generated from an interrupt */
+#define RTOS_TRACE_FROM_ISR         0x8000
+
+/* Set in xRtosTraceHeader_t.ucFlags when more than RTOS_TRACE_MAX_TASKS tasks exist, the task table is then empty */
+#define RTOS_TRACE_FLAG_TASKS_TRUNCATED 0x01
+
+#if configUSE_RTOS_TRACE
+
+#define traceTASK_SWITCHED_IN()                     vRtosTraceEvent( RTOS_TRACE_TASK_SWITCH, pxCurrentTCB->uxTCBNumber, 0 )
+#define traceTASK_CREATE( pxNewTCB )                vRtosTraceEvent( RTOS_TRACE_TASK_CREATE, ( pxNewTCB )->uxTCBNumber, ( pxNewTCB )->uxPriority )
+#define traceQUEUE_CREATE( pxNewQueue )             ( pxNewQueue )->uxQueueNumber = uxRtosTraceQueueCreate( ( pxNewQueue )->ucQueueType )
+#define traceQUEUE_SEND( pxQueue )                  vRtosTraceEvent( RTOS_TRACE_QUEUE_SEND, ( pxQueue )->uxQueueNumber, ( pxQueue )->ucQueueType )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )         vRtosTraceEvent( RTOS_TRACE_QUEUE_SEND, ( pxQueue )->uxQueueNumber, ( pxQueue )->ucQueueType | RTOS_TRACE_FROM_ISR )
+#define traceQUEUE_RECEIVE( pxQueue )               vRtosTraceEvent( RTOS_TRACE_QUEUE_RECEIVE, ( pxQueue )->uxQueueNumber, ( pxQueue )->ucQueueType )
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )      vRtosTraceEvent( RTOS_TRACE_QUEUE_RECEIVE, ( pxQueue )->uxQueueNumber, ( pxQueue )->ucQueueType | RTOS_TRACE_FROM_ISR )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )      vRtosTraceEvent( RTOS_TRACE_QUEUE_BLOCK_SEND, ( pxQueue )->uxQueueNumber, ( pxQueue )->ucQueueType )
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )   vRtosTraceEvent( RTOS_TRACE_QUEUE_BLOCK_RECEIVE, ( pxQueue )->uxQueueNumber, ( pxQueue )->ucQueueType )
+#define traceLOW_POWER_IDLE_BEGIN()                 vRtosTraceEvent( RTOS_TRACE_SLEEP, 0, 0 )
+#define traceLOW_POWER_IDLE_END()                   vRtosTraceEvent( RTOS_TRACE_WAKE, 0, 0 )
+#define traceINCREASE_TICK_COUNT( xTicksToJump )    vRtosTraceTicksSkipped( xTicksToJump )
+/* Regular calls keep the software extension of the cycle counter current */
+#define traceTASK_INCREMENT_TICK( xTickCount )      ( (void) ulRtosTraceTimestamp() )
+
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    vRtosTraceInit()
+#define portGET_RUN_TIME_COUNTER_VALUE()            ulRtosTraceTimestamp()
+
+#define traceISR_ENTER()                            vRtosTraceIsr( RTOS_TRACE_ISR_ENTER )
+#define traceISR_EXIT()                             vRtosTraceIsr( RTOS_TRACE_ISR_EXIT )
+
+#else
+
+#define traceISR_ENTER()
+#define traceISR_EXIT()
+
+#endif /* configUSE_RTOS_TRACE */
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+typedef enum eRtosTraceEvent_t {
+	RTOS_TRACE_TASK_SWITCH = 1,		 /**< Object is the task number switched in */
+	RTOS_TRACE_TASK_CREATE,			 /**< Object is the task number, parameter the priority */
+	RTOS_TRACE_ISR_ENTER,			 /**< Object is the interrupt number */
+	RTOS_TRACE_ISR_EXIT,			 /**< Object is the interrupt number */
+	RTOS_TRACE_QUEUE_CREATE,		 /**< Object is the queue number, parameter the queue type */
+	RTOS_TRACE_QUEUE_SEND,			 /**< Object is the queue number, parameter the queue type and RTOS_TRACE_FROM_ISR */
+	RTOS_TRACE_QUEUE_RECEIVE,		 /**< Object is the queue number, parameter the queue type and RTOS_TRACE_FROM_ISR */
+	RTOS_TRACE_QUEUE_BLOCK_SEND,	 /**< Object is the queue number, parameter the queue type */
+	RTOS_TRACE_QUEUE_BLOCK_RECEIVE,  /**< Object is the queue number, parameter the queue type */
+	RTOS_TRACE_SLEEP,				 /**< Idle task entering tickless idle */
+	RTOS_TRACE_WAKE,				 /**< Idle task leaving tickless idle */
+	RTOS_TRACE_USER					 /**< Application marker, see vRtosTraceUser */
+} eRtosTraceEvent_t;
+
+/**@brief Trace record, as stored in the ring and written by eRtosTraceDump */
+typedef struct xRtosTraceRecord_t
+{
+	uint32_t ulTimestamp;
+	uint8_t  ucEvent;
+	uint8_t  ucObject;
+	uint16_t usParam;
+} ATTR_PACKED xRtosTraceRecord_t;
+
+/**@brief Dump header, followed by ucNumTasks of [task number (1), name (ucNameLength)] and ulNumEvents records */
+typedef struct xRtosTraceHeader_t
+{
+	char	 pcMagic[4];		   /**< RTOS_TRACE_MAGIC */
+	uint8_t  ucVersion;			   /**< RTOS_TRACE_VERSION */
+	uint8_t  ucNumTasks;		   /**< Entries in the task table */
+	uint8_t  ucNameLength;		   /**< Length of names in the task table */
+	uint8_t  ucFlags;			   /**< RTOS_TRACE_FLAG_* */
+	uint32_t ulTimestampHz;		   /**< Timestamp frequency */
+	uint32_t ulNumEvents;		   /**< Records following the task table, oldest first */
+	uint32_t ulOverwritten;		   /**< Records lost to the ring wrapping */
+	uint16_t usOverheadCycles;	 /**< Measured CPU cycles per recorded event */
+	uint16_t usReserved;		   /**< Zero */
+} ATTR_PACKED xRtosTraceHeader_t;
+
+/**@brief Per task statistics since the previous call to ucRtosTraceTaskStats */
+typedef struct xRtosTaskStats_t
+{
+	char	 pcName[configMAX_TASK_NAME_LEN]; /**< Task name */
+	uint8_t  ucTaskNumber;					  /**< Task number, as used in trace records */
+	uint8_t  ucPriority;					  /**< Current priority */
+	uint16_t usCpuPermille;					  /**< CPU time in units of 0.1% */
+	uint16_t usStackFree;					  /**< Minimum free stack since the task was created, in words */
+} xRtosTaskStats_t;
+
+/**@brief Output function for eRtosTraceDump */
+typedef void ( *fnRtosTraceWrite_t )( const uint8_t *pucData, uint32_t ulLength, void *pvContext );
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Start the timestamp source and measure the recording overhead
+ *
+ * Called by the kernel through portCONFIGURE_TIMER_FOR_RUN_TIME_STATS when the scheduler starts
+ */
+void vRtosTraceInit( void );
+
+/**@brief Current timestamp, in units of 1 / ulTimestampHz */
+uint32_t ulRtosTraceTimestamp( void );
+
+/**@brief Account for kernel ticks stepped over while the cycle counter was stopped */
+void vRtosTraceTicksSkipped( uint32_t ulTicks );
+
+/**@brief Record an event, safe to call from tasks and interrupts */
+void vRtosTraceEvent( uint8_t ucEvent, uint32_t ulObject, uint32_t ulParam );
+
+/**@brief Record entry to or exit from the current interrupt, see traceISR_ENTER */
+void vRtosTraceIsr( uint8_t ucEvent );
+
+/**@brief Assign a trace number to a newly created queue */
+uint32_t uxRtosTraceQueueCreate( uint8_t ucQueueType );
+
+/**@brief Record an application defined marker */
+void vRtosTraceUser( uint8_t ucId, uint16_t usValue );
+
+/**@brief Pause or resume recording */
+void vRtosTraceEnable( bool bEnable );
+
+/**@brief Copy the most recent records, oldest first
+ *
+ * @param[out] pxRecords			Records output
+ * @param[in] ucMaxRecords			Length of pxRecords
+ *
+ * @retval							Number of records written to pxRecords
+ */
+uint8_t ucRtosTraceLatest( xRtosTraceRecord_t *pxRecords, uint8_t ucMaxRecords );
+
+/**@brief Per task CPU usage since the previous call, and stack high water marks
+ *
+ * @param[out] pxStats				Task statistics
+ * @param[in] ucMaxStats			Length of pxStats
+ *
+ * @retval							Number of tasks written to pxStats, 0 if more than RTOS_TRACE_MAX_TASKS tasks exist
+ */
+uint8_t ucRtosTraceTaskStats( xRtosTaskStats_t *pxStats, uint8_t ucMaxStats );
+
+/**@brief Log the output of ucRtosTraceTaskStats through eLog */
+void vRtosTraceTaskStatsPrint( void );
+
+/**@brief Write the task table and the contents of the ring
+ *
+ * Recording is paused while the ring is written
+ *
+ * @param[in] fnWrite				Output function
+ * @param[in] pvContext				Context passed to fnWrite
+ *
+ * @retval ::ERROR_NONE 			Trace written
+ */
+eModuleError_t eRtosTraceDump( fnRtosTraceWrite_t fnWrite, void *pvContext );
+
+#endif /* __CSIRO_CORE_RTOS_TRACE */
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: stack_monitor.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Task stack canaries and high water mark sampling
+ *
+ * Enabled for an application with APP_CFLAGS += -DconfigUSE_STACK_MONITOR=1, which sets
+ * configCHECK_FOR_STACK_OVERFLOW to 2. The kernel then fills every new stack with 0xA5 and
+ * checks on each context switch that the 16 bytes at the end of the outgoing task's stack
+ * are untouched. An overflow is recorded as REBOOT_STACK_OVERFLOW against the task.
+ *
+ * Tasks created with STATIC_TASK_CREATE, the idle task and the timer task are registered
+ * here, vStackMonitorSample scans the untouched fill of one registered task per call to
+ * track its minimum free stack. The task with the least free stack is stored with every
+ * reboot reason, so that watchdog and assertion reboots can be attributed to a task that
+ * ran out of stack before the canary was reached.
+ *
+ * This header is included at the end of FreeRTOSConfig.h so that STACK_MONITOR_REGISTER
+ * is available wherever freertos_helpers.h is.
+ *
+ */
+#ifndef __CSIRO_CORE_STACK_MONITOR
+#define __CSIRO_CORE_STACK_MONITOR
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Module Defines -------------------------------------------*/
+// clang-format off
+
+/* Maximum number of tasks that can be registered */
+#ifndef STACK_MONITOR_MAX_TASKS
+#define STACK_MONITOR_MAX_TASKS     16
+#endif
+
+/* Value of unused stack words, tskSTACK_FILL_BYTE */
+#define STACK_MONITOR_FILL          0xA5A5A5A5UL
+
+#if configUSE_STACK_MONITOR
+#define STACK_MONITOR_REGISTER( pcName, puxStack, ulStackWords )    vStackMonitorRegister( pcName, puxStack, ulStackWords )
+#else
+#define STACK_MONITOR_REGISTER( pcName, puxStack, ulStackWords )    ( (void) 0 )
+#endif /* configUSE_STACK_MONITOR */
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+/**@brief Stack usage of a registered task */
+typedef struct xStackMonitorReport_t
+{
+	char	 pcName[configMAX_TASK_NAME_LEN + 1]; /**< Task name */
+	uint16_t usSize;							  /**< Stack size in bytes, 0 if no task is registered */
+	uint16_t usFree;							  /**< Minimum free stack observed in bytes, 0 after an overflow */
+} xStackMonitorReport_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Register a task stack for sampling
+ *
+ * Tasks beyond STACK_MONITOR_MAX_TASKS are still covered by the kernel canary, but not sampled
+ *
+ * @param[in] pcName				Task name, must remain valid
+ * @param[in] pvStack				Stack buffer passed to the kernel
+ * @param[in] ulStackWords			Length of the stack buffer in words
+ */
+void vStackMonitorRegister( const char *pcName, void *pvStack, uint32_t ulStackWords );
+
+/**@brief Update the minimum free stack of the next registered task
+ *
+ * The cost is proportional to the free stack of that task, intended to be called
+ * from the heartbeat task so that every task is sampled every few seconds
+ */
+void vStackMonitorSample( void );
+
+/**@brief Record that a task has overflowed its stack, called from vApplicationStackOverflowHook */
+void vStackMonitorOverflow( const char *pcName );
+
+/**@brief Registered task with the least free stack, as of the last samples
+ *
+ * @param[out] pxReport				Task stack usage
+ *
+ * @retval							True if any task is registered
+ */
+bool bStackMonitorLowest( xStackMonitorReport_t *pxReport );
+
+/**@brief Stack usage of all registered tasks
+ *
+ * @param[out] pxReports			Task stack usage
+ * @param[in] ucMaxReports			Length of pxReports
+ *
+ * @retval							Number of tasks written to pxReports
+ */
+uint8_t ucStackMonitorReport( xStackMonitorReport_t *pxReports, uint8_t ucMaxReports );
+
+#endif /* __CSIRO_CORE_STACK_MONITOR */
@@ -4,6 +4,7 @@
 #include "task.h"
 
 #include "cpu.h"
+#include "crash_dump.h"
 #include "log.h"
 #include "watchdog.h"
 
@@ -33,15 +34,22 @@ void vApplicationMallocFailedHook( void )
 
 void vApplicationStackOverflowHook( TaskHandle_t pxTask, char *pcTaskName )
 {
-	(void) pcTaskName;
 	(void) pxTask;
 
 	/* Run time stack overflow checking is performed if
 	configCHECK_FOR_STACK_OVERFLOW is defined to 1 or 2.  This hook
-	function is called if a stack overflow is detected. */
-
+	function is called if a stack overflow is detected, from the context
+	switch away from the overflowing task. The program counter of the
+	overflow is not known at this point. */
+	vStackMonitorOverflow( pcTaskName );
+	vCrashDumpSoftware( CRASH_DUMP_STACK_OVERFLOW, NULL, 0, 0, 0 );
+#ifdef RELEASE_BUILD
+	vWatchdogSetRebootReason( REBOOT_STACK_OVERFLOW, pcTaskName, 0, 0 );
+	vSystemReboot();
+#else
 	/* Force an assert. */
 	configASSERT( (volatile void *) NULL );
+#endif /* RELEASE_BUILD */
 }
 
 /*-----------------------------------------------------------*/
@@ -68,6 +76,8 @@ the stack and so not exists after this function exits. */
 	Note that, as the array is necessarily of type StackType_t,
 	configMINIMAL_STACK_SIZE is specified in words, not bytes. */
 	*pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+
+	STACK_MONITOR_REGISTER( "IDLE", uxIdleTaskStack, configMINIMAL_STACK_SIZE );
 }
 
 /*-----------------------------------------------------------*/
@@ -94,16 +104,15 @@ the stack and so not exists after this function exits. */
 	Note that, as the array is necessarily of type StackType_t,
 	configMINIMAL_STACK_SIZE is specified in words, not bytes. */
 	*pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+
+	STACK_MONITOR_REGISTER( "Tmr Svc", uxTimerTaskStack, configTIMER_TASK_STACK_DEPTH );
 }
 
 /*-----------------------------------------------------------*/
 
 void vAssertionFailed( const char *pcFile, int32_t lLine, uint32_t ulProgramCounter, uint32_t ulLinkRegister )
 {
-	UNUSED( pcFile );
-	UNUSED( lLine );
-	UNUSED( ulProgramCounter );
-	UNUSED( ulLinkRegister );
+	vCrashDumpSoftware( CRASH_DUMP_ASSERTION, pcFile, lLine, ulProgramCounter, ulLinkRegister );
 #ifdef RELEASE_BUILD
 	vWatchdogSetRebootReason( REBOOT_ASSERTION, pcTaskGetName( NULL ), ulProgramCounter, ulLinkRegister );
 	vSystemReboot();
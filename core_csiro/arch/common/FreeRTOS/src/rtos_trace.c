@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "rtos_trace.h"
+
+#if configUSE_RTOS_TRACE
+
+#include <string.h>
+
+#include "cpu.h"
+#include "csiro_math.h"
+#include "cycle_count.h"
+#include "log.h"
+#include "memory_operations.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+#define RTOS_TRACE_MASK             ( RTOS_TRACE_EVENTS - 1 )
+
+/* Events recorded when measuring the recording overhead */
+#define RTOS_TRACE_CALIBRATION      16
+
+/* Target timestamp frequency */
+#define RTOS_TRACE_TIMESTAMP_HZ     1000000UL
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+/* Function Declarations ------------------------------------*/
+
+static uint32_t prvTimestamp( void );
+static uint8_t  prvTaskTable( void );
+
+/* Private Variables ----------------------------------------*/
+
+CASSERT( ( RTOS_TRACE_EVENTS & RTOS_TRACE_MASK ) == 0, rtos_trace_c )
+CASSERT( sizeof( xRtosTraceRecord_t ) == 8, rtos_trace_c )
+
+static xRtosTraceRecord_t pxEvents[RTOS_TRACE_EVENTS];
+static uint32_t			  ulEventsWritten = 0;
+static bool				  bRecording	  = true;
+
+static uint64_t ullCycles	  = 0;
+static uint32_t ulLastCycles   = 0;
+static uint32_t ulCyclesPerTick = 0;
+static uint8_t  ucTimestampShift = 0;
+static uint16_t usOverheadCycles = 0;
+static bool		bInitialised	 = false;
+
+static uint32_t ulQueuesCreated = 0;
+
+/* Task states and run time counters from the previous call to ucRtosTraceTaskStats */
+static TaskStatus_t pxTaskStatus[RTOS_TRACE_MAX_TASKS];
+static uint8_t		pucPreviousTask[RTOS_TRACE_MAX_TASKS];
+static uint32_t		pulPreviousRunTime[RTOS_TRACE_MAX_TASKS];
+static uint8_t		ucPreviousTasks = 0;
+static bool			bTasksTruncated = false;
+
+/*-----------------------------------------------------------*/
+
+void vRtosTraceInit( void )
+{
+	xRtosTraceRecord_t pxSaved[RTOS_TRACE_CALIBRATION];
+	uint32_t		   ulCpuHz = configCPU_CLOCK_HZ;
+	uint32_t		   ulStart, ulWritten;
+	uint8_t			   i;
+
+	vInitCycleCount();
+	vStartCycleCount();
+
+	/* Largest power of 2 divisor that keeps timestamps at or above RTOS_TRACE_TIMESTAMP_HZ */
+	ucTimestampShift = 0;
+	while ( ( ulCpuHz >> ( ucTimestampShift + 1 ) ) >= RTOS_TRACE_TIMESTAMP_HZ ) {
+		ucTimestampShift++;
+	}
+	ulCyclesPerTick = ulCpuHz / configTICK_RATE_HZ;
+	ulLastCycles	= ulGetCycleCount();
+	bInitialised	= true;
+
+	/* Measure the cost of recording, restoring whatever the measurement overwrites */
+	ulWritten = ulEventsWritten;
+	for ( i = 0; i < RTOS_TRACE_CALIBRATION; i++ ) {
+		pxSaved[i] = pxEvents[( ulWritten + i ) & RTOS_TRACE_MASK];
+	}
+	ulStart = ulGetCycleCount();
+	for ( i = 0; i < RTOS_TRACE_CALIBRATION; i++ ) {
+		vRtosTraceEvent( RTOS_TRACE_USER, 0, 0 );
+	}
+	usOverheadCycles = ( ulGetCycleCount() - ulStart ) / RTOS_TRACE_CALIBRATION;
+	for ( i = 0; i < RTOS_TRACE_CALIBRATION; i++ ) {
+		pxEvents[( ulWritten + i ) & RTOS_TRACE_MASK] = pxSaved[i];
+	}
+	ulEventsWritten = ulWritten;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvTimestamp( void )
+{
+	uint32_t ulNow;
+
+	if ( !bInitialised ) {
+		return 0;
+	}
+	/* The cycle counter wraps in around a minute, it is extended by the regular tick calls */
+	ulNow = ulGetCycleCount();
+	ullCycles += ulNow - ulLastCycles;
+	ulLastCycles = ulNow;
+	return (uint32_t) ( ullCycles >> ucTimestampShift );
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulRtosTraceTimestamp( void )
+{
+	UBaseType_t uxMask = portSET_INTERRUPT_MASK_FROM_ISR();
+	uint32_t	ulTimestamp = prvTimestamp();
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxMask );
+	return ulTimestamp;
+}
+
+/*-----------------------------------------------------------*/
+
+void vRtosTraceTicksSkipped( uint32_t ulTicks )
+{
+	UBaseType_t uxMask = portSET_INTERRUPT_MASK_FROM_ISR();
+	/* Any cycles counted while woken during the sleep are also counted here, a small overestimate */
+	ullCycles += (uint64_t) ulTicks * ulCyclesPerTick;
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxMask );
+}
+
+/*-----------------------------------------------------------*/
+
+void vRtosTraceEvent( uint8_t ucEvent, uint32_t ulObject, uint32_t ulParam )
+{
+	xRtosTraceRecord_t *pxRecord;
+	UBaseType_t			uxMask = portSET_INTERRUPT_MASK_FROM_ISR();
+
+	if ( bRecording ) {
+		pxRecord			  = &pxEvents[ulEventsWritten & RTOS_TRACE_MASK];
+		pxRecord->ulTimestamp = prvTimestamp();
+		pxRecord->ucEvent	 = ucEvent;
+		pxRecord->ucObject	= (uint8_t) ulObject;
+		pxRecord->usParam	 = (uint16_t) ulParam;
+		ulEventsWritten++;
+	}
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxMask );
+}
+
+/*-----------------------------------------------------------*/
+
+void vRtosTraceIsr( uint8_t ucEvent )
+{
+	/* Exception numbers of external interrupts start at 16 */
+	vRtosTraceEvent( ucEvent, __get_IPSR() - 16, 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t uxRtosTraceQueueCreate( uint8_t ucQueueType )
+{
+	uint32_t ulQueueNumber = ++ulQueuesCreated;
+	vRtosTraceEvent( RTOS_TRACE_QUEUE_CREATE, ulQueueNumber, ucQueueType );
+	return ulQueueNumber;
+}
+
+/*-----------------------------------------------------------*/
+
+void vRtosTraceUser( uint8_t ucId, uint16_t usValue )
+{
+	vRtosTraceEvent( RTOS_TRACE_USER, ucId, usValue );
+}
+
+/*-----------------------------------------------------------*/
+
+void vRtosTraceEnable( bool bEnable )
+{
+	bRecording = bEnable;
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t ucRtosTraceLatest( xRtosTraceRecord_t *pxRecords, uint8_t ucMaxRecords )
+{
+	uint32_t ulWritten = ulEventsWritten;
+	uint32_t ulNum	 = MIN( MIN( ulWritten, RTOS_TRACE_EVENTS ), ucMaxRecords );
+	uint32_t i;
+
+	/* No locking, also called from fault handlers with the kernel in an unknown state */
+	for ( i = 0; i < ulNum; i++ ) {
+		pxRecords[i] = pxEvents[( ulWritten - ulNum + i ) & RTOS_TRACE_MASK];
+	}
+	return (uint8_t) ulNum;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t prvTaskTable( void )
+{
+	uint32_t	ulTotalRunTime;
+	UBaseType_t uxNumTasks = 0;
+
+	/* uxTaskGetSystemState fills nothing if the table is too small, so the table is reported empty and flagged */
+	bTasksTruncated = ( uxTaskGetNumberOfTasks() > RTOS_TRACE_MAX_TASKS );
+	if ( !bTasksTruncated ) {
+		uxNumTasks = uxTaskGetSystemState( pxTaskStatus, RTOS_TRACE_MAX_TASKS, &ulTotalRunTime );
+		/* Tasks created since the count was read */
+		bTasksTruncated = ( uxNumTasks == 0 );
+	}
+	return (uint8_t) uxNumTasks;
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t ucRtosTraceTaskStats( xRtosTaskStats_t *pxStats, uint8_t ucMaxStats )
+{
+	uint32_t pulDelta[RTOS_TRACE_MAX_TASKS];
+	uint32_t ulTotal = 0;
+	uint8_t  ucNumTasks, i, j;
+
+	ucNumTasks = prvTaskTable();
+	/* Run time since the previous call, tasks created since then are counted from zero */
+	for ( i = 0; i < ucNumTasks; i++ ) {
+		pulDelta[i] = pxTaskStatus[i].ulRunTimeCounter;
+		for ( j = 0; j < ucPreviousTasks; j++ ) {
+			if ( pucPreviousTask[j] == pxTaskStatus[i].xTaskNumber ) {
+				pulDelta[i] -= pulPreviousRunTime[j];
+				break;
+			}
+		}
+		ulTotal += pulDelta[i];
+	}
+	for ( i = 0; i < ucNumTasks; i++ ) {
+		pucPreviousTask[i]	= pxTaskStatus[i].xTaskNumber;
+		pulPreviousRunTime[i] = pxTaskStatus[i].ulRunTimeCounter;
+	}
+	ucPreviousTasks = ucNumTasks;
+
+	ucNumTasks = MIN( ucNumTasks, ucMaxStats );
+	for ( i = 0; i < ucNumTasks; i++ ) {
+		pvMemset( pxStats[i].pcName, 0x00, configMAX_TASK_NAME_LEN );
+		pvMemcpy( pxStats[i].pcName, pxTaskStatus[i].pcTaskName, MIN( strlen( pxTaskStatus[i].pcTaskName ), configMAX_TASK_NAME_LEN - 1 ) );
+		pxStats[i].ucTaskNumber  = pxTaskStatus[i].xTaskNumber;
+		pxStats[i].ucPriority	= pxTaskStatus[i].uxCurrentPriority;
+		pxStats[i].usCpuPermille = ( ulTotal == 0 ) ? 0 : (uint16_t) ( ( 1000 * (uint64_t) pulDelta[i] ) / ulTotal );
+		pxStats[i].usStackFree   = pxTaskStatus[i].usStackHighWaterMark;
+	}
+	return ucNumTasks;
+}
+
+/*-----------------------------------------------------------*/
+
+void vRtosTraceTaskStatsPrint( void )
+{
+	xRtosTaskStats_t pxStats[RTOS_TRACE_MAX_TASKS];
+	uint8_t			 ucNumTasks = ucRtosTraceTaskStats( pxStats, RTOS_TRACE_MAX_TASKS );
+	uint8_t			 i;
+
+	if ( bTasksTruncated ) {
+		eLog( LOG_APPLICATION, LOG_ERROR, "Task stats: more than %d tasks, increase RTOS_TRACE_MAX_TASKS\r\n", RTOS_TRACE_MAX_TASKS );
+		return;
+	}
+	eLog( LOG_APPLICATION, LOG_INFO, "Task       Pri    CPU  Stack\r\n" );
+	for ( i = 0; i < ucNumTasks; i++ ) {
+		eLog( LOG_APPLICATION, LOG_INFO, "%-10s %3d %3d.%d%% %6d\r\n", pxStats[i].pcName, pxStats[i].ucPriority, pxStats[i].usCpuPermille / 10, pxStats[i].usCpuPermille % 10, pxStats[i].usStackFree );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eRtosTraceDump( fnRtosTraceWrite_t fnWrite, void *pvContext )
+{
+	xRtosTraceHeader_t xHeader;
+	char			   pcName[configMAX_TASK_NAME_LEN];
+	uint32_t		   ulFirst, i;
+	uint8_t			   ucTaskNumber;
+	bool			   bWasRecording = bRecording;
+
+	vRtosTraceEnable( false );
+
+	pvMemset( &xHeader, 0x00, sizeof( xRtosTraceHeader_t ) );
+	pvMemcpy( xHeader.pcMagic, RTOS_TRACE_MAGIC, sizeof( xHeader.pcMagic ) );
+	xHeader.ucVersion		 = RTOS_TRACE_VERSION;
+	xHeader.ucNumTasks		 = prvTaskTable();
+	xHeader.ucFlags			 = bTasksTruncated ? RTOS_TRACE_FLAG_TASKS_TRUNCATED : 0;
+	xHeader.ucNameLength	 = configMAX_TASK_NAME_LEN;
+	xHeader.ulTimestampHz	= configCPU_CLOCK_HZ >> ucTimestampShift;
+	xHeader.ulNumEvents		 = MIN( ulEventsWritten, RTOS_TRACE_EVENTS );
+	xHeader.ulOverwritten	= ulEventsWritten - xHeader.ulNumEvents;
+	xHeader.usOverheadCycles = usOverheadCycles;
+	fnWrite( (uint8_t *) &xHeader, sizeof( xRtosTraceHeader_t ), pvContext );
+
+	for ( i = 0; i < xHeader.ucNumTasks; i++ ) {
+		ucTaskNumber = pxTaskStatus[i].xTaskNumber;
+		pvMemset( pcName, 0x00, configMAX_TASK_NAME_LEN );
+		pvMemcpy( pcName, pxTaskStatus[i].pcTaskName, MIN( strlen( pxTaskStatus[i].pcTaskName ), configMAX_TASK_NAME_LEN ) );
+		fnWrite( &ucTaskNumber, 1, pvContext );
+		fnWrite( (uint8_t *) pcName, configMAX_TASK_NAME_LEN, pvContext );
+	}
+
+	ulFirst = ulEventsWritten - xHeader.ulNumEvents;
+	for ( i = 0; i < xHeader.ulNumEvents; i++ ) {
+		fnWrite( (uint8_t *) &pxEvents[( ulFirst + i ) & RTOS_TRACE_MASK], sizeof( xRtosTraceRecord_t ), pvContext );
+	}
+
+	vRtosTraceEnable( bWasRecording );
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+#endif /* configUSE_RTOS_TRACE */
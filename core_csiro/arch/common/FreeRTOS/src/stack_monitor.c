@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "stack_monitor.h"
+
+#include <string.h>
+
+#include "compiler_intrinsics.h"
+#include "csiro_math.h"
+#include "memory_operations.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+#define STACK_MONITOR_WORD          sizeof( StackType_t )
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+typedef struct xStackMonitorTask_t
+{
+	const char *	pcName;
+	const uint32_t *pulStack;
+	uint16_t		usWords;
+	uint16_t		usFreeWords;
+} xStackMonitorTask_t;
+
+/* Function Declarations ------------------------------------*/
+
+#if configUSE_STACK_MONITOR
+static xStackMonitorTask_t *prvFind( const char *pcName );
+static void					prvPopulate( xStackMonitorTask_t *pxTask, const char *pcName, xStackMonitorReport_t *pxReport );
+#endif /* configUSE_STACK_MONITOR */
+
+/* Private Variables ----------------------------------------*/
+
+#if configUSE_STACK_MONITOR
+
+static xStackMonitorTask_t pxTasks[STACK_MONITOR_MAX_TASKS];
+static volatile uint8_t	   ucRegistered = 0;
+static uint8_t			   ucNextSample = 0;
+
+static const char *volatile pcOverflowName = NULL;
+
+/*-----------------------------------------------------------*/
+
+void vStackMonitorRegister( const char *pcName, void *pvStack, uint32_t ulStackWords )
+{
+	xStackMonitorTask_t *pxTask;
+
+	taskENTER_CRITICAL();
+	if ( ucRegistered < STACK_MONITOR_MAX_TASKS ) {
+		pxTask				= &pxTasks[ucRegistered];
+		pxTask->pcName		= pcName;
+		pxTask->pulStack	= (const uint32_t *) pvStack;
+		pxTask->usWords		= MIN( ulStackWords, UINT16_MAX );
+		pxTask->usFreeWords = pxTask->usWords;
+		ucRegistered++;
+	}
+	taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+void vStackMonitorSample( void )
+{
+	xStackMonitorTask_t *pxTask;
+	uint16_t			 usFree = 0;
+
+	if ( ucRegistered == 0 ) {
+		return;
+	}
+	pxTask		 = &pxTasks[ucNextSample];
+	ucNextSample = ( ucNextSample + 1 ) % ucRegistered;
+
+	/* Stacks grow down from the end of the buffer, the fill remains at the start until the stack
+	 * reaches it. Only the words up to the previous minimum need to be checked. */
+	while ( ( usFree < pxTask->usFreeWords ) && ( pxTask->pulStack[usFree] == STACK_MONITOR_FILL ) ) {
+		usFree++;
+	}
+	/* The overflow hook can clear the free space from the context switch */
+	taskENTER_CRITICAL();
+	pxTask->usFreeWords = MIN( pxTask->usFreeWords, usFree );
+	taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+static xStackMonitorTask_t *prvFind( const char *pcName )
+{
+	uint8_t i;
+	/* The kernel truncates task names to configMAX_TASK_NAME_LEN - 1 characters */
+	for ( i = 0; i < ucRegistered; i++ ) {
+		if ( strncmp( pxTasks[i].pcName, pcName, configMAX_TASK_NAME_LEN - 1 ) == 0 ) {
+			return &pxTasks[i];
+		}
+	}
+	return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+void vStackMonitorOverflow( const char *pcName )
+{
+	xStackMonitorTask_t *pxTask = prvFind( pcName );
+
+	if ( pxTask != NULL ) {
+		pxTask->usFreeWords = 0;
+	}
+	pcOverflowName = pcName;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPopulate( xStackMonitorTask_t *pxTask, const char *pcName, xStackMonitorReport_t *pxReport )
+{
+	strncpy( pxReport->pcName, pcName, configMAX_TASK_NAME_LEN );
+	pxReport->pcName[configMAX_TASK_NAME_LEN] = '\0';
+	pxReport->usSize						  = ( pxTask == NULL ) ? 0 : MIN( pxTask->usWords * STACK_MONITOR_WORD, UINT16_MAX );
+	pxReport->usFree						  = ( pxTask == NULL ) ? 0 : MIN( pxTask->usFreeWords * STACK_MONITOR_WORD, UINT16_MAX );
+}
+
+/*-----------------------------------------------------------*/
+
+bool bStackMonitorLowest( xStackMonitorReport_t *pxReport )
+{
+	xStackMonitorTask_t *pxLowest = NULL;
+	uint8_t				 i;
+
+	/* An overflowing task is reported even if it was never registered */
+	if ( pcOverflowName != NULL ) {
+		prvPopulate( prvFind( pcOverflowName ), pcOverflowName, pxReport );
+		pxReport->usFree = 0;
+		return true;
+	}
+	for ( i = 0; i < ucRegistered; i++ ) {
+		if ( ( pxLowest == NULL ) || ( pxTasks[i].usFreeWords < pxLowest->usFreeWords ) ) {
+			pxLowest = &pxTasks[i];
+		}
+	}
+	if ( pxLowest == NULL ) {
+		return false;
+	}
+	prvPopulate( pxLowest, pxLowest->pcName, pxReport );
+	return true;
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t ucStackMonitorReport( xStackMonitorReport_t *pxReports, uint8_t ucMaxReports )
+{
+	uint8_t ucNum = MIN( ucMaxReports, ucRegistered );
+	uint8_t i;
+
+	for ( i = 0; i < ucNum; i++ ) {
+		prvPopulate( &pxTasks[i], pxTasks[i].pcName, &pxReports[i] );
+	}
+	return ucNum;
+}
+
+/*-----------------------------------------------------------*/
+
+#else
+
+void vStackMonitorRegister( const char *pcName, void *pvStack, uint32_t ulStackWords )
+{
+	UNUSED( pcName );
+	UNUSED( pvStack );
+	UNUSED( ulStackWords );
+}
+
+/*-----------------------------------------------------------*/
+
+void vStackMonitorSample( void ) {}
+
+/*-----------------------------------------------------------*/
+
+void vStackMonitorOverflow( const char *pcName )
+{
+	UNUSED( pcName );
+}
+
+/*-----------------------------------------------------------*/
+
+bool bStackMonitorLowest( xStackMonitorReport_t *pxReport )
+{
+	pvMemset( pxReport, 0x00, sizeof( xStackMonitorReport_t ) );
+	return false;
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t ucStackMonitorReport( xStackMonitorReport_t *pxReports, uint8_t ucMaxReports )
+{
+	UNUSED( pxReports );
+	UNUSED( ucMaxReports );
+	return 0;
+}
+
+#endif /* configUSE_STACK_MONITOR */
+
+/*-----------------------------------------------------------*/
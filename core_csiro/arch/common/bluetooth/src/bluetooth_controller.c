@@ -12,6 +12,7 @@
 #include "queue.h"
 #include "task.h"
 
+#include "energy.h"
 #include "linked_list.h"
 #include "memory_pool.h"
 #include "rtc.h"
@@ -273,6 +274,9 @@ ATTR_NORETURN static void prvBtControllerTask( void *pvParameters )
 					xScanParams.usScanWindowMs   = xCommand.xParams.pxScanParams->usScanWindowMs;
 					xScanParams.fnCallback		 = xCommand.xParams.pxScanParams->fnCallback;
 					eError						 = eBluetoothGapScanConfigure( &xScanParams );
+					if ( ( eError == ERROR_NONE ) && ( xScanParams.usScanIntervalMs != 0 ) ) {
+						vEnergyDuty( ENERGY_RADIO_SCAN, ( (uint32_t) xScanParams.usScanWindowMs * ENERGY_DUTY_FULL ) / xScanParams.usScanIntervalMs );
+					}
 					break;
 				case COMMAND_CFG_CONN:
 					xConnParams.usConnectionInterval  = xCommand.xParams.pxConnParams->usConnectionInterval;
@@ -455,6 +459,7 @@ void vBluetoothControllerAdvertisingComplete( void )
 	xAdvertisingInfo_t *pxAdv				  = (xAdvertisingInfo_t *) pxCurrentlyAdvertising;
 	bool				bWasLastPacketInChain = ( pxCurrentlyAdvertising == pxLastToAdvertise );
 	xDateTime_t			xDatetime;
+	vEnergyEvent( ENERGY_RADIO_ADVERTISE, 1 );
 	bRtcGetDatetime( &xDatetime );
 	eLog( LOG_BLUETOOTH_GAP, LOG_INFO, "BT %2d.%05d: Advertising packet complete\r\n", xDatetime.xTime.ucSecond, xDatetime.xTime.usSecondFraction );
 	/* If this data is done, remove it from the list */
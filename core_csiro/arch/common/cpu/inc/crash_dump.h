@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: crash_dump.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Post-mortem records of faults, assertions and watchdog resets
+ *
+ * The record is written to .noinit RAM when the failure is detected and survives the
+ * following software or watchdog reset. It contains the register frame, a snapshot of the
+ * stack above the stack pointer, the running task, the format strings of the most recent
+ * log messages and, with configUSE_RTOS_TRACE, the most recent trace events.
+ *
+ * The fault handlers save r4-r11 before branching to C, so fault records contain every
+ * core register. Watchdog records contain the registers stacked by the exception entry,
+ * assertion and stack overflow records only the PC, LR and SP.
+ *
+ * Only the first failure since boot is recorded. The stack overflow hook and the watchdog
+ * handler assert in debug builds, which would otherwise replace the original record.
+ *
+ * After reboot pxCrashDumpRecord returns the record once, eCrashDumpLog sends it as a
+ * TDF_CRASH_DUMP summary followed by the raw record in TDF_CRASH_DUMP_DATA chunks.
+ * pyclasses/crash_dump.py reassembles the chunks and symbolises the record against the ELF.
+ *
+ * The layout of xCrashDump_t is fixed, changes require a new CRASH_DUMP_VERSION.
+ *
+ */
+#ifndef __CSIRO_CORE_CRASH_DUMP
+#define __CSIRO_CORE_CRASH_DUMP
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#include "rtos_trace.h"
+#include "tdf.h"
+
+/* Module Defines -------------------------------------------*/
+// clang-format off
+
+#define CRASH_DUMP_KEY              0x48535243UL /* "CRSH" */
+#define CRASH_DUMP_VERSION          1
+
+#define CRASH_DUMP_NAME_LEN         12
+#define CRASH_DUMP_FILE_LEN         24
+#define CRASH_DUMP_REGISTERS        17
+#define CRASH_DUMP_STACK_WORDS      64
+#define CRASH_DUMP_LOG_EVENTS       8
+#define CRASH_DUMP_TRACE_EVENTS     16
+
+/* Data bytes in each TDF_CRASH_DUMP_DATA */
+#define CRASH_DUMP_CHUNK            24
+
+/* xCrashDump_t.ucFlags */
+#define CRASH_DUMP_CALLEE_SAVED     0x01 /* r4-r11 are valid */
+#define CRASH_DUMP_CALLER_SAVED     0x02 /* r0-r3, r12 and xPSR are valid */
+#define CRASH_DUMP_HANDLER_MODE     0x04 /* Failed in an interrupt, see the stacked xPSR */
+#define CRASH_DUMP_FPU_FRAME        0x08 /* Exception entry stacked the FPU registers */
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+typedef enum eCrashDumpType_t {
+	CRASH_DUMP_NMI			  = 2, /**< Fault types are the exception number */
+	CRASH_DUMP_HARD_FAULT	 = 3,
+	CRASH_DUMP_MEM_MANAGE	 = 4,
+	CRASH_DUMP_BUS_FAULT	  = 5,
+	CRASH_DUMP_USAGE_FAULT	= 6,
+	CRASH_DUMP_WATCHDOG		  = 0x80,
+	CRASH_DUMP_ASSERTION	  = 0x81,
+	CRASH_DUMP_STACK_OVERFLOW = 0x82
+} eCrashDumpType_t;
+
+typedef enum eCrashDumpRegister_t {
+	CRASH_DUMP_R0 = 0,
+	CRASH_DUMP_R12 = 12,
+	CRASH_DUMP_SP,
+	CRASH_DUMP_LR,
+	CRASH_DUMP_PC,
+	CRASH_DUMP_XPSR
+} eCrashDumpRegister_t;
+
+/**@brief Log message, the format string is resolved from the ELF */
+typedef struct xCrashDumpLogEvent_t
+{
+	uint32_t ulFormat; /**< Address of the format string */
+	uint32_t ulTick;   /**< Kernel tick count */
+} xCrashDumpLogEvent_t;
+
+typedef struct xCrashDump_t
+{
+	uint32_t			 ulKey;									 /**< CRASH_DUMP_KEY */
+	uint16_t			 usVersion;								 /**< CRASH_DUMP_VERSION */
+	uint16_t			 usLength;								 /**< sizeof( xCrashDump_t ) */
+	uint32_t			 ulCrc;									 /**< CRC32 (IEEE 802.3) of everything after this field */
+	uint8_t				 ucType;								 /**< eCrashDumpType_t */
+	uint8_t				 ucFlags;								 /**< CRASH_DUMP_CALLEE_SAVED etc */
+	uint8_t				 ucStackWords;							 /**< Valid words in pulStack */
+	uint8_t				 ucLogEvents;							 /**< Valid entries in pxLog */
+	uint8_t				 ucTraceEvents;							 /**< Valid entries in pxTrace */
+	uint8_t				 pucReserved[3];						 /**< Zero */
+	char				 pcTaskName[CRASH_DUMP_NAME_LEN];		 /**< Running task, empty before the scheduler starts */
+	uint32_t			 ulTick;								 /**< Kernel tick count */
+	uint32_t			 pulRegisters[CRASH_DUMP_REGISTERS];	 /**< r0-r12, SP, LR, PC, xPSR at the failure */
+	uint32_t			 ulExcReturn;							 /**< EXC_RETURN of the fault handler */
+	uint32_t			 ulCfsr;								 /**< Configurable Fault Status Register */
+	uint32_t			 ulHfsr;								 /**< HardFault Status Register */
+	uint32_t			 ulFaultAddress;						 /**< MMFAR or BFAR if valid, otherwise 0 */
+	char				 pcFile[CRASH_DUMP_FILE_LEN];			 /**< Assertion file name, truncated from the start */
+	uint32_t			 ulLine;								 /**< Assertion line */
+	uint32_t			 pulStack[CRASH_DUMP_STACK_WORDS];		 /**< Stack from SP upwards */
+	xCrashDumpLogEvent_t pxLog[CRASH_DUMP_LOG_EVENTS];			 /**< Most recent log messages, oldest first */
+	xRtosTraceRecord_t	 pxTrace[CRASH_DUMP_TRACE_EVENTS];		 /**< Most recent trace events, oldest first */
+} xCrashDump_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Record a failure detected by an exception
+ *
+ * @param[in] eType					Failure type
+ * @param[in] pulFrame				Registers stacked on exception entry
+ * @param[in] ulExcReturn			EXC_RETURN value of the handler
+ * @param[in] pulCalleeSaved		r4-r11 saved by the handler, NULL if not available
+ */
+void vCrashDumpException( eCrashDumpType_t eType, uint32_t *pulFrame, uint32_t ulExcReturn, uint32_t *pulCalleeSaved );
+
+/**@brief Record a failure detected by software
+ *
+ * @param[in] eType					Failure type
+ * @param[in] pcFile				Source file, NULL if unknown
+ * @param[in] ulLine				Source line
+ * @param[in] ulProgramCounter		Program counter
+ * @param[in] ulLinkRegister		Link register
+ */
+void vCrashDumpSoftware( eCrashDumpType_t eType, const char *pcFile, uint32_t ulLine, uint32_t ulProgramCounter, uint32_t ulLinkRegister );
+
+/**@brief Remember a log message for the next record, called by eLog
+ *
+ * @param[in] pcFormat				Format string of the message
+ */
+void vCrashDumpLogEvent( const char *pcFormat );
+
+/**@brief Record written by the first call to vCrashDumpException or vCrashDumpSoftware since boot
+ *
+ * For inspection before the reset, with a debugger or to populate the reboot reason
+ */
+const xCrashDump_t *pxCrashDumpCurrent( void );
+
+/**@brief Record stored before the last reset
+ *
+ * The record is invalidated by the first call, later calls return the same result
+ *
+ * @retval							Valid record, NULL if there is none
+ */
+xCrashDump_t *pxCrashDumpRecord( void );
+
+/**@brief Log a record as TDF_CRASH_DUMP and the raw record as TDF_CRASH_DUMP_DATA chunks
+ *
+ * @param[in] ucLoggerMask			Loggers to log to
+ * @param[in] eTimestampType		Timestamp type of the TDFs
+ * @param[in] pxTime				Timestamp of the TDFs
+ * @param[in] pxDump				Record from pxCrashDumpRecord
+ *
+ * @retval ::ERROR_NONE 			TDFs logged
+ */
+eModuleError_t eCrashDumpLog( uint8_t ucLoggerMask, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, xCrashDump_t *pxDump );
+
+#endif /* __CSIRO_CORE_CRASH_DUMP */
@@ -5,18 +5,39 @@
  */
 /* Includes -------------------------------------------------*/
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include "compiler_intrinsics.h"
+#include "cpu.h"
+#include "crash_dump.h"
+#include "watchdog.h"
 
 /* Private Defines ------------------------------------------*/
 // clang-format off
 
+/* Save r4-r11 below the exception frame and pass the frame, EXC_RETURN and saved registers */
+#define FAULT_HANDLER_BUILD( IRQ_NAME )                                 \
+	ATTR_NAKED void IRQ_NAME( void )                                    \
+	{                                                                   \
+		__asm volatile(                                                 \
+			" tst lr, #4                                            \n" \
+			" ite eq                                                \n" \
+			" mrseq r0, msp                                         \n" \
+			" mrsne r0, psp                                         \n" \
+			" mov r1, lr                                            \n" \
+			" push {r4-r11}                                         \n" \
+			" mov r2, sp                                            \n" \
+			" b prvFaultHandler                                     \n" ); \
+	}
+
 // clang-format on
 
 /* Type Definitions -----------------------------------------*/
 
 /* Function Declarations ------------------------------------*/
 
-void prvGetRegistersFromStack( uint32_t *pulFaultStackAddress );
+void prvFaultHandler( uint32_t *pulFaultStackAddress, uint32_t ulExcReturn, uint32_t *pulCalleeSaved );
 
 /* Private Variables ----------------------------------------*/
 
@@ -29,72 +50,40 @@ void NMI_Handler( void )
 
 /*-----------------------------------------------------------*/
 
-ATTR_NAKED void HardFault_Handler( void )
-{
-	__asm volatile(
-		" tst lr, #4                                                \n"
-		" ite eq                                                    \n"
-		" mrseq r0, msp                                             \n"
-		" mrsne r0, psp                                             \n"
-		" b prvGetRegistersFromStack                                \n" );
-}
+FAULT_HANDLER_BUILD( HardFault_Handler )
 
 /*-----------------------------------------------------------*/
 
-void MemManage_Handler( void )
-{
-	while ( 1 ) continue;
-}
+FAULT_HANDLER_BUILD( MemManage_Handler )
 
 /*-----------------------------------------------------------*/
 
-void BusFault_Handler( void )
-{
-	while ( 1 ) continue;
-}
+FAULT_HANDLER_BUILD( BusFault_Handler )
 
 /*-----------------------------------------------------------*/
 
-void UsageFault_Handler( void )
-{
-	while ( 1 ) continue;
-}
+FAULT_HANDLER_BUILD( UsageFault_Handler )
 
 /*-----------------------------------------------------------*/
 
-void prvGetRegistersFromStack( uint32_t *pulFaultStackAddress )
+void prvFaultHandler( uint32_t *pulFaultStackAddress, uint32_t ulExcReturn, uint32_t *pulCalleeSaved )
 {
-	/**
-	 * These are volatile to try and prevent the compiler/linker optimising
-	 * them away as the variables never actually get used.  If the debugger
-	 * won't show the values of the variables, make them global my moving their
-	 * declaration outside of this function.
-	 **/
-
-	COMPILER_WARNING_DISABLE( "-Wunused-but-set-variable" );
-
-	volatile uint32_t r0;
-	volatile uint32_t r1;
-	volatile uint32_t r2;
-	volatile uint32_t r3;
-	volatile uint32_t r12;
-	volatile uint32_t lr;  /* Link register. */
-	volatile uint32_t pc;  /* Program counter. */
-	volatile uint32_t psr; /* Program status register. */
-
-	r0 = pulFaultStackAddress[0];
-	r1 = pulFaultStackAddress[1];
-	r2 = pulFaultStackAddress[2];
-	r3 = pulFaultStackAddress[3];
-
-	r12 = pulFaultStackAddress[4];
-	lr  = pulFaultStackAddress[5];
-	pc  = pulFaultStackAddress[6];
-	psr = pulFaultStackAddress[7];
-
-	COMPILER_WARNING_ENABLE();
-
-	/* When the following line is hit, the variables contain the register values. */
+	const xCrashDump_t *pxDump;
+	uint32_t			ulException;
+
+	/* The active exception number is the fault type */
+	__asm volatile( "mrs %0, ipsr" : "=r"( ulException ) );
+	vCrashDumpException( (eCrashDumpType_t) ( ulException & 0x1FF ), pulFaultStackAddress, ulExcReturn, pulCalleeSaved );
+	pxDump = pxCrashDumpCurrent();
+	UNUSED( pxDump );
+
+#ifdef RELEASE_BUILD
+	/* The frame may be invalid, the record only contains the registers if it was readable */
+	vWatchdogSetRebootReason( REBOOT_FAULT, pxDump->pcTaskName, pxDump->pulRegisters[CRASH_DUMP_PC], pxDump->pulRegisters[CRASH_DUMP_LR] );
+	vSystemReboot();
+#endif /* RELEASE_BUILD */
+
+	/* When the following line is hit, the crash dump contains the register values. */
 	for ( ;; )
 		;
 }
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "crash_dump.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "compiler_intrinsics.h"
+#include "csiro_math.h"
+#include "memory_operations.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+/* System Control Block fault registers */
+#define SCB_CFSR                    ( *(volatile uint32_t *) 0xE000ED28UL )
+#define SCB_HFSR                    ( *(volatile uint32_t *) 0xE000ED2CUL )
+#define SCB_MMFAR                   ( *(volatile uint32_t *) 0xE000ED34UL )
+#define SCB_BFAR                    ( *(volatile uint32_t *) 0xE000ED38UL )
+
+#define CFSR_MMARVALID              ( 1UL << 7 )
+#define CFSR_BFARVALID              ( 1UL << 15 )
+
+/* EXC_RETURN bits */
+#define EXC_RETURN_THREAD_MODE      ( 1UL << 3 )
+#define EXC_RETURN_BASIC_FRAME      ( 1UL << 4 )
+
+/* Stacked xPSR bit indicating a padding word was added to align the frame */
+#define XPSR_STACK_ALIGN            ( 1UL << 9 )
+
+#define FRAME_BASIC_WORDS           8
+#define FRAME_EXTENDED_WORDS        26
+
+#define CRASH_DUMP_CRC_OFFSET       offsetof( xCrashDump_t, ucType )
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+/* Function Declarations ------------------------------------*/
+
+static void		prvStringCopy( char *pcDestination, const char *pcSource, size_t xSize );
+static void		prvStart( eCrashDumpType_t eType );
+static void		prvStack( const uint32_t *pulStackPointer );
+static void		prvFinish( void );
+static uint32_t prvCrc( const uint8_t *pucData, uint32_t ulLength );
+
+/* Private Variables ----------------------------------------*/
+
+CASSERT( sizeof( xCrashDump_t ) == 596, crash_dump_c )
+
+/* Provided by the linker script, stack pointers outside this range are not followed */
+extern uint32_t __reserved_ram_start__[];
+extern uint32_t __StackTop[];
+
+static xCrashDump_t xCrashDump ATTR_SECTION( ".noinit" );
+
+static xCrashDumpLogEvent_t pxLogEvents[CRASH_DUMP_LOG_EVENTS];
+static uint32_t				ulLogEventsWritten = 0;
+
+static xCrashDump_t *pxPreviousDump = NULL;
+static bool			 bChecked		= false;
+
+/* A record was completed since boot, later failures are consequences of the same fault */
+static bool bRecorded = false;
+
+/*-----------------------------------------------------------*/
+
+/* Copies at most xSize - 1 characters and always terminates, truncation is expected */
+static void prvStringCopy( char *pcDestination, const char *pcSource, size_t xSize )
+{
+	size_t i;
+
+	for ( i = 0; ( i < xSize - 1 ) && ( pcSource[i] != '\0' ); i++ ) {
+		pcDestination[i] = pcSource[i];
+	}
+	pcDestination[i] = '\0';
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvStart( eCrashDumpType_t eType )
+{
+	uint32_t i;
+
+	pvMemset( &xCrashDump, 0x00, sizeof( xCrashDump_t ) );
+	xCrashDump.usVersion = CRASH_DUMP_VERSION;
+	xCrashDump.usLength  = sizeof( xCrashDump_t );
+	xCrashDump.ucType	= eType;
+
+	/* The kernel may be in any state, only read variables that are always valid */
+	if ( xTaskGetCurrentTaskHandle() != NULL ) {
+		prvStringCopy( xCrashDump.pcTaskName, pcTaskGetName( NULL ), CRASH_DUMP_NAME_LEN );
+	}
+	xCrashDump.ulTick = xTaskGetTickCount();
+
+	xCrashDump.ucLogEvents = MIN( ulLogEventsWritten, CRASH_DUMP_LOG_EVENTS );
+	for ( i = 0; i < xCrashDump.ucLogEvents; i++ ) {
+		xCrashDump.pxLog[i] = pxLogEvents[( ulLogEventsWritten - xCrashDump.ucLogEvents + i ) % CRASH_DUMP_LOG_EVENTS];
+	}
+#if configUSE_RTOS_TRACE
+	xCrashDump.ucTraceEvents = ucRtosTraceLatest( xCrashDump.pxTrace, CRASH_DUMP_TRACE_EVENTS );
+#endif /* configUSE_RTOS_TRACE */
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvStack( const uint32_t *pulStackPointer )
+{
+	const uint32_t *pulStackEnd = pulStackPointer;
+
+	xCrashDump.pulRegisters[CRASH_DUMP_SP] = (uint32_t) (uintptr_t) pulStackPointer;
+	/* A corrupted stack pointer must not cause a second fault */
+	if ( ( pulStackPointer < __reserved_ram_start__ ) || ( pulStackPointer >= __StackTop ) || ( ( (uintptr_t) pulStackPointer & 0x3 ) != 0 ) ) {
+		return;
+	}
+	while ( ( pulStackEnd < __StackTop ) && ( ( pulStackEnd - pulStackPointer ) < CRASH_DUMP_STACK_WORDS ) ) {
+		pulStackEnd++;
+	}
+	xCrashDump.ucStackWords = pulStackEnd - pulStackPointer;
+	pvMemcpy( xCrashDump.pulStack, pulStackPointer, xCrashDump.ucStackWords * sizeof( uint32_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvCrc( const uint8_t *pucData, uint32_t ulLength )
+{
+	uint32_t ulCrc = 0xFFFFFFFF;
+	uint8_t  i;
+
+	/* Bitwise CRC32 (IEEE 802.3), the hardware CRC may not be usable from a fault */
+	while ( ulLength-- ) {
+		ulCrc ^= *pucData++;
+		for ( i = 0; i < 8; i++ ) {
+			ulCrc = ( ulCrc >> 1 ) ^ ( 0xEDB88320 & -( ulCrc & 1 ) );
+		}
+	}
+	return ~ulCrc;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFinish( void )
+{
+	const uint8_t *pucRecord = (const uint8_t *) &xCrashDump;
+
+	xCrashDump.ulCrc = prvCrc( pucRecord + CRASH_DUMP_CRC_OFFSET, sizeof( xCrashDump_t ) - CRASH_DUMP_CRC_OFFSET );
+	xCrashDump.ulKey = CRASH_DUMP_KEY;
+	bRecorded		 = true;
+}
+
+/*-----------------------------------------------------------*/
+
+void vCrashDumpException( eCrashDumpType_t eType, uint32_t *pulFrame, uint32_t ulExcReturn, uint32_t *pulCalleeSaved )
+{
+	uint32_t ulFrameWords;
+	uint32_t i;
+
+	if ( bRecorded ) {
+		return;
+	}
+	prvStart( eType );
+	xCrashDump.ulExcReturn = ulExcReturn;
+	xCrashDump.ulCfsr	  = SCB_CFSR;
+	xCrashDump.ulHfsr	  = SCB_HFSR;
+	if ( xCrashDump.ulCfsr & CFSR_MMARVALID ) {
+		xCrashDump.ulFaultAddress = SCB_MMFAR;
+	}
+	else if ( xCrashDump.ulCfsr & CFSR_BFARVALID ) {
+		xCrashDump.ulFaultAddress = SCB_BFAR;
+	}
+	if ( !( ulExcReturn & EXC_RETURN_THREAD_MODE ) ) {
+		xCrashDump.ucFlags |= CRASH_DUMP_HANDLER_MODE;
+	}
+	if ( pulCalleeSaved != NULL ) {
+		for ( i = 0; i < 8; i++ ) {
+			xCrashDump.pulRegisters[4 + i] = pulCalleeSaved[i];
+		}
+		xCrashDump.ucFlags |= CRASH_DUMP_CALLEE_SAVED;
+	}
+	/* The frame itself can be the invalid access, it is only read if the stack pointer is plausible */
+	if ( ( pulFrame >= __reserved_ram_start__ ) && ( ( pulFrame + FRAME_BASIC_WORDS ) <= __StackTop ) ) {
+		/* Stacked frame is r0, r1, r2, r3, r12, LR, PC, xPSR */
+		for ( i = 0; i < 4; i++ ) {
+			xCrashDump.pulRegisters[i] = pulFrame[i];
+		}
+		xCrashDump.pulRegisters[CRASH_DUMP_R12]  = pulFrame[4];
+		xCrashDump.pulRegisters[CRASH_DUMP_LR]   = pulFrame[5];
+		xCrashDump.pulRegisters[CRASH_DUMP_PC]   = pulFrame[6];
+		xCrashDump.pulRegisters[CRASH_DUMP_XPSR] = pulFrame[7];
+		xCrashDump.ucFlags |= CRASH_DUMP_CALLER_SAVED;
+	}
+	/* Stack pointer before the exception entry */
+	ulFrameWords = FRAME_BASIC_WORDS;
+	if ( !( ulExcReturn & EXC_RETURN_BASIC_FRAME ) ) {
+		ulFrameWords = FRAME_EXTENDED_WORDS;
+		xCrashDump.ucFlags |= CRASH_DUMP_FPU_FRAME;
+	}
+	if ( xCrashDump.pulRegisters[CRASH_DUMP_XPSR] & XPSR_STACK_ALIGN ) {
+		ulFrameWords++;
+	}
+	prvStack( pulFrame + ulFrameWords );
+	prvFinish();
+}
+
+/*-----------------------------------------------------------*/
+
+void vCrashDumpSoftware( eCrashDumpType_t eType, const char *pcFile, uint32_t ulLine, uint32_t ulProgramCounter, uint32_t ulLinkRegister )
+{
+	volatile uint32_t ulStackMarker = 0;
+	size_t			  xLength;
+
+	/* The assertion from the stack overflow hook or the watchdog handler in debug builds must not replace their record */
+	if ( bRecorded ) {
+		return;
+	}
+	prvStart( eType );
+	if ( pcFile != NULL ) {
+		/* Keep the end of the path, which identifies the file */
+		xLength = strlen( pcFile );
+		if ( xLength >= CRASH_DUMP_FILE_LEN ) {
+			pcFile += xLength - ( CRASH_DUMP_FILE_LEN - 1 );
+		}
+		prvStringCopy( xCrashDump.pcFile, pcFile, CRASH_DUMP_FILE_LEN );
+	}
+	xCrashDump.ulLine						= ulLine;
+	xCrashDump.pulRegisters[CRASH_DUMP_PC] = ulProgramCounter;
+	xCrashDump.pulRegisters[CRASH_DUMP_LR] = ulLinkRegister;
+	/* The stack of this function, which includes the frames of the callers */
+	prvStack( (const uint32_t *) &ulStackMarker );
+	prvFinish();
+}
+
+/*-----------------------------------------------------------*/
+
+void vCrashDumpLogEvent( const char *pcFormat )
+{
+	UBaseType_t			  uxMask = portSET_INTERRUPT_MASK_FROM_ISR();
+	xCrashDumpLogEvent_t *pxEvent;
+
+	pxEvent			   = &pxLogEvents[ulLogEventsWritten % CRASH_DUMP_LOG_EVENTS];
+	pxEvent->ulFormat = (uint32_t) (uintptr_t) pcFormat;
+	pxEvent->ulTick   = xTaskGetTickCount();
+	ulLogEventsWritten++;
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxMask );
+}
+
+/*-----------------------------------------------------------*/
+
+const xCrashDump_t *pxCrashDumpCurrent( void )
+{
+	return &xCrashDump;
+}
+
+/*-----------------------------------------------------------*/
+
+xCrashDump_t *pxCrashDumpRecord( void )
+{
+	const uint8_t *pucRecord = (const uint8_t *) &xCrashDump;
+
+	if ( bChecked ) {
+		return pxPreviousDump;
+	}
+	bChecked = true;
+	if ( ( xCrashDump.ulKey == CRASH_DUMP_KEY ) && ( xCrashDump.usVersion == CRASH_DUMP_VERSION ) && ( xCrashDump.usLength == sizeof( xCrashDump_t ) ) ) {
+		if ( xCrashDump.ulCrc == prvCrc( pucRecord + CRASH_DUMP_CRC_OFFSET, sizeof( xCrashDump_t ) - CRASH_DUMP_CRC_OFFSET ) ) {
+			pxPreviousDump = &xCrashDump;
+		}
+	}
+	/* The record is reported once */
+	xCrashDump.ulKey = 0;
+	return pxPreviousDump;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eCrashDumpLog( uint8_t ucLoggerMask, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, xCrashDump_t *pxDump )
+{
+	const uint8_t *		  pucRecord = (const uint8_t *) pxDump;
+	tdf_crash_dump_t	  xSummary;
+	tdf_crash_dump_data_t xData;
+	eModuleError_t		  eError;
+	uint16_t			  usOffset;
+
+	xSummary.type = pxDump->ucType;
+	pvMemset( xSummary.procName, ' ', sizeof( xSummary.procName ) );
+	pvMemcpy( xSummary.procName, pxDump->pcTaskName, MIN( strlen( pxDump->pcTaskName ), sizeof( xSummary.procName ) ) );
+	xSummary.pc			   = pxDump->pulRegisters[CRASH_DUMP_PC];
+	xSummary.lr			   = pxDump->pulRegisters[CRASH_DUMP_LR];
+	xSummary.sp			   = pxDump->pulRegisters[CRASH_DUMP_SP];
+	xSummary.cfsr		   = pxDump->ulCfsr;
+	xSummary.fault_address = pxDump->ulFaultAddress;
+	xSummary.uptime		   = pxDump->ulTick / configTICK_RATE_HZ;
+	eError				   = eTdfAddMulti( ucLoggerMask, TDF_CRASH_DUMP, eTimestampType, pxTime, &xSummary );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	for ( usOffset = 0; usOffset < sizeof( xCrashDump_t ); usOffset += CRASH_DUMP_CHUNK ) {
+		xData.offset = usOffset;
+		pvMemset( xData.data, 0x00, CRASH_DUMP_CHUNK );
+		pvMemcpy( xData.data, pucRecord + usOffset, MIN( CRASH_DUMP_CHUNK, sizeof( xCrashDump_t ) - usOffset ) );
+		eError = eTdfAddMulti( ucLoggerMask, TDF_CRASH_DUMP_DATA, eTimestampType, pxTime, &xData );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
@@ -67,6 +67,7 @@ typedef struct _xAdcPlatform_t xAdcPlatform_t;
         .xPlatform = ADC_MODULE_PLATFORM_DEFAULT( HANDLE ),         \
         .xModuleAvailableHandle     = NULL,                         \
 		.xModuleAvailableStorage    = { { 0 } },                    \
+        .pxContinuous               = NULL,                         \
     };                                                              \
     ADC_MODULE_PLATFORM_SUFFIX( NAME, IRQ );                        \
 
@@ -76,11 +77,37 @@ typedef struct _xAdcPlatform_t xAdcPlatform_t;
 // clang-format on
 /* Type Definitions ---------------------------------------------------------*/
 
+/**
+ * Called from the ADC interrupt with each block of a continuous sampling run.
+ *
+ * Samples are interleaved by scan, in the order of the scan group:
+ * 		psSamples[ scan * ucNumChannels + channel ]
+ * Values are signed raw readings at the configured resolution. The buffer is
+ * handed back to the ADC when the callback returns, so the callback must copy
+ * out or reduce the data before returning.
+ **/
+typedef void ( *fnAdcBlockCallback_t )( const int16_t *psSamples, uint16_t usNumScans, uint8_t ucNumChannels, void *pvContext );
+
+typedef struct xAdcContinuousConfig_t
+{
+	const xGpio_t *		   pxChannels;		  /**< Inputs of the scan group, sampled in this order */
+	uint8_t				   ucNumChannels;	  /**< Number of inputs */
+	eAdcResolution_t	   eResolution;		  /**< Resolution of every input */
+	eAdcReferenceVoltage_t eReferenceVoltage; /**< Reference of every input */
+	uint32_t			   ulSamplePeriodUs;  /**< Hardware timer period between scans */
+	int16_t *			   ppsBuffers[2];	  /**< DMA buffers of usBlockScans * ucNumChannels samples */
+	uint16_t			   usBlockScans;	  /**< Scans per DMA buffer */
+	uint8_t				   ucDecimation;	  /**< Scans averaged into each delivered scan, 0 or 1 for none */
+	fnAdcBlockCallback_t   fnCallback;		  /**< Block callback, run from the ADC interrupt */
+	void *				   pvContext;		  /**< Passed to fnCallback */
+} xAdcContinuousConfig_t;
+
 struct _xAdcModule_t
 {
-	xAdcPlatform_t	xPlatform;
-	SemaphoreHandle_t xModuleAvailableHandle;
-	StaticSemaphore_t xModuleAvailableStorage;
+	xAdcPlatform_t				  xPlatform;
+	SemaphoreHandle_t			  xModuleAvailableHandle;
+	StaticSemaphore_t			  xModuleAvailableStorage;
+	const xAdcContinuousConfig_t *pxContinuous;
 };
 
 /* Function Declarations ----------------------------------------------------*/
@@ -91,6 +118,49 @@ uint32_t ulAdcSample( xAdcModule_t *xAdcModule, xGpio_t xGpio, eAdcResolution_t
 
 eModuleError_t eAdcRecalibrate( xAdcModule_t *xAdcModule );
 
+/**
+ * Start sampling a scan group continuously.
+ *
+ * A hardware timer triggers a scan of every input each ulSamplePeriodUs, and
+ * results are written by DMA into the two buffers alternately. Each full buffer
+ * is optionally decimated in place and then passed to fnCallback, while the
+ * other buffer fills. No task is woken while sampling.
+ *
+ * The ADC is held until eAdcContinuousStop is called, ulAdcSample and
+ * eAdcRecalibrate cannot be used in the meantime. pxConfig and the buffers
+ * must remain valid until then.
+ *
+ * \param pxAdcModule The ADC module
+ * \param pxConfig Scan group, timing and block configuration
+ * \return ERROR_INVALID_DATA if the configuration is unsupported
+ *		   ERROR_UNAVAILABLE_RESOURCE if the platform cannot sample continuously
+ *		   ERROR_TIMEOUT if the ADC is in use
+ **/
+eModuleError_t eAdcContinuousStart( xAdcModule_t *pxAdcModule, const xAdcContinuousConfig_t *pxConfig );
+
+/**
+ * Stop a continuous sampling run and release the ADC.
+ * The partially filled block is discarded.
+ *
+ * \param pxAdcModule The ADC module
+ * \return ERROR_INVALID_STATE if the ADC was not sampling continuously
+ **/
+eModuleError_t eAdcContinuousStop( xAdcModule_t *pxAdcModule );
+
+/**
+ * Average each group of ucFactor consecutive scans into one, in place.
+ *
+ * Each output value is the sum of its ucFactor inputs divided by ucFactor,
+ * truncated toward zero. usNumScans must be a multiple of ucFactor.
+ *
+ * \param psSamples Interleaved scans, overwritten with the decimated scans
+ * \param usNumScans Number of scans in psSamples
+ * \param ucNumChannels Samples per scan
+ * \param ucFactor Decimation factor
+ * \return Number of scans after decimation
+ **/
+uint16_t usAdcDecimate( int16_t *psSamples, uint16_t usNumScans, uint8_t ucNumChannels, uint8_t ucFactor );
+
 /*---------------------------------------------------------------------------*/
 
 #endif /* __CORE_CSIRO_INTERFACE_ADC */
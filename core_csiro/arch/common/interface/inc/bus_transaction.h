@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: bus_transaction.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Asynchronous transaction queue shared by the SPI and I2C drivers
+ *
+ * A transaction is a list of operations on a single device, each operation
+ * is one chip select assertion (SPI) or one START to STOP sequence (I2C).
+ * Transactions are queued on a bus with eSpiQueueTransaction or eI2CQueueTransaction
+ * and run back to back from the bus interrupt, including transactions for other
+ * devices on the same bus, without waking any task in between.
+ *
+ * Operation semantics:
+ * 	SPI: TX and RX are clocked simultaneously for the longer of the two lengths,
+ * 		 RX byte 0 is the byte received while TX byte 0 is sent. A register read of
+ * 		 N bytes is therefore a 1 byte TX and a N + 1 byte RX.
+ * 	I2C: TX is written, then after a repeated START, RX is read. Either can be empty.
+ *
+ * The transaction and the operation buffers must remain valid until the callback runs.
+ * Callbacks run from the bus interrupt and may queue further transactions. On EFR32 the
+ * transaction runs synchronously in the submitting task, which also runs the callback.
+ *
+ * The blocking bus API and the queue are mutually exclusive. Claiming the bus waits
+ * for the transaction in progress, queued transactions resume when the bus is released.
+ */
+#ifndef __CSIRO_CORE_INTERFACE_BUS_TRANSACTION
+#define __CSIRO_CORE_INTERFACE_BUS_TRANSACTION
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/* Module Defines -------------------------------------------*/
+// clang-format off
+
+#define BUS_TRANSACTION_QUEUE_DEFAULT   \
+	{                                   \
+		.pxHead		  = NULL,           \
+		.pxTail		  = NULL,           \
+		.xIdleHandle  = NULL,           \
+		.xIdleStorage = { { 0 } },      \
+		.bActive	  = false,          \
+		.bWaiting	  = false,          \
+		.ucClaims	  = 0               \
+	}
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+typedef struct xBusTransaction_t xBusTransaction_t;
+
+/**@brief Called once all operations of a transaction have completed, or one has failed */
+typedef void ( *fnBusTransactionDone_t )( xBusTransaction_t *pxTransaction, eModuleError_t eResult );
+
+typedef struct xBusOperation_t
+{
+	void *   pvTx;	/**< Data to write, NULL if usTxLen is 0 */
+	void *   pvRx;	/**< Buffer to read into, NULL if usRxLen is 0 */
+	uint16_t usTxLen; /**< Bytes to write */
+	uint16_t usRxLen; /**< Bytes to read */
+} xBusOperation_t;
+
+struct xBusTransaction_t
+{
+	const void *		   pvConfig;		/**< xSpiConfig_t or xI2CConfig_t of the device */
+	xBusOperation_t *	  pxOperations;	/**< Operations, run in order */
+	uint8_t				   ucNumOperations; /**< Number of operations */
+	fnBusTransactionDone_t fnDone;			/**< Completion callback, can be NULL */
+	void *				   pvContext;		/**< User context */
+	/* Driver state while queued */
+	xBusTransaction_t *pxNext;		/**< Next transaction in the queue */
+	uint8_t			   ucOperation; /**< Operation in progress */
+};
+
+typedef struct xBusTransactionQueue_t
+{
+	xBusTransaction_t *pxHead;		 /**< Transaction in progress while bActive */
+	xBusTransaction_t *pxTail;		 /**< Last queued transaction */
+	SemaphoreHandle_t  xIdleHandle;  /**< Given when the queue stops for a claim */
+	StaticSemaphore_t  xIdleStorage; /**< Storage for xIdleHandle */
+	bool			   bActive;		 /**< Queue owns the peripheral */
+	bool			   bWaiting;	 /**< A claim is waiting for the queue to stop */
+	uint8_t			   ucClaims;	 /**< Nested claims of the blocking API */
+} xBusTransactionQueue_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Create the semaphore of a queue, called by the bus init function
+ *
+ * @param[in] pxQueue				Queue to initialise
+ */
+void vBusTransactionQueueInit( xBusTransactionQueue_t *pxQueue );
+
+/**@brief Append a transaction to the queue
+ *
+ * @param[in] pxQueue				Bus queue
+ * @param[in] pxTransaction			Transaction to append
+ *
+ * @retval							True if the queue was idle, the caller must start pxTransaction
+ */
+bool bBusTransactionQueuePush( xBusTransactionQueue_t *pxQueue, xBusTransaction_t *pxTransaction );
+
+/**@brief Remove the completed transaction at the head of the queue
+ *
+ * Called from the bus interrupt. The queue stops when it is empty or the bus has
+ * been claimed, in which case the caller must stop the peripheral.
+ *
+ * @param[in] pxQueue				Bus queue
+ *
+ * @retval							Transaction to start next, NULL if the queue stopped
+ */
+xBusTransaction_t *pxBusTransactionQueuePop( xBusTransactionQueue_t *pxQueue );
+
+/**@brief Report a transaction removed with pxBusTransactionQueuePop
+ *
+ * Called from the bus interrupt once the next transaction has been started, or the
+ * peripheral stopped. Runs the callback and wakes a claim waiting for the queue.
+ *
+ * @param[in] pxQueue				Bus queue
+ * @param[in] pxTransaction			Completed transaction
+ * @param[in] eResult				Result of the transaction
+ */
+void vBusTransactionQueueComplete( xBusTransactionQueue_t *pxQueue, xBusTransaction_t *pxTransaction, eModuleError_t eResult );
+
+/**@brief Stop the queue for the blocking API, called with the bus mutex held
+ *
+ * Blocks until the transaction in progress has completed.
+ *
+ * @param[in] pxQueue				Bus queue
+ */
+void vBusTransactionQueueClaim( xBusTransactionQueue_t *pxQueue );
+
+/**@brief Undo vBusTransactionQueueClaim, called before the bus mutex is returned
+ *
+ * @param[in] pxQueue				Bus queue
+ *
+ * @retval							Transaction the caller must start, NULL if there is none
+ */
+xBusTransaction_t *pxBusTransactionQueueRelease( xBusTransactionQueue_t *pxQueue );
+
+#endif /* __CSIRO_CORE_INTERFACE_BUS_TRANSACTION */
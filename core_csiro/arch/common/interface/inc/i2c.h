@@ -43,6 +43,7 @@
 #include "FreeRTOS.h"
 #include "semphr.h"
 
+#include "bus_transaction.h"
 #include "gpio.h"
 
 /* Forward Declarations -------------------------------------*/
@@ -64,7 +65,8 @@ typedef struct _xI2CPlatform_t xI2CPlatform_t;
 		.pxCurrentConfig  = NULL,                                            \
 		.xBusMutexHandle  = NULL,                                            \
 		.xBusMutexStorage = { { 0 } },                                       \
-		.bBusClaimed	  = false                                            \
+		.bBusClaimed	  = false,                                           \
+		.xQueue			  = BUS_TRANSACTION_QUEUE_DEFAULT                    \
 	}
 
 /* Type Definitions -----------------------------------------*/
@@ -84,6 +86,7 @@ struct _xI2CModule_t
 	SemaphoreHandle_t xBusMutexHandle;
 	StaticSemaphore_t xBusMutexStorage;
 	bool			  bBusClaimed;
+	xBusTransactionQueue_t xQueue;
 };
 
 /* Function Declarations ------------------------------------*/
@@ -135,4 +138,14 @@ eModuleError_t eI2CReceive( xI2CModule_t *pxModule, void *pvBuffer, uint16_t usL
  **/
 eModuleError_t eI2CTransfer( xI2CModule_t *pxModule, void *pvSendBuffer, uint16_t usSendLength, void *pvReceiveBuffer, uint16_t usReceiveLength, TickType_t xTimeout );
 
+/**
+ * Queue a transaction without claiming the bus.
+ * 
+ * Returns immediately, pxTransaction->fnDone is called once the transaction
+ * completes or an operation is not acknowledged. Transactions queued while the
+ * bus is claimed start once it is released. pvConfig of the transaction must
+ * point to a xI2CConfig_t, see bus_transaction.h for the operation semantics.
+ **/
+eModuleError_t eI2CQueueTransaction( xI2CModule_t *pxModule, xBusTransaction_t *pxTransaction );
+
 #endif /* __CSIRO_CORE_INTERFACE_I2C */
@@ -227,6 +227,8 @@ void vRtcDateTimeToEpoch( xDateTime_t *pxDatetime, eTimeEpoch_t eEpoch, uint32_t
 
 /**
  * Convert an Epoch time to a Calendar struct
+ * The day of the week is populated, the second fraction is zeroed
+ * Repeated conversions within the same day reuse the previous calendar date
  * \param eEpoch 		Start time to reference our seconds offset against
  * \param ulEpochTime 	Seconds offset to convert
  * \param pxDatetime 	Pointer to datetime struct to store result
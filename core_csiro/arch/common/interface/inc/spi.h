@@ -23,6 +23,7 @@
 #include "semphr.h"
 #include "task.h"
 
+#include "bus_transaction.h"
 #include "gpio.h"
 
 /* Forward Declarations -------------------------------------*/
@@ -48,7 +49,8 @@ typedef struct _xSpiPlatform_t xSpiPlatform_t;
 		.xPlatform				 = SPI_MODULE_PLATFORM_DEFAULT( NAME, HANDLE ), \
 		.pxCurrentConfig		 = NULL,                                        \
 		.bBusClaimed			 = false,                                       \
-		.bCsAsserted			 = false                                        \
+		.bCsAsserted			 = false,                                       \
+		.xQueue					 = BUS_TRANSACTION_QUEUE_DEFAULT                \
 	};                                                                          \
 	SPI_MODULE_PLATFORM_SUFFIX( NAME, IRQ );
 
@@ -80,6 +82,7 @@ struct _xSpiModule_t
 	const xSpiConfig_t *pxCurrentConfig;
 	bool				bBusClaimed;
 	bool				bCsAsserted;
+	xBusTransactionQueue_t xQueue;
 };
 
 /* Function Declarations ------------------------------------*/
@@ -161,4 +164,15 @@ void vSpiReceive( xSpiModule_t *pxSpi, void *pvBuffer, uint32_t ulBufferLen );
 
 void vSpiTransfer( xSpiModule_t *pxSpi, void *pvTxBuffer, void *pvRxBuffer, uint32_t ulBufferLen );
 
+/**
+ * Queue a transaction without claiming the bus
+ * Returns immediately, pxTransaction->fnDone is called once the transaction completes.
+ * Transactions queued while the bus is claimed start once it is released.
+ * See bus_transaction.h for the operation semantics.
+ * \param xSpi The SPI module
+ * \param pxTransaction Transaction, pvConfig must point to a xSpiConfig_t
+ * \return Error State
+ */
+eModuleError_t eSpiQueueTransaction( xSpiModule_t *pxSpi, xBusTransaction_t *pxTransaction );
+
 #endif /* __LIBS_CSIRO_INTERFACE_SPI */
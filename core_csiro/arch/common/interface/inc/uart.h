@@ -55,6 +55,7 @@ typedef struct _xUartPlatform_t xUartPlatform_t;
 		.xIncompleteTransmissions = NULL,                                                                \
 		.ulBaud					  = 0,                                                                   \
 		.ucNumTxBuffers			  = NUM_TX_BUFFERS,                                                      \
+		.xStatistics			  = { 0 },                                                               \
 		.bInitialised			  = false,                                                               \
 		.bHardwareFlowControl	 = false,                                                               \
 	};                                                                                                   \
@@ -65,6 +66,16 @@ typedef struct _xUartPlatform_t xUartPlatform_t;
 
 typedef void ( *fnSerialByteHandler_t )( char );
 
+/**@brief Transmit statistics, counted since eUartInit or the last reset */
+typedef struct xUartStatistics_t
+{
+	uint32_t ulBuffersSent;		 /**< Buffers transmitted */
+	uint32_t ulBytesSent;		 /**< Bytes transmitted */
+	uint32_t ulChainedStarts;	/**< Buffers started by the hardware directly after the previous buffer */
+	uint32_t ulBlockedClaims;	/**< Buffer claims that had to wait for a free buffer */
+	uint8_t  ucPeakBuffersUsed; /**< Maximum number of buffers claimed at once */
+} xUartStatistics_t;
+
 struct _xUartModule_t
 {
 	xMemoryPool_t * pxMemPool;
@@ -78,6 +89,8 @@ struct _xUartModule_t
 	/* Interface Parameters */
 	uint32_t ulBaud;
 	uint8_t  ucNumTxBuffers;
+	/* Transmit Statistics */
+	xUartStatistics_t xStatistics;
 	bool	 bInitialised;
 	bool	 bHardwareFlowControl;
 };
@@ -109,6 +122,14 @@ void vUartOn( xUartModule_t *pxUart );
  */
 void vUartOff( xUartModule_t *pxUart );
 
+/**
+ * Get the transmit statistics of the UART
+ * \param xUart The UART module
+ * \param pxStatistics Statistics output
+ * \param bReset Restart the statistics after reading
+ */
+void vUartStatistics( xUartModule_t *pxUart, xUartStatistics_t *pxStatistics, bool bReset );
+
 /** 
  * Serial task for the board file
  * \param vParameters is a pointer to the initilised xUartModule_t struct
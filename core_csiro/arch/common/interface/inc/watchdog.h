@@ -46,7 +46,9 @@ typedef enum eWatchdogRebootReason_t {
 	REBOOT_UNKNOWN = 0,
 	REBOOT_WATCHDOG,
 	REBOOT_ASSERTION,
-	REBOOT_RPC
+	REBOOT_RPC,
+	REBOOT_STACK_OVERFLOW,
+	REBOOT_FAULT
 } eWatchdogRebootReason_t;
 
 typedef struct xWatchdogModule_t
@@ -66,6 +68,7 @@ typedef struct WatchdogReboot_t
 	uint32_t				ulProgramCounter;
 	uint32_t				ulLinkRegister;
 	char					cTaskName[configMAX_TASK_NAME_LEN + 1];
+	xStackMonitorReport_t	xStack; /**< Task with the least free stack when the reboot was requested, see stack_monitor.h */
 } WatchdogReboot_t;
 
 /* Function Declarations ------------------------------------*/
@@ -75,8 +78,9 @@ void			  vWatchdogPeriodic( xWatchdogModule_t *pxWdog );
 void			  vWatchdogSetRebootReason( eWatchdogRebootReason_t eReason, const char *pcTask, uint32_t ulProgramCounter, uint32_t ulLinkRegister );
 void			  vWatchdogPopulateTdf( WatchdogReboot_t *pxReboot, tdf_watchdog_info_t *pxWatchdogTdf );
 void			  vWatchdogPopulateTdfSmall( WatchdogReboot_t *pxReboot, tdf_watchdog_info_small_t *pxWatchdogTdf );
+bool			  bWatchdogPopulateStackTdf( WatchdogReboot_t *pxReboot, tdf_task_stack_t *pxStackTdf );
 void			  vWatchdogPrintRebootReason( SerialLog_t eLogger, LogLevel_t eLevel, WatchdogReboot_t *pxReboot );
-void			  vWatchdogRunInterrupt( uint32_t *pulStack );
+void			  vWatchdogRunInterrupt( uint32_t *pulStack, uint32_t ulExcReturn );
 WatchdogReboot_t *xWatchdogRebootReason( void );
 
 #endif /* __CORE_CSIRO_UTIL_WATCHDOG_COMMON */
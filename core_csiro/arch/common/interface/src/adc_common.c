@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ */
+/* Includes -------------------------------------------------*/
+
+#include "adc.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/* Function Declarations ------------------------------------*/
+
+/* Private Variables ----------------------------------------*/
+
+/*-----------------------------------------------------------*/
+
+uint16_t usAdcDecimate( int16_t *psSamples, uint16_t usNumScans, uint8_t ucNumChannels, uint8_t ucFactor )
+{
+	const int16_t *psInput = psSamples;
+	int16_t *	  psOutput = psSamples;
+	uint16_t	   usOutputScans;
+	uint16_t	   usScan;
+	uint8_t		   ucChannel;
+	uint8_t		   ucSample;
+	int32_t		   lSum;
+
+	configASSERT( ucFactor > 0 );
+	configASSERT( ( usNumScans % ucFactor ) == 0 );
+
+	usOutputScans = usNumScans / ucFactor;
+	/* Output scan N is written over input scan N, which has already been consumed */
+	for ( usScan = 0; usScan < usOutputScans; usScan++ ) {
+		for ( ucChannel = 0; ucChannel < ucNumChannels; ucChannel++ ) {
+			lSum = 0;
+			for ( ucSample = 0; ucSample < ucFactor; ucSample++ ) {
+				lSum += psInput[ucSample * ucNumChannels + ucChannel];
+			}
+			psOutput[ucChannel] = (int16_t) ( lSum / ucFactor );
+		}
+		psInput += ucFactor * ucNumChannels;
+		psOutput += ucNumChannels;
+	}
+	return usOutputScans;
+}
+
+/*-----------------------------------------------------------*/
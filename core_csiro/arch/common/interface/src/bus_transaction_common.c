@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ */
+/* Includes -------------------------------------------------*/
+
+#include "bus_transaction.h"
+
+#include "cpu.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/* Function Declarations ------------------------------------*/
+
+/* Private Variables ----------------------------------------*/
+
+/*-----------------------------------------------------------*/
+
+void vBusTransactionQueueInit( xBusTransactionQueue_t *pxQueue )
+{
+	pxQueue->xIdleHandle = xSemaphoreCreateBinaryStatic( &pxQueue->xIdleStorage );
+}
+
+/*-----------------------------------------------------------*/
+
+bool bBusTransactionQueuePush( xBusTransactionQueue_t *pxQueue, xBusTransaction_t *pxTransaction )
+{
+	CRITICAL_SECTION_DECLARE;
+	bool bStart;
+
+	configASSERT( pxTransaction->ucNumOperations > 0 );
+
+	pxTransaction->pxNext	  = NULL;
+	pxTransaction->ucOperation = 0;
+
+	CRITICAL_SECTION_START();
+	if ( pxQueue->pxTail == NULL ) {
+		pxQueue->pxHead = pxTransaction;
+	}
+	else {
+		pxQueue->pxTail->pxNext = pxTransaction;
+	}
+	pxQueue->pxTail = pxTransaction;
+	/* An idle, unclaimed queue is always empty, so the new transaction is the head */
+	bStart = !pxQueue->bActive && ( pxQueue->ucClaims == 0 );
+	if ( bStart ) {
+		configASSERT( pxQueue->pxHead == pxTransaction );
+		pxQueue->bActive = true;
+	}
+	CRITICAL_SECTION_STOP();
+	return bStart;
+}
+
+/*-----------------------------------------------------------*/
+
+xBusTransaction_t *pxBusTransactionQueuePop( xBusTransactionQueue_t *pxQueue )
+{
+	CRITICAL_SECTION_DECLARE;
+	xBusTransaction_t *pxNext;
+
+	CRITICAL_SECTION_START();
+	configASSERT( pxQueue->bActive );
+	pxQueue->pxHead = pxQueue->pxHead->pxNext;
+	if ( pxQueue->pxHead == NULL ) {
+		pxQueue->pxTail = NULL;
+	}
+	/* Remaining transactions wait for the claim to be released */
+	pxNext			 = ( pxQueue->ucClaims == 0 ) ? pxQueue->pxHead : NULL;
+	pxQueue->bActive = ( pxNext != NULL );
+	CRITICAL_SECTION_STOP();
+	return pxNext;
+}
+
+/*-----------------------------------------------------------*/
+
+void vBusTransactionQueueComplete( xBusTransactionQueue_t *pxQueue, xBusTransaction_t *pxTransaction, eModuleError_t eResult )
+{
+	CRITICAL_SECTION_DECLARE;
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	bool	   bWake;
+
+	/* Evaluated before the callback, which can restart the queue */
+	CRITICAL_SECTION_START();
+	bWake			  = !pxQueue->bActive && pxQueue->bWaiting;
+	pxQueue->bWaiting = pxQueue->bWaiting && !bWake;
+	CRITICAL_SECTION_STOP();
+
+	if ( pxTransaction->fnDone != NULL ) {
+		pxTransaction->fnDone( pxTransaction, eResult );
+	}
+	if ( bWake ) {
+		xSemaphoreGiveFromISR( pxQueue->xIdleHandle, &xHigherPriorityTaskWoken );
+		portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+void vBusTransactionQueueClaim( xBusTransactionQueue_t *pxQueue )
+{
+	CRITICAL_SECTION_DECLARE;
+	bool bWait;
+
+	CRITICAL_SECTION_START();
+	pxQueue->ucClaims++;
+	bWait			  = pxQueue->bActive;
+	pxQueue->bWaiting |= bWait;
+	CRITICAL_SECTION_STOP();
+
+	if ( bWait ) {
+		xSemaphoreTake( pxQueue->xIdleHandle, portMAX_DELAY );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+xBusTransaction_t *pxBusTransactionQueueRelease( xBusTransactionQueue_t *pxQueue )
+{
+	CRITICAL_SECTION_DECLARE;
+	xBusTransaction_t *pxStart = NULL;
+
+	CRITICAL_SECTION_START();
+	configASSERT( pxQueue->ucClaims > 0 );
+	pxQueue->ucClaims--;
+	if ( ( pxQueue->ucClaims == 0 ) && ( pxQueue->pxHead != NULL ) ) {
+		configASSERT( !pxQueue->bActive );
+		pxQueue->bActive = true;
+		pxStart			 = pxQueue->pxHead;
+	}
+	CRITICAL_SECTION_STOP();
+	return pxStart;
+}
+
+/*-----------------------------------------------------------*/
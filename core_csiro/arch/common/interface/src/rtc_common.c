@@ -5,19 +5,47 @@
  */
 /* Includes -------------------------------------------------*/
 
+#include "cpu.h"
 #include "memory_operations.h"
 #include "rtc.h"
 
 /* Private Defines ------------------------------------------*/
 // clang-format off
+
+#define DAYS_FROM_UNIX_EPOCH_TO_2000		10957lu
+#define DAYS_FROM_UNIX_EPOCH_TO_2015		16436lu
+
+/* Constants of the proleptic Gregorian calendar, with years starting on the 1st of March */
+#define DAYS_FROM_0000_03_01_TO_UNIX_EPOCH	719468lu
+#define DAYS_IN_400_YEARS					146097lu
+
+/* 01/01/1970 was a Thursday */
+#define UNIX_EPOCH_DAY_OF_WEEK				eThursday
+
+/* No date has this month, so an empty cache never matches, even for an all zero date */
+#define RTC_DAY_CACHE_INVALID_MONTH			( (eMonth_t) UINT8_MAX )
+
 // clang-format on
 
 /* Type Definitions -----------------------------------------*/
 
+typedef struct xRtcDayCache_t
+{
+	uint32_t ulDaysSinceUnixEpoch; /**< Day that xDate refers to */
+	xDate_t  xDate;				   /**< Calendar date of ulDaysSinceUnixEpoch */
+} xRtcDayCache_t;
+
 /* Function Declarations ------------------------------------*/
 
+static uint32_t prvEpochDayOffset( eTimeEpoch_t eEpoch );
+static uint32_t prvDaysFromCivil( xDate_t *pxDate );
+static void		prvCivilFromDays( uint32_t ulDaysSinceUnixEpoch, xDate_t *pxDate );
+
 /* Private Variables ----------------------------------------*/
 
+/* Most timestamps converted fall on the current day, so remember the most recent conversion */
+static xRtcDayCache_t xDayCache = { .ulDaysSinceUnixEpoch = UINT32_MAX, .xDate = { .eMonth = RTC_DAY_CACHE_INVALID_MONTH } };
+
 static const char *pucDaysOfWeek[] = {
 	[eSunday]	= "Sun",
 	[eMonday]	= "Mon",
@@ -128,105 +156,56 @@ xTdfTime_t xRtcTdfTimeSub( xTdfTime_t xBase, xTdfTime_t xSubtraction )
 
 void vRtcDateTimeToEpoch( xDateTime_t *pxDatetime, eTimeEpoch_t eEpoch, uint32_t *pulEpochTime )
 {
-	uint16_t usDays;
-	/**
-	 * Using the calculation from here:
-	 * http://pubs.opengroup.org/onlinepubs/009695399/basedefs/xbd_chap04.html#tag_04_14
-	 * to find the number of seconds since epoch.
-	 **/
-
-	eElapsedDaysInYear( &( pxDatetime->xDate ), &usDays );
-
-	*pulEpochTime = pxDatetime->xTime.ucSecond;
-	*pulEpochTime += pxDatetime->xTime.ucMinute * 60;
-	*pulEpochTime += pxDatetime->xTime.ucHour * 3600;
-	*pulEpochTime += usDays * 86400;
-	*pulEpochTime += ( pxDatetime->xDate.usYear - 1900 - 70 ) * 31536000;
-	*pulEpochTime += ( ( pxDatetime->xDate.usYear - 1900 - 69 ) / 4 ) * 86400;
-	*pulEpochTime -= ( ( pxDatetime->xDate.usYear - 1900 - 1 ) / 100 ) * 86400;
-	*pulEpochTime += ( ( pxDatetime->xDate.usYear - 1900 + 299 ) / 400 ) * 86400;
-
-	switch ( eEpoch ) {
-		case eUnixEpoch:
-			break;
-		case e2000Epoch:
-			*pulEpochTime -= SECONDS_FROM_UNIX_EPOCH_TO_2000;
-			break;
-		case e2015Epoch:
-			*pulEpochTime -= SECONDS_FROM_UNIX_EPOCH_TO_2015;
-			break;
-		default:
-			configASSERT( 0 );
+	CRITICAL_SECTION_DECLARE;
+	uint32_t ulDays;
+	bool	 bCached;
+
+	CRITICAL_SECTION_START();
+	bCached = ( xDayCache.xDate.ucDay == pxDatetime->xDate.ucDay ) &&
+			  ( xDayCache.xDate.eMonth == pxDatetime->xDate.eMonth ) &&
+			  ( xDayCache.xDate.usYear == pxDatetime->xDate.usYear );
+	ulDays = xDayCache.ulDaysSinceUnixEpoch;
+	CRITICAL_SECTION_STOP();
+
+	if ( !bCached ) {
+		ulDays = prvDaysFromCivil( &pxDatetime->xDate );
 	}
+	/* Offset the day count before scaling, so that epochs after 1970 can represent dates beyond 2106 */
+	*pulEpochTime = DAYS_TO_SECONDS( ulDays - prvEpochDayOffset( eEpoch ) );
+	*pulEpochTime += HOURS_TO_SECONDS( pxDatetime->xTime.ucHour );
+	*pulEpochTime += MINUTES_TO_SECONDS( pxDatetime->xTime.ucMinute );
+	*pulEpochTime += pxDatetime->xTime.ucSecond;
 }
 
 /*-----------------------------------------------------------*/
 
 void vRtcEpochToDateTime( eTimeEpoch_t eEpoch, uint32_t ulEpochTime, xDateTime_t *pxDatetime )
 {
-	uint8_t  ucEpochYearsToLeapYear = 0;
-	bool	 bIsLeapYear			= false;
-	uint32_t ulBlocks;
-	pvMemset( pxDatetime, 0, sizeof( xDateTime_t ) );
+	CRITICAL_SECTION_DECLARE;
+	uint32_t ulDays	= ( ulEpochTime / SECONDS_IN_1_DAY ) + prvEpochDayOffset( eEpoch );
+	uint32_t ulSeconds = ulEpochTime % SECONDS_IN_1_DAY;
+	bool	 bCached;
 
-	/* Calculate how many years into the Epoch the leap year occurs */
-	/* Also apply the year offset while we're at it */
-	switch ( eEpoch ) {
-		case eUnixEpoch:
-			pxDatetime->xDate.usYear = 1970;
-			ucEpochYearsToLeapYear   = 2;
-			break;
-		case e2000Epoch:
-			pxDatetime->xDate.usYear = 2000;
-			ucEpochYearsToLeapYear   = 0;
-			break;
-		case e2015Epoch:
-			pxDatetime->xDate.usYear = 2015;
-			ucEpochYearsToLeapYear   = 1;
-			break;
-		default:
-			configASSERT( 0 );
-	}
+	pvMemset( pxDatetime, 0, sizeof( xDateTime_t ) );
 
-	/* 4 Year Blocks*/
-	ulBlocks = ( ulEpochTime / SECONDS_IN_4_YEARS );
-	ulEpochTime -= ulBlocks * SECONDS_IN_4_YEARS;
-	pxDatetime->xDate.usYear += 4 * ulBlocks;
-	/* 1 Year Blocks */
-	ulBlocks = ( ulEpochTime / SECONDS_IN_1_YEAR );
-	ulEpochTime -= ulBlocks * SECONDS_IN_1_YEAR;
-	pxDatetime->xDate.usYear += ulBlocks;
-	/* Take a day off our seconds count if we hit the Epoch cycles leap year and its not this year */
-	if ( ulBlocks > ucEpochYearsToLeapYear ) {
-		ulEpochTime -= SECONDS_IN_1_DAY;
-	}
-	/* Store if this year is a leap year */
-	else if ( ulBlocks == ucEpochYearsToLeapYear ) {
-		bIsLeapYear = true;
+	CRITICAL_SECTION_START();
+	bCached = ( xDayCache.ulDaysSinceUnixEpoch == ulDays );
+	if ( bCached ) {
+		pxDatetime->xDate = xDayCache.xDate;
 	}
-	eMonth_t eMonth					 = 0;
-	uint8_t  ucLocalMonthLengths[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-	ucLocalMonthLengths[1] += bIsLeapYear ? 1 : 0;
-	/* Loop over months because its easier */
-	while ( ulEpochTime >= SECONDS_IN_1_DAY * ucLocalMonthLengths[eMonth] ) {
-		ulEpochTime -= SECONDS_IN_1_DAY * ucLocalMonthLengths[eMonth];
-		eMonth++;
+	CRITICAL_SECTION_STOP();
+
+	if ( !bCached ) {
+		prvCivilFromDays( ulDays, &pxDatetime->xDate );
+		CRITICAL_SECTION_START();
+		xDayCache.ulDaysSinceUnixEpoch = ulDays;
+		xDayCache.xDate				   = pxDatetime->xDate;
+		CRITICAL_SECTION_STOP();
 	}
-	pxDatetime->xDate.eMonth = eMonth + 1;
-	/* Days in the month */
-	ulBlocks = ( ulEpochTime / SECONDS_IN_1_DAY );
-	ulEpochTime -= ulBlocks * SECONDS_IN_1_DAY;
-	pxDatetime->xDate.ucDay = ulBlocks + 1;
-	/* Hour of the day */
-	ulBlocks = ( ulEpochTime / SECONDS_IN_1_HR );
-	ulEpochTime -= ulBlocks * SECONDS_IN_1_HR;
-	pxDatetime->xTime.ucHour = ulBlocks;
-	/* Minute of the hour */
-	ulBlocks = ( ulEpochTime / SECONDS_IN_1_MIN );
-	ulEpochTime -= ulBlocks * SECONDS_IN_1_MIN;
-	pxDatetime->xTime.ucMinute = ulBlocks;
-	/* Second of the minute */
-	pxDatetime->xTime.ucSecond = ulEpochTime;
+	pxDatetime->xTime.ucHour = ulSeconds / SECONDS_IN_1_HR;
+	ulSeconds %= SECONDS_IN_1_HR;
+	pxDatetime->xTime.ucMinute = ulSeconds / SECONDS_IN_1_MIN;
+	pxDatetime->xTime.ucSecond = ulSeconds % SECONDS_IN_1_MIN;
 }
 
 /*-----------------------------------------------------------*/
@@ -380,3 +359,58 @@ eModuleError_t eRtcPrintDatetime( xDateTime_t *xDatetime, SerialLog_t eLogger, L
 }
 
 /*-----------------------------------------------------------*/
+
+static uint32_t prvEpochDayOffset( eTimeEpoch_t eEpoch )
+{
+	switch ( eEpoch ) {
+		case eUnixEpoch:
+			return 0;
+		case e2000Epoch:
+			return DAYS_FROM_UNIX_EPOCH_TO_2000;
+		case e2015Epoch:
+			return DAYS_FROM_UNIX_EPOCH_TO_2015;
+		default:
+			configASSERT( 0 );
+			return 0;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * Closed form conversions between the calendar and a day count, from
+ * http://howardhinnant.github.io/date_algorithms.html
+ * 
+ * Years are shifted to start on the 1st of March so that the leap day is the final day of the year.
+ * Only valid for dates on or after 01/03/0000, which is all that unsigned arithmetic is required for.
+ **/
+static uint32_t prvDaysFromCivil( xDate_t *pxDate )
+{
+	const uint32_t ulYear		  = pxDate->usYear - ( pxDate->eMonth <= eFebruary ? 1 : 0 );
+	const uint32_t ulMonth		  = pxDate->eMonth;
+	const uint32_t ulEra		  = ulYear / 400;
+	const uint32_t ulYearOfEra	= ulYear - ( ulEra * 400 );
+	const uint32_t ulDayOfYear	= ( ( 153 * ( ulMonth > eFebruary ? ulMonth - 3 : ulMonth + 9 ) ) + 2 ) / 5 + pxDate->ucDay - 1;
+	const uint32_t ulDayOfEra	 = ( ulYearOfEra * 365 ) + ( ulYearOfEra / 4 ) - ( ulYearOfEra / 100 ) + ulDayOfYear;
+	return ( ulEra * DAYS_IN_400_YEARS ) + ulDayOfEra - DAYS_FROM_0000_03_01_TO_UNIX_EPOCH;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCivilFromDays( uint32_t ulDaysSinceUnixEpoch, xDate_t *pxDate )
+{
+	const uint32_t ulDays		 = ulDaysSinceUnixEpoch + DAYS_FROM_0000_03_01_TO_UNIX_EPOCH;
+	const uint32_t ulEra		 = ulDays / DAYS_IN_400_YEARS;
+	const uint32_t ulDayOfEra	= ulDays - ( ulEra * DAYS_IN_400_YEARS );
+	const uint32_t ulYearOfEra   = ( ulDayOfEra - ( ulDayOfEra / 1460 ) + ( ulDayOfEra / 36524 ) - ( ulDayOfEra / ( DAYS_IN_400_YEARS - 1 ) ) ) / 365;
+	const uint32_t ulDayOfYear   = ulDayOfEra - ( ( 365 * ulYearOfEra ) + ( ulYearOfEra / 4 ) - ( ulYearOfEra / 100 ) );
+	const uint32_t ulShiftedMonth = ( ( 5 * ulDayOfYear ) + 2 ) / 153;
+	const uint32_t ulMonth		 = ( ulShiftedMonth < 10 ) ? ( ulShiftedMonth + 3 ) : ( ulShiftedMonth - 9 );
+
+	pxDate->usYear	 = ( ulEra * 400 ) + ulYearOfEra + ( ulMonth <= eFebruary ? 1 : 0 );
+	pxDate->eMonth	 = ulMonth;
+	pxDate->ucDay	  = ulDayOfYear - ( ( 153 * ulShiftedMonth ) + 2 ) / 5 + 1;
+	pxDate->eDayOfWeek = ( ulDaysSinceUnixEpoch + UNIX_EPOCH_DAY_OF_WEEK ) % 7;
+}
+
+/*-----------------------------------------------------------*/
@@ -63,8 +63,20 @@ eModuleError_t eUartWrite( void *pvContext, const char *pcFormat, va_list pvArgs
 char *pcUartClaimBuffer( void *pvContext, uint32_t *pulBufferLen )
 {
 	xUartModule_t *pxUart = (xUartModule_t *) pvContext;
+	int8_t *	   pcBuffer;
+	uint8_t		   ucUsed;
 	*pulBufferLen		  = pxUart->pxMemPool->ulBufferSize;
-	return (char *) pcMemoryPoolClaim( pxUart->pxMemPool, portMAX_DELAY );
+	/* A claim that has to wait means the UART is not keeping up with the producers */
+	pcBuffer = pcMemoryPoolClaim( pxUart->pxMemPool, 0 );
+	if ( pcBuffer == NULL ) {
+		pxUart->xStatistics.ulBlockedClaims++;
+		pcBuffer = pcMemoryPoolClaim( pxUart->pxMemPool, portMAX_DELAY );
+	}
+	ucUsed = ucMemoryPoolUsedBuffers( pxUart->pxMemPool );
+	if ( ucUsed > pxUart->xStatistics.ucPeakBuffersUsed ) {
+		pxUart->xStatistics.ucPeakBuffersUsed = ucUsed;
+	}
+	return (char *) pcBuffer;
 }
 
 /*-----------------------------------------------------------*/
@@ -77,6 +89,20 @@ void vUartReleaseBuffer( void *pvContext, char *pucBuffer )
 
 /*-----------------------------------------------------------*/
 
+void vUartStatistics( xUartModule_t *pxUart, xUartStatistics_t *pxStatistics, bool bReset )
+{
+	CRITICAL_SECTION_DECLARE;
+	/* Counters are updated from the transmit interrupt */
+	CRITICAL_SECTION_START();
+	*pxStatistics = pxUart->xStatistics;
+	if ( bReset ) {
+		pvMemset( &pxUart->xStatistics, 0x00, sizeof( xUartStatistics_t ) );
+	}
+	CRITICAL_SECTION_STOP();
+}
+
+/*-----------------------------------------------------------*/
+
 ATTR_NORETURN void vSerialReceiveTask( void *pvParameters )
 {
 	char				  pcBuffer[32];
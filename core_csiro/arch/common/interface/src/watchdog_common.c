@@ -7,6 +7,7 @@
 
 #include "watchdog.h"
 
+#include "crash_dump.h"
 #include "memory_operations.h"
 #include "tdf.h"
 
@@ -23,7 +24,7 @@
 
 /*-----------------------------------------------------------*/
 
-void vWatchdogRunInterrupt( uint32_t *pulStack )
+void vWatchdogRunInterrupt( uint32_t *pulStack, uint32_t ulExcReturn )
 {
 	/** 
 	 * Get the program counter and link register at the point the interrupt was called
@@ -34,6 +35,7 @@ void vWatchdogRunInterrupt( uint32_t *pulStack )
 	 **/
 	uint32_t ulLR = pulStack[5];
 	uint32_t ulPC = pulStack[6];
+	vCrashDumpException( CRASH_DUMP_WATCHDOG, pulStack, ulExcReturn, NULL );
 	vWatchdogSetRebootReason( REBOOT_WATCHDOG, pcTaskGetName( NULL ), ulPC, ulLR );
 
 #ifndef RELEASE_BUILD
@@ -60,11 +62,20 @@ void vWatchdogPrintRebootReason( SerialLog_t eLogger, LogLevel_t eLevel, Watchdo
 		case REBOOT_RPC:
 			pcFormat = "Rebooted From RPC: %s\r\n";
 			break;
+		case REBOOT_STACK_OVERFLOW:
+			pcFormat = "Stack Overflow: %s\r\n";
+			break;
+		case REBOOT_FAULT:
+			pcFormat = "Fault: %s PC: 0x%X LR: 0x%X\r\n";
+			break;
 		default:
 			pcFormat = "Unknown Reboot\r\n";
 			break;
 	}
 	eLog( eLogger, eLevel, pcFormat, pxReboot->cTaskName, pxReboot->ulProgramCounter, pxReboot->ulLinkRegister );
+	if ( pxReboot->xStack.usSize != 0 ) {
+		eLog( eLogger, eLevel, "Least Free Stack: %s %d/%d bytes\r\n", pxReboot->xStack.pcName, pxReboot->xStack.usFree, pxReboot->xStack.usSize );
+	}
 }
 
 /*-----------------------------------------------------------*/
@@ -96,3 +107,22 @@ void vWatchdogPopulateTdfSmall( WatchdogReboot_t *pxReboot, tdf_watchdog_info_sm
 }
 
 /*-----------------------------------------------------------*/
+
+bool bWatchdogPopulateStackTdf( WatchdogReboot_t *pxReboot, tdf_task_stack_t *pxStackTdf )
+{
+	uint8_t i = 0;
+	/* Nothing to report if the stack monitor is disabled */
+	if ( pxReboot->xStack.pcName[0] == '\0' ) {
+		return false;
+	}
+	pvMemset( pxStackTdf->procName, ' ', sizeof( pxStackTdf->procName ) );
+	while ( ( pxReboot->xStack.pcName[i] != '\0' ) && ( i < sizeof( pxStackTdf->procName ) ) ) {
+		pxStackTdf->procName[i] = pxReboot->xStack.pcName[i];
+		i++;
+	}
+	pxStackTdf->stack_size = pxReboot->xStack.usSize;
+	pxStackTdf->stack_free = pxReboot->xStack.usFree;
+	return true;
+}
+
+/*-----------------------------------------------------------*/
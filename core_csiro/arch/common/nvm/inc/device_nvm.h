@@ -67,7 +67,8 @@ typedef enum {
 	NVM_SCHEDULE_12,
 	NVM_SCHEDULE_13,
 	NVM_SCHEDULE_14,
-	NVM_SCHEDULE_MAX = NVM_SCHEDULE_14 // Ensure this is equal to the largest NVM_SCHEDULE
+	NVM_SCHEDULE_MAX = NVM_SCHEDULE_14, // Ensure this is equal to the largest NVM_SCHEDULE
+	NVM_FLASH_DELTA_PROGRESS
 } eNvmKey_t;
 
 extern const uint32_t ulKeyLengthWords[];
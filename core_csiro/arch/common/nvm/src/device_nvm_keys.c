@@ -8,6 +8,7 @@
 #include "device_nvm.h"
 
 #include "compiler_intrinsics.h"
+#include "flash_interface.h"
 
 #if __has_include( "scheduler.h" )
 /* CSIRO Scheduler */
@@ -64,7 +65,8 @@ const uint32_t ulKeyLengthWords[] = {
 	[NVM_SCHEDULE_12]			 = SIZEOF_WORDS( xSchedule_t ),
 	[NVM_SCHEDULE_13]			 = SIZEOF_WORDS( xSchedule_t ),
 	[NVM_SCHEDULE_14]			 = SIZEOF_WORDS( xSchedule_t ),
-	[NVM_SCHEDULE_CRC]			 = 1
+	[NVM_SCHEDULE_CRC]			 = 1,
+	[NVM_FLASH_DELTA_PROGRESS]	 = SIZEOF_WORDS( xFlashDeltaProgress_t )
 };
 
 /*-----------------------------------------------------------*/
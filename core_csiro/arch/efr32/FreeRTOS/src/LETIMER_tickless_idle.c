@@ -38,6 +38,7 @@
 
 #include "board.h"
 #include "cpu.h"
+#include "energy.h"
 #include "leds.h"
 
 /* The LETIMER channel used to generate the tick interrupt. */
@@ -131,6 +132,7 @@ bool vSleep( void )
 	/* Critical section to allow sleep blocks in ISRs. */
 	CORE_ENTER_CRITICAL();
 	bEnterDeepSleep = bBoardCanDeepSleep();
+	vEnergyActive( ENERGY_CPU, false );
 	if ( bEnterDeepSleep ) {
 		vBoardDeepSleep();
 		EMU_EnterEM2( true );
@@ -138,6 +140,7 @@ bool vSleep( void )
 	else {
 		EMU_EnterEM1();
 	}
+	vEnergyActive( ENERGY_CPU, true );
 	CORE_EXIT_CRITICAL();
 
 	return bEnterDeepSleep;
@@ -29,6 +29,7 @@
 
 #include "rtos_gecko.h"
 
+#include "energy.h"
 #include "log.h"
 #include "memory_operations.h"
 #include "rtc.h"
@@ -164,6 +165,7 @@ eModuleError_t eBluetoothGapScanStart( eBluetoothPhy_t ePHY )
 		eLog( LOG_BLUETOOTH_GAP, LOG_ERROR, "BT: Failed to start scan 0x%X\r\n", pxStartResponse->result );
 		return ERROR_INVALID_STATE;
 	}
+	vEnergyActive( ENERGY_RADIO_SCAN, true );
 	xDateTime_t xDatetime;
 	bRtcGetDatetime( &xDatetime );
 	eLog( LOG_BLUETOOTH_GAP, LOG_DEBUG, "BT %2d.%05d: Scanning started\r\n", xDatetime.xTime.ucSecond, xDatetime.xTime.usSecondFraction );
@@ -185,6 +187,9 @@ eModuleError_t eBluetoothGapScanStop( void )
 {
 	struct gecko_msg_le_gap_end_procedure_rsp_t *xEndResp;
 	xEndResp = gecko_cmd_le_gap_end_procedure();
+	if ( xEndResp->result == 0 ) {
+		vEnergyActive( ENERGY_RADIO_SCAN, false );
+	}
 	xDateTime_t xDatetime;
 	bRtcGetDatetime( &xDatetime );
 	eLog( LOG_BLUETOOTH_GAP, LOG_DEBUG, "BT %2d.%05d: Scan stopped\r\n", xDatetime.xTime.ucSecond, xDatetime.xTime.usSecondFraction );
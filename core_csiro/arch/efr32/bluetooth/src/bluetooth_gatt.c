@@ -14,6 +14,7 @@
 #include "bluetooth_gatt.h"
 #include "bluetooth_utility.h"
 
+#include "energy.h"
 #include "memory_operations.h"
 #include "rtc.h"
 
@@ -106,6 +107,7 @@ void vBluetoothGattEventHandler( struct gecko_cmd_packet *pxEvent )
 				  pxConnOpened->address.addr );
 			xEventGroupClearBits( pxBluetoothState, BLUETOOTH_CONNECTING );
 			xEventGroupSetBits( pxBluetoothState, BLUETOOTH_CONNECTED );
+			vEnergyActive( ENERGY_RADIO_CONNECTED, true );
 
 			/* Initialise connection context appropriately */
 			if ( pxConnOpened->master ) {
@@ -158,6 +160,7 @@ void vBluetoothGattEventHandler( struct gecko_cmd_packet *pxEvent )
 				  xDateTime.xTime.ucSecond, xDateTime.xTime.usSecondFraction,
 				  pxConnClosed->reason );
 			xEventGroupClearBits( pxBluetoothState, BLUETOOTH_CONNECTING | BLUETOOTH_CONNECTED );
+			vEnergyActive( ENERGY_RADIO_CONNECTED, false );
 			xEventGroupClearBits( pxEventConnection->xConnectionState, BT_CONNECTION_PENDING | BT_CONNECTION_CONNECTED );
 			xEventGroupSetBits( pxEventConnection->xConnectionState, BT_CONNECTION_IDLE );
 			/* Unblock any blocking operation */
@@ -11,6 +11,7 @@
 
 #include "adc.h"
 #include "adc_arch.h"
+#include "energy.h"
 #include "gpio.h"
 #include "log.h"
 
@@ -76,6 +77,7 @@ uint32_t ulAdcSample( xAdcModule_t *pxAdcModule, xGpio_t xGpio, eAdcResolution_t
 	xSemaphoreTake( pxAdcAccess, portMAX_DELAY );
 
 	CMU_ClockEnable( cmuClock_ADC0, true ); // Turn clock on.
+	vEnergyActive( ENERGY_ADC, true );
 
 	xAdcInitSingleStruct.posSel		= eGpioToAportChannelMapping( xGpio );
 	xAdcInitSingleStruct.reference  = eAdcReferenceVoltageGet( eReferenceVoltage );
@@ -92,6 +94,7 @@ uint32_t ulAdcSample( xAdcModule_t *pxAdcModule, xGpio_t xGpio, eAdcResolution_t
 	ulSample = ADC_DataSingleGet( pxAdcModule->xPlatform.pxADC ); // Get ADC result.
 
 	CMU_ClockEnable( cmuClock_ADC0, false ); // Turn clock off.
+	vEnergyActive( ENERGY_ADC, false );
 
 	xSemaphoreGive( pxAdcAccess );
 
@@ -113,6 +116,27 @@ eModuleError_t eAdcRecalibrate( xAdcModule_t *pxAdc )
 
 /*-----------------------------------------------------------*/
 
+/**
+ * Continuous sampling would need the ADC scan mode triggered over PRS and an
+ * LDMA descriptor loop. As with calibration, it is not implemented for this chip.
+ **/
+eModuleError_t eAdcContinuousStart( xAdcModule_t *pxAdc, const xAdcContinuousConfig_t *pxConfig )
+{
+	UNUSED( pxAdc );
+	UNUSED( pxConfig );
+	return ERROR_UNAVAILABLE_RESOURCE;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eAdcContinuousStop( xAdcModule_t *pxAdc )
+{
+	UNUSED( pxAdc );
+	return ERROR_INVALID_STATE;
+}
+
+/*-----------------------------------------------------------*/
+
 /* A handy dandy function for converting simple pin/port macros to the
  * infrequenctly used APORT/Channel macros used for analog functionality on
  * the EFR32. Stops the programmer from having to look at their chips datasheet
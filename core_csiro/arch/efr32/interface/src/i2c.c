@@ -22,6 +22,8 @@
 /* Private Defines ------------------------------------------*/
 // clang-format off
 
+#define I2C_QUEUE_OPERATION_TIMEOUT		pdMS_TO_TICKS( 100 )
+
 // clang-format on
 /* Type Definitions -----------------------------------------*/
 
@@ -248,3 +250,42 @@ eModuleError_t eI2CTransfer( xI2CModule_t *pxModule, void *pvSendBuffer, uint16_
 }
 
 /*-----------------------------------------------------------*/
+
+eModuleError_t eI2CQueueTransaction( xI2CModule_t *pxModule, xBusTransaction_t *pxTransaction )
+{
+	xBusOperation_t *pxOperation;
+	eModuleError_t	 eResult = ERROR_NONE;
+
+	if ( ( pxTransaction->pvConfig == NULL ) || ( pxTransaction->ucNumOperations == 0 ) ) {
+		return ERROR_INVALID_DATA;
+	}
+
+	/* Transfers are polled on this platform, so the transaction runs in the calling task */
+	eResult = eI2CBusStart( pxModule, (xI2CConfig_t *) pxTransaction->pvConfig, portMAX_DELAY );
+	if ( eResult != ERROR_NONE ) {
+		return eResult;
+	}
+	for ( pxTransaction->ucOperation = 0; pxTransaction->ucOperation < pxTransaction->ucNumOperations; pxTransaction->ucOperation++ ) {
+		pxOperation = &pxTransaction->pxOperations[pxTransaction->ucOperation];
+		if ( pxOperation->usRxLen == 0 ) {
+			eResult = eI2CTransmit( pxModule, pxOperation->pvTx, pxOperation->usTxLen, I2C_QUEUE_OPERATION_TIMEOUT );
+		}
+		else if ( pxOperation->usTxLen == 0 ) {
+			eResult = eI2CReceive( pxModule, pxOperation->pvRx, pxOperation->usRxLen, I2C_QUEUE_OPERATION_TIMEOUT );
+		}
+		else {
+			eResult = eI2CTransfer( pxModule, pxOperation->pvTx, pxOperation->usTxLen, pxOperation->pvRx, pxOperation->usRxLen, I2C_QUEUE_OPERATION_TIMEOUT );
+		}
+		if ( eResult != ERROR_NONE ) {
+			break;
+		}
+	}
+	eI2CBusEnd( pxModule );
+
+	if ( pxTransaction->fnDone != NULL ) {
+		pxTransaction->fnDone( pxTransaction, eResult );
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
@@ -7,6 +7,7 @@
 /* Includes -------------------------------------------------*/
 
 #include "spi.h"
+#include "csiro_math.h"
 #include "gpio.h"
 
 #include "spidrv.h"
@@ -176,6 +177,52 @@ void vSpiTransfer( xSpiModule_t *pxSpi, void *pvTxBuffer, void *pvRxBuffer, uint
 
 /*-----------------------------------------------------------*/
 
+eModuleError_t eSpiQueueTransaction( xSpiModule_t *pxSpi, xBusTransaction_t *pxTransaction )
+{
+	xBusOperation_t *pxOperation;
+	uint8_t *		 pucTx;
+	uint8_t *		 pucRx;
+	uint16_t		 usCommon;
+	eModuleError_t	 eError;
+
+	if ( ( pxTransaction->pvConfig == NULL ) || ( pxTransaction->ucNumOperations == 0 ) ) {
+		return ERROR_INVALID_DATA;
+	}
+
+	/* SPIDRV has no way to chain transfers, so the transaction runs in the calling task */
+	eError = eSpiBusStart( pxSpi, (const xSpiConfig_t *) pxTransaction->pvConfig, portMAX_DELAY );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	for ( pxTransaction->ucOperation = 0; pxTransaction->ucOperation < pxTransaction->ucNumOperations; pxTransaction->ucOperation++ ) {
+		pxOperation = &pxTransaction->pxOperations[pxTransaction->ucOperation];
+		pucTx		= (uint8_t *) pxOperation->pvTx;
+		pucRx		= (uint8_t *) pxOperation->pvRx;
+		usCommon	= MIN( pxOperation->usTxLen, pxOperation->usRxLen );
+
+		vSpiCsAssert( pxSpi );
+		/* Full duplex for the common length, then whichever direction is longer */
+		if ( usCommon > 0 ) {
+			vSpiTransfer( pxSpi, pucTx, pucRx, usCommon );
+		}
+		if ( pxOperation->usTxLen > usCommon ) {
+			vSpiTransmit( pxSpi, pucTx + usCommon, pxOperation->usTxLen - usCommon );
+		}
+		if ( pxOperation->usRxLen > usCommon ) {
+			vSpiReceive( pxSpi, pucRx + usCommon, pxOperation->usRxLen - usCommon );
+		}
+		vSpiCsRelease( pxSpi );
+	}
+	vSpiBusEnd( pxSpi );
+
+	if ( pxTransaction->fnDone != NULL ) {
+		pxTransaction->fnDone( pxTransaction, ERROR_NONE );
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
 static void prvSpiInit( xSpiModule_t *pxSpi )
 {
 	SPIDRV_Init_t xInitData;
@@ -216,9 +216,11 @@ void vTxDoneCallback( UARTDRV_Handle_t handle, Ecode_t transferStatus, uint8_t *
 {
 	UNUSED( handle );
 	UNUSED( transferStatus );
-	UNUSED( transferCount );
 	xUartModule_t *pxModule					= (xUartModule_t *) handle->context;
 	BaseType_t	 xHigherPriorityTaskWoken = pdFALSE;
+	/* UARTDRV starts the next queued buffer itself, so there are no chained starts to count */
+	pxModule->xStatistics.ulBuffersSent++;
+	pxModule->xStatistics.ulBytesSent += transferCount;
 	vMemoryPoolReleaseFromISR( pxModule->pxMemPool, (int8_t *) data, &xHigherPriorityTaskWoken );
 	xSemaphoreTakeFromISR( pxModule->xIncompleteTransmissions, &xHigherPriorityTaskWoken );
 	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
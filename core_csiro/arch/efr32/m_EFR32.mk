@@ -63,6 +63,7 @@ GENERATED_SRCS 		+= $(SRC_DIR)/gatt_efr32.c
 APPLICATION_SRCS 	+= $(CSIRO_ARCH_DIR)/FreeRTOS/src/LETIMER_tickless_idle.c
 APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/cpu/src/syscalls.c
 APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/cpu/src/cortex_exceptions.c
+APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/cpu/src/crash_dump.c
 
 ##############################################################################
 # SDK Library
@@ -34,7 +34,10 @@
 #include "nrfx_rtc.h"
 
 #include "board.h"
+#include "compiler_intrinsics.h"
 #include "cpu.h"
+#include "energy.h"
+#include "sleep_stats.h"
 
 #ifdef USE_RTC_TICKLESS_IDLE
 
@@ -99,6 +102,7 @@ static bool prvSleep( void )
 
 	/* Critical section to allow sleep blocks in ISRs. */
 	bEnterDeepSleep = bBoardCanDeepSleep();
+	vEnergyActive( ENERGY_CPU, false );
 	if ( bEnterDeepSleep ) {
 		vBoardDeepSleep();
 		__WFI();
@@ -106,12 +110,34 @@ static bool prvSleep( void )
 	else {
 		__WFI();
 	}
+	vEnergyActive( ENERGY_CPU, true );
 
 	return bEnterDeepSleep;
 }
 
 /*-----------------------------------------------------------*/
 
+static int32_t prvWakeIrq( void )
+{
+	uint32_t ulPending;
+	uint8_t  i;
+
+	/* Interrupts are still masked by the critical region, so the interrupt that ended WFI is still pending */
+	for ( i = 0; i < ( sizeof( NVIC->ISPR ) / sizeof( NVIC->ISPR[0] ) ); i++ ) {
+		ulPending = NVIC->ISPR[i];
+		if ( i == ( RTC1_IRQn / 32 ) ) {
+			/* The tick timer is not a wake source while ticks are suppressed */
+			ulPending &= ~( 1UL << ( RTC1_IRQn % 32 ) );
+		}
+		if ( ulPending != 0 ) {
+			return ( 32 * i ) + COUNT_TRAILING_ZEROS( ulPending );
+		}
+	}
+	return SLEEP_STATS_IRQ_UNKNOWN;
+}
+
+/*-----------------------------------------------------------*/
+
 void prvStopTickInterruptTimer( void )
 {
 	nrfx_rtc_tick_disable( &rtc );
@@ -173,6 +199,7 @@ void vSetWakeTimeInterrupt( TickType_t xExpectedIdleTime )
 void portSUPPRESS_TICKS_AND_SLEEP( TickType_t xExpectedIdleTime )
 {
 	unsigned long	ulLowPowerTimeBeforeSleep, ulLowPowerTimeAfterSleep;
+	TickType_t		 xSleepStart, xSleptTicks;
 	eSleepModeStatus eSleepStatus;
 
 	/* Ensure the expected idle time does not overflow the counter */
@@ -183,9 +210,11 @@ void portSUPPRESS_TICKS_AND_SLEEP( TickType_t xExpectedIdleTime )
 	/* Read the current time from a time source that will remain operational
     while the microcontroller is in a low power state. */
 	ulLowPowerTimeBeforeSleep = ulGetExternalTime();
+	xSleepStart				  = xTaskGetTickCount();
 
 	/* Confirm the board can enter deep sleep before stopping the interrupt */
 	if ( !bBoardCanDeepSleep() ) {
+		vSleepStatsRecord( xSleepStart, xExpectedIdleTime, 0, SLEEP_WAKE_BLOCKED, SLEEP_STATS_IRQ_UNKNOWN );
 		return;
 	}
 
@@ -205,6 +234,7 @@ void portSUPPRESS_TICKS_AND_SLEEP( TickType_t xExpectedIdleTime )
         sleep state.  Restart the tick and exit the critical section. */
 		prvStartTickInterruptTimer();
 		CRITICAL_REGION_EXIT();
+		vSleepStatsRecord( xSleepStart, xExpectedIdleTime, 0, SLEEP_WAKE_ABORTED, SLEEP_STATS_IRQ_UNKNOWN );
 	}
 	else {
 		if ( eSleepStatus == eNoTasksWaitingTimeout ) {
@@ -212,6 +242,12 @@ void portSUPPRESS_TICKS_AND_SLEEP( TickType_t xExpectedIdleTime )
             microcontroller out of its low power state at a fixed time in the
             future. */
 			prvSleep();
+
+			/* The RTC keeps counting, so the kernel tick can still be corrected for
+            the time spent asleep. The sleep is limited to one counter period. */
+			xSleptTicks = ( ulGetExternalTime() - ulLowPowerTimeBeforeSleep ) & UINT24_MAX;
+			vTaskStepTick( xSleptTicks );
+			vSleepStatsRecord( xSleepStart, portMAX_DELAY, xSleptTicks, SLEEP_WAKE_INTERRUPT, prvWakeIrq() );
 		}
 		else {
 			/* Configure an interrupt to bring the microcontroller out of its low
@@ -234,8 +270,17 @@ void portSUPPRESS_TICKS_AND_SLEEP( TickType_t xExpectedIdleTime )
 			ulLowPowerTimeAfterSleep = ulGetExternalTime();
 
 			/* Correct the kernels tick count to account for the time the
-            microcontroller spent in its low power state. */
-			vTaskStepTick( ulLowPowerTimeAfterSleep - ulLowPowerTimeBeforeSleep );
+            microcontroller spent in its low power state. The counter is only
+            24 bits, so the difference is truncated to handle it wrapping. */
+			xSleptTicks = ( ulLowPowerTimeAfterSleep - ulLowPowerTimeBeforeSleep ) & UINT24_MAX;
+			vTaskStepTick( xSleptTicks );
+
+			if ( xSleptTicks >= xExpectedIdleTime ) {
+				vSleepStatsRecord( xSleepStart, xExpectedIdleTime, xSleptTicks, SLEEP_WAKE_TIMEOUT, SLEEP_STATS_IRQ_UNKNOWN );
+			}
+			else {
+				vSleepStatsRecord( xSleepStart, xExpectedIdleTime, xSleptTicks, SLEEP_WAKE_INTERRUPT, prvWakeIrq() );
+			}
 		}
 
 		/* Exit the critical section - it might be possible to do this immediately
@@ -26,6 +26,7 @@
 
 #include "FreeRTOS.h"
 
+#include "energy.h"
 #include "log.h"
 #include "rtc.h"
 
@@ -185,6 +186,7 @@ eModuleError_t eBluetoothGapScanStart( eBluetoothPhy_t ePHY )
 		eLog( LOG_BLUETOOTH_GAP, LOG_ERROR, "BT: Failed to start scan 0x%X\r\n", ulError );
 		return ( ulError == NRF_ERROR_INVALID_STATE ) ? ERROR_INVALID_STATE : ERROR_INVALID_DATA;
 	}
+	vEnergyActive( ENERGY_RADIO_SCAN, true );
 
 	xDateTime_t xDatetime;
 	bRtcGetDatetime( &xDatetime );
@@ -208,6 +210,7 @@ eModuleError_t eBluetoothGapScanStop( void )
 {
 	eModuleError_t eError = ( sd_ble_gap_scan_stop() == NRF_SUCCESS ) ? ERROR_NONE : ERROR_INVALID_STATE;
 	if ( eError == ERROR_NONE ) {
+		vEnergyActive( ENERGY_RADIO_SCAN, false );
 		xDateTime_t xDatetime;
 		bRtcGetDatetime( &xDatetime );
 		eLog( LOG_BLUETOOTH_GAP, LOG_DEBUG, "BT %2d.%05d: Scan stopped\r\n", xDatetime.xTime.ucSecond, xDatetime.xTime.usSecondFraction );
@@ -8,6 +8,7 @@
 #include "FreeRTOS.h"
 #include "semphr.h"
 
+#include "energy.h"
 #include "rtc.h"
 
 #include "bluetooth.h"
@@ -115,6 +116,7 @@ void prvBluetoothGattEventHandler( ble_evt_t const *pxEvent )
 				  pxConnected->peer_addr.addr );
 			xEventGroupClearBits( pxBluetoothState, BLUETOOTH_CONNECTING );
 			xEventGroupSetBits( pxBluetoothState, BLUETOOTH_CONNECTED );
+			vEnergyActive( ENERGY_RADIO_CONNECTED, true );
 
 			/* Initialise connection context appropriately */
 			if ( pxConnected->role != BLE_GAP_ROLE_PERIPH ) {
@@ -162,6 +164,7 @@ void prvBluetoothGattEventHandler( ble_evt_t const *pxEvent )
 			eLog( LOG_BLUETOOTH_GATT, LOG_INFO, "BT %2d.%05d: Device Disconnected %d\r\n",
 				  xDateTime.xTime.ucSecond, xDateTime.xTime.usSecondFraction, pxDisconnected->reason );
 			xEventGroupClearBits( pxBluetoothState, BLUETOOTH_CONNECTING | BLUETOOTH_CONNECTED );
+			vEnergyActive( ENERGY_RADIO_CONNECTED, false );
 			xEventGroupClearBits( pxEventConnection->xConnectionState, BT_CONNECTION_PENDING | BT_CONNECTION_CONNECTED );
 			xEventGroupSetBits( pxEventConnection->xConnectionState, BT_CONNECTION_IDLE );
 			/* Unblock any GATT tasks */
@@ -42,6 +42,7 @@
 #include "adc.h"
 
 #include "nrf_saadc.h"
+#include "nrfx_ppi.h"
 
 /* Module Defines -------------------------------------------*/
 // clang-format off
@@ -51,18 +52,22 @@
 
 #define ADC_MODULE_PLATFORM_SUFFIX( NAME, IRQ )
 
-#define ADC_MODULE_PLATFORM_DEFAULT( handle )                \
-	{                                                        \
-		.pxAdc									= handle,    \
-		.lLastCalibratedTemperatureMilliDegrees = UINT16_MAX \
+#define ADC_MODULE_PLATFORM_DEFAULT( handle )                 \
+	{                                                         \
+		.pxAdc									= handle,     \
+		.pxTimer								= NULL,       \
+		.xSampleChannel							= 0,          \
+		.lLastCalibratedTemperatureMilliDegrees = UINT16_MAX  \
 	}
 
 /* Type Definitions -----------------------------------------*/
 
 struct _xAdcPlatform_t
 {
-	NRF_SAADC_Type *pxAdc;
-	int32_t			lLastCalibratedTemperatureMilliDegrees;
+	NRF_SAADC_Type *  pxAdc;
+	NRF_TIMER_Type *  pxTimer;		  /**< Scan trigger for continuous sampling, assigned by the board */
+	nrf_ppi_channel_t xSampleChannel; /**< Connects pxTimer to the SAADC while sampling continuously */
+	int32_t			  lLastCalibratedTemperatureMilliDegrees;
 };
 
 /* Availible resolution of the sampled voltage. */
@@ -71,6 +71,11 @@
 		.xRxActivityChannel		= 0,                 \
 		.xFlushChannel			= 0,                 \
 		.xTimeoutExpiredChannel = 0,                 \
+		.xTxChainChannel		= 0,                 \
+		.xTxChainGroup			= 0,                 \
+		.pxInFlight				= { { 0 } },         \
+		.ucInFlight				= 0,                 \
+		.bTxStarted				= false,             \
 		.bAlwaysReceiving		= false,             \
 		.xRx					= UNUSED_GPIO,       \
 		.xTx					= UNUSED_GPIO,       \
@@ -96,6 +101,12 @@ struct _xUartPlatform_t
 	nrf_ppi_channel_t xRxActivityChannel;
 	nrf_ppi_channel_t xFlushChannel;
 	nrf_ppi_channel_t xTimeoutExpiredChannel;
+	nrf_ppi_channel_t xTxChainChannel;
+	nrf_ppi_channel_group_t xTxChainGroup;
+	/* Buffer being transmitted and the buffer loaded to follow it */
+	xPendingTransmit_t pxInFlight[2];
+	uint8_t			   ucInFlight;
+	bool			   bTxStarted;
 	bool			  bAlwaysReceiving;
 	xGpio_t			  xRx;
 	xGpio_t			  xTx;
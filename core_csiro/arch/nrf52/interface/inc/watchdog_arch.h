@@ -31,16 +31,17 @@
 			"ite   EQ\n"                   \
 			"mrseq R0, MSP\n"              \
 			"mrsne R0, PSP\n"              \
+			"mov   R1, LR\n"                \
 			"b vWatchdogRunInterrupt\n" ); \
 	}
 
 #else
 
-#define WATCHDOG_HANDLER_BUILD( IRQ_NAME ) \
-	void IRQ_NAME( void )                  \
-	{                                      \
-		uint32_t pulStack[6] = { 0 };      \
-		vWatchdogRunInterrupt( pulStack ); \
+#define WATCHDOG_HANDLER_BUILD( IRQ_NAME )    \
+	void IRQ_NAME( void )                     \
+	{                                         \
+		uint32_t pulStack[8] = { 0 };         \
+		vWatchdogRunInterrupt( pulStack, 0 ); \
 	}
 
 #endif
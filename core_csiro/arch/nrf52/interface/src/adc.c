@@ -13,8 +13,11 @@
 
 #include "adc.h"
 #include "adc_arch.h"
+#include "energy.h"
 
 #include "nrf_saadc.h"
+#include "nrf_timer.h"
+#include "nrfx_ppi.h"
 #include "nrfx_saadc.h"
 
 /* Private Defines ------------------------------------------*/
@@ -23,6 +26,9 @@
 
 #define TEMP_RECALIBRATION_THRESHOLD 10000 // 10 degrees
 
+/* Acquisition (10us) plus conversion (<2us) time of each input in a scan */
+#define ADC_SCAN_CHANNEL_TIME_US 12
+
 /* Type Definitions -----------------------------------------*/
 
 /* Function Declarations ------------------------------------*/
@@ -34,10 +40,15 @@ nrf_saadc_reference_t prvAdcReferenceVoltageMapping( eAdcReferenceVoltage_t eAdc
 
 void vAdcInterruptHandler( nrfx_saadc_evt_t const *pxEvent );
 
+static void prvAdcContinuousBlock( const xAdcContinuousConfig_t *pxConfig, nrf_saadc_value_t *psBuffer, uint16_t usSize );
+
 /* Private Variables ----------------------------------------*/
 
 STATIC_SEMAPHORE_STRUCTURES( xSamplingDoneSemaphore );
 
+/* Module sampling continuously, the SAADC interrupt has no context */
+static xAdcModule_t *pxContinuousAdc = NULL;
+
 /* Functions ------------------------------------------------*/
 
 /**
@@ -96,6 +107,7 @@ uint32_t ulAdcSample( xAdcModule_t *pxAdc, xGpio_t xGpio, eAdcResolution_t eReso
 	 * is terribly wrong, so reboot.
 	 **/
 	configASSERT( xSemaphoreTake( pxAdc->xModuleAvailableHandle, pdMS_TO_TICKS( 1000 ) ) == pdTRUE );
+	vEnergyActive( ENERGY_ADC, true );
 
 	/* Initialise the SAADC module. */
 	configASSERT( nrfx_saadc_init( &xAdcInit, vAdcInterruptHandler ) == NRFX_SUCCESS );
@@ -123,6 +135,8 @@ uint32_t ulAdcSample( xAdcModule_t *pxAdc, xGpio_t xGpio, eAdcResolution_t eReso
 	 **/
 	configASSERT( xSemaphoreTake( xSamplingDoneSemaphore, pdMS_TO_TICKS( 1000 ) ) == pdTRUE );
 
+	vEnergyActive( ENERGY_ADC, false );
+
 	/**
 	 * Once the conversion is finished, give the semaphore back because other
 	 * tasks can now sample the ADC.
@@ -177,6 +191,132 @@ eModuleError_t eAdcRecalibrate( xAdcModule_t *pxAdc )
 
 /*-----------------------------------------------------------*/
 
+/**
+ * Continuous sampling chains the TIMER COMPARE0 event to the SAADC SAMPLE task
+ * through PPI, so each scan is triggered in hardware. The nrfx driver keeps two
+ * buffers registered, when one fills it moves the DMA to the other and reports
+ * the full one, which is handed back once the callback has processed it.
+ *
+ * Inputs are assigned to SAADC channels in the order they are given, as the
+ * SAADC scans channels in ascending order.
+ *
+ * Hardware oversampling is not used, as the SAADC only supports it with a single
+ * channel enabled. Decimation is done in software on each block instead.
+ **/
+eModuleError_t eAdcContinuousStart( xAdcModule_t *pxAdc, const xAdcContinuousConfig_t *pxConfig )
+{
+	NRF_TIMER_Type *const	  pxTimer  = pxAdc->xPlatform.pxTimer;
+	nrfx_saadc_config_t		   xAdcInit = NRFX_SAADC_DEFAULT_CONFIG;
+	nrf_saadc_channel_config_t xAdcChannelInit;
+	uint32_t				   ulBlockSamples;
+	uint32_t				   ulCompareEvent;
+	uint8_t					   ucChannel;
+
+	/* The board must assign a timer to trigger scans */
+	configASSERT( pxTimer != NULL );
+
+	ulBlockSamples = (uint32_t) pxConfig->usBlockScans * pxConfig->ucNumChannels;
+	if ( ( pxConfig->ucNumChannels == 0 ) || ( pxConfig->ucNumChannels > NRF_SAADC_CHANNEL_COUNT ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( ( ulBlockSamples == 0 ) || ( ulBlockSamples > SAADC_RESULT_MAXCNT_MAXCNT_Msk ) || ( pxConfig->fnCallback == NULL ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( ( pxConfig->ucDecimation > 1 ) && ( ( pxConfig->usBlockScans % pxConfig->ucDecimation ) != 0 ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	/* A scan must complete before the next one is triggered */
+	if ( pxConfig->ulSamplePeriodUs < ( pxConfig->ucNumChannels * ADC_SCAN_CHANNEL_TIME_US ) ) {
+		return ERROR_INVALID_DATA;
+	}
+
+	if ( xSemaphoreTake( pxAdc->xModuleAvailableHandle, pdMS_TO_TICKS( 1000 ) ) != pdTRUE ) {
+		return ERROR_TIMEOUT;
+	}
+	vEnergyActive( ENERGY_ADC, true );
+
+	/* In low power mode the sample task is START, which would restart the buffer on every scan */
+	xAdcInit.oversample		= NRF_SAADC_OVERSAMPLE_DISABLED;
+	xAdcInit.low_power_mode = false;
+
+	pxAdc->pxContinuous = pxConfig;
+	pxContinuousAdc		= pxAdc;
+
+	configASSERT( nrfx_saadc_init( &xAdcInit, vAdcInterruptHandler ) == NRFX_SUCCESS );
+	for ( ucChannel = 0; ucChannel < pxConfig->ucNumChannels; ucChannel++ ) {
+		xAdcChannelInit			  = (nrf_saadc_channel_config_t) NRFX_SAADC_DEFAULT_CHANNEL_CONFIG_SE( prvGpioToAnalogPortMapping( pxConfig->pxChannels[ucChannel] ) );
+		xAdcChannelInit.reference = prvAdcReferenceVoltageMapping( pxConfig->eReferenceVoltage );
+		xAdcChannelInit.gain	  = prvAdcGainMapping( pxConfig->eReferenceVoltage );
+		configASSERT( nrfx_saadc_channel_init( ucChannel, &xAdcChannelInit ) == NRFX_SUCCESS );
+	}
+	nrf_saadc_resolution_set( pxConfig->eResolution );
+
+	/* First buffer starts the SAADC, the second is loaded to follow it */
+	configASSERT( nrfx_saadc_buffer_convert( pxConfig->ppsBuffers[0], ulBlockSamples ) == NRFX_SUCCESS );
+	configASSERT( nrfx_saadc_buffer_convert( pxConfig->ppsBuffers[1], ulBlockSamples ) == NRFX_SUCCESS );
+
+	/* 1MHz timer, clearing itself on each scan */
+	nrf_timer_mode_set( pxTimer, NRF_TIMER_MODE_TIMER );
+	nrf_timer_bit_width_set( pxTimer, NRF_TIMER_BIT_WIDTH_32 );
+	nrf_timer_frequency_set( pxTimer, NRF_TIMER_FREQ_1MHz );
+	nrf_timer_cc_write( pxTimer, NRF_TIMER_CC_CHANNEL0, pxConfig->ulSamplePeriodUs );
+	nrf_timer_shorts_enable( pxTimer, NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK );
+	nrf_timer_task_trigger( pxTimer, NRF_TIMER_TASK_CLEAR );
+
+	ulCompareEvent = (uint32_t) nrf_timer_event_address_get( pxTimer, NRF_TIMER_EVENT_COMPARE0 );
+	configASSERT( nrfx_ppi_channel_alloc( &pxAdc->xPlatform.xSampleChannel ) == NRFX_SUCCESS );
+	nrfx_ppi_channel_assign( pxAdc->xPlatform.xSampleChannel, ulCompareEvent, nrfx_saadc_sample_task_get() );
+	nrfx_ppi_channel_enable( pxAdc->xPlatform.xSampleChannel );
+
+	nrf_timer_task_trigger( pxTimer, NRF_TIMER_TASK_START );
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eAdcContinuousStop( xAdcModule_t *pxAdc )
+{
+	NRF_TIMER_Type *const pxTimer = pxAdc->xPlatform.pxTimer;
+
+	if ( pxAdc->pxContinuous == NULL ) {
+		return ERROR_INVALID_STATE;
+	}
+
+	nrf_timer_task_trigger( pxTimer, NRF_TIMER_TASK_STOP );
+	nrfx_ppi_channel_disable( pxAdc->xPlatform.xSampleChannel );
+	nrfx_ppi_channel_free( pxAdc->xPlatform.xSampleChannel );
+	nrf_timer_shorts_disable( pxTimer, NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK );
+	nrf_timer_event_clear( pxTimer, NRF_TIMER_EVENT_COMPARE0 );
+	nrf_timer_task_trigger( pxTimer, NRF_TIMER_TASK_SHUTDOWN );
+
+	/* Disables the interrupt before stopping, no blocks are reported after this */
+	nrfx_saadc_uninit();
+
+	pxContinuousAdc		= NULL;
+	pxAdc->pxContinuous = NULL;
+
+	vEnergyActive( ENERGY_ADC, false );
+	xSemaphoreGive( pxAdc->xModuleAvailableHandle );
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAdcContinuousBlock( const xAdcContinuousConfig_t *pxConfig, nrf_saadc_value_t *psBuffer, uint16_t usSize )
+{
+	uint16_t usScans = usSize / pxConfig->ucNumChannels;
+
+	if ( pxConfig->ucDecimation > 1 ) {
+		usScans = usAdcDecimate( psBuffer, usScans, pxConfig->ucNumChannels, pxConfig->ucDecimation );
+	}
+	pxConfig->fnCallback( psBuffer, usScans, pxConfig->ucNumChannels, pxConfig->pvContext );
+
+	/* The DMA has already moved to the other buffer, queue this one to follow it */
+	configASSERT( nrfx_saadc_buffer_convert( psBuffer, usSize ) == NRFX_SUCCESS );
+}
+
+/*-----------------------------------------------------------*/
+
 uint8_t prvGpioToAnalogChannelMapping( xGpio_t xGpio )
 {
 	/**
@@ -292,8 +432,13 @@ void vAdcInterruptHandler( nrfx_saadc_evt_t const *pxEvent )
 	 * enabled which draws ~ 1mA of current.
 	 * 
 	 * Reference: https://github.com/NordicPlayground/nRF52-ADC-examples/blob/11.0.0/saadc_low_power/main.c
+	 *
+	 * Continuous sampling keeps the module running and recycles the buffer instead.
 	 **/
-	if ( pxEvent->type == NRFX_SAADC_EVT_DONE ) {
+	if ( ( pxEvent->type == NRFX_SAADC_EVT_DONE ) && ( pxContinuousAdc != NULL ) ) {
+		prvAdcContinuousBlock( pxContinuousAdc->pxContinuous, pxEvent->data.done.p_buffer, pxEvent->data.done.size );
+	}
+	else if ( pxEvent->type == NRFX_SAADC_EVT_DONE ) {
 		nrfx_saadc_uninit();
 		xSemaphoreGiveFromISR( xSamplingDoneSemaphore, pxHigherPriorityTaskWoken );
 	}
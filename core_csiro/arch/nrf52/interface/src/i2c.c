@@ -9,6 +9,7 @@
 #include "semphr.h"
 #include "task.h"
 
+#include "compiler_intrinsics.h"
 #include "gpio.h"
 #include "i2c.h"
 #include "i2c_arch.h"
@@ -28,6 +29,10 @@ static nrf_twim_frequency_t xGetOptimumFrequency( uint32_t ulFrequency );
 static eModuleError_t		eGetErrorMessage( nrfx_err_t eError );
 void						vErrata89Workaround( xI2CModule_t *pxModule );
 
+static void prvI2CQueueStart( xI2CModule_t *pxModule, xBusTransaction_t *pxTransaction );
+static void prvI2COperationStart( xI2CModule_t *pxModule, xBusTransaction_t *pxTransaction );
+static void prvI2CEventHandler( nrfx_twim_evt_t const *pxEvent, void *pvContext );
+
 /* Private Variables ----------------------------------------*/
 
 /* Functions ------------------------------------------------*/
@@ -39,6 +44,7 @@ eModuleError_t eI2CInit( xI2CModule_t *pxModule )
 
 	// Create a mutex for our I2C module.
 	pxModule->xBusMutexHandle = xSemaphoreCreateMutexStatic( &( pxModule->xBusMutexStorage ) );
+	vBusTransactionQueueInit( &pxModule->xQueue );
 
 	return ERROR_NONE;
 }
@@ -56,6 +62,9 @@ eModuleError_t eI2CBusStart( xI2CModule_t *pxModule, xI2CConfig_t *pxConfig, Tic
 		return ERROR_TIMEOUT;
 	}
 
+	// Wait for any queued transaction in progress.
+	vBusTransactionQueueClaim( &pxModule->xQueue );
+
 	nrfx_twim_config_t xNrfDriverConfig = NRFX_TWIM_DEFAULT_CONFIG;
 	xNrfDriverConfig.scl				= pxModule->xPlatform.xScl.ucPin;
 	xNrfDriverConfig.sda				= pxModule->xPlatform.xSda.ucPin;
@@ -80,6 +89,8 @@ eModuleError_t eI2CBusStart( xI2CModule_t *pxModule, xI2CConfig_t *pxConfig, Tic
 
 eModuleError_t eI2CBusEnd( xI2CModule_t *pxModule )
 {
+	xBusTransaction_t *pxTransaction;
+
 	configASSERT( pxModule != NULL );
 	configASSERT( pxModule->bBusClaimed == true );
 
@@ -92,6 +103,12 @@ eModuleError_t eI2CBusEnd( xI2CModule_t *pxModule )
 	pxModule->bBusClaimed	 = false;
 	pxModule->pxCurrentConfig = NULL;
 
+	/* Resume transactions queued while the bus was claimed */
+	pxTransaction = pxBusTransactionQueueRelease( &pxModule->xQueue );
+	if ( pxTransaction != NULL ) {
+		prvI2CQueueStart( pxModule, pxTransaction );
+	}
+
 	/* Return the mutex */
 	xSemaphoreGive( pxModule->xBusMutexHandle );
 
@@ -200,6 +217,124 @@ eModuleError_t eI2CTransfer( xI2CModule_t *pxModule, void *pvSendBuffer, uint16_
 
 /*-----------------------------------------------------------*/
 
+eModuleError_t eI2CQueueTransaction( xI2CModule_t *pxModule, xBusTransaction_t *pxTransaction )
+{
+	xBusOperation_t *pxOperation;
+	uint8_t			 i;
+
+	if ( ( pxTransaction->pvConfig == NULL ) || ( pxTransaction->ucNumOperations == 0 ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	for ( i = 0; i < pxTransaction->ucNumOperations; i++ ) {
+		pxOperation = &pxTransaction->pxOperations[i];
+		configASSERT( ( pxOperation->usTxLen + pxOperation->usRxLen ) != 0 );
+		configASSERT( ( pxOperation->usTxLen == 0 ) || nrfx_is_in_ram( pxOperation->pvTx ) );
+		configASSERT( ( pxOperation->usRxLen == 0 ) || nrfx_is_in_ram( pxOperation->pvRx ) );
+	}
+
+	if ( bBusTransactionQueuePush( &pxModule->xQueue, pxTransaction ) ) {
+		prvI2CQueueStart( pxModule, pxTransaction );
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvI2CQueueStart( xI2CModule_t *pxModule, xBusTransaction_t *pxTransaction )
+{
+	const xI2CConfig_t *pxConfig = (const xI2CConfig_t *) pxTransaction->pvConfig;
+	nrfx_err_t			eError;
+
+	/* Unlike the blocking API, the driver runs with an event handler */
+	nrfx_twim_config_t xNrfDriverConfig = NRFX_TWIM_DEFAULT_CONFIG;
+	xNrfDriverConfig.scl				= pxModule->xPlatform.xScl.ucPin;
+	xNrfDriverConfig.sda				= pxModule->xPlatform.xSda.ucPin;
+	xNrfDriverConfig.frequency			= xGetOptimumFrequency( pxConfig->ulMaximumBusFrequency );
+	xNrfDriverConfig.interrupt_priority = configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY;
+
+	/* Only fails if the instance is in use, which the queue claim prevents */
+	eError = nrfx_twim_init( &pxModule->xPlatform.xInstance, &xNrfDriverConfig, prvI2CEventHandler, pxModule );
+	configASSERT( eError == NRFX_SUCCESS );
+	UNUSED( eError );
+
+	nrfx_twim_enable( &pxModule->xPlatform.xInstance );
+
+	prvI2COperationStart( pxModule, pxTransaction );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvI2COperationStart( xI2CModule_t *pxModule, xBusTransaction_t *pxTransaction )
+{
+	const xI2CConfig_t *  pxConfig	= (const xI2CConfig_t *) pxTransaction->pvConfig;
+	xBusOperation_t *	 pxOperation = &pxTransaction->pxOperations[pxTransaction->ucOperation];
+	nrfx_twim_xfer_desc_t xTransfer;
+	nrfx_err_t			  eError;
+
+	xTransfer.address = pxConfig->ucAddress >> 1;
+	if ( pxOperation->usRxLen == 0 ) {
+		xTransfer.type			 = NRFX_TWIM_XFER_TX;
+		xTransfer.p_primary_buf  = pxOperation->pvTx;
+		xTransfer.primary_length = pxOperation->usTxLen;
+	}
+	else if ( pxOperation->usTxLen == 0 ) {
+		xTransfer.type			 = NRFX_TWIM_XFER_RX;
+		xTransfer.p_primary_buf  = pxOperation->pvRx;
+		xTransfer.primary_length = pxOperation->usRxLen;
+	}
+	else {
+		/* LASTTX_STARTRX and LASTRX_STOP shorts run the write, repeated START and read without the CPU */
+		xTransfer.type			   = NRFX_TWIM_XFER_TXRX;
+		xTransfer.p_primary_buf	= pxOperation->pvTx;
+		xTransfer.primary_length   = pxOperation->usTxLen;
+		xTransfer.p_secondary_buf  = pxOperation->pvRx;
+		xTransfer.secondary_length = pxOperation->usRxLen;
+	}
+
+	eError = nrfx_twim_xfer( &pxModule->xPlatform.xInstance, &xTransfer, 0 );
+	configASSERT( eError == NRFX_SUCCESS );
+	UNUSED( eError );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvI2CEventHandler( nrfx_twim_evt_t const *pxEvent, void *pvContext )
+{
+	xI2CModule_t *		pxModule	  = (xI2CModule_t *) pvContext;
+	xBusTransaction_t * pxTransaction = pxModule->xQueue.pxHead;
+	const xI2CConfig_t *pxConfig;
+	xBusTransaction_t * pxNext;
+	eModuleError_t		eResult;
+
+	eResult = ( pxEvent->type == NRFX_TWIM_EVT_DONE ) ? ERROR_NONE : ERROR_NO_ACKNOWLEDGEMENT;
+
+	/* Next operation of the same transaction, the remainder is abandoned on a NACK */
+	pxTransaction->ucOperation++;
+	if ( ( eResult == ERROR_NONE ) && ( pxTransaction->ucOperation < pxTransaction->ucNumOperations ) ) {
+		prvI2COperationStart( pxModule, pxTransaction );
+		return;
+	}
+
+	/* Start the next transaction before running the callback of this one */
+	pxNext = pxBusTransactionQueuePop( &pxModule->xQueue );
+	if ( pxNext == NULL ) {
+		nrfx_twim_disable( &pxModule->xPlatform.xInstance );
+		nrfx_twim_uninit( &pxModule->xPlatform.xInstance );
+		vErrata89Workaround( pxModule );
+	}
+	else {
+		if ( pxNext->pvConfig != pxTransaction->pvConfig ) {
+			/* The address is part of each transfer, only the frequency is per device */
+			pxConfig = (const xI2CConfig_t *) pxNext->pvConfig;
+			nrf_twim_frequency_set( pxModule->xPlatform.xInstance.p_twim, xGetOptimumFrequency( pxConfig->ulMaximumBusFrequency ) );
+		}
+		prvI2COperationStart( pxModule, pxNext );
+	}
+	vBusTransactionQueueComplete( &pxModule->xQueue, pxTransaction, eResult );
+}
+
+/*-----------------------------------------------------------*/
+
 static nrf_twim_frequency_t xGetOptimumFrequency( uint32_t ulFrequency )
 {
 	/**
@@ -25,6 +25,13 @@
 /* Function Declarations ------------------------------------*/
 
 static void prvSpiTransfer( xSpiModule_t *pxSpi, void *pvTxBuffer, uint32_t ulTxLength, void *pvRxBuffer, uint32_t ulRxLength );
+static void prvSpiStart( xSpiModule_t *pxSpi, void *pvTxBuffer, uint32_t ulTxLength, void *pvRxBuffer, uint32_t ulRxLength );
+static void prvSpiConfigure( xSpiModule_t *pxSpi, const xSpiConfig_t *pxConfig );
+static void prvSpiStop( xSpiModule_t *pxSpi );
+
+static void prvSpiQueueStart( xSpiModule_t *pxSpi, xBusTransaction_t *pxTransaction );
+static void prvSpiOperationStart( xSpiModule_t *pxSpi, xBusTransaction_t *pxTransaction );
+static void prvSpiQueueService( xSpiModule_t *pxSpi );
 
 static nrf_spim_mode_t		xClockModeConversion( eSpiClockMode_t eClockMode );
 static nrf_spim_frequency_t xGetOptimumFrequency( uint32_t ulFrequency );
@@ -60,6 +67,7 @@ eModuleError_t eSpiInit( xSpiModule_t *pxSpi )
 
 	pxSpi->xBusMutexHandle		  = xSemaphoreCreateRecursiveMutexStatic( &( pxSpi->xBusMutexStorage ) );
 	pxSpi->xTransactionDoneHandle = xSemaphoreCreateBinaryStatic( &( pxSpi->xTransactionDoneStorage ) );
+	vBusTransactionQueueInit( &pxSpi->xQueue );
 
 	/* Set priority of SPI interrupt */
 	vInterruptSetPriority( xIRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY );
@@ -76,40 +84,14 @@ eModuleError_t eSpiBusStart( xSpiModule_t *pxSpi, const xSpiConfig_t *pxConfig,
 		return ERROR_TIMEOUT;
 	}
 
+	/* Wait for any queued transaction in progress */
+	vBusTransactionQueueClaim( &pxSpi->xQueue );
+
 	pxSpi->bBusClaimed	 = true;
 	pxSpi->bCsAsserted	 = false;
 	pxSpi->pxCurrentConfig = pxConfig;
 
-	/* Shorter names to make things more readable. */
-	const xSpiConfig_t *pxCurrentConfig = pxSpi->pxCurrentConfig;
-	xSpiPlatform_t *	pxPlatform		= &pxSpi->xPlatform;
-	NRF_SPIM_Type *		pxControlBlock  = pxPlatform->xInstance.p_reg;
-	const IRQn_Type		xIRQn			= nrfx_get_irq_number( pxControlBlock );
-
-	/* Setup SCLK Pin */
-	uint8_t ucDefaultSCLK = xClockModeConversion( pxCurrentConfig->eClockMode ) <= NRF_SPIM_MODE_1 ? GPIO_PUSHPULL_LOW : GPIO_PUSHPULL_HIGH;
-	vGpioSetup( pxPlatform->xSclk, GPIO_PUSHPULL, ucDefaultSCLK );
-	/* Setup other pins */
-	vGpioSetup( pxPlatform->xMosi, GPIO_PUSHPULL, GPIO_PUSHPULL_LOW );
-	vGpioSetup( pxPlatform->xMiso, GPIO_INPUT, GPIO_INPUT_NOFILTER );
-
-	/* Connect all pins to the module */
-	nrf_spim_pins_set( pxControlBlock, pxPlatform->xSclk.ucPin, pxPlatform->xMosi.ucPin, pxPlatform->xMiso.ucPin );
-
-	/* Set up SPI Module configuration settings */
-	nrf_spim_frequency_set( pxControlBlock, xGetOptimumFrequency( pxCurrentConfig->ulMaxBitrate ) );
-	nrf_spim_configure( pxControlBlock, xClockModeConversion( pxCurrentConfig->eClockMode ), xMostSignifigantBitFirst( pxCurrentConfig->ucMsbFirst ) );
-	nrf_spim_orc_set( pxControlBlock, pxCurrentConfig->ucDummyTx );
-
-	/* Trigger an interrupt at the end of a transmission */
-	nrf_spim_int_enable( pxControlBlock, NRF_SPIM_INT_END_MASK );
-
-	/* Enable global interrupt handler */
-	NVIC_ClearPendingIRQ( xIRQn );
-	NVIC_EnableIRQ( xIRQn );
-
-	/* Enable the module */
-	nrf_spim_enable( pxControlBlock );
+	prvSpiConfigure( pxSpi, pxConfig );
 
 	return ERROR_NONE;
 }
@@ -121,37 +103,18 @@ void vSpiBusEnd( xSpiModule_t *pxSpi )
 	configASSERT( pxSpi->bBusClaimed );
 	configASSERT( !pxSpi->bCsAsserted );
 
-	/* Shorter names to make things more readable. */
-	xSpiPlatform_t *pxPlatform	 = &pxSpi->xPlatform;
-	NRF_SPIM_Type * pxControlBlock = pxSpi->xPlatform.xInstance.p_reg;
+	xBusTransaction_t *pxTransaction;
 
 	pxSpi->pxCurrentConfig = NULL;
 	pxSpi->bBusClaimed	 = false;
 
-	/* Disable all module interrupts, and finally disable the module */
-	nrf_spim_int_disable( pxControlBlock, NRF_SPIM_ALL_INTS_MASK );
-
-	nrf_spim_disable( pxControlBlock );
+	prvSpiStop( pxSpi );
 
-/** 
- * NRF52840 Errata 195
- * 	SPIM3 continues to draw current after disable.
- * 	Current consumption around 900 μA higher than specified.
- */
-#ifdef NRF52840_XXAA
-	if ( pxSpi->xPlatform.xInstance.p_reg == NRF_SPIM3 ) {
-		*(volatile uint32_t *) 0x4002F004 = 1;
+	/* Resume transactions queued while the bus was claimed */
+	pxTransaction = pxBusTransactionQueueRelease( &pxSpi->xQueue );
+	if ( pxTransaction != NULL ) {
+		prvSpiQueueStart( pxSpi, pxTransaction );
 	}
-#endif /* NRF52840_XXAA */
-
-	/**
-	 * Reset the pins to default to save power.
-	 * Also allows other applications to take control of the pins when not in
-	 * use for SPI.
-	 **/
-	vGpioSetup( pxPlatform->xMiso, GPIO_PUSHPULL, GPIO_PUSHPULL_HIGH );
-	vGpioSetup( pxPlatform->xMosi, GPIO_PUSHPULL, GPIO_PUSHPULL_HIGH );
-	vGpioSetup( pxPlatform->xSclk, GPIO_PUSHPULL, GPIO_PUSHPULL_HIGH );
 
 	/* Return the SPI bus semaphore */
 	xSemaphoreGiveRecursive( pxSpi->xBusMutexHandle );
@@ -161,11 +124,19 @@ void vSpiBusEnd( xSpiModule_t *pxSpi )
 
 eModuleError_t eSpiBusLockout( xSpiModule_t *pxSpi, bool bEnableLockout, TickType_t xTimeout )
 {
-	BaseType_t xRet;
+	xBusTransaction_t *pxTransaction;
+	BaseType_t		   xRet;
 	if ( bEnableLockout ) {
 		xRet = xSemaphoreTakeRecursive( pxSpi->xBusMutexHandle, xTimeout );
+		if ( xRet == pdPASS ) {
+			vBusTransactionQueueClaim( &pxSpi->xQueue );
+		}
 	}
 	else {
+		pxTransaction = pxBusTransactionQueueRelease( &pxSpi->xQueue );
+		if ( pxTransaction != NULL ) {
+			prvSpiQueueStart( pxSpi, pxTransaction );
+		}
 		xRet = xSemaphoreGiveRecursive( pxSpi->xBusMutexHandle );
 	}
 	return ( xRet == pdPASS ) ? ERROR_NONE : ERROR_TIMEOUT;
@@ -221,12 +192,48 @@ void vSpiTransfer( xSpiModule_t *pxSpi, void *pvTxBuffer, void *pvRxBuffer, uint
 
 /*-----------------------------------------------------------*/
 
+eModuleError_t eSpiQueueTransaction( xSpiModule_t *pxSpi, xBusTransaction_t *pxTransaction )
+{
+	xBusOperation_t *pxOperation;
+	uint8_t			 i;
+
+	if ( ( pxTransaction->pvConfig == NULL ) || ( pxTransaction->ucNumOperations == 0 ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	for ( i = 0; i < pxTransaction->ucNumOperations; i++ ) {
+		pxOperation = &pxTransaction->pxOperations[i];
+		configASSERT( ( pxOperation->usTxLen + pxOperation->usRxLen ) != 0 );
+		configASSERT( ( pxOperation->usTxLen == 0 ) || nrfx_is_in_ram( pxOperation->pvTx ) );
+		configASSERT( ( pxOperation->usRxLen == 0 ) || nrfx_is_in_ram( pxOperation->pvRx ) );
+	}
+
+	if ( bBusTransactionQueuePush( &pxSpi->xQueue, pxTransaction ) ) {
+		prvSpiQueueStart( pxSpi, pxTransaction );
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
 static void prvSpiTransfer( xSpiModule_t *pxSpi, void *pvTxBuffer, uint32_t ulTxLen, void *pvRxBuffer, uint32_t ulRxLen )
 {
 	/* Check that bus is in the correct state for a transaction */
 	configASSERT( pxSpi->bBusClaimed );
 	configASSERT( pxSpi->bCsAsserted );
 
+	prvSpiStart( pxSpi, pvTxBuffer, ulTxLen, pvRxBuffer, ulRxLen );
+
+	/* Wait forever for the transaction to complete */
+	if ( xSemaphoreTake( pxSpi->xTransactionDoneHandle, portMAX_DELAY ) != pdPASS ) {
+		/* This assertion is used for error checking in CPPUTEST */
+		configASSERT( 0 );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSpiStart( xSpiModule_t *pxSpi, void *pvTxBuffer, uint32_t ulTxLen, void *pvRxBuffer, uint32_t ulRxLen )
+{
 #ifdef NRF52840_XXAA
 	if ( pxSpi->xPlatform.xInstance.p_reg == NRF_SPIM3 ) {
 		pvMemcpy( pucSPIM3WorkaroundTxBuffer, pvTxBuffer, ulTxLen );
@@ -241,12 +248,128 @@ static void prvSpiTransfer( xSpiModule_t *pxSpi, void *pvTxBuffer, uint32_t ulTx
 	/* Clear any past END events, and trigger a start */
 	nrf_spim_event_clear( pxSpi->xPlatform.xInstance.p_reg, NRF_SPIM_EVENT_END );
 	nrf_spim_task_trigger( pxSpi->xPlatform.xInstance.p_reg, NRF_SPIM_TASK_START );
+}
 
-	/* Wait forever for the transaction to complete */
-	if ( xSemaphoreTake( pxSpi->xTransactionDoneHandle, portMAX_DELAY ) != pdPASS ) {
-		/* This assertion is used for error checking in CPPUTEST */
-		configASSERT( 0 );
+/*-----------------------------------------------------------*/
+
+static void prvSpiConfigure( xSpiModule_t *pxSpi, const xSpiConfig_t *pxConfig )
+{
+	/* Shorter names to make things more readable. */
+	xSpiPlatform_t *pxPlatform	 = &pxSpi->xPlatform;
+	NRF_SPIM_Type * pxControlBlock = pxPlatform->xInstance.p_reg;
+	const IRQn_Type xIRQn		   = nrfx_get_irq_number( pxControlBlock );
+
+	/* Queued transactions switch devices without stopping the module */
+	nrf_spim_disable( pxControlBlock );
+
+	/* Setup SCLK Pin */
+	uint8_t ucDefaultSCLK = xClockModeConversion( pxConfig->eClockMode ) <= NRF_SPIM_MODE_1 ? GPIO_PUSHPULL_LOW : GPIO_PUSHPULL_HIGH;
+	vGpioSetup( pxPlatform->xSclk, GPIO_PUSHPULL, ucDefaultSCLK );
+	/* Setup other pins */
+	vGpioSetup( pxPlatform->xMosi, GPIO_PUSHPULL, GPIO_PUSHPULL_LOW );
+	vGpioSetup( pxPlatform->xMiso, GPIO_INPUT, GPIO_INPUT_NOFILTER );
+
+	/* Connect all pins to the module */
+	nrf_spim_pins_set( pxControlBlock, pxPlatform->xSclk.ucPin, pxPlatform->xMosi.ucPin, pxPlatform->xMiso.ucPin );
+
+	/* Set up SPI Module configuration settings */
+	nrf_spim_frequency_set( pxControlBlock, xGetOptimumFrequency( pxConfig->ulMaxBitrate ) );
+	nrf_spim_configure( pxControlBlock, xClockModeConversion( pxConfig->eClockMode ), xMostSignifigantBitFirst( pxConfig->ucMsbFirst ) );
+	nrf_spim_orc_set( pxControlBlock, pxConfig->ucDummyTx );
+
+	/* Trigger an interrupt at the end of a transmission */
+	nrf_spim_int_enable( pxControlBlock, NRF_SPIM_INT_END_MASK );
+
+	/* Enable global interrupt handler */
+	NVIC_ClearPendingIRQ( xIRQn );
+	NVIC_EnableIRQ( xIRQn );
+
+	/* Enable the module */
+	nrf_spim_enable( pxControlBlock );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSpiStop( xSpiModule_t *pxSpi )
+{
+	/* Shorter names to make things more readable. */
+	xSpiPlatform_t *pxPlatform	 = &pxSpi->xPlatform;
+	NRF_SPIM_Type * pxControlBlock = pxSpi->xPlatform.xInstance.p_reg;
+
+	/* Disable all module interrupts, and finally disable the module */
+	nrf_spim_int_disable( pxControlBlock, NRF_SPIM_ALL_INTS_MASK );
+
+	nrf_spim_disable( pxControlBlock );
+
+/** 
+ * NRF52840 Errata 195
+ * 	SPIM3 continues to draw current after disable.
+ * 	Current consumption around 900 μA higher than specified.
+ */
+#ifdef NRF52840_XXAA
+	if ( pxSpi->xPlatform.xInstance.p_reg == NRF_SPIM3 ) {
+		*(volatile uint32_t *) 0x4002F004 = 1;
+	}
+#endif /* NRF52840_XXAA */
+
+	/**
+	 * Reset the pins to default to save power.
+	 * Also allows other applications to take control of the pins when not in
+	 * use for SPI.
+	 **/
+	vGpioSetup( pxPlatform->xMiso, GPIO_PUSHPULL, GPIO_PUSHPULL_HIGH );
+	vGpioSetup( pxPlatform->xMosi, GPIO_PUSHPULL, GPIO_PUSHPULL_HIGH );
+	vGpioSetup( pxPlatform->xSclk, GPIO_PUSHPULL, GPIO_PUSHPULL_HIGH );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSpiQueueStart( xSpiModule_t *pxSpi, xBusTransaction_t *pxTransaction )
+{
+	prvSpiConfigure( pxSpi, (const xSpiConfig_t *) pxTransaction->pvConfig );
+	prvSpiOperationStart( pxSpi, pxTransaction );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSpiOperationStart( xSpiModule_t *pxSpi, xBusTransaction_t *pxTransaction )
+{
+	const xSpiConfig_t *pxConfig	= (const xSpiConfig_t *) pxTransaction->pvConfig;
+	xBusOperation_t *   pxOperation = &pxTransaction->pxOperations[pxTransaction->ucOperation];
+
+	vGpioSetup( pxConfig->xCsGpio, GPIO_PUSHPULL, GPIO_PUSHPULL_LOW );
+	prvSpiStart( pxSpi, pxOperation->pvTx, pxOperation->usTxLen, pxOperation->pvRx, pxOperation->usRxLen );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSpiQueueService( xSpiModule_t *pxSpi )
+{
+	xBusTransaction_t * pxTransaction = pxSpi->xQueue.pxHead;
+	const xSpiConfig_t *pxConfig	  = (const xSpiConfig_t *) pxTransaction->pvConfig;
+	xBusTransaction_t * pxNext;
+
+	vGpioSetup( pxConfig->xCsGpio, GPIO_PUSHPULL, GPIO_PUSHPULL_HIGH );
+
+	/* Next operation of the same transaction */
+	pxTransaction->ucOperation++;
+	if ( pxTransaction->ucOperation < pxTransaction->ucNumOperations ) {
+		prvSpiOperationStart( pxSpi, pxTransaction );
+		return;
+	}
+
+	/* Start the next transaction before running the callback of this one */
+	pxNext = pxBusTransactionQueuePop( &pxSpi->xQueue );
+	if ( pxNext == NULL ) {
+		prvSpiStop( pxSpi );
+	}
+	else {
+		if ( pxNext->pvConfig != pxTransaction->pvConfig ) {
+			prvSpiConfigure( pxSpi, (const xSpiConfig_t *) pxNext->pvConfig );
+		}
+		prvSpiOperationStart( pxSpi, pxNext );
 	}
+	vBusTransactionQueueComplete( &pxSpi->xQueue, pxTransaction, ERROR_NONE );
 }
 
 /*-----------------------------------------------------------*/
@@ -318,6 +441,12 @@ void vSpiInterruptHandler( xSpiModule_t *pxSpi )
 
 	nrf_spim_event_clear( pxSpi->xPlatform.xInstance.p_reg, NRF_SPIM_EVENT_END );
 
+	/* The queue and the blocking API never use the module at the same time */
+	if ( pxSpi->xQueue.bActive ) {
+		prvSpiQueueService( pxSpi );
+		return;
+	}
+
 	xSemaphoreGiveFromISR( pxSpi->xTransactionDoneHandle, &xHigherPriorityTaskWoken );
 
 	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
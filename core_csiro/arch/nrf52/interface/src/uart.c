@@ -35,6 +35,10 @@ void vUartInterruptHandler( xUartModule_t *pxModule );
 void prvUartInit( xUartModule_t *pxModule );
 void prvUartDisable( xUartModule_t *pxModule );
 
+static void prvUartStartTransmit( xUartModule_t *pxModule );
+static void prvUartLoadTransmit( xUartModule_t *pxModule, const xPendingTransmit_t *pxTransmit );
+static void prvUartTransmitDone( xUartModule_t *pxModule, BaseType_t *pxHigherPriorityTaskWoken );
+
 /* Private Variables ----------------------------------------*/
 /*-----------------------------------------------------------*/
 
@@ -118,6 +122,19 @@ eModuleError_t eUartInit( xUartModule_t *pxModule, bool bFlowControl )
 	nrfx_ppi_channel_alloc( &pxPlatform->xTimeoutExpiredChannel );
 	nrfx_ppi_channel_assign( pxPlatform->xTimeoutExpiredChannel, ulTimeoutChannelEvent, ulUartRxStopTask );
 
+	/**
+	 * The end of a transmission starts the buffer loaded into the double buffered TXD.PTR, so that queued
+	 * buffers are transmitted back to back. The channel is enabled once a buffer is loaded to follow, and
+	 * disables itself through its group after starting it.
+	 **/
+	uint32_t ulTxEndEvent	 = (uint32_t) nrf_uarte_event_address_get( pxUart, NRF_UARTE_EVENT_ENDTX );
+	uint32_t ulUartTxStartTask = (uint32_t) nrf_uarte_task_address_get( pxUart, NRF_UARTE_TASK_STARTTX );
+	nrfx_ppi_channel_alloc( &pxPlatform->xTxChainChannel );
+	nrfx_ppi_group_alloc( &pxPlatform->xTxChainGroup );
+	nrfx_ppi_channel_include_in_group( pxPlatform->xTxChainChannel, pxPlatform->xTxChainGroup );
+	nrfx_ppi_channel_assign( pxPlatform->xTxChainChannel, ulTxEndEvent, ulUartTxStartTask );
+	nrfx_ppi_channel_fork_assign( pxPlatform->xTxChainChannel, nrfx_ppi_task_addr_group_disable_get( pxPlatform->xTxChainGroup ) );
+
 	/* Set priority of UART interrupt */
 	vInterruptSetPriority( xIRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY );
 
@@ -208,7 +225,7 @@ void prvUartInit( xUartModule_t *pxModule )
 	pxTimer->EVENTS_COMPARE[RX_TIMEOUT_CC_CHANNEL] = 0x00;
 
 	/* Enable interrupt sources */
-	pxUart->INTEN = NRF_UARTE_INT_ENDRX_MASK | NRF_UARTE_INT_ENDTX_MASK |
+	pxUart->INTEN = NRF_UARTE_INT_ENDRX_MASK | NRF_UARTE_INT_ENDTX_MASK | NRF_UARTE_INT_TXSTARTED_MASK |
 					NRF_UARTE_INT_ERROR_MASK | NRF_UARTE_INT_RXTO_MASK;
 
 	/* Enable global interrupt handler */
@@ -249,15 +266,19 @@ void vUartQueueBuffer( xUartModule_t *pxModule, int8_t *pcBuffer, uint32_t ulBuf
 	CRITICAL_SECTION_DECLARE;
 	/* Critical section so that a second thread doesn't start another initialisation sequence halfway through */
 	CRITICAL_SECTION_START();
-	if ( uxSemaphoreGetCount( pxModule->xIncompleteTransmissions ) == 0 ) {
+	if ( pxPlatform->ucInFlight == 0 ) {
 		/* Enable the Hardware if not currently on */
 		if ( !pxUart->ENABLE ) {
 			prvUartInit( pxModule );
 		}
 		/* There are no buffers currently TX'ing, which means we must start it ourselves */
-		pxUart->TXD.PTR		  = (uint32_t) pcBuffer;
-		pxUart->TXD.MAXCNT	= ulBufferLen;
-		pxUart->TASKS_STARTTX = 0x01;
+		pxPlatform->pxInFlight[0] = xTransmit;
+		pxPlatform->ucInFlight	= 1;
+		prvUartStartTransmit( pxModule );
+	}
+	else if ( ( pxPlatform->ucInFlight == 1 ) && pxPlatform->bTxStarted ) {
+		/* Current buffer has been latched by the DMA, this buffer can follow it directly */
+		prvUartLoadTransmit( pxModule, &xTransmit );
 	}
 	else {
 		/* Buffer already TX'ing, add it to the queue for the interrupt handler to start */
@@ -277,7 +298,7 @@ void vUartInterruptHandler( xUartModule_t *pxModule )
 	NRF_TIMER_Type *const  pxTimer	= pxPlatform->pxTimer;
 	xPendingTransmit_t	 xTransmit;
 	BaseType_t			   xHigherPriorityTaskWoken = pdFALSE;
-	int8_t *			   pucPtr;
+	bool				   bChained;
 
 	/**
 	 * 		We want to continue receiving data under the following conditions
@@ -292,7 +313,7 @@ void vUartInterruptHandler( xUartModule_t *pxModule )
 
 	/* There is potentially more data if we have recently received data but our RX timer event hasn't fired yet */
 	const bool bAlwaysReceiving   = pxPlatform->bAlwaysReceiving;
-	const bool bTransmitting	  = pxUart->EVENTS_TXSTARTED;
+	const bool bTransmitting	  = pxPlatform->ucInFlight > 0;
 	const bool bTimeoutRunning	= pxUart->EVENTS_RXDRDY && ( !pxTimer->EVENTS_COMPARE[RX_TIMEOUT_CC_CHANNEL] );
 	const bool bContinueReceiving = bAlwaysReceiving || bTransmitting || bTimeoutRunning;
 
@@ -328,33 +349,115 @@ void vUartInterruptHandler( xUartModule_t *pxModule )
 	if ( pxUart->EVENTS_ENDTX ) {
 		/* Transmission has completed */
 		pxUart->EVENTS_ENDTX = 0x00;
-		pucPtr				 = (int8_t *) pxUart->TXD.PTR;
-		/* Check if there are more buffers pending to transmit */
-		if ( xQueueReceiveFromISR( pxPlatform->xQueuedTransmits, &xTransmit, &xHigherPriorityTaskWoken ) == pdTRUE ) {
-			/* Start the pending transmit */
-			pxUart->TXD.PTR		  = (uint32_t) xTransmit.pucBuffer;
-			pxUart->TXD.MAXCNT	= xTransmit.ulBufferLen;
-			pxUart->TASKS_STARTTX = 0x01;
+		nrfx_ppi_channel_disable( pxPlatform->xTxChainChannel );
+		/** 
+		 * TXSTARTED follows the STARTTX from the chain channel within a few cycles. If it is not set the
+		 * channel was enabled after ENDTX, or not at all, and the loaded buffer must be started here.
+		 * TXSTARTED of the previous buffer was cleared before the next buffer was loaded.
+		 **/
+		bChained = ( pxPlatform->ucInFlight == 2 ) && pxUart->EVENTS_TXSTARTED;
+		/* An ENDTX already handled as a merged completion has nothing left in flight */
+		if ( pxPlatform->ucInFlight > 0 ) {
+			prvUartTransmitDone( pxModule, &xHigherPriorityTaskWoken );
 		}
-		else {
-			/* Trigger STOPTX to move to lower power state and to set EVENT_TXSTOPPED */
-			pxUart->EVENTS_TXSTARTED = 0x00;
-			pxUart->TASKS_STOPTX	 = 0x01;
-			/* Stop RX if we're not always receiving and timeout isn't running */
-			if ( !bAlwaysReceiving && !bTimeoutRunning ) {
-				pxUart->TASKS_STOPRX = 0x01;
+		if ( bChained ) {
+			pxModule->xStatistics.ulChainedStarts++;
+			/* If this interrupt was delayed the chained buffer may have completed as well, its ENDTX merged with 
+			 * the previous one. TXD.AMOUNT is the length of the last completed buffer, which differs between 
+			 * chained buffers. The chained buffer can also complete after ENDTX was cleared above, so its
+			 * event is cleared here to not complete a buffer twice. */
+			if ( pxUart->TXD.AMOUNT == pxPlatform->pxInFlight[0].ulBufferLen ) {
+				pxUart->EVENTS_ENDTX = 0x00;
+				prvUartTransmitDone( pxModule, &xHigherPriorityTaskWoken );
+			}
+		}
+		else if ( pxPlatform->ucInFlight > 0 ) {
+			prvUartStartTransmit( pxModule );
+		}
+		/* Check if there are more buffers pending to transmit */
+		if ( pxPlatform->ucInFlight == 0 ) {
+			if ( xQueueReceiveFromISR( pxPlatform->xQueuedTransmits, &xTransmit, &xHigherPriorityTaskWoken ) == pdTRUE ) {
+				/* Start the pending transmit */
+				pxPlatform->pxInFlight[0] = xTransmit;
+				pxPlatform->ucInFlight	= 1;
+				prvUartStartTransmit( pxModule );
+			}
+			else {
+				/* Trigger STOPTX to move to lower power state and to set EVENT_TXSTOPPED */
+				pxUart->EVENTS_TXSTARTED = 0x00;
+				pxPlatform->bTxStarted   = false;
+				pxUart->TASKS_STOPTX	 = 0x01;
+				/* Stop RX if we're not always receiving and timeout isn't running */
+				if ( !bAlwaysReceiving && !bTimeoutRunning ) {
+					pxUart->TASKS_STOPRX = 0x01;
+				}
 			}
 		}
-		/* Return buffer to the available memory pool */
-		vMemoryPoolReleaseFromISR( pxModule->pxMemPool, pucPtr, &xHigherPriorityTaskWoken );
-		xSemaphoreGiveFromISR( pxModule->xTxDone, &xHigherPriorityTaskWoken );
-		xSemaphoreTakeFromISR( pxModule->xIncompleteTransmissions, &xHigherPriorityTaskWoken );
+	}
+	if ( pxUart->EVENTS_TXSTARTED ) {
+		/* DMA has latched the current buffer, TXD.PTR can now be loaded with the next one */
+		pxUart->EVENTS_TXSTARTED = 0x00;
+		pxPlatform->bTxStarted   = ( pxPlatform->ucInFlight > 0 );
+		if ( ( pxPlatform->ucInFlight == 1 ) && ( xQueueReceiveFromISR( pxPlatform->xQueuedTransmits, &xTransmit, &xHigherPriorityTaskWoken ) == pdTRUE ) ) {
+			prvUartLoadTransmit( pxModule, &xTransmit );
+		}
 	}
 	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
 }
 
 /*-----------------------------------------------------------*/
 
+static void prvUartStartTransmit( xUartModule_t *pxModule )
+{
+	xUartPlatform_t *const pxPlatform = &pxModule->xPlatform;
+	NRF_UARTE_Type *const  pxUart	 = pxPlatform->pxUart;
+
+	/* TXSTARTED must only be set by this buffer before the next buffer can be loaded */
+	pxUart->EVENTS_TXSTARTED = 0x00;
+	pxPlatform->bTxStarted   = false;
+	pxUart->TXD.PTR			 = (uint32_t) pxPlatform->pxInFlight[0].pucBuffer;
+	pxUart->TXD.MAXCNT		 = pxPlatform->pxInFlight[0].ulBufferLen;
+	pxUart->TASKS_STARTTX	= 0x01;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUartLoadTransmit( xUartModule_t *pxModule, const xPendingTransmit_t *pxTransmit )
+{
+	xUartPlatform_t *const pxPlatform = &pxModule->xPlatform;
+	NRF_UARTE_Type *const  pxUart	 = pxPlatform->pxUart;
+
+	/* Must be called with interrupts masked, after TXSTARTED of the current buffer */
+	pxPlatform->pxInFlight[1] = *pxTransmit;
+	pxPlatform->ucInFlight	= 2;
+	pxUart->TXD.PTR			  = (uint32_t) pxTransmit->pucBuffer;
+	pxUart->TXD.MAXCNT		  = pxTransmit->ulBufferLen;
+	/* Buffers of equal length can't be told apart by TXD.AMOUNT, so they are started by the interrupt */
+	if ( pxTransmit->ulBufferLen != pxPlatform->pxInFlight[0].ulBufferLen ) {
+		nrfx_ppi_channel_enable( pxPlatform->xTxChainChannel );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUartTransmitDone( xUartModule_t *pxModule, BaseType_t *pxHigherPriorityTaskWoken )
+{
+	xUartPlatform_t *const pxPlatform = &pxModule->xPlatform;
+	/* TXD.PTR reads back the buffer loaded to follow, so the completed buffer is tracked here */
+	int8_t *pucPtr = (int8_t *) pxPlatform->pxInFlight[0].pucBuffer;
+
+	pxModule->xStatistics.ulBuffersSent++;
+	pxModule->xStatistics.ulBytesSent += pxPlatform->pxInFlight[0].ulBufferLen;
+	pxPlatform->pxInFlight[0] = pxPlatform->pxInFlight[1];
+	pxPlatform->ucInFlight--;
+	/* Return buffer to the available memory pool */
+	vMemoryPoolReleaseFromISR( pxModule->pxMemPool, pucPtr, pxHigherPriorityTaskWoken );
+	xSemaphoreGiveFromISR( pxModule->xTxDone, pxHigherPriorityTaskWoken );
+	xSemaphoreTakeFromISR( pxModule->xIncompleteTransmissions, pxHigherPriorityTaskWoken );
+}
+
+/*-----------------------------------------------------------*/
+
 void prvUartDisable( xUartModule_t *pxModule )
 {
 	xUartPlatform_t *const pxPlatform = &pxModule->xPlatform;
@@ -366,6 +469,7 @@ void prvUartDisable( xUartModule_t *pxModule )
 	nrfx_ppi_channel_disable( pxPlatform->xRxActivityChannel );
 	nrfx_ppi_channel_disable( pxPlatform->xFlushChannel );
 	nrfx_ppi_channel_disable( pxPlatform->xTimeoutExpiredChannel );
+	nrfx_ppi_channel_disable( pxPlatform->xTxChainChannel );
 
 	/* Setup pin initial states */
 	vGpioSetup( pxPlatform->xTx, GPIO_PUSHPULL, GPIO_PUSHPULL_HIGH );
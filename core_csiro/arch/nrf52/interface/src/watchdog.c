@@ -115,6 +115,8 @@ void vWatchdogSetRebootReason( eWatchdogRebootReason_t eReason, const char *pcTa
 		i++;
 	}
 	xWatchdogRebootValues.cTaskName[i] = '\0';
+	/* Store the task closest to overflowing its stack */
+	bStackMonitorLowest( &xWatchdogRebootValues.xStack );
 	/* Store PC and LR */
 	xWatchdogRebootValues.ulProgramCounter = ulProgramCounter;
 	xWatchdogRebootValues.ulLinkRegister   = ulLinkRegister;
@@ -65,6 +65,7 @@ GENERATED_SRCS 	+= $(SRC_DIR)/gatt_nrf52.c
 
 APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/cpu/src/syscalls.c
 APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/cpu/src/cortex_exceptions.c
+APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/cpu/src/crash_dump.c
 
 ##############################################################################
 # SDK Library
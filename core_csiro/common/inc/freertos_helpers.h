@@ -23,8 +23,9 @@
 	static StaticTask_t		 pxHandle##Struct;                     \
 	static StackType_t		 pxHandle##Stack[ulStackSize]
 
-#define STATIC_TASK_CREATE( pxHandle, fnFunction, pcDescription, pvParameters ) \
-	pxHandle = xTaskCreateStatic( fnFunction, pcDescription, pxHandle##StackSize, pvParameters, pxHandle##Priority, pxHandle##Stack, &pxHandle##Struct )
+#define STATIC_TASK_CREATE( pxHandle, fnFunction, pcDescription, pvParameters )                                                                   \
+	pxHandle = xTaskCreateStatic( fnFunction, pcDescription, pxHandle##StackSize, pvParameters, pxHandle##Priority, pxHandle##Stack, &pxHandle##Struct ), \
+	STACK_MONITOR_REGISTER( pcDescription, pxHandle##Stack, pxHandle##StackSize )
 
 #define STATIC_SEMAPHORE_STRUCTURES( pxHandle ) \
 	static SemaphoreHandle_t pxHandle;          \
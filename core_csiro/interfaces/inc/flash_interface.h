@@ -24,6 +24,20 @@
 /* Module Defines -------------------------------------------*/
 // clang-format off
 
+#define FLASH_CACHE_NO_PAGE     UINT32_MAX
+
+/* Delta update stream, see eFlashRomDeltaApply */
+#define FLASH_DELTA_BLOCK_SIZE      256     /**< Granularity of COPY and PATCH records */
+
+#define FLASH_DELTA_COPY            0x01    /**< [type, blocks, 0 (2), source offset (4)], blocks of the current image */
+#define FLASH_DELTA_LITERAL         0x02    /**< [type, 0, length (2)] + data, new data of at most one block */
+#define FLASH_DELTA_PATCH           0x03    /**< [type, edits, 0 (2), source offset (4)] + edits, a block of the current image with bytes replaced */
+#define FLASH_DELTA_END             0x04    /**< [type, 0, image CRC (2), image length (4)], validates the new image */
+
+#define FLASH_DELTA_HEADER_MAX      8
+
+#define FLASH_DELTA_FLAG_COMPLETE   0x0001  /**< New image has been written and validated */
+
 // clang-format on
 /* Type Definitions -----------------------------------------*/
 
@@ -48,6 +62,74 @@ typedef struct xFlashDefaultHardware_t
 	void *pvInterface; /**< Pointer to the communication interface, typically SPI */
 } xFlashDefaultHardware_t;
 
+/**@brief Optional write combining cache of a single flash page
+ * 
+ * Contiguous sub-page writes to the same page are merged and programmed as a single operation,
+ * either when a write to a different page arrives, xFlushDeadline after the first merged write,
+ * before any other operation type, or on eFlashFlush. The device never sleeps with writes pending.
+ * 
+ * Reads that fall completely within the pending bytes are served from RAM.
+ * Pending bytes are staged in xSettings.pucPage, which is otherwise only used as scratch space by
+ * operations that flush the cache first, so enabling the cache costs no additional page buffer.
+ * 
+ * @note	Writes are not merged across a gap, as bytes in the gap may already be programmed
+ * 			and reads of them could not be served from the cache.
+ * @note	Errors from deadline triggered programs are returned by the next operation on the device,
+ * 			eFlashFlush should be used when the result of a write must be known immediately.
+ */
+typedef struct xFlashCache_t
+{
+	TickType_t	   xFlushDeadline; /**< Maximum time writes can remain pending */
+	uint32_t	   ulPage;		   /**< Page with pending writes, FLASH_CACHE_NO_PAGE when clean */
+	uint16_t	   usDirtyStart;   /**< Offset of the first pending byte */
+	uint16_t	   usDirtyEnd;	   /**< Offset after the last pending byte */
+	TickType_t	   xPendingSince;  /**< Tick count of the first pending write */
+	eModuleError_t eDeferredError; /**< Failure of a deadline triggered program, not yet reported */
+	uint32_t	   ulWrites;	   /**< Statistics: Sub-page writes requested */
+	uint32_t	   ulPrograms;	   /**< Statistics: Program operations issued to the device */
+	uint32_t	   ulReadHits;	   /**< Statistics: Sub-page reads served from the cache */
+	uint32_t	   ulReadMisses;   /**< Statistics: Sub-page reads served by the device */
+} xFlashCache_t;
+
+/**@brief Progress of a delta update, checkpointed to NVM at erase unit boundaries
+ * 
+ * Everything before ulOutputOffset has been programmed, everything after it is erased
+ * again before being programmed when the update is resumed.
+ */
+typedef struct xFlashDeltaProgress_t
+{
+	uint32_t ulImageId;		 /**< Caller provided identifier of the update */
+	uint32_t ulStreamOffset; /**< Stream offset of the first record not completely applied */
+	uint32_t ulRecordSkip;   /**< Output bytes of that record already programmed */
+	uint32_t ulOutputOffset; /**< Bytes of the new image programmed */
+	uint16_t usCrc;			 /**< CRC16_CCITT of the programmed bytes */
+	uint16_t usFlags;		 /**< FLASH_DELTA_FLAG_* */
+} xFlashDeltaProgress_t;
+
+/**@brief Streaming delta update state */
+typedef struct xFlashDelta_t
+{
+	uint64_t			  ullFlashAddress;  /**< Destination of the new image, aligned to an erase unit */
+	uint8_t *			  pucRomAddress;	/**< Start of the current image */
+	uint32_t			  ulRomLength;		/**< Length of the current image */
+	xFlashDeltaProgress_t xProgress;		/**< Progress up to the last byte provided */
+	xFlashDeltaProgress_t xCheckpoint;		/**< Progress at the most recent erase unit boundary */
+	bool				  bCheckpointDirty; /**< xCheckpoint has not been written to NVM */
+	uint32_t			  ulStreamPosition; /**< Stream offset of the next byte expected */
+	uint32_t			  ulDiscard;		/**< Output bytes programmed before the update was resumed */
+	uint16_t			  usStaged;			/**< Output bytes waiting in the page buffer */
+	/* Record parser */
+	uint8_t  pucHeader[FLASH_DELTA_HEADER_MAX];
+	uint8_t  ucHeaderLen;
+	uint32_t ulRemaining;   /**< COPY and LITERAL output bytes remaining */
+	uint16_t usBlockOffset; /**< PATCH output offset within the block */
+	uint8_t  ucEdits;		/**< PATCH edits remaining */
+	uint8_t  pucEdit[2];	/**< PATCH edit header, [source bytes to keep, bytes to replace] */
+	uint8_t  ucEditLen;
+	uint8_t  ucSkip;	/**< PATCH source bytes before the current edit */
+	uint8_t  ucReplace; /**< PATCH replacement bytes remaining in the current edit */
+} xFlashDelta_t;
+
 /**@brief Flash Device Handle */
 typedef struct xFlashDevice_t
 {
@@ -56,6 +138,7 @@ typedef struct xFlashDevice_t
 	QueueHandle_t			 xCommandQueue;	/**< Queue to push commands at */
 	const char *			 pcName;		   /**< Unique device name*/
 	xFlashDefaultHardware_t *pxHardware;	   /**< Device Specific Hardware Mappings */
+	xFlashCache_t *			 pxCache;		   /**< Optional write combining cache, NULL to disable */
 } xFlashDevice_t;
 
 /**@brief Initialise Flash peripheral and query parameters
@@ -193,6 +276,18 @@ eModuleError_t eFlashRead( xFlashDevice_t *pxDevice, uint64_t ullFlashAddress, u
  */
 eModuleError_t eFlashWrite( xFlashDevice_t *pxDevice, uint64_t ullFlashAddress, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout );
 
+/**@brief Program any writes pending in the write combining cache
+ *
+ * @note	Once the requested operation has begun, this function will block until completion
+ * 			xTimeout is therefore the time to wait for the driver to become available, not an upper bound on execution time
+ * 
+ * @param[in] pxDevice		                Flash device to flush
+ * @param[in] xTimeout		            	Duration to wait for driver to become available
+ * 
+ * @retval ::ERROR_NONE 					No writes pending, or pending writes programmed successfully
+ */
+eModuleError_t eFlashFlush( xFlashDevice_t *pxDevice, TickType_t xTimeout );
+
 /**@brief Erase data from the flash device
  * 
  * @note    ullFlashAddress and ulLength must be integer multiples of (pxDevice->xSettings.usErasePages * pxDevice->xSettings.usPageSize)
@@ -295,6 +390,52 @@ eModuleError_t eFlashRomStore( xFlashDevice_t *pxDevice, uint64_t ullFlashAddres
  */
 eModuleError_t eFlashRomStoreDeltas( xFlashDevice_t *pxDevice, uint64_t ullFlashAddress, uint8_t *pucRomAddress, uint8_t *pucDeltas, uint8_t *pucDeltaData, uint8_t ucNumDeltas, TickType_t xTimeout );
 
+/**@brief Begin, or resume, a delta update from ROM into flash
+ * 
+ * If NVM holds progress for ulImageId the update resumes from the last checkpoint, otherwise it starts from the beginning.
+ * Delta stream data must then be provided from pxDelta->xProgress.ulStreamOffset onwards.
+ * 
+ * @param[in] pxDelta		                Update state
+ * @param[in] ulImageId		                Identifier of the update, for example the CRC of the new image
+ * @param[in] ullFlashAddress		        Start address of the new image, aligned to the erase unit of the device
+ * @param[in] pucRomAddress		            Start of the current image
+ * @param[in] ulRomLength		            Length of the current image
+ *
+ * @retval ::ERROR_NONE 					Update ready to receive data
+ * @retval ::ERROR_NO_CHANGE 				Update has already completed
+ */
+eModuleError_t eFlashRomDeltaStart( xFlashDelta_t *pxDelta, uint32_t ulImageId, uint64_t ullFlashAddress, uint8_t *pucRomAddress, uint32_t ulRomLength );
+
+/**@brief Apply the next portion of a delta update stream
+ * 
+ * The stream is a sequence of FLASH_DELTA_* records, which can be split across calls at any byte.
+ * New data is written in blocks of FLASH_DELTA_BLOCK_SIZE, which can be copied or patched from any
+ * byte offset of the current image so that code which has moved is not retransmitted.
+ * Erase units of the new image are erased immediately before they are first written, and the
+ * progress at each erase unit boundary is written to NVM before returning.
+ * The CRC of the new image is accumulated as it is written and checked against the FLASH_DELTA_END record,
+ * at which point FLASH_DELTA_FLAG_COMPLETE is set in pxDelta->xProgress.usFlags.
+ * 
+ * @note	Data before the expected stream offset is ignored, so retransmissions are harmless
+ * @note	After an error the update must be resumed with eFlashRomDeltaStart
+ * @note	Once the requested operation has begun, this function will block until completion
+ * 			xTimeout is therefore the time to wait for the driver to become available, not an upper bound on execution time
+ * 
+ * @param[in] pxDevice		                Flash device
+ * @param[in] pxDelta		                Update state from eFlashRomDeltaStart
+ * @param[in] ulStreamOffset		        Stream offset of pucData
+ * @param[in] pucData		                Delta stream data
+ * @param[in] ulLength		                Length of pucData
+ * @param[in] xTimeout		            	Duration to wait for driver to become available
+ *
+ * @retval ::ERROR_NONE 					Data applied
+ * @retval ::ERROR_INVALID_ADDRESS 			Data does not follow on from the stream already applied, or references outside the current image
+ * @retval ::ERROR_INVALID_DATA 			Malformed record
+ * @retval ::ERROR_INVALID_CRC 				New image does not match the FLASH_DELTA_END record, progress is discarded
+ * @retval ::ERROR_INVALID_STATE 			Update has already completed
+ */
+eModuleError_t eFlashRomDeltaApply( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta, uint32_t ulStreamOffset, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout );
+
 /**@brief Begin a flash read operation
  * 
  * Setup device for a streaming read operation that is never intended to end
@@ -310,4 +451,32 @@ eModuleError_t eFlashRomStoreDeltas( xFlashDevice_t *pxDevice, uint64_t ullFlash
  */
 eModuleError_t eFlashStartRead( xFlashDevice_t *pxDevice, uint64_t ullFlashAddress, TickType_t xTimeout );
 
+/* Driver Functions -----------------------------------------*/
+
+/**@brief Wait for a read that can be serviced while a long operation is in progress
+ * 
+ * Only intended to be called by flash drivers from the flash task while waiting on an erase.
+ * Returns as soon as a read is queued, rather than waiting the full duration.
+ * 
+ * @param[in] pxDevice		                Flash device
+ * @param[in] ulBusyPage		            First page of the region being modified
+ * @param[in] ulBusyPages		            Number of pages being modified, reads that overlap are not serviceable
+ * @param[in] xTimeout		            	Maximum duration to wait
+ *
+ * @retval true 							A serviceable read is waiting, see vFlashServiceReads
+ * @retval false 							xTimeout elapsed without a serviceable read
+ */
+bool bFlashWaitForRead( xFlashDevice_t *pxDevice, uint32_t ulBusyPage, uint32_t ulBusyPages, TickType_t xTimeout );
+
+/**@brief Run all queued reads that do not overlap the region being modified
+ * 
+ * Only intended to be called by flash drivers from the flash task, once the operation on
+ * the busy region has been suspended.
+ * 
+ * @param[in] pxDevice		                Flash device
+ * @param[in] ulBusyPage		            First page of the region being modified
+ * @param[in] ulBusyPages		            Number of pages being modified
+ */
+void vFlashServiceReads( xFlashDevice_t *pxDevice, uint32_t ulBusyPage, uint32_t ulBusyPages );
+
 #endif /* __CSIRO_CORE_FLASH_INTERFACE */
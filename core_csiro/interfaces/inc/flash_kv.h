@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: flash_kv.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Log structured key-value store on a range of erase sectors of a flash device
+ *
+ * Every update appends a record to a circular log, so a value update costs a
+ * program of the record rather than a read-modify-erase-write of a sector.
+ * 		1. Multiple keys can be committed atomically, the final record of a commit carries a commit flag
+ * 		2. Counters are incremented in RAM and only written back every usCounterWriteback increments
+ * 		3. Garbage collection copies the live records out of the oldest sector and erases it, one sector per step
+ *
+ * Each sector starts with a header holding a sequence number that orders the log. The RAM index of
+ * live records is rebuilt by scanning the log on initialisation, records belonging to a commit that
+ * was interrupted by a reset are discarded. One sector is always kept free for garbage collection.
+ *
+ * Records are a multiple of 4 bytes and never span a sector, so the store can also be placed on
+ * word programmed internal flash that is exposed through the flash_interface API.
+ *
+ */
+#ifndef __CSIRO_CORE_FLASH_KV
+#define __CSIRO_CORE_FLASH_KV
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "flash_interface.h"
+
+/* Module Defines -------------------------------------------*/
+
+// clang-format off
+#define FLASH_KV_KEY_MAX            0x7FFF  /**< Largest valid key */
+#define FLASH_KV_MAX_LENGTH         256     /**< Largest value that can be stored */
+#define FLASH_KV_MAX_COMMIT         8       /**< Most keys that can be updated in a single atomic commit */
+
+#define FLASH_KV_NO_ADDRESS         UINT32_MAX
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/**@brief Single key update within a commit */
+typedef struct xFlashKvItem_t
+{
+	uint16_t	usKey;	/**< Key to update */
+	uint16_t	usLength; /**< Length of pvData, 0 deletes the key */
+	const void *pvData;   /**< New value */
+} xFlashKvItem_t;
+
+/**@brief RAM index entry for a live key */
+typedef struct xFlashKvEntry_t
+{
+	uint16_t usKey;		/**< Key */
+	uint16_t usLength;  /**< Length of the value */
+	uint32_t ulAddress; /**< Offset of the newest record from the start of the store, FLASH_KV_NO_ADDRESS if only in RAM */
+	uint32_t ulCounter; /**< Cached value of 4 byte keys */
+	uint16_t usDirty;   /**< Increments of ulCounter not yet written to flash */
+} xFlashKvEntry_t;
+
+/**@brief Store statistics */
+typedef struct xFlashKvStats_t
+{
+	uint32_t ulCommits;		 /**< Commits written since initialisation */
+	uint32_t ulRecords;		 /**< Records written since initialisation, including relocations */
+	uint32_t ulBytesWritten; /**< Bytes programmed since initialisation, including headers */
+	uint32_t ulErases;		 /**< Sector erases since initialisation */
+	uint32_t ulRelocated;	/**< Records copied by garbage collection */
+	uint32_t ulCached;		 /**< Counter increments absorbed by the write-back cache */
+	uint32_t ulDiscarded;	/**< Records of incomplete commits or failed CRCs found during initialisation */
+	uint32_t ulLiveBytes;	/**< Flash space occupied by live records */
+	uint32_t ulFreeBytes;	/**< Flash space that can be written without garbage collection */
+	uint16_t usKeys;		 /**< Keys currently stored */
+} xFlashKvStats_t;
+
+/**@brief Store state */
+typedef struct xFlashKv_t
+{
+	/* Configuration */
+	xFlashDevice_t *pxDevice;			/**< Underlying flash device */
+	uint32_t		ulFirstSector;		/**< First erase sector of the store */
+	uint16_t		usNumSectors;		/**< Erase sectors in the store, at least 3 */
+	uint16_t		usMaxKeys;			/**< Capacity of the RAM index */
+	uint16_t		usCounterWriteback; /**< Counter increments held in RAM before being written, 0 or 1 writes through */
+	/* Runtime state */
+	SemaphoreHandle_t xAccess;		 /**< Access protection semaphore */
+	uint32_t		  ulSectorSize;  /**< Bytes per erase sector */
+	uint32_t		  ulSequence;	/**< Sequence number of the head sector */
+	uint32_t *		  pulSequence;   /**< Sequence number of each sector, 0 for free sectors */
+	uint16_t		  usHead;		 /**< Sector currently being appended to */
+	uint32_t		  ulHeadOffset;  /**< Offset of the next record in the head sector */
+	uint16_t		  usCommit;		 /**< Identifier of the next commit */
+	uint16_t		  usNumKeys;	 /**< Valid entries in pxIndex */
+	xFlashKvEntry_t * pxIndex;		 /**< Live keys */
+	uint8_t *		  pucRecord;	 /**< Record buffer */
+	xFlashKvStats_t   xStats;
+} xFlashKv_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Initialise the store and rebuild the index from flash
+ *
+ * Sectors without a valid header are erased if they contain any data.
+ *
+ * @param[in] pxKv					Store with configuration fields populated
+ *
+ * @retval ::ERROR_NONE 			Store initialised
+ * @retval ::ERROR_INVALID_DATA		Configuration is invalid
+ */
+eModuleError_t eFlashKvInit( xFlashKv_t *pxKv );
+
+/**@brief Read the value of a key
+ *
+ * @param[in] pxKv					Store
+ * @param[in] usKey					Key to read
+ * @param[out] pvData				Output buffer
+ * @param[in] usMaxLength			Size of pvData
+ * @param[out] pusLength			Optional, length of the value
+ *
+ * @retval ::ERROR_NONE 			Value read
+ * @retval ::ERROR_INVALID_ADDRESS	Key does not exist
+ * @retval ::ERROR_DATA_TOO_LARGE	Value is larger than usMaxLength
+ */
+eModuleError_t eFlashKvRead( xFlashKv_t *pxKv, uint16_t usKey, void *pvData, uint16_t usMaxLength, uint16_t *pusLength );
+
+/**@brief Write the value of a single key
+ *
+ * @param[in] pxKv					Store
+ * @param[in] usKey					Key to write
+ * @param[in] pvData				New value
+ * @param[in] usLength				Length of pvData, 0 deletes the key
+ *
+ * @retval ::ERROR_NONE 			Value written
+ * @retval ::ERROR_INVALID_DATA		Key or length is invalid
+ * @retval ::ERROR_DEVICE_FULL		Live data does not leave space for the value
+ */
+eModuleError_t eFlashKvWrite( xFlashKv_t *pxKv, uint16_t usKey, const void *pvData, uint16_t usLength );
+
+/**@brief Atomically update multiple keys
+ *
+ * Either all or none of the updates are visible after a reset during the commit.
+ * Dirty counters included in the commit are written with the provided value.
+ *
+ * @param[in] pxKv					Store
+ * @param[in] pxItems				Updates to apply, each key must appear at most once
+ * @param[in] ucNumItems			Number of updates, at most FLASH_KV_MAX_COMMIT
+ *
+ * @retval ::ERROR_NONE 			All updates written
+ * @retval ::ERROR_INVALID_DATA		An update is malformed
+ * @retval ::ERROR_DEVICE_FULL		Live data does not leave space for the commit
+ */
+eModuleError_t eFlashKvCommit( xFlashKv_t *pxKv, const xFlashKvItem_t *pxItems, uint8_t ucNumItems );
+
+/**@brief Increment a 4 byte counter
+ *
+ * The new value is held in RAM until usCounterWriteback increments have accumulated or eFlashKvFlush is called.
+ * Up to ( usCounterWriteback - 1 ) increments are lost on an unexpected reset.
+ * Counters that do not exist are created with a value of 1.
+ *
+ * @param[in] pxKv					Store
+ * @param[in] usKey					Counter to increment
+ * @param[out] pulNewValue			Optional, value after the increment
+ *
+ * @retval ::ERROR_NONE 			Counter incremented
+ * @retval ::ERROR_INVALID_DATA		Key exists but is not 4 bytes long
+ */
+eModuleError_t eFlashKvIncrement( xFlashKv_t *pxKv, uint16_t usKey, uint32_t *pulNewValue );
+
+/**@brief Write all counters with pending increments to flash
+ *
+ * @param[in] pxKv					Store
+ *
+ * @retval ::ERROR_NONE 			No increments remain in RAM
+ */
+eModuleError_t eFlashKvFlush( xFlashKv_t *pxKv );
+
+/**@brief Perform a single garbage collection step
+ *
+ * Reclaims the oldest sector if fewer than usMinFree sectors are free.
+ * Intended to be called from idle time so that writes rarely have to collect inline.
+ *
+ * @param[in] pxKv					Store
+ * @param[in] usMinFree				Desired number of free sectors
+ *
+ * @retval ::ERROR_NONE 			Enough sectors are free, or a sector was reclaimed
+ * @retval ::ERROR_DEVICE_FULL		The oldest sector could not be reclaimed
+ */
+eModuleError_t eFlashKvCollect( xFlashKv_t *pxKv, uint16_t usMinFree );
+
+/**@brief Remove all keys and erase the store
+ *
+ * @param[in] pxKv					Store
+ *
+ * @retval ::ERROR_NONE 			Store erased
+ */
+eModuleError_t eFlashKvErase( xFlashKv_t *pxKv );
+
+/**@brief Query store statistics
+ *
+ * @param[in] pxKv					Store
+ * @param[out] pxStats				Current statistics
+ */
+void vFlashKvStats( xFlashKv_t *pxKv, xFlashKvStats_t *pxStats );
+
+#endif /* __CSIRO_CORE_FLASH_KV */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: flash_wear.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Wear levelling and bad sector management for block storage on a flash device
+ *
+ * Logical sectors are mapped onto a pool of physical sectors that is larger by a number of spares.
+ * 		1. Erasing a logical sector moves it to the least worn free physical sector
+ * 		2. Sectors holding cold data are periodically moved onto worn sectors
+ * 		3. Sectors that fail to erase or program are retired
+ *
+ * The first page of every physical sector holds a small header with the owning logical sector,
+ * the erase count, and a sequence number. The mapping table is rebuilt from these headers on
+ * initialisation, with the highest sequence number winning when a crash leaves multiple claims
+ * on a logical sector. Each logical sector therefore provides ( usErasePages - 1 ) pages.
+ *
+ * Enabling the layer on a device changes the on-flash layout, existing data must be erased first.
+ *
+ */
+#ifndef __CSIRO_CORE_FLASH_WEAR
+#define __CSIRO_CORE_FLASH_WEAR
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "flash_interface.h"
+
+/* Module Defines -------------------------------------------*/
+
+// clang-format off
+#define FLASH_WEAR_UNMAPPED     UINT16_MAX
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/**@brief Wear levelling statistics */
+typedef struct xFlashWearStats_t
+{
+	uint32_t ulErases;		/**< Physical sector erases since initialisation */
+	uint32_t ulStaticMoves; /**< Cold logical sectors moved onto worn physical sectors */
+	uint32_t ulRetired;		/**< Physical sectors retired due to erase or program failures */
+	uint32_t ulMinErase;	/**< Lowest erase count of any usable physical sector */
+	uint32_t ulMaxErase;	/**< Highest erase count of any usable physical sector */
+	uint16_t usFree;		/**< Free physical sectors */
+} xFlashWearStats_t;
+
+/**@brief Translation layer state */
+typedef struct xFlashWear_t
+{
+	/* Configuration */
+	xFlashDevice_t *pxDevice;		   /**< Underlying flash device */
+	uint32_t		ulFirstSector;	   /**< First physical sector managed by the layer */
+	uint16_t		usNumSectors;	   /**< Physical sectors managed by the layer, including spares */
+	uint16_t		usNumSpares;	   /**< Physical sectors not visible as logical sectors */
+	uint32_t		ulStaticThreshold; /**< Erase count spread that triggers moving cold data, 0 to disable */
+	/* Runtime state */
+	SemaphoreHandle_t xAccess;		  /**< Access protection semaphore */
+	uint16_t		  usLogicalSectors; /**< usNumSectors - usNumSpares */
+	uint16_t		  usDataPages;		/**< Pages available in each logical sector */
+	uint32_t		  ulSequence;		/**< Sequence number of the most recent header */
+	uint16_t *		  pusMap;			/**< Logical to physical sector, FLASH_WEAR_UNMAPPED if never written */
+	uint16_t *		  pusOwner;			/**< Physical to logical sector, or free / bad markers */
+	uint32_t *		  pulEraseCount;	/**< Erase count of each physical sector */
+	uint8_t *		  pucPage;			/**< Page buffer for relocations */
+	xFlashWearStats_t xStats;
+} xFlashWear_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Initialise the layer and rebuild the mapping table from flash
+ *
+ * @param[in] pxWear				Layer with configuration fields populated
+ *
+ * @retval ::ERROR_NONE 			Layer initialised
+ * @retval ::ERROR_INVALID_DATA		Configuration is invalid
+ */
+eModuleError_t eFlashWearInit( xFlashWear_t *pxWear );
+
+/**@brief Read from a logical page
+ *
+ * Pages in logical sectors that have never been written read as the erase byte
+ *
+ * @param[in] pxWear				Layer
+ * @param[in] ulPage				Logical page
+ * @param[in] usOffset				Byte offset within the page
+ * @param[out] pucData				Output buffer
+ * @param[in] ulLength				Bytes to read, must not cross a page boundary
+ *
+ * @retval ::ERROR_NONE 			Data read
+ */
+eModuleError_t eFlashWearRead( xFlashWear_t *pxWear, uint32_t ulPage, uint16_t usOffset, uint8_t *pucData, uint32_t ulLength );
+
+/**@brief Program a logical page
+ *
+ * Logical sectors that have never been written are allocated on demand.
+ * If the program fails, the logical sector is relocated, the failed sector retired, and the program retried.
+ *
+ * @param[in] pxWear				Layer
+ * @param[in] ulPage				Logical page, must be erased
+ * @param[in] pucData				Data to write
+ * @param[in] ulLength				Bytes to write, must not cross a page boundary
+ *
+ * @retval ::ERROR_NONE 			Data written
+ * @retval ::ERROR_DEVICE_FULL		No free sectors remain for relocation
+ */
+eModuleError_t eFlashWearWrite( xFlashWear_t *pxWear, uint32_t ulPage, uint8_t *pucData, uint32_t ulLength );
+
+/**@brief Erase a logical sector
+ *
+ * The logical sector is remapped onto the least worn free physical sector
+ *
+ * @param[in] pxWear				Layer
+ * @param[in] ulSector				Logical sector
+ *
+ * @retval ::ERROR_NONE 			Logical sector erased
+ * @retval ::ERROR_DEVICE_FULL		No usable physical sectors remain
+ */
+eModuleError_t eFlashWearErase( xFlashWear_t *pxWear, uint32_t ulSector );
+
+/**@brief Query wear statistics
+ *
+ * @param[in] pxWear				Layer
+ * @param[out] pxStats				Current statistics
+ */
+void vFlashWearStats( xFlashWear_t *pxWear, xFlashWearStats_t *pxStats );
+
+#endif /* __CSIRO_CORE_FLASH_WEAR */
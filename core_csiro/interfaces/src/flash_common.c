@@ -14,6 +14,9 @@
 #include "board.h"
 #include "compiler_intrinsics.h"
 #include "crc.h"
+#include "csiro_math.h"
+#include "device_nvm.h"
+#include "energy.h"
 #include "log.h"
 #include "memory_operations.h"
 
@@ -32,7 +35,9 @@ typedef enum eCommand_t {
 	FLASH_CRC,
 	FLASH_ROM_STORE,
 	FLASH_ROM_STORE_DELTAS,
-	FLASH_ROM_START_READ
+	FLASH_ROM_START_READ,
+	FLASH_ROM_APPLY_DELTA,
+	FLASH_FLUSH
 } eCommand_t;
 
 typedef struct xFlashAction_t
@@ -63,15 +68,38 @@ static eModuleError_t prvFlashIterateRead( xFlashDevice_t *pxDevice, uint32_t ul
 static eModuleError_t prvFlashIterateCrc( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint16_t usNumBytes, uint32_t ulByteIndex, void *pvContext );
 static eModuleError_t prvFlashIterateRomStore( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint16_t usNumBytes, uint32_t ulByteIndex, void *pvContext );
 
+static bool prvFlashReadServiceable( xFlashDevice_t *pxDevice, xFlashAction_t *pxAction, uint32_t ulBusyPage, uint32_t ulBusyPages );
+
+static eModuleError_t prvFlashCacheWrite( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint8_t *pucData, uint16_t usNumBytes );
+static eModuleError_t prvFlashCacheRead( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint8_t *pucData, uint16_t usNumBytes );
+static eModuleError_t prvFlashCacheFlush( xFlashDevice_t *pxDevice );
+
 static eModuleError_t prvFlashErase( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint32_t ulDataLength );
 static eModuleError_t prvFlashRomCopyDeltas( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint8_t *pucRomAddress, uint8_t *pucDeltas, uint8_t *pucDeltaData, uint8_t ucNumDeltas );
 
+static eModuleError_t prvFlashDeltaApply( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta, uint8_t *pucData, uint32_t ulLength );
+static uint8_t		prvFlashDeltaHeaderLength( xFlashDelta_t *pxDelta );
+static eModuleError_t prvFlashDeltaHeader( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta );
+static eModuleError_t prvFlashDeltaOutput( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta, const uint8_t *pucData, uint32_t ulLength );
+static eModuleError_t prvFlashDeltaProgram( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta );
+
 /* Private Variables ----------------------------------------*/
 
 /*-----------------------------------------------------------*/
 
 eModuleError_t eFlashInit( xFlashDevice_t *pxDevice )
 {
+	xFlashCache_t *pxCache = pxDevice->pxCache;
+	if ( pxCache != NULL ) {
+		pxCache->ulPage			= FLASH_CACHE_NO_PAGE;
+		pxCache->usDirtyStart	= 0;
+		pxCache->usDirtyEnd		= 0;
+		pxCache->ulWrites		= 0;
+		pxCache->ulPrograms		= 0;
+		pxCache->ulReadHits		= 0;
+		pxCache->ulReadMisses	= 0;
+		pxCache->eDeferredError	= ERROR_NONE;
+	}
 	pxDevice->xCommandQueue = xQueueCreate( 1, sizeof( xFlashAction_t ) );
 	xTaskCreate( prvFlashInterfaceTask, pxDevice->pcName, configMINIMAL_STACK_SIZE, pxDevice, tskIDLE_PRIORITY + 2, NULL );
 	return ERROR_NONE;
@@ -221,6 +249,141 @@ eModuleError_t eFlashStartRead( xFlashDevice_t *pxDevice, uint64_t ullFlashAddre
 	return prvFlashExecuteAction( pxDevice->xCommandQueue, &xAction, xTimeout );
 }
 
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashRomDeltaStart( xFlashDelta_t *pxDelta, uint32_t ulImageId, uint64_t ullFlashAddress, uint8_t *pucRomAddress, uint32_t ulRomLength )
+{
+	xFlashDeltaProgress_t xSaved;
+
+	pvMemset( pxDelta, 0x00, sizeof( xFlashDelta_t ) );
+	pxDelta->ullFlashAddress = ullFlashAddress;
+	pxDelta->pucRomAddress   = pucRomAddress;
+	pxDelta->ulRomLength	 = ulRomLength;
+
+	if ( ( eNvmReadData( NVM_FLASH_DELTA_PROGRESS, &xSaved ) == ERROR_NONE ) && ( xSaved.ulImageId == ulImageId ) ) {
+		pxDelta->xCheckpoint = xSaved;
+		pxDelta->xProgress   = xSaved;
+		if ( xSaved.usFlags & FLASH_DELTA_FLAG_COMPLETE ) {
+			return ERROR_NO_CHANGE;
+		}
+		/* The interrupted record is parsed again, but its output up to the checkpoint is not rewritten */
+		pxDelta->ulDiscard				= xSaved.ulRecordSkip;
+		pxDelta->xProgress.ulRecordSkip = 0;
+		eLog( LOG_FLASH_DRIVER, LOG_INFO, "Delta %08X resuming at stream offset %d, image offset %d\r\n", ulImageId, xSaved.ulStreamOffset, xSaved.ulOutputOffset );
+	}
+	else {
+		pxDelta->xProgress.ulImageId = ulImageId;
+		pxDelta->xProgress.usCrc	 = 0xFFFF;
+		pxDelta->xCheckpoint		 = pxDelta->xProgress;
+	}
+	pxDelta->ulStreamPosition = pxDelta->xProgress.ulStreamOffset;
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashRomDeltaApply( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta, uint32_t ulStreamOffset, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout )
+{
+	eModuleError_t eResult, eError;
+	uint32_t	   ulApplied;
+
+	if ( pxDelta->xProgress.usFlags & FLASH_DELTA_FLAG_COMPLETE ) {
+		return ERROR_INVALID_STATE;
+	}
+	if ( ulStreamOffset > pxDelta->ulStreamPosition ) {
+		return ERROR_INVALID_ADDRESS;
+	}
+	/* Ignore data that has already been applied */
+	ulApplied = pxDelta->ulStreamPosition - ulStreamOffset;
+	if ( ulApplied >= ulLength ) {
+		return ERROR_NONE;
+	}
+	xFlashAction_t xAction = {
+		.eCommand		 = FLASH_ROM_APPLY_DELTA,
+		.ullFlashAddress = pxDelta->ullFlashAddress,
+		.pucArg1		 = (uint8_t *) pxDelta,
+		.pucArg2		 = pucData + ulApplied,
+		.pucArg3		 = NULL,
+		.ulLength		 = ulLength - ulApplied,
+		.xResponseTask   = xTaskGetCurrentTaskHandle(),
+		.peResult		 = &eResult
+	};
+	eError = prvFlashExecuteAction( pxDevice->xCommandQueue, &xAction, xTimeout );
+	if ( eError == ERROR_INVALID_CRC ) {
+		/* Image is corrupt, the next attempt must start from the beginning */
+		eNvmEraseKey( NVM_FLASH_DELTA_PROGRESS );
+		return eError;
+	}
+	/* Everything before the checkpoint has been programmed, even if a later operation failed */
+	if ( pxDelta->bCheckpointDirty ) {
+		pxDelta->bCheckpointDirty = false;
+		eResult					  = eNvmWriteData( NVM_FLASH_DELTA_PROGRESS, &pxDelta->xCheckpoint );
+		if ( eError == ERROR_NONE ) {
+			eError = eResult;
+		}
+	}
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashFlush( xFlashDevice_t *pxDevice, TickType_t xTimeout )
+{
+	eModuleError_t eResult;
+	xFlashAction_t xAction = {
+		.eCommand		 = FLASH_FLUSH,
+		.ullFlashAddress = 0x00,
+		.pucArg1		 = NULL,
+		.pucArg2		 = NULL,
+		.pucArg3		 = NULL,
+		.ulLength		 = 0x00,
+		.xResponseTask   = xTaskGetCurrentTaskHandle(),
+		.peResult		 = &eResult
+	};
+	return prvFlashExecuteAction( pxDevice->xCommandQueue, &xAction, xTimeout );
+}
+
+/*-----------------------------------------------------------*/
+
+bool bFlashWaitForRead( xFlashDevice_t *pxDevice, uint32_t ulBusyPage, uint32_t ulBusyPages, TickType_t xTimeout )
+{
+	xFlashAction_t xAction;
+	TickType_t	   xStart = xTaskGetTickCount();
+	TickType_t	   xElapsed;
+	/* Peeking wakes us as soon as any command is queued */
+	if ( xQueuePeek( pxDevice->xCommandQueue, &xAction, xTimeout ) != pdPASS ) {
+		return false;
+	}
+	if ( prvFlashReadServiceable( pxDevice, &xAction, ulBusyPage, ulBusyPages ) ) {
+		return true;
+	}
+	/* Any other command has to wait for the current operation to complete */
+	xElapsed = xTaskGetTickCount() - xStart;
+	if ( xElapsed < xTimeout ) {
+		vTaskDelay( xTimeout - xElapsed );
+	}
+	return false;
+}
+
+/*-----------------------------------------------------------*/
+
+void vFlashServiceReads( xFlashDevice_t *pxDevice, uint32_t ulBusyPage, uint32_t ulBusyPages )
+{
+	xFlashSettings_t *pxSettings = &pxDevice->xSettings;
+	xFlashAction_t	xAction;
+	eModuleError_t	eError;
+
+	while ( ( xQueuePeek( pxDevice->xCommandQueue, &xAction, 0 ) == pdPASS ) && prvFlashReadServiceable( pxDevice, &xAction, ulBusyPage, ulBusyPages ) ) {
+		xQueueReceive( pxDevice->xCommandQueue, &xAction, 0 );
+		uint32_t ulFlashPage   = ( uint32_t )( xAction.ullFlashAddress >> pxSettings->ucPageSizePower );
+		uint16_t usFlashOffset = ( uint16_t )( xAction.ullFlashAddress & pxSettings->usPageOffsetMask );
+		eLog( LOG_FLASH_DRIVER, LOG_DEBUG, "%s servicing read of page %d during busy pages %d-%d\r\n", pxDevice->pcName, ulFlashPage, ulBusyPage, ulBusyPage + ulBusyPages - 1 );
+		eError = prvFlashIteratePages( pxDevice, prvFlashIterateRead, xAction.pucArg1, ulFlashPage, usFlashOffset, xAction.ulLength );
+		*xAction.peResult = eError;
+		xTaskNotifyGive( xAction.xResponseTask );
+	}
+}
+
 /* Private Functions ----------------------------------------*/
 
 eModuleError_t prvFlashExecuteAction( QueueHandle_t xQueue, xFlashAction_t *pxAction, TickType_t xTimeout )
@@ -249,7 +412,24 @@ eModuleError_t prvFlashExecuteAction( QueueHandle_t xQueue, xFlashAction_t *pxAc
 
 static void prvFlashWaitAction( xFlashDevice_t *pxDevice, xFlashAction_t *pxAction )
 {
-	bool bPowerApplied;
+	xFlashCache_t *pxCache = pxDevice->pxCache;
+	eModuleError_t eError;
+	bool		   bPowerApplied;
+	/* Pending writes must be programmed by their deadline, and before the device sleeps */
+	while ( ( pxCache != NULL ) && ( pxCache->ulPage != FLASH_CACHE_NO_PAGE ) ) {
+		TickType_t xElapsed = xTaskGetTickCount() - pxCache->xPendingSince;
+		if ( xElapsed >= pxCache->xFlushDeadline ) {
+			/* No task is waiting on this result, hold it for the next operation */
+			eError = prvFlashCacheFlush( pxDevice );
+			if ( eError != ERROR_NONE ) {
+				pxCache->eDeferredError = eError;
+			}
+			break;
+		}
+		if ( xQueueReceive( pxDevice->xCommandQueue, pxAction, pxCache->xFlushDeadline - xElapsed ) == pdPASS ) {
+			return;
+		}
+	}
 	/* Wait for 2 seconds to see if someone wants to use the device */
 	if ( xQueueReceive( pxDevice->xCommandQueue, pxAction, pdMS_TO_TICKS( 2000 ) ) == pdPASS ) {
 		/* We received a command, return */
@@ -294,6 +474,12 @@ ATTR_NORETURN void prvFlashInterfaceTask( void *pvParameters )
 
 		eLog( LOG_FLASH_DRIVER, LOG_VERBOSE, "%s Action: %d  Addr %llu = %d.%d\r\n", pxDevice->pcName, xAction.eCommand, xAction.ullFlashAddress, ulFlashPage, usFlashOffset );
 
+		vEnergyActive( ENERGY_FLASH, true );
+		/* Only reads and writes interact with the cache, everything else requires the page buffer or clean memory */
+		if ( ( pxDevice->pxCache != NULL ) && ( xAction.eCommand != FLASH_READ ) && ( xAction.eCommand != FLASH_WRITE ) ) {
+			eError = prvFlashCacheFlush( pxDevice );
+		}
+
 		switch ( xAction.eCommand ) {
 			case FLASH_READ:
 				eError = prvFlashIteratePages( pxDevice, prvFlashIterateRead, xAction.pucArg1, ulFlashPage, usFlashOffset, xAction.ulLength );
@@ -319,10 +505,23 @@ ATTR_NORETURN void prvFlashInterfaceTask( void *pvParameters )
 			case FLASH_ROM_START_READ:
 				eError = pxDevice->pxImplementation->fnReadStart( pxDevice, ulFlashPage, usFlashOffset );
 				break;
+			case FLASH_ROM_APPLY_DELTA:
+				eError = prvFlashDeltaApply( pxDevice, (xFlashDelta_t *) xAction.pucArg1, xAction.pucArg2, xAction.ulLength );
+				break;
+			case FLASH_FLUSH:
+				/* Flush has already been run above */
+				break;
 			default:
 				configASSERT( 0 );
 		}
-		/* Return the result */
+		vEnergyActive( ENERGY_FLASH, false );
+		/* Return the result, or an earlier write failure which the caller has not seen */
+		if ( ( pxDevice->pxCache != NULL ) && ( pxDevice->pxCache->eDeferredError != ERROR_NONE ) ) {
+			if ( eError == ERROR_NONE ) {
+				eError = pxDevice->pxCache->eDeferredError;
+			}
+			pxDevice->pxCache->eDeferredError = ERROR_NONE;
+		}
 		*xAction.peResult = eError;
 		xTaskNotifyGive( xAction.xResponseTask );
 	}
@@ -371,6 +570,9 @@ static eModuleError_t prvFlashIterateRead( xFlashDevice_t *pxDevice, uint32_t ul
 		/* Nothing to do on termination */
 		return ERROR_NONE;
 	}
+	if ( pxDevice->pxCache != NULL ) {
+		return prvFlashCacheRead( pxDevice, ulFlashPage, usFlashOffset, pucOutputBuffer + ulByteIndex, usNumBytes );
+	}
 	return pxDevice->pxImplementation->fnReadSubpage( pxDevice, ulFlashPage, usFlashOffset, pucOutputBuffer + ulByteIndex, usNumBytes );
 }
 
@@ -383,11 +585,123 @@ static eModuleError_t prvFlashIterateWrite( xFlashDevice_t *pxDevice, uint32_t u
 		/* Nothing to do on termination */
 		return ERROR_NONE;
 	}
+	if ( pxDevice->pxCache != NULL ) {
+		return prvFlashCacheWrite( pxDevice, ulFlashPage, usFlashOffset, pucInputBuffer + ulByteIndex, usNumBytes );
+	}
 	return pxDevice->pxImplementation->fnWriteSubpage( pxDevice, ulFlashPage, usFlashOffset, pucInputBuffer + ulByteIndex, usNumBytes );
 }
 
 /*-----------------------------------------------------------*/
 
+static bool prvFlashReadServiceable( xFlashDevice_t *pxDevice, xFlashAction_t *pxAction, uint32_t ulBusyPage, uint32_t ulBusyPages )
+{
+	uint8_t  ucPageSizePower = pxDevice->xSettings.ucPageSizePower;
+	uint32_t ulFirstPage, ulLastPage;
+	if ( pxAction->eCommand != FLASH_READ ) {
+		return false;
+	}
+	if ( pxAction->ulLength == 0 ) {
+		return true;
+	}
+	/* Data in the busy region is undefined until the operation completes */
+	ulFirstPage = ( uint32_t )( pxAction->ullFlashAddress >> ucPageSizePower );
+	ulLastPage  = ( uint32_t )( ( pxAction->ullFlashAddress + pxAction->ulLength - 1 ) >> ucPageSizePower );
+	return ( ulLastPage < ulBusyPage ) || ( ulFirstPage >= ( ulBusyPage + ulBusyPages ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvFlashCacheWrite( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint8_t *pucData, uint16_t usNumBytes )
+{
+	xFlashCache_t *pxCache	= pxDevice->pxCache;
+	uint8_t *	  pucPage	= pxDevice->xSettings.pucPage;
+	uint16_t	   usEnd	  = usFlashOffset + usNumBytes;
+	eModuleError_t eError	 = ERROR_NONE;
+
+	pxCache->ulWrites++;
+	if ( pxCache->ulPage == ulFlashPage ) {
+		/* Only writes adjoining the pending bytes are merged, bytes in a gap may already be programmed */
+		if ( usFlashOffset == pxCache->usDirtyEnd ) {
+			pvMemcpy( pucPage + usFlashOffset, pucData, usNumBytes );
+			pxCache->usDirtyEnd = usEnd;
+			return ERROR_NONE;
+		}
+		if ( usEnd == pxCache->usDirtyStart ) {
+			pvMemcpy( pucPage + usFlashOffset, pucData, usNumBytes );
+			pxCache->usDirtyStart = usFlashOffset;
+			return ERROR_NONE;
+		}
+		/* Gaps and rewrites of pending bytes, the device needs to see both writes */
+		eError = prvFlashCacheFlush( pxDevice );
+	}
+	else if ( pxCache->ulPage != FLASH_CACHE_NO_PAGE ) {
+		/* Moving to a different page */
+		eError = prvFlashCacheFlush( pxDevice );
+	}
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	if ( usNumBytes == pxDevice->xSettings.usPageSize ) {
+		/* Full page writes gain nothing from the cache */
+		pxCache->ulPrograms++;
+		return pxDevice->pxImplementation->fnWriteSubpage( pxDevice, ulFlashPage, usFlashOffset, pucData, usNumBytes );
+	}
+	pvMemcpy( pucPage + usFlashOffset, pucData, usNumBytes );
+	pxCache->ulPage		  = ulFlashPage;
+	pxCache->usDirtyStart  = usFlashOffset;
+	pxCache->usDirtyEnd	= usEnd;
+	pxCache->xPendingSince = xTaskGetTickCount();
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvFlashCacheRead( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint8_t *pucData, uint16_t usNumBytes )
+{
+	xFlashCache_t *pxCache = pxDevice->pxCache;
+	uint16_t	   usEnd   = usFlashOffset + usNumBytes;
+	eModuleError_t eError;
+
+	if ( pxCache->ulPage == ulFlashPage ) {
+		if ( ( usFlashOffset >= pxCache->usDirtyStart ) && ( usEnd <= pxCache->usDirtyEnd ) ) {
+			pvMemcpy( pucData, pxDevice->xSettings.pucPage + usFlashOffset, usNumBytes );
+			pxCache->ulReadHits++;
+			return ERROR_NONE;
+		}
+		if ( ( usFlashOffset < pxCache->usDirtyEnd ) && ( usEnd > pxCache->usDirtyStart ) ) {
+			/* Partially pending, program the page so the device returns the complete data */
+			eError = prvFlashCacheFlush( pxDevice );
+			if ( eError != ERROR_NONE ) {
+				return eError;
+			}
+		}
+	}
+	pxCache->ulReadMisses++;
+	return pxDevice->pxImplementation->fnReadSubpage( pxDevice, ulFlashPage, usFlashOffset, pucData, usNumBytes );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvFlashCacheFlush( xFlashDevice_t *pxDevice )
+{
+	xFlashCache_t *pxCache = pxDevice->pxCache;
+	eModuleError_t eError;
+
+	if ( pxCache->ulPage == FLASH_CACHE_NO_PAGE ) {
+		return ERROR_NONE;
+	}
+	pxCache->ulPrograms++;
+	eError = pxDevice->pxImplementation->fnWriteSubpage( pxDevice, pxCache->ulPage, pxCache->usDirtyStart, pxDevice->xSettings.pucPage + pxCache->usDirtyStart, pxCache->usDirtyEnd - pxCache->usDirtyStart );
+	if ( eError != ERROR_NONE ) {
+		eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s cache flush of page %d failed %d\r\n", pxDevice->pcName, pxCache->ulPage, eError );
+	}
+	eLog( LOG_FLASH_DRIVER, LOG_VERBOSE, "%s cache: %d writes, %d programs, %d/%d read hits\r\n", pxDevice->pcName, pxCache->ulWrites, pxCache->ulPrograms, pxCache->ulReadHits, pxCache->ulReadHits + pxCache->ulReadMisses );
+	pxCache->ulPage = FLASH_CACHE_NO_PAGE;
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
 static eModuleError_t prvFlashIterateCrc( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint16_t usNumBytes, uint32_t ulByteIndex, void *pvContext )
 {
 	eModuleError_t eError;
@@ -447,7 +761,7 @@ static eModuleError_t prvFlashErase( xFlashDevice_t *pxDevice, uint32_t ulFlashP
 
 static eModuleError_t prvFlashRomCopyDeltas( xFlashDevice_t *pxDevice, uint32_t ulFlashPage, uint16_t usFlashOffset, uint8_t *pucRomAddress, uint8_t *pucDeltas, uint8_t *pucDeltaData, uint8_t ucNumDeltas )
 {
-	eModuleError_t eError;
+	eModuleError_t eError		 = ERROR_NONE;
 	uint8_t *	  pucBuffer	 = pxDevice->xSettings.pucPage;
 	uint16_t	   usPageSize	= pxDevice->xSettings.usPageSize;
 	uint16_t	   usBufferIndex = 0;
@@ -503,3 +817,218 @@ static eModuleError_t prvFlashRomCopyDeltas( xFlashDevice_t *pxDevice, uint32_t
 }
 
 /*-----------------------------------------------------------*/
+
+static eModuleError_t prvFlashDeltaApply( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta, uint8_t *pucData, uint32_t ulLength )
+{
+	xFlashSettings_t *pxSettings = &pxDevice->xSettings;
+	uint8_t *		  pucHeader  = pxDelta->pucHeader;
+	uint8_t *		  pucSource;
+	uint32_t		  ulNum;
+	eModuleError_t	eError = ERROR_NONE;
+
+	if ( ( ( pxDelta->ullFlashAddress & pxSettings->usPageOffsetMask ) != 0 ) || ( ( pxDelta->ullFlashAddress >> pxSettings->ucPageSizePower ) % pxSettings->usErasePages ) != 0 ) {
+		return ERROR_INVALID_ADDRESS;
+	}
+	while ( eError == ERROR_NONE ) {
+		pucSource = pxDelta->pucRomAddress + LE_U32_EXTRACT( pucHeader + 4 );
+		if ( pxDelta->ucHeaderLen < prvFlashDeltaHeaderLength( pxDelta ) ) {
+			if ( ulLength == 0 ) {
+				break;
+			}
+			pucHeader[pxDelta->ucHeaderLen++] = *pucData++;
+			ulLength--;
+			pxDelta->ulStreamPosition++;
+			if ( pxDelta->ucHeaderLen == prvFlashDeltaHeaderLength( pxDelta ) ) {
+				eError = prvFlashDeltaHeader( pxDevice, pxDelta );
+			}
+			continue;
+		}
+		if ( pucHeader[0] == FLASH_DELTA_END ) {
+			break;
+		}
+		/* Output that comes from the current image does not need any more input */
+		if ( pucHeader[0] == FLASH_DELTA_COPY ) {
+			ulNum				 = ( (uint32_t) pucHeader[1] * FLASH_DELTA_BLOCK_SIZE ) - pxDelta->ulRemaining;
+			eError				 = prvFlashDeltaOutput( pxDevice, pxDelta, pucSource + ulNum, pxDelta->ulRemaining );
+			pxDelta->ulRemaining = 0;
+		}
+		else if ( ( pucHeader[0] == FLASH_DELTA_PATCH ) && ( ( pxDelta->ucSkip > 0 ) || ( ( pxDelta->ucEdits == 0 ) && ( pxDelta->ucReplace == 0 ) ) ) ) {
+			/* Source bytes before the current edit, or after the final edit */
+			ulNum  = ( pxDelta->ucSkip > 0 ) ? pxDelta->ucSkip : ( FLASH_DELTA_BLOCK_SIZE - pxDelta->usBlockOffset );
+			eError = prvFlashDeltaOutput( pxDevice, pxDelta, pucSource + pxDelta->usBlockOffset, ulNum );
+			pxDelta->usBlockOffset += ulNum;
+			pxDelta->ucSkip = 0;
+		}
+		else if ( ulLength == 0 ) {
+			break;
+		}
+		/* New data, either a literal block or the replacement bytes of an edit */
+		else if ( ( pucHeader[0] == FLASH_DELTA_LITERAL ) || ( pxDelta->ucReplace > 0 ) ) {
+			ulNum  = MIN( ulLength, ( pucHeader[0] == FLASH_DELTA_LITERAL ) ? pxDelta->ulRemaining : pxDelta->ucReplace );
+			eError = prvFlashDeltaOutput( pxDevice, pxDelta, pucData, ulNum );
+			pucData += ulNum;
+			ulLength -= ulNum;
+			pxDelta->ulStreamPosition += ulNum;
+			if ( pucHeader[0] == FLASH_DELTA_LITERAL ) {
+				pxDelta->ulRemaining -= ulNum;
+			}
+			else {
+				pxDelta->ucReplace -= ulNum;
+				pxDelta->usBlockOffset += ulNum;
+			}
+		}
+		/* Edit header */
+		else {
+			pxDelta->pucEdit[pxDelta->ucEditLen++] = *pucData++;
+			ulLength--;
+			pxDelta->ulStreamPosition++;
+			if ( pxDelta->ucEditLen == sizeof( pxDelta->pucEdit ) ) {
+				pxDelta->ucEditLen = 0;
+				pxDelta->ucEdits--;
+				pxDelta->ucSkip	= pxDelta->pucEdit[0];
+				pxDelta->ucReplace = pxDelta->pucEdit[1];
+				if ( ( pxDelta->usBlockOffset + pxDelta->ucSkip + pxDelta->ucReplace ) > FLASH_DELTA_BLOCK_SIZE ) {
+					eError = ERROR_INVALID_DATA;
+				}
+			}
+		}
+		/* Record complete, later checkpoints are relative to the next record */
+		if ( ( pxDelta->ulRemaining == 0 ) &&
+			 ( ( pucHeader[0] != FLASH_DELTA_PATCH ) || ( ( pxDelta->ucEdits == 0 ) && ( pxDelta->ucReplace == 0 ) && ( pxDelta->usBlockOffset == FLASH_DELTA_BLOCK_SIZE ) ) ) ) {
+			pxDelta->ucHeaderLen			  = 0;
+			pxDelta->xProgress.ulStreamOffset = pxDelta->ulStreamPosition;
+			pxDelta->xProgress.ulRecordSkip   = 0;
+		}
+	}
+	/* Program any partial page so that the page buffer is free for other operations */
+	if ( eError == ERROR_NONE ) {
+		eError = prvFlashDeltaProgram( pxDevice, pxDelta );
+	}
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t prvFlashDeltaHeaderLength( xFlashDelta_t *pxDelta )
+{
+	/* The record type determines the length of the rest of the header */
+	if ( pxDelta->ucHeaderLen == 0 ) {
+		return 1;
+	}
+	return ( pxDelta->pucHeader[0] == FLASH_DELTA_LITERAL ) ? 4 : FLASH_DELTA_HEADER_MAX;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvFlashDeltaHeader( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta )
+{
+	uint8_t *	  pucHeader = pxDelta->pucHeader;
+	uint32_t	   ulSource  = LE_U32_EXTRACT( pucHeader + 4 );
+	eModuleError_t eError;
+
+	switch ( pucHeader[0] ) {
+		case FLASH_DELTA_COPY:
+			pxDelta->ulRemaining = (uint32_t) pucHeader[1] * FLASH_DELTA_BLOCK_SIZE;
+			if ( pxDelta->ulRemaining == 0 ) {
+				return ERROR_INVALID_DATA;
+			}
+			return ( ( ulSource <= pxDelta->ulRomLength ) && ( pxDelta->ulRemaining <= ( pxDelta->ulRomLength - ulSource ) ) ) ? ERROR_NONE : ERROR_INVALID_ADDRESS;
+		case FLASH_DELTA_LITERAL:
+			pxDelta->ulRemaining = LE_U16_EXTRACT( pucHeader + 2 );
+			return ( ( pxDelta->ulRemaining > 0 ) && ( pxDelta->ulRemaining <= FLASH_DELTA_BLOCK_SIZE ) ) ? ERROR_NONE : ERROR_INVALID_DATA;
+		case FLASH_DELTA_PATCH:
+			pxDelta->ucEdits	   = pucHeader[1];
+			pxDelta->ucEditLen	 = 0;
+			pxDelta->usBlockOffset = 0;
+			return ( ( ulSource <= pxDelta->ulRomLength ) && ( FLASH_DELTA_BLOCK_SIZE <= ( pxDelta->ulRomLength - ulSource ) ) ) ? ERROR_NONE : ERROR_INVALID_ADDRESS;
+		case FLASH_DELTA_END:
+			eError = prvFlashDeltaProgram( pxDevice, pxDelta );
+			if ( eError != ERROR_NONE ) {
+				return eError;
+			}
+			/* CRC was accumulated as the image was written, no need to read it back */
+			if ( ( pxDelta->xProgress.ulOutputOffset != LE_U32_EXTRACT( pucHeader + 4 ) ) || ( pxDelta->xProgress.usCrc != LE_U16_EXTRACT( pucHeader + 2 ) ) ) {
+				eLog( LOG_FLASH_DRIVER, LOG_ERROR, "Delta %08X invalid, %d bytes CRC %04X\r\n", pxDelta->xProgress.ulImageId, pxDelta->xProgress.ulOutputOffset, pxDelta->xProgress.usCrc );
+				return ERROR_INVALID_CRC;
+			}
+			pxDelta->xProgress.ulStreamOffset = pxDelta->ulStreamPosition;
+			pxDelta->xProgress.ulRecordSkip   = 0;
+			pxDelta->xProgress.usFlags |= FLASH_DELTA_FLAG_COMPLETE;
+			pxDelta->xCheckpoint	  = pxDelta->xProgress;
+			pxDelta->bCheckpointDirty = true;
+			eLog( LOG_FLASH_DRIVER, LOG_INFO, "Delta %08X complete, %d bytes\r\n", pxDelta->xProgress.ulImageId, pxDelta->xProgress.ulOutputOffset );
+			return ERROR_NONE;
+		default:
+			return ERROR_INVALID_DATA;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvFlashDeltaOutput( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta, const uint8_t *pucData, uint32_t ulLength )
+{
+	xFlashSettings_t *pxSettings  = &pxDevice->xSettings;
+	uint32_t		  ulEraseSize = (uint32_t) pxSettings->usErasePages << pxSettings->ucPageSizePower;
+	uint64_t		  ullAddress;
+	uint32_t		  ulNum;
+	uint16_t		  usOffset;
+	eModuleError_t	eError;
+
+	/* Skip output that was programmed before the update was interrupted */
+	ulNum = MIN( ulLength, pxDelta->ulDiscard );
+	pxDelta->ulDiscard -= ulNum;
+	pxDelta->xProgress.ulRecordSkip += ulNum;
+	pucData += ulNum;
+	ulLength -= ulNum;
+
+	while ( ulLength > 0 ) {
+		ullAddress = pxDelta->ullFlashAddress + pxDelta->xProgress.ulOutputOffset;
+		usOffset   = (uint16_t) ( ullAddress & pxSettings->usPageOffsetMask );
+		/* Entering a new erase unit, everything before this point has been programmed */
+		if ( ( pxDelta->xProgress.ulOutputOffset % ulEraseSize ) == 0 ) {
+			pxDelta->xCheckpoint	  = pxDelta->xProgress;
+			pxDelta->bCheckpointDirty = true;
+			eError					  = pxDevice->pxImplementation->fnErasePages( pxDevice, (uint32_t) ( ullAddress >> pxSettings->ucPageSizePower ), pxSettings->usErasePages );
+			if ( eError != ERROR_NONE ) {
+				return eError;
+			}
+		}
+		ulNum = MIN( ulLength, (uint32_t) ( pxSettings->usPageSize - usOffset ) );
+		pvMemcpy( pxSettings->pucPage + usOffset, pucData, ulNum );
+		vCrcStart( CRC16_CCITT, pxDelta->xProgress.usCrc );
+		pxDelta->xProgress.usCrc = (uint16_t) ulCrcCalculate( pxSettings->pucPage + usOffset, ulNum, true );
+		pxDelta->xProgress.ulOutputOffset += ulNum;
+		pxDelta->xProgress.ulRecordSkip += ulNum;
+		pxDelta->usStaged += ulNum;
+		pucData += ulNum;
+		ulLength -= ulNum;
+		if ( ( usOffset + ulNum ) == pxSettings->usPageSize ) {
+			eError = prvFlashDeltaProgram( pxDevice, pxDelta );
+			if ( eError != ERROR_NONE ) {
+				return eError;
+			}
+		}
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvFlashDeltaProgram( xFlashDevice_t *pxDevice, xFlashDelta_t *pxDelta )
+{
+	xFlashSettings_t *pxSettings = &pxDevice->xSettings;
+	uint64_t		  ullStart;
+	uint16_t		  usOffset, usStaged;
+
+	if ( pxDelta->usStaged == 0 ) {
+		return ERROR_NONE;
+	}
+	/* Staged bytes always end at the current output offset, within a single page */
+	usStaged		  = pxDelta->usStaged;
+	pxDelta->usStaged = 0;
+	ullStart		  = pxDelta->ullFlashAddress + pxDelta->xProgress.ulOutputOffset - usStaged;
+	usOffset		  = (uint16_t) ( ullStart & pxSettings->usPageOffsetMask );
+	return pxDevice->pxImplementation->fnWriteSubpage( pxDevice, (uint32_t) ( ullStart >> pxSettings->ucPageSizePower ), usOffset, pxSettings->pucPage + usOffset, usStaged );
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,696 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "flash_kv.h"
+
+#include "compiler_intrinsics.h"
+#include "crc.h"
+#include "csiro_math.h"
+#include "log.h"
+#include "memory_operations.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+#define KV_SECTOR_MAGIC         0x4B56
+
+#define KV_FLAG_COMMIT          0x8000
+#define KV_LENGTH_MASK          0x7FFF
+
+#define KV_SEQUENCE_FREE        0
+
+#define KV_TIMEOUT              pdMS_TO_TICKS( 1000 )
+
+#define KV_RECORD_SIZE( len )   ( sizeof( xKvRecordHeader_t ) + ROUND_UP( ( len ), 4 ) )
+
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/**@brief Header stored at the start of every sector in use */
+typedef struct xKvSectorHeader_t
+{
+	uint32_t ulSequence; /**< Incremented every time a sector is opened, orders the log */
+	uint16_t usMagic;	/**< KV_SECTOR_MAGIC */
+	uint16_t usCrc;		 /**< CRC16_CCITT over the preceding fields */
+} ATTR_PACKED xKvSectorHeader_t;
+
+/**@brief Header stored before every value */
+typedef struct xKvRecordHeader_t
+{
+	uint16_t usKey;	/**< Key being updated */
+	uint16_t usLength; /**< Length of the value, KV_FLAG_COMMIT set on the final record of a commit */
+	uint16_t usCommit; /**< Commit identifier, shared by all records of a commit */
+	uint16_t usCrc;	/**< CRC16_CCITT over the preceding fields and the value */
+} ATTR_PACKED xKvRecordHeader_t;
+
+/* Function Declarations ------------------------------------*/
+
+static uint64_t			prvAddress( xFlashKv_t *pxKv, uint16_t usSector, uint32_t ulOffset );
+static uint16_t			prvRecordCrc( xKvRecordHeader_t *pxHeader, const uint8_t *pucData );
+static bool				prvErased( xFlashKv_t *pxKv, const uint8_t *pucData, uint32_t ulLength );
+static uint16_t			prvFreeSectors( xFlashKv_t *pxKv );
+static xFlashKvEntry_t *prvFind( xFlashKv_t *pxKv, uint16_t usKey );
+static void				prvIndexUpdate( xFlashKv_t *pxKv, uint16_t usKey, uint16_t usLength, uint32_t ulAddress, const void *pvData );
+static void				prvScanSector( xFlashKv_t *pxKv, uint16_t usSector );
+static void				prvApply( xFlashKv_t *pxKv, uint32_t ulAddress );
+static eModuleError_t   prvEraseSector( xFlashKv_t *pxKv, uint16_t usSector );
+static eModuleError_t   prvOpenSector( xFlashKv_t *pxKv );
+static eModuleError_t   prvAppend( xFlashKv_t *pxKv, uint16_t usKey, uint16_t usLength, uint16_t usCommit, const void *pvData, uint32_t *pulAddress );
+static eModuleError_t   prvCollectOldest( xFlashKv_t *pxKv );
+static eModuleError_t   prvReserve( xFlashKv_t *pxKv, uint32_t ulBytes );
+static eModuleError_t   prvCommit( xFlashKv_t *pxKv, const xFlashKvItem_t *pxItems, uint8_t ucNumItems );
+
+/* Private Variables ----------------------------------------*/
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashKvInit( xFlashKv_t *pxKv )
+{
+	xFlashSettings_t *pxSettings = &pxKv->pxDevice->xSettings;
+	xKvSectorHeader_t xHeader;
+	uint32_t		  ulPrevious, ulNext, ulOffset;
+	uint16_t		  usSector, usNext;
+
+	pxKv->ulSectorSize = (uint32_t) pxSettings->usErasePages * pxSettings->usPageSize;
+	if ( ( pxKv->usNumSectors < 3 ) || ( pxKv->usMaxKeys == 0 ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( ( pxKv->ulFirstSector + pxKv->usNumSectors ) * pxSettings->usErasePages > pxSettings->ulNumPages ) {
+		return ERROR_INVALID_DATA;
+	}
+	/* Garbage collection must always be able to relocate the largest record */
+	if ( pxKv->ulSectorSize < sizeof( xKvSectorHeader_t ) + KV_RECORD_SIZE( FLASH_KV_MAX_LENGTH ) ) {
+		return ERROR_INVALID_DATA;
+	}
+
+	pxKv->xAccess	 = xSemaphoreCreateMutex();
+	pxKv->pulSequence = pvPortMalloc( pxKv->usNumSectors * sizeof( uint32_t ) );
+	pxKv->pxIndex	 = pvPortMalloc( pxKv->usMaxKeys * sizeof( xFlashKvEntry_t ) );
+	pxKv->pucRecord   = pvPortMalloc( KV_RECORD_SIZE( FLASH_KV_MAX_LENGTH ) );
+	configASSERT( pxKv->xAccess && pxKv->pulSequence && pxKv->pxIndex && pxKv->pucRecord );
+	pxKv->ulSequence = KV_SEQUENCE_FREE;
+	pxKv->usNumKeys  = 0;
+	pxKv->usCommit   = 0;
+	pvMemset( &pxKv->xStats, 0x00, sizeof( xFlashKvStats_t ) );
+
+	/* Find the sectors that are part of the log */
+	for ( usSector = 0; usSector < pxKv->usNumSectors; usSector++ ) {
+		pxKv->pulSequence[usSector] = KV_SEQUENCE_FREE;
+		eFlashRead( pxKv->pxDevice, prvAddress( pxKv, usSector, 0 ), (uint8_t *) &xHeader, sizeof( xKvSectorHeader_t ), KV_TIMEOUT );
+		vCrcStart( CRC16_CCITT, 0xFFFF );
+		if ( ( xHeader.usMagic == KV_SECTOR_MAGIC ) && ( xHeader.ulSequence != KV_SEQUENCE_FREE ) &&
+			 ( xHeader.usCrc == (uint16_t) ulCrcCalculate( (uint8_t *) &xHeader, sizeof( xKvSectorHeader_t ) - sizeof( xHeader.usCrc ), true ) ) ) {
+			pxKv->pulSequence[usSector] = xHeader.ulSequence;
+			if ( xHeader.ulSequence > pxKv->ulSequence ) {
+				pxKv->ulSequence = xHeader.ulSequence;
+				pxKv->usHead	 = usSector;
+			}
+			continue;
+		}
+		/* Free sectors must be fully erased, a reset during an erase can leave a sector in any state */
+		for ( ulOffset = 0; ulOffset < pxKv->ulSectorSize; ulOffset += FLASH_KV_MAX_LENGTH ) {
+			eFlashRead( pxKv->pxDevice, prvAddress( pxKv, usSector, ulOffset ), pxKv->pucRecord, MIN( FLASH_KV_MAX_LENGTH, pxKv->ulSectorSize - ulOffset ), KV_TIMEOUT );
+			if ( !prvErased( pxKv, pxKv->pucRecord, MIN( FLASH_KV_MAX_LENGTH, pxKv->ulSectorSize - ulOffset ) ) ) {
+				prvEraseSector( pxKv, usSector );
+				break;
+			}
+		}
+	}
+
+	if ( pxKv->ulSequence == KV_SEQUENCE_FREE ) {
+		pxKv->usHead = pxKv->usNumSectors - 1;
+		prvOpenSector( pxKv );
+	}
+	else {
+		/* Replay the log from the oldest sector */
+		ulPrevious = KV_SEQUENCE_FREE;
+		for ( ;; ) {
+			ulNext = UINT32_MAX;
+			usNext = pxKv->usNumSectors;
+			for ( usSector = 0; usSector < pxKv->usNumSectors; usSector++ ) {
+				if ( ( pxKv->pulSequence[usSector] > ulPrevious ) && ( pxKv->pulSequence[usSector] <= ulNext ) ) {
+					ulNext = pxKv->pulSequence[usSector];
+					usNext = usSector;
+				}
+			}
+			if ( usNext == pxKv->usNumSectors ) {
+				break;
+			}
+			prvScanSector( pxKv, usNext );
+			ulPrevious = ulNext;
+		}
+		/* An interrupted program can leave a record with an erased header but partially programmed contents */
+		ulOffset = MIN( KV_RECORD_SIZE( FLASH_KV_MAX_LENGTH ), pxKv->ulSectorSize - pxKv->ulHeadOffset );
+		eFlashRead( pxKv->pxDevice, prvAddress( pxKv, pxKv->usHead, pxKv->ulHeadOffset ), pxKv->pucRecord, ulOffset, KV_TIMEOUT );
+		if ( !prvErased( pxKv, pxKv->pucRecord, ulOffset ) ) {
+			pxKv->ulHeadOffset = pxKv->ulSectorSize;
+		}
+	}
+
+	eLog( LOG_FLASH_DRIVER, LOG_INFO, "%s kv: %d keys, %d free sectors, %d discarded records\r\n", pxKv->pxDevice->pcName, pxKv->usNumKeys, prvFreeSectors( pxKv ), pxKv->xStats.ulDiscarded );
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashKvRead( xFlashKv_t *pxKv, uint16_t usKey, void *pvData, uint16_t usMaxLength, uint16_t *pusLength )
+{
+	eModuleError_t   eError = ERROR_NONE;
+	xFlashKvEntry_t *pxEntry;
+
+	xSemaphoreTake( pxKv->xAccess, portMAX_DELAY );
+	pxEntry = prvFind( pxKv, usKey );
+	if ( pxEntry == NULL ) {
+		eError = ERROR_INVALID_ADDRESS;
+	}
+	else if ( pxEntry->usLength > usMaxLength ) {
+		eError = ERROR_DATA_TOO_LARGE;
+	}
+	else if ( pxEntry->usLength == sizeof( uint32_t ) ) {
+		/* Counter sized values are always cached, and may be newer than flash */
+		pvMemcpy( pvData, &pxEntry->ulCounter, sizeof( uint32_t ) );
+	}
+	else {
+		eError = eFlashRead( pxKv->pxDevice, prvAddress( pxKv, 0, pxEntry->ulAddress + sizeof( xKvRecordHeader_t ) ), pvData, pxEntry->usLength, KV_TIMEOUT );
+	}
+	if ( ( pxEntry != NULL ) && ( pusLength != NULL ) ) {
+		*pusLength = pxEntry->usLength;
+	}
+	xSemaphoreGive( pxKv->xAccess );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashKvWrite( xFlashKv_t *pxKv, uint16_t usKey, const void *pvData, uint16_t usLength )
+{
+	xFlashKvItem_t xItem = { .usKey = usKey, .usLength = usLength, .pvData = pvData };
+	return eFlashKvCommit( pxKv, &xItem, 1 );
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashKvCommit( xFlashKv_t *pxKv, const xFlashKvItem_t *pxItems, uint8_t ucNumItems )
+{
+	eModuleError_t eError;
+
+	if ( ( ucNumItems == 0 ) || ( ucNumItems > FLASH_KV_MAX_COMMIT ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	for ( uint8_t i = 0; i < ucNumItems; i++ ) {
+		if ( ( pxItems[i].usKey > FLASH_KV_KEY_MAX ) || ( pxItems[i].usLength > FLASH_KV_MAX_LENGTH ) || ( ( pxItems[i].usLength > 0 ) && ( pxItems[i].pvData == NULL ) ) ) {
+			return ERROR_INVALID_DATA;
+		}
+	}
+
+	xSemaphoreTake( pxKv->xAccess, portMAX_DELAY );
+	eError = prvCommit( pxKv, pxItems, ucNumItems );
+	xSemaphoreGive( pxKv->xAccess );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashKvIncrement( xFlashKv_t *pxKv, uint16_t usKey, uint32_t *pulNewValue )
+{
+	eModuleError_t   eError = ERROR_NONE;
+	xFlashKvEntry_t *pxEntry;
+	xFlashKvItem_t   xItem;
+	uint32_t		 ulValue;
+
+	if ( usKey > FLASH_KV_KEY_MAX ) {
+		return ERROR_INVALID_DATA;
+	}
+
+	xSemaphoreTake( pxKv->xAccess, portMAX_DELAY );
+	pxEntry = prvFind( pxKv, usKey );
+	if ( pxEntry == NULL ) {
+		if ( pxKv->usNumKeys == pxKv->usMaxKeys ) {
+			xSemaphoreGive( pxKv->xAccess );
+			return ERROR_DEVICE_FULL;
+		}
+		/* New counters only exist in RAM until their first write back */
+		pxEntry			   = &pxKv->pxIndex[pxKv->usNumKeys++];
+		pxEntry->usKey	 = usKey;
+		pxEntry->usLength  = sizeof( uint32_t );
+		pxEntry->ulAddress = FLASH_KV_NO_ADDRESS;
+		pxEntry->ulCounter = 0;
+		pxEntry->usDirty   = 0;
+	}
+	else if ( pxEntry->usLength != sizeof( uint32_t ) ) {
+		xSemaphoreGive( pxKv->xAccess );
+		return ERROR_INVALID_DATA;
+	}
+
+	ulValue = ++pxEntry->ulCounter;
+	if ( ++pxEntry->usDirty >= pxKv->usCounterWriteback ) {
+		xItem.usKey	= usKey;
+		xItem.usLength = sizeof( uint32_t );
+		xItem.pvData   = &ulValue;
+		eError		   = prvCommit( pxKv, &xItem, 1 );
+	}
+	else {
+		pxKv->xStats.ulCached++;
+	}
+	xSemaphoreGive( pxKv->xAccess );
+
+	if ( pulNewValue != NULL ) {
+		*pulNewValue = ulValue;
+	}
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashKvFlush( xFlashKv_t *pxKv )
+{
+	eModuleError_t eError = ERROR_NONE;
+	xFlashKvItem_t pxItems[FLASH_KV_MAX_COMMIT];
+	uint32_t	   pulValues[FLASH_KV_MAX_COMMIT];
+	uint8_t		   ucNumItems;
+	uint16_t	   i = 0;
+
+	xSemaphoreTake( pxKv->xAccess, portMAX_DELAY );
+	/* Dirty counters are written back in as few commits as possible */
+	while ( ( i < pxKv->usNumKeys ) && ( eError == ERROR_NONE ) ) {
+		ucNumItems = 0;
+		for ( ; ( i < pxKv->usNumKeys ) && ( ucNumItems < FLASH_KV_MAX_COMMIT ); i++ ) {
+			if ( pxKv->pxIndex[i].usDirty == 0 ) {
+				continue;
+			}
+			pulValues[ucNumItems]		   = pxKv->pxIndex[i].ulCounter;
+			pxItems[ucNumItems].usKey	= pxKv->pxIndex[i].usKey;
+			pxItems[ucNumItems].usLength = sizeof( uint32_t );
+			pxItems[ucNumItems].pvData   = &pulValues[ucNumItems];
+			ucNumItems++;
+		}
+		if ( ucNumItems > 0 ) {
+			eError = prvCommit( pxKv, pxItems, ucNumItems );
+		}
+	}
+	xSemaphoreGive( pxKv->xAccess );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashKvCollect( xFlashKv_t *pxKv, uint16_t usMinFree )
+{
+	eModuleError_t eError = ERROR_NONE;
+
+	xSemaphoreTake( pxKv->xAccess, portMAX_DELAY );
+	if ( prvFreeSectors( pxKv ) < usMinFree ) {
+		eError = prvCollectOldest( pxKv );
+	}
+	xSemaphoreGive( pxKv->xAccess );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashKvErase( xFlashKv_t *pxKv )
+{
+	eModuleError_t eError = ERROR_NONE;
+
+	xSemaphoreTake( pxKv->xAccess, portMAX_DELAY );
+	for ( uint16_t usSector = 0; usSector < pxKv->usNumSectors; usSector++ ) {
+		if ( pxKv->pulSequence[usSector] != KV_SEQUENCE_FREE ) {
+			eError = prvEraseSector( pxKv, usSector );
+			if ( eError != ERROR_NONE ) {
+				break;
+			}
+		}
+	}
+	pxKv->usNumKeys = 0;
+	if ( eError == ERROR_NONE ) {
+		eError = prvOpenSector( pxKv );
+	}
+	xSemaphoreGive( pxKv->xAccess );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+void vFlashKvStats( xFlashKv_t *pxKv, xFlashKvStats_t *pxStats )
+{
+	uint16_t usFree;
+
+	xSemaphoreTake( pxKv->xAccess, portMAX_DELAY );
+	usFree						= prvFreeSectors( pxKv );
+	pxKv->xStats.usKeys			= pxKv->usNumKeys;
+	pxKv->xStats.ulLiveBytes	= 0;
+	pxKv->xStats.ulFreeBytes	= pxKv->ulSectorSize - pxKv->ulHeadOffset;
+	for ( uint16_t i = 0; i < pxKv->usNumKeys; i++ ) {
+		if ( pxKv->pxIndex[i].ulAddress != FLASH_KV_NO_ADDRESS ) {
+			pxKv->xStats.ulLiveBytes += KV_RECORD_SIZE( pxKv->pxIndex[i].usLength );
+		}
+	}
+	/* The final free sector is reserved for garbage collection */
+	if ( usFree > 1 ) {
+		pxKv->xStats.ulFreeBytes += ( usFree - 1 ) * ( pxKv->ulSectorSize - sizeof( xKvSectorHeader_t ) );
+	}
+	*pxStats = pxKv->xStats;
+	xSemaphoreGive( pxKv->xAccess );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvAddress( xFlashKv_t *pxKv, uint16_t usSector, uint32_t ulOffset )
+{
+	return ( (uint64_t) ( pxKv->ulFirstSector + usSector ) * pxKv->ulSectorSize ) + ulOffset;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvRecordCrc( xKvRecordHeader_t *pxHeader, const uint8_t *pucData )
+{
+	vCrcStart( CRC16_CCITT, 0xFFFF );
+	ulCrcCalculate( (uint8_t *) pxHeader, sizeof( xKvRecordHeader_t ) - sizeof( pxHeader->usCrc ), false );
+	return (uint16_t) ulCrcCalculate( (uint8_t *) pucData, pxHeader->usLength & KV_LENGTH_MASK, true );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvErased( xFlashKv_t *pxKv, const uint8_t *pucData, uint32_t ulLength )
+{
+	for ( uint32_t i = 0; i < ulLength; i++ ) {
+		if ( pucData[i] != pxKv->pxDevice->xSettings.ucEraseByte ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvFreeSectors( xFlashKv_t *pxKv )
+{
+	uint16_t usFree = 0;
+	for ( uint16_t usSector = 0; usSector < pxKv->usNumSectors; usSector++ ) {
+		if ( pxKv->pulSequence[usSector] == KV_SEQUENCE_FREE ) {
+			usFree++;
+		}
+	}
+	return usFree;
+}
+
+/*-----------------------------------------------------------*/
+
+static xFlashKvEntry_t *prvFind( xFlashKv_t *pxKv, uint16_t usKey )
+{
+	for ( uint16_t i = 0; i < pxKv->usNumKeys; i++ ) {
+		if ( pxKv->pxIndex[i].usKey == usKey ) {
+			return &pxKv->pxIndex[i];
+		}
+	}
+	return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvIndexUpdate( xFlashKv_t *pxKv, uint16_t usKey, uint16_t usLength, uint32_t ulAddress, const void *pvData )
+{
+	xFlashKvEntry_t *pxEntry = prvFind( pxKv, usKey );
+
+	if ( usLength == 0 ) {
+		/* Deleted keys are removed by moving the final entry into their slot */
+		if ( pxEntry != NULL ) {
+			*pxEntry = pxKv->pxIndex[--pxKv->usNumKeys];
+		}
+		return;
+	}
+	if ( pxEntry == NULL ) {
+		if ( pxKv->usNumKeys == pxKv->usMaxKeys ) {
+			eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s kv: index full, key %d dropped\r\n", pxKv->pxDevice->pcName, usKey );
+			return;
+		}
+		pxEntry		   = &pxKv->pxIndex[pxKv->usNumKeys++];
+		pxEntry->usKey = usKey;
+	}
+	pxEntry->usLength  = usLength;
+	pxEntry->ulAddress = ulAddress;
+	pxEntry->usDirty   = 0;
+	if ( usLength == sizeof( uint32_t ) ) {
+		pvMemcpy( &pxEntry->ulCounter, pvData, sizeof( uint32_t ) );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvScanSector( xFlashKv_t *pxKv, uint16_t usSector )
+{
+	xKvRecordHeader_t xHeader;
+	uint32_t		  pulPending[FLASH_KV_MAX_COMMIT];
+	uint8_t			  ucPending = 0;
+	uint16_t		  usPendingCommit = 0;
+	uint32_t		  ulOffset		  = sizeof( xKvSectorHeader_t );
+	uint32_t		  ulSize;
+	uint16_t		  usLength;
+	bool			  bClean = true;
+
+	while ( ulOffset + sizeof( xKvRecordHeader_t ) <= pxKv->ulSectorSize ) {
+		eFlashRead( pxKv->pxDevice, prvAddress( pxKv, usSector, ulOffset ), (uint8_t *) &xHeader, sizeof( xKvRecordHeader_t ), KV_TIMEOUT );
+		if ( prvErased( pxKv, (uint8_t *) &xHeader, sizeof( xKvRecordHeader_t ) ) ) {
+			break;
+		}
+		usLength = xHeader.usLength & KV_LENGTH_MASK;
+		ulSize   = KV_RECORD_SIZE( usLength );
+		/* A corrupt length leaves no way to find the next record */
+		if ( ( usLength > FLASH_KV_MAX_LENGTH ) || ( ulOffset + ulSize > pxKv->ulSectorSize ) ) {
+			pxKv->xStats.ulDiscarded += ucPending + 1;
+			ucPending = 0;
+			bClean	= false;
+			ulOffset  = pxKv->ulSectorSize;
+			break;
+		}
+		eFlashRead( pxKv->pxDevice, prvAddress( pxKv, usSector, ulOffset + sizeof( xKvRecordHeader_t ) ), pxKv->pucRecord, usLength, KV_TIMEOUT );
+		bClean = ( xHeader.usKey <= FLASH_KV_KEY_MAX ) && ( xHeader.usCrc == prvRecordCrc( &xHeader, pxKv->pucRecord ) );
+		/* Records of a commit that never completed are followed by a record with a different identifier */
+		if ( !bClean || ( ( ucPending > 0 ) && ( xHeader.usCommit != usPendingCommit ) ) || ( ucPending == FLASH_KV_MAX_COMMIT ) ) {
+			pxKv->xStats.ulDiscarded += ucPending;
+			ucPending = 0;
+		}
+		if ( bClean ) {
+			pulPending[ucPending++] = ( usSector * pxKv->ulSectorSize ) + ulOffset;
+			usPendingCommit			= xHeader.usCommit;
+			pxKv->usCommit			= xHeader.usCommit + 1;
+			if ( xHeader.usLength & KV_FLAG_COMMIT ) {
+				for ( uint8_t i = 0; i < ucPending; i++ ) {
+					prvApply( pxKv, pulPending[i] );
+				}
+				ucPending = 0;
+			}
+		}
+		else {
+			pxKv->xStats.ulDiscarded++;
+		}
+		ulOffset += ulSize;
+	}
+	pxKv->xStats.ulDiscarded += ucPending;
+
+	if ( usSector == pxKv->usHead ) {
+		/* Never append after a record that was interrupted part way through programming */
+		pxKv->ulHeadOffset = bClean ? ulOffset : pxKv->ulSectorSize;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvApply( xFlashKv_t *pxKv, uint32_t ulAddress )
+{
+	xKvRecordHeader_t xHeader;
+	uint32_t		  ulValue = 0;
+
+	eFlashRead( pxKv->pxDevice, prvAddress( pxKv, 0, ulAddress ), (uint8_t *) &xHeader, sizeof( xKvRecordHeader_t ), KV_TIMEOUT );
+	xHeader.usLength &= KV_LENGTH_MASK;
+	if ( xHeader.usLength == sizeof( uint32_t ) ) {
+		eFlashRead( pxKv->pxDevice, prvAddress( pxKv, 0, ulAddress + sizeof( xKvRecordHeader_t ) ), (uint8_t *) &ulValue, sizeof( uint32_t ), KV_TIMEOUT );
+	}
+	prvIndexUpdate( pxKv, xHeader.usKey, xHeader.usLength, ulAddress, &ulValue );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvEraseSector( xFlashKv_t *pxKv, uint16_t usSector )
+{
+	pxKv->pulSequence[usSector] = KV_SEQUENCE_FREE;
+	pxKv->xStats.ulErases++;
+	return eFlashErase( pxKv->pxDevice, prvAddress( pxKv, usSector, 0 ), pxKv->ulSectorSize, KV_TIMEOUT );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvOpenSector( xFlashKv_t *pxKv )
+{
+	xKvSectorHeader_t xHeader;
+	uint16_t		  usSector = pxKv->usHead;
+
+	/* Sectors are used in order so that wear is spread evenly */
+	do {
+		usSector = ( usSector + 1 ) % pxKv->usNumSectors;
+		if ( usSector == pxKv->usHead ) {
+			return ERROR_DEVICE_FULL;
+		}
+	} while ( pxKv->pulSequence[usSector] != KV_SEQUENCE_FREE );
+
+	xHeader.ulSequence = ++pxKv->ulSequence;
+	xHeader.usMagic	= KV_SECTOR_MAGIC;
+	vCrcStart( CRC16_CCITT, 0xFFFF );
+	xHeader.usCrc = (uint16_t) ulCrcCalculate( (uint8_t *) &xHeader, sizeof( xKvSectorHeader_t ) - sizeof( xHeader.usCrc ), true );
+
+	pxKv->pulSequence[usSector] = xHeader.ulSequence;
+	pxKv->usHead				= usSector;
+	pxKv->ulHeadOffset			= sizeof( xKvSectorHeader_t );
+	pxKv->xStats.ulBytesWritten += sizeof( xKvSectorHeader_t );
+	return eFlashWrite( pxKv->pxDevice, prvAddress( pxKv, usSector, 0 ), (uint8_t *) &xHeader, sizeof( xKvSectorHeader_t ), KV_TIMEOUT );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvAppend( xFlashKv_t *pxKv, uint16_t usKey, uint16_t usLength, uint16_t usCommit, const void *pvData, uint32_t *pulAddress )
+{
+	xKvRecordHeader_t *pxHeader = (xKvRecordHeader_t *) pxKv->pucRecord;
+	uint8_t *		   pucValue = pxKv->pucRecord + sizeof( xKvRecordHeader_t );
+	uint16_t		   usSize   = KV_RECORD_SIZE( usLength & KV_LENGTH_MASK );
+
+	/* Relocated values are already in place */
+	if ( pvData != pucValue ) {
+		pvMemcpy( pucValue, pvData, usLength & KV_LENGTH_MASK );
+	}
+	pvMemset( pucValue + ( usLength & KV_LENGTH_MASK ), pxKv->pxDevice->xSettings.ucEraseByte, usSize - sizeof( xKvRecordHeader_t ) - ( usLength & KV_LENGTH_MASK ) );
+	pxHeader->usKey	= usKey;
+	pxHeader->usLength = usLength;
+	pxHeader->usCommit = usCommit;
+	pxHeader->usCrc	= prvRecordCrc( pxHeader, pucValue );
+
+	*pulAddress = ( pxKv->usHead * pxKv->ulSectorSize ) + pxKv->ulHeadOffset;
+	pxKv->ulHeadOffset += usSize;
+	pxKv->xStats.ulRecords++;
+	pxKv->xStats.ulBytesWritten += usSize;
+	return eFlashWrite( pxKv->pxDevice, prvAddress( pxKv, 0, *pulAddress ), pxKv->pucRecord, usSize, KV_TIMEOUT );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvCollectOldest( xFlashKv_t *pxKv )
+{
+	eModuleError_t   eError;
+	xFlashKvEntry_t *pxEntry;
+	uint32_t		 ulOldest = UINT32_MAX;
+	uint16_t		 usOldest = pxKv->usHead;
+	uint16_t		 usSector, usLength;
+
+	for ( usSector = 0; usSector < pxKv->usNumSectors; usSector++ ) {
+		if ( ( pxKv->pulSequence[usSector] != KV_SEQUENCE_FREE ) && ( pxKv->pulSequence[usSector] < ulOldest ) ) {
+			ulOldest = pxKv->pulSequence[usSector];
+			usOldest = usSector;
+		}
+	}
+	if ( usOldest == pxKv->usHead ) {
+		return ERROR_DEVICE_FULL;
+	}
+
+	/* Copy live records to the head of the log, before the original is erased */
+	for ( uint16_t i = 0; i < pxKv->usNumKeys; i++ ) {
+		pxEntry = &pxKv->pxIndex[i];
+		if ( ( pxEntry->ulAddress == FLASH_KV_NO_ADDRESS ) || ( ( pxEntry->ulAddress / pxKv->ulSectorSize ) != usOldest ) ) {
+			continue;
+		}
+		usLength = pxEntry->usLength;
+		if ( pxKv->ulHeadOffset + KV_RECORD_SIZE( usLength ) > pxKv->ulSectorSize ) {
+			/* Live records from a single sector always fit in the reserved sector */
+			eError = prvOpenSector( pxKv );
+			if ( eError != ERROR_NONE ) {
+				return eError;
+			}
+		}
+		eError = eFlashRead( pxKv->pxDevice, prvAddress( pxKv, 0, pxEntry->ulAddress + sizeof( xKvRecordHeader_t ) ), pxKv->pucRecord + sizeof( xKvRecordHeader_t ), usLength, KV_TIMEOUT );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+		eError = prvAppend( pxKv, pxEntry->usKey, usLength | KV_FLAG_COMMIT, pxKv->usCommit++, pxKv->pucRecord + sizeof( xKvRecordHeader_t ), &pxEntry->ulAddress );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+		pxKv->xStats.ulRelocated++;
+	}
+	return prvEraseSector( pxKv, usOldest );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvReserve( xFlashKv_t *pxKv, uint32_t ulBytes )
+{
+	eModuleError_t eError;
+	uint16_t	   usCollections = 0;
+
+	while ( pxKv->ulHeadOffset + ulBytes > pxKv->ulSectorSize ) {
+		/* One free sector is held back so that collection can always make progress */
+		if ( prvFreeSectors( pxKv ) > 1 ) {
+			eError = prvOpenSector( pxKv );
+		}
+		else if ( usCollections++ < pxKv->usNumSectors ) {
+			eError = prvCollectOldest( pxKv );
+		}
+		else {
+			/* Every sector has been collected without freeing enough space */
+			eError = ERROR_DEVICE_FULL;
+		}
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvCommit( xFlashKv_t *pxKv, const xFlashKvItem_t *pxItems, uint8_t ucNumItems )
+{
+	eModuleError_t eError;
+	uint32_t	   pulAddress[FLASH_KV_MAX_COMMIT];
+	uint32_t	   ulBytes   = 0;
+	uint16_t	   usNewKeys = 0;
+	uint16_t	   usCommit  = pxKv->usCommit++;
+	uint16_t	   usLength;
+
+	for ( uint8_t i = 0; i < ucNumItems; i++ ) {
+		ulBytes += KV_RECORD_SIZE( pxItems[i].usLength );
+		if ( ( pxItems[i].usLength > 0 ) && ( prvFind( pxKv, pxItems[i].usKey ) == NULL ) ) {
+			usNewKeys++;
+		}
+	}
+	/* Commits never span sectors, and must not partially fail due to a full index */
+	if ( ulBytes > pxKv->ulSectorSize - sizeof( xKvSectorHeader_t ) ) {
+		return ERROR_DATA_TOO_LARGE;
+	}
+	if ( pxKv->usNumKeys + usNewKeys > pxKv->usMaxKeys ) {
+		return ERROR_DEVICE_FULL;
+	}
+
+	eError = prvReserve( pxKv, ulBytes );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	for ( uint8_t i = 0; i < ucNumItems; i++ ) {
+		usLength = pxItems[i].usLength | ( ( i == ( ucNumItems - 1 ) ) ? KV_FLAG_COMMIT : 0 );
+		eError   = prvAppend( pxKv, pxItems[i].usKey, usLength, usCommit, pxItems[i].pvData, &pulAddress[i] );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+	}
+	/* The commit is only visible once the final record has been written */
+	for ( uint8_t i = 0; i < ucNumItems; i++ ) {
+		prvIndexUpdate( pxKv, pxItems[i].usKey, pxItems[i].usLength, pulAddress[i], pxItems[i].pvData );
+	}
+	pxKv->xStats.ulCommits++;
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
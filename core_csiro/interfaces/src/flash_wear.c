@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "flash_wear.h"
+
+#include "compiler_intrinsics.h"
+#include "crc.h"
+#include "csiro_math.h"
+#include "log.h"
+#include "memory_operations.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+#define WEAR_HEADER_MAGIC       0x5745
+#define WEAR_HEADER_RETIRED     0x0000
+
+#define WEAR_OWNER_FREE         UINT16_MAX
+#define WEAR_OWNER_BAD          ( UINT16_MAX - 1 )
+
+#define WEAR_COUNT_UNKNOWN      UINT32_MAX
+
+#define WEAR_TIMEOUT            pdMS_TO_TICKS( 1000 )
+
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/**@brief Header stored in the first page of every physical sector */
+typedef struct xWearHeader_t
+{
+	uint16_t usMagic;	  /**< WEAR_HEADER_MAGIC, or WEAR_HEADER_RETIRED for bad sectors */
+	uint16_t usLogical;	/**< Logical sector stored in this physical sector */
+	uint32_t ulEraseCount; /**< Erase count of this physical sector */
+	uint32_t ulSequence;   /**< Incremented on every header write, newest claim on a logical sector wins */
+	uint16_t usCrc;		   /**< CRC16_CCITT over the preceding fields */
+} ATTR_PACKED xWearHeader_t;
+
+/* Function Declarations ------------------------------------*/
+
+static uint64_t		  prvPageAddress( xFlashWear_t *pxWear, uint16_t usPhysical, uint32_t ulPage );
+static uint16_t		  prvHeaderCrc( xWearHeader_t *pxHeader );
+static bool			  prvPageErased( xFlashWear_t *pxWear );
+static eModuleError_t prvWriteHeader( xFlashWear_t *pxWear, uint16_t usPhysical, uint16_t usLogical );
+static void			  prvRetire( xFlashWear_t *pxWear, uint16_t usPhysical );
+static uint16_t		  prvFindFree( xFlashWear_t *pxWear, bool bMostWorn );
+static eModuleError_t prvEraseFree( xFlashWear_t *pxWear, bool bMostWorn, uint16_t *pusPhysical );
+static eModuleError_t prvRelocate( xFlashWear_t *pxWear, uint16_t usLogical, uint32_t ulSkipPage, bool bMostWorn );
+static eModuleError_t prvEraseLogical( xFlashWear_t *pxWear, uint16_t usLogical );
+static void			  prvStaticLevel( xFlashWear_t *pxWear, uint16_t usHotLogical );
+
+/* Private Variables ----------------------------------------*/
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashWearInit( xFlashWear_t *pxWear )
+{
+	xFlashSettings_t *pxSettings = &pxWear->pxDevice->xSettings;
+	xWearHeader_t	 xHeader, xExisting;
+	uint64_t		  ullKnownTotal = 0;
+	uint32_t		  ulKnown		= 0;
+	uint16_t		  usPhysical, usCurrent;
+
+	if ( ( pxWear->usNumSpares == 0 ) || ( pxWear->usNumSectors <= pxWear->usNumSpares ) || ( pxWear->usNumSectors >= WEAR_OWNER_BAD ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( ( pxSettings->usErasePages < 2 ) || ( ( pxWear->ulFirstSector + pxWear->usNumSectors ) * pxSettings->usErasePages > pxSettings->ulNumPages ) ) {
+		return ERROR_INVALID_DATA;
+	}
+
+	pxWear->usLogicalSectors = pxWear->usNumSectors - pxWear->usNumSpares;
+	pxWear->usDataPages		 = pxSettings->usErasePages - 1;
+	pxWear->ulSequence		 = 0;
+	pxWear->xAccess			 = xSemaphoreCreateMutex();
+	pxWear->pusMap			 = pvPortMalloc( pxWear->usLogicalSectors * sizeof( uint16_t ) );
+	pxWear->pusOwner		 = pvPortMalloc( pxWear->usNumSectors * sizeof( uint16_t ) );
+	pxWear->pulEraseCount	= pvPortMalloc( pxWear->usNumSectors * sizeof( uint32_t ) );
+	pxWear->pucPage			 = pvPortMalloc( pxSettings->usPageSize );
+	configASSERT( pxWear->xAccess && pxWear->pusMap && pxWear->pusOwner && pxWear->pulEraseCount && pxWear->pucPage );
+	pvMemset( pxWear->pusMap, 0xFF, pxWear->usLogicalSectors * sizeof( uint16_t ) );
+	pvMemset( &pxWear->xStats, 0x00, sizeof( xFlashWearStats_t ) );
+
+	/* Rebuild the mapping table from the sector headers */
+	for ( usPhysical = 0; usPhysical < pxWear->usNumSectors; usPhysical++ ) {
+		pxWear->pusOwner[usPhysical]	  = WEAR_OWNER_FREE;
+		pxWear->pulEraseCount[usPhysical] = WEAR_COUNT_UNKNOWN;
+		if ( eFlashRead( pxWear->pxDevice, prvPageAddress( pxWear, usPhysical, 0 ), (uint8_t *) &xHeader, sizeof( xWearHeader_t ), WEAR_TIMEOUT ) != ERROR_NONE ) {
+			continue;
+		}
+		if ( xHeader.usMagic == WEAR_HEADER_RETIRED ) {
+			pxWear->pusOwner[usPhysical] = WEAR_OWNER_BAD;
+			pxWear->xStats.ulRetired++;
+			continue;
+		}
+		/* Blank and corrupt headers are free sectors with an unknown history */
+		if ( ( xHeader.usMagic != WEAR_HEADER_MAGIC ) || ( xHeader.usCrc != prvHeaderCrc( &xHeader ) ) ) {
+			continue;
+		}
+		pxWear->pulEraseCount[usPhysical] = xHeader.ulEraseCount;
+		pxWear->ulSequence				  = MAX( pxWear->ulSequence, xHeader.ulSequence );
+		ullKnownTotal += xHeader.ulEraseCount;
+		ulKnown++;
+		if ( xHeader.usLogical >= pxWear->usLogicalSectors ) {
+			continue;
+		}
+		/* A crash between remapping and use leaves two claims on a logical sector, the newest claim is valid */
+		usCurrent = pxWear->pusMap[xHeader.usLogical];
+		if ( usCurrent != FLASH_WEAR_UNMAPPED ) {
+			eFlashRead( pxWear->pxDevice, prvPageAddress( pxWear, usCurrent, 0 ), (uint8_t *) &xExisting, sizeof( xWearHeader_t ), WEAR_TIMEOUT );
+			if ( xExisting.ulSequence > xHeader.ulSequence ) {
+				continue;
+			}
+			pxWear->pusOwner[usCurrent] = WEAR_OWNER_FREE;
+		}
+		pxWear->pusMap[xHeader.usLogical] = usPhysical;
+		pxWear->pusOwner[usPhysical]	  = xHeader.usLogical;
+	}
+
+	/* Sectors without a history are assumed to have average wear */
+	for ( usPhysical = 0; usPhysical < pxWear->usNumSectors; usPhysical++ ) {
+		if ( pxWear->pulEraseCount[usPhysical] == WEAR_COUNT_UNKNOWN ) {
+			pxWear->pulEraseCount[usPhysical] = ( ulKnown == 0 ) ? 0 : ( uint32_t )( ullKnownTotal / ulKnown );
+		}
+	}
+
+	eLog( LOG_FLASH_DRIVER, LOG_INFO, "%s wear: %d logical sectors, %d retired, sequence %d\r\n", pxWear->pxDevice->pcName, pxWear->usLogicalSectors, pxWear->xStats.ulRetired, pxWear->ulSequence );
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashWearRead( xFlashWear_t *pxWear, uint32_t ulPage, uint16_t usOffset, uint8_t *pucData, uint32_t ulLength )
+{
+	uint16_t	   usLogical = ulPage / pxWear->usDataPages;
+	uint16_t	   usPhysical;
+	eModuleError_t eError;
+
+	configASSERT( usLogical < pxWear->usLogicalSectors );
+	configASSERT( ( usOffset + ulLength ) <= pxWear->pxDevice->xSettings.usPageSize );
+
+	xSemaphoreTake( pxWear->xAccess, portMAX_DELAY );
+	usPhysical = pxWear->pusMap[usLogical];
+	if ( usPhysical == FLASH_WEAR_UNMAPPED ) {
+		pvMemset( pucData, pxWear->pxDevice->xSettings.ucEraseByte, ulLength );
+		eError = ERROR_NONE;
+	}
+	else {
+		eError = eFlashRead( pxWear->pxDevice, prvPageAddress( pxWear, usPhysical, 1 + ( ulPage % pxWear->usDataPages ) ) + usOffset, pucData, ulLength, WEAR_TIMEOUT );
+	}
+	xSemaphoreGive( pxWear->xAccess );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashWearWrite( xFlashWear_t *pxWear, uint32_t ulPage, uint8_t *pucData, uint32_t ulLength )
+{
+	uint16_t	   usLogical = ulPage / pxWear->usDataPages;
+	uint32_t	   ulSectorPage = 1 + ( ulPage % pxWear->usDataPages );
+	uint16_t	   usPhysical;
+	eModuleError_t eError = ERROR_NONE;
+
+	configASSERT( usLogical < pxWear->usLogicalSectors );
+	configASSERT( ulLength <= pxWear->pxDevice->xSettings.usPageSize );
+
+	xSemaphoreTake( pxWear->xAccess, portMAX_DELAY );
+	if ( pxWear->pusMap[usLogical] == FLASH_WEAR_UNMAPPED ) {
+		eError = prvEraseLogical( pxWear, usLogical );
+	}
+	while ( eError == ERROR_NONE ) {
+		usPhysical = pxWear->pusMap[usLogical];
+		eError	 = eFlashWrite( pxWear->pxDevice, prvPageAddress( pxWear, usPhysical, ulSectorPage ), pucData, ulLength, WEAR_TIMEOUT );
+		if ( eError != ERROR_FLASH_OPERATION_FAIL ) {
+			break;
+		}
+		/* Move the rest of the logical sector somewhere healthy and try again */
+		eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s wear: program failed on sector %d\r\n", pxWear->pxDevice->pcName, usPhysical );
+		eError = prvRelocate( pxWear, usLogical, ulSectorPage, false );
+		if ( eError == ERROR_NONE ) {
+			prvRetire( pxWear, usPhysical );
+		}
+	}
+	xSemaphoreGive( pxWear->xAccess );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFlashWearErase( xFlashWear_t *pxWear, uint32_t ulSector )
+{
+	eModuleError_t eError;
+
+	configASSERT( ulSector < pxWear->usLogicalSectors );
+
+	xSemaphoreTake( pxWear->xAccess, portMAX_DELAY );
+	eError = prvEraseLogical( pxWear, (uint16_t) ulSector );
+	if ( ( eError == ERROR_NONE ) && ( pxWear->ulStaticThreshold > 0 ) ) {
+		prvStaticLevel( pxWear, (uint16_t) ulSector );
+	}
+	xSemaphoreGive( pxWear->xAccess );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+void vFlashWearStats( xFlashWear_t *pxWear, xFlashWearStats_t *pxStats )
+{
+	uint16_t usPhysical;
+
+	xSemaphoreTake( pxWear->xAccess, portMAX_DELAY );
+	*pxStats			= pxWear->xStats;
+	pxStats->usFree		= 0;
+	pxStats->ulMinErase = UINT32_MAX;
+	pxStats->ulMaxErase = 0;
+	for ( usPhysical = 0; usPhysical < pxWear->usNumSectors; usPhysical++ ) {
+		if ( pxWear->pusOwner[usPhysical] == WEAR_OWNER_BAD ) {
+			continue;
+		}
+		pxStats->usFree += ( pxWear->pusOwner[usPhysical] == WEAR_OWNER_FREE ) ? 1 : 0;
+		pxStats->ulMinErase = MIN( pxStats->ulMinErase, pxWear->pulEraseCount[usPhysical] );
+		pxStats->ulMaxErase = MAX( pxStats->ulMaxErase, pxWear->pulEraseCount[usPhysical] );
+	}
+	xSemaphoreGive( pxWear->xAccess );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvPageAddress( xFlashWear_t *pxWear, uint16_t usPhysical, uint32_t ulPage )
+{
+	xFlashSettings_t *pxSettings = &pxWear->pxDevice->xSettings;
+	uint32_t		  ulFlashPage = ( ( pxWear->ulFirstSector + usPhysical ) * pxSettings->usErasePages ) + ulPage;
+	return (uint64_t) ulFlashPage << pxSettings->ucPageSizePower;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvHeaderCrc( xWearHeader_t *pxHeader )
+{
+	vCrcStart( CRC16_CCITT, 0xFFFF );
+	return (uint16_t) ulCrcCalculate( (uint8_t *) pxHeader, sizeof( xWearHeader_t ) - sizeof( pxHeader->usCrc ), true );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvPageErased( xFlashWear_t *pxWear )
+{
+	xFlashSettings_t *pxSettings = &pxWear->pxDevice->xSettings;
+	for ( uint16_t i = 0; i < pxSettings->usPageSize; i++ ) {
+		if ( pxWear->pucPage[i] != pxSettings->ucEraseByte ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvWriteHeader( xFlashWear_t *pxWear, uint16_t usPhysical, uint16_t usLogical )
+{
+	xWearHeader_t xHeader = {
+		.usMagic	  = WEAR_HEADER_MAGIC,
+		.usLogical	= usLogical,
+		.ulEraseCount = pxWear->pulEraseCount[usPhysical],
+		.ulSequence   = ++pxWear->ulSequence
+	};
+	xHeader.usCrc = prvHeaderCrc( &xHeader );
+	return eFlashWrite( pxWear->pxDevice, prvPageAddress( pxWear, usPhysical, 0 ), (uint8_t *) &xHeader, sizeof( xWearHeader_t ), WEAR_TIMEOUT );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRetire( xFlashWear_t *pxWear, uint16_t usPhysical )
+{
+	uint16_t usMagic = WEAR_HEADER_RETIRED;
+
+	eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s wear: retiring sector %d after %d erases\r\n", pxWear->pxDevice->pcName, usPhysical, pxWear->pulEraseCount[usPhysical] );
+	pxWear->pusOwner[usPhysical] = WEAR_OWNER_BAD;
+	pxWear->xStats.ulRetired++;
+	/* Best effort, clearing bits in a failing sector usually still succeeds. Otherwise it is retired again next boot */
+	eFlashWrite( pxWear->pxDevice, prvPageAddress( pxWear, usPhysical, 0 ), (uint8_t *) &usMagic, sizeof( usMagic ), WEAR_TIMEOUT );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvFindFree( xFlashWear_t *pxWear, bool bMostWorn )
+{
+	uint16_t usBest = FLASH_WEAR_UNMAPPED;
+	uint16_t usPhysical;
+
+	for ( usPhysical = 0; usPhysical < pxWear->usNumSectors; usPhysical++ ) {
+		if ( pxWear->pusOwner[usPhysical] != WEAR_OWNER_FREE ) {
+			continue;
+		}
+		if ( usBest == FLASH_WEAR_UNMAPPED ) {
+			usBest = usPhysical;
+		}
+		else if ( bMostWorn ? ( pxWear->pulEraseCount[usPhysical] > pxWear->pulEraseCount[usBest] ) : ( pxWear->pulEraseCount[usPhysical] < pxWear->pulEraseCount[usBest] ) ) {
+			usBest = usPhysical;
+		}
+	}
+	return usBest;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvEraseFree( xFlashWear_t *pxWear, bool bMostWorn, uint16_t *pusPhysical )
+{
+	xFlashSettings_t *pxSettings = &pxWear->pxDevice->xSettings;
+	uint32_t		  ulEraseSize = pxSettings->usErasePages << pxSettings->ucPageSizePower;
+	eModuleError_t	eError;
+	uint16_t		  usPhysical;
+
+	for ( ;; ) {
+		usPhysical = prvFindFree( pxWear, bMostWorn );
+		if ( usPhysical == FLASH_WEAR_UNMAPPED ) {
+			eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s wear: no usable sectors remain\r\n", pxWear->pxDevice->pcName );
+			return ERROR_DEVICE_FULL;
+		}
+		eError = eFlashErase( pxWear->pxDevice, prvPageAddress( pxWear, usPhysical, 0 ), ulEraseSize, WEAR_TIMEOUT );
+		pxWear->pulEraseCount[usPhysical]++;
+		pxWear->xStats.ulErases++;
+		if ( eError == ERROR_NONE ) {
+			*pusPhysical = usPhysical;
+			return ERROR_NONE;
+		}
+		if ( eError != ERROR_FLASH_OPERATION_FAIL ) {
+			return eError;
+		}
+		prvRetire( pxWear, usPhysical );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvRelocate( xFlashWear_t *pxWear, uint16_t usLogical, uint32_t ulSkipPage, bool bMostWorn )
+{
+	xFlashSettings_t *pxSettings = &pxWear->pxDevice->xSettings;
+	uint16_t		  usSource	 = pxWear->pusMap[usLogical];
+	uint16_t		  usTarget;
+	uint32_t		  ulPage;
+	eModuleError_t	eError;
+
+	for ( ;; ) {
+		eError = prvEraseFree( pxWear, bMostWorn, &usTarget );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+		/* Claim the target so that retiring it below is the only way it is reused */
+		pxWear->pusOwner[usTarget] = usLogical;
+		/* Copy the written pages, the header is written last so that a crash leaves the source valid */
+		for ( ulPage = 1; ( eError == ERROR_NONE ) && ( ulPage <= pxWear->usDataPages ); ulPage++ ) {
+			if ( ulPage == ulSkipPage ) {
+				continue;
+			}
+			eError = eFlashRead( pxWear->pxDevice, prvPageAddress( pxWear, usSource, ulPage ), pxWear->pucPage, pxSettings->usPageSize, WEAR_TIMEOUT );
+			if ( ( eError != ERROR_NONE ) || prvPageErased( pxWear ) ) {
+				continue;
+			}
+			eError = eFlashWrite( pxWear->pxDevice, prvPageAddress( pxWear, usTarget, ulPage ), pxWear->pucPage, pxSettings->usPageSize, WEAR_TIMEOUT );
+		}
+		if ( eError == ERROR_NONE ) {
+			eError = prvWriteHeader( pxWear, usTarget, usLogical );
+		}
+		if ( eError == ERROR_NONE ) {
+			pxWear->pusMap[usLogical] = usTarget;
+			pxWear->pusOwner[usSource] = WEAR_OWNER_FREE;
+			return ERROR_NONE;
+		}
+		if ( eError != ERROR_FLASH_OPERATION_FAIL ) {
+			pxWear->pusOwner[usTarget] = WEAR_OWNER_FREE;
+			return eError;
+		}
+		prvRetire( pxWear, usTarget );
+		eError = ERROR_NONE;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvEraseLogical( xFlashWear_t *pxWear, uint16_t usLogical )
+{
+	uint16_t	   usPrevious = pxWear->pusMap[usLogical];
+	uint16_t	   usPhysical;
+	eModuleError_t eError;
+
+	for ( ;; ) {
+		/* Dynamic levelling, new data always goes to the least worn free sector */
+		eError = prvEraseFree( pxWear, false, &usPhysical );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+		/* The new claim has a higher sequence number, so the previous sector is stale even if we crash before freeing it */
+		eError = prvWriteHeader( pxWear, usPhysical, usLogical );
+		if ( eError == ERROR_NONE ) {
+			break;
+		}
+		if ( eError != ERROR_FLASH_OPERATION_FAIL ) {
+			return eError;
+		}
+		prvRetire( pxWear, usPhysical );
+	}
+	if ( usPrevious != FLASH_WEAR_UNMAPPED ) {
+		pxWear->pusOwner[usPrevious] = WEAR_OWNER_FREE;
+	}
+	pxWear->pusMap[usLogical]	= usPhysical;
+	pxWear->pusOwner[usPhysical] = usLogical;
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvStaticLevel( xFlashWear_t *pxWear, uint16_t usHotLogical )
+{
+	uint16_t usColdest = FLASH_WEAR_UNMAPPED;
+	uint32_t ulMaxErase = 0;
+	uint16_t usPhysical, usOwner;
+
+	for ( usPhysical = 0; usPhysical < pxWear->usNumSectors; usPhysical++ ) {
+		usOwner = pxWear->pusOwner[usPhysical];
+		if ( usOwner == WEAR_OWNER_BAD ) {
+			continue;
+		}
+		ulMaxErase = MAX( ulMaxErase, pxWear->pulEraseCount[usPhysical] );
+		if ( ( usOwner == WEAR_OWNER_FREE ) || ( usOwner == usHotLogical ) ) {
+			continue;
+		}
+		if ( ( usColdest == FLASH_WEAR_UNMAPPED ) || ( pxWear->pulEraseCount[usPhysical] < pxWear->pulEraseCount[usColdest] ) ) {
+			usColdest = usPhysical;
+		}
+	}
+	/* Data that is never rewritten pins its sector at a low erase count, move it onto a worn sector so the sector can rejoin the pool */
+	if ( ( usColdest == FLASH_WEAR_UNMAPPED ) || ( ( ulMaxErase - pxWear->pulEraseCount[usColdest] ) <= pxWear->ulStaticThreshold ) ) {
+		return;
+	}
+	if ( prvRelocate( pxWear, pxWear->pusOwner[usColdest], 0, true ) == ERROR_NONE ) {
+		pxWear->xStats.ulStaticMoves++;
+	}
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: accelerometer_dsp.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Fixed point processing pipeline for accelerometer FIFO bursts
+ *
+ * Raw samples, as provided by accelerometer drivers, pass through the following stages:
+ * 		1. Optional Q15 FIR filter, evaluated only on decimated outputs
+ * 		2. Decimation (boxcar average when no FIR filter is provided)
+ * 		3. First order IIR low pass to estimate the static (gravity) component
+ * 		4. Dynamic body acceleration metrics (ODBA, VeDBA)
+ * 		5. Windowed feature extraction
+ *
+ * Processed samples are written back over the input buffer, so that
+ * the output of the pipeline can still be logged as raw data if desired.
+ *
+ */
+#ifndef __CSIRO_CORE_ACCELEROMETER_DSP
+#define __CSIRO_CORE_ACCELEROMETER_DSP
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "accelerometer_interface.h"
+#include "stats.h"
+#include "tdf.h"
+
+/* Module Defines -------------------------------------------*/
+
+// clang-format off
+#define ACC_DSP_MAX_FIR_TAPS        16
+#define ACC_DSP_MAX_STATIC_SHIFT    10
+
+/* Features are reported at 1024 counts per G (~1 milliG), which keeps variance calculations within 32 bits at 16G */
+#define ACC_DSP_FEATURE_SHIFT       4
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/**@brief Features extracted over a single window of processed samples
+ *
+ * All values are in units of ( 16384 >> ACC_DSP_FEATURE_SHIFT ) counts per G
+ */
+typedef struct xAccDspFeatures_t
+{
+	xStatsSummary_t xMagnitude;		/**< Statistics of the total acceleration magnitude */
+	int32_t			lVarianceX;		/**< Variance of the X axis */
+	int32_t			lVarianceY;		/**< Variance of the Y axis */
+	int32_t			lVarianceZ;		/**< Variance of the Z axis */
+	uint32_t		ulMeanOdba;		/**< Mean Overall Dynamic Body Acceleration */
+	uint32_t		ulMeanVedba;	/**< Mean Vectorial Dynamic Body Acceleration */
+	int8_t			cActivityClass; /**< Bin index of ulMeanOdba in the configured activity bins, -1 if none are configured */
+} xAccDspFeatures_t;
+
+/**@brief Callback run from the context of ucAccDspProcess when a feature window completes */
+typedef void ( *fnAccDspWindowComplete_t )( xAccDspFeatures_t *pxFeatures, void *pvContext );
+
+/**@brief Static configuration of a pipeline */
+typedef struct xAccDspConfig_t
+{
+	const int16_t *			 psFirTaps;			 /**< Q15 FIR coefficients, NULL to use a boxcar average for decimation */
+	uint8_t					 ucNumFirTaps;		 /**< Number of FIR coefficients, at most ACC_DSP_MAX_FIR_TAPS */
+	uint8_t					 ucDecimation;		 /**< Output one sample per ucDecimation inputs, 1 disables decimation */
+	uint8_t					 ucStaticShift;		 /**< Static estimate filter coefficient, alpha = 2 ^ -ucStaticShift */
+	uint16_t				 usWindowSamples;	 /**< Number of decimated samples per feature window, 0 disables windowing */
+	const uint32_t *		 pulActivityBins;	 /**< Optional ascending ODBA thresholds for cActivityClass, see ucBinIndexLong */
+	uint8_t					 ucNumActivityBins;  /**< Number of entries in pulActivityBins */
+	fnAccDspWindowComplete_t fnWindowComplete;   /**< Optional window completion callback */
+	void *					 pvContext;			 /**< Context provided to fnWindowComplete */
+} xAccDspConfig_t;
+
+/**@brief Runtime state of a pipeline, owned by the caller */
+typedef struct xAccDsp_t
+{
+	const xAccDspConfig_t *pxConfig;
+	/* FIR / Decimation */
+	int32_t plFirHistory[ACC_DSP_MAX_FIR_TAPS][3]; /**< Circular buffer of input samples */
+	uint8_t ucFirIndex;							  /**< Index of the most recent sample in plFirHistory */
+	uint8_t ucDecimationCount;					  /**< Inputs consumed towards the next output */
+	int32_t plDecimationSum[3];					  /**< Boxcar accumulator */
+	/* Static estimate */
+	bool	bSeeded;	 /**< Filter state has been seeded from the first sample */
+	int32_t plStatic[3]; /**< Static estimate, scaled by 2 ^ ucStaticShift */
+	/* Feature window */
+	xStats_t xMagnitudeStats;
+	xStats_t pxAxisStats[3];
+	uint64_t ullOdbaSum;
+	uint64_t ullVedbaSum;
+	uint16_t usWindowCount;
+} xAccDsp_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Initialise a processing pipeline
+ *
+ * @param[in] pxDsp				Pipeline state
+ * @param[in] pxConfig			Pipeline configuration, must remain valid for the life of the pipeline
+ *
+ * @retval ::ERROR_NONE 			Pipeline initialised
+ * @retval ::ERROR_INVALID_DATA 	Configuration is invalid
+ */
+eModuleError_t eAccDspInit( xAccDsp_t *pxDsp, const xAccDspConfig_t *pxConfig );
+
+/**@brief Reset all filter and window state without changing the configuration
+ *
+ * Should be called whenever the accelerometer is reconfigured or samples are lost
+ *
+ * @param[in] pxDsp				Pipeline state
+ */
+void vAccDspReset( xAccDsp_t *pxDsp );
+
+/**@brief Run a burst of samples through the pipeline
+ *
+ * Processed samples are written back into the start of pxBuffer->pxSamples, with
+ * ulMagnitude populated, and pxBuffer->ucNumSamples updated to the number of outputs.
+ * Window completion callbacks are run from this context.
+ *
+ * @param[in] pxDsp				Pipeline state
+ * @param[inout] pxBuffer		Raw samples in, processed samples out
+ *
+ * @retval Number of processed samples written back into pxBuffer
+ */
+uint8_t ucAccDspProcess( xAccDsp_t *pxDsp, xAccelerometerSampleBuffer_t *pxBuffer );
+
+/**@brief Magnitude of an acceleration vector without overflow at any supported range
+ *
+ * Inputs are shifted down only as far as required for VECTOR_SQR_MAGNITUDE to fit in 32 bits,
+ * so full resolution is retained for readings below 1G on each axis.
+ *
+ * @param[in] lX				X component
+ * @param[in] lY				Y component
+ * @param[in] lZ				Z component
+ *
+ * @retval Vector magnitude
+ */
+uint32_t ulAccDspMagnitude( int32_t lX, int32_t lY, int32_t lZ );
+
+/**@brief Log the features of a completed window
+ *
+ * Generates TDF_ACC_STATS, TDF_ACCEL_VARIANCE and TDF_STATS_SUMMARY (magnitude)
+ *
+ * @param[in] ucLoggerMask		Loggers to log to
+ * @param[in] eTimestampType	Timestamp type to log with
+ * @param[in] pxTime			Timestamp of the window
+ * @param[in] pxFeatures		Features to log
+ *
+ * @retval ::ERROR_NONE 		TDFs logged
+ */
+eModuleError_t eAccDspFeaturesLog( uint8_t ucLoggerMask, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, xAccDspFeatures_t *pxFeatures );
+
+#endif /* __CSIRO_CORE_ACCELEROMETER_DSP */
@@ -107,8 +107,27 @@
 
 /* Function Declarations ------------------------------------*/
 
+/**
+ * Integer square root, rounded down
+ * 
+ * Seeded from a 192 byte table indexed by the normalised input, then refined with Newton iteration
+ * 
+ * \param   ulInput     Value to find the root of
+ * \return              floor( sqrt( ulInput ) )
+ */
 uint32_t ulSquareRoot( uint32_t ulInput );
 
+/**
+ * Integer square root, rounded down
+ * 
+ * Table free variant of ulSquareRoot, seeded purely from the leading zero count
+ * Requires a few more iterations than ulSquareRoot
+ * 
+ * \param   ulInput     Value to find the root of
+ * \return              floor( sqrt( ulInput ) )
+ */
+uint32_t ulSquareRootNewton( uint32_t ulInput );
+
 /**
  * Iterate through the bits in a bitmask, from low to high
  * 
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: energy.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Attribution of energy consumption to subsystems
+ *
+ * Drivers mark the periods their subsystem is active through vEnergyActive, and count
+ * fixed cost operations through vEnergyEvent. Durations are measured on the RTC, which
+ * keeps counting while the CPU sleeps. Charge is only calculated when statistics are read,
+ * by applying the board current model from pxBoardEnergyModel to the accumulated durations.
+ *
+ * The board draws xEnergyModel_t.ulBaseMicroAmps at all times, each active subsystem adds
+ * its own active current on top. The CPU starts active and is marked inactive by the tickless
+ * idle implementation for the duration of each sleep.
+ *
+ * pyclasses/energy_model.py applies the same model to an application configuration on the
+ * host, to project battery life before deployment.
+ *
+ */
+#ifndef __CSIRO_CORE_ENERGY
+#define __CSIRO_CORE_ENERGY
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tdf.h"
+
+/* Module Defines -------------------------------------------*/
+// clang-format off
+
+/* Frequency of the duration timebase, ullRtcTickCount */
+#define ENERGY_TIMEBASE_HZ          32768
+
+#define ENERGY_DUTY_FULL            1000
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+typedef enum eEnergySubsystem_t {
+	ENERGY_CPU = 0,			/**< CPU running, inactive while tickless idle sleeps */
+	ENERGY_RADIO_SCAN,		/**< Bluetooth scanning, scaled by the scan window duty cycle */
+	ENERGY_RADIO_ADVERTISE, /**< Bluetooth advertising, one event per advertising packet */
+	ENERGY_RADIO_CONNECTED, /**< Bluetooth connection open */
+	ENERGY_FLASH,			/**< Onboard flash executing a command */
+	ENERGY_SD,				/**< SD card executing a command */
+	ENERGY_ADC,				/**< ADC conversion */
+	ENERGY_SENSORS,			/**< Application sensors */
+	ENERGY_SUBSYSTEMS
+} eEnergySubsystem_t;
+
+/**@brief Board current model */
+typedef struct xEnergyModel_t
+{
+	uint32_t ulBaseMicroAmps;						   /**< Board current with the CPU asleep and every subsystem inactive */
+	uint32_t pulActiveMicroAmps[ENERGY_SUBSYSTEMS];	/**< Additional current while a subsystem is active */
+	uint32_t pulEventNanoCoulombs[ENERGY_SUBSYSTEMS]; /**< Charge of each event counted through vEnergyEvent */
+	uint32_t ulBatteryMilliAmpHours;				   /**< Usable battery capacity, 0 if unknown */
+} xEnergyModel_t;
+
+/**@brief Accumulated subsystem activity */
+typedef struct xEnergyStats_t
+{
+	uint64_t ullElapsed;						 /**< Timebase ticks covered by the statistics */
+	uint64_t pullActive[ENERGY_SUBSYSTEMS];		 /**< Timebase ticks active, multiplied by the duty cycle in permille */
+	uint32_t pulEvents[ENERGY_SUBSYSTEMS];		 /**< Events counted */
+	uint64_t pullNanoCoulombs[ENERGY_SUBSYSTEMS]; /**< Charge attributed to each subsystem, calculated by vEnergyGet */
+	uint64_t ullBaseNanoCoulombs;				 /**< Charge of the base current, calculated by vEnergyGet */
+} xEnergyStats_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Mark a subsystem as active or inactive
+ *
+ * Repeated calls with the same state have no effect, safe to call from interrupts
+ *
+ * @param[in] eSubsystem			Subsystem
+ * @param[in] bActive				Subsystem is now active
+ */
+void vEnergyActive( eEnergySubsystem_t eSubsystem, bool bActive );
+
+/**@brief Set the fraction of its active time a subsystem draws its active current
+ *
+ * Used for subsystems that duty cycle internally, such as scanning with a window shorter
+ * than the interval. Applies from the time of the call.
+ *
+ * @param[in] eSubsystem			Subsystem
+ * @param[in] usPermille			Duty cycle, ENERGY_DUTY_FULL by default
+ */
+void vEnergyDuty( eEnergySubsystem_t eSubsystem, uint16_t usPermille );
+
+/**@brief Count fixed cost operations of a subsystem, safe to call from interrupts
+ *
+ * @param[in] eSubsystem			Subsystem
+ * @param[in] ulEvents				Number of operations
+ */
+void vEnergyEvent( eEnergySubsystem_t eSubsystem, uint32_t ulEvents );
+
+/**@brief Copy the activity accumulated since the last reset and calculate its charge
+ *
+ * @param[out] pxStats				Statistics output
+ * @param[in] bReset				Reset the statistics after copying them
+ */
+void vEnergyGet( xEnergyStats_t *pxStats, bool bReset );
+
+/**@brief Average current over the statistics period
+ *
+ * @param[in] pxStats				Statistics from vEnergyGet
+ *
+ * @retval							Average current in MicroAmperes
+ */
+uint32_t ulEnergyAverageMicroAmps( xEnergyStats_t *pxStats );
+
+/**@brief Battery life if the average current of the statistics period continues
+ *
+ * @param[in] pxStats				Statistics from vEnergyGet
+ *
+ * @retval							Projected battery life from full in hours, 0 if unknown
+ */
+uint32_t ulEnergyLifetimeHours( xEnergyStats_t *pxStats );
+
+/**@brief Log statistics as TDF_ENERGY_SUMMARY and a TDF_ENERGY_SUBSYSTEM per subsystem with charge
+ *
+ * @param[in] ucLoggerMask			Loggers to log to
+ * @param[in] eTimestampType		Timestamp type of the TDFs
+ * @param[in] pxTime				Timestamp of the TDFs
+ * @param[in] pxStats				Statistics from vEnergyGet
+ *
+ * @retval ::ERROR_NONE 			TDFs logged
+ */
+eModuleError_t eEnergyLog( uint8_t ucLoggerMask, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, xEnergyStats_t *pxStats );
+
+#endif /* __CSIRO_CORE_ENERGY */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: fifo_timestamp.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Sample timestamp reconstruction for FIFO based sensors
+ *
+ * FIFO sensors only report when a burst of samples is ready, and the sensor
+ * output data rate is derived from a clock that is independent of the RTC.
+ * This module tracks the true sample period from successive burst boundaries
+ * with a second order loop, so that:
+ * 		1. Samples are evenly spaced within and across bursts
+ * 		2. Sensor clock drift relative to the RTC is corrected
+ * 		3. Interrupt latency jitter on the burst boundary is filtered out
+ *
+ * Internally times are represented in 2^-24 second units since 2000,
+ * 256 times the resolution of xTdfTime_t, so that per sample rounding does not accumulate.
+ *
+ */
+#ifndef __CSIRO_CORE_FIFO_TIMESTAMP
+#define __CSIRO_CORE_FIFO_TIMESTAMP
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tdf.h"
+
+/* Module Defines -------------------------------------------*/
+
+// clang-format off
+/* Fraction of the boundary error applied to the timeline on each burst, 2 ^ -SHIFT */
+#define FIFO_TIMESTAMP_PHASE_SHIFT          2
+/* Fraction of the per sample boundary error applied to the period on each burst, 2 ^ -SHIFT */
+#define FIFO_TIMESTAMP_FREQUENCY_SHIFT      4
+/* Maximum deviation of the period estimate from the nominal period, 2 ^ -SHIFT */
+#define FIFO_TIMESTAMP_TOLERANCE_SHIFT      3
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/**@brief Timestamp reconstruction state for a single sensor, owned by the driver */
+typedef struct xFifoTimestamp_t
+{
+	uint32_t ulNominalPeriod; /**< Configured sample period, 2^-24 seconds */
+	uint32_t ulPeriod;		  /**< Estimated sample period, 2^-24 seconds */
+	uint64_t ullBoundary;	 /**< Previous observed burst boundary, 2^-24 seconds */
+	uint64_t ullLastSample;   /**< Reconstructed time of the most recent sample, 2^-24 seconds */
+	uint64_t ullBurstStart;   /**< Reconstructed time of the first sample in the current burst, 2^-24 seconds */
+	uint32_t ulBurstSpacing;  /**< Sample spacing within the current burst, 2^-24 seconds */
+	uint8_t  ucBoundaries;	/**< Burst boundaries observed since reset, saturates at 2 */
+} xFifoTimestamp_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Initialise timestamp reconstruction for a new sensor configuration
+ *
+ * @param[in] pxState			Reconstruction state
+ * @param[in] ulNominalPeriodUs	Configured sample period of the sensor in microseconds
+ */
+void vFifoTimestampInit( xFifoTimestamp_t *pxState, uint32_t ulNominalPeriodUs );
+
+/**@brief Discard all timing history while retaining the nominal period
+ *
+ * Should be called whenever the sensor FIFO is flushed or samples are lost
+ *
+ * @param[in] pxState			Reconstruction state
+ */
+void vFifoTimestampReset( xFifoTimestamp_t *pxState );
+
+/**@brief Reconstruct the timing of a burst of samples
+ *
+ * The boundary is the time the final sample in the burst became available,
+ * typically captured with bRtcGetTdfTime in the FIFO interrupt.
+ * Large boundary errors (missed bursts, RTC updates) resynchronise the timeline to the boundary.
+ *
+ * @param[in] pxState			Reconstruction state
+ * @param[in] pxBoundary		Observed time of the final sample in the burst
+ * @param[in] ucNumSamples		Number of samples in the burst
+ * @param[out] pxFirstSample	Optional, reconstructed time of the first sample in the burst
+ * @param[out] pxSpacing		Optional, reconstructed spacing between samples in the burst
+ */
+void vFifoTimestampBurst( xFifoTimestamp_t *pxState, xTdfTime_t *pxBoundary, uint8_t ucNumSamples, xTdfTime_t *pxFirstSample, xTdfTime_t *pxSpacing );
+
+/**@brief Time of a sample in the most recent burst
+ *
+ * Times are calculated from the internal high resolution state,
+ * avoiding the accumulated rounding of repeatedly adding pxSpacing.
+ *
+ * @param[in] pxState			Reconstruction state
+ * @param[in] ucIndex			Index of the sample in the burst
+ * @param[out] pxTime			Time of the sample
+ */
+void vFifoTimestampSample( xFifoTimestamp_t *pxState, uint8_t ucIndex, xTdfTime_t *pxTime );
+
+/**@brief Log a burst of equally sized TDFs with relative timestamps
+ *
+ * The first TDF is logged with a global timestamp if the logger requires it,
+ * all following TDFs are spaced by the reconstructed sample times.
+ *
+ * @param[in] ucLoggerMask		Loggers to log to
+ * @param[in] eTdfId			TDF ID of each record
+ * @param[in] pxState			Reconstruction state, after vFifoTimestampBurst
+ * @param[in] pucData			Packed TDF structs, one per sample
+ * @param[in] ucNumSamples		Number of TDFs in pucData
+ *
+ * @retval ::ERROR_NONE 		All TDFs logged
+ */
+eModuleError_t eFifoTimestampLog( uint8_t ucLoggerMask, eTdfIds_t eTdfId, xFifoTimestamp_t *pxState, uint8_t *pucData, uint8_t ucNumSamples );
+
+#endif /* __CSIRO_CORE_FIFO_TIMESTAMP */
@@ -90,6 +90,37 @@ struct xLoggerDevice_t;
  **/
 #define PHYSICAL_WRAP_NUMBER( log ) ( ( log )->ucWrapCounter + ( ( log )->ucClearByte == 0x00 ? 1 : 0 ) )
 #define LOGICAL_WRAP_NUMBER( log, physical ) ( ( physical ) - ( ( log )->ucClearByte == 0x00 ? 1 : 0 ) )
+/* Wrap numbers cycle through 255 values so that the physical wrap number never matches the erase byte */
+#define NEXT_WRAP_NUMBER( log ) ( ( ( log )->ucWrapCounter + 1 ) % 255 )
+
+/** 
+ * Commit markers, enabled with LOGGER_CONFIG_COMMIT_MARKERS
+ * 
+ * Every block header (after the wrap number) holds a CRC16 of the block, and every
+ * LOGGER_CHECKPOINT_INTERVAL blocks a checkpoint of the total pages written precedes
+ * the CRC. Both are stored
+ * 4 bits per 16 bit word with the remaining 12 bits equal to 0x000 (or 0xFFF when
+ * the erase byte is 0x00), which TDF decoders skip as padding. This guarantees a
+ * committed block never starts with the erase byte, and allows torn blocks from
+ * power loss during a program to be detected on initialisation.
+ * 
+ * If every checkpoint in a wrapping log has been torn, pages written can only be
+ * recovered from the wrap number, which repeats every 255 wraps. This is reported
+ * through LOGGER_STATUS_PAGES_ESTIMATED, and the estimate is carried into later
+ * checkpoints.
+ **/
+#define LOGGER_MARKER_SIZE		8
+#define LOGGER_CHECKPOINT_SIZE	16
+
+/** 
+ * Block footers, enabled with LOGGER_CONFIG_BLOCK_FOOTER
+ * 
+ * The final bytes of every block hold the sequence number of the block (total pages
+ * written when it was committed, 4 bytes) followed by a CRC16 of the rest of the block
+ * (2 bytes), both little endian. Decoders must stop usLoggerBlockFooterSize bytes before
+ * the end of each block. Footers are verified by eLoggerReadBlock and the scrubber.
+ **/
+#define LOGGER_FOOTER_SIZE		6
 
 // clang-format off
 // clang-format on
@@ -105,6 +136,10 @@ typedef enum eLoggerConfigureOptions_t {
 	LOGGER_CONFIG_GET_NUM_BLOCKS,		  /* Get the number of blocks the device can store */
 	LOGGER_CONFIG_GET_CLEAR_BYTE,		  /* Get the byte that erase operations set to */
 	LOGGER_CONFIG_GET_ERASE_UNIT,		  /* Get the byte that erase operations set to */
+	LOGGER_CONFIG_COMMIT_MARKERS,		  /* Add commit markers to each block, must be set before append or wrap mode */
+	LOGGER_CONFIG_BLOCK_FOOTER,			  /* Add a sequence number and CRC footer to each block, must be set before logging */
+	LOGGER_CONFIG_SET_START_BLOCK,		  /* Tell the device the first block used by the logger, sent by LOGGER_CONFIG_INIT_DEVICE */
+	LOGGER_CONFIG_SET_END_BLOCK,		  /* Tell the device the block after the last used by the logger, sent by LOGGER_CONFIG_INIT_DEVICE */
 	LOGGER_CONFIG_END
 } eLoggerConfigureOptions_t;
 
@@ -113,6 +148,9 @@ typedef enum eLoggerFlags_t {
 	LOGGER_FLAG_CLEAR_UNUSED_BYTES	 = 0x02, /* If set then unused buffer bytes are set to the clear_byte value */
 	LOGGER_FLAG_COMMIT_ONLY_USED_BYTES = 0x04, /* If set then only used bytes are committed */
 	LOGGER_FLAG_WRAPPING_ON			   = 0x08, /* If set then the logger will wrap around to the start page and continue writing */
+	LOGGER_FLAG_COMMIT_MARKERS		   = 0x10, /* If set then blocks start with a CRC and periodic checkpoints */
+	LOGGER_FLAG_BLOCK_FOOTER		   = 0x20, /* If set then blocks end with a sequence number and CRC */
+	LOGGER_FLAG_PAGES_ESTIMATED		   = 0x40, /* If set then no checkpoint survived and pages written is only known modulo 255 wraps */
 } eLoggerFlags_t;
 
 typedef enum eLoggerSearchOptions_t {
@@ -129,7 +167,10 @@ typedef enum eLoggerStatus_t {
 	LOGGER_STATUS_BLOCKS_WRITTEN = 0, /* Used to request the number of blocks written to the device */
 	LOGGER_STATUS_NUM_BLOCKS	 = 1,
 	LOGGER_STATUS_WRAP_COUNT	 = 2,
-	LOGGER_STATUS_DEVICE_STATUS /* Used to send the device a statuc pointer */
+	LOGGER_STATUS_DEVICE_STATUS,  /* Used to send the device a statuc pointer */
+	LOGGER_STATUS_TORN_BLOCKS,	  /* Number of torn blocks found on initialisation */
+	LOGGER_STATUS_CORRUPT_BLOCKS, /* Number of corrupt blocks found by the most recent scrub */
+	LOGGER_STATUS_PAGES_ESTIMATED /* True if pages written could not be recovered from a checkpoint on initialisation */
 } eLoggerStatus_t;
 
 /**
@@ -153,6 +194,8 @@ typedef struct xLogger_t
 	uint32_t					  ulPagesWritten;		 /* The number of pages written in this log */
 	uint8_t						  ucFlags;				 /* Used to store various settings. Set using the eLoggerConfigure function */
 	uint8_t *					  pucBuffer;			 /* This a pointer to an array of size 2 * usLogicalBlockSize */
+	uint32_t					  ulTornBlocks;			 /* Blocks invalidated on initialisation due to interrupted writes */
+	uint32_t					  ulCorruptBlocks;		 /* Blocks with invalid footers found by the most recent complete scrub */
 } xLogger_t;
 
 /** 
@@ -169,6 +212,20 @@ typedef struct xLoggerDevice_t
 	eModuleError_t ( *fnPrepareBlock )( uint32_t ulBlockNum );																 /*  Prepares the given block for writing (Erasing sectors etc) */
 } xLoggerDevice_t;
 
+/**
+ * Background verification of committed block footers, see vLoggerScrubStart.
+ */
+typedef struct xLoggerScrub_t
+{
+	xLogger_t *pxLog;		   /* Logger to scrub, with LOGGER_CONFIG_BLOCK_FOOTER enabled */
+	uint8_t *  pucBuffer;	   /* Block buffer of usLogicalBlockSize bytes, only used by the scrubber */
+	TickType_t xBlockPeriod;   /* Delay between block reads */
+	uint32_t   ulNextBlock;	/* Next block to verify */
+	uint32_t   ulPassCorrupt;  /* Corrupt blocks found so far in the current pass */
+	uint32_t   ulBlocksChecked; /* Total blocks verified */
+	uint32_t   ulPasses;		/* Total complete passes over the logger */
+} xLoggerScrub_t;
+
 /* Function Declarations ------------------------------------*/
 
 // Adds data to buffer and flushes if full. Returns immediately.
@@ -181,6 +238,14 @@ eModuleError_t eLoggerCommit( xLogger_t *pxLog );
 eModuleError_t eLoggerConfigure( xLogger_t *pxLog, uint16_t usSetting, void *pvConfValue );
 // Gets logger and/or device status.
 eModuleError_t eLoggerStatus( xLogger_t *pxLog, uint16_t usType, void *pvStatus );
+// Number of bytes at the start of a block that are not log data
+uint16_t usLoggerBlockHeaderSize( xLogger_t *pxLog, uint32_t ulBlockNum );
+// Number of bytes at the end of a block that are not log data
+uint16_t usLoggerBlockFooterSize( xLogger_t *pxLog );
+// Verifies the footer of the next committed block. Returns the result for that block.
+eModuleError_t eLoggerScrubBlock( xLoggerScrub_t *pxScrub );
+// Starts a task that continuously verifies committed blocks, priority should be just above idle.
+void vLoggerScrubStart( xLoggerScrub_t *pxScrub, UBaseType_t uxPriority );
 // Used to find information within loggers.
 eModuleError_t eLoggerSearch( xLogger_t *pxLog, uint16_t usNumBytes, uint8_t *pucMatchData, uint8_t ucSearchFlags, uint32_t *pulBlockNum );
 // Output current logger info
@@ -9,6 +9,10 @@
  * Routines for duplicating data from one logger to another.
  * Canonical use case is copying data from onboard flash to external SD card
  * Tests currently run across most common use cases, but has never been tested on actual hardware
+ *
+ * eLogMirror copies raw pages, which splits TDFs when the block sizes differ.
+ * eLogMirrorTdf instead parses each source block and repacks whole TDFs into destination blocks,
+ * re-encoding timestamps so that every destination block is independently decodable.
  * 
  */
 #ifndef __CSIRO_CORE_LOGGER_MIRROR
@@ -16,16 +20,67 @@
 /* Includes -------------------------------------------------*/
 
 #include "logger.h"
+#include "tdf_parse.h"
 
 /* Module Defines -------------------------------------------*/
 // clang-format off
 // clang-format on
 /* Type Definitions -----------------------------------------*/
 
+/**@brief TDF aware mirror state, owned by the caller and preserved between calls */
+typedef struct xLogMirrorTdf_t
+{
+	uint8_t *	pucBuffer;		   /**< Source block buffer */
+	uint16_t	 usBufferLen;		   /**< Size of pucBuffer, at least the source logical block size */
+	uint32_t	 ulSrcPagesMirrored; /**< Source pages already mirrored, persist to resume after a reset */
+	uint32_t	 ulDstPage;		   /**< Destination ulPagesWritten when xDstTime was recorded */
+	xTdfTime_t   xDstTime;		   /**< Most recent global time in the current destination block */
+	bool		 bDstTimeValid;	  /**< xDstTime has been recorded */
+	xTdfParser_t xParser;			   /**< Source block parser */
+	/* Statistics */
+	uint32_t ulTdfs;	  /**< TDFs copied individually */
+	uint32_t ulSegments;  /**< Compressed segments copied verbatim */
+	uint32_t ulGlobals;   /**< Relative timestamps promoted to global timestamps */
+	uint32_t ulDropped;   /**< TDFs too large for a destination block */
+	uint32_t ulLostPages;	/**< Source pages overwritten before they were mirrored */
+	uint32_t ulCorruptPages; /**< Source pages that failed block footer verification */
+} xLogMirrorTdf_t;
+
 /* Function Declarations ------------------------------------*/
 
 uint32_t ulLogMirrorLostSrcPages( uint32_t ulPagesWritten, uint32_t ulNumPages, uint8_t ucEraseUnit );
 
 eModuleError_t eLogMirror( xLogger_t *pxSource, xLogger_t *pxDestination );
 
+/**@brief Initialise TDF aware mirror state
+ *
+ * @param[in] pxState				Mirror state
+ * @param[in] pucBuffer				Source block buffer, at least the source logical block size
+ * @param[in] usBufferLen			Size of pucBuffer
+ * @param[in] ulSrcPagesMirrored	Source pages mirrored by a previous session, 0 to mirror from the start
+ */
+void vLogMirrorTdfInit( xLogMirrorTdf_t *pxState, uint8_t *pucBuffer, uint16_t usBufferLen, uint32_t ulSrcPagesMirrored );
+
+/**@brief Mirror TDF data, repacking whole TDFs between loggers of any block size
+ *
+ * Global timestamps are copied, relative timestamps are kept relative where the offset from the
+ * destination block's most recent global time can be represented, otherwise promoted to global.
+ * Compressed segments are copied verbatim when they fit in a destination block, otherwise expanded.
+ * Source pages lost to wrapping, or that fail block footer verification, are recorded as TDF_LOST_DATA.
+ *
+ * The final destination block is committed before returning, so pxState->ulSrcPagesMirrored
+ * always describes data that has reached the destination. Each call can therefore leave a
+ * partially filled destination block, ulMaxPages should cover several destination blocks.
+ *
+ * @note	The destination logger must only be written by the mirror
+ *
+ * @param[in] pxSrc					Source logger
+ * @param[in] pxDst					Destination logger, wrapping must be disabled
+ * @param[in] pxState				Mirror state
+ * @param[in] ulMaxPages			Maximum source pages to mirror in this call
+ *
+ * @retval ::ERROR_NONE 			All requested pages mirrored
+ */
+eModuleError_t eLogMirrorTdf( xLogger_t *pxSrc, xLogger_t *pxDst, xLogMirrorTdf_t *pxState, uint32_t ulMaxPages );
+
 #endif /* __CSIRO_CORE_LOGGER_MIRROR */
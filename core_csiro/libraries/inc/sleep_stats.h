@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: sleep_stats.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Accounting of tickless idle periods
+ *
+ * The tickless idle implementation of each port reports every call to portSUPPRESS_TICKS_AND_SLEEP,
+ * in kernel ticks, through vSleepStatsRecord. Nothing in this module touches hardware, so a host
+ * port can report its simulated idle periods through the same call and be checked against the
+ * same statistics as a device.
+ *
+ * Run time is the time between the end of one idle period and the start of the next, so the
+ * run time since the most recent idle period is only accounted once the next period starts.
+ *
+ */
+#ifndef __CSIRO_CORE_SLEEP_STATS
+#define __CSIRO_CORE_SLEEP_STATS
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#include "tdf.h"
+
+/* Module Defines -------------------------------------------*/
+// clang-format off
+
+/* Bin N counts sleeps of [2^N, 2^(N+1)) ticks, the final bin also counts all longer sleeps */
+#define SLEEP_STATS_HISTOGRAM_BINS      12
+
+/* Wake sources are counted per interrupt number below this limit */
+#ifndef SLEEP_STATS_NUM_IRQS
+#define SLEEP_STATS_NUM_IRQS            48
+#endif
+
+/* Wake interrupt could not be determined */
+#define SLEEP_STATS_IRQ_UNKNOWN         ( -1 )
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+typedef enum eSleepWake_t {
+	SLEEP_WAKE_TIMEOUT = 0,		/**< Slept until the expected idle time expired */
+	SLEEP_WAKE_INTERRUPT,		/**< Woken early by an interrupt other than the wake timer */
+	SLEEP_WAKE_ABORTED,			/**< eTaskConfirmSleepModeStatus aborted the sleep */
+	SLEEP_WAKE_BLOCKED,			/**< The board did not allow the sleep to start */
+	SLEEP_WAKE_REASONS
+} eSleepWake_t;
+
+typedef struct xSleepStats_t
+{
+	uint32_t pulWakes[SLEEP_WAKE_REASONS];				   /**< Idle periods by outcome */
+	uint32_t pulHistogram[SLEEP_STATS_HISTOGRAM_BINS];	 /**< Sleep durations, see SLEEP_STATS_HISTOGRAM_BINS */
+	uint16_t pusWakeIrqs[SLEEP_STATS_NUM_IRQS];			   /**< SLEEP_WAKE_INTERRUPT wakes by interrupt number, saturating */
+	uint32_t ulUnknownIrqWakes;							   /**< SLEEP_WAKE_INTERRUPT wakes without a known interrupt */
+	uint32_t ulSleepTicks;								   /**< Ticks spent asleep */
+	uint32_t ulRunTicks;								   /**< Ticks spent outside of idle periods */
+	uint32_t ulOversleepTicks;							   /**< Ticks slept past the expected idle time */
+	uint32_t ulUndersleepTicks;							   /**< Ticks of the expected idle time that were not slept */
+	uint32_t ulMaxOversleep;							   /**< Longest single oversleep, the worst case wake latency */
+} xSleepStats_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Record the outcome of a call to portSUPPRESS_TICKS_AND_SLEEP
+ *
+ * @note	Called by the tickless idle implementation with the scheduler suspended
+ *
+ * @param[in] xSleepStart			Kernel tick count when the idle period started
+ * @param[in] xExpectedIdleTime		Idle time requested by the kernel, portMAX_DELAY if no task has a timeout
+ * @param[in] xSleptTicks			Ticks actually spent asleep, 0 if the sleep was aborted or blocked
+ * @param[in] eWake					Outcome of the idle period
+ * @param[in] lWakeIrq				Interrupt number that ended a SLEEP_WAKE_INTERRUPT sleep, or SLEEP_STATS_IRQ_UNKNOWN
+ */
+void vSleepStatsRecord( TickType_t xSleepStart, TickType_t xExpectedIdleTime, TickType_t xSleptTicks, eSleepWake_t eWake, int32_t lWakeIrq );
+
+/**@brief Copy the statistics accumulated since the last reset
+ *
+ * @param[out] pxStats				Statistics output
+ * @param[in] bReset				Reset the statistics after copying them
+ */
+void vSleepStatsGet( xSleepStats_t *pxStats, bool bReset );
+
+/**@brief Percentage of accounted time spent asleep
+ *
+ * @param[in] pxStats				Statistics from vSleepStatsGet
+ *
+ * @retval							Sleep time in units of 0.1%
+ */
+uint16_t usSleepStatsPermille( xSleepStats_t *pxStats );
+
+/**@brief Log statistics as TDF_SLEEP_STATS, TDF_SLEEP_HISTOGRAM and a TDF_SLEEP_WAKE_IRQ per wake interrupt
+ *
+ * Counters that do not fit the TDF fields saturate
+ *
+ * @param[in] ucLoggerMask			Loggers to log to
+ * @param[in] eTimestampType		Timestamp type of the TDFs
+ * @param[in] pxTime				Timestamp of the TDFs
+ * @param[in] pxStats				Statistics from vSleepStatsGet
+ *
+ * @retval ::ERROR_NONE 			TDFs logged
+ */
+eModuleError_t eSleepStatsLog( uint8_t ucLoggerMask, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, xSleepStats_t *pxStats );
+
+#endif /* __CSIRO_CORE_SLEEP_STATS */
@@ -66,6 +66,9 @@
 
 #define TDF_TIMESTAMP_MASK 						0xC000	// 11000000 00000000
 #define TDF_ID_MASK 							0x0FFF	// 00001111 11111111
+#define TDF_COMPRESSED_ID 						0x0FFE	// Reserved TDF ID which marks a compressed segment
+
+#define TDF_COMPRESSED_MAX_RECORDS 				UINT8_MAX
 
 #define TDF_ID(x) 					((x) & TDF_ID_MASK)
 #define TDF_TIMESTAMP(x) 			((x) & TDF_TIMESTAMP_MASK)
@@ -109,6 +112,38 @@ typedef struct xTdfLogger_t
 	xTdfTime_t		  xValidAfterTime;
 } xTdfLogger_t;
 
+/**@brief Compressed TDF segment encoder state
+ *
+ * A compressed segment contains consecutive records of a single TDF ID. It is identified by
+ * the reserved TDF_COMPRESSED_ID in the header, followed by the TDF ID of the records.
+ * Parsers which do not support compression fail the ID lookup instead of misreading the segment.
+ *
+ * Segment layout:
+ * 		[ uint16 header | uint16 TDF ID | uint8 record count | (xTdfTime_t base time) | record 0 | record 1 ... ]
+ * 
+ * The header timestamp bits are either TDF_TIMESTAMP_NONE or TDF_TIMESTAMP_GLOBAL.
+ * Record 0 is stored verbatim. Subsequent records are stored as the difference of each
+ * little endian 16 bit word against the previous record, zig-zag encoded into a varint.
+ * An odd trailing byte is treated as a word with a zero upper byte.
+ * 
+ * For timestamped segments, time differences are run length encoded. A record which starts
+ * a new run is prefixed by the varint time difference in 1/65536 seconds, followed by a uint8
+ * count of the records which share that difference.
+ */
+typedef struct xTdfCompressor_t
+{
+	uint8_t *			pucBuffer;						 /**< Output buffer for the segment */
+	uint16_t			usBufferLen;					 /**< Size of pucBuffer */
+	uint16_t			usBufferOffset;					 /**< Number of bytes of pucBuffer used */
+	eTdfIds_t			eTdfId;							 /**< TDF ID of all records in the segment */
+	eTdfTimestampType_t eTimestampType;					 /**< TDF_TIMESTAMP_NONE or TDF_TIMESTAMP_GLOBAL */
+	uint8_t				ucNumRecords;					 /**< Records in the segment */
+	uint16_t			usRunCountOffset;				 /**< Offset of the current time run count */
+	uint32_t			ulRunDelta;						 /**< Time difference of the current run */
+	xTdfTime_t			xPreviousTime;					 /**< Timestamp of the previous record */
+	uint8_t				pucPrevious[UINT8_MAX];			 /**< Previous record, for word differences */
+} xTdfCompressor_t;
+
 /* More Macros ----------------------------------------------*/
 
 // Enumerates a list of active TDF loggers
@@ -232,4 +267,38 @@ eModuleError_t eTdfFlushMulti( uint8_t ucLoggerMask );
  */
 eModuleError_t eTdfSchedulerArgsParse( xTdfLoggerMapping_t *pxLoggerMapping, uint8_t ucTdfMask, eTdfIds_t eTdfId, xTdfTime_t *pxGlobalTime, void *pucData );
 
+/**@brief Start a new compressed TDF segment
+ *
+ * @param[in] pxCompressor		Compressor state
+ * @param[in] eTdfId			The TDF type of all records in the segment
+ * @param[in] eTimestampType	TDF_TIMESTAMP_NONE or TDF_TIMESTAMP_GLOBAL
+ * @param[in] pucBuffer			Output buffer for the segment
+ * @param[in] usBufferLen		Size of the output buffer
+ */
+void vTdfCompressStart( xTdfCompressor_t *pxCompressor, eTdfIds_t eTdfId, eTdfTimestampType_t eTimestampType, uint8_t *pucBuffer, uint16_t usBufferLen );
+
+/**@brief Append a record to a compressed TDF segment
+ *
+ * @param[in] pxCompressor		Compressor state
+ * @param[in] pxTime			Timestamp of the record, ignored for TDF_TIMESTAMP_NONE segments
+ * @param[in] pvData			Record data, pucTdfStructLengths[eTdfId] bytes long
+ * 
+ * @retval ::ERROR_NONE 		Record added to segment
+ * @retval ::ERROR_DEVICE_FULL 	Segment cannot be guaranteed to hold the record, segment is unchanged
+ * @retval ::ERROR_INVALID_TIME Record is older than the previous record or more than 65535 seconds newer
+ */
+eModuleError_t eTdfCompressAdd( xTdfCompressor_t *pxCompressor, xTdfTime_t *pxTime, void *pvData );
+
+/**@brief Add a compressed TDF segment to a TDF log.
+ *
+ * The segment is always written into a single logger block.
+ * The compressor must be restarted with vTdfCompressStart before being reused.
+ *
+ * @param[in] pxTdfLog			A pointer to the TDF log to add data to.
+ * @param[in] pxCompressor		Completed segment
+ * 
+ * @retval ::ERROR_NONE 		Segment added successfully.
+ */
+eModuleError_t eTdfAddCompressed( xTdfLogger_t *pxTdfLog, xTdfCompressor_t *pxCompressor );
+
 #endif // __CORE_CSIRO_TDF_H__
@@ -491,11 +491,19 @@ typedef enum eTdfIds {
     TDF_MAG_XYZ_SIGNED                      = 473,
     TDF_HEADING                             = 474,
     TDF_RANGE_CM                            = 475,
+    TDF_SLEEP_STATS                         = 476,
+    TDF_SLEEP_HISTOGRAM                     = 477,
+    TDF_SLEEP_WAKE_IRQ                      = 478,
+    TDF_ENERGY_SUBSYSTEM                    = 479,
+    TDF_ENERGY_SUMMARY                      = 480,
+    TDF_TASK_STACK                          = 481,
+    TDF_CRASH_DUMP                          = 482,
+    TDF_CRASH_DUMP_DATA                     = 483,
 } eTdfIds_t;
 
 /* External Variables ---------------------------------------*/
 
-extern const uint8_t pucTdfStructLengths[476];
+extern const uint8_t pucTdfStructLengths[484];
 
 // clang-format on
 #endif /* __CORE_CSIRO_LIBRARIES_TDF_AUTO */
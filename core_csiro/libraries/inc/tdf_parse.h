@@ -30,6 +30,12 @@ typedef struct xTdfParser_t
 	uint32_t   ulBufferLen;
 	uint32_t   ulCurrentOffset;
 	xTdfTime_t xBufferTime;
+	/* Compressed segment state */
+	uint16_t usSegmentId;				 /**< TDF header reported for records in the current segment */
+	uint8_t  ucSegmentRemaining;		 /**< Records remaining in the current segment */
+	uint8_t  ucRunRemaining;			 /**< Records remaining in the current time run */
+	uint32_t ulRunDelta;				 /**< Time difference of the current time run */
+	uint8_t  pucSegmentRecord[UINT8_MAX]; /**< Most recently decoded record */
 } xTdfParser_t;
 
 typedef struct xTdf_t
@@ -44,6 +50,18 @@ typedef struct xTdf_t
 
 void vTdfParseStart( xTdfParser_t *pxParser, uint8_t *pucBuffer, uint32_t ulBufferLen );
 
+/**@brief Extract the next TDF from the buffer
+ *
+ * Records inside compressed segments (TDF_COMPRESSED_ID) are expanded one at a time.
+ * Their data is decoded into the parser state, and is only valid until the next call.
+ * Their ID contains TDF_TIMESTAMP_GLOBAL if the segment is timestamped, otherwise no flags.
+ *
+ * @param[in] pxParser			Parser state
+ * @param[out] pxTdf			Next TDF in the buffer
+ * 
+ * @retval ::ERROR_NONE 		TDF extracted
+ * @retval ::ERROR_INVALID_DATA No more valid TDFs in the buffer
+ */
 eModuleError_t eTdfParse( xTdfParser_t *pxParser, xTdf_t *pxTdf );
 
 #endif /* __CSIRO_CORE_TDF_PARSE */
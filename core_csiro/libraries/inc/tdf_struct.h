@@ -3187,6 +3187,79 @@ typedef struct tdf_range_cm {
 } ATTR_PACKED tdf_range_cm_t;
 #define TDF_RANGE_CM_SIZE sizeof(tdf_range_cm_t)
 
+// Tickless idle accounting, durations in RTOS ticks
+typedef struct tdf_sleep_stats {
+    uint32_t sleep_ticks;  
+    uint32_t run_ticks;  
+    uint16_t timeouts;  
+    uint16_t interrupts;  
+    uint16_t aborted;  
+    uint16_t blocked;  
+    uint16_t oversleep;  
+    uint16_t undersleep;  
+    uint16_t max_oversleep;  
+} ATTR_PACKED tdf_sleep_stats_t;
+#define TDF_SLEEP_STATS_SIZE sizeof(tdf_sleep_stats_t)
+
+// Tickless idle durations, bin N counts sleeps of 2^N to 2^(N+1) ticks
+typedef struct tdf_sleep_histogram {
+    uint16_t bins[12];  
+} ATTR_PACKED tdf_sleep_histogram_t;
+#define TDF_SLEEP_HISTOGRAM_SIZE sizeof(tdf_sleep_histogram_t)
+
+// Tickless idle periods ended early by an interrupt
+typedef struct tdf_sleep_wake_irq {
+    uint8_t irq;  
+    uint16_t wakes;  
+} ATTR_PACKED tdf_sleep_wake_irq_t;
+#define TDF_SLEEP_WAKE_IRQ_SIZE sizeof(tdf_sleep_wake_irq_t)
+
+// Energy attributed to a subsystem over the statistics period
+typedef struct tdf_energy_subsystem {
+    uint8_t subsystem;  
+    uint32_t active_ms; // Milliseconds, scaled by the duty cycle 
+    uint32_t events;  
+    uint32_t charge; // Microcoulombs 
+} ATTR_PACKED tdf_energy_subsystem_t;
+#define TDF_ENERGY_SUBSYSTEM_SIZE sizeof(tdf_energy_subsystem_t)
+
+// Energy statistics period summary
+typedef struct tdf_energy_summary {
+    uint32_t period_ms; // Milliseconds 
+    uint32_t charge; // Microcoulombs 
+    uint32_t average_current; // Microamperes 
+    uint32_t lifetime; // Hours 
+} ATTR_PACKED tdf_energy_summary_t;
+#define TDF_ENERGY_SUMMARY_SIZE sizeof(tdf_energy_summary_t)
+
+// Task stack high water mark
+typedef struct tdf_task_stack {
+    char procName[8];  
+    uint16_t stack_size; // Bytes 
+    uint16_t stack_free; // Bytes 
+} ATTR_PACKED tdf_task_stack_t;
+#define TDF_TASK_STACK_SIZE sizeof(tdf_task_stack_t)
+
+// Post-mortem record summary
+typedef struct tdf_crash_dump {
+    uint8_t type;  
+    char procName[8];  
+    uint32_t pc;  
+    uint32_t lr;  
+    uint32_t sp;  
+    uint32_t cfsr;  
+    uint32_t fault_address;  
+    uint32_t uptime; // Seconds 
+} ATTR_PACKED tdf_crash_dump_t;
+#define TDF_CRASH_DUMP_SIZE sizeof(tdf_crash_dump_t)
+
+// Post-mortem record raw data
+typedef struct tdf_crash_dump_data {
+    uint16_t offset; // Bytes 
+    uint8_t data[24];  
+} ATTR_PACKED tdf_crash_dump_data_t;
+#define TDF_CRASH_DUMP_DATA_SIZE sizeof(tdf_crash_dump_data_t)
+
 
 // clang-format on
 /* Function Declarations ------------------------------------*/
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "accelerometer_dsp.h"
+
+#include "compiler_intrinsics.h"
+#include "csiro_math.h"
+#include "memory_operations.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+/* Largest component magnitude (in bits) for which VECTOR_SQR_MAGNITUDE cannot overflow */
+#define MAGNITUDE_MAX_BITS      14
+
+#define AXIS_X                  0
+#define AXIS_Y                  1
+#define AXIS_Z                  2
+#define NUM_AXES                3
+
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/* Function Declarations ------------------------------------*/
+
+static void prvAccDspSeed( xAccDsp_t *pxDsp, const int32_t plSample[NUM_AXES] );
+static bool prvAccDspDecimate( xAccDsp_t *pxDsp, const int32_t plSample[NUM_AXES], int32_t plOutput[NUM_AXES] );
+static void prvAccDspWindowReset( xAccDsp_t *pxDsp );
+static void prvAccDspWindowUpdate( xAccDsp_t *pxDsp, xAccelerometerSample_t *pxSample, uint32_t ulOdba, uint32_t ulVedba );
+static void prvAccDspWindowComplete( xAccDsp_t *pxDsp );
+
+/* Private Variables ----------------------------------------*/
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eAccDspInit( xAccDsp_t *pxDsp, const xAccDspConfig_t *pxConfig )
+{
+	if ( ( pxConfig->ucDecimation == 0 ) || ( pxConfig->ucStaticShift > ACC_DSP_MAX_STATIC_SHIFT ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( ( pxConfig->psFirTaps != NULL ) && ( ( pxConfig->ucNumFirTaps == 0 ) || ( pxConfig->ucNumFirTaps > ACC_DSP_MAX_FIR_TAPS ) ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( ( pxConfig->pulActivityBins != NULL ) && ( pxConfig->ucNumActivityBins > INT8_MAX ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	pxDsp->pxConfig = pxConfig;
+	vAccDspReset( pxDsp );
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+void vAccDspReset( xAccDsp_t *pxDsp )
+{
+	pvMemset( pxDsp->plDecimationSum, 0x00, sizeof( pxDsp->plDecimationSum ) );
+	pxDsp->ucFirIndex		 = 0;
+	pxDsp->ucDecimationCount = 0;
+	pxDsp->bSeeded			 = false;
+	prvAccDspWindowReset( pxDsp );
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t ucAccDspProcess( xAccDsp_t *pxDsp, xAccelerometerSampleBuffer_t *pxBuffer )
+{
+	const xAccDspConfig_t *pxConfig = pxDsp->pxConfig;
+	xAccelerometerSample_t *pxInput;
+	xAccelerometerSample_t *pxOutput = pxBuffer->pxSamples;
+	int32_t					plRaw[NUM_AXES];
+	int32_t					plFiltered[NUM_AXES];
+	int32_t					plDynamic[NUM_AXES];
+	uint32_t				ulOdba;
+	uint32_t				ulVedba;
+	uint8_t					i, j;
+
+	for ( i = 0; i < pxBuffer->ucNumSamples; i++ ) {
+		pxInput			= &pxBuffer->pxSamples[i];
+		plRaw[AXIS_X]	= pxInput->lX;
+		plRaw[AXIS_Y]	= pxInput->lY;
+		plRaw[AXIS_Z]	= pxInput->lZ;
+
+		if ( !pxDsp->bSeeded ) {
+			prvAccDspSeed( pxDsp, plRaw );
+		}
+		/* Nothing further to do until a decimated output is available */
+		if ( !prvAccDspDecimate( pxDsp, plRaw, plFiltered ) ) {
+			continue;
+		}
+		/* Static component tracks the filtered signal, dynamic component is what remains */
+		ulOdba = 0;
+		for ( j = 0; j < NUM_AXES; j++ ) {
+			pxDsp->plStatic[j] += plFiltered[j] - ( pxDsp->plStatic[j] >> pxConfig->ucStaticShift );
+			plDynamic[j] = plFiltered[j] - ( pxDsp->plStatic[j] >> pxConfig->ucStaticShift );
+			ulOdba += ABS( plDynamic[j] );
+		}
+		ulVedba = ulAccDspMagnitude( plDynamic[AXIS_X], plDynamic[AXIS_Y], plDynamic[AXIS_Z] );
+		/* Output index never overtakes the input index, so outputs can be written in place */
+		pxOutput->lX		  = plFiltered[AXIS_X];
+		pxOutput->lY		  = plFiltered[AXIS_Y];
+		pxOutput->lZ		  = plFiltered[AXIS_Z];
+		pxOutput->ulMagnitude = ulAccDspMagnitude( pxOutput->lX, pxOutput->lY, pxOutput->lZ );
+
+		if ( pxConfig->usWindowSamples != 0 ) {
+			prvAccDspWindowUpdate( pxDsp, pxOutput, ulOdba, ulVedba );
+		}
+		pxOutput++;
+	}
+	pxBuffer->ucNumSamples = (uint8_t) ( pxOutput - pxBuffer->pxSamples );
+	return pxBuffer->ucNumSamples;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulAccDspMagnitude( int32_t lX, int32_t lY, int32_t lZ )
+{
+	/* OR'ing the absolute values gives the bit length of the largest component */
+	uint32_t ulLargest = (uint32_t) ( ABS( lX ) | ABS( lY ) | ABS( lZ ) | 1 );
+	uint32_t ulBits	= 32 - COUNT_LEADING_ZEROS( ulLargest );
+	uint32_t ulShift   = ( ulBits > MAGNITUDE_MAX_BITS ) ? ( ulBits - MAGNITUDE_MAX_BITS ) : 0;
+	/**
+	 * Components are now less than 2^14, therefore:
+	 * 		3 * ((2 ** 14) ** 2) == 3 * (2 ** 28) < 2 ** 31
+	 **/
+	uint32_t ulSquaredMag = VECTOR_SQR_MAGNITUDE( lX >> ulShift, lY >> ulShift, lZ >> ulShift );
+	return ulSquareRoot( ulSquaredMag ) << ulShift;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eAccDspFeaturesLog( uint8_t ucLoggerMask, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, xAccDspFeatures_t *pxFeatures )
+{
+	tdf_acc_stats_t		 xAccStats;
+	tdf_accel_variance_t xVariance;
+	tdf_stats_summary_t  xMagnitude;
+	eModuleError_t		 eError;
+
+	xAccStats.norm			 = pxFeatures->ulMeanVedba;
+	xAccStats.mean			 = (uint32_t) pxFeatures->xMagnitude.mean;
+	xAccStats.variance		 = (uint32_t) pxFeatures->xMagnitude.variance;
+	xAccStats.classification = pxFeatures->cActivityClass;
+
+	xVariance.x = pxFeatures->lVarianceX;
+	xVariance.y = pxFeatures->lVarianceY;
+	xVariance.z = pxFeatures->lVarianceZ;
+
+	vStatsSummaryToTdf( &pxFeatures->xMagnitude, &xMagnitude );
+
+	eError = eTdfAddMulti( ucLoggerMask, TDF_ACC_STATS, eTimestampType, pxTime, &xAccStats );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	eError = eTdfAddMulti( ucLoggerMask, TDF_ACCEL_VARIANCE, eTimestampType, pxTime, &xVariance );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	return eTdfAddMulti( ucLoggerMask, TDF_STATS_SUMMARY, eTimestampType, pxTime, &xMagnitude );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAccDspSeed( xAccDsp_t *pxDsp, const int32_t plSample[NUM_AXES] )
+{
+	uint8_t i, j;
+	/* Assume the signal has been constant up until now to avoid a startup transient in every filter */
+	for ( i = 0; i < ACC_DSP_MAX_FIR_TAPS; i++ ) {
+		for ( j = 0; j < NUM_AXES; j++ ) {
+			pxDsp->plFirHistory[i][j] = plSample[j];
+		}
+	}
+	for ( j = 0; j < NUM_AXES; j++ ) {
+		pxDsp->plStatic[j] = plSample[j] * ( (int32_t) 1 << pxDsp->pxConfig->ucStaticShift );
+	}
+	pxDsp->bSeeded = true;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvAccDspDecimate( xAccDsp_t *pxDsp, const int32_t plSample[NUM_AXES], int32_t plOutput[NUM_AXES] )
+{
+	const xAccDspConfig_t *pxConfig = pxDsp->pxConfig;
+	uint8_t				   ucTap, ucIndex, j;
+	int64_t				   pllAccumulator[NUM_AXES];
+
+	if ( pxConfig->psFirTaps == NULL ) {
+		/* Boxcar average over the decimation period */
+		for ( j = 0; j < NUM_AXES; j++ ) {
+			pxDsp->plDecimationSum[j] += plSample[j];
+		}
+		if ( ++pxDsp->ucDecimationCount < pxConfig->ucDecimation ) {
+			return false;
+		}
+		for ( j = 0; j < NUM_AXES; j++ ) {
+			plOutput[j]				  = pxDsp->plDecimationSum[j] / pxConfig->ucDecimation;
+			pxDsp->plDecimationSum[j] = 0;
+		}
+		pxDsp->ucDecimationCount = 0;
+		return true;
+	}
+	/* Every input enters the history, but the filter is only evaluated on samples that will be output */
+	pxDsp->ucFirIndex = ( pxDsp->ucFirIndex + 1 ) % pxConfig->ucNumFirTaps;
+	for ( j = 0; j < NUM_AXES; j++ ) {
+		pxDsp->plFirHistory[pxDsp->ucFirIndex][j] = plSample[j];
+	}
+	if ( ++pxDsp->ucDecimationCount < pxConfig->ucDecimation ) {
+		return false;
+	}
+	pxDsp->ucDecimationCount = 0;
+
+	pllAccumulator[AXIS_X] = 0;
+	pllAccumulator[AXIS_Y] = 0;
+	pllAccumulator[AXIS_Z] = 0;
+	ucIndex				   = pxDsp->ucFirIndex;
+	for ( ucTap = 0; ucTap < pxConfig->ucNumFirTaps; ucTap++ ) {
+		for ( j = 0; j < NUM_AXES; j++ ) {
+			pllAccumulator[j] += (int64_t) pxConfig->psFirTaps[ucTap] * pxDsp->plFirHistory[ucIndex][j];
+		}
+		ucIndex = ( ucIndex == 0 ) ? ( pxConfig->ucNumFirTaps - 1 ) : ( ucIndex - 1 );
+	}
+	/* Q15 coefficients, round to nearest */
+	for ( j = 0; j < NUM_AXES; j++ ) {
+		plOutput[j] = (int32_t) ( ( pllAccumulator[j] + ( 1 << 14 ) ) >> 15 );
+	}
+	return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAccDspWindowReset( xAccDsp_t *pxDsp )
+{
+	uint8_t j;
+	vStatsReset( &pxDsp->xMagnitudeStats );
+	for ( j = 0; j < NUM_AXES; j++ ) {
+		vStatsReset( &pxDsp->pxAxisStats[j] );
+	}
+	pxDsp->ullOdbaSum	= 0;
+	pxDsp->ullVedbaSum   = 0;
+	pxDsp->usWindowCount = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAccDspWindowUpdate( xAccDsp_t *pxDsp, xAccelerometerSample_t *pxSample, uint32_t ulOdba, uint32_t ulVedba )
+{
+	vStatsUpdate( &pxDsp->xMagnitudeStats, (int32_t) ( pxSample->ulMagnitude >> ACC_DSP_FEATURE_SHIFT ) );
+	vStatsUpdate( &pxDsp->pxAxisStats[AXIS_X], pxSample->lX >> ACC_DSP_FEATURE_SHIFT );
+	vStatsUpdate( &pxDsp->pxAxisStats[AXIS_Y], pxSample->lY >> ACC_DSP_FEATURE_SHIFT );
+	vStatsUpdate( &pxDsp->pxAxisStats[AXIS_Z], pxSample->lZ >> ACC_DSP_FEATURE_SHIFT );
+	pxDsp->ullOdbaSum += ulOdba;
+	pxDsp->ullVedbaSum += ulVedba;
+
+	if ( ++pxDsp->usWindowCount >= pxDsp->pxConfig->usWindowSamples ) {
+		prvAccDspWindowComplete( pxDsp );
+		prvAccDspWindowReset( pxDsp );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAccDspWindowComplete( xAccDsp_t *pxDsp )
+{
+	const xAccDspConfig_t *pxConfig = pxDsp->pxConfig;
+	xAccDspFeatures_t	  xFeatures;
+	xStatsSummary_t		   xAxisSummary;
+
+	if ( pxConfig->fnWindowComplete == NULL ) {
+		return;
+	}
+	vStatsGetSummary( &pxDsp->xMagnitudeStats, &xFeatures.xMagnitude );
+	vStatsGetSummary( &pxDsp->pxAxisStats[AXIS_X], &xAxisSummary );
+	xFeatures.lVarianceX = xAxisSummary.variance;
+	vStatsGetSummary( &pxDsp->pxAxisStats[AXIS_Y], &xAxisSummary );
+	xFeatures.lVarianceY = xAxisSummary.variance;
+	vStatsGetSummary( &pxDsp->pxAxisStats[AXIS_Z], &xAxisSummary );
+	xFeatures.lVarianceZ = xAxisSummary.variance;
+
+	xFeatures.ulMeanOdba  = (uint32_t) ( pxDsp->ullOdbaSum / pxDsp->usWindowCount ) >> ACC_DSP_FEATURE_SHIFT;
+	xFeatures.ulMeanVedba = (uint32_t) ( pxDsp->ullVedbaSum / pxDsp->usWindowCount ) >> ACC_DSP_FEATURE_SHIFT;
+
+	if ( pxConfig->pulActivityBins != NULL ) {
+		xFeatures.cActivityClass = (int8_t) ucBinIndexLong( xFeatures.ulMeanOdba, pxConfig->pulActivityBins, pxConfig->ucNumActivityBins );
+	}
+	else {
+		xFeatures.cActivityClass = -1;
+	}
+	pxConfig->fnWindowComplete( &xFeatures, pxConfig->pvContext );
+}
+
+/*-----------------------------------------------------------*/
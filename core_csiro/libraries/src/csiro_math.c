@@ -15,6 +15,8 @@
 
 /* Private Defines ------------------------------------------*/
 // clang-format off
+#define SQRT_TABLE_OFFSET   64
+#define SQRT_SEED_OFFSET    128
 // clang-format on
 
 /* Type Definitions -----------------------------------------*/
@@ -23,27 +25,70 @@
 
 /* Private Variables ----------------------------------------*/
 
+// clang-format off
+/* ceil( 16 * sqrt( i + SQRT_TABLE_OFFSET + 1 ) ) - SQRT_SEED_OFFSET */
+static const uint8_t pucSquareRootSeed[192] = {
+	  1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,  16,
+	 16,  17,  18,  19,  20,  21,  22,  23,  23,  24,  25,  26,  27,  28,  28,  29,
+	 30,  31,  32,  32,  33,  34,  35,  36,  36,  37,  38,  39,  40,  40,  41,  42,
+	 43,  43,  44,  45,  46,  46,  47,  48,  48,  49,  50,  51,  51,  52,  53,  54,
+	 54,  55,  56,  56,  57,  58,  58,  59,  60,  60,  61,  62,  62,  63,  64,  64,
+	 65,  66,  66,  67,  68,  68,  69,  70,  70,  71,  72,  72,  73,  74,  74,  75,
+	 76,  76,  77,  77,  78,  79,  79,  80,  80,  81,  82,  82,  83,  84,  84,  85,
+	 85,  86,  87,  87,  88,  88,  89,  90,  90,  91,  91,  92,  92,  93,  94,  94,
+	 95,  95,  96,  96,  97,  98,  98,  99,  99, 100, 100, 101, 102, 102, 103, 103,
+	104, 104, 105, 105, 106, 107, 107, 108, 108, 109, 109, 110, 110, 111, 111, 112,
+	112, 113, 114, 114, 115, 115, 116, 116, 117, 117, 118, 118, 119, 119, 120, 120,
+	121, 121, 122, 122, 123, 123, 124, 124, 125, 125, 126, 126, 127, 127, 128, 128,
+};
+// clang-format on
+
 /* Functions ------------------------------------------------*/
 
 uint32_t ulSquareRoot( uint32_t ulInput )
 {
-	uint32_t op  = ulInput;
-	uint32_t res = 0;
-	uint32_t one = 1uL << 30; // The second-to-top bit is set: use 1u << 14 for uint16_t type; use 1uL<<30 for int32_t type
-	// "one" starts at the highest power of four <= than the argument.
-	while ( one > op ) {
-		one >>= 2;
+	uint32_t ulLog4, ulIndex, ulRoot, ulNext;
+	int32_t  lShift;
+
+	if ( ulInput == 0 ) {
+		return 0;
+	}
+	/* Normalise the input into [64, 256) with an even shift, so the root scales by an exact power of 2 */
+	ulLog4  = ( 31 - COUNT_LEADING_ZEROS( ulInput ) ) >> 1;
+	lShift  = ( 2 * (int32_t) ulLog4 ) - 6;
+	ulIndex = ( lShift >= 0 ) ? ( ulInput >> lShift ) : ( ulInput << -lShift );
+	/* Scale the table upper bound back to the input range, rounding up so it remains an upper bound */
+	ulRoot = pucSquareRootSeed[ulIndex - SQRT_TABLE_OFFSET] + SQRT_SEED_OFFSET;
+	lShift = (int32_t) ulLog4 - 7;
+	ulRoot = ( lShift >= 0 ) ? ( ulRoot << lShift ) : ( ( ulRoot + ( 1UL << -lShift ) - 1 ) >> -lShift );
+	/* Newton iteration from above decreases monotonically onto floor( sqrt( ulInput ) ), normally within 2 steps */
+	for ( ;; ) {
+		ulNext = ( ulRoot + ( ulInput / ulRoot ) ) >> 1;
+		if ( ulNext >= ulRoot ) {
+			return ulRoot;
+		}
+		ulRoot = ulNext;
 	}
+}
 
-	while ( one != 0 ) {
-		if ( op >= res + one ) {
-			op  = op - ( res + one );
-			res = res + 2 * one;
+/*-----------------------------------------------------------*/
+
+uint32_t ulSquareRootNewton( uint32_t ulInput )
+{
+	uint32_t ulRoot, ulNext;
+
+	if ( ulInput == 0 ) {
+		return 0;
+	}
+	/* 2 ^ ceil( bits / 2 ) is always greater than or equal to the root */
+	ulRoot = 1UL << ( ( 33 - COUNT_LEADING_ZEROS( ulInput ) ) >> 1 );
+	for ( ;; ) {
+		ulNext = ( ulRoot + ( ulInput / ulRoot ) ) >> 1;
+		if ( ulNext >= ulRoot ) {
+			return ulRoot;
 		}
-		res >>= 1;
-		one >>= 2;
+		ulRoot = ulNext;
 	}
-	return res;
 }
 
 /*-----------------------------------------------------------*/
@@ -70,16 +115,24 @@ uint32_t ulBitmaskIterate( uint32_t ulBitmask, uint32_t ulCurrentBit )
 /**
  * Testing the following comparison for index i:
  *          	(pucBins[i] <= ucValue < pucBins[i+1])
+ * 
+ * As the bins are sorted, this is the index of the first bin greater than ucValue
  */
 uint8_t ucBinIndexByte( uint8_t ucValue, const uint8_t *pucBins, uint8_t ucNumBins )
 {
-	uint8_t ucBin;
-	for ( ucBin = 0; ucBin < ucNumBins; ucBin++ ) {
-		if ( ucValue < pucBins[ucBin] ) {
-			break;
+	uint8_t ucLow  = 0;
+	uint8_t ucHigh = ucNumBins;
+	uint8_t ucMid;
+	while ( ucLow < ucHigh ) {
+		ucMid = ucLow + ( ( ucHigh - ucLow ) >> 1 );
+		if ( ucValue < pucBins[ucMid] ) {
+			ucHigh = ucMid;
+		}
+		else {
+			ucLow = ucMid + 1;
 		}
 	}
-	return ucBin;
+	return ucLow;
 }
 
 /*-----------------------------------------------------------*/
@@ -87,16 +140,24 @@ uint8_t ucBinIndexByte( uint8_t ucValue, const uint8_t *pucBins, uint8_t ucNumBi
 /**
  * Testing the following comparison for index i:
  *          	(pulBins[i] <= ulValue < pulBins[i+1])
+ * 
+ * As the bins are sorted, this is the index of the first bin greater than ulValue
  */
 uint8_t ucBinIndexLong( uint32_t ulValue, const uint32_t *pulBins, uint8_t ucNumBins )
 {
-	uint8_t ucBin;
-	for ( ucBin = 0; ucBin < ucNumBins; ucBin++ ) {
-		if ( ulValue < pulBins[ucBin] ) {
-			break;
+	uint8_t ucLow  = 0;
+	uint8_t ucHigh = ucNumBins;
+	uint8_t ucMid;
+	while ( ucLow < ucHigh ) {
+		ucMid = ucLow + ( ( ucHigh - ucLow ) >> 1 );
+		if ( ulValue < pulBins[ucMid] ) {
+			ucHigh = ucMid;
+		}
+		else {
+			ucLow = ucMid + 1;
 		}
 	}
-	return ucBin;
+	return ucLow;
 }
 
 /*-----------------------------------------------------------*/
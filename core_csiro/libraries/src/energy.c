@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "energy.h"
+
+#include "FreeRTOS.h"
+
+#include "board.h"
+#include "compiler_intrinsics.h"
+#include "csiro_math.h"
+#include "memory_operations.h"
+#include "rtc.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+#define SATURATE_U32( x )       ( (uint32_t) MIN( ( x ), UINT32_MAX ) )
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+/* Function Declarations ------------------------------------*/
+
+static uint64_t prvNow( void );
+static void		prvAccumulate( eEnergySubsystem_t eSubsystem, uint64_t ullNow );
+static uint64_t prvCharge( uint64_t ullTicksPermille, uint32_t ulMicroAmps );
+
+/* Private Variables ----------------------------------------*/
+
+/* The CPU is running from boot */
+static uint32_t ulActiveMask = ( 1UL << ENERGY_CPU );
+
+static uint64_t pullActive[ENERGY_SUBSYSTEMS];
+static uint64_t pullActiveSince[ENERGY_SUBSYSTEMS];
+static uint32_t pulEvents[ENERGY_SUBSYSTEMS];
+static uint16_t pusDuty[ENERGY_SUBSYSTEMS] = {
+	[0 ... ENERGY_SUBSYSTEMS - 1] = ENERGY_DUTY_FULL
+};
+
+static uint64_t ullPeriodStart = 0;
+static uint64_t ullLastNow	 = 0;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNow( void )
+{
+	/* The RTC overflow is counted in an interrupt, which can still be pending when the
+	 * counter is read from a masked context. Time never runs backwards here, a short
+	 * period is attributed late instead. */
+	uint64_t ullNow = ullRtcTickCount();
+	ullLastNow		= MAX( ullLastNow, ullNow );
+	return ullLastNow;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAccumulate( eEnergySubsystem_t eSubsystem, uint64_t ullNow )
+{
+	if ( ulActiveMask & ( 1UL << eSubsystem ) ) {
+		pullActive[eSubsystem] += ( ullNow - pullActiveSince[eSubsystem] ) * pusDuty[eSubsystem];
+		pullActiveSince[eSubsystem] = ullNow;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+void vEnergyActive( eEnergySubsystem_t eSubsystem, bool bActive )
+{
+	UBaseType_t uxMask;
+	uint32_t	ulBit = ( 1UL << eSubsystem );
+	uint64_t	ullNow;
+
+	configASSERT( eSubsystem < ENERGY_SUBSYSTEMS );
+	uxMask = portSET_INTERRUPT_MASK_FROM_ISR();
+	ullNow = prvNow();
+	if ( bActive != ( ( ulActiveMask & ulBit ) != 0 ) ) {
+		if ( bActive ) {
+			pullActiveSince[eSubsystem] = ullNow;
+			ulActiveMask |= ulBit;
+		}
+		else {
+			prvAccumulate( eSubsystem, ullNow );
+			ulActiveMask &= ~ulBit;
+		}
+	}
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxMask );
+}
+
+/*-----------------------------------------------------------*/
+
+void vEnergyDuty( eEnergySubsystem_t eSubsystem, uint16_t usPermille )
+{
+	UBaseType_t uxMask = portSET_INTERRUPT_MASK_FROM_ISR();
+	configASSERT( eSubsystem < ENERGY_SUBSYSTEMS );
+	/* Time already spent active is accounted at the previous duty cycle */
+	prvAccumulate( eSubsystem, prvNow() );
+	pusDuty[eSubsystem] = MIN( usPermille, ENERGY_DUTY_FULL );
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxMask );
+}
+
+/*-----------------------------------------------------------*/
+
+void vEnergyEvent( eEnergySubsystem_t eSubsystem, uint32_t ulEvents )
+{
+	UBaseType_t uxMask = portSET_INTERRUPT_MASK_FROM_ISR();
+	configASSERT( eSubsystem < ENERGY_SUBSYSTEMS );
+	pulEvents[eSubsystem] += ulEvents;
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxMask );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvCharge( uint64_t ullTicksPermille, uint32_t ulMicroAmps )
+{
+	/* uA * ticks * permille / ENERGY_TIMEBASE_HZ is charge in nC, split to avoid overflow */
+	return ( ( ullTicksPermille / ENERGY_TIMEBASE_HZ ) * ulMicroAmps ) + ( ( ( ullTicksPermille % ENERGY_TIMEBASE_HZ ) * ulMicroAmps ) / ENERGY_TIMEBASE_HZ );
+}
+
+/*-----------------------------------------------------------*/
+
+void vEnergyGet( xEnergyStats_t *pxStats, bool bReset )
+{
+	const xEnergyModel_t *pxModel = pxBoardEnergyModel();
+	UBaseType_t			  uxMask;
+	uint64_t			  ullNow;
+	uint8_t				  i;
+
+	uxMask = portSET_INTERRUPT_MASK_FROM_ISR();
+	ullNow = prvNow();
+	for ( i = 0; i < ENERGY_SUBSYSTEMS; i++ ) {
+		prvAccumulate( (eEnergySubsystem_t) i, ullNow );
+	}
+	pxStats->ullElapsed = ullNow - ullPeriodStart;
+	pvMemcpy( pxStats->pullActive, pullActive, sizeof( pullActive ) );
+	pvMemcpy( pxStats->pulEvents, pulEvents, sizeof( pulEvents ) );
+	if ( bReset ) {
+		pvMemset( pullActive, 0x00, sizeof( pullActive ) );
+		pvMemset( pulEvents, 0x00, sizeof( pulEvents ) );
+		ullPeriodStart = ullNow;
+	}
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxMask );
+
+	pxStats->ullBaseNanoCoulombs = prvCharge( pxStats->ullElapsed * ENERGY_DUTY_FULL, pxModel->ulBaseMicroAmps );
+	for ( i = 0; i < ENERGY_SUBSYSTEMS; i++ ) {
+		pxStats->pullNanoCoulombs[i] = prvCharge( pxStats->pullActive[i], pxModel->pulActiveMicroAmps[i] );
+		pxStats->pullNanoCoulombs[i] += (uint64_t) pxStats->pulEvents[i] * pxModel->pulEventNanoCoulombs[i];
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulEnergyAverageMicroAmps( xEnergyStats_t *pxStats )
+{
+	uint64_t ullTotal = pxStats->ullBaseNanoCoulombs;
+	uint8_t  i;
+
+	if ( pxStats->ullElapsed == 0 ) {
+		return 0;
+	}
+	for ( i = 0; i < ENERGY_SUBSYSTEMS; i++ ) {
+		ullTotal += pxStats->pullNanoCoulombs[i];
+	}
+	/* Charge in nC per second is current in nA */
+	return SATURATE_U32( ( ullTotal * ENERGY_TIMEBASE_HZ ) / ( pxStats->ullElapsed * 1000 ) );
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulEnergyLifetimeHours( xEnergyStats_t *pxStats )
+{
+	uint32_t ulCapacity = pxBoardEnergyModel()->ulBatteryMilliAmpHours;
+	uint32_t ulAverage  = ulEnergyAverageMicroAmps( pxStats );
+
+	if ( ( ulCapacity == 0 ) || ( ulAverage == 0 ) ) {
+		return 0;
+	}
+	return (uint32_t) ( ( (uint64_t) ulCapacity * 1000 ) / ulAverage );
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eEnergyLog( uint8_t ucLoggerMask, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, xEnergyStats_t *pxStats )
+{
+	tdf_energy_summary_t   xSummary;
+	tdf_energy_subsystem_t xSubsystem;
+	uint64_t			   ullTotal = pxStats->ullBaseNanoCoulombs;
+	eModuleError_t		   eError;
+	uint8_t				   i;
+
+	for ( i = 0; i < ENERGY_SUBSYSTEMS; i++ ) {
+		ullTotal += pxStats->pullNanoCoulombs[i];
+	}
+	xSummary.period_ms		 = SATURATE_U32( ( pxStats->ullElapsed * 1000 ) / ENERGY_TIMEBASE_HZ );
+	xSummary.charge			 = SATURATE_U32( ullTotal / 1000 );
+	xSummary.average_current = ulEnergyAverageMicroAmps( pxStats );
+	xSummary.lifetime		 = ulEnergyLifetimeHours( pxStats );
+	eError					 = eTdfAddMulti( ucLoggerMask, TDF_ENERGY_SUMMARY, eTimestampType, pxTime, &xSummary );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	for ( i = 0; i < ENERGY_SUBSYSTEMS; i++ ) {
+		if ( pxStats->pullNanoCoulombs[i] == 0 ) {
+			continue;
+		}
+		xSubsystem.subsystem = i;
+		xSubsystem.active_ms = SATURATE_U32( pxStats->pullActive[i] / ENERGY_TIMEBASE_HZ );
+		xSubsystem.events	= pxStats->pulEvents[i];
+		xSubsystem.charge	= SATURATE_U32( pxStats->pullNanoCoulombs[i] / 1000 );
+		eError				 = eTdfAddMulti( ucLoggerMask, TDF_ENERGY_SUBSYSTEM, eTimestampType, pxTime, &xSubsystem );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "fifo_timestamp.h"
+
+#include "csiro_math.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+#define FINE_FRACTION_BITS      24
+#define FINE_PER_TDF_FRACTION   ( 1 << ( FINE_FRACTION_BITS - 16 ) )
+
+// clang-format on
+
+/* Type Definitions -----------------------------------------*/
+
+/* Function Declarations ------------------------------------*/
+
+static uint64_t prvTdfToFine( xTdfTime_t *pxTime );
+static void		prvFineToTdf( uint64_t ullFine, xTdfTime_t *pxTime );
+static void		prvFifoTimestampResync( xFifoTimestamp_t *pxState, uint64_t ullObserved, uint8_t ucNumSamples );
+
+/* Private Variables ----------------------------------------*/
+
+/*-----------------------------------------------------------*/
+
+void vFifoTimestampInit( xFifoTimestamp_t *pxState, uint32_t ulNominalPeriodUs )
+{
+	configASSERT( ulNominalPeriodUs > 0 );
+	pxState->ulNominalPeriod = ( ( (uint64_t) ulNominalPeriodUs ) << FINE_FRACTION_BITS ) / 1000000;
+	vFifoTimestampReset( pxState );
+}
+
+/*-----------------------------------------------------------*/
+
+void vFifoTimestampReset( xFifoTimestamp_t *pxState )
+{
+	pxState->ulPeriod		= pxState->ulNominalPeriod;
+	pxState->ulBurstSpacing = pxState->ulNominalPeriod;
+	pxState->ullBoundary	= 0;
+	pxState->ullLastSample  = 0;
+	pxState->ullBurstStart  = 0;
+	pxState->ucBoundaries   = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void vFifoTimestampBurst( xFifoTimestamp_t *pxState, xTdfTime_t *pxBoundary, uint8_t ucNumSamples, xTdfTime_t *pxFirstSample, xTdfTime_t *pxSpacing )
+{
+	uint64_t ullObserved = prvTdfToFine( pxBoundary );
+	uint32_t ulTolerance = pxState->ulNominalPeriod >> FIFO_TIMESTAMP_TOLERANCE_SHIFT;
+	uint64_t ullPredicted;
+	int64_t  llError;
+	int64_t  llLimit;
+
+	ucNumSamples = MAX( 1, ucNumSamples );
+
+	if ( pxState->ucBoundaries == 0 ) {
+		/* Nothing to compare against, assume the nominal period */
+		prvFifoTimestampResync( pxState, ullObserved, ucNumSamples );
+		pxState->ucBoundaries = 1;
+	}
+	else {
+		if ( pxState->ucBoundaries == 1 ) {
+			/* Second boundary, the period can be measured directly for a fast initial lock */
+			uint32_t ulMeasured = ( ullObserved - pxState->ullBoundary ) / ucNumSamples;
+			if ( ( ulMeasured >= ( pxState->ulNominalPeriod - ulTolerance ) ) && ( ulMeasured <= ( pxState->ulNominalPeriod + ulTolerance ) ) ) {
+				pxState->ulPeriod	 = ulMeasured;
+				pxState->ucBoundaries = 2;
+			}
+		}
+		ullPredicted = pxState->ullLastSample + ( (uint64_t) ucNumSamples * pxState->ulPeriod );
+		llError		 = (int64_t) ( ullObserved - ullPredicted );
+		llLimit		 = ( (int64_t) ucNumSamples * pxState->ulPeriod ) / 2;
+
+		if ( ( llError > llLimit ) || ( llError < -llLimit ) ) {
+			/* Bursts were missed or the RTC was updated, restart the timeline from this boundary */
+			prvFifoTimestampResync( pxState, ullObserved, ucNumSamples );
+		}
+		else {
+			/* Integral term, per sample error corrects the period estimate */
+			int64_t llPeriod = (int64_t) pxState->ulPeriod + ( llError / ( (int64_t) ucNumSamples << FIFO_TIMESTAMP_FREQUENCY_SHIFT ) );
+			llPeriod		 = CLAMP( llPeriod, (int64_t) pxState->ulNominalPeriod + ulTolerance, (int64_t) pxState->ulNominalPeriod - ulTolerance );
+			/* Proportional term, slew the timeline towards the observed boundary */
+			uint64_t ullLastSample = ullPredicted + ( llError / ( 1 << FIFO_TIMESTAMP_PHASE_SHIFT ) );
+			/* Spread this burst evenly between the previous and current final samples */
+			pxState->ulBurstSpacing = ( ullLastSample - pxState->ullLastSample ) / ucNumSamples;
+			pxState->ullBurstStart  = pxState->ullLastSample + pxState->ulBurstSpacing;
+			pxState->ullLastSample  = ullLastSample;
+			pxState->ulPeriod		= (uint32_t) llPeriod;
+		}
+	}
+	pxState->ullBoundary = ullObserved;
+
+	if ( pxFirstSample != NULL ) {
+		prvFineToTdf( pxState->ullBurstStart, pxFirstSample );
+	}
+	if ( pxSpacing != NULL ) {
+		prvFineToTdf( pxState->ulBurstSpacing, pxSpacing );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+void vFifoTimestampSample( xFifoTimestamp_t *pxState, uint8_t ucIndex, xTdfTime_t *pxTime )
+{
+	prvFineToTdf( pxState->ullBurstStart + ( (uint64_t) ucIndex * pxState->ulBurstSpacing ), pxTime );
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eFifoTimestampLog( uint8_t ucLoggerMask, eTdfIds_t eTdfId, xFifoTimestamp_t *pxState, uint8_t *pucData, uint8_t ucNumSamples )
+{
+	eModuleError_t eError = ERROR_NONE;
+	uint8_t		   ucSize = pucTdfStructLengths[eTdfId];
+	xTdfTime_t	   xSampleTime;
+
+	for ( uint8_t i = 0; i < ucNumSamples; i++ ) {
+		vFifoTimestampSample( pxState, i, &xSampleTime );
+		/* eTdfAdd falls back to a global timestamp whenever a relative offset is not possible */
+		eModuleError_t eSampleError = eTdfAddMulti( ucLoggerMask, eTdfId, TDF_TIMESTAMP_RELATIVE_OFFSET_MS, &xSampleTime, pucData + ( i * ucSize ) );
+		if ( eSampleError != ERROR_NONE ) {
+			eError = eSampleError;
+		}
+	}
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFifoTimestampResync( xFifoTimestamp_t *pxState, uint64_t ullObserved, uint8_t ucNumSamples )
+{
+	pxState->ulBurstSpacing = pxState->ulPeriod;
+	pxState->ullBurstStart  = ullObserved - ( (uint64_t) ( ucNumSamples - 1 ) * pxState->ulPeriod );
+	pxState->ullLastSample  = ullObserved;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvTdfToFine( xTdfTime_t *pxTime )
+{
+	return ( ( (uint64_t) pxTime->ulSecondsSince2000 ) << FINE_FRACTION_BITS ) + ( (uint64_t) pxTime->usSecondsFraction * FINE_PER_TDF_FRACTION );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFineToTdf( uint64_t ullFine, xTdfTime_t *pxTime )
+{
+	/* Round to the nearest TDF fraction */
+	ullFine += FINE_PER_TDF_FRACTION / 2;
+	pxTime->ulSecondsSince2000 = (uint32_t) ( ullFine >> FINE_FRACTION_BITS );
+	pxTime->usSecondsFraction  = (uint16_t) ( ullFine / FINE_PER_TDF_FRACTION );
+}
+
+/*-----------------------------------------------------------*/
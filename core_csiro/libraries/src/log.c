@@ -9,6 +9,7 @@
 #include "FreeRTOS.h"
 
 #include "board.h"
+#include "crash_dump.h"
 #include "log.h"
 #include "tiny_printf.h"
 
@@ -88,6 +89,7 @@ eModuleError_t eLog( SerialLog_t eLog, LogLevel_t eLevel, const char *pcFormat,
 		return ERROR_INVALID_LOG_LEVEL;
 	}
 	if ( eLevel <= xLoggerLevels[eLog] ) {
+		vCrashDumpLogEvent( pcFormat );
 		va_start( va, pcFormat );
 		eError = pxSerialOutput->pxImplementation->fnWrite( pxSerialOutput->pvContext, pcFormat, va );
 		va_end( va );
@@ -7,16 +7,43 @@
 /* Includes -------------------------------------------------*/
 
 #include "FreeRTOS.h"
+#include "task.h"
 
 #include "log.h"
 #include "logger.h"
 
+#include "crc.h"
 #include "memory_operations.h"
 
 /* Private Defines ------------------------------------------*/
+// clang-format off
+
+/* Blocks between checkpoint records when commit markers are enabled */
+#ifndef LOGGER_CHECKPOINT_INTERVAL
+#define LOGGER_CHECKPOINT_INTERVAL  16
+#endif
+
+#define LOGGER_MAX_HEADER_SIZE      ( 1 + LOGGER_CHECKPOINT_SIZE + LOGGER_MARKER_SIZE )
+
+// clang-format on
 
 /* Type Definitions -----------------------------------------*/
 /* Function Declarations ------------------------------------*/
+
+static void		prvLoggerStartBlock( xLogger_t *pxLog );
+static void		prvLoggerSeal( xLogger_t *pxLog, uint8_t *pucBlock );
+static bool		prvLoggerBlockValid( xLogger_t *pxLog, uint32_t ulBlockNum, uint8_t *pucBlock );
+static bool		prvLoggerBlockFilled( xLogger_t *pxLog, uint8_t *pucBlock, uint16_t usStart, uint8_t ucFill );
+static void		prvLoggerInvalidate( xLogger_t *pxLog, uint32_t ulBlockNum, uint8_t *pucBlock, uint8_t ucWrapNumber );
+static void		prvLoggerRecover( xLogger_t *pxLog );
+static uint8_t	prvLoggerRecoverFirst( xLogger_t *pxLog );
+static void		prvMarkerEncode( xLogger_t *pxLog, uint8_t *pucWords, uint32_t ulValue, uint8_t ucNibbles );
+static bool		prvMarkerDecode( xLogger_t *pxLog, uint8_t *pucWords, uint32_t *pulValue, uint8_t ucNibbles );
+static uint16_t prvMarkerCrc( xLogger_t *pxLog, uint8_t *pucBlock, uint16_t usMarkerOffset );
+static void		prvFooterSeal( xLogger_t *pxLog, uint8_t *pucBlock );
+static eModuleError_t prvFooterVerify( xLogger_t *pxLog, uint32_t ulBlockNum, uint8_t *pucBlock );
+static void		prvLoggerScrubTask( void *pvParameters );
+
 /* Private Variables ----------------------------------------*/
 
 /* Functions ------------------------------------------------*/
@@ -31,20 +58,21 @@
 eModuleError_t eLoggerLog( xLogger_t *pxLog, uint16_t usNumBytes, void *pvLogData )
 {
 	uint16_t	   usMaxSize;
-	eModuleError_t eError = ERROR_NONE;
+	uint16_t	   usDataEnd = pxLog->usLogicalBlockSize - usLoggerBlockFooterSize( pxLog );
+	eModuleError_t eError	= ERROR_NONE;
 	uint8_t *	  pucWriteDataPointer;
 
 	eLog( LOG_LOGGER, LOG_VERBOSE, "eLoggerLog: FLAGS:%02X BLOCK:%lu ByteOffset:%d / %d\r\n",
 		  pxLog->ucFlags, pxLog->ulCurrentBlockAddress, pxLog->usBufferByteOffset, pxLog->usLogicalBlockSize );
 
-	// If data to log is too large to fit in the logger. (The allowable data size shrinks by one if wrapping is on.)
-	usMaxSize = ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) ? pxLog->usLogicalBlockSize - 1 : pxLog->usLogicalBlockSize;
+	// If data to log is too large to fit in the logger. (The allowable data size shrinks by the largest block header and the footer.)
+	usMaxSize = usDataEnd - ( ( pxLog->ucFlags & LOGGER_FLAG_COMMIT_MARKERS ) ? LOGGER_MAX_HEADER_SIZE : usLoggerBlockHeaderSize( pxLog, 0 ) );
 	if ( usNumBytes > usMaxSize ) {
 		return ERROR_DATA_TOO_LARGE;
 	}
 
 	// Will the new data fit on this page? If not, then commit the current buffer
-	if ( usNumBytes > ( pxLog->usLogicalBlockSize - pxLog->usBufferByteOffset ) ) {
+	if ( usNumBytes > ( usDataEnd - pxLog->usBufferByteOffset ) ) {
 		// Write current_buffer and switch the internal buffer to the other one
 		eError = eLoggerCommit( pxLog );
 
@@ -64,7 +92,7 @@ eModuleError_t eLoggerLog( xLogger_t *pxLog, uint16_t usNumBytes, void *pvLogDat
 	pxLog->usBufferByteOffset += usNumBytes;
 
 	/* If the buffer is currently full, send it off for commiting */
-	if ( pxLog->usBufferByteOffset == pxLog->usLogicalBlockSize ) {
+	if ( pxLog->usBufferByteOffset == usDataEnd ) {
 		eError = eLoggerCommit( pxLog );
 	}
 
@@ -84,7 +112,6 @@ eModuleError_t eLoggerLog( xLogger_t *pxLog, uint16_t usNumBytes, void *pvLogDat
 eModuleError_t eLoggerCommit( xLogger_t *pxLog )
 {
 	eModuleError_t eError = ERROR_NONE;
-	uint8_t		   ucWrappingEnabled;
 	uint8_t *	  pucWriteDataAddress;
 
 	eLog( LOG_LOGGER, LOG_VERBOSE, "eLoggerCommit: FLAGS:%02X BLOCK:%lu ByteOffset:%d\r\n",
@@ -92,11 +119,10 @@ eModuleError_t eLoggerCommit( xLogger_t *pxLog )
 
 	/** 
 	 * Make sure that the buffer we are committing actually contains data.
-	*  Basically if wrapping is one, the next block will already contain
-	*  the wrap number, but the block is still technically empty.
+	*  Basically if wrapping or commit markers are on, the next block will
+	*  already contain a header, but the block is still technically empty.
 	**/
-	ucWrappingEnabled = ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) != 0; // Will be one or zero.
-	if ( pxLog->usBufferByteOffset > ucWrappingEnabled ) {
+	if ( pxLog->usBufferByteOffset > usLoggerBlockHeaderSize( pxLog, pxLog->ulCurrentBlockAddress ) ) {
 		/* If current logical block address is larger than the total number of logical blocks in this logger. */
 		if ( pxLog->ulCurrentBlockAddress > pxLog->ulNumBlocks - 1 )
 			return ERROR_DEVICE_FULL;
@@ -111,6 +137,14 @@ eModuleError_t eLoggerCommit( xLogger_t *pxLog )
 		uint8_t *pucData	 = &pxLog->pucBuffer[pxLog->ucCurrentBuffer ? pxLog->usLogicalBlockSize : 0];
 		uint32_t ulBlockSize = ( ( pxLog->ucFlags & LOGGER_FLAG_COMMIT_ONLY_USED_BYTES ) ? pxLog->usBufferByteOffset : pxLog->usLogicalBlockSize );
 
+		if ( pxLog->ucFlags & LOGGER_FLAG_COMMIT_MARKERS ) {
+			prvLoggerSeal( pxLog, pucData );
+		}
+		/* Footer CRC covers the commit markers, so must be calculated last */
+		if ( pxLog->ucFlags & LOGGER_FLAG_BLOCK_FOOTER ) {
+			prvFooterSeal( pxLog, pucData );
+		}
+
 		eLog( LOG_LOGGER, LOG_INFO, "Logger TX: length = %i\r\n", ulBlockSize );
 		eError = pxLog->pxLoggerDevice->fnWriteBlock( ulBlockNum, pucData, ulBlockSize );
 
@@ -124,20 +158,16 @@ eModuleError_t eLoggerCommit( xLogger_t *pxLog )
 			/* If the device is full and wrapping is enabled, reset back to block 0 of the device */
 			if ( ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) && ( pxLog->ulCurrentBlockAddress >= pxLog->ulNumBlocks ) ) {
 				pxLog->ulCurrentBlockAddress = 0;
-				pxLog->ucWrapCounter++;
+				pxLog->ucWrapCounter = NEXT_WRAP_NUMBER( pxLog );
 			}
 		}
 		/* In wrap mode prepare the next block for writing */
 		if ( ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) && ( pxLog->ulCurrentBlockAddress < pxLog->ulNumBlocks ) ) {
-			pxLog->pxLoggerDevice->fnPrepareBlock( pxLog->ulCurrentBlockAddress );
+			pxLog->pxLoggerDevice->fnPrepareBlock( pxLog->ulStartBlockAddress + pxLog->ulCurrentBlockAddress );
 		}
 
-		pxLog->usBufferByteOffset = 0;
-		/* If wrapping is on, set the first byte in the new buffer to the wrap number */
-		if ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) {
-			pxLog->pucBuffer[pxLog->ucCurrentBuffer ? pxLog->usLogicalBlockSize : 0] = PHYSICAL_WRAP_NUMBER( pxLog );
-			pxLog->usBufferByteOffset												 = 1;
-		}
+		/* Reserve the header of the new buffer */
+		prvLoggerStartBlock( pxLog );
 	}
 
 	return eError;
@@ -154,20 +184,23 @@ eModuleError_t eLoggerCommit( xLogger_t *pxLog )
 eModuleError_t eLoggerConfigure( xLogger_t *pxLog, uint16_t usSetting, void *pvConfValue )
 {
 	eModuleError_t eError = ERROR_NONE;
-	uint32_t	   ulDeviceLength;
+	uint32_t	   ulDeviceLength, ulEndBlock;
 	uint8_t		   usMatchBuffer;
 
-	uint8_t *pucCurrentBuffer = &( pxLog->pucBuffer[( pxLog->ucCurrentBuffer ) ? pxLog->usLogicalBlockSize : 0] );
 	uint8_t *pucUnusedBuffer  = &( pxLog->pucBuffer[( !pxLog->ucCurrentBuffer ) ? pxLog->usLogicalBlockSize : 0] );
 
 	switch ( usSetting ) {
 		case LOGGER_CONFIG_INIT_DEVICE:
+			/* Devices that manage their own layout need to know where the logger starts */
+			eLoggerConfigure( pxLog, LOGGER_CONFIG_SET_START_BLOCK, &pxLog->ulStartBlockAddress );
 			/* Logger length should be automatically configured */
 			if ( pxLog->ulNumBlocks == LOGGER_LENGTH_REMAINING_BLOCKS ) {
 				/* Query the device for its total length */
 				eLoggerConfigure( pxLog, LOGGER_CONFIG_GET_NUM_BLOCKS, &ulDeviceLength );
 				pxLog->ulNumBlocks = ulDeviceLength - pxLog->ulStartBlockAddress;
 			}
+			ulEndBlock = pxLog->ulStartBlockAddress + pxLog->ulNumBlocks;
+			eLoggerConfigure( pxLog, LOGGER_CONFIG_SET_END_BLOCK, &ulEndBlock );
 			/* Query the device for the erase byte */
 			eLoggerConfigure( pxLog, LOGGER_CONFIG_GET_CLEAR_BYTE, &pxLog->ucClearByte );
 			/* Setup initial flags */
@@ -196,6 +229,10 @@ eModuleError_t eLoggerConfigure( xLogger_t *pxLog, uint16_t usSetting, void *pvC
 			pxLog->ucFlags |= LOGGER_FLAG_WRAPPING_ON;
 			/* Get the current wrap number */
 			eLoggerReadBlock( pxLog, 0, 0, pucUnusedBuffer );
+			/* The first block is unreliable if power was lost while erasing or writing it */
+			if ( pxLog->ucFlags & LOGGER_FLAG_COMMIT_MARKERS ) {
+				pucUnusedBuffer[0] = prvLoggerRecoverFirst( pxLog );
+			}
 			pxLog->ucWrapCounter	 = LOGICAL_WRAP_NUMBER( pxLog, pucUnusedBuffer[0] );
 			uint8_t ucCompletedWraps = pxLog->ucWrapCounter;
 			/* Only need to scan if the first byte does not match the erase byte */
@@ -205,8 +242,9 @@ eModuleError_t eLoggerConfigure( xLogger_t *pxLog, uint16_t usSetting, void *pvC
 				eLoggerSearch( pxLog, 1, &usMatchBuffer, LOGGER_SEARCH_BINARY_SEARCH | LOGGER_SEARCH_NOT_MATCH, &pxLog->ulCurrentBlockAddress );
 				/* If all the pages have the same wrap number, we are back at the start of the device again */
 				if ( pxLog->ulCurrentBlockAddress >= pxLog->ulNumBlocks ) {
-					pxLog->ucWrapCounter++;
+					pxLog->ucWrapCounter = NEXT_WRAP_NUMBER( pxLog );
 					pxLog->ulCurrentBlockAddress = 0;
+					ucCompletedWraps++;
 				}
 			}
 			else {
@@ -214,17 +252,35 @@ eModuleError_t eLoggerConfigure( xLogger_t *pxLog, uint16_t usSetting, void *pvC
 				pxLog->ulCurrentBlockAddress = 0;
 				ucCompletedWraps			 = 0;
 			}
-			pxLog->usBufferByteOffset = 1;							   // reset the byte offset
-			pucCurrentBuffer[0]		  = PHYSICAL_WRAP_NUMBER( pxLog ); // set first byte to num_wraps
-			pxLog->ulPagesWritten	 = ( ucCompletedWraps * pxLog->ulNumBlocks ) + pxLog->ulCurrentBlockAddress;
+			pxLog->ulPagesWritten = ( ucCompletedWraps * pxLog->ulNumBlocks ) + pxLog->ulCurrentBlockAddress;
+			if ( pxLog->ucFlags & LOGGER_FLAG_COMMIT_MARKERS ) {
+				prvLoggerRecover( pxLog );
+			}
+			/* Reset the byte offset and set the first byte to num_wraps */
+			prvLoggerStartBlock( pxLog );
 			/* Prepare the first block for writing */
-			pxLog->pxLoggerDevice->fnPrepareBlock( pxLog->ulCurrentBlockAddress );
+			pxLog->pxLoggerDevice->fnPrepareBlock( pxLog->ulStartBlockAddress + pxLog->ulCurrentBlockAddress );
 			break;
 		case LOGGER_CONFIG_APPEND_MODE:
 			usMatchBuffer = pxLog->ucClearByte;
 			eLog( LOG_LOGGER, LOG_INFO, "LOGGER_CONFIG: match:%02X\r\n", usMatchBuffer );
 			eLoggerSearch( pxLog, 1, &usMatchBuffer, LOGGER_SEARCH_BINARY_SEARCH, &pxLog->ulCurrentBlockAddress );
 			pxLog->ulPagesWritten = pxLog->ulCurrentBlockAddress;
+			if ( pxLog->ucFlags & LOGGER_FLAG_COMMIT_MARKERS ) {
+				prvLoggerRecover( pxLog );
+				prvLoggerStartBlock( pxLog );
+			}
+			break;
+		case LOGGER_CONFIG_COMMIT_MARKERS:
+			/* Markers cover the whole block, so full blocks must be committed */
+			pxLog->ucFlags |= LOGGER_FLAG_COMMIT_MARKERS | LOGGER_FLAG_CLEAR_UNUSED_BYTES;
+			pxLog->ucFlags &= ~LOGGER_FLAG_COMMIT_ONLY_USED_BYTES;
+			prvLoggerStartBlock( pxLog );
+			break;
+		case LOGGER_CONFIG_BLOCK_FOOTER:
+			/* Footers are at the end of the block, so full blocks must be committed */
+			pxLog->ucFlags |= LOGGER_FLAG_BLOCK_FOOTER | LOGGER_FLAG_CLEAR_UNUSED_BYTES;
+			pxLog->ucFlags &= ~LOGGER_FLAG_COMMIT_ONLY_USED_BYTES;
 			break;
 		default:
 			eError = pxLog->pxLoggerDevice->fnConfigure( (uint32_t) usSetting, pvConfValue );
@@ -257,6 +313,15 @@ eModuleError_t eLoggerStatus( xLogger_t *pxLog, uint16_t usType, void *pvStatus
 			/* TODO: Make this do something logical... */
 			*( (uint32_t *) pvStatus ) = pxLog->pxLoggerDevice->fnStatus( 0 );
 			break;
+		case LOGGER_STATUS_TORN_BLOCKS:
+			*( (uint32_t *) pvStatus ) = pxLog->ulTornBlocks;
+			break;
+		case LOGGER_STATUS_CORRUPT_BLOCKS:
+			*( (uint32_t *) pvStatus ) = pxLog->ulCorruptBlocks;
+			break;
+		case LOGGER_STATUS_PAGES_ESTIMATED:
+			*( (bool *) pvStatus ) = ( pxLog->ucFlags & LOGGER_FLAG_PAGES_ESTIMATED ) != 0;
+			break;
 		default:
 			return ERROR_DEFAULT_CASE;
 	}
@@ -271,14 +336,25 @@ eModuleError_t eLoggerStatus( xLogger_t *pxLog, uint16_t usType, void *pvStatus
  * Reads a logical block of data from the log at the specified BlockNum.
  * A BlockNum of 0 will be the first page of the logger. On underlying hardware
  * which support reading, loggers can read from them.
+ * 
+ * If block footers are enabled, reads of complete blocks (usBlockOffset of 0)
+ * are verified. ERROR_INVALID_CRC is returned for corrupt or partially programmed
+ * blocks, and ERROR_INVALID_DATA for blocks with an unexpected sequence number.
+ * Erased blocks and blocks invalidated on initialisation are not errors.
  */
 eModuleError_t eLoggerReadBlock( xLogger_t *pxLog, uint32_t ulBlockNum, uint16_t usBlockOffset, void *pvBlockData )
 {
+	eModuleError_t eError;
+
 	eLog( LOG_LOGGER, LOG_INFO, "Logger Read Block Num: %lu\r\n", ulBlockNum );
 	if ( ulBlockNum >= pxLog->ulNumBlocks ) {
 		return ERROR_INVALID_ADDRESS;
 	}
-	return pxLog->pxLoggerDevice->fnReadBlock( pxLog->ulStartBlockAddress + ulBlockNum, usBlockOffset, pvBlockData, pxLog->usLogicalBlockSize - usBlockOffset );
+	eError = pxLog->pxLoggerDevice->fnReadBlock( pxLog->ulStartBlockAddress + ulBlockNum, usBlockOffset, pvBlockData, pxLog->usLogicalBlockSize - usBlockOffset );
+	if ( ( eError == ERROR_NONE ) && ( usBlockOffset == 0 ) && ( pxLog->ucFlags & LOGGER_FLAG_BLOCK_FOOTER ) ) {
+		eError = prvFooterVerify( pxLog, ulBlockNum, pvBlockData );
+	}
+	return eError;
 }
 
 /*-----------------------------------------------------------*/
@@ -357,6 +433,71 @@ eModuleError_t eLoggerSearch( xLogger_t *pxLog, uint16_t usNumBytes, uint8_t *pu
 
 /*-----------------------------------------------------------*/
 
+uint16_t usLoggerBlockHeaderSize( xLogger_t *pxLog, uint32_t ulBlockNum )
+{
+	uint16_t usSize = ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) ? 1 : 0;
+	if ( pxLog->ucFlags & LOGGER_FLAG_COMMIT_MARKERS ) {
+		usSize += LOGGER_MARKER_SIZE;
+		usSize += ( ulBlockNum % LOGGER_CHECKPOINT_INTERVAL == 0 ) ? LOGGER_CHECKPOINT_SIZE : 0;
+	}
+	return usSize;
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t usLoggerBlockFooterSize( xLogger_t *pxLog )
+{
+	return ( pxLog->ucFlags & LOGGER_FLAG_BLOCK_FOOTER ) ? LOGGER_FOOTER_SIZE : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eLoggerScrubBlock( xLoggerScrub_t *pxScrub )
+{
+	xLogger_t *	pxLog   = pxScrub->pxLog;
+	uint32_t	   ulBlock = pxScrub->ulNextBlock;
+	eModuleError_t eError  = ERROR_NONE;
+	bool		   bWritten;
+
+	/* The head block is being written, other blocks are only committed once wrapping has begun */
+	bWritten = ( ulBlock != pxLog->ulCurrentBlockAddress ) && ( ( ulBlock < pxLog->ulCurrentBlockAddress ) || ( pxLog->ulPagesWritten >= pxLog->ulNumBlocks ) );
+	if ( bWritten ) {
+		eError = eLoggerReadBlock( pxLog, ulBlock, 0, pxScrub->pucBuffer );
+		/* The erase unit ahead of the head can be erased while we are reading, so confirm failures */
+		if ( ( eError == ERROR_INVALID_CRC ) || ( eError == ERROR_INVALID_DATA ) ) {
+			eError = eLoggerReadBlock( pxLog, ulBlock, 0, pxScrub->pucBuffer );
+		}
+		if ( ( eError == ERROR_INVALID_CRC ) || ( eError == ERROR_INVALID_DATA ) ) {
+			eLog( LOG_LOGGER, LOG_ERROR, "Logger %s: Block %d corrupt\r\n", pxLog->pucDescription, ulBlock );
+			pxScrub->ulPassCorrupt++;
+		}
+		pxScrub->ulBlocksChecked++;
+	}
+	/* Wait until the pass is complete before publishing the count */
+	if ( ++pxScrub->ulNextBlock >= pxLog->ulNumBlocks ) {
+		pxLog->ulCorruptBlocks = pxScrub->ulPassCorrupt;
+		eLog( LOG_LOGGER, LOG_INFO, "Logger %s: Scrub %d complete, %d corrupt blocks\r\n", pxLog->pucDescription, pxScrub->ulPasses, pxScrub->ulPassCorrupt );
+		pxScrub->ulNextBlock   = 0;
+		pxScrub->ulPassCorrupt = 0;
+		pxScrub->ulPasses++;
+	}
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+void vLoggerScrubStart( xLoggerScrub_t *pxScrub, UBaseType_t uxPriority )
+{
+	configASSERT( pxScrub->pxLog->ucFlags & LOGGER_FLAG_BLOCK_FOOTER );
+	pxScrub->ulNextBlock	 = 0;
+	pxScrub->ulPassCorrupt   = 0;
+	pxScrub->ulBlocksChecked = 0;
+	pxScrub->ulPasses		 = 0;
+	xTaskCreate( prvLoggerScrubTask, "Scrub", configMINIMAL_STACK_SIZE, pxScrub, uxPriority, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
 void vLoggerPrint( xLogger_t *pxLog, SerialLog_t eLogger, LogLevel_t eLevel )
 {
 	const char *pucOn  = "Enabled";
@@ -394,3 +535,249 @@ void vLoggerPrint( xLogger_t *pxLog, SerialLog_t eLogger, LogLevel_t eLevel )
 }
 
 /*-----------------------------------------------------------*/
+
+static void prvLoggerStartBlock( xLogger_t *pxLog )
+{
+	uint8_t *pucBlock = &pxLog->pucBuffer[pxLog->ucCurrentBuffer ? pxLog->usLogicalBlockSize : 0];
+	/* Marker contents are only known once the block is complete, see prvLoggerSeal */
+	pxLog->usBufferByteOffset = usLoggerBlockHeaderSize( pxLog, pxLog->ulCurrentBlockAddress );
+	/* If wrapping is on, set the first byte in the new buffer to the wrap number */
+	if ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) {
+		pucBlock[0] = PHYSICAL_WRAP_NUMBER( pxLog );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvLoggerSeal( xLogger_t *pxLog, uint8_t *pucBlock )
+{
+	uint16_t usOffset = ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) ? 1 : 0;
+
+	if ( pxLog->ulCurrentBlockAddress % LOGGER_CHECKPOINT_INTERVAL == 0 ) {
+		/* Total pages written is lost once the 8 bit wrap counter overflows, so checkpoint it periodically */
+		prvMarkerEncode( pxLog, pucBlock + usOffset, pxLog->ulPagesWritten, LOGGER_CHECKPOINT_SIZE / 2 );
+		usOffset += LOGGER_CHECKPOINT_SIZE;
+	}
+	prvMarkerEncode( pxLog, pucBlock + usOffset, prvMarkerCrc( pxLog, pucBlock, usOffset ), LOGGER_MARKER_SIZE / 2 );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvLoggerBlockValid( xLogger_t *pxLog, uint32_t ulBlockNum, uint8_t *pucBlock )
+{
+	uint16_t usOffset = usLoggerBlockHeaderSize( pxLog, ulBlockNum ) - LOGGER_MARKER_SIZE;
+	uint32_t ulCrc;
+
+	if ( eLoggerReadBlock( pxLog, ulBlockNum, 0, pucBlock ) != ERROR_NONE ) {
+		return false;
+	}
+	if ( !prvMarkerDecode( pxLog, pucBlock + usOffset, &ulCrc, LOGGER_MARKER_SIZE / 2 ) ) {
+		return false;
+	}
+	return ulCrc == prvMarkerCrc( pxLog, pucBlock, usOffset );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvLoggerBlockFilled( xLogger_t *pxLog, uint8_t *pucBlock, uint16_t usStart, uint8_t ucFill )
+{
+	for ( uint16_t i = usStart; i < pxLog->usLogicalBlockSize; i++ ) {
+		if ( pucBlock[i] != ucFill ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvLoggerInvalidate( xLogger_t *pxLog, uint32_t ulBlockNum, uint8_t *pucBlock, uint8_t ucWrapNumber )
+{
+	/* Programming the inverse of the erase byte is possible over any content, and decodes as TDF padding */
+	pvMemset( pucBlock, (uint8_t) ~pxLog->ucClearByte, pxLog->usLogicalBlockSize );
+	if ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) {
+		pucBlock[0] = ucWrapNumber;
+	}
+	pxLog->pxLoggerDevice->fnWriteBlock( pxLog->ulStartBlockAddress + ulBlockNum, pucBlock, pxLog->usLogicalBlockSize );
+	pxLog->ulTornBlocks++;
+	eLog( LOG_LOGGER, LOG_ERROR, "Logger: Block %d torn by interrupted write\r\n", ulBlockNum );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t prvLoggerRecoverFirst( xLogger_t *pxLog )
+{
+	uint8_t *pucIdleBuffer = &pxLog->pucBuffer[( !pxLog->ucCurrentBuffer ) ? pxLog->usLogicalBlockSize : 0];
+	bool	 bErased;
+
+	if ( prvLoggerBlockValid( pxLog, 0, pucIdleBuffer ) || prvLoggerBlockFilled( pxLog, pucIdleBuffer, 1, ~pxLog->ucClearByte ) ) {
+		return pucIdleBuffer[0];
+	}
+	bErased = prvLoggerBlockFilled( pxLog, pucIdleBuffer, 0, pxLog->ucClearByte );
+	/* Block 0 is only erased or written after the final block of the previous wrap, which holds the previous wrap number */
+	eLoggerReadBlock( pxLog, pxLog->ulNumBlocks - 1, 0, pucIdleBuffer );
+	if ( pucIdleBuffer[0] == pxLog->ucClearByte ) {
+		/* No previous wrap, either a new log or block 0 was torn */
+		pxLog->ucWrapCounter = 0;
+		if ( bErased ) {
+			return pxLog->ucClearByte;
+		}
+	}
+	else {
+		pxLog->ucWrapCounter = LOGICAL_WRAP_NUMBER( pxLog, pucIdleBuffer[0] );
+		pxLog->ucWrapCounter = NEXT_WRAP_NUMBER( pxLog );
+	}
+	if ( !bErased ) {
+		prvLoggerInvalidate( pxLog, 0, pucIdleBuffer, PHYSICAL_WRAP_NUMBER( pxLog ) );
+	}
+	return PHYSICAL_WRAP_NUMBER( pxLog );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvLoggerRecover( xLogger_t *pxLog )
+{
+	uint8_t *pucIdleBuffer = &pxLog->pucBuffer[( !pxLog->ucCurrentBuffer ) ? pxLog->usLogicalBlockSize : 0];
+	bool	 bWrapping	 = ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) != 0;
+	uint8_t	 ucInvalid	 = ~pxLog->ucClearByte;
+	uint32_t ulHead		   = pxLog->ulCurrentBlockAddress;
+	uint32_t ulLast, ulCheckpoint, ulPages, i;
+	bool	 bExpected;
+
+	/* The final committed block may have been interrupted after its first byte was programmed */
+	ulLast = ( ulHead + pxLog->ulNumBlocks - 1 ) % pxLog->ulNumBlocks;
+	if ( ( pxLog->ulPagesWritten > 0 ) && !prvLoggerBlockValid( pxLog, ulLast, pucIdleBuffer ) &&
+		 !prvLoggerBlockFilled( pxLog, pucIdleBuffer, bWrapping ? 1 : 0, ucInvalid ) ) {
+		/* The search has already validated the wrap number of this block */
+		prvLoggerInvalidate( pxLog, ulLast, pucIdleBuffer, pucIdleBuffer[0] );
+	}
+	/**
+	 * The head block may have been interrupted before its first byte was programmed, writing over it would corrupt the new block.
+	 * The head should either be erased, or in wrap mode an intact block from the previous wrap which will be erased before use.
+	 **/
+	if ( ulHead < pxLog->ulNumBlocks ) {
+		bExpected = prvLoggerBlockValid( pxLog, ulHead, pucIdleBuffer ) && bWrapping;
+		bExpected = bExpected || prvLoggerBlockFilled( pxLog, pucIdleBuffer, 0, pxLog->ucClearByte );
+		bExpected = bExpected || ( bWrapping && prvLoggerBlockFilled( pxLog, pucIdleBuffer, 1, ucInvalid ) );
+		if ( !bExpected ) {
+			prvLoggerInvalidate( pxLog, ulHead, pucIdleBuffer, PHYSICAL_WRAP_NUMBER( pxLog ) );
+			pxLog->ulCurrentBlockAddress++;
+			pxLog->ulPagesWritten++;
+			if ( bWrapping && ( pxLog->ulCurrentBlockAddress >= pxLog->ulNumBlocks ) ) {
+				pxLog->ulCurrentBlockAddress = 0;
+				pxLog->ucWrapCounter = NEXT_WRAP_NUMBER( pxLog );
+			}
+			ulHead = pxLog->ulCurrentBlockAddress;
+			ulLast = ( ulHead + pxLog->ulNumBlocks - 1 ) % pxLog->ulNumBlocks;
+		}
+	}
+	/* The wrap byte only tracks 255 wraps, recover the full count from the most recent intact checkpoint */
+	ulCheckpoint = ulLast - ( ulLast % LOGGER_CHECKPOINT_INTERVAL );
+	for ( i = 0; bWrapping && ( pxLog->ulPagesWritten > 0 ) && ( i <= pxLog->ulNumBlocks / LOGGER_CHECKPOINT_INTERVAL ); i++ ) {
+		if ( prvLoggerBlockValid( pxLog, ulCheckpoint, pucIdleBuffer ) && prvMarkerDecode( pxLog, pucIdleBuffer + 1, &ulPages, LOGGER_CHECKPOINT_SIZE / 2 ) ) {
+			pxLog->ulPagesWritten = ulPages + ( ( ulLast + pxLog->ulNumBlocks - ulCheckpoint ) % pxLog->ulNumBlocks ) + 1;
+			break;
+		}
+		/* Continue into the previous wrap if required */
+		ulCheckpoint = ( ulCheckpoint == 0 ) ? ( pxLog->ulNumBlocks - 1 ) - ( ( pxLog->ulNumBlocks - 1 ) % LOGGER_CHECKPOINT_INTERVAL ) : ulCheckpoint - LOGGER_CHECKPOINT_INTERVAL;
+	}
+	/* Every checkpoint was torn, the count from the wrap number may be short by a multiple of 255 wraps */
+	if ( bWrapping && ( pxLog->ulPagesWritten > 0 ) && ( i > pxLog->ulNumBlocks / LOGGER_CHECKPOINT_INTERVAL ) ) {
+		pxLog->ucFlags |= LOGGER_FLAG_PAGES_ESTIMATED;
+		eLog( LOG_LOGGER, LOG_ERROR, "Logger: No intact checkpoint, pages written is only known modulo 255 wraps\r\n" );
+	}
+	eLog( LOG_LOGGER, LOG_INFO, "Logger: Recovered head %d, %d pages written\r\n", pxLog->ulCurrentBlockAddress, pxLog->ulPagesWritten );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvMarkerEncode( xLogger_t *pxLog, uint8_t *pucWords, uint32_t ulValue, uint8_t ucNibbles )
+{
+	/* Low 12 bits of each word are the TDF ID, which must not match the erase pattern */
+	uint16_t usPadding = ( pxLog->ucClearByte == 0x00 ) ? 0x0FFF : 0x0000;
+	uint16_t usWord;
+	for ( uint8_t i = 0; i < ucNibbles; i++ ) {
+		usWord			   = ( ( ulValue >> ( 4 * i ) ) & 0xF ) << 12 | usPadding;
+		pucWords[2 * i]	= usWord & 0xFF;
+		pucWords[2 * i + 1] = usWord >> 8;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvMarkerDecode( xLogger_t *pxLog, uint8_t *pucWords, uint32_t *pulValue, uint8_t ucNibbles )
+{
+	uint16_t usPadding = ( pxLog->ucClearByte == 0x00 ) ? 0x0FFF : 0x0000;
+	uint16_t usWord;
+	*pulValue = 0;
+	for ( uint8_t i = 0; i < ucNibbles; i++ ) {
+		usWord = pucWords[2 * i] | ( pucWords[2 * i + 1] << 8 );
+		if ( ( usWord & 0x0FFF ) != usPadding ) {
+			return false;
+		}
+		*pulValue |= ( uint32_t )( usWord >> 12 ) << ( 4 * i );
+	}
+	return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvMarkerCrc( xLogger_t *pxLog, uint8_t *pucBlock, uint16_t usMarkerOffset )
+{
+	uint16_t usAfter = usMarkerOffset + LOGGER_MARKER_SIZE;
+	/* Block footer is written after the markers, see prvFooterSeal */
+	uint16_t usEnd = pxLog->usLogicalBlockSize - usLoggerBlockFooterSize( pxLog );
+	vCrcStart( CRC16_CCITT, 0xFFFF );
+	ulCrcCalculate( pucBlock, usMarkerOffset, false );
+	return (uint16_t) ulCrcCalculate( pucBlock + usAfter, usEnd - usAfter, true );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFooterSeal( xLogger_t *pxLog, uint8_t *pucBlock )
+{
+	uint16_t usCrcOffset = pxLog->usLogicalBlockSize - sizeof( uint16_t );
+	uint16_t usCrc;
+
+	LE_U32_PACK( pucBlock + pxLog->usLogicalBlockSize - LOGGER_FOOTER_SIZE, pxLog->ulPagesWritten );
+	vCrcStart( CRC16_CCITT, 0xFFFF );
+	usCrc = (uint16_t) ulCrcCalculate( pucBlock, usCrcOffset, true );
+	LE_U16_PACK( pucBlock + usCrcOffset, usCrc );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvFooterVerify( xLogger_t *pxLog, uint32_t ulBlockNum, uint8_t *pucBlock )
+{
+	uint16_t usCrcOffset = pxLog->usLogicalBlockSize - sizeof( uint16_t );
+	uint32_t ulSequence  = LE_U32_EXTRACT( pucBlock + pxLog->usLogicalBlockSize - LOGGER_FOOTER_SIZE );
+
+	/* Erased blocks, and blocks invalidated by prvLoggerInvalidate, have no footer */
+	if ( prvLoggerBlockFilled( pxLog, pucBlock, 0, pxLog->ucClearByte ) ||
+		 prvLoggerBlockFilled( pxLog, pucBlock, ( pxLog->ucFlags & LOGGER_FLAG_WRAPPING_ON ) ? 1 : 0, ~pxLog->ucClearByte ) ) {
+		return ERROR_NONE;
+	}
+	vCrcStart( CRC16_CCITT, 0xFFFF );
+	if ( LE_U16_EXTRACT( pucBlock + usCrcOffset ) != (uint16_t) ulCrcCalculate( pucBlock, usCrcOffset, true ) ) {
+		return ERROR_INVALID_CRC;
+	}
+	/* A valid block in the wrong location, for example a misdirected write */
+	if ( ( ulSequence % pxLog->ulNumBlocks ) != ulBlockNum ) {
+		return ERROR_INVALID_DATA;
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvLoggerScrubTask( void *pvParameters )
+{
+	xLoggerScrub_t *pxScrub = (xLoggerScrub_t *) pvParameters;
+
+	for ( ;; ) {
+		eLoggerScrubBlock( pxScrub );
+		vTaskDelay( pxScrub->xBlockPeriod );
+	}
+}
+
+/*-----------------------------------------------------------*/
@@ -30,6 +30,12 @@ eModuleError_t prvMirrorSameSizes( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t
 eModuleError_t prvMirrorSrcLarger( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t ulLostSrcPages );
 eModuleError_t prvMirrorDstLarger( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t ulLostSrcPages );
 
+static eModuleError_t prvMirrorTdfBlock( xLogger_t *pxDst, xLogMirrorTdf_t *pxState, uint8_t *pucBlock, uint32_t ulLength );
+static eModuleError_t prvMirrorTdfEmit( xLogger_t *pxDst, xLogMirrorTdf_t *pxState, xTdf_t *pxTdf, uint16_t usPreferred );
+static eModuleError_t prvMirrorTdfSegment( xLogger_t *pxDst, xLogMirrorTdf_t *pxState, uint8_t *pucSegment, uint32_t ulLength, xTdfTime_t *pxLastTime );
+static uint16_t		  prvMirrorTdfTimestamp( xLogger_t *pxDst, xLogMirrorTdf_t *pxState, xTdfTime_t *pxTime, uint16_t usPreferred, uint16_t *pusOffset );
+static uint16_t		  prvMirrorTdfMaxPayload( xLogger_t *pxDst );
+
 /* Private Variables ----------------------------------------*/
 
 uint8_t pucCopyBuffer[COPY_BUFFER_SIZE];
@@ -87,7 +93,7 @@ eModuleError_t eLogMirror( xLogger_t *pxSrc, xLogger_t *pxDst )
 eModuleError_t prvMirrorSameSizes( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t ulLostSrcPages )
 {
 	uint32_t ulActualLostPages = ulLostSrcPages - pxDst->ulPagesWritten;
-	uint32_t ulSrcOffset	   = pxSrc->ucFlags & LOGGER_FLAG_WRAPPING_ON ? 1 : 0;
+	uint32_t ulSrcOffset;
 	uint32_t ulIterCount, ulReadPage;
 	uint32_t i;
 
@@ -102,6 +108,7 @@ eModuleError_t prvMirrorSameSizes( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t
 	ulIterCount = pxSrc->ulPagesWritten - pxDst->ulPagesWritten;
 	ulReadPage  = ( pxSrc->ulPagesWritten - ulActualLostPages ) % pxSrc->ulNumBlocks;
 	for ( i = 0; i < ulIterCount; i++ ) {
+		ulSrcOffset = usLoggerBlockHeaderSize( pxSrc, ulReadPage );
 		eLoggerReadBlock( pxSrc, ulReadPage, ulSrcOffset, pucCopyBuffer );
 		eLoggerLog( pxDst, pxDst->usLogicalBlockSize, pucCopyBuffer );
 		ulReadPage = ( ulReadPage + 1 ) % pxSrc->ulNumBlocks;
@@ -125,7 +132,7 @@ eModuleError_t prvMirrorSrcLarger( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t
 	uint32_t ulSizeRatio		  = pxSrc->usLogicalBlockSize / pxDst->usLogicalBlockSize;
 	uint32_t ulEquivalentSrcPages = pxDst->ulPagesWritten / ulSizeRatio;
 	uint32_t ulActualLostPages	= 0;
-	uint32_t ulSrcOffset		  = pxSrc->ucFlags & LOGGER_FLAG_WRAPPING_ON ? 1 : 0;
+	uint32_t ulSrcOffset;
 	uint32_t ulIterCount, ulReadPage;
 	uint32_t i, j;
 
@@ -147,6 +154,7 @@ eModuleError_t prvMirrorSrcLarger( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t
 	ulIterCount = pxSrc->ulPagesWritten - ( pxDst->ulPagesWritten / ulSizeRatio );
 	ulReadPage  = ( pxSrc->ulCurrentBlockAddress - ulIterCount ) % pxSrc->ulNumBlocks;
 	for ( i = 0; i < ulIterCount; i++ ) {
+		ulSrcOffset = usLoggerBlockHeaderSize( pxSrc, ulReadPage );
 		eLoggerReadBlock( pxSrc, ulReadPage, ulSrcOffset, pucCopyBuffer );
 		for ( j = 0; j < ulSizeRatio; j++ ) {
 			eLoggerLog( pxDst, pxDst->usLogicalBlockSize, pucCopyBuffer + ( j * pxDst->usLogicalBlockSize ) );
@@ -162,7 +170,7 @@ eModuleError_t prvMirrorDstLarger( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t
 	uint32_t ulSizeRatio		  = pxDst->usLogicalBlockSize / pxSrc->usLogicalBlockSize;
 	uint32_t ulEquivalentSrcPages = pxDst->ulPagesWritten * ulSizeRatio;
 	uint32_t ulActualLostPages	= 0;
-	uint32_t ulSrcOffset		  = pxSrc->ucFlags & LOGGER_FLAG_WRAPPING_ON ? 1 : 0;
+	uint32_t ulSrcOffset;
 	uint32_t ulIterCount, ulReadPage;
 	uint16_t usPageOffset;
 	uint32_t i, j;
@@ -185,6 +193,7 @@ eModuleError_t prvMirrorDstLarger( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t
 	ulReadPage  = ( pxSrc->ulCurrentBlockAddress - ulSizeRatio * ulIterCount ) % pxSrc->ulNumBlocks;
 	for ( i = 0; i < ulIterCount; i++ ) {
 		for ( j = 0; j < ulSizeRatio; j++ ) {
+			ulSrcOffset  = usLoggerBlockHeaderSize( pxSrc, ulReadPage );
 			usPageOffset = j * ( pxSrc->usLogicalBlockSize - ulSrcOffset );
 			// fprintf( stderr, "STL %d %d %d\r\n", j, ulReadPage, usPageOffset );
 			eLoggerReadBlock( pxSrc, ulReadPage, ulSrcOffset, pucCopyBuffer + usPageOffset );
@@ -196,3 +205,232 @@ eModuleError_t prvMirrorDstLarger( xLogger_t *pxSrc, xLogger_t *pxDst, uint32_t
 }
 
 /*-----------------------------------------------------------*/
+
+void vLogMirrorTdfInit( xLogMirrorTdf_t *pxState, uint8_t *pucBuffer, uint16_t usBufferLen, uint32_t ulSrcPagesMirrored )
+{
+	pvMemset( pxState, 0x00, sizeof( xLogMirrorTdf_t ) );
+	pxState->pucBuffer			= pucBuffer;
+	pxState->usBufferLen		= usBufferLen;
+	pxState->ulSrcPagesMirrored = ulSrcPagesMirrored;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eLogMirrorTdf( xLogger_t *pxSrc, xLogger_t *pxDst, xLogMirrorTdf_t *pxState, uint32_t ulMaxPages )
+{
+	eModuleError_t eError = ERROR_NONE;
+	uint32_t	   ulLostPages, ulBlock;
+	uint16_t	   usOffset;
+	uint8_t		   ucEraseUnit;
+	xTdf_t		   xTdf;
+
+	configASSERT( pxState->usBufferLen >= pxSrc->usLogicalBlockSize );
+	configASSERT( ( pxDst->ucFlags & LOGGER_FLAG_WRAPPING_ON ) == 0 );
+
+	/* Source has been erased since the previous session */
+	if ( pxState->ulSrcPagesMirrored > pxSrc->ulPagesWritten ) {
+		eLog( LOG_LOGGER, LOG_WARNING, "Mirror: %s restarted, mirroring from start\r\n", pxSrc->pucDescription );
+		pxState->ulSrcPagesMirrored = 0;
+	}
+
+	/* Record source pages that were overwritten before they could be mirrored */
+	eLoggerConfigure( pxSrc, LOGGER_CONFIG_GET_ERASE_UNIT, &ucEraseUnit );
+	ulLostPages = ulLogMirrorLostSrcPages( pxSrc->ulPagesWritten, pxSrc->ulNumBlocks, ucEraseUnit );
+	while ( ( eError == ERROR_NONE ) && ( pxState->ulSrcPagesMirrored < ulLostPages ) ) {
+		xTdf.usId	  = TDF_LOST_DATA;
+		xTdf.pucData   = (uint8_t *) &pxState->ulSrcPagesMirrored;
+		xTdf.ucDataLen = pucTdfStructLengths[TDF_LOST_DATA];
+		eError		   = prvMirrorTdfEmit( pxDst, pxState, &xTdf, TDF_TIMESTAMP_NONE );
+		pxState->ulSrcPagesMirrored++;
+		pxState->ulLostPages++;
+	}
+
+	/* Stream committed source pages through the block buffer */
+	while ( ( eError == ERROR_NONE ) && ( ulMaxPages > 0 ) && ( pxState->ulSrcPagesMirrored < pxSrc->ulPagesWritten ) ) {
+		ulBlock  = pxState->ulSrcPagesMirrored % pxSrc->ulNumBlocks;
+		usOffset = usLoggerBlockHeaderSize( pxSrc, ulBlock );
+		/* Complete blocks are read so that block footers are verified */
+		eError = eLoggerReadBlock( pxSrc, ulBlock, 0, pxState->pucBuffer );
+		if ( eError == ERROR_NONE ) {
+			eError = prvMirrorTdfBlock( pxDst, pxState, pxState->pucBuffer + usOffset, pxSrc->usLogicalBlockSize - usLoggerBlockFooterSize( pxSrc ) - usOffset );
+		}
+		else if ( ( eError == ERROR_INVALID_CRC ) || ( eError == ERROR_INVALID_DATA ) ) {
+			/* Corrupt pages are recorded in the same way as lost pages */
+			xTdf.usId	  = TDF_LOST_DATA;
+			xTdf.pucData   = (uint8_t *) &pxState->ulSrcPagesMirrored;
+			xTdf.ucDataLen = pucTdfStructLengths[TDF_LOST_DATA];
+			eError		   = prvMirrorTdfEmit( pxDst, pxState, &xTdf, TDF_TIMESTAMP_NONE );
+			pxState->ulCorruptPages++;
+		}
+		if ( eError == ERROR_NONE ) {
+			pxState->ulSrcPagesMirrored++;
+			ulMaxPages--;
+		}
+	}
+
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	return eLoggerCommit( pxDst );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvMirrorTdfBlock( xLogger_t *pxDst, xLogMirrorTdf_t *pxState, uint8_t *pucBlock, uint32_t ulLength )
+{
+	xTdfParser_t * pxParser = &pxState->xParser;
+	eModuleError_t eError   = ERROR_NONE;
+	xTdfTime_t	 xStartTime;
+	uint32_t	   ulStart, ulHeader;
+	xTdf_t		   xTdf;
+	bool		   bValid;
+
+	vTdfParseStart( pxParser, pucBlock, ulLength );
+	while ( eError == ERROR_NONE ) {
+		ulStart	= pxParser->ulCurrentOffset;
+		xStartTime = pxParser->xBufferTime;
+		if ( eTdfParse( pxParser, &xTdf ) != ERROR_NONE ) {
+			break;
+		}
+		/* The parser skips padding before the TDF header */
+		for ( ulHeader = ulStart; ( pucBlock[ulHeader] == 0x00 ) || ( pucBlock[ulHeader] == 0xFF ); ulHeader++ ) {
+		}
+		if ( TDF_ID( LE_U16_EXTRACT( pucBlock + ulHeader ) ) != TDF_COMPRESSED_ID ) {
+			eError = prvMirrorTdfEmit( pxDst, pxState, &xTdf, TDF_TIMESTAMP( xTdf.usId ) );
+			continue;
+		}
+		/* Walk to the end of the compressed segment */
+		bValid = true;
+		while ( bValid && ( pxParser->ucSegmentRemaining > 0 ) ) {
+			bValid = ( eTdfParse( pxParser, &xTdf ) == ERROR_NONE );
+		}
+		if ( bValid && ( ( pxParser->ulCurrentOffset - ulHeader ) <= prvMirrorTdfMaxPayload( pxDst ) ) ) {
+			eError = prvMirrorTdfSegment( pxDst, pxState, pucBlock + ulHeader, pxParser->ulCurrentOffset - ulHeader, &xTdf.xTime );
+			continue;
+		}
+		/* Segment does not fit in a destination block, or is corrupt. Expand the valid records individually */
+		pxParser->ulCurrentOffset	= ulStart;
+		pxParser->xBufferTime		 = xStartTime;
+		pxParser->ucSegmentRemaining = 0;
+		do {
+			if ( eTdfParse( pxParser, &xTdf ) != ERROR_NONE ) {
+				break;
+			}
+			eError = prvMirrorTdfEmit( pxDst, pxState, &xTdf, ( TDF_TIMESTAMP( xTdf.usId ) == TDF_TIMESTAMP_NONE ) ? TDF_TIMESTAMP_NONE : TDF_TIMESTAMP_RELATIVE_OFFSET_MS );
+		} while ( ( eError == ERROR_NONE ) && ( pxParser->ucSegmentRemaining > 0 ) );
+	}
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvMirrorTdfEmit( xLogger_t *pxDst, xLogMirrorTdf_t *pxState, xTdf_t *pxTdf, uint16_t usPreferred )
+{
+	eModuleError_t eError;
+	uint16_t	   usTdfId, usOffset;
+	uint16_t	   usTimestampType;
+	uint8_t		   ucHeaderLen;
+
+	/* Worst case is a global timestamp at the start of a block */
+	ucHeaderLen = 2 + ( ( usPreferred == TDF_TIMESTAMP_NONE ) ? 0 : sizeof( xTdfTime_t ) );
+	if ( ucHeaderLen + pxTdf->ucDataLen > prvMirrorTdfMaxPayload( pxDst ) ) {
+		pxState->ulDropped++;
+		return ERROR_NONE;
+	}
+	usTimestampType = prvMirrorTdfTimestamp( pxDst, pxState, &pxTdf->xTime, usPreferred, &usOffset );
+	ucHeaderLen		= 2 + ( ( usTimestampType == TDF_TIMESTAMP_GLOBAL ) ? sizeof( xTdfTime_t ) : ( ( usTimestampType == TDF_TIMESTAMP_NONE ) ? 0 : sizeof( uint16_t ) ) );
+	/* TDFs never span blocks, a new block requires a new global time */
+	if ( ucHeaderLen + pxTdf->ucDataLen > pxDst->usLogicalBlockSize - usLoggerBlockFooterSize( pxDst ) - pxDst->usBufferByteOffset ) {
+		eError = eLoggerCommit( pxDst );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+		pxState->bDstTimeValid = false;
+		usTimestampType		   = prvMirrorTdfTimestamp( pxDst, pxState, &pxTdf->xTime, usPreferred, &usOffset );
+		ucHeaderLen			   = 2 + ( ( usTimestampType == TDF_TIMESTAMP_NONE ) ? 0 : sizeof( xTdfTime_t ) );
+	}
+	if ( ( usTimestampType == TDF_TIMESTAMP_GLOBAL ) && ( usPreferred != TDF_TIMESTAMP_GLOBAL ) ) {
+		pxState->ulGlobals++;
+	}
+
+	usTdfId = TDF_ID( pxTdf->usId ) | usTimestampType;
+	eError  = eLoggerLog( pxDst, sizeof( uint16_t ), &usTdfId );
+	if ( usTimestampType == TDF_TIMESTAMP_GLOBAL ) {
+		/* Relative timestamps that follow are offsets from this TDF, until the block is committed */
+		pxState->xDstTime	  = pxTdf->xTime;
+		pxState->ulDstPage	 = pxDst->ulPagesWritten;
+		pxState->bDstTimeValid = true;
+		eLoggerLog( pxDst, sizeof( xTdfTime_t ), &pxTdf->xTime );
+	}
+	else if ( usTimestampType != TDF_TIMESTAMP_NONE ) {
+		eLoggerLog( pxDst, sizeof( uint16_t ), &usOffset );
+	}
+	eLoggerLog( pxDst, pxTdf->ucDataLen, pxTdf->pucData );
+	pxState->ulTdfs++;
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvMirrorTdfSegment( xLogger_t *pxDst, xLogMirrorTdf_t *pxState, uint8_t *pucSegment, uint32_t ulLength, xTdfTime_t *pxLastTime )
+{
+	eModuleError_t eError;
+
+	if ( ulLength > (uint32_t) ( pxDst->usLogicalBlockSize - usLoggerBlockFooterSize( pxDst ) - pxDst->usBufferByteOffset ) ) {
+		eError = eLoggerCommit( pxDst );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+		pxState->bDstTimeValid = false;
+	}
+	/* Relative timestamps after a timestamped segment are offsets from its final record */
+	if ( TDF_TIMESTAMP( LE_U16_EXTRACT( pucSegment ) ) == TDF_TIMESTAMP_GLOBAL ) {
+		pxState->xDstTime	  = *pxLastTime;
+		pxState->ulDstPage	 = pxDst->ulPagesWritten;
+		pxState->bDstTimeValid = true;
+	}
+	eError = eLoggerLog( pxDst, ulLength, pucSegment );
+	pxState->ulSegments++;
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvMirrorTdfTimestamp( xLogger_t *pxDst, xLogMirrorTdf_t *pxState, xTdfTime_t *pxTime, uint16_t usPreferred, uint16_t *pusOffset )
+{
+	int64_t llDelta;
+
+	if ( ( usPreferred == TDF_TIMESTAMP_NONE ) || ( usPreferred == TDF_TIMESTAMP_GLOBAL ) ) {
+		return usPreferred;
+	}
+	/* Relative timestamps need a global time earlier in the same destination block */
+	if ( !pxState->bDstTimeValid || ( pxState->ulDstPage != pxDst->ulPagesWritten ) ||
+		 ( pxDst->usBufferByteOffset <= usLoggerBlockHeaderSize( pxDst, pxDst->ulCurrentBlockAddress ) ) ) {
+		return TDF_TIMESTAMP_GLOBAL;
+	}
+	llDelta = ( ( (int64_t) pxTime->ulSecondsSince2000 - pxState->xDstTime.ulSecondsSince2000 ) << 16 ) +
+			  ( (int64_t) pxTime->usSecondsFraction - pxState->xDstTime.usSecondsFraction );
+	if ( usPreferred == TDF_TIMESTAMP_RELATIVE_OFFSET_S ) {
+		if ( ( pxTime->usSecondsFraction != pxState->xDstTime.usSecondsFraction ) || ( llDelta < 0 ) || ( ( llDelta >> 16 ) > UINT16_MAX ) ) {
+			return TDF_TIMESTAMP_GLOBAL;
+		}
+		*pusOffset = (uint16_t) ( llDelta >> 16 );
+	}
+	else {
+		if ( ( llDelta < 0 ) || ( llDelta > UINT16_MAX ) ) {
+			return TDF_TIMESTAMP_GLOBAL;
+		}
+		*pusOffset = (uint16_t) llDelta;
+	}
+	return usPreferred;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvMirrorTdfMaxPayload( xLogger_t *pxDst )
+{
+	/* Block 0 always carries the largest header */
+	return pxDst->usLogicalBlockSize - usLoggerBlockHeaderSize( pxDst, 0 ) - usLoggerBlockFooterSize( pxDst );
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "sleep_stats.h"
+
+#include "task.h"
+
+#include "compiler_intrinsics.h"
+#include "csiro_math.h"
+#include "memory_operations.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+#define SATURATE_U16( x )       ( (uint16_t) MIN( ( x ), UINT16_MAX ) )
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+/* Function Declarations ------------------------------------*/
+
+/* Private Variables ----------------------------------------*/
+
+static xSleepStats_t xStats;
+
+/* Kernel tick count at the end of the most recent idle period */
+static TickType_t xLastWake = 0;
+
+/*-----------------------------------------------------------*/
+
+void vSleepStatsRecord( TickType_t xSleepStart, TickType_t xExpectedIdleTime, TickType_t xSleptTicks, eSleepWake_t eWake, int32_t lWakeIrq )
+{
+	uint8_t ucBin;
+
+	configASSERT( eWake < SLEEP_WAKE_REASONS );
+
+	xStats.pulWakes[eWake]++;
+	xStats.ulRunTicks += xSleepStart - xLastWake;
+	xLastWake = xSleepStart + xSleptTicks;
+
+	if ( ( eWake == SLEEP_WAKE_ABORTED ) || ( eWake == SLEEP_WAKE_BLOCKED ) ) {
+		return;
+	}
+
+	xStats.ulSleepTicks += xSleptTicks;
+	ucBin = ( xSleptTicks == 0 ) ? 0 : ( 31 - COUNT_LEADING_ZEROS( (uint32_t) xSleptTicks ) );
+	xStats.pulHistogram[MIN( ucBin, SLEEP_STATS_HISTOGRAM_BINS - 1 )]++;
+
+	if ( eWake == SLEEP_WAKE_INTERRUPT ) {
+		if ( ( lWakeIrq >= 0 ) && ( lWakeIrq < SLEEP_STATS_NUM_IRQS ) ) {
+			if ( xStats.pusWakeIrqs[lWakeIrq] < UINT16_MAX ) {
+				xStats.pusWakeIrqs[lWakeIrq]++;
+			}
+		}
+		else {
+			xStats.ulUnknownIrqWakes++;
+		}
+	}
+
+	/* Without a kernel timeout there is no expected wake time to be early or late against */
+	if ( xExpectedIdleTime == portMAX_DELAY ) {
+		return;
+	}
+	if ( xSleptTicks > xExpectedIdleTime ) {
+		xStats.ulOversleepTicks += xSleptTicks - xExpectedIdleTime;
+		xStats.ulMaxOversleep = MAX( xStats.ulMaxOversleep, xSleptTicks - xExpectedIdleTime );
+	}
+	else if ( eWake == SLEEP_WAKE_TIMEOUT ) {
+		/* Early interrupt wakes are expected, only a wake timer firing early is an error */
+		xStats.ulUndersleepTicks += xExpectedIdleTime - xSleptTicks;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+void vSleepStatsGet( xSleepStats_t *pxStats, bool bReset )
+{
+	taskENTER_CRITICAL();
+	pvMemcpy( pxStats, &xStats, sizeof( xSleepStats_t ) );
+	if ( bReset ) {
+		pvMemset( &xStats, 0x00, sizeof( xSleepStats_t ) );
+	}
+	taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t usSleepStatsPermille( xSleepStats_t *pxStats )
+{
+	uint64_t ullTotal = (uint64_t) pxStats->ulSleepTicks + pxStats->ulRunTicks;
+	if ( ullTotal == 0 ) {
+		return 0;
+	}
+	return (uint16_t) ( ( 1000 * (uint64_t) pxStats->ulSleepTicks ) / ullTotal );
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eSleepStatsLog( uint8_t ucLoggerMask, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, xSleepStats_t *pxStats )
+{
+	tdf_sleep_stats_t	 xSleep;
+	tdf_sleep_histogram_t xHistogram;
+	tdf_sleep_wake_irq_t  xWakeIrq;
+	eModuleError_t		  eError;
+	uint8_t				  i;
+
+	xSleep.sleep_ticks   = pxStats->ulSleepTicks;
+	xSleep.run_ticks	 = pxStats->ulRunTicks;
+	xSleep.timeouts		 = SATURATE_U16( pxStats->pulWakes[SLEEP_WAKE_TIMEOUT] );
+	xSleep.interrupts	= SATURATE_U16( pxStats->pulWakes[SLEEP_WAKE_INTERRUPT] );
+	xSleep.aborted		 = SATURATE_U16( pxStats->pulWakes[SLEEP_WAKE_ABORTED] );
+	xSleep.blocked		 = SATURATE_U16( pxStats->pulWakes[SLEEP_WAKE_BLOCKED] );
+	xSleep.oversleep	 = SATURATE_U16( pxStats->ulOversleepTicks );
+	xSleep.undersleep	= SATURATE_U16( pxStats->ulUndersleepTicks );
+	xSleep.max_oversleep = SATURATE_U16( pxStats->ulMaxOversleep );
+	for ( i = 0; i < SLEEP_STATS_HISTOGRAM_BINS; i++ ) {
+		xHistogram.bins[i] = SATURATE_U16( pxStats->pulHistogram[i] );
+	}
+
+	eError = eTdfAddMulti( ucLoggerMask, TDF_SLEEP_STATS, eTimestampType, pxTime, &xSleep );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	eError = eTdfAddMulti( ucLoggerMask, TDF_SLEEP_HISTOGRAM, eTimestampType, pxTime, &xHistogram );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	for ( i = 0; i < SLEEP_STATS_NUM_IRQS; i++ ) {
+		if ( pxStats->pusWakeIrqs[i] == 0 ) {
+			continue;
+		}
+		xWakeIrq.irq   = i;
+		xWakeIrq.wakes = pxStats->pusWakeIrqs[i];
+		eError		   = eTdfAddMulti( ucLoggerMask, TDF_SLEEP_WAKE_IRQ, eTimestampType, pxTime, &xWakeIrq );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
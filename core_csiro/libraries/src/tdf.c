@@ -19,6 +19,12 @@
 #define TDF_RELATIVE_TIMESTAMP_SIZE		2
 #define TDF_GLOBAL_TIMESTAMP_SIZE		sizeof( xTdfTime_t )
 
+#define TDF_COMPRESSED_HEADER_SIZE		5
+#define TDF_COMPRESSED_COUNT_OFFSET		4
+#define VARINT_MAX_SIZE_16BIT			3
+#define VARINT_MAX_SIZE_32BIT			5
+#define ZIGZAG_ENCODE_16BIT( s )		( (uint16_t) ( ( (uint16_t) ( s ) << 1 ) ^ (uint16_t) ( ( s ) >> 15 ) ) )
+
 // clang-format on
 /* Type Definitions -----------------------------------------*/
 
@@ -26,6 +32,7 @@
 
 void prvClearBufferTime( xTdfLogger_t *pxTdfLog );
 bool bCanUseARelativeTimestamp( xTdfLogger_t *pxTdfLog, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxGlobalTime, int32_t lTimeDifferenceInSeconds, int32_t lTimeDifferenceInFractions );
+static uint8_t prvVarintEncode( uint8_t *pucBuffer, uint32_t ulValue );
 
 /* Private Variables ----------------------------------------*/
 
@@ -188,8 +195,9 @@ eModuleError_t eTdfAdd( xTdfLogger_t *pxTdfLog, eTdfIds_t eTdfId, eTdfTimestampT
 		else {
 			// Calculate time differences
 			lTimeDifferenceInSeconds   = pxGlobalTime->ulSecondsSince2000 - pxTdfLog->xBufferTime.ulSecondsSince2000;
-			lTimeDifferenceInFractions = ( ( lTimeDifferenceInSeconds * 65536 ) +
-										   ( pxGlobalTime->usSecondsFraction - pxTdfLog->xBufferTime.usSecondsFraction ) );
+			/* Wraps when the buffer time is invalid or seconds away, bCanUseARelativeTimestamp rejects both */
+			lTimeDifferenceInFractions = (int32_t) ( ( (uint32_t) lTimeDifferenceInSeconds * 65536 ) +
+													 ( pxGlobalTime->usSecondsFraction - pxTdfLog->xBufferTime.usSecondsFraction ) );
 
 			if ( bCanUseARelativeTimestamp( pxTdfLog, eTimestampType, pxGlobalTime, lTimeDifferenceInSeconds, lTimeDifferenceInFractions ) ) {
 				/* Set the TDF timestamp to be in fractions or seconds */
@@ -225,7 +233,7 @@ eModuleError_t eTdfAdd( xTdfLogger_t *pxTdfLog, eTdfIds_t eTdfId, eTdfTimestampT
 	 * If it will, we flush the buffer before writing our tdf to the logger.
 	 */
 
-	uint16_t usBytesRemainingInLog = pxTdfLog->pxLog->usLogicalBlockSize - pxTdfLog->pxLog->usBufferByteOffset;
+	uint16_t usBytesRemainingInLog = pxTdfLog->pxLog->usLogicalBlockSize - usLoggerBlockFooterSize( pxTdfLog->pxLog ) - pxTdfLog->pxLog->usBufferByteOffset;
 	eLog( LOG_LOGGER, LOG_VERBOSE, "TDF: Required Space = %d Remaining Space = %d\r\n", ucTdfSize, usBytesRemainingInLog );
 	if ( ucTdfSize > usBytesRemainingInLog ) {
 		eError = eTdfFlush( pxTdfLog );
@@ -333,6 +341,154 @@ eModuleError_t eTdfSchedulerArgsParse( xTdfLoggerMapping_t *pxLoggerMapping, uin
 
 /*-----------------------------------------------------------*/
 
+void vTdfCompressStart( xTdfCompressor_t *pxCompressor, eTdfIds_t eTdfId, eTdfTimestampType_t eTimestampType, uint8_t *pucBuffer, uint16_t usBufferLen )
+{
+	configASSERT( ( eTimestampType == TDF_TIMESTAMP_NONE ) || ( eTimestampType == TDF_TIMESTAMP_GLOBAL ) );
+
+	pxCompressor->pucBuffer		   = pucBuffer;
+	pxCompressor->usBufferLen	  = usBufferLen;
+	pxCompressor->usBufferOffset   = 0;
+	pxCompressor->eTdfId		   = eTdfId;
+	pxCompressor->eTimestampType   = eTimestampType;
+	pxCompressor->ucNumRecords	 = 0;
+	pxCompressor->usRunCountOffset = 0;
+	pxCompressor->ulRunDelta	   = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eTdfCompressAdd( xTdfCompressor_t *pxCompressor, xTdfTime_t *pxTime, void *pvData )
+{
+	const bool	  bTimestamped = ( pxCompressor->eTimestampType == TDF_TIMESTAMP_GLOBAL );
+	const uint8_t ucLength	 = pucTdfStructLengths[pxCompressor->eTdfId];
+	uint8_t *	 pucData	  = (uint8_t *) pvData;
+	uint8_t *	 pucOutput	= pxCompressor->pucBuffer;
+	uint16_t	  usOffset	 = pxCompressor->usBufferOffset;
+	uint16_t	  usWorstCase;
+	uint16_t	  usPrevious, usCurrent;
+	uint32_t	  ulTimeDelta = 0;
+	uint8_t		  i;
+
+	if ( pxCompressor->ucNumRecords == TDF_COMPRESSED_MAX_RECORDS ) {
+		return ERROR_DEVICE_FULL;
+	}
+	/* First record is stored verbatim along with the segment header */
+	if ( pxCompressor->ucNumRecords == 0 ) {
+		usWorstCase = TDF_COMPRESSED_HEADER_SIZE + ( bTimestamped ? TDF_GLOBAL_TIMESTAMP_SIZE : 0 ) + ucLength;
+		if ( usWorstCase > pxCompressor->usBufferLen ) {
+			return ERROR_DEVICE_FULL;
+		}
+		LE_U16_PACK( pucOutput, TDF_COMPRESSED_ID | pxCompressor->eTimestampType );
+		LE_U16_PACK( pucOutput + 2, pxCompressor->eTdfId );
+		usOffset = TDF_COMPRESSED_HEADER_SIZE;
+		if ( bTimestamped ) {
+			pvMemcpy( pucOutput + usOffset, pxTime, TDF_GLOBAL_TIMESTAMP_SIZE );
+			usOffset += TDF_GLOBAL_TIMESTAMP_SIZE;
+		}
+		pvMemcpy( pucOutput + usOffset, pucData, ucLength );
+		usOffset += ucLength;
+	}
+	else {
+		if ( bTimestamped ) {
+			/* Time must not go backwards, and differences of 65536 seconds or more cannot be represented in 32 bits of 1/65536 seconds */
+			if ( ( pxTime->ulSecondsSince2000 < pxCompressor->xPreviousTime.ulSecondsSince2000 ) ||
+				 ( ( pxTime->ulSecondsSince2000 - pxCompressor->xPreviousTime.ulSecondsSince2000 ) > UINT16_MAX ) ||
+				 ( ( pxTime->ulSecondsSince2000 == pxCompressor->xPreviousTime.ulSecondsSince2000 ) &&
+				   ( pxTime->usSecondsFraction < pxCompressor->xPreviousTime.usSecondsFraction ) ) ) {
+				return ERROR_INVALID_TIME;
+			}
+			ulTimeDelta = ( ( pxTime->ulSecondsSince2000 - pxCompressor->xPreviousTime.ulSecondsSince2000 ) << 16 ) +
+						  pxTime->usSecondsFraction - pxCompressor->xPreviousTime.usSecondsFraction;
+		}
+		usWorstCase = usOffset + ( ( ucLength + 1 ) / 2 ) * VARINT_MAX_SIZE_16BIT + ( bTimestamped ? VARINT_MAX_SIZE_32BIT + 1 : 0 );
+		if ( usWorstCase > pxCompressor->usBufferLen ) {
+			return ERROR_DEVICE_FULL;
+		}
+		if ( bTimestamped ) {
+			/* Extend the current run of time differences if possible, otherwise start a new run */
+			if ( ( pxCompressor->usRunCountOffset != 0 ) && ( ulTimeDelta == pxCompressor->ulRunDelta ) && ( pucOutput[pxCompressor->usRunCountOffset] < UINT8_MAX ) ) {
+				pucOutput[pxCompressor->usRunCountOffset]++;
+			}
+			else {
+				usOffset += prvVarintEncode( pucOutput + usOffset, ulTimeDelta );
+				pxCompressor->usRunCountOffset = usOffset;
+				pxCompressor->ulRunDelta	   = ulTimeDelta;
+				pucOutput[usOffset++]		   = 1;
+			}
+		}
+		/* Word wise differences against the previous record, wrapping arithmetic makes this lossless for any field layout */
+		for ( i = 0; i < ucLength; i += 2 ) {
+			usPrevious = pxCompressor->pucPrevious[i];
+			usCurrent  = pucData[i];
+			if ( ( i + 1 ) < ucLength ) {
+				usPrevious |= (uint16_t) pxCompressor->pucPrevious[i + 1] << 8;
+				usCurrent |= (uint16_t) pucData[i + 1] << 8;
+			}
+			usOffset += prvVarintEncode( pucOutput + usOffset, ZIGZAG_ENCODE_16BIT( (int16_t) ( usCurrent - usPrevious ) ) );
+		}
+	}
+	if ( bTimestamped ) {
+		pxCompressor->xPreviousTime.ulSecondsSince2000 = pxTime->ulSecondsSince2000;
+		pxCompressor->xPreviousTime.usSecondsFraction  = pxTime->usSecondsFraction;
+	}
+	pvMemcpy( pxCompressor->pucPrevious, pucData, ucLength );
+	pxCompressor->usBufferOffset		   = usOffset;
+	pucOutput[TDF_COMPRESSED_COUNT_OFFSET] = ++pxCompressor->ucNumRecords;
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eTdfAddCompressed( xTdfLogger_t *pxTdfLog, xTdfCompressor_t *pxCompressor )
+{
+	eModuleError_t eError = ERROR_NONE;
+	uint16_t	   usBytesRemainingInLog;
+	xTdfTime_t	   xBaseTime;
+
+	if ( pxCompressor->ucNumRecords == 0 ) {
+		return ERROR_NONE;
+	}
+	configASSERT( pxCompressor->usBufferOffset <= pxTdfLog->pxLog->usLogicalBlockSize );
+
+	xSemaphoreTakeRecursive( pxTdfLog->xTdfSemaphore, portMAX_DELAY );
+
+	/* Record times never decrease within a segment, so checking the base time is sufficient */
+	if ( pxCompressor->eTimestampType != TDF_TIMESTAMP_NONE ) {
+		pvMemcpy( &xBaseTime, pxCompressor->pucBuffer + TDF_COMPRESSED_HEADER_SIZE, TDF_GLOBAL_TIMESTAMP_SIZE );
+		if ( xBaseTime.ulSecondsSince2000 < pxTdfLog->xValidAfterTime.ulSecondsSince2000 ) {
+			xSemaphoreGiveRecursive( pxTdfLog->xTdfSemaphore );
+			return ERROR_INVALID_TIME;
+		}
+	}
+
+	/* Segments must be stored in a single block, as they are meaningless without their header */
+	usBytesRemainingInLog = pxTdfLog->pxLog->usLogicalBlockSize - usLoggerBlockFooterSize( pxTdfLog->pxLog ) - pxTdfLog->pxLog->usBufferByteOffset;
+	if ( pxCompressor->usBufferOffset > usBytesRemainingInLog ) {
+		eError = eTdfFlush( pxTdfLog );
+		if ( eError != ERROR_NONE ) {
+			xSemaphoreGiveRecursive( pxTdfLog->xTdfSemaphore );
+			return eError;
+		}
+		usBytesRemainingInLog = pxTdfLog->pxLog->usLogicalBlockSize - usLoggerBlockFooterSize( pxTdfLog->pxLog ) - pxTdfLog->pxLog->usBufferByteOffset;
+	}
+
+	eError = eLoggerLog( pxTdfLog->pxLog, pxCompressor->usBufferOffset, pxCompressor->pucBuffer );
+
+	/* Parsers treat the final record of a timestamped segment as the new reference time */
+	if ( pxCompressor->eTimestampType == TDF_TIMESTAMP_GLOBAL ) {
+		pxTdfLog->xBufferTime.ulSecondsSince2000 = pxCompressor->xPreviousTime.ulSecondsSince2000;
+		pxTdfLog->xBufferTime.usSecondsFraction  = pxCompressor->xPreviousTime.usSecondsFraction;
+	}
+	if ( pxCompressor->usBufferOffset == usBytesRemainingInLog ) {
+		prvClearBufferTime( pxTdfLog );
+	}
+
+	xSemaphoreGiveRecursive( pxTdfLog->xTdfSemaphore );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * bWeAreAllowedToUseARelativeTimestamp
  *
@@ -371,3 +527,17 @@ void prvClearBufferTime( xTdfLogger_t *pxTdfLog )
 }
 
 /*-----------------------------------------------------------*/
+
+static uint8_t prvVarintEncode( uint8_t *pucBuffer, uint32_t ulValue )
+{
+	uint8_t ucBytes = 0;
+	/* 7 bits per byte, least significant group first, MSB set on all but the final byte */
+	while ( ulValue >= 0x80 ) {
+		pucBuffer[ucBytes++] = (uint8_t) ( ulValue | 0x80 );
+		ulValue >>= 7;
+	}
+	pucBuffer[ucBytes++] = (uint8_t) ulValue;
+	return ucBytes;
+}
+
+/*-----------------------------------------------------------*/
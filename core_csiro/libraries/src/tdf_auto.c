@@ -18,7 +18,7 @@
 /* External Variables ---------------------------------------*/
 // clang-format off
 
-const uint8_t pucTdfStructLengths[476] = {
+const uint8_t pucTdfStructLengths[484] = {
     [TDF_BATTERY_VOLTAGE                    ] = 2,
     [TDF_BATTERY_CURRENT                    ] = 2,
     [TDF_SOLAR_VOLTAGE                      ] = 2,
@@ -487,6 +487,14 @@ const uint8_t pucTdfStructLengths[476] = {
     [TDF_MAG_XYZ_SIGNED                     ] = 6,
     [TDF_HEADING                            ] = 2,
     [TDF_RANGE_CM                           ] = 2,
+    [TDF_SLEEP_STATS                        ] = 22,
+    [TDF_SLEEP_HISTOGRAM                    ] = 24,
+    [TDF_SLEEP_WAKE_IRQ                     ] = 3,
+    [TDF_ENERGY_SUBSYSTEM                   ] = 13,
+    [TDF_ENERGY_SUMMARY                     ] = 16,
+    [TDF_TASK_STACK                         ] = 12,
+    [TDF_CRASH_DUMP                         ] = 33,
+    [TDF_CRASH_DUMP_DATA                    ] = 26,
 };
 
 // clang-format on
@@ -13,11 +13,20 @@
 /* Private Defines ------------------------------------------*/
 // clang-format off
 
+#define ZIGZAG_DECODE_16BIT( u )	( (uint16_t) ( ( ( u ) >> 1 ) ^ ( -( ( u ) & 0x01 ) ) ) )
+
+/* TDF IDs are 12 bits from untrusted data, only IDs inside the length table can be parsed */
+#define TDF_ID_KNOWN( usTdf )		( ( usTdf ) < sizeof( pucTdfStructLengths ) )
+
 // clang-format on
 /* Type Definitions -----------------------------------------*/
 
 /* Function Declarations ------------------------------------*/
 
+static eModuleError_t prvTdfSegmentStart( xTdfParser_t *pxParser, uint16_t usTdfIdTimestamp, xTdf_t *pxTdf );
+static eModuleError_t prvTdfSegmentNext( xTdfParser_t *pxParser, xTdf_t *pxTdf );
+static bool			  prvVarintDecode( xTdfParser_t *pxParser, uint32_t *pulValue );
+
 /* Private Variables ----------------------------------------*/
 
 /*-----------------------------------------------------------*/
@@ -29,15 +38,21 @@ void vTdfParseStart( xTdfParser_t *pxParser, uint8_t *pucBuffer, uint32_t ulBuff
 	pxParser->ulCurrentOffset				 = 0;
 	pxParser->xBufferTime.ulSecondsSince2000 = 0;
 	pxParser->xBufferTime.usSecondsFraction  = 0;
+	pxParser->ucSegmentRemaining			 = 0;
 }
 
 /*-----------------------------------------------------------*/
 
 eModuleError_t eTdfParse( xTdfParser_t *pxParser, xTdf_t *pxTdf )
 {
-	uint8_t  ucByte = 0x00;
-	uint16_t usTdfIdTimestamp, usTdf, usTimestampType, usTemp;
-	uint8_t  ucTdfLen;
+	uint8_t	ucByte = 0x00;
+	uint16_t   usTdfIdTimestamp, usTdf, usTimestampType, usTemp;
+	uint8_t	ucTdfLen;
+	xTdfTime_t xTime;
+	/* Continue expanding the current compressed segment */
+	if ( pxParser->ucSegmentRemaining > 0 ) {
+		return prvTdfSegmentNext( pxParser, pxTdf );
+	}
 	if ( pxParser->ulCurrentOffset >= pxParser->ulBufferLen ) {
 		return ERROR_INVALID_DATA;
 	}
@@ -57,28 +72,37 @@ eModuleError_t eTdfParse( xTdfParser_t *pxParser, xTdf_t *pxTdf )
 	usTdfIdTimestamp = LE_U16_EXTRACT( pxParser->pucBuffer + pxParser->ulCurrentOffset );
 	usTdf			 = TDF_ID_MASK & usTdfIdTimestamp;
 	usTimestampType  = TDF_TIMESTAMP_MASK & usTdfIdTimestamp;
+	if ( usTdf == TDF_COMPRESSED_ID ) {
+		return prvTdfSegmentStart( pxParser, usTdfIdTimestamp, pxTdf );
+	}
+	if ( !TDF_ID_KNOWN( usTdf ) ) {
+		return ERROR_INVALID_DATA;
+	}
 	ucTdfLen		 = 2 + pucTdfStructLengths[usTdf];
+	xTime			 = pxParser->xBufferTime;
+	/* Relative offsets are from the most recent global time, they do not accumulate */
 	switch ( usTimestampType ) {
 		case TDF_TIMESTAMP_NONE:
 			break;
 		case TDF_TIMESTAMP_GLOBAL:
 			/* We check later if these values are actually out of range of the buffer, in which case pxParser is already invalid */
-			pxParser->xBufferTime.ulSecondsSince2000 = LE_U32_EXTRACT( pxParser->pucBuffer + pxParser->ulCurrentOffset + 2 );
-			pxParser->xBufferTime.usSecondsFraction  = LE_U16_EXTRACT( pxParser->pucBuffer + pxParser->ulCurrentOffset + 6 );
+			xTime.ulSecondsSince2000 = LE_U32_EXTRACT( pxParser->pucBuffer + pxParser->ulCurrentOffset + 2 );
+			xTime.usSecondsFraction  = LE_U16_EXTRACT( pxParser->pucBuffer + pxParser->ulCurrentOffset + 6 );
+			pxParser->xBufferTime	= xTime;
 			ucTdfLen += 6;
 			break;
 		case TDF_TIMESTAMP_RELATIVE_OFFSET_S:
-			pxParser->xBufferTime.ulSecondsSince2000 += LE_U16_EXTRACT( pxParser->pucBuffer + pxParser->ulCurrentOffset + 2 );
+			xTime.ulSecondsSince2000 += LE_U16_EXTRACT( pxParser->pucBuffer + pxParser->ulCurrentOffset + 2 );
 			ucTdfLen += 2;
 			break;
 		case TDF_TIMESTAMP_RELATIVE_OFFSET_MS:
 			/* Convert MS to seconds fractions */
 			usTemp = ( (uint32_t) LE_U16_EXTRACT( pxParser->pucBuffer + pxParser->ulCurrentOffset + 2 ) );
 			/* Check for fractional second overflow */
-			if ( (uint32_t) pxParser->xBufferTime.usSecondsFraction + (uint32_t) usTemp > 0xFFFF ) {
-				pxParser->xBufferTime.ulSecondsSince2000++;
+			if ( (uint32_t) xTime.usSecondsFraction + (uint32_t) usTemp > 0xFFFF ) {
+				xTime.ulSecondsSince2000++;
 			}
-			pxParser->xBufferTime.usSecondsFraction += usTemp;
+			xTime.usSecondsFraction += usTemp;
 			ucTdfLen += 2;
 			break;
 		default:
@@ -93,10 +117,140 @@ eModuleError_t eTdfParse( xTdfParser_t *pxParser, xTdf_t *pxTdf )
 	pxTdf->usId						= usTdfIdTimestamp;
 	pxTdf->pucData					= pxParser->pucBuffer + pxParser->ulCurrentOffset - pucTdfStructLengths[usTdf];
 	pxTdf->ucDataLen				= pucTdfStructLengths[usTdf];
+	pxTdf->xTime					= xTime;
+
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvTdfSegmentStart( xTdfParser_t *pxParser, uint16_t usTdfIdTimestamp, xTdf_t *pxTdf )
+{
+	uint16_t usTimestampType = TDF_TIMESTAMP_MASK & usTdfIdTimestamp;
+	uint32_t ulHeaderLen	 = 5;
+	uint8_t *pucHeader		 = pxParser->pucBuffer + pxParser->ulCurrentOffset;
+	uint16_t usTdf;
+
+	/* Compressed segments only support global timestamps or none */
+	if ( ( usTimestampType != TDF_TIMESTAMP_NONE ) && ( usTimestampType != TDF_TIMESTAMP_GLOBAL ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( usTimestampType == TDF_TIMESTAMP_GLOBAL ) {
+		ulHeaderLen += sizeof( xTdfTime_t );
+	}
+	if ( pxParser->ulCurrentOffset + ulHeaderLen > pxParser->ulBufferLen ) {
+		return ERROR_INVALID_DATA;
+	}
+	/* The reserved header is followed by the TDF ID of the records */
+	usTdf = TDF_ID_MASK & LE_U16_EXTRACT( pucHeader + 2 );
+	if ( !TDF_ID_KNOWN( usTdf ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( pxParser->ulCurrentOffset + ulHeaderLen + pucTdfStructLengths[usTdf] > pxParser->ulBufferLen ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( pucHeader[4] == 0 ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( usTimestampType == TDF_TIMESTAMP_GLOBAL ) {
+		pxParser->xBufferTime.ulSecondsSince2000 = LE_U32_EXTRACT( pucHeader + 5 );
+		pxParser->xBufferTime.usSecondsFraction  = LE_U16_EXTRACT( pucHeader + 9 );
+	}
+	/* First record is stored verbatim */
+	pvMemcpy( pxParser->pucSegmentRecord, pucHeader + ulHeaderLen, pucTdfStructLengths[usTdf] );
+	pxParser->ulCurrentOffset += ulHeaderLen + pucTdfStructLengths[usTdf];
+	pxParser->usSegmentId		 = usTdf | usTimestampType;
+	pxParser->ucSegmentRemaining = pucHeader[4] - 1;
+	pxParser->ucRunRemaining	 = 0;
+
+	pxTdf->usId						= pxParser->usSegmentId;
+	pxTdf->pucData					= pxParser->pucSegmentRecord;
+	pxTdf->ucDataLen				= pucTdfStructLengths[usTdf];
 	pxTdf->xTime.ulSecondsSince2000 = pxParser->xBufferTime.ulSecondsSince2000;
 	pxTdf->xTime.usSecondsFraction  = pxParser->xBufferTime.usSecondsFraction;
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvTdfSegmentNext( xTdfParser_t *pxParser, xTdf_t *pxTdf )
+{
+	uint16_t usTdf	 = TDF_ID_MASK & pxParser->usSegmentId;
+	uint8_t *pucRecord = pxParser->pucSegmentRecord;
+	uint32_t ulValue, ulFraction;
+	uint16_t usWord;
+	uint8_t  ucLength;
+	uint8_t  i;
+
+	/* Any decoding failure invalidates the remainder of the segment */
+	pxParser->ucSegmentRemaining--;
+
+	if ( !TDF_ID_KNOWN( usTdf ) ) {
+		pxParser->ucSegmentRemaining = 0;
+		return ERROR_INVALID_DATA;
+	}
+	ucLength = pucTdfStructLengths[usTdf];
+
+	if ( TDF_TIMESTAMP( pxParser->usSegmentId ) == TDF_TIMESTAMP_GLOBAL ) {
+		/* Start of a new run of time differences */
+		if ( pxParser->ucRunRemaining == 0 ) {
+			if ( !prvVarintDecode( pxParser, &pxParser->ulRunDelta ) || ( pxParser->ulCurrentOffset >= pxParser->ulBufferLen ) ) {
+				pxParser->ucSegmentRemaining = 0;
+				return ERROR_INVALID_DATA;
+			}
+			pxParser->ucRunRemaining = pxParser->pucBuffer[pxParser->ulCurrentOffset++];
+			if ( pxParser->ucRunRemaining == 0 ) {
+				pxParser->ucSegmentRemaining = 0;
+				return ERROR_INVALID_DATA;
+			}
+		}
+		pxParser->ucRunRemaining--;
+		ulFraction								 = (uint32_t) pxParser->xBufferTime.usSecondsFraction + ( pxParser->ulRunDelta & 0xFFFF );
+		pxParser->xBufferTime.ulSecondsSince2000 += ( pxParser->ulRunDelta >> 16 ) + ( ulFraction >> 16 );
+		pxParser->xBufferTime.usSecondsFraction = (uint16_t) ulFraction;
+	}
+	/* Apply word wise differences to the previous record */
+	for ( i = 0; i < ucLength; i += 2 ) {
+		if ( !prvVarintDecode( pxParser, &ulValue ) || ( ulValue > UINT16_MAX ) ) {
+			pxParser->ucSegmentRemaining = 0;
+			return ERROR_INVALID_DATA;
+		}
+		usWord = pucRecord[i];
+		if ( ( i + 1 ) < ucLength ) {
+			usWord |= (uint16_t) pucRecord[i + 1] << 8;
+		}
+		usWord += ZIGZAG_DECODE_16BIT( (uint16_t) ulValue );
+		pucRecord[i] = (uint8_t) usWord;
+		if ( ( i + 1 ) < ucLength ) {
+			pucRecord[i + 1] = (uint8_t) ( usWord >> 8 );
+		}
+	}
 
+	pxTdf->usId						= pxParser->usSegmentId;
+	pxTdf->pucData					= pucRecord;
+	pxTdf->ucDataLen				= ucLength;
+	pxTdf->xTime.ulSecondsSince2000 = pxParser->xBufferTime.ulSecondsSince2000;
+	pxTdf->xTime.usSecondsFraction  = pxParser->xBufferTime.usSecondsFraction;
 	return ERROR_NONE;
 }
 
 /*-----------------------------------------------------------*/
+
+static bool prvVarintDecode( xTdfParser_t *pxParser, uint32_t *pulValue )
+{
+	uint32_t ulValue = 0;
+	uint8_t  ucShift = 0;
+	uint8_t  ucByte;
+	do {
+		if ( ( pxParser->ulCurrentOffset >= pxParser->ulBufferLen ) || ( ucShift > 28 ) ) {
+			return false;
+		}
+		ucByte = pxParser->pucBuffer[pxParser->ulCurrentOffset++];
+		ulValue |= (uint32_t) ( ucByte & 0x7F ) << ucShift;
+		ucShift += 7;
+	} while ( ucByte & 0x80 );
+	*pulValue = ulValue;
+	return true;
+}
+
+/*-----------------------------------------------------------*/
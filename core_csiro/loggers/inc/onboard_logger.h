@@ -8,11 +8,29 @@
  *
  * Logger device for onboard flash chips
  * 
+ * In wrap mode, sectors are erased by the logger as the write head reaches them.
+ * Setting ONBOARD_LOGGER_ERASE_AHEAD in "FreeRTOSConfigApp.h" moves these erases
+ * to a low priority task, which keeps that many sectors ahead of the write head
+ * erased whenever the system is otherwise idle.
+ * 
+ * The data in the erased sectors is lost earlier than it would otherwise be,
+ * and the window wraps at the end of the flash, so erase ahead should only be
+ * used with wrapping loggers that span the remainder of the device.
+ * 
+ * Setting ONBOARD_LOGGER_WEAR_LEVELLING stores blocks through the flash_wear
+ * layer. Each erase moves the sector to the least worn spare, cold data is
+ * periodically moved onto worn sectors, and failing sectors are retired.
+ * Each sector loses one page to wear metadata, and the device must be erased
+ * when the option is changed. Only the sectors from the logger start block to
+ * the end of the device are managed, blocks reserved before the logger (such
+ * as OTA images) are never touched.
+ * 
  */
 #ifndef __CSIRO_CORE_ONBOARD_LOGGER
 #define __CSIRO_CORE_ONBOARD_LOGGER
 /* Includes -------------------------------------------------*/
 
+#include "flash_wear.h"
 #include "logger.h"
 
 /* Module Defines -------------------------------------------*/
@@ -20,6 +38,33 @@
 // clang-format off
 // clang-format on
 
+/* Type Definitions -----------------------------------------*/
+
+/**@brief Erase ahead statistics, all counts are since boot */
+typedef struct xOnboardLoggerEraseStats_t
+{
+	uint32_t   ulEraseDebt;		   /**< Sectors in the erase ahead window that are not yet erased */
+	uint32_t   ulBackgroundErases; /**< Sectors erased by the background task */
+	uint32_t   ulStallErases;	  /**< Sectors erased while the writer waited */
+	uint32_t   ulStalls;		   /**< Block preparations that had to wait for an erase */
+	TickType_t xStallTicks;		   /**< Total time spent waiting for erases */
+	TickType_t xMaxStallTicks;	 /**< Longest single wait for an erase */
+} xOnboardLoggerEraseStats_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Query the erase ahead statistics
+ * 
+ * @param[out] pxStats			Current statistics, zeroed if ONBOARD_LOGGER_ERASE_AHEAD is not enabled
+ */
+void vOnboardLoggerEraseStats( xOnboardLoggerEraseStats_t *pxStats );
+
+/**@brief Query the wear levelling statistics
+ * 
+ * @param[out] pxStats			Current statistics, zeroed if ONBOARD_LOGGER_WEAR_LEVELLING is not enabled
+ */
+void vOnboardLoggerWearStats( xFlashWearStats_t *pxStats );
+
 /* Variable Declarations ------------------------------------*/
 
 extern const xLoggerDevice_t xOnboardLoggerDevice;
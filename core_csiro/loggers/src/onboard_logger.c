@@ -7,20 +7,106 @@
 
 #include "onboard_logger.h"
 
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
 #include "board.h"
+#include "cpu_arch.h"
 #include "flash_interface.h"
+#include "flash_wear.h"
+#include "log.h"
+#include "memory_operations.h"
 
 /* Private Defines ------------------------------------------*/
 // clang-format off
 
+/**
+ *  Default behaviour:
+ *  	Sectors are erased synchronously when the write head reaches them
+ *  Alternate behaviour:
+ * 		A background task keeps ONBOARD_LOGGER_ERASE_AHEAD sectors past the write head erased
+ * 		ONBOARD_LOGGER_ERASE_AHEAD should be set in "FreeRTOSConfigApp.h" if alternate functionality is desired
+ **/
+#ifndef ONBOARD_LOGGER_ERASE_AHEAD
+#define ONBOARD_LOGGER_ERASE_AHEAD  0
+#endif
+
+/**
+ *  Default behaviour:
+ *  	Logger blocks map directly onto flash pages
+ *  Alternate behaviour:
+ * 		Blocks are stored through the flash_wear layer, which spreads erases over the device and retires failing sectors
+ * 		ONBOARD_LOGGER_WEAR_SPARES sectors are reserved for remapping, and one page of every sector holds wear metadata
+ * 		Changes the on-flash layout, the device must be erased when enabling or disabling
+ * 		ONBOARD_LOGGER_WEAR_LEVELLING should be set in "FreeRTOSConfigApp.h" if alternate functionality is desired
+ **/
+#ifndef ONBOARD_LOGGER_WEAR_LEVELLING
+#define ONBOARD_LOGGER_WEAR_LEVELLING           0
+#endif
+
+#ifndef ONBOARD_LOGGER_WEAR_SPARES
+#define ONBOARD_LOGGER_WEAR_SPARES              8
+#endif
+
+/* Erase count spread that causes sectors holding cold data to be moved */
+#ifndef ONBOARD_LOGGER_WEAR_STATIC_THRESHOLD
+#define ONBOARD_LOGGER_WEAR_STATIC_THRESHOLD    64
+#endif
+
+#define SECTOR_INVALID              UINT32_MAX
+
 // clang-format on
 
 /* Type Definitions -----------------------------------------*/
 
 /* Function Declarations ------------------------------------*/
 
+static uint16_t		  prvSectorBlocks( void );
+static uint32_t		  prvNumSectors( void );
+static uint32_t		  prvFirstBlock( void );
+static eModuleError_t prvEraseSector( uint32_t ulSector );
+
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+static xFlashWear_t *prvWear( void );
+#endif
+
+#if ONBOARD_LOGGER_ERASE_AHEAD > 0
+static uint32_t		  prvEraseAheadNext( uint32_t ulSector, uint32_t ulCount );
+static eModuleError_t prvEraseAheadPrepare( uint32_t ulBlockNum );
+static void			  prvEraseAheadComplete( uint32_t ulSector, eModuleError_t eError );
+void				  prvEraseAheadTask( void *pvParameters );
+#endif
+
 /* Private Variables ----------------------------------------*/
 
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+static xFlashWear_t   xWear;
+static bool			  bWearStarted = false;
+static volatile bool bWearReady   = false;
+
+/* Blocks before the logger are reserved for other uses, such as OTA images, and are outside the wear region */
+static uint32_t ulWearFirstBlock = 0;
+#endif
+
+#if ONBOARD_LOGGER_ERASE_AHEAD > 0
+STATIC_TASK_STRUCTURES( pxEraseAheadTask, configMINIMAL_STACK_SIZE, tskIDLE_PRIORITY + 1 );
+STATIC_SEMAPHORE_STRUCTURES( xEraseComplete );
+
+/* Blocks [ulLoggerStartBlock, ulLoggerEndBlock) belong to the logger, blocks before it may hold OTA images */
+static uint32_t ulLoggerStartBlock = 0;
+static uint32_t ulLoggerEndBlock   = UINT32_MAX;
+
+/* The window only covers sectors [ulFirstSector, ulFirstSector + ulNumSectors) and wraps within them */
+/* Sectors [ulWriteSector, ulWriteSector + ulErasedSectors) are known to be erased */
+static uint32_t					  ulFirstSector;
+static uint32_t					  ulNumSectors;
+static uint32_t					  ulWriteSector   = SECTOR_INVALID;
+static uint32_t					  ulErasedSectors = 0;
+static bool						  bEraseInProgress;
+static xOnboardLoggerEraseStats_t xEraseStats;
+#endif
+
 /*-----------------------------------------------------------*/
 
 static eModuleError_t eConfigure( uint16_t usSetting, void *pvParameters )
@@ -30,10 +116,28 @@ static eModuleError_t eConfigure( uint16_t usSetting, void *pvParameters )
 			*( (uint8_t *) pvParameters ) = pxOnboardFlash->xSettings.ucEraseByte;
 			break;
 		case LOGGER_CONFIG_GET_NUM_BLOCKS:
-			*( (uint32_t *) pvParameters ) = pxOnboardFlash->xSettings.ulNumPages;
+			*( (uint32_t *) pvParameters ) = prvFirstBlock() + ( prvNumSectors() * prvSectorBlocks() );
 			break;
 		case LOGGER_CONFIG_GET_ERASE_UNIT:
-			*( (uint8_t *) pvParameters ) = pxOnboardFlash->xSettings.usErasePages;
+			*( (uint8_t *) pvParameters ) = prvSectorBlocks();
+			break;
+		case LOGGER_CONFIG_SET_START_BLOCK:
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+			/* The wear region is fixed once the mapping table has been built */
+			configASSERT( !bWearStarted || ( ulWearFirstBlock == *( (uint32_t *) pvParameters ) ) );
+			ulWearFirstBlock = *( (uint32_t *) pvParameters );
+#endif
+#if ONBOARD_LOGGER_ERASE_AHEAD > 0
+			/* The window is fixed once the first block has been prepared */
+			configASSERT( ( pxEraseAheadTask == NULL ) || ( ulLoggerStartBlock == *( (uint32_t *) pvParameters ) ) );
+			ulLoggerStartBlock = *( (uint32_t *) pvParameters );
+#endif
+			break;
+		case LOGGER_CONFIG_SET_END_BLOCK:
+#if ONBOARD_LOGGER_ERASE_AHEAD > 0
+			configASSERT( ( pxEraseAheadTask == NULL ) || ( ulLoggerEndBlock == *( (uint32_t *) pvParameters ) ) );
+			ulLoggerEndBlock = *( (uint32_t *) pvParameters );
+#endif
 			break;
 		default:
 			break;
@@ -53,34 +157,304 @@ static eModuleError_t eStatus( uint16_t usType )
 
 static eModuleError_t eReadBlock( uint32_t ulBlockNum, uint16_t usOffset, void *pvBlockData, uint32_t ulBlockSize )
 {
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+	return eFlashWearRead( prvWear(), ulBlockNum - ulWearFirstBlock, usOffset, pvBlockData, ulBlockSize );
+#else
 	uint64_t ullAddress = ( (uint64_t) ulBlockNum << pxOnboardFlash->xSettings.ucPageSizePower ) + usOffset;
 	return eFlashRead( pxOnboardFlash, ullAddress, pvBlockData, ulBlockSize, pdMS_TO_TICKS( 1000 ) );
+#endif
 }
 
 /*-----------------------------------------------------------*/
 
 static eModuleError_t eWriteBlock( uint32_t ulBlockNum, void *pvBlockData, uint32_t ulBlockSize )
 {
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+	return eFlashWearWrite( prvWear(), ulBlockNum - ulWearFirstBlock, pvBlockData, ulBlockSize );
+#else
 	uint64_t ullAddress = ( (uint64_t) ulBlockNum << pxOnboardFlash->xSettings.ucPageSizePower );
 	return eFlashWrite( pxOnboardFlash, ullAddress, pvBlockData, ulBlockSize, pdMS_TO_TICKS( 1000 ) );
+#endif
 }
 
 /*-----------------------------------------------------------*/
 
 static eModuleError_t ePrepareBlock( uint32_t ulBlockNum )
 {
-	uint64_t ullAddress  = ( (uint64_t) ulBlockNum << pxOnboardFlash->xSettings.ucPageSizePower );
-	uint32_t ulEraseSize = pxOnboardFlash->xSettings.usErasePages << pxOnboardFlash->xSettings.ucPageSizePower;
-
+	/* Sectors are counted from the first block of the device region */
+	ulBlockNum -= prvFirstBlock();
+#if ONBOARD_LOGGER_ERASE_AHEAD > 0
+	return prvEraseAheadPrepare( ulBlockNum );
+#else
 	/* If the block is the start of an erase boundary, erase if */
-	if ( ulBlockNum % pxOnboardFlash->xSettings.usErasePages == 0 ) {
-		return eFlashErase( pxOnboardFlash, ullAddress, ulEraseSize, pdMS_TO_TICKS( 1000 ) );
+	if ( ulBlockNum % prvSectorBlocks() == 0 ) {
+		return prvEraseSector( ulBlockNum / prvSectorBlocks() );
 	}
 	return ERROR_NONE;
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvSectorBlocks( void )
+{
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+	return prvWear()->usDataPages;
+#else
+	return pxOnboardFlash->xSettings.usErasePages;
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvNumSectors( void )
+{
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+	return prvWear()->usLogicalSectors;
+#else
+	return pxOnboardFlash->xSettings.ulNumPages / pxOnboardFlash->xSettings.usErasePages;
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvFirstBlock( void )
+{
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+	return ulWearFirstBlock;
+#else
+	return 0;
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+
+static xFlashWear_t *prvWear( void )
+{
+	CRITICAL_SECTION_DECLARE;
+	xFlashSettings_t *pxSettings = &pxOnboardFlash->xSettings;
+	eModuleError_t	  eError;
+	bool			  bInitialise;
+	/* The mapping table is rebuilt on first use, after the flash task has started */
+	CRITICAL_SECTION_START();
+	bInitialise  = !bWearStarted;
+	bWearStarted = true;
+	CRITICAL_SECTION_STOP();
+	if ( bInitialise ) {
+		/* The region starts at the first whole sector after the reserved blocks and runs to the end of the device */
+		xWear.pxDevice			= pxOnboardFlash;
+		xWear.ulFirstSector		= ( ulWearFirstBlock + pxSettings->usErasePages - 1 ) / pxSettings->usErasePages;
+		xWear.usNumSectors		= ( pxSettings->ulNumPages / pxSettings->usErasePages ) - xWear.ulFirstSector;
+		xWear.usNumSpares		= ONBOARD_LOGGER_WEAR_SPARES;
+		xWear.ulStaticThreshold = ONBOARD_LOGGER_WEAR_STATIC_THRESHOLD;
+		eError					= eFlashWearInit( &xWear );
+		configASSERT( eError == ERROR_NONE );
+		bWearReady = true;
+	}
+	/* Other tasks may arrive while the first is still initialising */
+	while ( !bWearReady ) {
+		vTaskDelay( 1 );
+	}
+	return &xWear;
+}
+
+#endif /* ONBOARD_LOGGER_WEAR_LEVELLING */
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvEraseSector( uint32_t ulSector )
+{
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+	return eFlashWearErase( prvWear(), ulSector );
+#else
+	xFlashSettings_t *pxSettings  = &pxOnboardFlash->xSettings;
+	uint32_t		  ulEraseSize = pxSettings->usErasePages << pxSettings->ucPageSizePower;
+	uint64_t		  ullAddress  = (uint64_t) ulSector * ulEraseSize;
+	return eFlashErase( pxOnboardFlash, ullAddress, ulEraseSize, pdMS_TO_TICKS( 1000 ) );
+#endif
 }
 
 /*-----------------------------------------------------------*/
 
+void vOnboardLoggerEraseStats( xOnboardLoggerEraseStats_t *pxStats )
+{
+#if ONBOARD_LOGGER_ERASE_AHEAD > 0
+	CRITICAL_SECTION_DECLARE;
+	CRITICAL_SECTION_START();
+	*pxStats			 = xEraseStats;
+	pxStats->ulEraseDebt = ( ulWriteSector == SECTOR_INVALID ) ? 0 : ( ONBOARD_LOGGER_ERASE_AHEAD + 1 - ulErasedSectors );
+	CRITICAL_SECTION_STOP();
+#else
+	pvMemset( pxStats, 0x00, sizeof( xOnboardLoggerEraseStats_t ) );
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+void vOnboardLoggerWearStats( xFlashWearStats_t *pxStats )
+{
+#if ONBOARD_LOGGER_WEAR_LEVELLING
+	vFlashWearStats( prvWear(), pxStats );
+#else
+	pvMemset( pxStats, 0x00, sizeof( xFlashWearStats_t ) );
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+#if ONBOARD_LOGGER_ERASE_AHEAD > 0
+
+/* The sector ulCount after ulSector, wrapping within the logger sectors */
+static uint32_t prvEraseAheadNext( uint32_t ulSector, uint32_t ulCount )
+{
+	return ulFirstSector + ( ( ulSector - ulFirstSector + ulCount ) % ulNumSectors );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvEraseAheadPrepare( uint32_t ulBlockNum )
+{
+	CRITICAL_SECTION_DECLARE;
+	uint16_t	   usSectorBlocks = prvSectorBlocks();
+	uint32_t	   ulSector		  = ulBlockNum / usSectorBlocks;
+	TickType_t	 xStart		= xTaskGetTickCount();
+	bool		   bStalled		= false;
+	bool		   bErased, bBusy;
+	eModuleError_t eError = ERROR_NONE;
+
+	if ( pxEraseAheadTask == NULL ) {
+		/* Sectors whose first block is inside the logger, the same sectors that are erased synchronously without erase ahead */
+		uint32_t ulStart = ulLoggerStartBlock - prvFirstBlock();
+		uint32_t ulEnd	 = prvNumSectors() * usSectorBlocks;
+		if ( ( ulLoggerEndBlock - prvFirstBlock() ) < ulEnd ) {
+			ulEnd = ulLoggerEndBlock - prvFirstBlock();
+		}
+		ulFirstSector = ( ulStart + usSectorBlocks - 1 ) / usSectorBlocks;
+		ulNumSectors  = ( ( ulEnd + usSectorBlocks - 1 ) / usSectorBlocks ) - ulFirstSector;
+		configASSERT( ONBOARD_LOGGER_ERASE_AHEAD < ulNumSectors );
+		STATIC_SEMAPHORE_CREATE_BINARY( xEraseComplete );
+		STATIC_TASK_CREATE( pxEraseAheadTask, prvEraseAheadTask, "EraseAhead", NULL );
+	}
+	/* Sectors outside the window are not the logger's to erase, a partial first sector is shared with the reserved blocks */
+	if ( ( ulSector < ulFirstSector ) || ( ulSector >= ( ulFirstSector + ulNumSectors ) ) ) {
+		return ERROR_NONE;
+	}
+
+	CRITICAL_SECTION_START();
+	if ( ( ulWriteSector != SECTOR_INVALID ) && ( ulSector == prvEraseAheadNext( ulWriteSector, 1 ) ) ) {
+		/* Sequential progress, the erased window shrinks by the sector we left */
+		ulErasedSectors = ( ulErasedSectors > 0 ) ? ulErasedSectors - 1 : 0;
+		ulWriteSector   = ulSector;
+	}
+	else if ( ulSector != ulWriteSector ) {
+		/* Logger has moved, nothing ahead is known to be erased. A partially written sector is already prepared */
+		ulErasedSectors = ( ulBlockNum % usSectorBlocks == 0 ) ? 0 : 1;
+		ulWriteSector   = ulSector;
+	}
+	CRITICAL_SECTION_STOP();
+
+	/* Wait until the sector under the write head is erased */
+	for ( ;; ) {
+		CRITICAL_SECTION_START();
+		bErased = ( ulErasedSectors > 0 );
+		bBusy   = bEraseInProgress;
+		if ( !bErased && !bBusy ) {
+			bEraseInProgress = true;
+		}
+		CRITICAL_SECTION_STOP();
+		if ( bErased ) {
+			break;
+		}
+		bStalled = true;
+		if ( bBusy ) {
+			/* The background task is erasing, which will be this sector if the logger was sequential */
+			xSemaphoreTake( xEraseComplete, portMAX_DELAY );
+			continue;
+		}
+		eError = prvEraseSector( ulSector );
+		prvEraseAheadComplete( ulSector, eError );
+		if ( eError != ERROR_NONE ) {
+			break;
+		}
+		CRITICAL_SECTION_START();
+		xEraseStats.ulStallErases++;
+		CRITICAL_SECTION_STOP();
+	}
+
+	if ( bStalled ) {
+		TickType_t xStalled = xTaskGetTickCount() - xStart;
+		CRITICAL_SECTION_START();
+		xEraseStats.ulStalls++;
+		xEraseStats.xStallTicks += xStalled;
+		xEraseStats.xMaxStallTicks = ( xStalled > xEraseStats.xMaxStallTicks ) ? xStalled : xEraseStats.xMaxStallTicks;
+		CRITICAL_SECTION_STOP();
+		eLog( LOG_LOGGER, LOG_DEBUG, "Onboard Log: Stalled %d ticks preparing sector %d\r\n", xStalled, ulSector );
+	}
+	/* Top up the erased window in the background */
+	if ( ulErasedSectors <= ONBOARD_LOGGER_ERASE_AHEAD ) {
+		xTaskNotifyGive( pxEraseAheadTask );
+	}
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvEraseAheadComplete( uint32_t ulSector, eModuleError_t eError )
+{
+	CRITICAL_SECTION_DECLARE;
+	CRITICAL_SECTION_START();
+	bEraseInProgress = false;
+	/* The write head may have jumped while the erase was running */
+	if ( ( eError == ERROR_NONE ) && ( ulSector == prvEraseAheadNext( ulWriteSector, ulErasedSectors ) ) ) {
+		ulErasedSectors++;
+	}
+	CRITICAL_SECTION_STOP();
+	xSemaphoreGive( xEraseComplete );
+}
+
+/*-----------------------------------------------------------*/
+
+ATTR_NORETURN void prvEraseAheadTask( void *pvParameters )
+{
+	CRITICAL_SECTION_DECLARE;
+	uint32_t	   ulSector = 0;
+	bool		   bErase;
+	eModuleError_t eError;
+	UNUSED( pvParameters );
+
+	for ( ;; ) {
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+		do {
+			CRITICAL_SECTION_START();
+			bErase = !bEraseInProgress && ( ulErasedSectors <= ONBOARD_LOGGER_ERASE_AHEAD );
+			if ( bErase ) {
+				bEraseInProgress = true;
+				ulSector		 = prvEraseAheadNext( ulWriteSector, ulErasedSectors );
+			}
+			CRITICAL_SECTION_STOP();
+			if ( !bErase ) {
+				break;
+			}
+			eError = prvEraseSector( ulSector );
+			prvEraseAheadComplete( ulSector, eError );
+			if ( eError != ERROR_NONE ) {
+				/* Retry on the next preparation, the writer will fall back to erasing synchronously */
+				eLog( LOG_LOGGER, LOG_ERROR, "Onboard Log: Failed to erase sector %d\r\n", ulSector );
+				break;
+			}
+			CRITICAL_SECTION_START();
+			xEraseStats.ulBackgroundErases++;
+			CRITICAL_SECTION_STOP();
+		} while ( bErase );
+	}
+}
+
+#endif /* ONBOARD_LOGGER_ERASE_AHEAD > 0 */
+
+/*-----------------------------------------------------------*/
+
 LOGGER_DEVICE( xOnboardLoggerDevice, eConfigure, eStatus, eReadBlock, eWriteBlock, ePrepareBlock );
 
 /*-----------------------------------------------------------*/
@@ -14,6 +14,7 @@
 #include "FreeRTOS.h"
 
 #include "cpu_arch.h"
+#include "csiro_math.h"
 #include "leds.h"
 #include "memory_operations.h"
 
@@ -36,6 +37,16 @@
 #define SD_RAM_BUFFER_FLUSH_PERCENTAGE 90
 #endif
 
+/**
+ *  Sequential readback:
+ * 		A read of the page following the previously read page fetches SD_READ_AHEAD_PAGES pages
+ * 		with a single multiple block read, following reads are then served from RAM
+ * 		SD_READ_AHEAD_PAGES should be set in "FreeRTOSConfigApp.h" to enable
+ **/
+#ifndef SD_READ_AHEAD_PAGES
+#define SD_READ_AHEAD_PAGES 1
+#endif
+
 #define RAM_BUFFER_INDEX_INCREMENT(x) (((x) + 1) % SD_RAM_BUFFER_PAGES)
 
 // clang-format on
@@ -47,6 +58,11 @@ void prvSdDumpTask( void *pvParameters );
 
 static inline uint32_t ulBufferItems( void );
 
+static void prvReadAheadInvalidate( uint32_t ulFirstBlock, uint32_t ulNumBlocks );
+#if SD_READ_AHEAD_PAGES > 1
+static bool prvReadAheadUnchanged( uint32_t ulFirstBlock, uint32_t ulNumBlocks );
+#endif
+
 /* Private Variables ----------------------------------------*/
 
 STATIC_TASK_STRUCTURES( pxSdDumpTask, configMINIMAL_STACK_SIZE, tskIDLE_PRIORITY + 1 );
@@ -58,6 +74,17 @@ static uint16_t usRamBufferHead;
 static uint16_t usRamBufferTail;
 static uint32_t ulRamBufferBasePage = UINT32_MAX;
 
+#if SD_READ_AHEAD_PAGES > 1
+/* Only accessed by the reading task */
+static uint8_t  pucReadAhead[SD_READ_AHEAD_PAGES * 512];
+static uint32_t ulReadAheadBase  = UINT32_MAX;
+static uint32_t ulReadAheadCount = 0;
+static uint32_t ulLastReadBlock  = UINT32_MAX;
+/* Pages written since the reading task last checked, updated by any task */
+static uint32_t ulWrittenFirst = UINT32_MAX;
+static uint32_t ulWrittenEnd   = 0;
+#endif
+
 /* Functions ------------------------------------------------*/
 
 static eModuleError_t eConfigure( uint16_t usSetting, void *pvParameters )
@@ -104,6 +131,42 @@ static eModuleError_t eReadBlock( uint32_t ulBlockNum, uint16_t usOffset, void *
 	configASSERT( ulBlockSize != 0 );
 	configASSERT( pvBlockData != NULL );
 
+#if SD_READ_AHEAD_PAGES > 1
+	xSdParameters_t xParameters;
+	eModuleError_t  eError;
+	bool bSequential = ( ulBlockNum == ( ulLastReadBlock + 1 ) );
+	ulLastReadBlock  = ulBlockNum;
+	/* Drop the cached pages if any of them have been written since they were read */
+	if ( ( ulReadAheadBase != UINT32_MAX ) && !prvReadAheadUnchanged( ulReadAheadBase, ulReadAheadCount ) ) {
+		ulReadAheadBase = UINT32_MAX;
+	}
+	/* Page was fetched by a previous read ahead */
+	if ( ( ulReadAheadBase != UINT32_MAX ) && ( ulBlockNum >= ulReadAheadBase ) && ( ulBlockNum < ( ulReadAheadBase + ulReadAheadCount ) ) ) {
+		pvMemcpy( pvBlockData, pucReadAhead + ( 512 * ( ulBlockNum - ulReadAheadBase ) ) + usOffset, ulBlockSize );
+		return ERROR_NONE;
+	}
+	/* Sequential readback, fetch the following pages in a single transaction */
+	if ( bSequential ) {
+		eSdParameters( &xParameters );
+		uint32_t ulNumBlocks = ( ulBlockNum < xParameters.ulNumBlocks ) ? MIN( SD_READ_AHEAD_PAGES, xParameters.ulNumBlocks - ulBlockNum ) : 0;
+		if ( ulNumBlocks > 1 ) {
+			ulReadAheadBase = UINT32_MAX;
+			/* Writes completed before now are on the card, only those which complete during the read can make it stale */
+			prvReadAheadUnchanged( 0, 0 );
+			eError = eSdMultiBlockRead( ulBlockNum, ulNumBlocks, pucReadAhead, pdMS_TO_TICKS( 1000 ) );
+			if ( eError != ERROR_NONE ) {
+				return eError;
+			}
+			pvMemcpy( pvBlockData, pucReadAhead + usOffset, ulBlockSize );
+			if ( prvReadAheadUnchanged( ulBlockNum, ulNumBlocks ) ) {
+				ulReadAheadCount = ulNumBlocks;
+				ulReadAheadBase  = ulBlockNum;
+			}
+			return ERROR_NONE;
+		}
+	}
+#endif /* SD_READ_AHEAD_PAGES > 1 */
+
 	return eSdBlockRead( ulBlockNum, usOffset, pvBlockData, usBlockSize, pdMS_TO_TICKS( 1000 ) );
 }
 
@@ -139,7 +202,9 @@ static eModuleError_t eWriteBlock( uint32_t ulBlockNum, void *pvBlockData, uint3
 	}
 	/* If no RAM buffering, write it directly */
 	else {
-		return eSdBlockWrite( ulBlockNum, 0, pvBlockData, usBlockSize, pdMS_TO_TICKS( 1000 ) );
+		eModuleError_t eError = eSdBlockWrite( ulBlockNum, 0, pvBlockData, usBlockSize, pdMS_TO_TICKS( 1000 ) );
+		prvReadAheadInvalidate( ulBlockNum, 1 );
+		return eError;
 	}
 	return ERROR_NONE;
 }
@@ -166,11 +231,17 @@ ATTR_NORETURN void prvSdDumpTask( void *pvParameters )
 		ulPagesDumped = 0;
 		/* Write pages until the tail matches the head */
 		while ( usRamBufferTail != usRamBufferHead ) {
-			eLog( LOG_LOGGER, LOG_VERBOSE, "SD Log:  Dump writing to page %d from buffer offset %d\r\n", ulRamBufferBasePage, ( 512 * usRamBufferTail ) );
-			eSdBlockWrite( ulRamBufferBasePage, 0, pucRamBuffer + ( 512 * usRamBufferTail ), 512, pdMS_TO_TICKS( 1000 ) );
-			ulRamBufferBasePage++;
-			ulPagesDumped++;
-			usRamBufferTail = RAM_BUFFER_INDEX_INCREMENT( usRamBufferTail );
+			/* Pages from the tail up to the head or the end of the buffer are contiguous in RAM and on the card */
+			uint16_t usHead  = usRamBufferHead;
+			uint16_t usPages = ( ( usHead > usRamBufferTail ) ? usHead : SD_RAM_BUFFER_PAGES ) - usRamBufferTail;
+			eLog( LOG_LOGGER, LOG_VERBOSE, "SD Log:  Dump writing %d pages to page %d from buffer offset %d\r\n", usPages, ulRamBufferBasePage, ( 512 * usRamBufferTail ) );
+			if ( eSdMultiBlockWrite( ulRamBufferBasePage, usPages, pucRamBuffer + ( 512 * usRamBufferTail ), usPages * pdMS_TO_TICKS( 1000 ) ) != ERROR_NONE ) {
+				eLog( LOG_LOGGER, LOG_ERROR, "SD Log: Failed to write pages %d to %d\r\n", ulRamBufferBasePage, ulRamBufferBasePage + usPages - 1 );
+			}
+			prvReadAheadInvalidate( ulRamBufferBasePage, usPages );
+			ulRamBufferBasePage += usPages;
+			ulPagesDumped += usPages;
+			usRamBufferTail = ( usRamBufferTail + usPages ) % SD_RAM_BUFFER_PAGES;
 		}
 		/* TODO: A time taken in ms would be nice additional information for future */
 		eLog( LOG_LOGGER, LOG_INFO, "SD Log: Wrote %d pages\r\n", ulPagesDumped );
@@ -183,11 +254,51 @@ ATTR_NORETURN void prvSdDumpTask( void *pvParameters )
 
 static eModuleError_t ePrepareBlock( uint32_t ulBlockNum )
 {
-	return eSdEraseBlocks( ulBlockNum, ulBlockNum, pdMS_TO_TICKS( 1000 ) );
+	eModuleError_t eError = eSdEraseBlocks( ulBlockNum, ulBlockNum, pdMS_TO_TICKS( 1000 ) );
+	prvReadAheadInvalidate( ulBlockNum, 1 );
+	return eError;
 }
 
 /*-----------------------------------------------------------*/
 
+/* Called by writers once pages have changed on the card.
+ * Writers can run in the dump task, so only the written range is recorded here,
+ * the cache itself is checked and dropped in the reading task.
+ */
+static void prvReadAheadInvalidate( uint32_t ulFirstBlock, uint32_t ulNumBlocks )
+{
+#if SD_READ_AHEAD_PAGES > 1
+	CRITICAL_SECTION_DECLARE;
+	CRITICAL_SECTION_START();
+	ulWrittenFirst = MIN( ulWrittenFirst, ulFirstBlock );
+	ulWrittenEnd   = MAX( ulWrittenEnd, ulFirstBlock + ulNumBlocks );
+	CRITICAL_SECTION_STOP();
+#else
+	UNUSED( ulFirstBlock );
+	UNUSED( ulNumBlocks );
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+#if SD_READ_AHEAD_PAGES > 1
+/* Consumes the pages written since the last call, returns false if any of them are in the provided range */
+static bool prvReadAheadUnchanged( uint32_t ulFirstBlock, uint32_t ulNumBlocks )
+{
+	CRITICAL_SECTION_DECLARE;
+	uint32_t ulFirst, ulEnd;
+	CRITICAL_SECTION_START();
+	ulFirst		   = ulWrittenFirst;
+	ulEnd		   = ulWrittenEnd;
+	ulWrittenFirst = UINT32_MAX;
+	ulWrittenEnd   = 0;
+	CRITICAL_SECTION_STOP();
+	return ( ulFirst >= ( ulFirstBlock + ulNumBlocks ) ) || ( ulEnd <= ulFirstBlock );
+}
+#endif
+
+/*-----------------------------------------------------------*/
+
 LOGGER_DEVICE( xSdLoggerDevice, eConfigure, eStatus, eReadBlock, eWriteBlock, ePrepareBlock );
 
 /*-----------------------------------------------------------*/
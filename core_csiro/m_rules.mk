@@ -51,6 +51,12 @@ $(APPLICATION_SRCS) $(CORE_CSIRO_SRCS): | $(GENERATED_SRCS)
 # List Processing
 ##############################################################################
 
+# Worst case stack analysis of every object in the application
+# Overhead covers the exception frame and context switch state with an active FPU context (51 words on Cortex-M4F)
+STACK_TASK_OVERHEAD ?= 204
+STACK_MSU := $(REPO_ROOT)/core_external/StackUsage/builtin.msu_master $(CORE_CSIRO_DIR)/stack_usage.msu $(wildcard $(APP_ROOT)/*.msu)
+STACK_ANALYSIS = $(REPO_ROOT)/core_external/StackUsage/WCS.py --readelf $(READELF) --objs "$(OBJ_DIR),$(ARCH_LIB_DIR),$(PLATFORM_LIB_DIR)" --msu $(STACK_MSU)
+
 # List of all compiled libraries in final application
 APP_LIBS := $(foreach lib, $(PLATFORM_LIBS), $(PLATFORM_LIB_DIR)/lib$(lib).a) $(foreach lib, $(ARCH_LIBS), $(ARCH_LIB_DIR)/lib$(lib).a) 
 
@@ -161,10 +167,9 @@ tdf:
 	tdf3tool --output $(CORE_CSIRO_DIR)/libraries/
 
 .PHONY: stack
-## Get stack usage of functions
+## Get stack usage of functions, requires STACK_CHECK
 stack: $(OBJ_DIR)/$(PROJ_NAME).elf
-	@cp $(REPO_ROOT)/core_external/StackUsage/builtin.msu_master $(LIB_DIR)/builtin.msu
-	@$(REPO_ROOT)/core_external/StackUsage/WCS.py --readelf $(READELF) --objs "$(DBG_DIR),$(LIB_DIR)"
+	@$(STACK_ANALYSIS)
 
 .PHONY: size
 ## Prints list of variables in a binary sorted by file size
@@ -189,6 +194,9 @@ OBJ_DEP = $(APP_OBJS:%.o=%.d)
 $(OBJ_DIR)/$(PROJ_NAME).elf: $(APP_OBJS) $(APP_LIBS)
 	$(TRACE_LD)
 	$(Q)$(LD) $(LDFLAGS) $(APP_OBJS) -Wl,--start-group $(APP_LIBS) $(EXTERNAL_LIBS) -Wl,--end-group -o $@
+ifneq ($(STACK_CHECK),)
+	$(Q)$(STACK_ANALYSIS) --tasks $(STACK_CHECK) --task-overhead $(STACK_TASK_OVERHEAD)
+endif
 
 ################
 # HEX File
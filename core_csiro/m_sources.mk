@@ -26,6 +26,9 @@ APPLICATION_SRCS 	+= $(wildcard $(CORE_CSIRO_DIR)/scheduler/activities/src/*.c)
 # .weak function overrides must be included here, otherwise they aren't overwritten properly
 APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/FreeRTOS/src/rtos_hooks.c
 APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/FreeRTOS/src/heap_1.c
+# Only referenced by the kernel library, so also linked as an object
+APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/FreeRTOS/src/rtos_trace.c
+APPLICATION_SRCS 	+= $(CORE_CSIRO_DIR)/arch/common/FreeRTOS/src/stack_monitor.c
 APPLICATION_SRCS	+= $(CORE_CSIRO_DIR)/arch/common/nvm/src/device_nvm_keys.c
 APPLICATION_SRCS 	+= $(wildcard $(CSIRO_ARCH_DIR)/cpu/$(CPU_VARIANT)/src/*)
 
@@ -81,6 +84,7 @@ CORE_CSIRO_INCS 	+= $(CORE_CSIRO_DIR)/interfaces/inc
 CORE_CSIRO_INCS		+= $(CORE_CSIRO_DIR)/libraries/inc
 CORE_CSIRO_INCS 	+= $(CORE_CSIRO_DIR)/loggers/inc
 CORE_CSIRO_INCS		+= $(CORE_CSIRO_DIR)/batteries/inc
+CORE_CSIRO_INCS		+= $(CSIRO_SCHEDULER_DIR)/activities/inc
 
 CORE_CSIRO_INCS 	+= $(CORE_CSIRO_DIR)/platform/common/inc
 CORE_CSIRO_INCS		+= $(wildcard $(CORE_CSIRO_DIR)/arch/common/*/inc)
@@ -137,8 +141,13 @@ endif
 # Memory Map
 LDFLAGS 		+= -Wl,-Map=$(PROJ_NAME)_$(BUILD_MODE).map
 
-# Stack Usage (Disabled Typically)
-# CFLAGS 			+= -c -fdump-rtl-dfinish -fstack-usage
+# Stack Usage Analysis
+#   STACK_CHECK=warn	Report task stacks smaller than their worst case usage after linking
+#   STACK_CHECK=error	Fail the build instead
+# Objects compiled without these flags are not analysed, run 'make clean' when enabling
+ifneq ($(STACK_CHECK),)
+CFLAGS 			+= -fdump-rtl-dfinish -fstack-usage -save-temps=obj
+endif
 
 # Output Binary Ordering
 CFLAGS  		+= -ffunction-sections -fdata-sections
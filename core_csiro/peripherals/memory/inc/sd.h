@@ -43,6 +43,8 @@ eModuleError_t eSdInit( xSdInit_t *pxInit );
 eModuleError_t eSdParameters( xSdParameters_t *pxParameters );
 eModuleError_t eSdBlockRead( uint32_t ulBlockAddress, uint16_t usBlockOffset, uint8_t *pucBuffer, uint16_t usBufferLen, TickType_t xTimeout );
 eModuleError_t eSdBlockWrite( uint32_t ulBlockAddress, uint16_t usBlockOffset, uint8_t *pucBuffer, uint16_t usBufferLen, TickType_t xTimeout );
+eModuleError_t eSdMultiBlockRead( uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer, TickType_t xTimeout );
+eModuleError_t eSdMultiBlockWrite( uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer, TickType_t xTimeout );
 eModuleError_t eSdEraseBlocks( uint32_t ulFirstBlockAddress, uint32_t ulLastBlockAddress, TickType_t xTimeout );
 
 #endif /* __CORE_CSIRO_MEMORY_SD */
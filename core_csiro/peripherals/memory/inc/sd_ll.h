@@ -48,6 +48,7 @@ typedef enum eSdCommand_t {
 	SD_READ_SINGLE_BLOCK	   = 17, // CMD17, Block read
 	SD_READ_MULTIPLE_BLOCK	 = 18, // CMD18, Multiple block read
 	SD_WRITE_BLOCK			   = 24, // CMD24, Block write
+	SD_SET_WR_BLK_ERASE_COUNT  = 23, // ACMD23, Number of blocks to pre-erase before a multiple block write
 	SD_WRITE_MULTIPLE_BLOCK	= 25, // CMD25,  Multiple block write
 	SD_ERASE_WR_BLK_START_ADDR = 32, // CMD32, Erase block start
 	SD_ERASE_WR_BLK_END_ADDR   = 33, // CMD33, Erase block end
@@ -118,6 +119,20 @@ eModuleError_t eSdReadBytes( uint16_t usBlockOffset, uint8_t *pucBuffer, uint32_
 
 eModuleError_t eSdWriteBytes( xSdParameters_t *pxParams, uint16_t usBlockOffset, uint8_t *pucBuffer, uint32_t ulBufferLen );
 
+/**
+ * Data phase of SD_READ_MULTIPLE_BLOCK, terminated with SD_STOP_TRANSMISSION
+ * \param pucBuffer 	Buffer of ulNumBlocks * SD_DEFAULT_BLOCK_SIZE bytes
+ * \param ulNumBlocks 	Number of blocks to receive
+ */
+eModuleError_t eSdReadBlocks( uint8_t *pucBuffer, uint32_t ulNumBlocks );
+
+/**
+ * Data phase of SD_WRITE_MULTIPLE_BLOCK, terminated with a stop token
+ * \param pucBuffer 	Buffer of ulNumBlocks * SD_DEFAULT_BLOCK_SIZE bytes
+ * \param ulNumBlocks 	Number of blocks to send
+ */
+eModuleError_t eSdWriteBlocks( uint8_t *pucBuffer, uint32_t ulNumBlocks );
+
 void vSdParseCSD( uint8_t *pucCSD, xSdParameters_t *pxParams );
 
 void vSdParseSCR( uint8_t *pucCSR, xSdParameters_t *pxParams );
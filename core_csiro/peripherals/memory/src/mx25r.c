@@ -7,6 +7,7 @@
 
 #include "mx25r.h"
 
+#include "csiro_math.h"
 #include "log.h"
 
 /* Private Defines ------------------------------------------*/
@@ -28,6 +29,9 @@
 #define MX25R_COMMAND_BLOCK_ERASE_64K       0xD8 /* Erase a 64kB Block */
 #define MX25R_COMMAND_CHIP_ERASE            0xC7 /* Mass Erase */
 
+#define MX25R_COMMAND_SUSPEND               0xB0 /* Suspend a Program or Erase */
+#define MX25R_COMMAND_RESUME                0x30 /* Resume a Program or Erase */
+
 #define MX25R_COMMAND_READ_SECURITY         0x2B
 #define MX25R_COMMAND_POWER_DOWN            0xB9
 
@@ -38,9 +42,17 @@
 #define MX25R_STATUS_WEL                    0x02
 
 // Security Register Masks
+#define MX25R_SECURITY_ERASE_SUSPENDED      0x08
 #define MX25R_SECURITY_PROGRAM_FAIL         0x20
 #define MX25R_SECURITY_ERASE_FAIL           0x40
 
+/* Once past the typical operation time, poll at this fraction of the typical time */
+#define MX25R_POLL_DIVISOR                  8
+/* Erases must run for a while between suspensions to guarantee forward progress */
+#define MX25R_MIN_ERASE_PROGRESS            pdMS_TO_TICKS( 5 )
+/* tESL is 20us, a status read takes ~5us */
+#define MX25R_SUSPEND_STATUS_POLLS          10
+
 // clang-format on
 /* Type Definitions -----------------------------------------*/
 
@@ -61,6 +73,13 @@ typedef struct xMX25rGenericCommand_t
 	uint8_t *	pucData;
 } xMX25rGenericCommand_t;
 
+/**@brief Datasheet timing of an operation that sets WIP */
+typedef struct xMX25rBusyTiming_t
+{
+	uint32_t ulTypicalMs; /**< Typical duration, WIP is not polled before this */
+	uint32_t ulMaximumMs; /**< Timeout for the operation, excluding time spent suspended */
+} xMX25rBusyTiming_t;
+
 /* Function Declarations ------------------------------------*/
 
 eModuleError_t eMX25rFlashInit( xFlashDevice_t *pxDevice );
@@ -73,7 +92,10 @@ eModuleError_t eMX25rFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStart
 eModuleError_t eMX25rFlashEraseAll( xFlashDevice_t *pxDevice );
 
 static eModuleError_t prvMX25rGenericCommand( xFlashDevice_t *pxDevice, const xMX25rGenericCommand_t *pxCommand );
-static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, TickType_t xPollDelay, TickType_t xTimeout );
+static eModuleError_t prvReadRegister( xFlashDevice_t *pxDevice, uint8_t ucCommand, uint8_t *pucValue );
+static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, const xMX25rBusyTiming_t *pxTiming, uint32_t ulBusyPage, uint32_t ulBusyPages );
+static eModuleError_t prvSuspendForReads( xFlashDevice_t *pxDevice, uint32_t ulBusyPage, uint32_t ulBusyPages );
+static eModuleError_t prvCheckOperationResult( xFlashDevice_t *pxDevice );
 
 /* Private Variables ----------------------------------------*/
 
@@ -118,6 +140,33 @@ static const xMX25rGenericCommand_t xCommandChipErase = {
 	.pucData		= NULL
 };
 
+static const xMX25rGenericCommand_t xCommandSuspend = {
+	.eMode			= SEND_COMMAND_ONLY,
+	.ucCommand		= MX25R_COMMAND_SUSPEND,
+	.ulPageNumber   = NO_ADDRESS,
+	.ucByteOffset   = 0,
+	.ucDummyBytes   = 0,
+	.usNumDataBytes = 0,
+	.pucData		= NULL
+};
+
+static const xMX25rGenericCommand_t xCommandResume = {
+	.eMode			= SEND_COMMAND_ONLY,
+	.ucCommand		= MX25R_COMMAND_RESUME,
+	.ulPageNumber   = NO_ADDRESS,
+	.ucByteOffset   = 0,
+	.ucDummyBytes   = 0,
+	.usNumDataBytes = 0,
+	.pucData		= NULL
+};
+
+/* Typical times from the datasheet, maximums include margin over the datasheet values */
+static const xMX25rBusyTiming_t xTimingPageProgram = { .ulTypicalMs = 1, .ulMaximumMs = 20 };
+static const xMX25rBusyTiming_t xTimingSectorErase = { .ulTypicalMs = 40, .ulMaximumMs = 500 };
+static const xMX25rBusyTiming_t xTimingBlock32k	= { .ulTypicalMs = 240, .ulMaximumMs = 4000 };
+static const xMX25rBusyTiming_t xTimingBlock64k	= { .ulTypicalMs = 480, .ulMaximumMs = 5000 };
+static const xMX25rBusyTiming_t xTimingChipErase   = { .ulTypicalMs = 50000, .ulMaximumMs = 100000 };
+
 /*-----------------------------------------------------------*/
 
 eModuleError_t eMX25rFlashInit( xFlashDevice_t *pxDevice )
@@ -210,8 +259,8 @@ eModuleError_t eMX25rFlashWriteSubpage( xFlashDevice_t *pxDevice, uint32_t ulPag
 	};
 	prvMX25rGenericCommand( pxDevice, &xCommandWriteEnable );
 	prvMX25rGenericCommand( pxDevice, &xWriteCommand );
-	/* Wait for the page write to complete, checking every tick for a maximum of 20ms */
-	return prvWaitWhileBusy( pxDevice, 1, pdMS_TO_TICKS( 20 ) );
+	/* Wait for the page write to complete, programs are too short to be worth suspending */
+	return prvWaitWhileBusy( pxDevice, &xTimingPageProgram, 0, 0 );
 }
 
 /*-----------------------------------------------------------*/
@@ -258,6 +307,7 @@ eModuleError_t eMX25rFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStart
 	const uint16_t usPagesPer32kBlock = 128; /**< 32k Block Erase Operation, T_Max = 3.0s */
 	const uint16_t usPagesPer64kBlock = 256; /**< 64k Block Erase Operation, T_Max = 3.5s */
 
+	eModuleError_t		   eError;
 	xMX25rGenericCommand_t xErase = {
 		.eMode			= SEND_COMMAND_ONLY,
 		.ucCommand		= 0,
@@ -274,17 +324,23 @@ eModuleError_t eMX25rFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStart
 		xErase.ulPageNumber = ulStartPage;
 		prvMX25rGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvMX25rGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 50 ), pdMS_TO_TICKS( 500 ) );
+		eError = prvWaitWhileBusy( pxDevice, &xTimingSectorErase, ulStartPage, usPagesPerSector );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
 		ulStartPage += usPagesPerSector;
 		ulNumPages -= usPagesPerSector;
 	}
-	/* Run 32k erases to the first 64k block */
-	while ( ( ulNumPages > 0 ) && ( ulStartPage % usPagesPer64kBlock != 0 ) ) {
+	/* Run 32k erases to the first 64k block, while a whole 32k block remains */
+	while ( ( ulNumPages >= usPagesPer32kBlock ) && ( ulStartPage % usPagesPer64kBlock != 0 ) ) {
 		xErase.ucCommand	= MX25R_COMMAND_BLOCK_ERASE_32K;
 		xErase.ulPageNumber = ulStartPage;
 		prvMX25rGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvMX25rGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 250 ), pdMS_TO_TICKS( 4000 ) );
+		eError = prvWaitWhileBusy( pxDevice, &xTimingBlock32k, ulStartPage, usPagesPer32kBlock );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
 		ulStartPage += usPagesPer32kBlock;
 		ulNumPages -= usPagesPer32kBlock;
 	}
@@ -294,7 +350,10 @@ eModuleError_t eMX25rFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStart
 		xErase.ulPageNumber = ulStartPage;
 		prvMX25rGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvMX25rGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 250 ), pdMS_TO_TICKS( 5000 ) );
+		eError = prvWaitWhileBusy( pxDevice, &xTimingBlock64k, ulStartPage, usPagesPer64kBlock );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
 		ulStartPage += usPagesPer64kBlock;
 		ulNumPages -= usPagesPer64kBlock;
 	}
@@ -304,7 +363,10 @@ eModuleError_t eMX25rFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStart
 		xErase.ulPageNumber = ulStartPage;
 		prvMX25rGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvMX25rGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 250 ), pdMS_TO_TICKS( 4000 ) );
+		eError = prvWaitWhileBusy( pxDevice, &xTimingBlock32k, ulStartPage, usPagesPer32kBlock );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
 		ulStartPage += usPagesPer32kBlock;
 		ulNumPages -= usPagesPer32kBlock;
 	}
@@ -314,7 +376,10 @@ eModuleError_t eMX25rFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStart
 		xErase.ulPageNumber = ulStartPage;
 		prvMX25rGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvMX25rGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 50 ), pdMS_TO_TICKS( 500 ) );
+		eError = prvWaitWhileBusy( pxDevice, &xTimingSectorErase, ulStartPage, usPagesPerSector );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
 		ulStartPage += usPagesPerSector;
 		ulNumPages -= usPagesPerSector;
 	}
@@ -329,8 +394,8 @@ eModuleError_t eMX25rFlashEraseAll( xFlashDevice_t *pxDevice )
 	prvMX25rGenericCommand( pxDevice, &xCommandWriteEnable );
 	/* Send the erase command */
 	prvMX25rGenericCommand( pxDevice, &xCommandChipErase );
-	/* Wait for the erase to complete, checking once a second for a maximum of 100 seconds */
-	return prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 1000 ), pdMS_TO_TICKS( 100000 ) );
+	/* Wait for the erase to complete, chip erases cannot be suspended */
+	return prvWaitWhileBusy( pxDevice, &xTimingChipErase, 0, 0 );
 }
 
 /*-----------------------------------------------------------*/
@@ -385,28 +450,36 @@ static eModuleError_t prvMX25rGenericCommand( xFlashDevice_t *pxDevice, const xM
 
 /*-----------------------------------------------------------*/
 
-static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, TickType_t xPollDelay, TickType_t xTimeout )
+static eModuleError_t prvReadRegister( xFlashDevice_t *pxDevice, uint8_t ucCommand, uint8_t *pucValue )
 {
-	// This will cause overflow so enter something reasonable.
-	configASSERT( xTimeout != portMAX_DELAY );
-
-	uint8_t		   ucStatus = 0xFF;
-	eModuleError_t eError;
-	TickType_t	 xEndTime = xTaskGetTickCount() + xTimeout;
-
-	xMX25rGenericCommand_t xReadStatus = {
+	xMX25rGenericCommand_t xReadRegister = {
 		.eMode			= READ_DATA,
-		.ucCommand		= MX25R_COMMAND_READ_STATUS,
+		.ucCommand		= ucCommand,
 		.ulPageNumber   = NO_ADDRESS,
 		.ucByteOffset   = 0,
 		.ucDummyBytes   = 0,
 		.usNumDataBytes = 1,
-		.pucData		= &ucStatus
+		.pucData		= pucValue
 	};
+	return prvMX25rGenericCommand( pxDevice, &xReadRegister );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, const xMX25rBusyTiming_t *pxTiming, uint32_t ulBusyPage, uint32_t ulBusyPages )
+{
+	uint8_t		   ucStatus;
+	eModuleError_t eError;
+	TickType_t	 xTypical	= MAX( 1, pdMS_TO_TICKS( pxTiming->ulTypicalMs ) );
+	TickType_t	 xPollDelay  = MAX( 1, xTypical / MX25R_POLL_DIVISOR );
+	TickType_t	 xStart		 = xTaskGetTickCount();
+	TickType_t	 xEndTime	= xStart + pdMS_TO_TICKS( pxTiming->ulMaximumMs );
+	TickType_t	 xLastResume = xStart;
+	TickType_t	 xNow, xDelay, xSuspended;
 
 	while ( true ) {
 		/* Read status register into ucStatus */
-		eError = prvMX25rGenericCommand( pxDevice, &xReadStatus );
+		eError = prvReadRegister( pxDevice, MX25R_COMMAND_READ_STATUS, &ucStatus );
 		if ( eError != ERROR_NONE ) {
 			eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s Failed to read status\r\n", pxDevice->pcName );
 			return eError;
@@ -415,27 +488,95 @@ static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, TickType_t xPo
 		/* Break if we are no longer busy */
 		if ( !( ucStatus & MX25R_STATUS_WIP ) ) {
 			eLog( LOG_FLASH_DRIVER, LOG_DEBUG, "%s WWB done\r\n", pxDevice->pcName );
-			return ERROR_NONE;
+			return prvCheckOperationResult( pxDevice );
 		}
 
 		/* Break if we have timed out */
-		if ( xTaskGetTickCount() > xEndTime ) {
+		xNow = xTaskGetTickCount();
+		if ( xNow > xEndTime ) {
 			eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s WWB timeout\r\n", pxDevice->pcName );
 			return ERROR_TIMEOUT;
 		}
 
-		/* Otherwise wait and try again */
-		else {
-			if ( ( xEndTime - xTaskGetTickCount() ) < xPollDelay ) {
-				eLog( LOG_FLASH_DRIVER, LOG_VERBOSE, "%s WWB wait small\r\n", pxDevice->pcName );
-				vTaskDelay( xEndTime - xTaskGetTickCount() );
-			}
-			else {
-				eLog( LOG_FLASH_DRIVER, LOG_VERBOSE, "%s WWB waiting %d ticks\r\n", pxDevice->pcName, xPollDelay );
-				vTaskDelay( xPollDelay );
-			}
+		/* Completion before the typical time is unlikely, so only start polling once it has passed */
+		xDelay = ( ( xNow - xStart ) < xTypical ) ? ( xTypical - ( xNow - xStart ) ) : xPollDelay;
+		xDelay = MIN( xDelay, xEndTime - xNow );
+
+		/* Operations that cannot be suspended simply wait */
+		if ( ulBusyPages == 0 ) {
+			eLog( LOG_FLASH_DRIVER, LOG_VERBOSE, "%s WWB waiting %d ticks\r\n", pxDevice->pcName, xDelay );
+			vTaskDelay( xDelay );
+			continue;
+		}
+		/* Otherwise wait for the delay or a read request, whichever comes first */
+		if ( !bFlashWaitForRead( pxDevice, ulBusyPage, ulBusyPages, xDelay ) ) {
+			continue;
+		}
+		xNow = xTaskGetTickCount();
+		if ( ( xNow - xLastResume ) < MX25R_MIN_ERASE_PROGRESS ) {
+			vTaskDelay( MX25R_MIN_ERASE_PROGRESS - ( xNow - xLastResume ) );
+			continue;
 		}
+		xSuspended = xNow;
+		eError	 = prvSuspendForReads( pxDevice, ulBusyPage, ulBusyPages );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+		/* Time spent suspended does not count towards the operation timeout */
+		xLastResume = xTaskGetTickCount();
+		xEndTime += xLastResume - xSuspended;
 	}
 }
 
 /*-----------------------------------------------------------*/
+
+static eModuleError_t prvCheckOperationResult( xFlashDevice_t *pxDevice )
+{
+	uint8_t		   ucSecurity = 0x00;
+	eModuleError_t eError;
+	/* Failure flags are updated at the end of every program or erase */
+	eError = prvReadRegister( pxDevice, MX25R_COMMAND_READ_SECURITY, &ucSecurity );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	if ( ucSecurity & ( MX25R_SECURITY_PROGRAM_FAIL | MX25R_SECURITY_ERASE_FAIL ) ) {
+		eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s operation failed 0x%02X\r\n", pxDevice->pcName, ucSecurity );
+		return ERROR_FLASH_OPERATION_FAIL;
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvSuspendForReads( xFlashDevice_t *pxDevice, uint32_t ulBusyPage, uint32_t ulBusyPages )
+{
+	uint8_t		   ucStatus   = MX25R_STATUS_WIP;
+	uint8_t		   ucSecurity = 0x00;
+	uint8_t		   ucPolls	= MX25R_SUSPEND_STATUS_POLLS;
+	eModuleError_t eError;
+
+	prvMX25rGenericCommand( pxDevice, &xCommandSuspend );
+	/* WIP clears once the operation has suspended */
+	while ( ( ucStatus & MX25R_STATUS_WIP ) && ucPolls-- ) {
+		eError = prvReadRegister( pxDevice, MX25R_COMMAND_READ_STATUS, &ucStatus );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+	}
+	if ( ucStatus & MX25R_STATUS_WIP ) {
+		eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s failed to suspend\r\n", pxDevice->pcName );
+		return ERROR_TIMEOUT;
+	}
+	/* The erase may have completed before the suspend command arrived */
+	eError = prvReadRegister( pxDevice, MX25R_COMMAND_READ_SECURITY, &ucSecurity );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	vFlashServiceReads( pxDevice, ulBusyPage, ulBusyPages );
+	if ( ucSecurity & MX25R_SECURITY_ERASE_SUSPENDED ) {
+		prvMX25rGenericCommand( pxDevice, &xCommandResume );
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
@@ -13,6 +13,7 @@
 #include "sd_ll.h"
 
 #include "board.h"
+#include "energy.h"
 #include "log.h"
 
 /* Private Defines ------------------------------------------*/
@@ -35,6 +36,8 @@ typedef enum eCommand_t {
 	SD_PARAMETERS,
 	SD_BLOCK_READ,
 	SD_BLOCK_WRITE,
+	SD_BLOCKS_READ,
+	SD_BLOCKS_WRITE,
 	SD_BLOCKS_ERASE
 } eCommand_t;
 
@@ -45,7 +48,7 @@ typedef struct xSdAction_t
 	uint32_t   ulBlockEnd;
 	uint16_t   usBlockOffset;
 	uint8_t *  pucData;
-	uint32_t   ulDataLen;
+	uint32_t   ulDataLen; /* Bytes for single block actions, blocks for multiple block actions */
 } xSdAction_t;
 
 /* Function Declarations ------------------------------------*/
@@ -62,6 +65,8 @@ static eModuleError_t prvSdQueryParameters( xSdParameters_t *pxParameters );
 static eModuleError_t prvSdReadRegister( eSdCommand_t eRegisterCommand, uint8_t *pucReg );
 static eModuleError_t prvSdBlockRead( xSdParameters_t *pxParameters, uint32_t ulBlockAddress, uint16_t usBlockOffset, uint8_t *pucBuffer, uint32_t ulBufferLen );
 static eModuleError_t prvSdBlockWrite( xSdParameters_t *pxParameters, uint32_t ulBlockAddress, uint16_t usBlockOffset, uint8_t *pucBuffer, uint32_t ulBufferLen );
+static eModuleError_t prvSdMultiBlockRead( xSdParameters_t *pxParameters, uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer );
+static eModuleError_t prvSdMultiBlockWrite( xSdParameters_t *pxParameters, uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer );
 static eModuleError_t prvSdEraseRange( xSdParameters_t *pxParameters, uint32_t ulBlockFirst, uint32_t ulBlockLast );
 
 /* Private Variables ----------------------------------------*/
@@ -132,6 +137,32 @@ eModuleError_t eSdBlockWrite( uint32_t ulBlockAddress, uint16_t usBlockOffset, u
 
 /*-----------------------------------------------------------*/
 
+eModuleError_t eSdMultiBlockRead( uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer, TickType_t xTimeout )
+{
+	xSdAction_t xAction = {
+		.eCommand  = SD_BLOCKS_READ,
+		.ulBlock   = ulBlockAddress,
+		.pucData   = pucBuffer,
+		.ulDataLen = ulNumBlocks
+	};
+	return prvExecuteAction( &xAction, xTimeout );
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eSdMultiBlockWrite( uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer, TickType_t xTimeout )
+{
+	xSdAction_t xAction = {
+		.eCommand  = SD_BLOCKS_WRITE,
+		.ulBlock   = ulBlockAddress,
+		.pucData   = pucBuffer,
+		.ulDataLen = ulNumBlocks
+	};
+	return prvExecuteAction( &xAction, xTimeout );
+}
+
+/*-----------------------------------------------------------*/
+
 eModuleError_t eSdEraseBlocks( uint32_t ulFirstBlockAddress, uint32_t ulLastBlockAddress, TickType_t xTimeout )
 {
 	xSdAction_t xAction = {
@@ -161,6 +192,7 @@ ATTR_NORETURN static void prvSdTask( void *pvParameters )
 
 		/* Validate that we found an SD card */
 		if ( xSdParams.eCardType != SDCARD_TYPE_NONE ) {
+			vEnergyActive( ENERGY_SD, true );
 			switch ( xAction.eCommand ) {
 				case SD_PARAMETERS:
 					pvMemcpy( xAction.pucData, &xSdParams, sizeof( xSdParameters_t ) );
@@ -172,6 +204,12 @@ ATTR_NORETURN static void prvSdTask( void *pvParameters )
 				case SD_BLOCK_READ:
 					eError = prvSdBlockRead( &xSdParams, xAction.ulBlock, xAction.usBlockOffset, xAction.pucData, xAction.ulDataLen );
 					break;
+				case SD_BLOCKS_READ:
+					eError = prvSdMultiBlockRead( &xSdParams, xAction.ulBlock, xAction.ulDataLen, xAction.pucData );
+					break;
+				case SD_BLOCKS_WRITE:
+					eError = prvSdMultiBlockWrite( &xSdParams, xAction.ulBlock, xAction.ulDataLen, xAction.pucData );
+					break;
 				case SD_BLOCKS_ERASE:
 					eError = prvSdEraseRange( &xSdParams, xAction.ulBlock, xAction.ulBlockEnd );
 					break;
@@ -179,6 +217,7 @@ ATTR_NORETURN static void prvSdTask( void *pvParameters )
 					configASSERT( 0 );
 					break;
 			}
+			vEnergyActive( ENERGY_SD, false );
 		}
 		else {
 			eError = ERROR_UNAVAILABLE_RESOURCE;
@@ -465,6 +504,59 @@ static eModuleError_t prvSdBlockWrite( xSdParameters_t *pxParameters, uint32_t u
 
 /*-----------------------------------------------------------*/
 
+static eModuleError_t prvSdMultiBlockRead( xSdParameters_t *pxParameters, uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer )
+{
+	eModuleError_t eError;
+	uint8_t		   ucResponse;
+
+	if ( ulNumBlocks == 1 ) {
+		return prvSdBlockRead( pxParameters, ulBlockAddress, 0, pucBuffer, SD_DEFAULT_BLOCK_SIZE );
+	}
+
+	eError = eSdCommand( SD_READ_MULTIPLE_BLOCK, ulBlockAddress, &ucResponse );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+
+	eError = eSdReadBlocks( pucBuffer, ulNumBlocks );
+
+	eLog( LOG_SD_DRIVER, LOG_INFO, "SD: Read Addr  - 0x%08X Blocks - %3d Data - % 4A...\r\n", ulBlockAddress, ulNumBlocks, pucBuffer );
+
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvSdMultiBlockWrite( xSdParameters_t *pxParameters, uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer )
+{
+	eModuleError_t eError;
+	uint8_t		   ucResponse;
+
+	if ( ulNumBlocks == 1 ) {
+		return prvSdBlockWrite( pxParameters, ulBlockAddress, 0, pucBuffer, SD_DEFAULT_BLOCK_SIZE );
+	}
+
+	/* Pre-erase hint, lets the card prepare the whole range instead of erasing as each block arrives */
+	eError = eSdCommand( SD_SET_WR_BLK_ERASE_COUNT, ulNumBlocks, &ucResponse );
+	if ( eError != ERROR_NONE ) {
+		/* The hint is optional, the write is still valid without it */
+		eLog( LOG_SD_DRIVER, LOG_INFO, "SD: Pre-erase hint not accepted\r\n" );
+	}
+
+	eError = eSdCommand( SD_WRITE_MULTIPLE_BLOCK, ulBlockAddress, &ucResponse );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+
+	eError = eSdWriteBlocks( pucBuffer, ulNumBlocks );
+
+	eLog( LOG_SD_DRIVER, LOG_INFO, "SD: Write Addr - 0x%08X Blocks - %3d Data - % 4A...\r\n", ulBlockAddress, ulNumBlocks, pucBuffer );
+
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
 static eModuleError_t prvSdEraseRange( xSdParameters_t *pxParameters, uint32_t ulBlockFirst, uint32_t ulBlockLast )
 {
 	eModuleError_t eError;
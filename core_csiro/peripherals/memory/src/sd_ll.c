@@ -79,6 +79,9 @@
 #define SD_SDHC_TIMEOUT_WRITE 250
 #define SD_SDHC_TIMEOUT_ERASE 250
 
+/* Bytes polled before yielding, 256us at 8MHz, 1/8 of a tick, shorter waits are cheaper to spin through than to sleep */
+#define SD_POLL_BYTES 256
+
 /* Type Definitions -----------------------------------------*/
 
 typedef struct xCSD_t
@@ -166,6 +169,7 @@ eModuleError_t eSdCommand( eSdCommand_t eCommand, uint32_t ulArgument, uint8_t *
 		case SD_SEND_OP_COND:
 		case SD_SEND_SCR:
 		case SD_SEND_STATUS:
+		case SD_SET_WR_BLK_ERASE_COUNT:
 			bIsAppCommand = true;
 			break;
 		default:
@@ -232,11 +236,13 @@ eModuleError_t eSdCommand( eSdCommand_t eCommand, uint32_t ulArgument, uint8_t *
 
 	/* Read any remaining bytes afer the command response */
 	const char *pcFormatStr;
+	uint32_t	ulResponseLen = 1;
 	switch ( eCommand ) {
 		case SD_SEND_IF_COND: /* R7 Response, 4 bytes remaining */
 		case SD_READ_OCR:	 /* R3 Response, 4 bytes remaining */
 			vSpiReceive( pxSpi, pucResponse + 1, 4 );
-			pcFormatStr = "SD: CMD - %d RESP - %02X %02X %02X %02X %02X\r\n";
+			ulResponseLen = 5;
+			pcFormatStr	  = "SD: CMD - %d RESP - %02X %02X %02X %02X %02X\r\n";
 			break;
 		case SD_STOP_TRANSMISSION: /* R1b Response, wait until ready */
 		case SD_ERASE:			   /* R1b Response, wait until ready */
@@ -245,13 +251,17 @@ eModuleError_t eSdCommand( eSdCommand_t eCommand, uint32_t ulArgument, uint8_t *
 			break;
 		case SD_SEND_STATUS: /* R2 Response, 1 byte remaining */
 			vSpiReceive( pxSpi, pucResponse + 1, 1 );
-			pcFormatStr = "SD: CMD - %d RESP - %02X %02X\r\n";
+			ulResponseLen = 2;
+			pcFormatStr	  = "SD: CMD - %d RESP - %02X %02X\r\n";
 			break;
 		default: /* R1 Response, no bytes remaining */
 			pcFormatStr = "SD: CMD - %d RESP - %02X\r\n";
 			break;
 	}
-	eLog( LOG_SD_DRIVER, LOG_VERBOSE, pcFormatStr, eCommand, pucResponse[0], pucResponse[1], pucResponse[2], pucResponse[3], pucResponse[4] );
+	/* Callers only provide space for the response they expect, don't read past it for logging */
+	uint8_t pucLogged[5] = { 0 };
+	pvMemcpy( pucLogged, pucResponse, ulResponseLen );
+	eLog( LOG_SD_DRIVER, LOG_VERBOSE, pcFormatStr, eCommand, pucLogged[0], pucLogged[1], pucLogged[2], pucLogged[3], pucLogged[4] );
 
 	/* For read and write commands, CS must be left low for following data */
 	switch ( eCommand ) {
@@ -428,12 +438,17 @@ void vSdPrintCID( uint8_t *pucCID )
 static eModuleError_t prvWaitReady( uint16_t usWaitMs )
 {
 	uint8_t	ucResponse;
+	uint32_t   ulPolls  = 0;
 	TickType_t xEndTime = xTaskGetTickCount() + pdMS_TO_TICKS( usWaitMs );
 	do {
 		vSpiReceive( pxSpi, &ucResponse, 1 );
 		if ( ucResponse == 0xFF ) {
 			return ERROR_NONE;
 		}
+		if ( ++ulPolls < SD_POLL_BYTES ) {
+			continue;
+		}
+		ulPolls = 0;
 		eLog( LOG_SD_DRIVER, LOG_VERBOSE, "SD: Card still busy\r\n" );
 		/* Release the SPI bus while we the SD card is busy*/
 		vSpiCsRelease( pxSpi );
@@ -450,12 +465,17 @@ static eModuleError_t prvWaitReady( uint16_t usWaitMs )
 static eModuleError_t prvWaitToken( uint8_t ucToken )
 {
 	uint8_t	ucResponse;
+	uint32_t   ulPolls  = 0;
 	TickType_t xEndTime = xTaskGetTickCount() + pdMS_TO_TICKS( SD_SDHC_TIMEOUT_READ );
 	do {
 		vSpiReceive( pxSpi, &ucResponse, 1 );
 		if ( ucResponse == ucToken ) {
 			return ERROR_NONE;
 		}
+		if ( ++ulPolls < SD_POLL_BYTES ) {
+			continue;
+		}
+		ulPolls = 0;
 		/* Release the SPI bus while we the SD card is busy*/
 		vSpiCsRelease( pxSpi );
 		vSpiBusEnd( pxSpi );
@@ -566,3 +586,71 @@ eModuleError_t eSdWriteBytes( xSdParameters_t *pxParams, uint16_t usBlockOffset,
 }
 
 /*-----------------------------------------------------------*/
+
+eModuleError_t eSdReadBlocks( uint8_t *pucBuffer, uint32_t ulNumBlocks )
+{
+	eModuleError_t eError = ERROR_NONE;
+	uint8_t		   pucCrc[SD_DEFAULT_CRC_SIZE];
+	uint8_t		   ucResponse;
+
+	for ( uint32_t i = 0; i < ulNumBlocks; i++ ) {
+		eError = prvWaitToken( SD_START_BLOCK );
+		if ( eError != ERROR_NONE ) {
+			eLog( LOG_SD_DRIVER, LOG_ERROR, "SD: Failed to receive start token for block %d\r\n", i );
+			break;
+		}
+		vSpiReceive( pxSpi, pucBuffer + ( i * SD_DEFAULT_BLOCK_SIZE ), SD_DEFAULT_BLOCK_SIZE );
+		vSpiReceive( pxSpi, pucCrc, SD_DEFAULT_CRC_SIZE );
+	}
+	vSpiCsRelease( pxSpi );
+	vSpiBusEnd( pxSpi );
+	/* The card streams blocks until told to stop, regardless of how the data phase ended */
+	if ( eSdCommand( SD_STOP_TRANSMISSION, 0x00, &ucResponse ) != ERROR_NONE ) {
+		eLog( LOG_SD_DRIVER, LOG_ERROR, "SD: Failed to stop multiple block read\r\n" );
+	}
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eSdWriteBlocks( uint8_t *pucBuffer, uint32_t ulNumBlocks )
+{
+	eModuleError_t eError		= ERROR_NONE;
+	uint8_t		   ucStartToken = SD_START_BLK_MULTI;
+	uint8_t		   ucStopToken  = SD_STOP_TRANS;
+	uint8_t		   ucResponse;
+
+	for ( uint32_t i = 0; i < ulNumBlocks; i++ ) {
+		vSpiTransmit( pxSpi, &ucStartToken, 1 );
+		vSpiTransmit( pxSpi, pucBuffer + ( i * SD_DEFAULT_BLOCK_SIZE ), SD_DEFAULT_BLOCK_SIZE );
+		vSpiTransmit( pxSpi, (uint8_t *) pucFF, SD_DEFAULT_CRC_SIZE );
+
+		/* Receive the Data Response */
+		vSpiReceive( pxSpi, &ucResponse, 1 );
+		ucResponse &= SD_DATA_RESPONSE_MASK;
+		if ( ucResponse != SD_DATA_ACCEPTED ) {
+			eLog( LOG_SD_DRIVER, LOG_ERROR, "SD: Multiple write failed on block %d with error 0x%02X\r\n", i, ucResponse );
+			eError = ERROR_FLASH_OPERATION_FAIL;
+			break;
+		}
+		/* Card is busy programming the block */
+		eError = prvWaitReady( SD_SDHC_TIMEOUT_WRITE );
+		if ( eError != ERROR_NONE ) {
+			break;
+		}
+	}
+	/* Stop token, followed by a byte before the card signals busy */
+	vSpiTransmit( pxSpi, &ucStopToken, 1 );
+	vSpiTransmit( pxSpi, (uint8_t *) pucFF, 1 );
+	/* Programming of the final blocks is only complete once the card releases busy, report the first failure */
+	if ( ( prvWaitReady( SD_SDHC_TIMEOUT_WRITE ) != ERROR_NONE ) && ( eError == ERROR_NONE ) ) {
+		eLog( LOG_SD_DRIVER, LOG_ERROR, "SD: Card still busy after multiple block write\r\n" );
+		eError = ERROR_TIMEOUT;
+	}
+
+	vSpiCsRelease( pxSpi );
+	vSpiBusEnd( pxSpi );
+	return eError;
+}
+
+/*-----------------------------------------------------------*/
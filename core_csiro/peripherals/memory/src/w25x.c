@@ -7,6 +7,7 @@
 
 #include "w25x.h"
 
+#include "csiro_math.h"
 #include "log.h"
 
 /* Private Defines ------------------------------------------*/
@@ -50,6 +51,8 @@
 #define W25X_CMD_CHIP_ERASE				0xC7	/* Mass Erase */
 #define W25X_CMD_DEEP_PWR_DOWN			0xB9	/* Power down */
 #define W25X_CMD_RELEASE_PWR_DOWN		0xAB	/* Release Power-Down */
+#define W25X_CMD_SUSPEND				0x75	/* Erase / Program Suspend (W25Q only) */
+#define W25X_CMD_RESUME					0x7A	/* Erase / Program Resume (W25Q only) */
 #define W25X_CMD_ENABLE_RESET			0x66	/* Enable Reset */
 #define W25X_CMD_RESET_DEVICE			0x99	/* Reset Device */
 
@@ -59,6 +62,16 @@
 #define W25X_MASK_STATUS1_WRITE_ENABLE_LATCH		0x02
 #define W25X_MASK_STATUS1_BUSY						0x01
 
+/* Bitmasks of status register 2 */
+#define W25X_MASK_STATUS2_SUSPENDED					0x80
+
+/* Once past the typical operation time, poll at this fraction of the typical time */
+#define W25X_POLL_DIVISOR			8
+/* Erases must run for a while between suspensions to guarantee forward progress */
+#define W25X_MIN_ERASE_PROGRESS		pdMS_TO_TICKS( 5 )
+/* tSUS is 20us, a status read takes ~5us */
+#define W25X_SUSPEND_STATUS_POLLS	10
+
 // clang-format on
 /* Type Definitions -----------------------------------------*/
 
@@ -79,6 +92,13 @@ typedef struct xW25xGenericCommand_t
 	uint8_t *   pucData;
 } xW25xGenericCommand_t;
 
+/**@brief Datasheet timing of an operation that sets BUSY */
+typedef struct xW25xBusyTiming_t
+{
+	uint32_t ulTypicalMs; /**< Typical duration, BUSY is not polled before this */
+	uint32_t ulMaximumMs; /**< Timeout for the operation, excluding time spent suspended */
+} xW25xBusyTiming_t;
+
 /* Function Declarations ------------------------------------*/
 
 eModuleError_t eW25xFlashInit( xFlashDevice_t *pxDevice );
@@ -91,7 +111,9 @@ eModuleError_t eW25xFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStartP
 eModuleError_t eW25xFlashEraseAll( xFlashDevice_t *pxDevice );
 
 static eModuleError_t prvW25xGenericCommand( xFlashDevice_t *pxDevice, const xW25xGenericCommand_t *pxCommand );
-static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, TickType_t xPollDelay, TickType_t xTimeout );
+static eModuleError_t prvReadRegister( xFlashDevice_t *pxDevice, uint8_t ucCommand, uint8_t *pucValue );
+static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, const xW25xBusyTiming_t *pxTiming, uint32_t ulBusyPage, uint32_t ulBusyPages );
+static eModuleError_t prvSuspendForReads( xFlashDevice_t *pxDevice, uint32_t ulBusyPage, uint32_t ulBusyPages );
 
 /* Private Variables ----------------------------------------*/
 
@@ -146,6 +168,34 @@ static const xW25xGenericCommand_t xCommandChipErase = {
 	.pucData		= NULL
 };
 
+static const xW25xGenericCommand_t xCommandSuspend = {
+	.eMode			= SEND_COMMAND_ONLY,
+	.ucCommand		= W25X_CMD_SUSPEND,
+	.ulPageNumber   = NO_ADDRESS,
+	.ucByteOffset   = 0,
+	.ucDummyBytes   = 0,
+	.usNumDataBytes = 0,
+	.pucData		= NULL
+};
+
+static const xW25xGenericCommand_t xCommandResume = {
+	.eMode			= SEND_COMMAND_ONLY,
+	.ucCommand		= W25X_CMD_RESUME,
+	.ulPageNumber   = NO_ADDRESS,
+	.ucByteOffset   = 0,
+	.ucDummyBytes   = 0,
+	.usNumDataBytes = 0,
+	.pucData		= NULL
+};
+
+/* Typical times from the datasheet, maximums include margin over the datasheet values */
+static const xW25xBusyTiming_t xTimingBoot		  = { .ulTypicalMs = 1, .ulMaximumMs = 2000 };
+static const xW25xBusyTiming_t xTimingPageProgram = { .ulTypicalMs = 1, .ulMaximumMs = 5 };
+static const xW25xBusyTiming_t xTimingSectorErase = { .ulTypicalMs = 45, .ulMaximumMs = 500 };
+static const xW25xBusyTiming_t xTimingBlock32k	= { .ulTypicalMs = 120, .ulMaximumMs = 2000 };
+static const xW25xBusyTiming_t xTimingBlock64k	= { .ulTypicalMs = 150, .ulMaximumMs = 2500 };
+static const xW25xBusyTiming_t xTimingChipErase   = { .ulTypicalMs = 20000, .ulMaximumMs = 200000 };
+
 /*-----------------------------------------------------------*/
 
 eModuleError_t eW25xFlashInit( xFlashDevice_t *pxDevice )
@@ -175,7 +225,7 @@ eModuleError_t eW25xFlashInit( xFlashDevice_t *pxDevice )
 	vTaskDelay( 1 );
 
 	/* Wait until chip not busy */
-	if ( prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 10 ), pdMS_TO_TICKS( 2000 ) ) != ERROR_NONE ) {
+	if ( prvWaitWhileBusy( pxDevice, &xTimingBoot, 0, 0 ) != ERROR_NONE ) {
 		eLog( LOG_FLASH_DRIVER, LOG_ERROR, "Flash: Failed to boot...\r\n" );
 		return ERROR_INITIALISATION_FAILURE;
 	}
@@ -248,8 +298,8 @@ eModuleError_t eW25xFlashWriteSubpage( xFlashDevice_t *pxDevice, uint32_t ulPage
 	};
 	prvW25xGenericCommand( pxDevice, &xCommandWriteEnable );
 	prvW25xGenericCommand( pxDevice, &xWriteCommand );
-	/* Wait for the page write to complete, checking every tick for a maximum of 5ms */
-	return prvWaitWhileBusy( pxDevice, 1, pdMS_TO_TICKS( 5 ) );
+	/* Wait for the page write to complete, programs are too short to be worth suspending */
+	return prvWaitWhileBusy( pxDevice, &xTimingPageProgram, 0, 0 );
 }
 
 /*-----------------------------------------------------------*/
@@ -313,17 +363,17 @@ eModuleError_t eW25xFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStartP
 		xErase.ulPageNumber = ulStartPage;
 		prvW25xGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvW25xGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 50 ), pdMS_TO_TICKS( 500 ) );
+		prvWaitWhileBusy( pxDevice, &xTimingSectorErase, ulStartPage, usPagesPerSector );
 		ulStartPage += usPagesPerSector;
 		ulNumPages -= usPagesPerSector;
 	}
-	/* Run 32k erases to the first 64k block */
-	while ( ( ulNumPages > 0 ) && ( ulStartPage % usPagesPer64kBlock != 0 ) ) {
+	/* Run 32k erases to the first 64k block, while a whole 32k block remains */
+	while ( ( ulNumPages >= usPagesPer32kBlock ) && ( ulStartPage % usPagesPer64kBlock != 0 ) ) {
 		xErase.ucCommand	= W25X_CMD_ERASE_32K;
 		xErase.ulPageNumber = ulStartPage;
 		prvW25xGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvW25xGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 250 ), pdMS_TO_TICKS( 2000 ) );
+		prvWaitWhileBusy( pxDevice, &xTimingBlock32k, ulStartPage, usPagesPer32kBlock );
 		ulStartPage += usPagesPer32kBlock;
 		ulNumPages -= usPagesPer32kBlock;
 	}
@@ -333,7 +383,7 @@ eModuleError_t eW25xFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStartP
 		xErase.ulPageNumber = ulStartPage;
 		prvW25xGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvW25xGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 250 ), pdMS_TO_TICKS( 2500 ) );
+		prvWaitWhileBusy( pxDevice, &xTimingBlock64k, ulStartPage, usPagesPer64kBlock );
 		ulStartPage += usPagesPer64kBlock;
 		ulNumPages -= usPagesPer64kBlock;
 	}
@@ -343,7 +393,7 @@ eModuleError_t eW25xFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStartP
 		xErase.ulPageNumber = ulStartPage;
 		prvW25xGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvW25xGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 250 ), pdMS_TO_TICKS( 2000 ) );
+		prvWaitWhileBusy( pxDevice, &xTimingBlock32k, ulStartPage, usPagesPer32kBlock );
 		ulStartPage += usPagesPer32kBlock;
 		ulNumPages -= usPagesPer32kBlock;
 	}
@@ -353,7 +403,7 @@ eModuleError_t eW25xFlashErasePages( xFlashDevice_t *pxDevice, uint32_t ulStartP
 		xErase.ulPageNumber = ulStartPage;
 		prvW25xGenericCommand( pxDevice, &xCommandWriteEnable );
 		prvW25xGenericCommand( pxDevice, &xErase );
-		prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 50 ), pdMS_TO_TICKS( 500 ) );
+		prvWaitWhileBusy( pxDevice, &xTimingSectorErase, ulStartPage, usPagesPerSector );
 		ulStartPage += usPagesPerSector;
 		ulNumPages -= usPagesPerSector;
 	}
@@ -368,8 +418,8 @@ eModuleError_t eW25xFlashEraseAll( xFlashDevice_t *pxDevice )
 	prvW25xGenericCommand( pxDevice, &xCommandWriteEnable );
 	/* Send the erase command */
 	prvW25xGenericCommand( pxDevice, &xCommandChipErase );
-	/* Wait for the erase to complete, checking once a second for a maximum of 200 seconds */
-	return prvWaitWhileBusy( pxDevice, pdMS_TO_TICKS( 1000 ), pdMS_TO_TICKS( 200000 ) );
+	/* Wait for the erase to complete, chip erases cannot be suspended */
+	return prvWaitWhileBusy( pxDevice, &xTimingChipErase, 0, 0 );
 }
 
 /*-----------------------------------------------------------*/
@@ -424,28 +474,41 @@ static eModuleError_t prvW25xGenericCommand( xFlashDevice_t *pxDevice, const xW2
 
 /*-----------------------------------------------------------*/
 
-static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, TickType_t xPollDelay, TickType_t xTimeout )
+static eModuleError_t prvReadRegister( xFlashDevice_t *pxDevice, uint8_t ucCommand, uint8_t *pucValue )
 {
-	// This will cause overflow so enter something reasonable.
-	configASSERT( xTimeout != portMAX_DELAY );
-
-	uint8_t		   ucStatus = 0xFF;
-	eModuleError_t eError;
-	TickType_t	 xEndTime = xTaskGetTickCount() + xTimeout;
-
-	xW25xGenericCommand_t xReadStatus = {
+	xW25xGenericCommand_t xReadRegister = {
 		.eMode			= READ_DATA,
-		.ucCommand		= W25X_CMD_READ_STATUS_1,
+		.ucCommand		= ucCommand,
 		.ulPageNumber   = NO_ADDRESS,
 		.ucByteOffset   = 0,
 		.ucDummyBytes   = 0,
 		.usNumDataBytes = 1,
-		.pucData		= &ucStatus
+		.pucData		= pucValue
 	};
+	return prvW25xGenericCommand( pxDevice, &xReadRegister );
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, const xW25xBusyTiming_t *pxTiming, uint32_t ulBusyPage, uint32_t ulBusyPages )
+{
+	uint8_t		   ucStatus;
+	eModuleError_t eError;
+	TickType_t	 xTypical	= MAX( 1, pdMS_TO_TICKS( pxTiming->ulTypicalMs ) );
+	TickType_t	 xPollDelay  = MAX( 1, xTypical / W25X_POLL_DIVISOR );
+	TickType_t	 xStart		 = xTaskGetTickCount();
+	TickType_t	 xEndTime	= xStart + pdMS_TO_TICKS( pxTiming->ulMaximumMs );
+	TickType_t	 xLastResume = xStart;
+	TickType_t	 xNow, xDelay, xSuspended;
+
+	/* Only the W25Q parts support suspending erases */
+	if ( pxDevice->xSettings.ulNumPages < W25X_NUM_PAGES_64Mb ) {
+		ulBusyPages = 0;
+	}
 
 	while ( true ) {
 		/* Read status register into ucStatus */
-		eError = prvW25xGenericCommand( pxDevice, &xReadStatus );
+		eError = prvReadRegister( pxDevice, W25X_CMD_READ_STATUS_1, &ucStatus );
 		if ( eError != ERROR_NONE ) {
 			eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s Failed to read status\r\n", pxDevice->pcName );
 			return eError;
@@ -458,23 +521,73 @@ static eModuleError_t prvWaitWhileBusy( xFlashDevice_t *pxDevice, TickType_t xPo
 		}
 
 		/* Break if we have timed out */
-		if ( xTaskGetTickCount() > xEndTime ) {
+		xNow = xTaskGetTickCount();
+		if ( xNow > xEndTime ) {
 			eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s WWB timeout\r\n", pxDevice->pcName );
 			return ERROR_TIMEOUT;
 		}
 
-		/* Otherwise wait and try again */
-		else {
-			if ( ( xEndTime - xTaskGetTickCount() ) < xPollDelay ) {
-				eLog( LOG_FLASH_DRIVER, LOG_VERBOSE, "%s WWB wait small\r\n", pxDevice->pcName );
-				vTaskDelay( xEndTime - xTaskGetTickCount() );
-			}
-			else {
-				eLog( LOG_FLASH_DRIVER, LOG_VERBOSE, "%s WWB waiting %d ticks\r\n", pxDevice->pcName, xPollDelay );
-				vTaskDelay( xPollDelay );
-			}
+		/* Completion before the typical time is unlikely, so only start polling once it has passed */
+		xDelay = ( ( xNow - xStart ) < xTypical ) ? ( xTypical - ( xNow - xStart ) ) : xPollDelay;
+		xDelay = MIN( xDelay, xEndTime - xNow );
+
+		/* Operations that cannot be suspended simply wait */
+		if ( ulBusyPages == 0 ) {
+			eLog( LOG_FLASH_DRIVER, LOG_VERBOSE, "%s WWB waiting %d ticks\r\n", pxDevice->pcName, xDelay );
+			vTaskDelay( xDelay );
+			continue;
+		}
+		/* Otherwise wait for the delay or a read request, whichever comes first */
+		if ( !bFlashWaitForRead( pxDevice, ulBusyPage, ulBusyPages, xDelay ) ) {
+			continue;
+		}
+		xNow = xTaskGetTickCount();
+		if ( ( xNow - xLastResume ) < W25X_MIN_ERASE_PROGRESS ) {
+			vTaskDelay( W25X_MIN_ERASE_PROGRESS - ( xNow - xLastResume ) );
+			continue;
+		}
+		xSuspended = xNow;
+		eError	 = prvSuspendForReads( pxDevice, ulBusyPage, ulBusyPages );
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+		/* Time spent suspended does not count towards the operation timeout */
+		xLastResume = xTaskGetTickCount();
+		xEndTime += xLastResume - xSuspended;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static eModuleError_t prvSuspendForReads( xFlashDevice_t *pxDevice, uint32_t ulBusyPage, uint32_t ulBusyPages )
+{
+	uint8_t		   ucStatus  = W25X_MASK_STATUS1_BUSY;
+	uint8_t		   ucStatus2 = 0x00;
+	uint8_t		   ucPolls   = W25X_SUSPEND_STATUS_POLLS;
+	eModuleError_t eError;
+
+	prvW25xGenericCommand( pxDevice, &xCommandSuspend );
+	/* BUSY clears once the operation has suspended */
+	while ( ( ucStatus & W25X_MASK_STATUS1_BUSY ) && ucPolls-- ) {
+		eError = prvReadRegister( pxDevice, W25X_CMD_READ_STATUS_1, &ucStatus );
+		if ( eError != ERROR_NONE ) {
+			return eError;
 		}
 	}
+	if ( ucStatus & W25X_MASK_STATUS1_BUSY ) {
+		eLog( LOG_FLASH_DRIVER, LOG_ERROR, "%s failed to suspend\r\n", pxDevice->pcName );
+		return ERROR_TIMEOUT;
+	}
+	/* The erase may have completed before the suspend command arrived */
+	eError = prvReadRegister( pxDevice, W25X_CMD_READ_STATUS_2, &ucStatus2 );
+	if ( eError != ERROR_NONE ) {
+		return eError;
+	}
+	vFlashServiceReads( pxDevice, ulBusyPage, ulBusyPages );
+	if ( ucStatus2 & W25X_MASK_STATUS2_SUSPENDED ) {
+		prvW25xGenericCommand( pxDevice, &xCommandResume );
+	}
+	return ERROR_NONE;
 }
 
 /*-----------------------------------------------------------*/
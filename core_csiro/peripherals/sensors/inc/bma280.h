@@ -45,6 +45,7 @@
 
 #include "accelerometer_interface.h"
 #include "bma280_device.h"
+#include "fifo_timestamp.h"
 #include "spi.h"
 #include "tdf.h"
 
@@ -112,8 +113,7 @@ eModuleError_t eBma280WaitForInterrupt( eAccelerometerInterrupt_t *peInterruptTy
 /**@brief Read accelerometer samples
  *
  * @param[out] pxData				Array of samples of length MAX(1, ucNumFIFO)
- * @param[out] pxFirstSample		Timestamp of the first sample
- * @param[out] pulGenerationTime	RTC ticks that passed between previous data interrupt and current interrupt
+ * @param[out] pxTiming			Reconstructed sample timing of the burst, see vFifoTimestampSample and eFifoTimestampLog
  * @param[in]  ucNumFIFO			Number of bytes to read from the FIFO, must equal ucFIFOLimit from the configuration struct
  * 									A value of 0 reads from the data registers instead of the FIFO
  * @param[in]  xTimeout				Wait timeout
@@ -121,7 +121,7 @@ eModuleError_t eBma280WaitForInterrupt( eAccelerometerInterrupt_t *peInterruptTy
  * @retval ::ERROR_NONE				Data retrieved
  * @retval ::ERROR_TIMEOUT			SPI Bus was busy	
  */
-eModuleError_t eBma280ReadData( xAccelerometerSample_t *pxData, xTdfTime_t *pxFirstSample, uint32_t *pulGenerationTime, uint8_t ucNumFIFO, TickType_t xTimeout );
+eModuleError_t eBma280ReadData( xAccelerometerSample_t *pxData, xFifoTimestamp_t *pxTiming, uint8_t ucNumFIFO, TickType_t xTimeout );
 
 /**@brief Query the currently active hardware interrupts
  *
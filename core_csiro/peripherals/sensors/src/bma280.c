@@ -14,6 +14,7 @@
 #include "bma280_device.h"
 
 #include "csiro_math.h"
+#include "fifo_timestamp.h"
 #include "gpio.h"
 #include "log.h"
 #include "memory_operations.h"
@@ -56,9 +57,8 @@ static xGpio_t		 xInterrupt2;
 
 static uint8_t ucCurrentRangeShift = 0;
 
-static xTdfTime_t xInterruptTime;
-static uint64_t   ullPreviousInterrupt;
-static uint32_t   ulInterruptPeriod;
+static xTdfTime_t		xInterruptTime;
+static xFifoTimestamp_t xTimestamp;
 
 /*-----------------------------------------------------------*/
 
@@ -157,7 +157,7 @@ eModuleError_t eBma280Configure( xAccelerometerConfiguration_t *pxConfig, xAccel
 
 /*-----------------------------------------------------------*/
 
-eModuleError_t eBma280ReadData( xAccelerometerSample_t *pxData, xTdfTime_t *pxFirstSample, uint32_t *pulGenerationTime, uint8_t ucNumFIFO, TickType_t xTimeout )
+eModuleError_t eBma280ReadData( xAccelerometerSample_t *pxData, xFifoTimestamp_t *pxTiming, uint8_t ucNumFIFO, TickType_t xTimeout )
 {
 	eModuleError_t eError;
 	struct xHardwareSample_t
@@ -214,16 +214,9 @@ eModuleError_t eBma280ReadData( xAccelerometerSample_t *pxData, xTdfTime_t *pxFi
 		pxOutputSample->ulMagnitude = ulMagnitude << ( 2 + ucCurrentRangeShift );
 	} while ( ucSampleIndex-- );
 
-	/* Timing information */
-	*pulGenerationTime = ulInterruptPeriod;
-	if ( ucNumFIFO > 1 ) {
-		uint32_t   ulFirstSampleTimeAgoTdfTicks = ( 2 * ulInterruptPeriod ) - ( 2 * ulInterruptPeriod / ucNumFIFO );
-		xTdfTime_t xFirstDelta					= { ulFirstSampleTimeAgoTdfTicks / UINT16_MAX, ulFirstSampleTimeAgoTdfTicks % UINT16_MAX };
-		*pxFirstSample							= xRtcTdfTimeSub( xInterruptTime, xFirstDelta );
-	}
-	else {
-		*pxFirstSample = xInterruptTime;
-	}
+	/* Timing information, the interrupt occurs when the final sample of the burst is available */
+	vFifoTimestampBurst( &xTimestamp, &xInterruptTime, ucNumFIFO, NULL, NULL );
+	*pxTiming = xTimestamp;
 
 	return eError;
 }
@@ -276,9 +269,6 @@ void prvBma280DataReadyIRQ( void )
 {
 	BaseType_t				  xHigherPriorityTaskWoken = pdFALSE;
 	eAccelerometerInterrupt_t eIntType				   = ACCELEROMETER_NEW_DATA;
-	uint64_t				  ullRtcNow				   = ullRtcTickCount();
-	ulInterruptPeriod								   = ullRtcNow - ullPreviousInterrupt;
-	ullPreviousInterrupt							   = ullRtcNow;
 	bRtcGetTdfTime( &xInterruptTime );
 	xQueueSendToBackFromISR( xInterruptQueue, &eIntType, &xHigherPriorityTaskWoken );
 	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
@@ -373,14 +363,14 @@ static eModuleError_t prvBmaConfigureData( xAccelerometerConfiguration_t *pxConf
 	/* Enable interrupt pins */
 	vGpioSetup( xInterrupt1, GPIO_INPUT, GPIO_INPUT_NOFILTER );
 	eGpioConfigureInterrupt( xInterrupt1, true, GPIO_INTERRUPT_RISING_EDGE, prvBma280DataReadyIRQ );
-	/* Set an approximate previous interrupt time */
-	ullPreviousInterrupt = ullRtcTickCount();
 	/* Store actual configuration */
 	pxState->bEnabled		  = true;
 	pxState->ucSampleGrouping = CLAMP( pxConfig->ucFIFOLimit, 32, 1 );
 	pxState->ucMaxG			  = pucRanges[ulRange];
 	pxState->ulRateMilliHz	= ulSampleRate;
 	pxState->ulPeriodUs		  = 1000000000 / pxState->ulRateMilliHz;
+	/* Sample timing restarts from the next interrupt */
+	vFifoTimestampInit( &xTimestamp, pxState->ulPeriodUs );
 	return ERROR_NONE;
 }
 
@@ -326,6 +326,7 @@ void prvBoardInterfaceInit( void )
 	eSpiInit( pxBma280Spi );
 	eSpiInit( pxFlashSpi );
 	vWatchdogInit( pxWatchdog );
+	pxAdc->xPlatform.pxTimer = NRF_TIMER2;
 	vAdcInit( pxAdc );
 	vTempInit();
 }
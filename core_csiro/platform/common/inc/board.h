@@ -29,6 +29,7 @@
 #include "serial_interface.h"
 
 #include "device_nvm.h"
+#include "energy.h"
 
 #include "board_arch.h"
 
@@ -112,6 +113,15 @@ void vApplicationWaitUntilActivated( void );
  */
 fnSerialByteHandler_t fnBoardSerialHandler( void );
 
+/**@brief Provide the current model used for energy accounting
+ *
+ *  The default model is a generic nRF52 with external SPI flash, platforms and applications
+ *  should provide measured values for their hardware and battery
+ *
+ * @retval		Board current model
+ */
+const xEnergyModel_t *pxBoardEnergyModel( void );
+
 /**
   @}
 */
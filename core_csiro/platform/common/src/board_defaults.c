@@ -23,6 +23,32 @@
 /* Function Declarations ------------------------------------*/
 
 /* Private Variables ----------------------------------------*/
+
+/* Datasheet figures for an nRF52832 running from the DC/DC converter with a MX25R flash */
+static const xEnergyModel_t xDefaultEnergyModel = {
+	.ulBaseMicroAmps	= 5,
+	.pulActiveMicroAmps = {
+		[ENERGY_CPU]			 = 3700,
+		[ENERGY_RADIO_SCAN]		 = 5400,
+		[ENERGY_RADIO_CONNECTED] = 50,
+		[ENERGY_FLASH]			 = 4000,
+		[ENERGY_SD]				 = 30000,
+		[ENERGY_ADC]			 = 1200,
+	},
+	.pulEventNanoCoulombs = {
+		/* Three channel legacy advertising event at 0 dBm */
+		[ENERGY_RADIO_ADVERTISE] = 15000,
+	},
+	.ulBatteryMilliAmpHours = 0
+};
+
+/*-----------------------------------------------------------*/
+
+ATTR_WEAK const xEnergyModel_t *pxBoardEnergyModel( void )
+{
+	return &xDefaultEnergyModel;
+}
+
 /*-----------------------------------------------------------*/
 
 ATTR_WEAK fnSerialByteHandler_t fnBoardSerialHandler( void )
@@ -104,6 +104,7 @@ ATTR_NORETURN static void prvHeartbeatTask( void *pvParameters )
 	for ( ;; ) {
 		vRtcHeartbeatWait();
 		vBoardWatchdogPeriodic();
+		vStackMonitorSample();
 		vApplicationTickCallback( ++ulUptime );
 	}
 }
@@ -275,6 +275,7 @@ void prvBoardInterfaceInit( void )
 	eSpiInit( pxSpi );
 	eI2CInit( pxI2C );
 	vWatchdogInit( pxWatchdog );
+	pxAdc->xPlatform.pxTimer = NRF_TIMER2;
 	vAdcInit( pxAdc );
 	vTempInit();
 }
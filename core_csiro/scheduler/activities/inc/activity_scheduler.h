@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Filename: activity_scheduler.h
+ * Creation_Date: 18/10/2026
+ * Author: CSIRO Data61
+ *
+ * Cooperative scheduler for periodic and event triggered activities
+ *
+ * Activities are short run-to-completion functions, such as sampling a sensor, that all execute
+ * from a single worker task instead of each owning a task and stack.
+ *
+ * Periodic activities run at multiples of xPeriod offset by xPhase, counted from kernel tick 0.
+ * Activities with related periods and equal phases therefore fall due on the same ticks.
+ * A periodic run may be delayed by up to xSlack ticks. The worker sleeps until the earliest
+ * deadline (due tick plus slack) of any activity, then runs every activity that has fallen due.
+ * Larger slack values let more activities share each wakeup and lengthen tickless idle periods.
+ * Lateness is bounded by xSlack and never accumulates, as the next due tick is always
+ * derived from the phase.
+ *
+ * Event triggered activities run on the next worker wakeup after one of their event bits is
+ * signalled. An activity can be both periodic and event triggered.
+ *
+ * Example:
+ *      static xActivity_t xTemperature = {
+ *          .pcName  = "Temp",
+ *          .fnRun   = prvSampleTemperature,
+ *          .xPeriod = pdMS_TO_TICKS( 60000 ),
+ *          .xSlack  = pdMS_TO_TICKS( 5000 ),
+ *      };
+ *      eActivityRegister( &xTemperature );
+ *      eActivitySchedulerStart();
+ *
+ */
+#ifndef __CSIRO_CORE_ACTIVITY_SCHEDULER
+#define __CSIRO_CORE_ACTIVITY_SCHEDULER
+/* Includes -------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#include "core_types.h"
+
+/* Module Defines -------------------------------------------*/
+// clang-format off
+
+#ifndef ACTIVITY_SCHEDULER_STACK_SIZE
+#define ACTIVITY_SCHEDULER_STACK_SIZE   ( 2 * configMINIMAL_STACK_SIZE )
+#endif
+
+#ifndef ACTIVITY_SCHEDULER_PRIORITY
+#define ACTIVITY_SCHEDULER_PRIORITY     ( tskIDLE_PRIORITY + 1 )
+#endif
+
+/* Event bits available to applications, the remaining bit is used internally */
+#define ACTIVITY_EVENTS_ALL             0x7FFFFFFFUL
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+/**@brief Activity function
+ *
+ * @param[in] pvContext				Context of the activity
+ * @param[in] ulEvents				Signalled events that triggered the run, 0 for a periodic run
+ */
+typedef void ( *fnActivity_t )( void *pvContext, uint32_t ulEvents );
+
+typedef struct xActivity_t
+{
+	/* Configuration, set before registering */
+	const char * pcName;	/**< Activity name */
+	fnActivity_t fnRun;		/**< Activity function */
+	void *		 pvContext; /**< Passed to fnRun */
+	TickType_t   xPeriod;   /**< Ticks between periodic runs, 0 for event triggered only */
+	TickType_t   xPhase;	/**< Periodic runs are due at multiples of xPeriod plus xPhase */
+	TickType_t   xSlack;	/**< Ticks a periodic run may be delayed to share a wakeup, less than xPeriod */
+	uint32_t	 ulEvents;  /**< Event bits that trigger a run, 0 for periodic only */
+	/* State, managed by the scheduler */
+	struct xActivity_t *pxNext;
+	TickType_t			xNextRun;	 /**< Next due tick of a periodic activity */
+	bool				bEnabled;	 /**< Activity is run */
+	bool				bRealign;	 /**< xNextRun must be recomputed from the phase */
+	uint32_t			ulRuns;		 /**< Number of runs */
+	uint32_t			ulMissed;	 /**< Periodic runs skipped because the worker was late */
+	TickType_t			xMaxLateness; /**< Largest delay of a periodic run past its due tick */
+} xActivity_t;
+
+typedef struct xActivitySchedulerStats_t
+{
+	uint32_t ulWakeups; /**< Scheduling passes of the worker */
+	uint32_t ulRuns;	/**< Activity runs, across all activities */
+} xActivitySchedulerStats_t;
+
+/* Function Declarations ------------------------------------*/
+
+/**@brief Add an activity to the scheduler
+ *
+ * The activity is enabled and first runs on the next due tick at or after registration.
+ * Activities can be registered before or after the worker is started, and cannot be removed.
+ *
+ * @param[in] pxActivity			Activity, must remain valid forever
+ *
+ * @retval ::ERROR_NONE 			Activity registered
+ * @retval ::ERROR_INVALID_DATA 	Activity has no function, no trigger, or slack not less than its period
+ */
+eModuleError_t eActivityRegister( xActivity_t *pxActivity );
+
+/**@brief Enable or disable an activity
+ *
+ * A re-enabled periodic activity resumes from its next due tick, missed runs are not made up.
+ *
+ * @param[in] pxActivity			Registered activity
+ * @param[in] bEnable				Enable the activity
+ */
+void vActivityEnable( xActivity_t *pxActivity, bool bEnable );
+
+/**@brief Signal events to the scheduler
+ *
+ * Events signalled before the worker is started are discarded
+ *
+ * @param[in] ulEvents				Event bits, within ACTIVITY_EVENTS_ALL
+ */
+void vActivitySignal( uint32_t ulEvents );
+
+/**@brief Signal events to the scheduler from an interrupt
+ *
+ * @param[in] ulEvents				Event bits, within ACTIVITY_EVENTS_ALL
+ * @param[out] pxHigherPriorityTaskWoken	Set to pdTRUE if a context switch should be requested
+ */
+void vActivitySignalFromISR( uint32_t ulEvents, BaseType_t *pxHigherPriorityTaskWoken );
+
+/**@brief Create the worker task that runs all registered activities
+ *
+ * @retval ::ERROR_NONE 			Worker started
+ * @retval ::ERROR_INVALID_STATE 	Worker already started
+ */
+eModuleError_t eActivitySchedulerStart( void );
+
+/**@brief Run a single scheduling pass
+ *
+ * Runs every enabled activity triggered by ulEvents or due at xNow. Called by the worker task
+ * each time it wakes, exposed for applications that drive the scheduler from an existing task.
+ *
+ * @param[in] xNow					Current kernel tick count
+ * @param[in] ulEvents				Events signalled since the previous pass
+ *
+ * @retval 							Ticks until the next pass is required, portMAX_DELAY if none
+ */
+TickType_t xActivitySchedulerRun( TickType_t xNow, uint32_t ulEvents );
+
+/**@brief Scheduler counters since boot
+ *
+ * @param[out] pxStats				Scheduler counters
+ */
+void vActivitySchedulerStats( xActivitySchedulerStats_t *pxStats );
+
+#endif /* __CSIRO_CORE_ACTIVITY_SCHEDULER */
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO)
+ * All rights reserved.
+ */
+
+/* Includes -------------------------------------------------*/
+
+#include "activity_scheduler.h"
+
+#include "task.h"
+
+#include "compiler_intrinsics.h"
+#include "csiro_math.h"
+#include "freertos_helpers.h"
+
+/* Private Defines ------------------------------------------*/
+// clang-format off
+
+/* Internal event requesting the worker to recompute its wakeup time */
+#define ACTIVITY_EVENT_RESCHEDULE       0x80000000UL
+
+/* Signed comparison of tick counts, valid across tick count overflow */
+#define TICK_REACHED( xNow, xTick )     ( (int32_t) ( ( xNow ) - ( xTick ) ) >= 0 )
+
+// clang-format on
+/* Type Definitions -----------------------------------------*/
+
+/* Function Declarations ------------------------------------*/
+
+static void prvActivityWorker( void *pvParameters );
+static void prvAlign( xActivity_t *pxActivity, TickType_t xNow );
+
+/* Private Variables ----------------------------------------*/
+
+STATIC_TASK_STRUCTURES( pxWorker, ACTIVITY_SCHEDULER_STACK_SIZE, ACTIVITY_SCHEDULER_PRIORITY );
+
+/* Singly linked, new activities are pushed onto the head while the worker may be traversing */
+static xActivity_t *volatile pxActivities = NULL;
+
+static xActivitySchedulerStats_t xStats;
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eActivityRegister( xActivity_t *pxActivity )
+{
+	if ( pxActivity->fnRun == NULL ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( ( pxActivity->xPeriod == 0 ) && ( pxActivity->ulEvents == 0 ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( ( pxActivity->xPeriod != 0 ) && ( pxActivity->xSlack >= pxActivity->xPeriod ) ) {
+		return ERROR_INVALID_DATA;
+	}
+	if ( pxActivity->ulEvents & ~ACTIVITY_EVENTS_ALL ) {
+		return ERROR_INVALID_DATA;
+	}
+	pxActivity->ulRuns		 = 0;
+	pxActivity->ulMissed	 = 0;
+	pxActivity->xMaxLateness = 0;
+	pxActivity->bRealign	 = true;
+	pxActivity->bEnabled	 = true;
+
+	taskENTER_CRITICAL();
+	pxActivity->pxNext = pxActivities;
+	pxActivities	   = pxActivity;
+	taskEXIT_CRITICAL();
+
+	vActivitySignal( ACTIVITY_EVENT_RESCHEDULE );
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+void vActivityEnable( xActivity_t *pxActivity, bool bEnable )
+{
+	/* The worker reads both flags together, see xActivitySchedulerRun */
+	taskENTER_CRITICAL();
+	if ( bEnable && !pxActivity->bEnabled ) {
+		pxActivity->bRealign = true;
+	}
+	pxActivity->bEnabled = bEnable;
+	taskEXIT_CRITICAL();
+	vActivitySignal( ACTIVITY_EVENT_RESCHEDULE );
+}
+
+/*-----------------------------------------------------------*/
+
+void vActivitySignal( uint32_t ulEvents )
+{
+	if ( pxWorker != NULL ) {
+		xTaskNotify( pxWorker, ulEvents, eSetBits );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+void vActivitySignalFromISR( uint32_t ulEvents, BaseType_t *pxHigherPriorityTaskWoken )
+{
+	if ( pxWorker != NULL ) {
+		xTaskNotifyFromISR( pxWorker, ulEvents, eSetBits, pxHigherPriorityTaskWoken );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+eModuleError_t eActivitySchedulerStart( void )
+{
+	if ( pxWorker != NULL ) {
+		return ERROR_INVALID_STATE;
+	}
+	STATIC_TASK_CREATE( pxWorker, prvActivityWorker, "Activity", NULL );
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAlign( xActivity_t *pxActivity, TickType_t xNow )
+{
+	TickType_t xPeriod = pxActivity->xPeriod;
+	TickType_t xPhase  = pxActivity->xPhase % xPeriod;
+	TickType_t xElapsed;
+
+	/* First tick at or after xNow that is congruent to the phase, measured from the phase so no sum can overflow */
+	if ( xNow < xPhase ) {
+		pxActivity->xNextRun = xPhase;
+	}
+	else {
+		xElapsed			 = ( xNow - xPhase ) % xPeriod;
+		pxActivity->xNextRun = xNow + ( ( xElapsed == 0 ) ? 0 : xPeriod - xElapsed );
+	}
+	pxActivity->bRealign = false;
+}
+
+/*-----------------------------------------------------------*/
+
+TickType_t xActivitySchedulerRun( TickType_t xNow, uint32_t ulEvents )
+{
+	xActivity_t *pxActivity;
+	TickType_t   xLateness, xUntilDeadline;
+	TickType_t   xSleep = portMAX_DELAY;
+	uint32_t	 ulTriggered, ulPeriods;
+	bool		 bEnabled, bRun;
+
+	xStats.ulWakeups++;
+	ulEvents &= ACTIVITY_EVENTS_ALL;
+
+	for ( pxActivity = pxActivities; pxActivity != NULL; pxActivity = pxActivity->pxNext ) {
+		taskENTER_CRITICAL();
+		bEnabled = pxActivity->bEnabled;
+		if ( bEnabled && ( pxActivity->xPeriod != 0 ) && pxActivity->bRealign ) {
+			prvAlign( pxActivity, xNow );
+		}
+		taskEXIT_CRITICAL();
+		if ( !bEnabled ) {
+			continue;
+		}
+		/* Signalled events and a due periodic run are served by a single call */
+		ulTriggered = ulEvents & pxActivity->ulEvents;
+		bRun		= ( ulTriggered != 0 );
+		if ( ( pxActivity->xPeriod != 0 ) && TICK_REACHED( xNow, pxActivity->xNextRun ) ) {
+			xLateness = xNow - pxActivity->xNextRun;
+			ulPeriods = xLateness / pxActivity->xPeriod;
+			/* Due ticks that passed entirely are skipped, the schedule stays locked to the phase */
+			pxActivity->ulMissed += ulPeriods;
+			pxActivity->xMaxLateness = MAX( pxActivity->xMaxLateness, xLateness % pxActivity->xPeriod );
+			pxActivity->xNextRun += ( ulPeriods + 1 ) * pxActivity->xPeriod;
+			bRun = true;
+		}
+		if ( bRun ) {
+			pxActivity->fnRun( pxActivity->pvContext, ulTriggered );
+			pxActivity->ulRuns++;
+			xStats.ulRuns++;
+		}
+		if ( pxActivity->xPeriod != 0 ) {
+			/* Deadline of the next run, xNextRun is always in the future here */
+			xUntilDeadline = pxActivity->xNextRun + pxActivity->xSlack - xNow;
+			xSleep		   = MIN( xSleep, xUntilDeadline );
+		}
+	}
+	return xSleep;
+}
+
+/*-----------------------------------------------------------*/
+
+void vActivitySchedulerStats( xActivitySchedulerStats_t *pxStats )
+{
+	taskENTER_CRITICAL();
+	*pxStats = xStats;
+	taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvActivityWorker( void *pvParameters )
+{
+	TickType_t xSleep;
+	uint32_t   ulEvents = 0;
+	UNUSED( pvParameters );
+
+	for ( ;; ) {
+		xSleep	 = xActivitySchedulerRun( xTaskGetTickCount(), ulEvents );
+		ulEvents = 0;
+		xTaskNotifyWait( 0, UINT32_MAX, &ulEvents, xSleep );
+	}
+}
+
+/*-----------------------------------------------------------*/
@@ -3,7 +3,9 @@
 import re
 import pprint
 import os
+import sys
 import argparse
+import fnmatch
 from subprocess import check_output
 
 # Constants
@@ -12,6 +14,7 @@ rtl_ext = None # e.g. '.c.270r.dfinish'. The number '270' will change with gcc v
                # function find_rtl_ext
 su_ext = '.su'
 obj_ext = '.o'
+pre_ext = '.i'
 manual_ext = '.msu'
 stdout_encoding = "utf-8"  # System dependant
 
@@ -33,7 +36,8 @@ def read_symbols(readelf_path, file):
 
         s2 = Symbol()
         s2.value = int(v[1], 16)
-        s2.size = int(v[2])
+        # Large sizes are printed in hex
+        s2.size = int(v[2], 16) if v[2].startswith('0x') else int(v[2])
         s2.type = v[3]
         s2.binding = v[4]
         if len(v) >= 8:
@@ -56,10 +60,14 @@ def read_obj(readelf_path, tu, call_graph):
     """
     filename = tu[0:tu.rindex(".")] + obj_ext
     symbols = read_symbols(readelf_path, filename)
+    call_graph['objects'][tu] = {}
 
     for s in symbols:
 
-        if s.type == 'FUNC':
+        if s.type == 'OBJECT':
+            # Object sizes are used to find declared task stack sizes
+            call_graph['objects'][tu][s.name] = s.size
+        elif s.type == 'FUNC':
             if s.binding == 'GLOBAL':
                 # Check for multiple declarations
                 if s.name in call_graph['globals'] or s.name in call_graph['locals']:
@@ -185,11 +193,21 @@ def read_su(tu, call_graph):
 def read_manual(file, call_graph):
     """
     reads the manual stack useage files.
+    Lines are either 'function stack_size', or 'function -> target [target ...]' to list the functions that calls
+    via function pointer in 'function' can reach. Targets can contain shell style wildcards. Lines starting
+    with '#' are comments.
     :param file: the file name
     :param call_graph: a object used to store information about each function, results go here
     """
 
     for line in open(file).readlines():
+        line = line.strip()
+        if not line or line.startswith('#'):
+            continue
+        if '->' in line:
+            fxn, targets = line.split('->', 1)
+            call_graph['ptr_targets'].setdefault(fxn.strip(), []).extend(targets.split())
+            continue
         fxn, stack_sz = line.split()
         if fxn in call_graph:
             raise Exception("Redeclared Function {}".format(fxn))
@@ -246,6 +264,33 @@ def resolve_all_calls(call_graph):
             resolve_calls(fxn_dict)
 
 
+def all_fxns(call_graph):
+    """
+    :return: a list of every global and local function dictionary
+    """
+    fxns = list(call_graph['globals'].values())
+    for l_dict in call_graph['locals'].values():
+        fxns.extend(l_dict.values())
+    return fxns
+
+
+def resolve_ptr_calls(call_graph):
+    """
+    Replaces calls via function pointer with calls to every function listed for the caller in the manual files.
+    A function pointer call without a matching annotation remains unbounded.
+    """
+    fxns = all_fxns(call_graph)
+    for fxn_dict in fxns:
+        if not fxn_dict['has_ptr_call'] or fxn_dict['name'] not in call_graph['ptr_targets']:
+            continue
+        for pattern in call_graph['ptr_targets'][fxn_dict['name']]:
+            targets = [f for f in fxns if fnmatch.fnmatchcase(f['name'], pattern)]
+            if not targets:
+                fxn_dict['unresolved_calls'].add(pattern)
+            fxn_dict['r_calls'].extend(targets)
+        fxn_dict['has_ptr_call'] = False
+
+
 def calc_all_wcs(call_graph):
     def calc_wcs(fxn_dict2, call_graph1, parents):
         """
@@ -263,11 +308,13 @@ def calc_all_wcs(call_graph):
         # Check for pointer calls
         if fxn_dict2['has_ptr_call']:
             fxn_dict2['wcs'] = 'unbounded'
+            fxn_dict2['unbounded_by'] = {fxn_dict2['name'] + ' (pointer call)'}
             return
 
         # Check for recursion
         if fxn_dict2 in parents:
             fxn_dict2['wcs'] = 'unbounded'
+            fxn_dict2['unbounded_by'] = {fxn_dict2['name'] + ' (recursion)'}
             return
 
         # Calculate WCS
@@ -282,6 +329,7 @@ def calc_all_wcs(call_graph):
             # If the called function is unbounded, so is this function
             if call_dict['wcs'] == 'unbounded':
                 fxn_dict2['wcs'] = 'unbounded'
+                fxn_dict2['unbounded_by'] = call_dict.get('unbounded_by', set())
                 return
 
             # Keep track of the call with the largest stack use
@@ -347,6 +395,141 @@ def print_all_fxns(call_graph):
         print_fxn(row_format, d)
 
 
+def split_args(text, start):
+    """
+    Splits the arguments of the call whose opening bracket is at text[start]
+    :return: list of argument strings, or None if the brackets are unbalanced
+    """
+    depth = 0
+    args = []
+    arg_start = start + 1
+    for i in range(start, len(text)):
+        c = text[i]
+        if c in '([{':
+            depth += 1
+        elif c in ')]}':
+            depth -= 1
+            if depth == 0:
+                args.append(text[arg_start:i].strip())
+                return args
+        elif c == ',' and depth == 1:
+            args.append(text[arg_start:i].strip())
+            arg_start = i + 1
+    return None
+
+
+def strip_casts(expr):
+    """
+    Removes type casts, redundant brackets and integer suffixes from a preprocessed C expression
+    """
+    expr = re.sub(r'\(\s*(const\s+)?[A-Za-z_]\w*(\s+[A-Za-z_]\w*)*\s*\*?\s*\)\s*(?=[\w(&])', '', expr)
+    expr = re.sub(r'\b(0x[0-9a-fA-F]+|\d+)[uUlL]+\b', r'\1', expr)
+    return expr.strip()
+
+
+def eval_depth(expr):
+    """
+    Evaluates a constant stack depth expression
+    :return: the depth, or None if the expression is not a constant
+    """
+    expr = strip_casts(expr)
+    if not re.match(r'^[\s\dxXa-fA-F()+\-*/<>]*$', expr):
+        return None
+    try:
+        return int(eval(expr.replace('/', '//'), {'__builtins__': {}}))
+    except (SyntaxError, NameError, ZeroDivisionError, TypeError):
+        return None
+
+
+def read_tasks(tu, call_graph, stack_word):
+    """
+    Finds the tasks created in a translation unit from its preprocessed source, and the declared stack size of each.
+    Stack sizes are the size of the stack buffer for xTaskCreateStatic (and STATIC_TASK_CREATE), or the constant
+    stack depth for xTaskCreate.
+    :param tu: the translation unit
+    :param call_graph: a object used to store information about each function, results go here
+    :param stack_word: size of StackType_t in bytes
+    """
+    filename = tu[0:tu.rindex(".")] + pre_ext
+    if not os.path.isfile(filename):
+        return
+    text = open(filename).read()
+    identifier = re.compile(r'^(\([^()]*\)\s*)?&?\s*([A-Za-z_]\w*)$')
+
+    for m in re.finditer(r'\b(xTaskCreateStatic|xTaskCreate)\s*\(', text):
+        args = split_args(text, m.end() - 1)
+        if args is None or len(args) < 6:
+            continue
+        # Prototypes and definitions have typed parameters, calls have a bare function name
+        entry = identifier.match(strip_casts(args[0]))
+        if not entry:
+            continue
+        fxn_dict = find_fxn(tu, entry.group(2), call_graph)
+        if not fxn_dict:
+            continue
+
+        declared = None
+        if m.group(1) == 'xTaskCreateStatic':
+            stack = identifier.match(strip_casts(args[5]))
+            if stack and stack.group(2) in call_graph['objects'][tu]:
+                declared = call_graph['objects'][tu][stack.group(2)]
+        else:
+            depth = eval_depth(args[2])
+            if depth is not None:
+                declared = depth * stack_word
+
+        name = args[1].strip('"') if args[1].startswith('"') else args[1]
+        call_graph['tasks'].append({'name': name, 'entry': fxn_dict, 'declared': declared})
+
+
+def check_tasks(call_graph, overhead):
+    """
+    Compares the declared stack of each task against the worst case stack of its entry function plus the context
+    switch overhead, and prints a table of the results.
+    :return: (number of tasks with too small a stack, number of tasks that could not be checked)
+    """
+    tasks = sorted(call_graph['tasks'], key=lambda t: t['name'])
+    if not tasks:
+        print("No tasks found, stack analysis requires the -save-temps=obj preprocessor output")
+        return 0, 0
+
+    too_small = 0
+    unknown = 0
+    name_width = max(max([len(t['name']) for t in tasks]), 4)
+    entry_width = max(max([len(t['entry']['name']) for t in tasks]), 5)
+    row_format = "{:<" + str(name_width + 2) + "}  {:<" + str(entry_width + 2) + "}  {:>8}  {:>10}  {:>8}  {}"
+
+    print("")
+    print(row_format.format('Task', 'Entry', 'Declared', 'Worst Case', 'Margin', 'Status'))
+    for task in tasks:
+        fxn_dict = task['entry']
+        declared = task['declared']
+        wcs = fxn_dict['wcs']
+        if wcs == 'unbounded' or fxn_dict['unresolved_calls']:
+            unknown += 1
+            causes = sorted(fxn_dict.get('unbounded_by', set()) | fxn_dict['unresolved_calls'])
+            status = 'UNBOUNDED: {}'.format(', '.join(causes))
+            required = '?'
+            margin = '?'
+        elif declared is None:
+            unknown += 1
+            required = wcs + overhead
+            status = 'UNKNOWN: declared stack size is not a constant'
+            margin = '?'
+        else:
+            required = wcs + overhead
+            margin = declared - required
+            if margin < 0:
+                too_small += 1
+                status = 'TOO SMALL'
+            else:
+                status = 'OK'
+        print(row_format.format(task['name'], fxn_dict['name'], '?' if declared is None else declared, required, margin,
+                                status))
+    print("Worst case includes {} bytes of context switch overhead".format(overhead))
+    return too_small, unknown
+
+
 def find_rtl_ext(obj_dirs):
     # Find the rtl_extension
     global rtl_ext
@@ -395,14 +578,15 @@ def find_files(obj_dirs):
     return tu, manual
 
 
-def main(obj_dirs, readelf_executable):
+def main(obj_dirs, readelf_executable, manual_files=(), tasks=None, overhead=0, stack_word=4):
 
     # Find the appropriate RTL extension
     find_rtl_ext(obj_dirs)
 
     # Find all input files
-    call_graph = {'locals': {}, 'globals': {}, 'weak': {}}
+    call_graph = {'locals': {}, 'globals': {}, 'weak': {}, 'objects': {}, 'ptr_targets': {}, 'tasks': []}
     tu_list, manual_list = find_files(obj_dirs)
+    manual_list += [m for m in manual_files if m not in manual_list]
 
     # Read the input files
     for tu in tu_list:
@@ -426,18 +610,37 @@ def main(obj_dirs, readelf_executable):
 
     # Resolve All Function Calls
     resolve_all_calls(call_graph)
+    resolve_ptr_calls(call_graph)
 
     # Calculate Worst Case Stack For Each Function
     calc_all_wcs(call_graph)
 
-    # Print A Nice Message With Each Function and the WCS
-    print_all_fxns(call_graph)
+    if tasks is None:
+        # Print A Nice Message With Each Function and the WCS
+        print_all_fxns(call_graph)
+        return 0
+
+    # Check the declared stack of each task
+    for tu in tu_list:
+        read_tasks(tu, call_graph, stack_word)
+    too_small, unknown = check_tasks(call_graph, overhead)
+    if too_small:
+        print("{}: {} task stacks are smaller than their worst case".format(tasks, too_small))
+        if tasks == 'error':
+            return 1
+    if unknown:
+        print("warning: {} task stacks could not be checked, add .msu annotations for their pointer calls".format(unknown))
+    return 0
 
 if __name__ == '__main__':
 
     parser = argparse.ArgumentParser(description='Print Stack Usage for given executable')
     parser.add_argument('--objs', dest='obj_dirs', type=str, default='.', help='Comma seperated directories containing object files')
     parser.add_argument('--readelf', dest='readelf', type=str, default='arm-none-eabi-readelf.exe', help='readelf executable')
+    parser.add_argument('--msu', dest='msu', type=str, nargs='*', default=[], help='Additional manual stack usage files')
+    parser.add_argument('--tasks', dest='tasks', choices=['warn', 'error'], help='Check task stacks instead of listing every function, failing on too small stacks with error')
+    parser.add_argument('--task-overhead', dest='overhead', type=int, default=0, help='Bytes of context switch and exception frame overhead on each task stack')
+    parser.add_argument('--stack-word', dest='stack_word', type=int, default=4, help='Size of StackType_t in bytes')
     args = parser.parse_args()
 
-    main(args.obj_dirs, args.readelf)
\ No newline at end of file
+    sys.exit(main(args.obj_dirs, args.readelf, args.msu, args.tasks, args.overhead, args.stack_word))
\ No newline at end of file
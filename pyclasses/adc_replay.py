@@ -0,0 +1,130 @@
+#!/usr/bin/env python
+''' Host stand-in for eAdcContinuousStart, replaying recorded sample files
+
+Delivers recorded scans in the same blocks as the continuous ADC, with the same decimation
+as usAdcDecimate, so downstream processing can be developed and benchmarked on the host.
+Sample files are either
+    CSV     one scan per row, one column per input, an optional header row
+    binary  signed 16 bit little endian samples interleaved by scan, as in the DMA buffers
+A processing function is called with each block as a list of scans, each a list of samples,
+and the time it takes is compared against the time the ADC takes to fill a block.
+As on the device, a partial block at the end of the recording is not delivered.
+'''
+__author__ = 'CSIRO Data61'
+
+import csv
+import struct
+import time
+
+SAMPLE = struct.Struct('<h')
+
+
+def load_csv(path):
+    ''' Scans of a CSV sample file '''
+    scans = []
+    with open(path, 'r') as f:
+        for row in csv.reader(f):
+            if not row:
+                continue
+            try:
+                scans.append([int(value) for value in row])
+            except ValueError:
+                if scans:
+                    raise
+                # Header row
+    return scans
+
+
+def load_binary(data, channels):
+    ''' Scans of interleaved signed 16 bit little endian samples '''
+    if channels <= 0:
+        raise ValueError('Number of channels must be positive')
+    samples = [s[0] for s in SAMPLE.iter_unpack(data[:len(data) - len(data) % SAMPLE.size])]
+    whole = len(samples) - len(samples) % channels
+    return [samples[i:i + channels] for i in range(0, whole, channels)]
+
+
+def decimate(scans, factor):
+    ''' Average each group of factor scans, truncating toward zero like usAdcDecimate '''
+    if factor <= 1:
+        return [list(scan) for scan in scans]
+    if len(scans) % factor:
+        raise ValueError('{} scans is not a multiple of the decimation {}'.format(len(scans), factor))
+    output = []
+    for start in range(0, len(scans), factor):
+        group = scans[start:start + factor]
+        sums = [sum(column) for column in zip(*group)]
+        output.append([int(total / factor) if total >= 0 else -int(-total / factor) for total in sums])
+    return output
+
+
+def blocks(scans, block_scans, decimation=1):
+    ''' Blocks of scans as passed to the fnAdcBlockCallback_t of the continuous ADC '''
+    if block_scans <= 0:
+        raise ValueError('Block size must be positive')
+    if decimation > 1 and block_scans % decimation:
+        raise ValueError('Decimation must divide the block size')
+    for start in range(0, len(scans) - block_scans + 1, block_scans):
+        yield decimate(scans[start:start + block_scans], decimation)
+
+
+def replay(scans, block_scans, decimation, process, sample_period_us):
+    ''' Run process on each block, returning the timing of the processing
+
+    The budget is the time the ADC takes to fill the next block, processing that takes
+    longer than this on the device would stall the sampling.
+    '''
+    budget = block_scans * sample_period_us / 1e6
+    times = []
+    for block in blocks(scans, block_scans, decimation):
+        start = time.perf_counter()
+        process(block)
+        times.append(time.perf_counter() - start)
+    return {
+        'blocks': len(times),
+        'scans': len(times) * block_scans,
+        'budget_s': budget,
+        'total_s': sum(times),
+        'mean_s': sum(times) / len(times) if times else 0,
+        'max_s': max(times) if times else 0,
+        'load': (max(times) / budget) if times and budget else 0,
+    }
+
+
+def channel_means(block):
+    ''' Default processing, the mean of each input over a block '''
+    return [sum(column) / len(block) for column in zip(*block)]
+
+
+if __name__ == '__main__':
+    import argparse
+    import importlib
+    parser = argparse.ArgumentParser(description='Replay ADC sample files in continuous sampling blocks')
+    parser.add_argument('samples', help='CSV or binary sample file')
+    parser.add_argument('--channels', type=int, help='Inputs per scan of a binary file')
+    parser.add_argument('--block', type=int, default=64, help='Scans per DMA buffer')
+    parser.add_argument('--decimate', type=int, default=1, help='Scans averaged per delivered scan')
+    parser.add_argument('--period', type=float, default=1000, help='Sample period in microseconds')
+    parser.add_argument('--process', help='Processing function as module:function, default channel means')
+    parser.add_argument('--output', help='Write the delivered scans to this CSV file')
+    args = parser.parse_args()
+
+    if args.channels:
+        with open(args.samples, 'rb') as f:
+            recorded = load_binary(f.read(), args.channels)
+    else:
+        recorded = load_csv(args.samples)
+    function = channel_means
+    if args.process:
+        module, name = args.process.split(':')
+        function = getattr(importlib.import_module(module), name)
+
+    if args.output:
+        with open(args.output, 'w', newline='') as f:
+            writer = csv.writer(f)
+            for block in blocks(recorded, args.block, args.decimate):
+                writer.writerows(block)
+    stats = replay(recorded, args.block, args.decimate, function, args.period)
+    print('{} blocks of {} scans, {:.3f} ms budget per block'.format(stats['blocks'], args.block, 1000 * stats['budget_s']))
+    print('processing mean {:.3f} ms, max {:.3f} ms, {:.1f}% of budget on this host'.format(
+        1000 * stats['mean_s'], 1000 * stats['max_s'], 100 * stats['load']))
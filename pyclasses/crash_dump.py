@@ -0,0 +1,308 @@
+#!/usr/bin/env python
+''' Decoding and symbolisation of post-mortem records from core_csiro crash_dump.c
+
+The record is xCrashDump_t, all fields little endian. It is reported after reboot as a
+TDF_CRASH_DUMP summary followed by TDF_CRASH_DUMP_DATA chunks of [offset (2), data (24)].
+The record can be given as a binary file, or as a text file of chunks, one per line:
+    <offset> <hex data>
+
+Addresses are resolved against the symbol table of the application ELF, and log events
+against the strings in its sections. Line numbers are added when an addr2line for the
+target is available, e.g. --addr2line arm-none-eabi-addr2line
+'''
+__author__ = 'CSIRO Data61'
+
+import struct
+import subprocess
+import zlib
+
+import rtos_trace
+
+KEY = 0x48535243
+VERSION = 1
+
+NAME_LEN = 12
+FILE_LEN = 24
+REGISTERS = 17
+STACK_WORDS = 64
+LOG_EVENTS = 8
+TRACE_EVENTS = 16
+CHUNK = 24
+
+HEADER = struct.Struct('<IHHI')
+BODY = struct.Struct('<BBBBB3x{}sI{}IIIII{}sI{}I'.format(NAME_LEN, REGISTERS, FILE_LEN, STACK_WORDS))
+LOG_EVENT = struct.Struct('<II')
+RECORD_SIZE = HEADER.size + BODY.size + LOG_EVENTS * LOG_EVENT.size + TRACE_EVENTS * rtos_trace.RECORD.size
+
+# ucFlags
+CALLEE_SAVED = 0x01
+CALLER_SAVED = 0x02
+HANDLER_MODE = 0x04
+FPU_FRAME = 0x08
+
+TYPES = {
+    2: 'NMI',
+    3: 'HardFault',
+    4: 'MemManage',
+    5: 'BusFault',
+    6: 'UsageFault',
+    0x80: 'Watchdog',
+    0x81: 'Assertion',
+    0x82: 'Stack overflow',
+}
+
+REGISTER_NAMES = ['r{}'.format(i) for i in range(13)] + ['sp', 'lr', 'pc', 'xpsr']
+
+CFSR_BITS = {
+    0: 'IACCVIOL', 1: 'DACCVIOL', 3: 'MUNSTKERR', 4: 'MSTKERR', 5: 'MLSPERR', 7: 'MMARVALID',
+    8: 'IBUSERR', 9: 'PRECISERR', 10: 'IMPRECISERR', 11: 'UNSTKERR', 12: 'STKERR', 13: 'LSPERR', 15: 'BFARVALID',
+    16: 'UNDEFINSTR', 17: 'INVSTATE', 18: 'INVPC', 19: 'NOCP', 24: 'UNALIGNED', 25: 'DIVBYZERO',
+}
+HFSR_BITS = {1: 'VECTTBL', 30: 'FORCED', 31: 'DEBUGEVT'}
+
+TRACE_EVENT_NAMES = {
+    rtos_trace.TASK_SWITCH: 'task switch', rtos_trace.TASK_CREATE: 'task create',
+    rtos_trace.ISR_ENTER: 'isr enter', rtos_trace.ISR_EXIT: 'isr exit',
+    rtos_trace.QUEUE_CREATE: 'queue create', rtos_trace.QUEUE_SEND: 'queue send',
+    rtos_trace.QUEUE_RECEIVE: 'queue receive', rtos_trace.QUEUE_BLOCK_SEND: 'queue block send',
+    rtos_trace.QUEUE_BLOCK_RECEIVE: 'queue block receive', rtos_trace.SLEEP: 'sleep',
+    rtos_trace.WAKE: 'wake', rtos_trace.USER: 'user',
+}
+
+
+def _cstring(raw):
+    return raw.split(b'\x00')[0].decode('ascii', 'replace')
+
+
+def reassemble(chunks):
+    ''' Rebuild a record from (offset, data) TDF_CRASH_DUMP_DATA chunks, in any order '''
+    record = bytearray(RECORD_SIZE)
+    covered = set()
+    for offset, data in chunks:
+        data = data[:max(0, RECORD_SIZE - offset)]
+        record[offset:offset + len(data)] = data
+        covered.update(range(offset, offset + len(data)))
+    if len(covered) != RECORD_SIZE:
+        raise ValueError('Missing {} bytes of the record'.format(RECORD_SIZE - len(covered)))
+    return bytes(record)
+
+
+def parse_chunks(text):
+    ''' Chunks from lines of "<offset> <hex data>" '''
+    chunks = []
+    for line in text.splitlines():
+        line = line.strip()
+        if not line or line.startswith('#'):
+            continue
+        offset, data = line.split(None, 1)
+        chunks.append((int(offset, 0), bytes.fromhex(data.replace(' ', ''))))
+    return chunks
+
+
+def parse(data):
+    ''' Decode a record into a dictionary, raises ValueError if it is not a valid record '''
+    if len(data) < RECORD_SIZE:
+        raise ValueError('Record too short')
+    _, version, length, crc = HEADER.unpack_from(data)
+    # The key is cleared on the device once the record has been read
+    if version != VERSION or length != RECORD_SIZE:
+        raise ValueError('Not a version {} crash record'.format(VERSION))
+    if zlib.crc32(data[HEADER.size:RECORD_SIZE]) & 0xFFFFFFFF != crc:
+        raise ValueError('Record CRC mismatch')
+    fields = BODY.unpack_from(data, HEADER.size)
+    crash_type, flags, stack_words, log_events, trace_events, task, tick = fields[:7]
+    registers = list(fields[7:7 + REGISTERS])
+    exc_return, cfsr, hfsr, fault_address, filename, line = fields[7 + REGISTERS:13 + REGISTERS]
+    stack = list(fields[13 + REGISTERS:])
+    offset = HEADER.size + BODY.size
+    log = [LOG_EVENT.unpack_from(data, offset + i * LOG_EVENT.size) for i in range(min(log_events, LOG_EVENTS))]
+    offset += LOG_EVENTS * LOG_EVENT.size
+    trace = [rtos_trace.RECORD.unpack_from(data, offset + i * rtos_trace.RECORD.size)
+             for i in range(min(trace_events, TRACE_EVENTS))]
+    return {
+        'type': crash_type,
+        'flags': flags,
+        'task': _cstring(task),
+        'tick': tick,
+        'registers': dict(zip(REGISTER_NAMES, registers)),
+        'exc_return': exc_return,
+        'cfsr': cfsr,
+        'hfsr': hfsr,
+        'fault_address': fault_address,
+        'file': _cstring(filename),
+        'line': line,
+        'stack': stack[:min(stack_words, STACK_WORDS)],
+        'log': log,
+        'trace': trace,
+    }
+
+
+def valid_registers(record):
+    ''' Names of the registers captured for the record type '''
+    names = ['sp', 'lr', 'pc']
+    if record['flags'] & CALLER_SAVED:
+        names += ['r0', 'r1', 'r2', 'r3', 'r12', 'xpsr']
+    if record['flags'] & CALLEE_SAVED:
+        names += ['r{}'.format(i) for i in range(4, 12)]
+    return [n for n in REGISTER_NAMES if n in names]
+
+
+def bit_names(value, names):
+    return [name for bit, name in sorted(names.items()) if value & (1 << bit)]
+
+
+class Elf:
+    ''' Symbol table and section contents of an ELF file '''
+
+    def __init__(self, data):
+        if data[:4] != b'\x7fELF' or data[5] != 1:
+            raise ValueError('Not a little endian ELF file')
+        is64 = data[4] == 2
+        if is64:
+            shoff, = struct.unpack_from('<Q', data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x3A)
+            section = struct.Struct('<IIQQQQIIQQ')
+            symbol = struct.Struct('<IBBHQQ')
+        else:
+            shoff, = struct.unpack_from('<I', data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x2E)
+            section = struct.Struct('<IIIIIIIIII')
+            symbol = struct.Struct('<IIIBBH')
+        headers = [section.unpack_from(data, shoff + i * shentsize) for i in range(shnum)]
+        names = headers[shstrndx]
+        self.data = data
+        self.sections = []
+        for name, sh_type, flags, addr, offset, size, link, _, _, entsize in headers:
+            name = _cstring(data[names[4] + name:])
+            self.sections.append({'name': name, 'type': sh_type, 'flags': flags, 'addr': addr,
+                                  'offset': offset, 'size': size, 'link': link, 'entsize': entsize})
+        self.symbols = []
+        for sec in self.sections:
+            # SHT_SYMTAB
+            if sec['type'] != 2:
+                continue
+            strtab = self.sections[sec['link']]
+            for i in range(sec['size'] // sec['entsize']):
+                fields = symbol.unpack_from(data, sec['offset'] + i * sec['entsize'])
+                if is64:
+                    name, info, _, shndx, value, size = fields
+                else:
+                    name, value, size, info, _, shndx = fields
+                # Functions and objects only
+                if (info & 0xF) not in (1, 2) or shndx == 0:
+                    continue
+                # Clear the thumb bit of function addresses
+                if (info & 0xF) == 2:
+                    value &= ~1
+                self.symbols.append((value, size, _cstring(data[strtab['offset'] + name:])))
+        self.symbols.sort()
+
+    @classmethod
+    def load(cls, path):
+        with open(path, 'rb') as f:
+            return cls(f.read())
+
+    def symbol(self, address):
+        ''' "name+offset" of the symbol containing address, None if there is none '''
+        for value, size, name in self.symbols:
+            if value <= address < value + max(size, 1):
+                offset = address - value
+                return '{}+0x{:x}'.format(name, offset) if offset else name
+        return None
+
+    def is_code(self, address):
+        ''' Address is in an executable section, used to pick return addresses from the stack '''
+        # SHF_ALLOC | SHF_EXECINSTR
+        return any(sec['flags'] & 0x6 == 0x6 and sec['addr'] <= (address & ~1) < sec['addr'] + sec['size']
+                   for sec in self.sections)
+
+    def string(self, address):
+        ''' NUL terminated string at address, None if the address is not in a loaded section '''
+        for sec in self.sections:
+            # SHT_NOBITS has no content in the file
+            if sec['addr'] and sec['type'] != 8 and sec['addr'] <= address < sec['addr'] + sec['size']:
+                start = sec['offset'] + address - sec['addr']
+                return _cstring(self.data[start:sec['offset'] + sec['size']])
+        return None
+
+
+def source_lines(addr2line, elf_path, addresses):
+    ''' {address: "file:line"} from an addr2line for the target, empty if it cannot be run '''
+    addresses = sorted(set(a & ~1 for a in addresses))
+    if not addr2line or not addresses:
+        return {}
+    try:
+        output = subprocess.check_output([addr2line, '-e', elf_path] + ['0x{:x}'.format(a) for a in addresses])
+    except (OSError, subprocess.CalledProcessError):
+        return {}
+    lines = output.decode('ascii', 'replace').splitlines()
+    return {a: l for a, l in zip(addresses, lines) if not l.startswith('??')}
+
+
+def report(record, elf=None, lines={}):
+    ''' Human readable report of a parsed record '''
+
+    def where(address):
+        text = '0x{:08x}'.format(address)
+        name = elf.symbol(address & ~1) if elf else None
+        if name:
+            text += ' {}'.format(name)
+        if (address & ~1) in lines:
+            text += ' ({})'.format(lines[address & ~1])
+        return text
+
+    out = []
+    out.append('{} in {}'.format(TYPES.get(record['type'], 'Unknown ({})'.format(record['type'])),
+                                 record['task'] or 'no task'))
+    if record['flags'] & HANDLER_MODE:
+        out.append('Failed in handler mode, exception {}'.format(record['registers']['xpsr'] & 0x1FF))
+    out.append('Tick {}'.format(record['tick']))
+    if record['file']:
+        out.append('Assertion at {}:{}'.format(record['file'], record['line']))
+    if record['type'] < 0x80:
+        out.append(' '.join(['CFSR 0x{:08x}'.format(record['cfsr'])] + bit_names(record['cfsr'], CFSR_BITS)))
+        out.append(' '.join(['HFSR 0x{:08x}'.format(record['hfsr'])] + bit_names(record['hfsr'], HFSR_BITS)))
+        if record['cfsr'] & ((1 << 7) | (1 << 15)):
+            out.append('Fault address 0x{:08x}'.format(record['fault_address']))
+        out.append('EXC_RETURN 0x{:08x}'.format(record['exc_return']))
+    out.append('Registers')
+    for name in valid_registers(record):
+        value = record['registers'][name]
+        out.append('  {:<5}{}'.format(name, where(value) if name in ('pc', 'lr') else '0x{:08x}'.format(value)))
+    if record['stack']:
+        out.append('Stack from 0x{:08x}'.format(record['registers']['sp']))
+        for index, value in enumerate(record['stack']):
+            # Values pointing into code are likely return addresses
+            if elf and elf.is_code(value):
+                out.append('  sp+0x{:03x}  {}'.format(index * 4, where(value)))
+    if record['log']:
+        out.append('Recent log messages')
+        for address, tick in record['log']:
+            text = elf.string(address) if elf else None
+            out.append('  {:>10}  {}'.format(tick, repr(text.strip()) if text is not None else '0x{:08x}'.format(address)))
+    if record['trace']:
+        out.append('Recent trace events')
+        for timestamp, event, obj, param in record['trace']:
+            name = TRACE_EVENT_NAMES.get(event, 'event {}'.format(event))
+            out.append('  {:>10}  {} object {} param 0x{:04x}'.format(timestamp, name, obj, param))
+    return '\n'.join(out)
+
+
+if __name__ == '__main__':
+    import argparse
+    parser = argparse.ArgumentParser(description='Decode a crash record and symbolise it against the ELF')
+    parser.add_argument('elf', help='Application ELF the device was running')
+    parser.add_argument('record', help='Binary record, or chunks with --chunks')
+    parser.add_argument('--chunks', action='store_true', help='Record is a text file of TDF_CRASH_DUMP_DATA chunks')
+    parser.add_argument('--addr2line', help='addr2line for the target, to add source lines')
+    args = parser.parse_args()
+    if args.chunks:
+        with open(args.record, 'r') as f:
+            data = reassemble(parse_chunks(f.read()))
+    else:
+        with open(args.record, 'rb') as f:
+            data = f.read()
+    record = parse(data)
+    elf = Elf.load(args.elf)
+    addresses = [record['registers']['pc'], record['registers']['lr']] + [v for v in record['stack'] if elf.is_code(v)]
+    print(report(record, elf, source_lines(args.addr2line, args.elf, addresses)))
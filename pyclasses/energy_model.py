@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+''' Host projection of average current and battery life for an application configuration
+
+Applies the same current model as core_csiro/libraries/src/energy.c, so that deployment
+settings can be compared before flashing a device. The configuration is JSON:
+    {
+        "model": {
+            "base_uA": 5,
+            "active_uA": {"cpu": 3700, "radio_scan": 5400, ...},
+            "event_nC": {"radio_advertise": 15000},
+            "battery_mAh": 2600
+        },
+        "activities": [
+            {"name": "advertise", "subsystem": "radio_advertise", "period_s": 1, "events": 1},
+            {"name": "scan", "subsystem": "radio_scan", "period_s": 60, "duration_s": 5, "duty": 100},
+            {"name": "sample", "subsystem": "cpu", "period_s": 10, "duration_s": 0.002}
+        ]
+    }
+Each activity is active for duration_s and counts events every period_s. duty is the fraction
+of the active time the subsystem draws its active current, in permille (default 1000).
+The model section mirrors xEnergyModel_t, missing entries are 0.
+'''
+__author__ = 'CSIRO Data61'
+
+import json
+
+# Order of eEnergySubsystem_t, also the subsystem field of TDF_ENERGY_SUBSYSTEM
+SUBSYSTEMS = ['cpu', 'radio_scan', 'radio_advertise', 'radio_connected', 'flash', 'sd', 'adc', 'sensors']
+
+DUTY_FULL = 1000
+
+# Default board model of pxBoardEnergyModel
+DEFAULT_MODEL = {
+    'base_uA': 5,
+    'active_uA': {'cpu': 3700, 'radio_scan': 5400, 'radio_connected': 50, 'flash': 4000, 'sd': 30000, 'adc': 1200},
+    'event_nC': {'radio_advertise': 15000},
+    'battery_mAh': 0,
+}
+
+
+def subsystem_currents(model, activities):
+    ''' Average current of each subsystem in uA, keyed by subsystem name '''
+    active_ua = model.get('active_uA', {})
+    event_nc = model.get('event_nC', {})
+    currents = {}
+    for activity in activities:
+        subsystem = activity['subsystem']
+        if subsystem not in SUBSYSTEMS:
+            raise ValueError('Unknown subsystem {}'.format(subsystem))
+        period = float(activity['period_s'])
+        if period <= 0:
+            raise ValueError('{} period must be positive'.format(activity.get('name', subsystem)))
+        duration = float(activity.get('duration_s', 0))
+        if duration > period:
+            raise ValueError('{} is active longer than its period'.format(activity.get('name', subsystem)))
+        duty = min(activity.get('duty', DUTY_FULL), DUTY_FULL) / DUTY_FULL
+        # nC per second is nA
+        current = (duration / period) * duty * active_ua.get(subsystem, 0)
+        current += activity.get('events', 0) * event_nc.get(subsystem, 0) / 1000 / period
+        currents[subsystem] = currents.get(subsystem, 0) + current
+    return currents
+
+
+def project(config):
+    ''' Projected (average current uA, {subsystem: uA}, battery life hours or None) '''
+    model = config.get('model', DEFAULT_MODEL)
+    currents = subsystem_currents(model, config.get('activities', []))
+    average = model.get('base_uA', 0) + sum(currents.values())
+    capacity = model.get('battery_mAh', 0)
+    lifetime = (capacity * 1000 / average) if (capacity and average) else None
+    return average, currents, lifetime
+
+
+if __name__ == '__main__':
+    import argparse
+    parser = argparse.ArgumentParser(description='Project battery life of an application configuration')
+    parser.add_argument('config', help='Application configuration JSON')
+    parser.add_argument('--battery', type=float, help='Override the battery capacity in mAh')
+    args = parser.parse_args()
+    with open(args.config, 'r') as f:
+        config = json.load(f)
+    if args.battery is not None:
+        config.setdefault('model', dict(DEFAULT_MODEL))['battery_mAh'] = args.battery
+    average, currents, lifetime = project(config)
+    base = config.get('model', DEFAULT_MODEL).get('base_uA', 0)
+    print('{:<16}{:>10.1f} uA'.format('base', base))
+    for subsystem in SUBSYSTEMS:
+        if subsystem in currents:
+            print('{:<16}{:>10.1f} uA'.format(subsystem, currents[subsystem]))
+    print('{:<16}{:>10.1f} uA'.format('average', average))
+    if lifetime is None:
+        print('Battery capacity unknown')
+    else:
+        print('Battery life {:.0f} hours ({:.1f} days)'.format(lifetime, lifetime / 24))
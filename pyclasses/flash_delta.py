@@ -0,0 +1,200 @@
+#!/usr/bin/env python
+''' Block level delta encoding of firmware images for eFlashRomDeltaApply
+
+The stream is a sequence of records, all fields little endian
+    COPY    [0x01, blocks, 0 (2), source offset (4)]            whole blocks of the current image
+    LITERAL [0x02, 0, length (2)] + data                        new data of at most one block
+    PATCH   [0x03, edits, 0 (2), source offset (4)] + edits     one block of the current image, with
+                                                                edits of [keep, replace] + replace bytes
+    END     [0x04, 0, image CRC (2), image length (4)]          CRC16_CCITT of the new image
+
+Source offsets are byte offsets into the current image, so code that moves by an
+arbitrary amount is still copied rather than resent.
+'''
+__author__ = 'CSIRO Data61'
+
+import struct
+
+BLOCK_SIZE = 256
+
+DELTA_COPY = 0x01
+DELTA_LITERAL = 0x02
+DELTA_PATCH = 0x03
+DELTA_END = 0x04
+
+# Source candidates are found through the first bytes of every offset of the current image
+_INDEX_KEY = 16
+_INDEX_CANDIDATES = 4
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    ''' CRC16_CCITT as calculated by eFlashCrc '''
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def _patch_edits(source, target):
+    ''' Edits that turn source into target, merging differences separated by short runs '''
+    edits = []
+    position = 0
+    index = 0
+    while index < len(target):
+        if source[index] == target[index]:
+            index += 1
+            continue
+        end = index + 1
+        # Re-using a short run of matching bytes is cheaper than a new edit header
+        while end < len(target):
+            if source[end] != target[end]:
+                end += 1
+            elif end + 2 < len(target) and source[end:end + 2] != target[end:end + 2]:
+                end += 1
+            else:
+                break
+        # Edit fields are a single byte each
+        while index - position > 255:
+            edits.append((255, 0, b''))
+            position += 255
+        while end - index > 255:
+            edits.append((index - position, 255, target[index:index + 255]))
+            index += 255
+            position = index
+        edits.append((index - position, end - index, target[index:end]))
+        position = end
+        index = end
+    return edits
+
+
+def _patch_size(edits):
+    return 8 + sum(2 + len(data) for _, _, data in edits)
+
+
+def encode(old, new):
+    ''' Encode new as a delta stream against the current image old '''
+    old = bytes(old)
+    new = bytes(new)
+    # Candidate sources for every byte offset, keyed on a short prefix
+    old_index = {}
+    for offset in range(len(old) - BLOCK_SIZE + 1):
+        candidates = old_index.setdefault(old[offset:offset + _INDEX_KEY], [])
+        if len(candidates) < _INDEX_CANDIDATES:
+            candidates.append(offset)
+
+    stream = bytearray()
+    copy_start = None
+    copy_count = 0
+    shift = 0
+
+    def flush_copy():
+        nonlocal copy_start, copy_count
+        if copy_count:
+            stream.extend(struct.pack('<BBxxI', DELTA_COPY, copy_count, copy_start))
+        copy_start = None
+        copy_count = 0
+
+    for offset in range(0, len(new), BLOCK_SIZE):
+        block = new[offset:offset + BLOCK_SIZE]
+        if len(block) == BLOCK_SIZE:
+            # Prefer continuing the current run of copies
+            candidates = old_index.get(block[:_INDEX_KEY], [])
+            if copy_count and copy_count < 255:
+                candidates = [copy_start + copy_count * BLOCK_SIZE] + candidates
+            source = next((c for c in candidates if old[c:c + BLOCK_SIZE] == block), None)
+            if source is not None:
+                if copy_count and copy_count < 255 and source == copy_start + copy_count * BLOCK_SIZE:
+                    copy_count += 1
+                else:
+                    flush_copy()
+                    copy_start = source
+                    copy_count = 1
+                shift = source - offset
+                continue
+        flush_copy()
+        literal = struct.pack('<BBH', DELTA_LITERAL, 0, len(block)) + block
+        best = None
+        if len(block) == BLOCK_SIZE:
+            # Code that moved keeps the shift of the most recent copy
+            for source in {offset, offset + shift}:
+                if 0 <= source and source + BLOCK_SIZE <= len(old):
+                    edits = _patch_edits(old[source:source + BLOCK_SIZE], block)
+                    if len(edits) <= 255 and (best is None or _patch_size(edits) < _patch_size(best[1])):
+                        best = (source, edits)
+        if best is not None and _patch_size(best[1]) < len(literal):
+            source, edits = best
+            stream.extend(struct.pack('<BBxxI', DELTA_PATCH, len(edits), source))
+            for keep, replace, data in edits:
+                stream.extend(struct.pack('<BB', keep, replace) + data)
+        else:
+            stream.extend(literal)
+    flush_copy()
+    stream.extend(struct.pack('<BBHI', DELTA_END, 0, crc16_ccitt(new), len(new)))
+    return bytes(stream)
+
+
+def apply(old, stream):
+    ''' Reference decoder, returns the new image '''
+    old = bytes(old)
+    new = bytearray()
+    offset = 0
+    while offset < len(stream):
+        record, arg, value = struct.unpack_from('<BBH', stream, offset)
+        start = offset
+        offset += 4
+        if record in (DELTA_COPY, DELTA_PATCH):
+            source, = struct.unpack_from('<I', stream, offset)
+            offset += 4
+        if record == DELTA_COPY:
+            if arg == 0 or source + arg * BLOCK_SIZE > len(old):
+                raise ValueError('Invalid COPY at {}'.format(start))
+            new.extend(old[source:source + arg * BLOCK_SIZE])
+        elif record == DELTA_LITERAL:
+            if value == 0 or value > BLOCK_SIZE or offset + value > len(stream):
+                raise ValueError('Invalid LITERAL at {}'.format(start))
+            new.extend(stream[offset:offset + value])
+            offset += value
+        elif record == DELTA_PATCH:
+            if source + BLOCK_SIZE > len(old):
+                raise ValueError('Invalid PATCH at {}'.format(start))
+            block = bytearray(old[source:source + BLOCK_SIZE])
+            position = 0
+            for _ in range(arg):
+                keep, replace = struct.unpack_from('<BB', stream, offset)
+                offset += 2
+                position += keep
+                if position + replace > BLOCK_SIZE:
+                    raise ValueError('Invalid PATCH edit at {}'.format(offset - 2))
+                block[position:position + replace] = stream[offset:offset + replace]
+                offset += replace
+                position += replace
+            new.extend(block)
+        elif record == DELTA_END:
+            crc, length = struct.unpack_from('<HI', stream, offset - 2)
+            offset += 4
+            if length != len(new) or crc != crc16_ccitt(new):
+                raise ValueError('Image does not match END record')
+            return bytes(new)
+        else:
+            raise ValueError('Unknown record {} at {}'.format(record, start))
+    raise ValueError('Stream has no END record')
+
+
+if __name__ == '__main__':
+    import argparse
+    parser = argparse.ArgumentParser(description='Encode a firmware update for eFlashRomDeltaApply')
+    parser.add_argument('old', help='Image currently running on the device')
+    parser.add_argument('new', help='Image to update to')
+    parser.add_argument('output', help='Delta stream output file')
+    args = parser.parse_args()
+    with open(args.old, 'rb') as f:
+        old_image = f.read()
+    with open(args.new, 'rb') as f:
+        new_image = f.read()
+    delta = encode(old_image, new_image)
+    assert apply(old_image, delta) == new_image
+    with open(args.output, 'wb') as f:
+        f.write(delta)
+    print('{} byte image encoded in {} bytes'.format(len(new_image), len(delta)))
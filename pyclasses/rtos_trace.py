@@ -0,0 +1,202 @@
+#!/usr/bin/env python
+''' Conversion of eRtosTraceDump output to Chrome trace format JSON
+
+The dump is a header, a task table and the trace records, all fields little endian
+    HEADER  ['RTRC', version, tasks, name length, flags, timestamp Hz (4), events (4),
+             overwritten (4), overhead cycles (2), 0 (2)]
+    TASK    [task number, name (name length)]
+    RECORD  [timestamp (4), event, object, parameter (2)]
+
+Load the output in chrome://tracing or https://ui.perfetto.dev
+'''
+__author__ = 'CSIRO Data61'
+
+import json
+import struct
+
+MAGIC = b'RTRC'
+VERSION = 1
+
+HEADER = struct.Struct('<4sBBBBIIIHxx')
+
+# Header flags
+FLAG_TASKS_TRUNCATED = 0x01
+RECORD = struct.Struct('<IBBH')
+
+TASK_SWITCH = 1
+TASK_CREATE = 2
+ISR_ENTER = 3
+ISR_EXIT = 4
+QUEUE_CREATE = 5
+QUEUE_SEND = 6
+QUEUE_RECEIVE = 7
+QUEUE_BLOCK_SEND = 8
+QUEUE_BLOCK_RECEIVE = 9
+SLEEP = 10
+WAKE = 11
+USER = 12
+
+FROM_ISR = 0x8000
+
+QUEUE_TYPES = {0: 'queue', 1: 'mutex', 2: 'semaphore', 3: 'semaphore', 4: 'mutex'}
+QUEUE_ACTIONS = {
+    QUEUE_SEND: ('send', 'give'),
+    QUEUE_RECEIVE: ('receive', 'take'),
+    QUEUE_BLOCK_SEND: ('block on send', 'block on give'),
+    QUEUE_BLOCK_RECEIVE: ('block on receive', 'block on take'),
+}
+
+# Chrome trace thread ids of the non-task rows
+ISR_TID_BASE = 1000
+SLEEP_TID = 2000
+
+
+def parse(data):
+    ''' Decode a dump into (header dict, {task number: name}, [(timestamp, event, object, param)]) '''
+    if len(data) < HEADER.size:
+        raise ValueError('Dump too short')
+    magic, version, num_tasks, name_len, flags, hz, num_events, overwritten, overhead = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError('Not a version {} trace dump'.format(VERSION))
+    header = {'timestamp_hz': hz, 'events': num_events, 'overwritten': overwritten, 'overhead_cycles': overhead,
+              'tasks_truncated': bool(flags & FLAG_TASKS_TRUNCATED)}
+    offset = HEADER.size
+    tasks = {}
+    for _ in range(num_tasks):
+        number = data[offset]
+        tasks[number] = data[offset + 1:offset + 1 + name_len].split(b'\x00')[0].decode('ascii', 'replace')
+        offset += 1 + name_len
+    if len(data) < offset + num_events * RECORD.size:
+        raise ValueError('Dump truncated')
+    records = []
+    # Timestamps are 32 bit, unwrap them into a continuous timeline
+    previous = None
+    extension = 0
+    for index in range(num_events):
+        timestamp, event, obj, param = RECORD.unpack_from(data, offset + index * RECORD.size)
+        if previous is not None and timestamp < previous:
+            extension += 1 << 32
+        previous = timestamp
+        records.append((timestamp + extension, event, obj, param))
+    return header, tasks, records
+
+
+def _queue_name(obj, param):
+    return '{} {}'.format(QUEUE_TYPES.get(param & 0xFF, 'queue'), obj)
+
+
+def to_chrome(header, tasks, records):
+    ''' Convert parsed records into a Chrome trace format dictionary '''
+    scale = 1e6 / header['timestamp_hz']
+    events = []
+    task_names = dict(tasks)
+
+    def task_name(number):
+        return task_names.get(number, 'task {}'.format(number))
+
+    def us(timestamp):
+        return (timestamp - records[0][0]) * scale
+
+    current = None
+    switched_in = None
+    isr_open = {}
+    sleep_start = None
+    for timestamp, event, obj, param in records:
+        if event == TASK_SWITCH:
+            if current is not None:
+                events.append({'name': task_name(current), 'ph': 'X', 'pid': 1, 'tid': current,
+                               'ts': us(switched_in), 'dur': us(timestamp) - us(switched_in)})
+            current = obj
+            switched_in = timestamp
+        elif event == TASK_CREATE:
+            events.append({'name': 'create {}'.format(task_name(obj)), 'ph': 'i', 's': 'g', 'pid': 1,
+                           'tid': obj, 'ts': us(timestamp), 'args': {'priority': param}})
+        elif event == ISR_ENTER:
+            isr_open[obj] = timestamp
+        elif event == ISR_EXIT:
+            start = isr_open.pop(obj, None)
+            if start is not None:
+                events.append({'name': 'IRQ {}'.format(obj), 'ph': 'X', 'pid': 1, 'tid': ISR_TID_BASE + obj,
+                               'ts': us(start), 'dur': us(timestamp) - us(start)})
+        elif event == QUEUE_CREATE:
+            events.append({'name': 'create {}'.format(_queue_name(obj, param)), 'ph': 'i', 's': 'g', 'pid': 1,
+                           'tid': current if current is not None else 0, 'ts': us(timestamp)})
+        elif event in QUEUE_ACTIONS:
+            queue_type = param & 0xFF
+            action = QUEUE_ACTIONS[event][0 if QUEUE_TYPES.get(queue_type, 'queue') == 'queue' else 1]
+            events.append({'name': '{} {}'.format(action, _queue_name(obj, param)), 'ph': 'i', 's': 't', 'pid': 1,
+                           'tid': current if current is not None else 0, 'ts': us(timestamp),
+                           'args': {'from_isr': bool(param & FROM_ISR)}})
+        elif event == SLEEP:
+            sleep_start = timestamp
+        elif event == WAKE:
+            if sleep_start is not None:
+                events.append({'name': 'sleep', 'ph': 'X', 'pid': 1, 'tid': SLEEP_TID,
+                               'ts': us(sleep_start), 'dur': us(timestamp) - us(sleep_start)})
+            sleep_start = None
+        elif event == USER:
+            events.append({'name': 'marker {}'.format(obj), 'ph': 'i', 's': 'g', 'pid': 1,
+                           'tid': current if current is not None else 0, 'ts': us(timestamp), 'args': {'value': param}})
+    # The running task's slice ends at the final record
+    if current is not None and records:
+        events.append({'name': task_name(current), 'ph': 'X', 'pid': 1, 'tid': current,
+                       'ts': us(switched_in), 'dur': us(records[-1][0]) - us(switched_in)})
+
+    # Row names
+    tids = {e['tid'] for e in events}
+    for tid in sorted(tids):
+        if tid >= SLEEP_TID:
+            name = 'Sleep'
+        elif tid >= ISR_TID_BASE:
+            name = 'IRQ {}'.format(tid - ISR_TID_BASE)
+        else:
+            name = task_name(tid)
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': tid, 'args': {'name': name}})
+    events.append({'name': 'process_name', 'ph': 'M', 'pid': 1, 'args': {'name': 'FreeRTOS'}})
+    return {
+        'traceEvents': events,
+        'displayTimeUnit': 'ns',
+        'otherData': {
+            'timestamp_hz': header['timestamp_hz'],
+            'overwritten': header['overwritten'],
+            'overhead_cycles': header['overhead_cycles'],
+            'tasks_truncated': header['tasks_truncated'],
+        },
+    }
+
+
+def cpu_usage(header, tasks, records):
+    ''' Fraction of the traced time each task was running, keyed by task name '''
+    usage = {}
+    current = None
+    switched_in = None
+    for timestamp, event, obj, _ in records:
+        if event != TASK_SWITCH:
+            continue
+        if current is not None:
+            usage[current] = usage.get(current, 0) + timestamp - switched_in
+        current = obj
+        switched_in = timestamp
+    if current is not None:
+        usage[current] = usage.get(current, 0) + records[-1][0] - switched_in
+    total = sum(usage.values())
+    return {tasks.get(n, 'task {}'.format(n)): t / total for n, t in usage.items()} if total else {}
+
+
+if __name__ == '__main__':
+    import argparse
+    parser = argparse.ArgumentParser(description='Convert an eRtosTraceDump output to Chrome trace format')
+    parser.add_argument('dump', help='Binary trace dump')
+    parser.add_argument('output', help='Chrome trace JSON output file')
+    args = parser.parse_args()
+    with open(args.dump, 'rb') as f:
+        trace = parse(f.read())
+    with open(args.output, 'w') as f:
+        json.dump(to_chrome(*trace), f)
+    header, _, records = trace
+    print('{} events, {} overwritten, {} cycles per event'.format(len(records), header['overwritten'],
+                                                                 header['overhead_cycles']))
+    if header['tasks_truncated']:
+        print('Task names missing, more tasks than RTOS_TRACE_MAX_TASKS')
+    for name, fraction in sorted(cpu_usage(*trace).items(), key=lambda x: -x[1]):
+        print('{:<12}{:6.1f}%'.format(name, 100 * fraction))
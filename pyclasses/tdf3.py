@@ -108,6 +108,10 @@ class Tdf:
     FLAG_TIME_MASK  = 0x03 << 2
     FLAG_TEMPORAL_ARRAY = 0x02
     FLAG_SPATIAL_ARRAY = 0x01
+    # Reserved TDF ID marking a compressed segment, the real ID follows (see xTdfCompressor_t)
+    SID_COMPRESSED = 0x0FFE
+    # Sequence number and CRC at the end of logger blocks written with LOGGER_CONFIG_BLOCK_FOOTER
+    LOGGER_FOOTER_SIZE = 6
     FLAG_BITS = 4
     FLAG_MASK = 0xF000
 
@@ -232,6 +236,16 @@ class Tdf:
             if debug: print(c.BLUE + ' '.join(['%02x' % b for b in buffer[:1]]) + c.END, end=' ', file=debug)
             buffer = buffer[1:]
 
+            # Compressed segments carry the real SID after the reserved header
+            compressed = sid == Tdf.SID_COMPRESSED
+            if compressed:
+                try:
+                    (sid,) = struct.unpack('<H', buffer[:2])
+                except struct.error:
+                    raise TdfBufferLengthError(0, 'None', initialBufLen-currentBufLen, timestamp)
+                sid &= ~Tdf.FLAG_MASK
+                buffer = buffer[2:]
+
             # Look up the SID in the tdf dictionary
             try:
                 sensorInfo = self.tdfDict[str(sid)]
@@ -268,6 +282,73 @@ class Tdf:
         if debug: print('', file=debug)
         return
 
+    @staticmethod
+    def readVarint(buffer, offset):
+        ''' Reads an unsigned LEB128 varint
+        Returns (value, offset after the varint) '''
+        value = 0
+        shift = 0
+        while True:
+            b = buffer[offset]
+            offset += 1
+            value |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return (value, offset)
+
+    def expandCompressed(self, sid, flags, sensorInfo, buffer):
+        ''' Expands a compressed TDF segment into standard TDF3 records
+        Takes the TDF ID, flags, sensor info and the buffer following the segment TDF ID
+        Segment layout is documented alongside xTdfCompressor_t in tdf.h
+        Returns (expanded buffer, remaining buffer, time of final record or None) '''
+        length = sensorInfo.get('bytes')
+        if length is None:
+            raise TdfParseException('Compressed segments require fixed length TDFs')
+        timed = ( flags & Tdf.FLAG_TIME_MASK ) == Tdf.FLAG_TIMESTAMP
+        count = buffer[0]
+        offset = 1
+        if timed:
+            (seconds, fraction) = struct.unpack('<LH', buffer[offset:offset+6])
+            offset += 6
+        record = bytearray(buffer[offset:offset+length])
+        if len(record) != length:
+            raise IndexError
+        offset += length
+        expanded = bytearray()
+        runRemaining = 0
+        runDelta = 0
+        for i in range(count):
+            if i > 0:
+                if timed:
+                    # Time differences are run length encoded
+                    if runRemaining == 0:
+                        (runDelta, offset) = Tdf.readVarint(buffer, offset)
+                        runRemaining = buffer[offset]
+                        offset += 1
+                    runRemaining -= 1
+                    fraction += runDelta
+                    seconds += fraction >> 16
+                    fraction &= 0xFFFF
+                # Zig-zag encoded differences of little endian 16 bit words
+                for w in range(0, length, 2):
+                    (zigzag, offset) = Tdf.readVarint(buffer, offset)
+                    delta = (zigzag >> 1) ^ -(zigzag & 0x01)
+                    word = record[w] | ((record[w+1] << 8) if w + 1 < length else 0)
+                    word = (word + delta) & 0xFFFF
+                    record[w] = word & 0xFF
+                    if w + 1 < length:
+                        record[w+1] = word >> 8
+            if timed:
+                expanded += struct.pack('<HLH', sid | (Tdf.FLAG_TIMESTAMP << (16-Tdf.FLAG_BITS)), seconds, fraction)
+            else:
+                expanded += struct.pack('<H', sid)
+            expanded += record
+        lastTime = None
+        if timed:
+            lastTime = FosTime.fos2utc(seconds) + datetime.timedelta(milliseconds=((fraction/65536.0)*1000.0))
+            lastTime = lastTime.replace(tzinfo=None)
+        return (bytes(expanded), buffer[offset:], lastTime)
+
     def parseTdf16(self, buffer, time=datetime.datetime.utcnow(), timestamp=None, debug=False, combine=False):
         ''' Parses TDF3 (16 bit) messages
         Takes TDF buffer and time
@@ -316,15 +397,38 @@ class Tdf:
             sid = sid & ~Tdf.FLAG_MASK
             #print "flags: %x sid: %x" % (flags, sid)
 
+            # Compressed segments carry the real SID after the reserved header
+            compressed = sid == Tdf.SID_COMPRESSED
+            if compressed:
+                try:
+                    (sid,) = struct.unpack('<H', buffer[:2])
+                except struct.error:
+                    raise TdfBufferLengthError(0, 'None', initialBufLen-currentBufLen, timestamp)
+                sid &= ~Tdf.FLAG_MASK
+                buffer = buffer[2:]
+
             # Look up the SID in the tdf dictionary
             try:
                 sensorInfo = self.tdfDict[str(sid)]
             except KeyError:
-                if sid == 0 or sid == 4095: # 0xffff - 0xf000 = 4095
+                if not compressed and (sid == 0 or sid == 4095): # 0xffff - 0xf000 = 4095
                     continue
                 if debug: print(c.RED + ' '.join(['%02x' % b for b in buffer]) + c.END, end=' ', file=debug)
                 raise TdfLookupError(sid, initialBufLen-currentBufLen)
 
+            # Compressed segments are expanded into standard TDFs and parsed as normal
+            if compressed:
+                try:
+                    (expanded, buffer, lastTime) = self.expandCompressed(sid, flags, sensorInfo, buffer)
+                except (IndexError, struct.error):
+                    if debug: print(c.RED + ' '.join(['%02x' % b for b in buffer]) + c.END, file=debug)
+                    raise TdfBufferLengthError(sid, sensorInfo['sensor'], initialBufLen-currentBufLen, timestamp)
+                for reading in self.parseTdf16(expanded, time=time, timestamp=timestamp, debug=debug, combine=combine):
+                    yield reading
+                if lastTime is not None:
+                    timestamp = lastTime
+                continue
+
             # Check for special flags in the SensorID
             if ( flags & Tdf.FLAG_TIME_MASK ) > 0:
                 if ( flags & Tdf.FLAG_TIME_MASK ) == Tdf.FLAG_TIMESTAMP:
@@ -469,3 +573,11 @@ class Tdf:
                                 }
         if debug: print('', file=debug, flush=True)
         return
+
+    def parseLogBlock(self, block, footer=False, time=datetime.datetime.utcnow(), debug=False, combine=False):
+        ''' Parses a complete logger block of TDF3 data
+        Commit markers and unused bytes are skipped as padding, the block footer is removed when footer is True
+        Emits the same dicts as parseTdf16 '''
+        if footer:
+            block = block[:len(block) - Tdf.LOGGER_FOOTER_SIZE]
+        return self.parseTdf16(block, time=time, debug=debug, combine=combine)
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the accelerometer DSP pipeline, with a throughput benchmark
+ *
+ * The benchmark replays a recorded trace, a CSV of raw x,y,z samples at 100 Hz
+ * in units of G / 16384, given as the first argument. The trace is processed in
+ * FIFO sized bursts, as the accelerometer drivers hand samples to the pipeline.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "accelerometer_dsp.h"
+
+static int iErrors;
+#define CHECK( c, ... )                             \
+	do {                                            \
+		if ( !( c ) ) {                             \
+			iErrors++;                              \
+			printf( "FAIL %d: ", __LINE__ );        \
+			printf( __VA_ARGS__ );                  \
+			printf( "\n" );                         \
+		}                                           \
+	} while ( 0 )
+
+eModuleError_t eTdfAddMulti( uint8_t ucLoggerMask, eTdfIds_t eTdfType, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, void *pvTdfData )
+{
+	return ERROR_NONE;
+}
+
+static xAccDspFeatures_t xLastWindow;
+static int				 iWindows;
+
+static void prvWindow( xAccDspFeatures_t *pxFeatures, void *pvContext )
+{
+	xLastWindow = *pxFeatures;
+	iWindows++;
+}
+
+#define TRACE_MAX_SAMPLES 65536
+#define TRACE_BURST		  32
+
+static xAccelerometerSample_t pxTrace[TRACE_MAX_SAMPLES];
+static xAccelerometerSample_t pxBurst[TRACE_BURST];
+static int8_t				  pcClasses[TRACE_MAX_SAMPLES / 100];
+static int					  iClasses;
+
+static void prvTraceWindow( xAccDspFeatures_t *pxFeatures, void *pvContext )
+{
+	if ( iClasses < (int) sizeof( pcClasses ) ) {
+		pcClasses[iClasses++] = pxFeatures->cActivityClass;
+	}
+}
+
+static int prvTraceLoad( const char *pcPath )
+{
+	FILE *pxFile = fopen( pcPath, "r" );
+	char  pcLine[64];
+	long  lX, lY, lZ;
+	int	  iNum = 0;
+
+	if ( pxFile == NULL ) {
+		return -1;
+	}
+	while ( ( iNum < TRACE_MAX_SAMPLES ) && fgets( pcLine, sizeof( pcLine ), pxFile ) ) {
+		if ( sscanf( pcLine, "%ld,%ld,%ld", &lX, &lY, &lZ ) == 3 ) {
+			pxTrace[iNum++] = ( xAccelerometerSample_t ){ .lX = lX, .lY = lY, .lZ = lZ };
+		}
+	}
+	fclose( pxFile );
+	return iNum;
+}
+
+/* Pushes the whole trace through the pipeline in bursts, copying each burst as a driver fills its FIFO buffer */
+__attribute__( ( noinline, no_sanitize_address ) ) static void prvTraceReplay( xAccDsp_t *pxDsp, int iNum )
+{
+	int i, iBurst;
+
+	for ( i = 0; i < iNum; i += iBurst ) {
+		iBurst = ( iNum - i ) < TRACE_BURST ? ( iNum - i ) : TRACE_BURST;
+		memcpy( pxBurst, pxTrace + i, iBurst * sizeof( xAccelerometerSample_t ) );
+		xAccelerometerSampleBuffer_t xBuffer = { (uint8_t) iBurst, pxBurst };
+		ucAccDspProcess( pxDsp, &xBuffer );
+	}
+}
+
+static double prvSeconds( void )
+{
+	struct timespec xNow;
+	clock_gettime( CLOCK_MONOTONIC, &xNow );
+	return xNow.tv_sec + xNow.tv_nsec * 1e-9;
+}
+
+static uint8_t prvProcess( xAccDsp_t *pxDsp, xAccelerometerSample_t *pxSamples, uint8_t ucNum )
+{
+	xAccelerometerSampleBuffer_t xBuffer = { ucNum, pxSamples };
+	return ucAccDspProcess( pxDsp, &xBuffer );
+}
+
+int main( int argc, char **argv )
+{
+	static const int16_t  psTaps[4] = { 8192, 8192, 8192, 8192 };
+	static const uint32_t pulBins[2] = { 100, 1000 };
+	xAccelerometerSample_t pxSamples[200];
+	xAccDspConfig_t		   xConfig = { NULL, 0, 4, 4, 25, pulBins, 2, prvWindow, NULL };
+	xAccDsp_t			   xDsp;
+	uint8_t				   ucOut;
+	int					   i, iBurst;
+
+	/* Magnitude keeps full resolution below 1G and does not overflow at 16G */
+	CHECK( ulAccDspMagnitude( 16384, 0, 0 ) == 16384, "1G magnitude" );
+	CHECK( ulAccDspMagnitude( -300, 400, 0 ) == 500, "3-4-5 magnitude" );
+	uint32_t ulBig = ulAccDspMagnitude( 16 * 16384, -16 * 16384, 16 * 16384 );
+	CHECK( fabs( ulBig - 16 * 16384 * sqrt( 3 ) ) < 16 * 16384 * sqrt( 3 ) * 0.001, "16G magnitude %u", ulBig );
+
+	/* Invalid configurations */
+	xConfig.ucDecimation = 0;
+	CHECK( eAccDspInit( &xDsp, &xConfig ) == ERROR_INVALID_DATA, "zero decimation" );
+	xConfig.ucDecimation = 4;
+	xConfig.psFirTaps	= psTaps;
+	xConfig.ucNumFirTaps = ACC_DSP_MAX_FIR_TAPS + 1;
+	CHECK( eAccDspInit( &xDsp, &xConfig ) == ERROR_INVALID_DATA, "too many taps" );
+
+	/* Boxcar decimation averages each group of inputs, truncating toward zero, outputs are written in place */
+	xConfig.psFirTaps = NULL;
+	CHECK( eAccDspInit( &xDsp, &xConfig ) == ERROR_NONE, "boxcar init" );
+	for ( i = 0; i < 100; i++ ) {
+		pxSamples[i] = ( xAccelerometerSample_t ){ .lX = i, .lY = -i, .lZ = 16384 };
+	}
+	ucOut = prvProcess( &xDsp, pxSamples, 100 );
+	CHECK( ucOut == 25, "boxcar outputs %d", ucOut );
+	for ( i = 0; i < ucOut; i++ ) {
+		CHECK( pxSamples[i].lX == ( 16 * i + 6 ) / 4 && pxSamples[i].lY == -( 16 * i + 6 ) / 4, "boxcar output %d: %d %d", i, (int) pxSamples[i].lX, (int) pxSamples[i].lY );
+		CHECK( pxSamples[i].ulMagnitude == ulAccDspMagnitude( pxSamples[i].lX, pxSamples[i].lY, pxSamples[i].lZ ), "output magnitude %d", i );
+	}
+	CHECK( iWindows == 1, "one window per 25 outputs, got %d", iWindows );
+
+	/* Decimation state carries across bursts of any length */
+	vAccDspReset( &xDsp );
+	for ( i = 0; i < 10; i++ ) {
+		pxSamples[i] = ( xAccelerometerSample_t ){ .lX = 8, .lY = 0, .lZ = 16384 };
+	}
+	CHECK( prvProcess( &xDsp, pxSamples, 3 ) == 0, "partial group" );
+	CHECK( prvProcess( &xDsp, pxSamples, 5 ) == 2, "groups spanning bursts" );
+
+	/* Unity gain FIR passes a constant exactly, and a static signal has no dynamic component */
+	xConfig.psFirTaps	= psTaps;
+	xConfig.ucNumFirTaps = 4;
+	eAccDspInit( &xDsp, &xConfig );
+	iWindows = 0;
+	for ( iBurst = 0; iBurst < 4; iBurst++ ) {
+		for ( i = 0; i < 100; i++ ) {
+			pxSamples[i] = ( xAccelerometerSample_t ){ .lX = 1000, .lY = -2000, .lZ = 16000 };
+		}
+		ucOut = prvProcess( &xDsp, pxSamples, 100 );
+		CHECK( ucOut == 25 && pxSamples[24].lX == 1000 && pxSamples[24].lY == -2000 && pxSamples[24].lZ == 16000, "FIR constant" );
+	}
+	CHECK( iWindows == 4 && xLastWindow.ulMeanOdba == 0 && xLastWindow.cActivityClass == 0, "static window odba %u class %d", xLastWindow.ulMeanOdba, xLastWindow.cActivityClass );
+	CHECK( xLastWindow.lVarianceX == 0 && xLastWindow.xMagnitude.n == 25, "static window variance" );
+
+	/* Movement on one axis is reported as dynamic acceleration and classified */
+	for ( iBurst = 0; iBurst < 20; iBurst++ ) {
+		for ( i = 0; i < 100; i++ ) {
+			double t	 = ( iBurst * 100 + i ) / 100.0;
+			pxSamples[i] = ( xAccelerometerSample_t ){ .lX = (int32_t) ( 8000 * sin( 2 * M_PI * 2 * t ) ), .lY = 0, .lZ = 16384 };
+		}
+		prvProcess( &xDsp, pxSamples, 100 );
+	}
+	CHECK( xLastWindow.ulMeanOdba > 100 && xLastWindow.cActivityClass >= 1, "moving window odba %u class %d", xLastWindow.ulMeanOdba, xLastWindow.cActivityClass );
+	CHECK( xLastWindow.lVarianceX > 0 && xLastWindow.lVarianceY == 0, "moving window variance %d %d", (int) xLastWindow.lVarianceX, (int) xLastWindow.lVarianceY );
+
+	/* Recorded trace: resting windows are class 0, moving windows are not, throughput is informational */
+	int iTrace = ( argc > 1 ) ? prvTraceLoad( argv[1] ) : -1;
+	CHECK( iTrace >= 1000, "trace %s loaded %d samples", ( argc > 1 ) ? argv[1] : "(none)", iTrace );
+	if ( iTrace >= 1000 ) {
+		int iRest = 0, iMoving = 0;
+
+		xConfig.fnWindowComplete = prvTraceWindow;
+		eAccDspInit( &xDsp, &xConfig );
+		prvTraceReplay( &xDsp, iTrace );
+		CHECK( iClasses == iTrace / 100, "trace windows %d", iClasses );
+		for ( i = 0; i < iClasses; i++ ) {
+			iRest += ( pcClasses[i] == 0 );
+			iMoving += ( pcClasses[i] > 0 );
+		}
+		CHECK( iRest > 0 && iMoving > 0, "trace classes %d resting %d moving", iRest, iMoving );
+		printf( "Trace of %d samples, %d windows, %d resting, %d moving\n", iTrace, iClasses, iRest, iMoving );
+
+		int	   iRepeats = 1 + 4000000 / iTrace;
+		double dBest	= 1e9;
+		for ( int iRun = 0; iRun < 3; iRun++ ) {
+			double dStart = prvSeconds();
+			for ( i = 0; i < iRepeats; i++ ) {
+				prvTraceReplay( &xDsp, iTrace );
+			}
+			double dElapsed = prvSeconds() - dStart;
+			dBest			= dElapsed < dBest ? dElapsed : dBest;
+		}
+		printf( "4 tap FIR, decimate by 4: %.2f M samples/s on this host (%.0f x a 100 Hz stream)\n",
+				1e-6 * iRepeats * iTrace / dBest, iRepeats * iTrace / dBest / 100.0 );
+	}
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the activity scheduler, driven through xActivitySchedulerRun with a simulated tick count
+ * An hour of sensor activities is run with and without slack and aligned phases, reporting worker wakeups per hour
+ * and the largest lateness (jitter) of any periodic run, including across tick count overflow.
+ * activity_scheduler.c is included directly so module state can be reset between scenarios.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+
+/* Critical sections are counted to check the flags shared with the worker are locked */
+static int iCriticalDepth, iCriticalEntries;
+#undef taskENTER_CRITICAL
+#undef taskEXIT_CRITICAL
+#define taskENTER_CRITICAL() \
+	do {                     \
+		iCriticalDepth++;    \
+		iCriticalEntries++;  \
+	} while ( 0 )
+#define taskEXIT_CRITICAL() iCriticalDepth--
+
+#include "activity_scheduler.c"
+
+#define HOUR ( 3600 * configTICK_RATE_HZ )
+#define NUM_SENSORS 6
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+static const uint32_t pulPeriodsMs[NUM_SENSORS] = { 1000, 5000, 7000, 10000, 30000, 60000 };
+static uint32_t		  ulEventRuns;
+static uint32_t		  ulNotified;
+
+BaseType_t xTaskNotify( TaskHandle_t xTask, uint32_t ulValue, int eAction )
+{
+	ulNotified |= ulValue;
+	return pdPASS;
+}
+
+static void prvRun( void *pvContext, uint32_t ulEvents )
+{
+	if ( ulEvents ) {
+		ulEventRuns++;
+	}
+}
+
+/* Simulate an hour from xStart, the worker sleeps for the returned time unless an event arrives first */
+static uint32_t prvScenario( const char *pcName, uint32_t ulSlackPercent, bool bAligned, TickType_t xStart, bool bEvents )
+{
+	static xActivity_t pxSensors[NUM_SENSORS + 1];
+	TickType_t		   xNow, xSleep, xWake, xNextEvent, xMaxLateness = 0;
+	uint32_t		   ulEvents = 0, ulExpected, ulRuns = 0;
+	int				   i;
+
+	memset( pxSensors, 0x00, sizeof( pxSensors ) );
+	pxActivities = NULL;
+	memset( &xStats, 0x00, sizeof( xStats ) );
+	ulEventRuns = 0;
+	srand( 7 );
+	for ( i = 0; i < NUM_SENSORS; i++ ) {
+		pxSensors[i].fnRun	= prvRun;
+		pxSensors[i].xPeriod = pdMS_TO_TICKS( pulPeriodsMs[i] );
+		pxSensors[i].xPhase  = bAligned ? 0 : rand() % pxSensors[i].xPeriod;
+		pxSensors[i].xSlack  = pxSensors[i].xPeriod * ulSlackPercent / 100;
+		CHECK( eActivityRegister( &pxSensors[i] ) == ERROR_NONE, "%s: register %d", pcName, i );
+	}
+	pxSensors[NUM_SENSORS].fnRun	= prvRun;
+	pxSensors[NUM_SENSORS].ulEvents = 0x01;
+	eActivityRegister( &pxSensors[NUM_SENSORS] );
+
+	/* A button press every two minutes on average */
+	xNextEvent = xStart + rand() % ( 240 * configTICK_RATE_HZ );
+	xNow	   = xStart;
+	while ( ( xNow - xStart ) < HOUR ) {
+		xSleep	 = xActivitySchedulerRun( xNow, ulEvents );
+		ulEvents = 0;
+		xWake	 = ( xSleep == portMAX_DELAY ) ? xNow + HOUR : xNow + xSleep;
+		if ( bEvents && ( (int32_t) ( xNextEvent - xWake ) < 0 ) ) {
+			xWake		= xNextEvent;
+			ulEvents	= 0x01;
+			xNextEvent += 1 + rand() % ( 240 * configTICK_RATE_HZ );
+		}
+		xNow = xWake;
+	}
+
+	for ( i = 0; i < NUM_SENSORS; i++ ) {
+		ulExpected = HOUR / pxSensors[i].xPeriod;
+		CHECK( ( pxSensors[i].ulRuns + 1 >= ulExpected ) && ( pxSensors[i].ulRuns <= ulExpected + 1 ), "%s: %u runs of %u", pcName, pxSensors[i].ulRuns, ulExpected );
+		CHECK( pxSensors[i].xMaxLateness <= pxSensors[i].xSlack, "%s: lateness %u beyond slack %u", pcName, pxSensors[i].xMaxLateness, pxSensors[i].xSlack );
+		CHECK( pxSensors[i].ulMissed == 0, "%s: %u runs missed", pcName, pxSensors[i].ulMissed );
+		xMaxLateness = MAX( xMaxLateness, pxSensors[i].xMaxLateness );
+		ulRuns += pxSensors[i].ulRuns;
+	}
+	if ( bEvents ) {
+		CHECK( ulEventRuns > 0, "%s: no event runs", pcName );
+	}
+	printf( "%-36s %5u wakeups/hour, %5u activity runs, %3u event runs, %4u ms max lateness\n", pcName, xStats.ulWakeups, ulRuns, ulEventRuns, xMaxLateness * 1000 / configTICK_RATE_HZ );
+	return xStats.ulWakeups;
+}
+
+static TickType_t prvAlignAt( TickType_t xPeriod, TickType_t xPhase, TickType_t xNow )
+{
+	xActivity_t xActivity = { .fnRun = prvRun, .xPeriod = xPeriod, .xPhase = xPhase };
+	prvAlign( &xActivity, xNow );
+	return xActivity.xNextRun;
+}
+
+int main( void )
+{
+	xActivity_t xInvalid = { .fnRun = prvRun, .xPeriod = 10, .xSlack = 10 };
+	xActivity_t xActivity;
+	TickType_t  xSleep;
+	uint32_t	ulSeparate, ulShared;
+
+	/* Sharing wakeups, the separate task per sensor baseline has no slack and random phases */
+	ulSeparate = prvScenario( "random phases, no slack", 0, false, 0, false );
+	prvScenario( "aligned phases, no slack", 0, true, 0, false );
+	prvScenario( "random phases, 10% slack", 10, false, 0, false );
+	ulShared = prvScenario( "aligned phases, 10% slack", 10, true, 0, false );
+	prvScenario( "aligned phases, 10% slack, events", 10, true, 0, true );
+	prvScenario( "random phases, 10% slack, tick overflow", 10, false, UINT32_MAX - 1000 * configTICK_RATE_HZ, true );
+	/* Every activity shares the wakeups of the fastest one */
+	CHECK( ulShared <= HOUR / pdMS_TO_TICKS( pulPeriodsMs[0] ) + 1, "slack and alignment only reduced wakeups from %u to %u", ulSeparate, ulShared );
+
+	/* Invalid activities are rejected */
+	CHECK( eActivityRegister( &xInvalid ) == ERROR_INVALID_DATA, "slack not less than the period accepted" );
+	xInvalid.xPeriod = 0;
+	xInvalid.xSlack	 = 0;
+	CHECK( eActivityRegister( &xInvalid ) == ERROR_INVALID_DATA, "activity without a trigger accepted" );
+
+	/* Phase alignment, including phases beyond the current tick and periods near the tick range */
+	CHECK( prvAlignAt( 100, 30, 1005 ) == 1030, "align after the phase" );
+	CHECK( prvAlignAt( 100, 30, 1030 ) == 1030, "align on a due tick" );
+	CHECK( prvAlignAt( 100, 130, 1005 ) == 1030, "align with a phase beyond the period" );
+	CHECK( prvAlignAt( 100, 30, 5 ) == 30, "align before the first due tick" );
+	CHECK( prvAlignAt( 1000, 30, UINT32_MAX - 100 ) == (TickType_t) ( UINT32_MAX - 100 + 1000 - ( ( UINT32_MAX - 100 - 30 ) % 1000 ) ), "align across overflow" );
+	CHECK( prvAlignAt( 0x90000000, 0x8FFFFFFF, 0x20 ) == 0x8FFFFFFF, "align with a long period" );
+	CHECK( prvAlignAt( 0x90000000, 0x10, 0x8FFFFF00 ) == 0x90000010, "align with a long period after the phase" );
+
+	/* A re-enabled activity is realigned to its phase, missed runs are not made up */
+	pxActivities = NULL;
+	memset( &xActivity, 0x00, sizeof( xActivity ) );
+	xActivity.fnRun	  = prvRun;
+	xActivity.xPeriod = 100;
+	xActivity.xPhase  = 30;
+	eActivityRegister( &xActivity );
+	xActivitySchedulerRun( 1005, 0 );
+	CHECK( xActivity.xNextRun == 1030, "first run at %u", xActivity.xNextRun );
+	iCriticalEntries = 0;
+	vActivityEnable( &xActivity, false );
+	CHECK( ( iCriticalEntries > 0 ) && ( iCriticalDepth == 0 ), "enable not locked" );
+	xActivitySchedulerRun( 1030, 0 );
+	CHECK( xActivity.ulRuns == 0, "disabled activity run" );
+	vActivityEnable( &xActivity, true );
+	xSleep = xActivitySchedulerRun( 5000, 0 );
+	CHECK( ( xActivity.xNextRun == 5030 ) && ( xSleep == 30 ) && ( xActivity.ulMissed == 0 ), "realigned to %u, sleep %u", xActivity.xNextRun, xSleep );
+	CHECK( iCriticalDepth == 0, "unbalanced critical sections" );
+
+	/* Signals before the worker starts are dropped */
+	ulNotified = 0;
+	vActivitySignal( 0x01 );
+	CHECK( ulNotified == 0, "signal before start" );
+	CHECK( eActivitySchedulerStart() == ERROR_NONE, "start" );
+	vActivitySignal( 0x02 );
+	CHECK( ulNotified == 0x02, "signal after start" );
+	CHECK( eActivitySchedulerStart() == ERROR_INVALID_STATE, "second start" );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host build of the EFR32 SPI and I2C drivers against stub Gecko SDK headers, with checks of their transaction queues
+ * The EFR32 drivers run queued transactions synchronously in the calling task. SPIDRV completes transfers immediately
+ * into a register mapped device and the polled I2C driver serves one device, NACKing any other address.
+ * The harness checks data, chip select framing and completion callbacks, NACKed I2C transactions abandoning their
+ * operations, and that a transaction is rejected without a callback when the bus cannot be claimed.
+ * The host cannot block, so a take of a mutex held by another task fails as a timeout would.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "em_cmu.h"
+
+#include "i2c.h"
+#include "spi.h"
+
+#define I2C_DEVICE_ADDRESS 0x29
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+/* Kernel objects -------------------------------------------*/
+
+typedef struct xHostSemaphore_t
+{
+	int  iCount;
+	int  iRecursion;
+	bool bHeldElsewhere;
+} xHostSemaphore_t;
+
+static xHostSemaphore_t pxSemaphores[8];
+static uint32_t			ulSemaphores;
+
+static xHostSemaphore_t *prvSemaphoreCreate( int iCount )
+{
+	xHostSemaphore_t *pxSemaphore = &pxSemaphores[ulSemaphores++];
+
+	memset( pxSemaphore, 0x00, sizeof( xHostSemaphore_t ) );
+	pxSemaphore->iCount = iCount;
+	return pxSemaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic( StaticSemaphore_t *pxSemaphoreBuffer )
+{
+	return prvSemaphoreCreate( 0 );
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic( StaticSemaphore_t *pxMutexBuffer )
+{
+	return prvSemaphoreCreate( 1 );
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic( StaticSemaphore_t *pxMutexBuffer )
+{
+	return prvSemaphoreCreate( 0 );
+}
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore, TickType_t xTicksToWait )
+{
+	xHostSemaphore_t *pxSemaphore = xSemaphore;
+
+	if ( pxSemaphore->bHeldElsewhere || ( pxSemaphore->iCount == 0 ) ) {
+		return pdFAIL;
+	}
+	pxSemaphore->iCount--;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore )
+{
+	xHostSemaphore_t *pxSemaphore = xSemaphore;
+
+	configASSERT( pxSemaphore->iCount == 0 );
+	pxSemaphore->iCount++;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveFromISR( SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken )
+{
+	( (xHostSemaphore_t *) xSemaphore )->iCount = 1;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t xMutex, TickType_t xTicksToWait )
+{
+	xHostSemaphore_t *pxSemaphore = xMutex;
+
+	if ( pxSemaphore->bHeldElsewhere ) {
+		return pdFAIL;
+	}
+	pxSemaphore->iRecursion++;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t xMutex )
+{
+	xHostSemaphore_t *pxSemaphore = xMutex;
+
+	configASSERT( pxSemaphore->iRecursion > 0 );
+	pxSemaphore->iRecursion--;
+	return pdPASS;
+}
+
+void CMU_ClockEnable( CMU_Clock_TypeDef clock, bool enable ) {}
+
+/* Chip select ----------------------------------------------*/
+
+#define CS_PIN 7
+
+static bool		bCsAsserted;
+static uint32_t ulCsAsserts;
+
+void vGpioSetup( xGpio_t xGpio, eGpioType_t eType, uint32_t ulParam )
+{
+	if ( xGpio.ucPin == CS_PIN ) {
+		if ( !bCsAsserted && ( eType == GPIO_OPENDRAIN ) && ( ulParam == GPIO_OPENDRAIN_LOW ) ) {
+			ulCsAsserts++;
+		}
+		bCsAsserted = ( eType == GPIO_OPENDRAIN ) && ( ulParam == GPIO_OPENDRAIN_LOW );
+	}
+}
+
+/* SPIDRV model ---------------------------------------------*/
+
+/* Bytes clocked out while the chip select is asserted, the device answers with a count of bytes clocked */
+static uint8_t	pucSpiWritten[64];
+static uint32_t ulSpiWritten;
+static uint32_t ulSpiClocked;
+static bool		bSpiInitialised;
+
+Ecode_t SPIDRV_Init( SPIDRV_Handle_t handle, SPIDRV_Init_t *initData )
+{
+	CHECK( !bSpiInitialised, "SPIDRV initialised twice" );
+	CHECK( initData->csControl == spidrvCsControlApplication, "chip select not under application control" );
+	handle->initData = *initData;
+	bSpiInitialised	 = true;
+	return ECODE_EMDRV_SPIDRV_OK;
+}
+
+Ecode_t SPIDRV_DeInit( SPIDRV_Handle_t handle )
+{
+	bSpiInitialised = false;
+	return ECODE_EMDRV_SPIDRV_OK;
+}
+
+static void prvSpiClock( SPIDRV_Handle_t handle, const uint8_t *pucTx, uint8_t *pucRx, int iCount, SPIDRV_Callback_t fnCallback )
+{
+	int i;
+
+	CHECK( bSpiInitialised && bCsAsserted, "transfer with the bus %s and chip select %s", bSpiInitialised ? "started" : "stopped", bCsAsserted ? "asserted" : "released" );
+	for ( i = 0; i < iCount; i++ ) {
+		if ( ulSpiWritten < sizeof( pucSpiWritten ) ) {
+			pucSpiWritten[ulSpiWritten++] = ( pucTx != NULL ) ? pucTx[i] : (uint8_t) handle->initData.dummyTxValue;
+		}
+		if ( pucRx != NULL ) {
+			pucRx[i] = (uint8_t) ulSpiClocked;
+		}
+		ulSpiClocked++;
+	}
+	/* SPIDRV calls back from its DMA interrupt */
+	fnCallback( handle, ECODE_EMDRV_SPIDRV_OK, iCount );
+}
+
+Ecode_t SPIDRV_MTransmit( SPIDRV_Handle_t handle, const void *buffer, int count, SPIDRV_Callback_t callback )
+{
+	prvSpiClock( handle, buffer, NULL, count, callback );
+	return ECODE_EMDRV_SPIDRV_OK;
+}
+
+Ecode_t SPIDRV_MReceive( SPIDRV_Handle_t handle, void *buffer, int count, SPIDRV_Callback_t callback )
+{
+	prvSpiClock( handle, NULL, buffer, count, callback );
+	return ECODE_EMDRV_SPIDRV_OK;
+}
+
+Ecode_t SPIDRV_MTransfer( SPIDRV_Handle_t handle, const void *txBuffer, void *rxBuffer, int count, SPIDRV_Callback_t callback )
+{
+	prvSpiClock( handle, txBuffer, rxBuffer, count, callback );
+	return ECODE_EMDRV_SPIDRV_OK;
+}
+
+/* I2C model ------------------------------------------------*/
+
+I2C_TypeDef						pxHostI2C[2];
+static I2C_TransferSeq_TypeDef *pxI2CSequence;
+static uint8_t					pucI2CRegisters[256];
+static uint8_t					ucI2CPointer;
+static uint32_t					ulI2CSequences;
+
+void I2C_Init( I2C_TypeDef *i2c, const I2C_Init_TypeDef *init )
+{
+	i2c->ulFrequency = init->freq;
+}
+
+void I2C_Enable( I2C_TypeDef *i2c, bool enable )
+{
+	i2c->bEnabled = enable;
+}
+
+I2C_TransferReturn_TypeDef I2C_TransferInit( I2C_TypeDef *i2c, I2C_TransferSeq_TypeDef *seq )
+{
+	CHECK( i2c->bEnabled && ( i2c->ROUTEPEN != 0 ), "transfer on a disabled bus" );
+	pxI2CSequence = seq;
+	ulI2CSequences++;
+	return i2cTransferInProgress;
+}
+
+/* The device writes from the register pointer set by the first byte written, and reads from it */
+I2C_TransferReturn_TypeDef I2C_Transfer( I2C_TypeDef *i2c )
+{
+	I2C_TransferSeq_TypeDef *pxSequence = pxI2CSequence;
+	uint8_t *				 pucRx		= NULL;
+	uint16_t				 usRxLen	= 0, i;
+
+	if ( ( pxSequence->addr >> 1 ) != I2C_DEVICE_ADDRESS ) {
+		return i2cTransferNack;
+	}
+	if ( pxSequence->flags == I2C_FLAG_READ ) {
+		pucRx	= pxSequence->buf[0].data;
+		usRxLen = pxSequence->buf[0].len;
+	}
+	else {
+		for ( i = 0; i < pxSequence->buf[0].len; i++ ) {
+			if ( i == 0 ) {
+				ucI2CPointer = pxSequence->buf[0].data[0];
+			}
+			else {
+				pucI2CRegisters[ucI2CPointer++] = pxSequence->buf[0].data[i];
+			}
+		}
+		if ( pxSequence->flags == I2C_FLAG_WRITE_READ ) {
+			pucRx	= pxSequence->buf[1].data;
+			usRxLen = pxSequence->buf[1].len;
+		}
+	}
+	for ( i = 0; i < usRxLen; i++ ) {
+		pucRx[i] = pucI2CRegisters[ucI2CPointer++];
+	}
+	return i2cTransferDone;
+}
+
+/* Transactions ---------------------------------------------*/
+
+static USART_TypeDef xUsart;
+
+SPI_MODULE_CREATE( SPI0, &xUsart, USART0_IRQHandler );
+I2C_MODULE_CREATE( I2C0, I2C0 );
+
+static xSpiModule_t *const pxSpi = &SPI_MODULE_GET( SPI0 );
+static xI2CModule_t *const pxI2C = &I2C_MODULE_GET( I2C0 );
+
+static xSpiConfig_t xSpiConfig	 = { .xCsGpio = { gpioPortA, CS_PIN }, .ulMaxBitrate = 1000000, .eClockMode = eSpiClockMode0, .ucDummyTx = 0xFF, .ucMsbFirst = 1 };
+static xI2CConfig_t xI2CConfig	 = { .ulMaximumBusFrequency = 100000, .ucAddress = I2C_DEVICE_ADDRESS << 1 };
+static xI2CConfig_t xI2CAbsent	 = { .ulMaximumBusFrequency = 100000, .ucAddress = 0x40 << 1 };
+static uint32_t		ulCallbacks;
+static eModuleError_t eCallbackResult;
+
+static void prvDone( xBusTransaction_t *pxTransaction, eModuleError_t eResult )
+{
+	ulCallbacks++;
+	eCallbackResult = eResult;
+}
+
+static void prvHoldElsewhere( SemaphoreHandle_t xMutex, bool bHeld )
+{
+	( (xHostSemaphore_t *) xMutex )->bHeldElsewhere = bHeld;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSpiTransactions( void )
+{
+	uint8_t			  pucWrite[3] = { 0x12, 0x34, 0x56 };
+	uint8_t			  ucCommand	  = 0x80 | 0x05;
+	uint8_t			  pucRx[4];
+	xBusOperation_t	  pxOperations[3];
+	xBusTransaction_t xTransaction;
+
+	CHECK( eSpiInit( pxSpi ) == ERROR_NONE, "SPI init" );
+
+	/* Write only, command then read, and full duplex with the transmit longer than the receive */
+	memset( pucRx, 0x00, sizeof( pucRx ) );
+	pxOperations[0] = ( xBusOperation_t ){ .pvTx = pucWrite, .usTxLen = 3 };
+	pxOperations[1] = ( xBusOperation_t ){ .pvTx = &ucCommand, .usTxLen = 1, .pvRx = pucRx, .usRxLen = 3 };
+	pxOperations[2] = ( xBusOperation_t ){ .pvTx = pucWrite, .usTxLen = 3, .pvRx = &pucRx[3], .usRxLen = 1 };
+	xTransaction	= ( xBusTransaction_t ){ .pvConfig = &xSpiConfig, .pxOperations = pxOperations, .ucNumOperations = 3, .fnDone = prvDone };
+	ulCallbacks		= 0;
+	CHECK( eSpiQueueTransaction( pxSpi, &xTransaction ) == ERROR_NONE, "SPI queue" );
+	CHECK( ( ulCallbacks == 1 ) && ( eCallbackResult == ERROR_NONE ), "%u callbacks, result %d", ulCallbacks, eCallbackResult );
+	CHECK( ( ulCsAsserts == 3 ) && !bCsAsserted && !bSpiInitialised, "%u chip selects, bus not released", ulCsAsserts );
+	/* Operations are full duplex from their first byte, as on the other platforms */
+	CHECK( ulSpiWritten == 9, "%u bytes clocked", ulSpiWritten );
+	CHECK( ( memcmp( pucSpiWritten, pucWrite, 3 ) == 0 ) && ( pucSpiWritten[3] == ucCommand ), "written" );
+	CHECK( ( pucSpiWritten[4] == 0xFF ) && ( pucSpiWritten[5] == 0xFF ) && ( memcmp( &pucSpiWritten[6], pucWrite, 3 ) == 0 ), "dummy bytes and full duplex" );
+	CHECK( ( pucRx[0] == 3 ) && ( pucRx[2] == 5 ) && ( pucRx[3] == 6 ), "read %u %u %u", pucRx[0], pucRx[2], pucRx[3] );
+
+	/* A transaction that cannot claim the bus is rejected without a callback */
+	ulCallbacks = 0;
+	ulCsAsserts = 0;
+	prvHoldElsewhere( pxSpi->xBusMutexHandle, true );
+	CHECK( eSpiQueueTransaction( pxSpi, &xTransaction ) == ERROR_TIMEOUT, "SPI queue with the bus held" );
+	CHECK( ( ulCallbacks == 0 ) && ( ulCsAsserts == 0 ) && !bSpiInitialised, "transaction run without the bus" );
+	prvHoldElsewhere( pxSpi->xBusMutexHandle, false );
+
+	xTransaction.ucNumOperations = 0;
+	CHECK( eSpiQueueTransaction( pxSpi, &xTransaction ) == ERROR_INVALID_DATA, "empty transaction accepted" );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvI2CTransactions( void )
+{
+	uint8_t			  pucWrite[3] = { 0x20, 0xAB, 0xCD };
+	uint8_t			  ucRegister  = 0x20;
+	uint8_t			  pucRx[2];
+	xBusOperation_t	  pxOperations[2];
+	xBusTransaction_t xTransaction;
+
+	pxI2C->xPlatform.xSda		   = ( xGpio_t ){ gpioPortC, 10 };
+	pxI2C->xPlatform.xScl		   = ( xGpio_t ){ gpioPortC, 11 };
+	pxI2C->xPlatform.ulLocationSda = 0;
+	pxI2C->xPlatform.ulLocationScl = 0;
+	CHECK( eI2CInit( pxI2C ) == ERROR_NONE, "I2C init" );
+
+	/* Write two registers, then read them back in one sequence */
+	pxOperations[0] = ( xBusOperation_t ){ .pvTx = pucWrite, .usTxLen = 3 };
+	pxOperations[1] = ( xBusOperation_t ){ .pvTx = &ucRegister, .usTxLen = 1, .pvRx = pucRx, .usRxLen = 2 };
+	xTransaction	= ( xBusTransaction_t ){ .pvConfig = &xI2CConfig, .pxOperations = pxOperations, .ucNumOperations = 2, .fnDone = prvDone };
+	ulCallbacks		= 0;
+	ulI2CSequences	= 0;
+	CHECK( eI2CQueueTransaction( pxI2C, &xTransaction ) == ERROR_NONE, "I2C queue" );
+	CHECK( ( ulCallbacks == 1 ) && ( eCallbackResult == ERROR_NONE ) && ( ulI2CSequences == 2 ), "%u callbacks, result %d, %u sequences", ulCallbacks, eCallbackResult, ulI2CSequences );
+	CHECK( ( pucRx[0] == 0xAB ) && ( pucRx[1] == 0xCD ), "read %02X %02X", pucRx[0], pucRx[1] );
+	CHECK( !pxI2C->bBusClaimed && ( I2C0->ROUTEPEN == 0 ), "I2C not released" );
+
+	/* A NACK abandons the remaining operations */
+	xTransaction.pvConfig = &xI2CAbsent;
+	ulCallbacks			  = 0;
+	ulI2CSequences		  = 0;
+	CHECK( eI2CQueueTransaction( pxI2C, &xTransaction ) == ERROR_NONE, "I2C queue to an absent device" );
+	CHECK( ( ulCallbacks == 1 ) && ( eCallbackResult == ERROR_NO_ACKNOWLEDGEMENT ), "%u callbacks, result %d", ulCallbacks, eCallbackResult );
+	CHECK( ( ulI2CSequences == 1 ) && ( xTransaction.ucOperation == 0 ), "%u sequences after a NACK", ulI2CSequences );
+	CHECK( !pxI2C->bBusClaimed, "I2C not released after a NACK" );
+
+	/* A transaction that cannot claim the bus is rejected without a callback */
+	xTransaction.pvConfig = &xI2CConfig;
+	ulCallbacks			  = 0;
+	ulI2CSequences		  = 0;
+	prvHoldElsewhere( pxI2C->xBusMutexHandle, true );
+	CHECK( eI2CQueueTransaction( pxI2C, &xTransaction ) == ERROR_TIMEOUT, "I2C queue with the bus held" );
+	CHECK( ( ulCallbacks == 0 ) && ( ulI2CSequences == 0 ) && !pxI2C->bBusClaimed, "transaction run without the bus" );
+	prvHoldElsewhere( pxI2C->xBusMutexHandle, false );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+	prvSpiTransactions();
+	prvI2CTransactions();
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
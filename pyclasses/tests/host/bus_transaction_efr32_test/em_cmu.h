@@ -0,0 +1,16 @@
+/*
+ * Host stub of the Gecko SDK clock management unit
+ */
+#ifndef __CORE_CSIRO_HOST_EM_CMU_H__
+#define __CORE_CSIRO_HOST_EM_CMU_H__
+
+#include <stdbool.h>
+
+typedef enum {
+	cmuClock_I2C0,
+	cmuClock_I2C1
+} CMU_Clock_TypeDef;
+
+void CMU_ClockEnable( CMU_Clock_TypeDef clock, bool enable );
+
+#endif /* __CORE_CSIRO_HOST_EM_CMU_H__ */
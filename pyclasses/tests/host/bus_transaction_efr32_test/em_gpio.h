@@ -0,0 +1,17 @@
+/*
+ * Host stub of the Gecko SDK GPIO types, pins are configured through vGpioSetup
+ */
+#ifndef __CORE_CSIRO_HOST_EM_GPIO_H__
+#define __CORE_CSIRO_HOST_EM_GPIO_H__
+
+#include <stdint.h>
+
+typedef enum {
+	gpioPortA,
+	gpioPortB,
+	gpioPortC,
+	gpioPortD,
+	gpioPortF = 5
+} GPIO_Port_TypeDef;
+
+#endif /* __CORE_CSIRO_HOST_EM_GPIO_H__ */
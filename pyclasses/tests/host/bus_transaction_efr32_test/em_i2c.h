@@ -0,0 +1,66 @@
+/*
+ * Host stub of the Gecko SDK I2C driver, the harness implements the transfer functions
+ */
+#ifndef __CORE_CSIRO_HOST_EM_I2C_H__
+#define __CORE_CSIRO_HOST_EM_I2C_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+	uint32_t ROUTEPEN;
+	uint32_t ROUTELOC0;
+	uint32_t ulFrequency;
+	bool	 bEnabled;
+} I2C_TypeDef;
+
+extern I2C_TypeDef pxHostI2C[2];
+
+#define I2C0 ( &pxHostI2C[0] )
+#define I2C1 ( &pxHostI2C[1] )
+
+#define I2C_ROUTEPEN_SDAPEN 0x01
+#define I2C_ROUTEPEN_SCLPEN 0x02
+
+#define I2C_FLAG_WRITE 0x0001
+#define I2C_FLAG_READ 0x0002
+#define I2C_FLAG_WRITE_READ 0x0004
+
+typedef struct
+{
+	bool	 enable;
+	bool	 master;
+	uint32_t refFreq;
+	uint32_t freq;
+} I2C_Init_TypeDef;
+
+#define I2C_INIT_DEFAULT                                             \
+	{                                                                \
+		.enable = true, .master = true, .refFreq = 0, .freq = 92000 \
+	}
+
+typedef struct
+{
+	uint16_t addr;
+	uint16_t flags;
+	struct
+	{
+		uint8_t *data;
+		uint16_t len;
+	} buf[2];
+} I2C_TransferSeq_TypeDef;
+
+typedef enum {
+	i2cTransferInProgress = 1,
+	i2cTransferDone		  = 0,
+	i2cTransferNack		  = -1,
+	i2cTransferBusErr	  = -2
+} I2C_TransferReturn_TypeDef;
+
+void					   I2C_Init( I2C_TypeDef *i2c, const I2C_Init_TypeDef *init );
+void					   I2C_Enable( I2C_TypeDef *i2c, bool enable );
+I2C_TransferReturn_TypeDef I2C_TransferInit( I2C_TypeDef *i2c, I2C_TransferSeq_TypeDef *seq );
+I2C_TransferReturn_TypeDef I2C_Transfer( I2C_TypeDef *i2c );
+
+#endif /* __CORE_CSIRO_HOST_EM_I2C_H__ */
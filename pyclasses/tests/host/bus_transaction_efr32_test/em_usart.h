@@ -0,0 +1,14 @@
+/*
+ * Host stub of the Gecko SDK USART registers, SPIDRV is modelled by the harness
+ */
+#ifndef __CORE_CSIRO_HOST_EM_USART_H__
+#define __CORE_CSIRO_HOST_EM_USART_H__
+
+#include <stdint.h>
+
+typedef struct
+{
+	uint32_t ulDummy;
+} USART_TypeDef;
+
+#endif /* __CORE_CSIRO_HOST_EM_USART_H__ */
@@ -0,0 +1,11 @@
+/*
+ * Semaphore functions used by the bus drivers beyond those of the shared stubs
+ */
+#ifndef __CORE_CSIRO_HOST_SEMPHR_H__
+#define __CORE_CSIRO_HOST_SEMPHR_H__
+
+#include "FreeRTOS.h"
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic( StaticSemaphore_t *pxMutexBuffer );
+
+#endif /* __CORE_CSIRO_HOST_SEMPHR_H__ */
@@ -0,0 +1,75 @@
+/*
+ * Host stub of the Gecko SDK SPIDRV driver, the harness implements the driver functions
+ */
+#ifndef __CORE_CSIRO_HOST_SPIDRV_H__
+#define __CORE_CSIRO_HOST_SPIDRV_H__
+
+#include <stdint.h>
+
+#include "em_usart.h"
+
+typedef uint32_t Ecode_t;
+
+#define ECODE_EMDRV_SPIDRV_OK 0
+
+typedef enum {
+	spidrvMaster,
+	spidrvSlave
+} SPIDRV_Type_t;
+
+typedef enum {
+	spidrvBitOrderLsbFirst,
+	spidrvBitOrderMsbFirst
+} SPIDRV_BitOrder_t;
+
+typedef enum {
+	spidrvClockMode0,
+	spidrvClockMode1,
+	spidrvClockMode2,
+	spidrvClockMode3
+} SPIDRV_ClockMode_t;
+
+typedef enum {
+	spidrvCsControlAuto,
+	spidrvCsControlApplication
+} SPIDRV_CsControl_t;
+
+typedef enum {
+	spidrvSlaveStartImmediate,
+	spidrvSlaveStartDelayed
+} SPIDRV_SlaveStart_t;
+
+typedef struct
+{
+	USART_TypeDef *		port;
+	uint8_t				portLocationTx;
+	uint8_t				portLocationRx;
+	uint8_t				portLocationClk;
+	uint8_t				portLocationCs;
+	uint32_t			bitRate;
+	uint32_t			frameLength;
+	uint32_t			dummyTxValue;
+	SPIDRV_Type_t		type;
+	SPIDRV_BitOrder_t	bitOrder;
+	SPIDRV_ClockMode_t	clockMode;
+	SPIDRV_CsControl_t	csControl;
+	SPIDRV_SlaveStart_t slaveStartMode;
+} SPIDRV_Init_t;
+
+typedef struct SPIDRV_HandleData
+{
+	SPIDRV_Init_t initData;
+	int			  iInitialised;
+} SPIDRV_HandleData_t;
+
+typedef SPIDRV_HandleData_t *SPIDRV_Handle_t;
+
+typedef void ( *SPIDRV_Callback_t )( struct SPIDRV_HandleData *handle, Ecode_t transferStatus, int itemsTransferred );
+
+Ecode_t SPIDRV_Init( SPIDRV_Handle_t handle, SPIDRV_Init_t *initData );
+Ecode_t SPIDRV_DeInit( SPIDRV_Handle_t handle );
+Ecode_t SPIDRV_MTransmit( SPIDRV_Handle_t handle, const void *buffer, int count, SPIDRV_Callback_t callback );
+Ecode_t SPIDRV_MReceive( SPIDRV_Handle_t handle, void *buffer, int count, SPIDRV_Callback_t callback );
+Ecode_t SPIDRV_MTransfer( SPIDRV_Handle_t handle, const void *txBuffer, void *rxBuffer, int count, SPIDRV_Callback_t callback );
+
+#endif /* __CORE_CSIRO_HOST_SPIDRV_H__ */
@@ -0,0 +1,704 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host simulation of the nRF52 SPI and I2C transaction queues
+ * The SPIM model times transfers from the frequency register and serves two register mapped devices selected by their
+ * chip select, the TWIM model serves two devices at different maximum bus speeds and NACKs any other address.
+ * Blocking takes of a semaphore run the simulation until it is given, counting a task wake.
+ * The harness checks FIFO completion across devices, transactions queued from callbacks, the blocking API claiming
+ * and releasing the queue, lockout across nested claims and NACKed I2C transactions abandoning their operations.
+ * It reports the cost of register reads through the blocking API against the queue. Times are in ns.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "i2c.h"
+#include "spi.h"
+
+#define CS_A 10
+#define CS_B 11
+#define NUM_JOBS 256
+#define REGISTER_READS 1000
+#define ISR_LATENCY_NS 3000
+#define WAKE_LATENCY_NS 25000
+#define SPIM_START_NS 1000
+#define IDLE UINT64_MAX
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+int				iCriticalDepth;
+static bool		bInterrupt;
+static uint64_t ullNow;
+static uint32_t ulTaskWakes, ulInterrupts;
+
+static bool bSimStep( void );
+
+/* Kernel objects -------------------------------------------*/
+
+typedef struct xHostSemaphore_t
+{
+	int  iCount;
+	int  iRecursion;
+	bool bMutex;
+} xHostSemaphore_t;
+
+static xHostSemaphore_t pxSemaphores[8];
+static uint32_t			ulSemaphores;
+
+static xHostSemaphore_t *prvSemaphoreCreate( int iCount, bool bMutex )
+{
+	xHostSemaphore_t *pxSemaphore = &pxSemaphores[ulSemaphores++];
+
+	pxSemaphore->iCount		= iCount;
+	pxSemaphore->iRecursion = 0;
+	pxSemaphore->bMutex		= bMutex;
+	return pxSemaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic( StaticSemaphore_t *pxSemaphoreBuffer )
+{
+	return prvSemaphoreCreate( 0, false );
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic( StaticSemaphore_t *pxMutexBuffer )
+{
+	return prvSemaphoreCreate( 1, true );
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic( StaticSemaphore_t *pxMutexBuffer )
+{
+	return prvSemaphoreCreate( 0, true );
+}
+
+/* Nothing else runs on the host, so a take that would block runs the hardware until the semaphore is given */
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore, TickType_t xTicksToWait )
+{
+	xHostSemaphore_t *pxSemaphore = xSemaphore;
+
+	configASSERT( !bInterrupt && ( iCriticalDepth == 0 ) );
+	if ( pxSemaphore->bMutex ) {
+		configASSERT( pxSemaphore->iCount == 1 );
+		pxSemaphore->iCount = 0;
+		return pdPASS;
+	}
+	while ( pxSemaphore->iCount == 0 ) {
+		if ( !bSimStep() ) {
+			printf( "FAIL %d: blocked with the bus idle\n", __LINE__ );
+			exit( 1 );
+		}
+		if ( pxSemaphore->iCount != 0 ) {
+			ulTaskWakes++;
+			ullNow += WAKE_LATENCY_NS;
+		}
+	}
+	pxSemaphore->iCount = 0;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore )
+{
+	xHostSemaphore_t *pxSemaphore = xSemaphore;
+
+	configASSERT( pxSemaphore->bMutex && ( pxSemaphore->iCount == 0 ) );
+	pxSemaphore->iCount = 1;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveFromISR( SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken )
+{
+	xHostSemaphore_t *pxSemaphore = xSemaphore;
+
+	configASSERT( !pxSemaphore->bMutex );
+	pxSemaphore->iCount = 1;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t xMutex, TickType_t xTicksToWait )
+{
+	configASSERT( !bInterrupt );
+	( (xHostSemaphore_t *) xMutex )->iRecursion++;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t xMutex )
+{
+	configASSERT( ( (xHostSemaphore_t *) xMutex )->iRecursion > 0 );
+	( (xHostSemaphore_t *) xMutex )->iRecursion--;
+	return pdPASS;
+}
+
+TickType_t xTaskGetTickCount( void )
+{
+	return (TickType_t) ( ullNow / 1000000 );
+}
+
+void vInterruptSetPriority( int32_t IRQn, uint32_t ulPriority ) {}
+
+/* Chip selects ---------------------------------------------*/
+
+static int		piPinLevel[32];
+static uint32_t ulCsAsserts;
+
+void vGpioSetup( xGpio_t xGpio, eGpioType_t eType, uint32_t ulParam )
+{
+	int iLevel = ( eType == GPIO_PUSHPULL ) ? (int) ulParam : 1;
+
+	if ( ( xGpio.ucPin == CS_A ) || ( xGpio.ucPin == CS_B ) ) {
+		if ( piPinLevel[xGpio.ucPin] && !iLevel ) {
+			ulCsAsserts++;
+		}
+		piPinLevel[xGpio.ucPin] = iLevel;
+	}
+}
+
+/* SPIM model -----------------------------------------------*/
+
+typedef struct xSpiDevice_t
+{
+	uint8_t	 pucRegisters[256];
+	uint32_t ulFrequency;
+	int		 iMode;
+} xSpiDevice_t;
+
+NRF_SPIM_Type		pxHostSpim[2];
+static xSpiDevice_t xDeviceA = { .ulFrequency = 8000000, .iMode = 0 };
+static xSpiDevice_t xDeviceB = { .ulFrequency = 1000000, .iMode = 3 };
+static uint64_t		ullSpimDone = IDLE;
+
+void SPIM0_IRQHandler( void );
+
+void nrf_spim_pins_set( NRF_SPIM_Type *p_reg, uint32_t sck_pin, uint32_t mosi_pin, uint32_t miso_pin ) {}
+
+void nrf_spim_frequency_set( NRF_SPIM_Type *p_reg, nrf_spim_frequency_t frequency )
+{
+	configASSERT( !p_reg->bEnabled );
+	p_reg->ulFrequency = frequency;
+}
+
+void nrf_spim_configure( NRF_SPIM_Type *p_reg, nrf_spim_mode_t spi_mode, nrf_spim_bit_order_t spi_bit_order )
+{
+	configASSERT( !p_reg->bEnabled );
+	p_reg->iMode = spi_mode;
+}
+
+void nrf_spim_orc_set( NRF_SPIM_Type *p_reg, uint8_t orc )
+{
+	p_reg->ucOrc = orc;
+}
+
+void nrf_spim_int_enable( NRF_SPIM_Type *p_reg, uint32_t mask )
+{
+	p_reg->ulInten |= mask;
+}
+
+void nrf_spim_int_disable( NRF_SPIM_Type *p_reg, uint32_t mask )
+{
+	p_reg->ulInten &= ~mask;
+}
+
+void nrf_spim_enable( NRF_SPIM_Type *p_reg )
+{
+	p_reg->bEnabled = true;
+}
+
+void nrf_spim_disable( NRF_SPIM_Type *p_reg )
+{
+	configASSERT( ullSpimDone == IDLE );
+	p_reg->bEnabled = false;
+}
+
+void nrf_spim_tx_buffer_set( NRF_SPIM_Type *p_reg, const void *p_buffer, size_t length )
+{
+	p_reg->pucTx   = p_buffer;
+	p_reg->ulTxLen = length;
+}
+
+void nrf_spim_rx_buffer_set( NRF_SPIM_Type *p_reg, void *p_buffer, size_t length )
+{
+	p_reg->pucRx   = p_buffer;
+	p_reg->ulRxLen = length;
+}
+
+void nrf_spim_event_clear( NRF_SPIM_Type *p_reg, nrf_spim_event_t event )
+{
+	p_reg->bEventEnd = false;
+}
+
+void nrf_spim_task_trigger( NRF_SPIM_Type *p_reg, nrf_spim_task_t task )
+{
+	uint32_t ulBytes = MAX( p_reg->ulTxLen, p_reg->ulRxLen );
+
+	configASSERT( p_reg->bEnabled && ( ullSpimDone == IDLE ) );
+	ullSpimDone = ullNow + SPIM_START_NS + (uint64_t) ulBytes * 8 * 1000000000ULL / p_reg->ulFrequency;
+}
+
+/* Devices read from the address in the first byte when bit 7 is set, otherwise they write to it */
+static void prvSpimComplete( NRF_SPIM_Type *pxSpim )
+{
+	xSpiDevice_t *pxDevice;
+	uint32_t	  ulBytes = MAX( pxSpim->ulTxLen, pxSpim->ulRxLen );
+	uint8_t		  ucCommand, ucOut, ucIn;
+	uint32_t	  i;
+
+	CHECK( piPinLevel[CS_A] + piPinLevel[CS_B] == 1, "%d devices selected", 2 - piPinLevel[CS_A] - piPinLevel[CS_B] );
+	pxDevice = !piPinLevel[CS_A] ? &xDeviceA : &xDeviceB;
+	CHECK( ( pxSpim->ulFrequency == pxDevice->ulFrequency ) && ( pxSpim->iMode == pxDevice->iMode ), "device %c at %u Hz mode %d",
+		   ( pxDevice == &xDeviceA ) ? 'A' : 'B', pxSpim->ulFrequency, pxSpim->iMode );
+	ucCommand = pxSpim->ulTxLen ? pxSpim->pucTx[0] : pxSpim->ucOrc;
+	for ( i = 0; i < ulBytes; i++ ) {
+		ucOut = ( i < pxSpim->ulTxLen ) ? pxSpim->pucTx[i] : pxSpim->ucOrc;
+		ucIn  = 0xEE;
+		if ( i > 0 ) {
+			if ( ucCommand & 0x80 ) {
+				ucIn = pxDevice->pucRegisters[(uint8_t) ( ( ucCommand & 0x7F ) + i - 1 )];
+			}
+			else {
+				pxDevice->pucRegisters[(uint8_t) ( ucCommand + i - 1 )] = ucOut;
+			}
+		}
+		if ( i < pxSpim->ulRxLen ) {
+			pxSpim->pucRx[i] = ucIn;
+		}
+	}
+	pxSpim->bEventEnd = true;
+}
+
+/* TWIM model -----------------------------------------------*/
+
+typedef struct xI2CDevice_t
+{
+	uint8_t	 ucAddress;
+	uint8_t	 ucPointer;
+	uint8_t	 pucRegisters[256];
+	uint32_t ulMaxFrequency;
+} xI2CDevice_t;
+
+NRF_TWIM_Type		   pxHostTwim[2];
+static xI2CDevice_t	   pxI2CDevices[2] = { { .ucAddress = 0x29, .ulMaxFrequency = 400000 }, { .ucAddress = 0x69, .ulMaxFrequency = 100000 } };
+static nrfx_twim_evt_handler_t fnTwimHandler;
+static void *		   pvTwimContext;
+static bool			   bTwimInit, bTwimEnabled;
+static nrfx_twim_xfer_desc_t xTwimXfer;
+static uint64_t		   ullTwimDone = IDLE;
+static uint32_t		   ulTwimSequences;
+
+nrfx_err_t nrfx_twim_init( nrfx_twim_t const *p_instance, nrfx_twim_config_t const *p_config, nrfx_twim_evt_handler_t event_handler, void *p_context )
+{
+	if ( bTwimInit ) {
+		return NRFX_ERROR_BUSY;
+	}
+	if ( event_handler != NULL ) {
+		configASSERT( p_config->interrupt_priority == configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY );
+	}
+	bTwimInit						= true;
+	fnTwimHandler					= event_handler;
+	pvTwimContext					= p_context;
+	p_instance->p_twim->ulFrequency = p_config->frequency;
+	return NRFX_SUCCESS;
+}
+
+void nrfx_twim_uninit( nrfx_twim_t const *p_instance )
+{
+	configASSERT( bTwimInit && !bTwimEnabled );
+	bTwimInit = false;
+}
+
+void nrfx_twim_enable( nrfx_twim_t const *p_instance )
+{
+	configASSERT( bTwimInit );
+	bTwimEnabled = true;
+}
+
+void nrfx_twim_disable( nrfx_twim_t const *p_instance )
+{
+	configASSERT( ullTwimDone == IDLE );
+	bTwimEnabled = false;
+}
+
+void nrf_twim_frequency_set( NRF_TWIM_Type *p_reg, nrf_twim_frequency_t frequency )
+{
+	p_reg->ulFrequency = frequency;
+}
+
+bool nrfx_twim_is_busy( nrfx_twim_t const *p_instance )
+{
+	return false;
+}
+
+/* Devices write from the register pointer set by the first byte written, and read from it */
+static nrfx_twim_evt_type_t prvTwimRun( nrfx_twim_xfer_desc_t const *pxXfer )
+{
+	xI2CDevice_t *pxDevice = NULL;
+	uint8_t *	  pucTx = NULL, *pucRx = NULL;
+	size_t		  ulTxLen = 0, ulRxLen = 0, i;
+
+	ulTwimSequences++;
+	for ( i = 0; i < 2; i++ ) {
+		if ( pxI2CDevices[i].ucAddress == pxXfer->address ) {
+			pxDevice = &pxI2CDevices[i];
+		}
+	}
+	if ( pxDevice == NULL ) {
+		return NRFX_TWIM_EVT_ADDRESS_NACK;
+	}
+	CHECK( pxHostTwim[0].ulFrequency <= pxDevice->ulMaxFrequency, "%u Hz to a %u Hz device", pxHostTwim[0].ulFrequency, pxDevice->ulMaxFrequency );
+	if ( pxXfer->type == NRFX_TWIM_XFER_RX ) {
+		pucRx	= pxXfer->p_primary_buf;
+		ulRxLen = pxXfer->primary_length;
+	}
+	else {
+		pucTx	= pxXfer->p_primary_buf;
+		ulTxLen = pxXfer->primary_length;
+		if ( pxXfer->type == NRFX_TWIM_XFER_TXRX ) {
+			pucRx	= pxXfer->p_secondary_buf;
+			ulRxLen = pxXfer->secondary_length;
+		}
+	}
+	for ( i = 0; i < ulTxLen; i++ ) {
+		if ( i == 0 ) {
+			pxDevice->ucPointer = pucTx[0];
+		}
+		else {
+			pxDevice->pucRegisters[pxDevice->ucPointer++] = pucTx[i];
+		}
+	}
+	for ( i = 0; i < ulRxLen; i++ ) {
+		pucRx[i] = pxDevice->pucRegisters[pxDevice->ucPointer++];
+	}
+	return NRFX_TWIM_EVT_DONE;
+}
+
+/* Nine bit times per byte, including the address of each direction */
+static uint64_t prvTwimDuration( nrfx_twim_xfer_desc_t const *pxXfer )
+{
+	size_t ulBytes = 1 + pxXfer->primary_length;
+
+	if ( pxXfer->type == NRFX_TWIM_XFER_TXRX ) {
+		ulBytes += 1 + pxXfer->secondary_length;
+	}
+	return (uint64_t) ulBytes * 9 * 1000000000ULL / pxHostTwim[0].ulFrequency;
+}
+
+nrfx_err_t nrfx_twim_xfer( nrfx_twim_t const *p_instance, nrfx_twim_xfer_desc_t const *p_xfer_desc, uint32_t flags )
+{
+	configASSERT( bTwimEnabled && ( fnTwimHandler != NULL ) && ( ullTwimDone == IDLE ) );
+	xTwimXfer	= *p_xfer_desc;
+	ullTwimDone = ullNow + prvTwimDuration( p_xfer_desc );
+	return NRFX_SUCCESS;
+}
+
+/* Blocking transfers, without an event handler */
+nrfx_err_t nrfx_twim_tx( nrfx_twim_t const *p_instance, uint8_t address, uint8_t const *p_data, size_t length, bool no_stop )
+{
+	nrfx_twim_xfer_desc_t xXfer = { .type = NRFX_TWIM_XFER_TX, .address = address, .primary_length = length, .p_primary_buf = (uint8_t *) p_data };
+
+	configASSERT( bTwimEnabled && ( fnTwimHandler == NULL ) );
+	ullNow += prvTwimDuration( &xXfer );
+	return ( prvTwimRun( &xXfer ) == NRFX_TWIM_EVT_DONE ) ? NRFX_SUCCESS : NRFX_ERROR_DRV_TWI_ERR_ANACK;
+}
+
+nrfx_err_t nrfx_twim_rx( nrfx_twim_t const *p_instance, uint8_t address, uint8_t *p_data, size_t length )
+{
+	nrfx_twim_xfer_desc_t xXfer = { .type = NRFX_TWIM_XFER_RX, .address = address, .primary_length = length, .p_primary_buf = p_data };
+
+	configASSERT( bTwimEnabled && ( fnTwimHandler == NULL ) );
+	ullNow += prvTwimDuration( &xXfer );
+	return ( prvTwimRun( &xXfer ) == NRFX_TWIM_EVT_DONE ) ? NRFX_SUCCESS : NRFX_ERROR_DRV_TWI_ERR_ANACK;
+}
+
+/* Event loop -----------------------------------------------*/
+
+/* Completes the next transfer and runs its interrupt, false when both buses are idle */
+static bool bSimStep( void )
+{
+	nrfx_twim_evt_t xEvent;
+
+	if ( ( ullSpimDone == IDLE ) && ( ullTwimDone == IDLE ) ) {
+		return false;
+	}
+	if ( ullSpimDone <= ullTwimDone ) {
+		ullNow		= ullSpimDone;
+		ullSpimDone = IDLE;
+		prvSpimComplete( &pxHostSpim[0] );
+		if ( pxHostSpim[0].ulInten & NRF_SPIM_INT_END_MASK ) {
+			ullNow += ISR_LATENCY_NS;
+			ulInterrupts++;
+			bInterrupt = true;
+			SPIM0_IRQHandler();
+			bInterrupt = false;
+		}
+	}
+	else {
+		ullNow			  = ullTwimDone;
+		ullTwimDone		  = IDLE;
+		xEvent.type		  = prvTwimRun( &xTwimXfer );
+		xEvent.xfer_desc  = xTwimXfer;
+		ullNow += ISR_LATENCY_NS;
+		ulInterrupts++;
+		bInterrupt = true;
+		fnTwimHandler( &xEvent, pvTwimContext );
+		bInterrupt = false;
+	}
+	CHECK( iCriticalDepth == 0, "critical section depth %d after an interrupt", iCriticalDepth );
+	return true;
+}
+
+static void prvSimDrain( void )
+{
+	while ( bSimStep() ) {
+	}
+}
+
+/* Transactions ---------------------------------------------*/
+
+SPI_MODULE_CREATE( SPI0, 0, SPIM0_IRQHandler );
+I2C_MODULE_CREATE( I2C0, 0 );
+
+static xSpiModule_t *const pxSpi = &SPI_MODULE_GET( SPI0 );
+static xI2CModule_t *const pxI2C = &I2C_MODULE_GET( I2C0 );
+
+static xSpiConfig_t xConfigA	= { .xCsGpio = { CS_A }, .ulMaxBitrate = 8000000, .eClockMode = eSpiClockMode0, .ucDummyTx = 0xFF, .ucMsbFirst = 1 };
+static xSpiConfig_t xConfigB	= { .xCsGpio = { CS_B }, .ulMaxBitrate = 1000000, .eClockMode = eSpiClockMode3, .ucDummyTx = 0xFF, .ucMsbFirst = 1 };
+static xI2CConfig_t xConfigFast = { .ulMaximumBusFrequency = 400000, .ucAddress = 0x29 << 1 };
+static xI2CConfig_t xConfigSlow = { .ulMaximumBusFrequency = 100000, .ucAddress = 0x69 << 1 };
+static xI2CConfig_t xConfigNone = { .ulMaximumBusFrequency = 400000, .ucAddress = 0x40 << 1 };
+
+/* Write a value to a register, then read back from the same register */
+typedef struct xJob_t
+{
+	xBusTransaction_t xTransaction;
+	xBusOperation_t	  pxOperations[2];
+	uint8_t			  pucWrite[2];
+	uint8_t			  ucRead;
+	uint8_t			  pucRx[4];
+} xJob_t;
+
+static xJob_t			  pxJobs[NUM_JOBS];
+static xBusTransaction_t *pxDone[NUM_JOBS];
+static eModuleError_t	  peDoneResult[NUM_JOBS];
+static uint32_t			  ulDone;
+static uint32_t			  ulFollowUps;
+
+static void prvDone( xBusTransaction_t *pxTransaction, eModuleError_t eResult )
+{
+	CHECK( bInterrupt, "completed outside the interrupt" );
+	pxDone[ulDone]		 = pxTransaction;
+	peDoneResult[ulDone] = eResult;
+	ulDone++;
+}
+
+/* SPI reads return the command byte slot first, I2C reads only the data */
+static xBusTransaction_t *pxJob( uint32_t ulJob, const void *pvConfig, bool bSpi, uint8_t ucRegister, uint8_t ucValue, fnBusTransactionDone_t fnDone )
+{
+	xJob_t *pxJob = &pxJobs[ulJob];
+
+	memset( pxJob, 0x00, sizeof( xJob_t ) );
+	pxJob->pucWrite[0]	   = ucRegister;
+	pxJob->pucWrite[1]	   = ucValue;
+	pxJob->ucRead		   = bSpi ? ( 0x80 | ucRegister ) : ucRegister;
+	pxJob->pxOperations[0] = ( xBusOperation_t ){ .pvTx = pxJob->pucWrite, .usTxLen = 2 };
+	pxJob->pxOperations[1] = ( xBusOperation_t ){ .pvTx = &pxJob->ucRead, .usTxLen = 1, .pvRx = pxJob->pucRx, .usRxLen = bSpi ? 2 : 1 };
+	pxJob->xTransaction	   = ( xBusTransaction_t ){ .pvConfig = pvConfig, .pxOperations = pxJob->pxOperations, .ucNumOperations = 2, .fnDone = fnDone, .pvContext = pxJob };
+	return &pxJob->xTransaction;
+}
+
+static uint8_t prvJobRead( uint32_t ulJob, bool bSpi )
+{
+	return pxJobs[ulJob].pucRx[bSpi ? 1 : 0];
+}
+
+/* Queues the next transaction from the completion interrupt, alternating devices */
+static void prvFollowUp( xBusTransaction_t *pxTransaction, eModuleError_t eResult )
+{
+	prvDone( pxTransaction, eResult );
+	if ( ulFollowUps < 50 ) {
+		ulFollowUps++;
+		eSpiQueueTransaction( pxSpi, pxJob( 100 + ulFollowUps, ( ulFollowUps & 1 ) ? &xConfigB : &xConfigA, true, 0x20 + ulFollowUps, ulFollowUps, prvFollowUp ) );
+	}
+}
+
+static void prvReset( void )
+{
+	ulDone		 = 0;
+	ulTaskWakes	 = 0;
+	ulInterrupts = 0;
+	ulCsAsserts	 = 0;
+}
+
+static void prvCheckOrder( const char *pcName )
+{
+	uint32_t i;
+
+	for ( i = 0; i < ulDone; i++ ) {
+		CHECK( pxDone[i] == &pxJobs[i].xTransaction, "%s: completion %u out of order", pcName, i );
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSpiRegisterReads( void )
+{
+	static xBusOperation_t	 pxOperations[REGISTER_READS];
+	static xBusTransaction_t pxTransactions[REGISTER_READS];
+	static uint8_t			 pucRx[REGISTER_READS][7];
+	static uint8_t			 ucCommand = 0x80 | 0x02;
+	uint8_t					 pucData[6];
+	uint64_t				 ullStart, ullBlocking, ullQueued;
+	uint32_t				 ulBlockingWakes, i;
+
+	/* The blocking driver pattern, one task wake per access */
+	prvReset();
+	ullStart = ullNow;
+	for ( i = 0; i < REGISTER_READS; i++ ) {
+		eSpiBusStart( pxSpi, ( i & 1 ) ? &xConfigB : &xConfigA, portMAX_DELAY );
+		vSpiCsAssert( pxSpi );
+		vSpiTransmit( pxSpi, &ucCommand, 1 );
+		vSpiReceive( pxSpi, pucData, sizeof( pucData ) );
+		vSpiCsRelease( pxSpi );
+		vSpiBusEnd( pxSpi );
+	}
+	ullBlocking		= ullNow - ullStart;
+	ulBlockingWakes = ulTaskWakes;
+
+	prvReset();
+	ullStart = ullNow;
+	for ( i = 0; i < REGISTER_READS; i++ ) {
+		pxOperations[i]	  = ( xBusOperation_t ){ .pvTx = &ucCommand, .usTxLen = 1, .pvRx = pucRx[i], .usRxLen = 7 };
+		pxTransactions[i] = ( xBusTransaction_t ){ .pvConfig = ( i & 1 ) ? &xConfigB : &xConfigA, .pxOperations = &pxOperations[i], .ucNumOperations = 1 };
+		eSpiQueueTransaction( pxSpi, &pxTransactions[i] );
+	}
+	prvSimDrain();
+	ullQueued = ullNow - ullStart;
+	CHECK( ulTaskWakes == 0, "%u task wakes while queued", ulTaskWakes );
+	CHECK( pucRx[REGISTER_READS - 1][1] == xDeviceB.pucRegisters[2], "queued read" );
+	printf( "%u register reads on two devices: blocking %.2f ms (%u task wakes), queued %.2f ms (%u task wakes, %u interrupts)\n",
+			REGISTER_READS, ullBlocking / 1e6, ulBlockingWakes, ullQueued / 1e6, ulTaskWakes, ulInterrupts );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+	uint8_t		  pucCommand[2] = { 0x05, 0xAB };
+	uint8_t		  pucI2CCommand[2] = { 0x10, 0x77 };
+	xI2CConfig_t *pxConfig;
+	uint32_t	  i;
+
+	piPinLevel[CS_A]				 = 1;
+	piPinLevel[CS_B]				 = 1;
+	pxSpi->xPlatform.xMosi.ucPin	 = 1;
+	pxSpi->xPlatform.xMiso.ucPin	 = 2;
+	pxSpi->xPlatform.xSclk.ucPin	 = 3;
+	pxI2C->xPlatform.xSda.ucPin		 = 4;
+	pxI2C->xPlatform.xScl.ucPin		 = 5;
+	CHECK( eSpiInit( pxSpi ) == ERROR_NONE, "SPI init" );
+	CHECK( eI2CInit( pxI2C ) == ERROR_NONE, "I2C init" );
+
+	/* Transactions on two SPI devices complete in order from the interrupt, without waking a task */
+	prvReset();
+	for ( i = 0; i < 200; i++ ) {
+		CHECK( eSpiQueueTransaction( pxSpi, pxJob( i, ( i % 3 ) ? &xConfigA : &xConfigB, true, i & 0x3F, (uint8_t) ( i * 7 ), prvDone ) ) == ERROR_NONE, "queue %u", i );
+	}
+	prvSimDrain();
+	CHECK( ulDone == 200, "%u of 200 completed", ulDone );
+	prvCheckOrder( "SPI queue" );
+	for ( i = 0; i < ulDone; i++ ) {
+		CHECK( ( peDoneResult[i] == ERROR_NONE ) && ( prvJobRead( i, true ) == (uint8_t) ( i * 7 ) ), "job %u read %02X", i, prvJobRead( i, true ) );
+	}
+	CHECK( ( ulTaskWakes == 0 ) && ( ulCsAsserts == 400 ) && ( ulInterrupts == 400 ), "%u task wakes, %u chip selects, %u interrupts", ulTaskWakes, ulCsAsserts, ulInterrupts );
+	CHECK( !pxHostSpim[0].bEnabled && !pxSpi->xQueue.bActive && piPinLevel[CS_A] && piPinLevel[CS_B], "SPI not idle after the queue" );
+
+	/* Callbacks queue transactions from the interrupt */
+	prvReset();
+	ulFollowUps = 0;
+	eSpiQueueTransaction( pxSpi, pxJob( 100, &xConfigA, true, 0x20, 0, prvFollowUp ) );
+	prvSimDrain();
+	CHECK( ( ulDone == 51 ) && ( ulTaskWakes == 0 ) && !pxHostSpim[0].bEnabled, "%u follow ups completed", ulDone );
+	CHECK( ( xDeviceB.pucRegisters[0x20 + 49] == 49 ) && ( xDeviceA.pucRegisters[0x20 + 50] == 50 ), "follow up writes" );
+
+	/* The blocking API claims the queue after the transaction in progress, the rest resume on release */
+	prvReset();
+	for ( i = 0; i < 3; i++ ) {
+		eSpiQueueTransaction( pxSpi, pxJob( i, &xConfigA, true, 0x40 + i, 0x11 * ( i + 1 ), prvDone ) );
+	}
+	CHECK( eSpiBusStart( pxSpi, &xConfigB, portMAX_DELAY ) == ERROR_NONE, "claim" );
+	CHECK( ( ulDone == 1 ) && !pxSpi->xQueue.bActive, "claim waited for %u transactions", ulDone );
+	vSpiCsAssert( pxSpi );
+	vSpiTransmit( pxSpi, pucCommand, 2 );
+	vSpiCsRelease( pxSpi );
+	CHECK( ( xDeviceB.pucRegisters[5] == 0xAB ) && ( ulDone == 1 ), "blocking write while claimed" );
+	eSpiQueueTransaction( pxSpi, pxJob( 3, &xConfigB, true, 0x50, 0x99, prvDone ) );
+	CHECK( !pxSpi->xQueue.bActive, "transaction started while claimed" );
+	vSpiBusEnd( pxSpi );
+	CHECK( pxSpi->xQueue.bActive, "queue not resumed on release" );
+	prvSimDrain();
+	CHECK( ( ulDone == 4 ) && ( xDeviceB.pucRegisters[0x50] == 0x99 ) && ( xDeviceA.pucRegisters[0x42] == 0x33 ), "%u completed after release", ulDone );
+	prvCheckOrder( "claim and release" );
+
+	/* Lockout holds the queue across nested claims */
+	prvReset();
+	eSpiBusLockout( pxSpi, true, portMAX_DELAY );
+	eSpiQueueTransaction( pxSpi, pxJob( 0, &xConfigA, true, 0x60, 0x01, prvDone ) );
+	eSpiBusStart( pxSpi, &xConfigA, portMAX_DELAY );
+	vSpiCsAssert( pxSpi );
+	vSpiTransmit( pxSpi, pucCommand, 2 );
+	vSpiCsRelease( pxSpi );
+	vSpiBusEnd( pxSpi );
+	CHECK( !pxSpi->xQueue.bActive && ( ulDone == 0 ), "queue resumed inside the lockout" );
+	eSpiBusLockout( pxSpi, false, portMAX_DELAY );
+	prvSimDrain();
+	CHECK( ( ulDone == 1 ) && ( xDeviceA.pucRegisters[0x60] == 0x01 ), "queue not resumed after the lockout" );
+
+	/* I2C devices at different bus speeds and an absent device, each write then read is one sequence */
+	prvReset();
+	ulTwimSequences = 0;
+	for ( i = 0; i < 30; i++ ) {
+		pxConfig = ( i % 5 == 4 ) ? &xConfigNone : ( i & 1 ) ? &xConfigSlow : &xConfigFast;
+		CHECK( eI2CQueueTransaction( pxI2C, pxJob( i, pxConfig, false, i, (uint8_t) ( 0xA0 + i ), prvDone ) ) == ERROR_NONE, "queue %u", i );
+	}
+	prvSimDrain();
+	CHECK( ( ulDone == 30 ) && ( ulTaskWakes == 0 ) && !bTwimInit, "%u of 30 completed", ulDone );
+	prvCheckOrder( "I2C queue" );
+	for ( i = 0; i < ulDone; i++ ) {
+		if ( i % 5 == 4 ) {
+			CHECK( ( peDoneResult[i] == ERROR_NO_ACKNOWLEDGEMENT ) && ( pxJobs[i].xTransaction.ucOperation == 1 ), "NACK of job %u", i );
+		}
+		else {
+			CHECK( ( peDoneResult[i] == ERROR_NONE ) && ( prvJobRead( i, false ) == (uint8_t) ( 0xA0 + i ) ), "job %u read %02X", i, prvJobRead( i, false ) );
+		}
+	}
+	/* A NACKed transaction abandons its second operation */
+	CHECK( ulTwimSequences == 24 * 2 + 6, "%u TWIM sequences", ulTwimSequences );
+
+	/* The blocking I2C API interleaves with the queue */
+	prvReset();
+	for ( i = 0; i < 3; i++ ) {
+		eI2CQueueTransaction( pxI2C, pxJob( i, &xConfigFast, false, 0x80 + i, i, prvDone ) );
+	}
+	CHECK( eI2CBusStart( pxI2C, &xConfigSlow, portMAX_DELAY ) == ERROR_NONE, "claim" );
+	CHECK( ( ulDone == 1 ) && bTwimInit && ( fnTwimHandler == NULL ), "claim waited for %u transactions", ulDone );
+	CHECK( eI2CTransmit( pxI2C, pucI2CCommand, 2, 10 ) == ERROR_NONE, "blocking write" );
+	eI2CBusEnd( pxI2C );
+	prvSimDrain();
+	CHECK( ( ulDone == 3 ) && ( pxI2CDevices[1].pucRegisters[0x10] == 0x77 ) && ( pxI2CDevices[0].pucRegisters[0x82] == 2 ) && !bTwimInit, "%u completed after release", ulDone );
+	prvCheckOrder( "I2C claim and release" );
+
+	prvSpiRegisterReads();
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,37 @@
+/*
+ * Host model of the nRF52 interrupt controller, interrupts are run by the harness
+ * Critical sections are counted so that the harness can check they are balanced and never block
+ */
+#ifndef __CORE_CSIRO_HOST_CPU_ARCH_H__
+#define __CORE_CSIRO_HOST_CPU_ARCH_H__
+
+#include <stdint.h>
+
+typedef int32_t IRQn_Type;
+
+/* From FreeRTOSConfig.h */
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY 5
+
+extern int iCriticalDepth;
+
+#undef CRITICAL_SECTION_DECLARE
+#undef CRITICAL_SECTION_START
+#undef CRITICAL_SECTION_STOP
+#define CRITICAL_SECTION_DECLARE uint8_t irqState = 0
+#define CRITICAL_SECTION_START() \
+	do {                         \
+		(void) irqState;         \
+		iCriticalDepth++;        \
+	} while ( 0 )
+#define CRITICAL_SECTION_STOP() iCriticalDepth--
+
+static inline void NVIC_ClearPendingIRQ( IRQn_Type IRQn ) {}
+static inline void NVIC_EnableIRQ( IRQn_Type IRQn ) {}
+static inline void NVIC_DisableIRQ( IRQn_Type IRQn ) {}
+
+static inline uint32_t ulCpuClockFreq( void )
+{
+	return 64000000;
+}
+
+#endif /* __CORE_CSIRO_HOST_CPU_ARCH_H__ */
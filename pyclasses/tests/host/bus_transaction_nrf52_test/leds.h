@@ -0,0 +1 @@
+/* Host stub, the SPI driver does not use the LEDs */
@@ -0,0 +1,2 @@
+/* Host stub, pins are configured through vGpioSetup */
+#include <stdint.h>
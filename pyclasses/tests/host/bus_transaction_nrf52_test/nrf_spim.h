@@ -0,0 +1,65 @@
+/*
+ * Host model of the SPIM registers, the harness implements the HAL functions
+ */
+#ifndef __CORE_CSIRO_HOST_NRF_SPIM_H__
+#define __CORE_CSIRO_HOST_NRF_SPIM_H__
+
+#include <stddef.h>
+
+#include "nrfx_common.h"
+
+typedef struct
+{
+	bool		   bEnabled;
+	uint32_t	   ulInten;
+	bool		   bEventEnd;
+	const uint8_t *pucTx;
+	uint32_t	   ulTxLen;
+	uint8_t *	   pucRx;
+	uint32_t	   ulRxLen;
+	uint32_t	   ulFrequency;
+	int			   iMode;
+	uint8_t		   ucOrc;
+} NRF_SPIM_Type;
+
+typedef int		 nrf_spim_mode_t;
+typedef uint32_t nrf_spim_frequency_t;
+typedef int		 nrf_spim_bit_order_t;
+typedef int		 nrf_spim_event_t;
+typedef int		 nrf_spim_task_t;
+
+enum { NRF_SPIM_MODE_0,
+	   NRF_SPIM_MODE_1,
+	   NRF_SPIM_MODE_2,
+	   NRF_SPIM_MODE_3 };
+enum { NRF_SPIM_BIT_ORDER_MSB_FIRST,
+	   NRF_SPIM_BIT_ORDER_LSB_FIRST };
+
+/* Frequencies are in Hz, so the model can time transfers from the register */
+#define SPIM_FREQUENCY_FREQUENCY_M8 8000000
+#define SPIM_FREQUENCY_FREQUENCY_M4 4000000
+#define SPIM_FREQUENCY_FREQUENCY_M2 2000000
+#define SPIM_FREQUENCY_FREQUENCY_M1 1000000
+#define SPIM_FREQUENCY_FREQUENCY_K500 500000
+#define SPIM_FREQUENCY_FREQUENCY_K250 250000
+#define SPIM_FREQUENCY_FREQUENCY_K125 125000
+
+#define NRF_SPIM_INT_END_MASK 0x01
+#define NRF_SPIM_ALL_INTS_MASK 0xFFFFFFFF
+#define NRF_SPIM_EVENT_END 0
+#define NRF_SPIM_TASK_START 0
+
+void nrf_spim_pins_set( NRF_SPIM_Type *p_reg, uint32_t sck_pin, uint32_t mosi_pin, uint32_t miso_pin );
+void nrf_spim_frequency_set( NRF_SPIM_Type *p_reg, nrf_spim_frequency_t frequency );
+void nrf_spim_configure( NRF_SPIM_Type *p_reg, nrf_spim_mode_t spi_mode, nrf_spim_bit_order_t spi_bit_order );
+void nrf_spim_orc_set( NRF_SPIM_Type *p_reg, uint8_t orc );
+void nrf_spim_int_enable( NRF_SPIM_Type *p_reg, uint32_t mask );
+void nrf_spim_int_disable( NRF_SPIM_Type *p_reg, uint32_t mask );
+void nrf_spim_enable( NRF_SPIM_Type *p_reg );
+void nrf_spim_disable( NRF_SPIM_Type *p_reg );
+void nrf_spim_tx_buffer_set( NRF_SPIM_Type *p_reg, const void *p_buffer, size_t length );
+void nrf_spim_rx_buffer_set( NRF_SPIM_Type *p_reg, void *p_buffer, size_t length );
+void nrf_spim_event_clear( NRF_SPIM_Type *p_reg, nrf_spim_event_t event );
+void nrf_spim_task_trigger( NRF_SPIM_Type *p_reg, nrf_spim_task_t task );
+
+#endif /* __CORE_CSIRO_HOST_NRF_SPIM_H__ */
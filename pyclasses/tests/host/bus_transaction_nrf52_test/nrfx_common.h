@@ -0,0 +1,23 @@
+/*
+ * Host stub of the nrfx common helpers
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_COMMON_H__
+#define __CORE_CSIRO_HOST_NRFX_COMMON_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* On target cpu.h is included through FreeRTOSConfig.h */
+#include "cpu.h"
+
+static inline bool nrfx_is_in_ram( const void *p_object )
+{
+	return p_object != NULL;
+}
+
+static inline IRQn_Type nrfx_get_irq_number( const void *p_reg )
+{
+	return 3;
+}
+
+#endif /* __CORE_CSIRO_HOST_NRFX_COMMON_H__ */
@@ -0,0 +1,14 @@
+/*
+ * Host stub of the nrfx error codes used by the bus drivers
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_ERRORS_H__
+#define __CORE_CSIRO_HOST_NRFX_ERRORS_H__
+
+typedef int nrfx_err_t;
+
+#define NRFX_SUCCESS 0
+#define NRFX_ERROR_BUSY 1
+#define NRFX_ERROR_TIMEOUT 2
+#define NRFX_ERROR_DRV_TWI_ERR_ANACK 3
+
+#endif /* __CORE_CSIRO_HOST_NRFX_ERRORS_H__ */
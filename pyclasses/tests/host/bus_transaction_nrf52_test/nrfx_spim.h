@@ -0,0 +1,24 @@
+/*
+ * Host stub of the nrfx SPIM driver types, instances map to the harness register models
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_SPIM_H__
+#define __CORE_CSIRO_HOST_NRFX_SPIM_H__
+
+#include "nrf_spim.h"
+
+typedef void ( *nrfx_spim_evt_handler_t )( void const *p_event, void *p_context );
+
+typedef struct
+{
+	NRF_SPIM_Type *p_reg;
+	uint8_t		   drv_inst_idx;
+} nrfx_spim_t;
+
+extern NRF_SPIM_Type pxHostSpim[2];
+
+#define NRFX_SPIM_INSTANCE( id )                      \
+	{                                                 \
+		.p_reg = &pxHostSpim[id], .drv_inst_idx = id \
+	}
+
+#endif /* __CORE_CSIRO_HOST_NRFX_SPIM_H__ */
@@ -0,0 +1,93 @@
+/*
+ * Host stub of the nrfx TWIM driver, the harness implements the driver functions
+ * Frequencies are in Hz, so the model can time transfers from the configuration
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_TWIM_H__
+#define __CORE_CSIRO_HOST_NRFX_TWIM_H__
+
+#include <stddef.h>
+
+#include "nrfx_common.h"
+#include "nrfx_errors.h"
+
+typedef struct
+{
+	uint32_t ulFrequency;
+} NRF_TWIM_Type;
+
+typedef struct
+{
+	NRF_TWIM_Type *p_twim;
+	uint8_t		   drv_inst_idx;
+} nrfx_twim_t;
+
+extern NRF_TWIM_Type pxHostTwim[2];
+
+/* Driver indices 0 and 1 apply the errata 89 workaround to fixed register addresses */
+#define NRFX_TWIM_INSTANCE( id )                           \
+	{                                                      \
+		.p_twim = &pxHostTwim[id], .drv_inst_idx = id + 2 \
+	}
+
+typedef uint32_t nrf_twim_frequency_t;
+
+#define NRF_TWIM_FREQ_100K 100000
+#define NRF_TWIM_FREQ_250K 250000
+#define NRF_TWIM_FREQ_400K 400000
+
+typedef struct
+{
+	uint32_t			 scl;
+	uint32_t			 sda;
+	nrf_twim_frequency_t frequency;
+	uint8_t				 interrupt_priority;
+	bool				 hold_bus_uninit;
+} nrfx_twim_config_t;
+
+#define NRFX_TWIM_DEFAULT_CONFIG                                                                           \
+	{                                                                                                      \
+		.scl = 31, .sda = 31, .frequency = NRF_TWIM_FREQ_100K, .interrupt_priority = 7, .hold_bus_uninit = 0 \
+	}
+
+typedef enum {
+	NRFX_TWIM_XFER_TX,
+	NRFX_TWIM_XFER_RX,
+	NRFX_TWIM_XFER_TXRX,
+	NRFX_TWIM_XFER_TXTX
+} nrfx_twim_xfer_type_t;
+
+typedef struct
+{
+	nrfx_twim_xfer_type_t type;
+	uint8_t				  address;
+	size_t				  primary_length;
+	size_t				  secondary_length;
+	uint8_t *			  p_primary_buf;
+	uint8_t *			  p_secondary_buf;
+} nrfx_twim_xfer_desc_t;
+
+typedef enum {
+	NRFX_TWIM_EVT_DONE,
+	NRFX_TWIM_EVT_ADDRESS_NACK,
+	NRFX_TWIM_EVT_DATA_NACK
+} nrfx_twim_evt_type_t;
+
+typedef struct
+{
+	nrfx_twim_evt_type_t  type;
+	nrfx_twim_xfer_desc_t xfer_desc;
+} nrfx_twim_evt_t;
+
+typedef void ( *nrfx_twim_evt_handler_t )( nrfx_twim_evt_t const *p_event, void *p_context );
+
+nrfx_err_t nrfx_twim_init( nrfx_twim_t const *p_instance, nrfx_twim_config_t const *p_config, nrfx_twim_evt_handler_t event_handler, void *p_context );
+void	   nrfx_twim_uninit( nrfx_twim_t const *p_instance );
+void	   nrfx_twim_enable( nrfx_twim_t const *p_instance );
+void	   nrfx_twim_disable( nrfx_twim_t const *p_instance );
+nrfx_err_t nrfx_twim_xfer( nrfx_twim_t const *p_instance, nrfx_twim_xfer_desc_t const *p_xfer_desc, uint32_t flags );
+nrfx_err_t nrfx_twim_tx( nrfx_twim_t const *p_instance, uint8_t address, uint8_t const *p_data, size_t length, bool no_stop );
+nrfx_err_t nrfx_twim_rx( nrfx_twim_t const *p_instance, uint8_t address, uint8_t *p_data, size_t length );
+bool	   nrfx_twim_is_busy( nrfx_twim_t const *p_instance );
+void	   nrf_twim_frequency_set( NRF_TWIM_Type *p_reg, nrf_twim_frequency_t frequency );
+
+#endif /* __CORE_CSIRO_HOST_NRFX_TWIM_H__ */
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the crash dump record across a simulated reset
+ * A stack overflow followed by the assertion from the debug build overflow hook must keep the overflow record, the record
+ * must be reported once after the reset with a valid CRC, and a failure after the reset must be recorded again.
+ * The record is logged through eTdfAddMulti and the TDF_CRASH_DUMP_DATA chunks reassembled into the original record.
+ * crash_dump.c is included directly so the boot state can be reset, RAM is a static array bounded by __StackTop.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+
+#define portSET_INTERRUPT_MASK_FROM_ISR() 0
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR( x ) (void) ( x )
+
+#include "crash_dump.c"
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+uint32_t __reserved_ram_start__[256];
+__asm__( ".globl __StackTop\n.set __StackTop, __reserved_ram_start__ + 1024\n" );
+
+static uint8_t pucReassembled[sizeof( xCrashDump_t ) + CRASH_DUMP_CHUNK];
+static int	 iSummaries, iChunks;
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+	return (TaskHandle_t) 1;
+}
+
+char *pcTaskGetName( TaskHandle_t xTask )
+{
+	return "VeryLongTaskName";
+}
+
+TickType_t xTaskGetTickCount( void )
+{
+	return 10 * configTICK_RATE_HZ;
+}
+
+eModuleError_t eTdfAddMulti( uint8_t ucLoggerMask, eTdfIds_t eTdfId, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, void *pvTdfData )
+{
+	tdf_crash_dump_data_t *pxData = pvTdfData;
+
+	if ( eTdfId == TDF_CRASH_DUMP ) {
+		iSummaries++;
+		CHECK( ( (tdf_crash_dump_t *) pvTdfData )->uptime == 10, "uptime %u", ( (tdf_crash_dump_t *) pvTdfData )->uptime );
+	}
+	else if ( eTdfId == TDF_CRASH_DUMP_DATA ) {
+		CHECK( pxData->offset == iChunks * CRASH_DUMP_CHUNK, "chunk %d at offset %u", iChunks, pxData->offset );
+		memcpy( &pucReassembled[pxData->offset], pxData->data, CRASH_DUMP_CHUNK );
+		iChunks++;
+	}
+	return ERROR_NONE;
+}
+
+/* Module state that does not survive a reset, the record itself is in .noinit */
+static void prvReset( void )
+{
+	pxPreviousDump	   = NULL;
+	bChecked		   = false;
+	bRecorded		   = false;
+	ulLogEventsWritten = 0;
+}
+
+int main( void )
+{
+	static const char *pcFormats[] = { "first %d", "second %d", "third %d" };
+	xCrashDump_t *	   pxRecord;
+	int				   i;
+
+	/* Nothing is reported from uninitialised RAM */
+	memset( &xCrashDump, 0x5A, sizeof( xCrashDump ) );
+	prvReset();
+	CHECK( pxCrashDumpRecord() == NULL, "garbage accepted" );
+
+	/* Stack overflow, then the debug build hook asserts */
+	prvReset();
+	for ( i = 0; i < 11; i++ ) {
+		vCrashDumpLogEvent( pcFormats[i % 3] );
+	}
+	vCrashDumpSoftware( CRASH_DUMP_STACK_OVERFLOW, NULL, 0, 0, 0 );
+	vCrashDumpSoftware( CRASH_DUMP_ASSERTION, "/src/core_csiro/arch/common/FreeRTOS/src/rtos_hooks.c", 55, 0x8100, 0x8200 );
+	CHECK( pxCrashDumpCurrent()->ucType == CRASH_DUMP_STACK_OVERFLOW, "overflow record replaced by type %02X", pxCrashDumpCurrent()->ucType );
+	CHECK( pxCrashDumpCurrent()->ulLine == 0 && pxCrashDumpCurrent()->pcFile[0] == '\0', "assertion location in the overflow record" );
+	CHECK( pxCrashDumpCurrent()->ucLogEvents == CRASH_DUMP_LOG_EVENTS, "%u log events", pxCrashDumpCurrent()->ucLogEvents );
+	CHECK( pxCrashDumpCurrent()->pxLog[CRASH_DUMP_LOG_EVENTS - 1].ulFormat == (uint32_t) (uintptr_t) pcFormats[10 % 3], "latest log event not last" );
+	CHECK( strcmp( pxCrashDumpCurrent()->pcTaskName, "VeryLongTas" ) == 0, "task '%s'", pxCrashDumpCurrent()->pcTaskName );
+
+	/* Reported once after the reset */
+	prvReset();
+	pxRecord = pxCrashDumpRecord();
+	CHECK( pxRecord != NULL && pxRecord->ucType == CRASH_DUMP_STACK_OVERFLOW, "overflow record not reported" );
+	CHECK( pxCrashDumpRecord() == pxRecord, "second call differs" );
+	if ( pxRecord != NULL ) {
+		CHECK( eCrashDumpLog( 0x01, TDF_TIMESTAMP_NONE, NULL, pxRecord ) == ERROR_NONE, "log" );
+		CHECK( iSummaries == 1 && iChunks == ( sizeof( xCrashDump_t ) + CRASH_DUMP_CHUNK - 1 ) / CRASH_DUMP_CHUNK, "%d summaries, %d chunks", iSummaries, iChunks );
+		CHECK( memcmp( pucReassembled + sizeof( uint32_t ), (uint8_t *) pxRecord + sizeof( uint32_t ), sizeof( xCrashDump_t ) - sizeof( uint32_t ) ) == 0, "chunks differ from the record" );
+	}
+	prvReset();
+	CHECK( pxCrashDumpRecord() == NULL, "record reported after a second reset" );
+
+	/* A failure after the reset is recorded, the file is truncated from the start */
+	vCrashDumpSoftware( CRASH_DUMP_ASSERTION, "/src/core_csiro/arch/common/FreeRTOS/src/rtos_hooks.c", 55, 0x8100, 0x8200 );
+	CHECK( pxCrashDumpCurrent()->ucType == CRASH_DUMP_ASSERTION, "assertion not recorded after reset" );
+	CHECK( strcmp( pxCrashDumpCurrent()->pcFile, "eeRTOS/src/rtos_hooks.c" ) == 0, "file '%s'", pxCrashDumpCurrent()->pcFile );
+	CHECK( pxCrashDumpCurrent()->pulRegisters[CRASH_DUMP_PC] == 0x8100 && pxCrashDumpCurrent()->pulRegisters[CRASH_DUMP_LR] == 0x8200, "PC and LR" );
+	prvReset();
+	CHECK( pxCrashDumpRecord() != NULL, "assertion record not reported" );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
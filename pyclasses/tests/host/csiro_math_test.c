@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the csiro_math square roots and bin lookups, with timings
+ *
+ * Both square roots are checked against the original bit-by-bit implementation for every
+ * 32 bit input, and the reference itself is checked against the running integer root.
+ * The binary search bin lookups are checked against the original linear scans on random
+ * sorted tables, duplicate bins included.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "csiro_math.h"
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+/* The implementations replaced by the table seeded Newton iteration and binary searches */
+static uint32_t prvSquareRootBitwise( uint32_t ulInput )
+{
+	uint32_t op  = ulInput;
+	uint32_t res = 0;
+	uint32_t one = 1uL << 30;
+	while ( one > op ) {
+		one >>= 2;
+	}
+	while ( one != 0 ) {
+		if ( op >= res + one ) {
+			op  = op - ( res + one );
+			res = res + 2 * one;
+		}
+		res >>= 1;
+		one >>= 2;
+	}
+	return res;
+}
+
+static uint8_t prvBinIndexByteLinear( uint8_t ucValue, const uint8_t *pucBins, uint8_t ucNumBins )
+{
+	uint8_t ucBin;
+	for ( ucBin = 0; ucBin < ucNumBins; ucBin++ ) {
+		if ( ucValue < pucBins[ucBin] ) {
+			break;
+		}
+	}
+	return ucBin;
+}
+
+static uint8_t prvBinIndexLongLinear( uint32_t ulValue, const uint32_t *pulBins, uint8_t ucNumBins )
+{
+	uint8_t ucBin;
+	for ( ucBin = 0; ucBin < ucNumBins; ucBin++ ) {
+		if ( ulValue < pulBins[ucBin] ) {
+			break;
+		}
+	}
+	return ucBin;
+}
+
+static int prvCompareByte( const void *a, const void *b )
+{
+	return *(const uint8_t *) a - *(const uint8_t *) b;
+}
+
+static int prvCompareLong( const void *a, const void *b )
+{
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+	return ( x > y ) - ( x < y );
+}
+
+static uint32_t prvRandom( void )
+{
+	return ( (uint32_t) rand() << 16 ) ^ (uint32_t) rand();
+}
+
+static double prvSeconds( void )
+{
+	struct timespec xNow;
+	clock_gettime( CLOCK_MONOTONIC, &xNow );
+	return xNow.tv_sec + xNow.tv_nsec * 1e-9;
+}
+
+/*-----------------------------------------------------------*/
+
+#define TIMING_INPUTS 4096
+
+static uint32_t pulInputs[TIMING_INPUTS];
+static uint8_t  pucBins[255];
+static uint32_t pulBins[255];
+
+typedef uint32_t ( *fnSqrt_t )( uint32_t ulInput );
+typedef uint8_t ( *fnBinLong_t )( uint32_t ulValue, const uint32_t *pulBins, uint8_t ucNumBins );
+
+/* Best of 3 runs, the sum keeps the calls from being discarded */
+__attribute__( ( noinline, no_sanitize_address ) ) static double prvTimeSqrt( fnSqrt_t fnSqrt )
+{
+	volatile uint32_t ulSink = 0;
+	double			  dBest	 = 1e9;
+	int				  iRun, iRepeat, i;
+
+	for ( iRun = 0; iRun < 3; iRun++ ) {
+		double	 dStart = prvSeconds();
+		uint32_t ulSum	= 0;
+		for ( iRepeat = 0; iRepeat < 250; iRepeat++ ) {
+			for ( i = 0; i < TIMING_INPUTS; i++ ) {
+				ulSum += fnSqrt( pulInputs[i] );
+			}
+		}
+		double dElapsed = prvSeconds() - dStart;
+		ulSink += ulSum;
+		dBest = dElapsed < dBest ? dElapsed : dBest;
+	}
+	return 1e9 * dBest / ( 250.0 * TIMING_INPUTS );
+}
+
+__attribute__( ( noinline, no_sanitize_address ) ) static double prvTimeBins( fnBinLong_t fnBin, uint8_t ucNumBins )
+{
+	volatile uint32_t ulSink = 0;
+	double			  dBest	 = 1e9;
+	int				  iRun, iRepeat, i;
+
+	for ( iRun = 0; iRun < 3; iRun++ ) {
+		double	 dStart = prvSeconds();
+		uint32_t ulSum	= 0;
+		for ( iRepeat = 0; iRepeat < 250; iRepeat++ ) {
+			for ( i = 0; i < TIMING_INPUTS; i++ ) {
+				ulSum += fnBin( pulInputs[i], pulBins, ucNumBins );
+			}
+		}
+		double dElapsed = prvSeconds() - dStart;
+		ulSink += ulSum;
+		dBest = dElapsed < dBest ? dElapsed : dBest;
+	}
+	return 1e9 * dBest / ( 250.0 * TIMING_INPUTS );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+	uint32_t ulInput = 0, ulRoot = 0, ulReference;
+	uint32_t ulSqrtErrors = 0, ulNewtonErrors = 0, ulReferenceErrors = 0;
+	int		 iTable, iNum, i;
+
+	/* Every 32 bit input, ulRoot tracks floor( sqrt( ulInput ) ) as the input increases */
+	do {
+		if ( ( (uint64_t) ( ulRoot + 1 ) * ( ulRoot + 1 ) ) <= ulInput ) {
+			ulRoot++;
+		}
+		ulReference = prvSquareRootBitwise( ulInput );
+		if ( ulReference != ulRoot ) {
+			if ( ulReferenceErrors++ == 0 ) {
+				CHECK( 0, "reference sqrt( %u ) = %u, expected %u", ulInput, ulReference, ulRoot );
+			}
+		}
+		if ( ulSquareRoot( ulInput ) != ulReference ) {
+			if ( ulSqrtErrors++ == 0 ) {
+				CHECK( 0, "ulSquareRoot( %u ) = %u, expected %u", ulInput, ulSquareRoot( ulInput ), ulReference );
+			}
+		}
+		if ( ulSquareRootNewton( ulInput ) != ulReference ) {
+			if ( ulNewtonErrors++ == 0 ) {
+				CHECK( 0, "ulSquareRootNewton( %u ) = %u, expected %u", ulInput, ulSquareRootNewton( ulInput ), ulReference );
+			}
+		}
+	} while ( ++ulInput != 0 );
+	CHECK( ulReferenceErrors == 0 && ulSqrtErrors == 0 && ulNewtonErrors == 0, "square root mismatches: reference %u, table %u, newton %u",
+		   ulReferenceErrors, ulSqrtErrors, ulNewtonErrors );
+
+	/* Random sorted tables of every length, values drawn from a small range so duplicates are common */
+	srand( 1 );
+	for ( iTable = 0; iTable < 20000; iTable++ ) {
+		uint8_t	 ucNumBins = iTable % 256;
+		uint32_t ulRange   = ( iTable & 1 ) ? 64 : UINT32_MAX;
+		for ( i = 0; i < ucNumBins; i++ ) {
+			pucBins[i] = (uint8_t) ( prvRandom() % ( ulRange < 256 ? ulRange : 256 ) );
+			pulBins[i] = prvRandom() % ulRange;
+		}
+		qsort( pucBins, ucNumBins, sizeof( uint8_t ), prvCompareByte );
+		qsort( pulBins, ucNumBins, sizeof( uint32_t ), prvCompareLong );
+		for ( i = 0; i < 256; i++ ) {
+			uint8_t ucExpected = prvBinIndexByteLinear( (uint8_t) i, pucBins, ucNumBins );
+			uint8_t ucActual   = ucBinIndexByte( (uint8_t) i, pucBins, ucNumBins );
+			if ( ucActual != ucExpected ) {
+				CHECK( 0, "table %d: ucBinIndexByte( %d ) = %d, expected %d", iTable, i, ucActual, ucExpected );
+				break;
+			}
+		}
+		for ( i = 0; i < 64 + ucNumBins; i++ ) {
+			/* Values on, either side of, and between the bin edges */
+			uint32_t ulValue	= ( i < ucNumBins ) ? pulBins[i] + ( i % 3 ) - 1 : ( ( i & 1 ) ? prvRandom() % ulRange : ( i == ucNumBins ? UINT32_MAX : 0 ) );
+			uint8_t	 ucExpected = prvBinIndexLongLinear( ulValue, pulBins, ucNumBins );
+			uint8_t	 ucActual	= ucBinIndexLong( ulValue, pulBins, ucNumBins );
+			if ( ucActual != ucExpected ) {
+				CHECK( 0, "table %d: ucBinIndexLong( %u ) = %d, expected %d", iTable, ulValue, ucActual, ucExpected );
+				break;
+			}
+		}
+	}
+
+	/* Timings, informational only, over inputs with uniformly distributed bit lengths */
+	for ( i = 0; i < TIMING_INPUTS; i++ ) {
+		pulInputs[i] = prvRandom() >> ( prvRandom() % 32 );
+	}
+	printf( "Square root: bitwise %.1f ns, table seeded %.1f ns, newton %.1f ns per call\n", prvTimeSqrt( prvSquareRootBitwise ),
+			prvTimeSqrt( ulSquareRoot ), prvTimeSqrt( ulSquareRootNewton ) );
+	for ( iNum = 4; iNum <= 64; iNum *= 4 ) {
+		for ( i = 0; i < iNum; i++ ) {
+			pulBins[i] = ( UINT32_MAX / iNum ) * i;
+		}
+		for ( i = 0; i < TIMING_INPUTS; i++ ) {
+			pulInputs[i] = prvRandom();
+		}
+		printf( "%2d bins: linear %.1f ns, binary %.1f ns per call\n", iNum, prvTimeBins( prvBinIndexLongLinear, iNum ),
+				prvTimeBins( ucBinIndexLong, iNum ) );
+	}
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the energy accounting against a stubbed RTC
+ * 100 s of activity is replayed: the CPU awake for 1% of the time in 128 wakes, 10 s of scanning at a 10%
+ * duty cycle and 50 advertising events. With the harness board model this is 120 uA, 8333 h on 1000 mAh,
+ * and every subsystem's charge is checked against the hand calculation, as are the logged TDFs.
+ * Duty cycle changes while active, repeated state changes, an RTC read that runs backwards while the
+ * overflow interrupt is pending and the statistics reset are checked separately.
+ * energy.c is included directly so that its state can be reset between scenarios.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+
+#define portSET_INTERRUPT_MASK_FROM_ISR() 0
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR( x ) (void) ( x )
+
+#include "energy.c"
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+/* 100 s in steps of 256 RTC ticks */
+#define STEP_TICKS 256
+#define WORKLOAD_STEPS 12800
+#define CPU_PERIOD_STEPS 100
+#define SCAN_START_STEP 1280
+#define SCAN_STEPS 1280
+#define SCAN_DUTY 100
+#define ADVERTISE_PERIOD_STEPS 256
+
+static const xEnergyModel_t xModel = {
+	.ulBaseMicroAmps	= 15,
+	.pulActiveMicroAmps = {
+		[ENERGY_CPU]		= 4000,
+		[ENERGY_RADIO_SCAN] = 5000,
+		[ENERGY_FLASH]		= 1000,
+	},
+	.pulEventNanoCoulombs = {
+		[ENERGY_RADIO_ADVERTISE] = 30000,
+	},
+	.ulBatteryMilliAmpHours = 1000
+};
+
+static uint64_t ullRtc;
+
+const xEnergyModel_t *pxBoardEnergyModel( void )
+{
+	return &xModel;
+}
+
+uint64_t ullRtcTickCount( void )
+{
+	return ullRtc;
+}
+
+/*-----------------------------------------------------------*/
+
+static tdf_energy_summary_t   xSummary;
+static tdf_energy_subsystem_t pxSubsystems[ENERGY_SUBSYSTEMS];
+static int					  iSubsystemTdfs;
+
+eModuleError_t eTdfAddMulti( uint8_t ucLoggerMask, eTdfIds_t eTdfId, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxGlobalTime, void *pucData )
+{
+	if ( eTdfId == TDF_ENERGY_SUMMARY ) {
+		memcpy( &xSummary, pucData, sizeof( xSummary ) );
+	}
+	else if ( ( eTdfId == TDF_ENERGY_SUBSYSTEM ) && ( iSubsystemTdfs < ENERGY_SUBSYSTEMS ) ) {
+		memcpy( &pxSubsystems[iSubsystemTdfs++], pucData, sizeof( tdf_energy_subsystem_t ) );
+	}
+	else {
+		CHECK( false, "unexpected TDF %d", eTdfId );
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Boot state, with the CPU running */
+static void prvReset( void )
+{
+	int i;
+
+	ulActiveMask = ( 1UL << ENERGY_CPU );
+	memset( pullActive, 0, sizeof( pullActive ) );
+	memset( pullActiveSince, 0, sizeof( pullActiveSince ) );
+	memset( pulEvents, 0, sizeof( pulEvents ) );
+	for ( i = 0; i < ENERGY_SUBSYSTEMS; i++ ) {
+		pusDuty[i] = ENERGY_DUTY_FULL;
+	}
+	ullRtc		   = 0;
+	ullPeriodStart = 0;
+	ullLastNow	 = 0;
+}
+
+static void prvWorkload( void )
+{
+	xEnergyStats_t xStats;
+	uint32_t	   ulStep, ulAverage, ulLifetime;
+	int			   i;
+
+	prvReset();
+	vEnergyDuty( ENERGY_RADIO_SCAN, SCAN_DUTY );
+	for ( ulStep = 0; ulStep < WORKLOAD_STEPS; ulStep++ ) {
+		/* The CPU wakes for the first step of each period, and is running at boot */
+		vEnergyActive( ENERGY_CPU, ( ulStep % CPU_PERIOD_STEPS ) == 0 );
+		if ( ulStep == SCAN_START_STEP ) {
+			vEnergyActive( ENERGY_RADIO_SCAN, true );
+		}
+		if ( ulStep == SCAN_START_STEP + SCAN_STEPS ) {
+			vEnergyActive( ENERGY_RADIO_SCAN, false );
+		}
+		if ( ( ulStep % ADVERTISE_PERIOD_STEPS ) == 0 ) {
+			vEnergyEvent( ENERGY_RADIO_ADVERTISE, 1 );
+		}
+		ullRtc += STEP_TICKS;
+	}
+	/* Awake to read the statistics */
+	vEnergyActive( ENERGY_CPU, true );
+	vEnergyGet( &xStats, false );
+
+	/* 15 uA base, 1 s of CPU at 4 mA, 10 s of scanning at 10% of 5 mA and 50 events of 30 uC */
+	CHECK( xStats.ullElapsed == 100 * ENERGY_TIMEBASE_HZ, "elapsed %llu", (unsigned long long) xStats.ullElapsed );
+	CHECK( xStats.ullBaseNanoCoulombs == 1500000, "base %llu nC", (unsigned long long) xStats.ullBaseNanoCoulombs );
+	CHECK( xStats.pullNanoCoulombs[ENERGY_CPU] == 4000000, "CPU %llu nC", (unsigned long long) xStats.pullNanoCoulombs[ENERGY_CPU] );
+	CHECK( xStats.pullNanoCoulombs[ENERGY_RADIO_SCAN] == 5000000, "scan %llu nC", (unsigned long long) xStats.pullNanoCoulombs[ENERGY_RADIO_SCAN] );
+	CHECK( xStats.pullNanoCoulombs[ENERGY_RADIO_ADVERTISE] == 1500000, "advertising %llu nC", (unsigned long long) xStats.pullNanoCoulombs[ENERGY_RADIO_ADVERTISE] );
+	CHECK( xStats.pulEvents[ENERGY_RADIO_ADVERTISE] == 50, "%u advertising events", xStats.pulEvents[ENERGY_RADIO_ADVERTISE] );
+	for ( i = ENERGY_RADIO_CONNECTED; i < ENERGY_SUBSYSTEMS; i++ ) {
+		CHECK( xStats.pullNanoCoulombs[i] == 0, "subsystem %d charged %llu nC", i, (unsigned long long) xStats.pullNanoCoulombs[i] );
+	}
+	ulAverage  = ulEnergyAverageMicroAmps( &xStats );
+	ulLifetime = ulEnergyLifetimeHours( &xStats );
+	CHECK( ulAverage == 120, "average %u uA", ulAverage );
+	CHECK( ulLifetime == 8333, "lifetime %u h", ulLifetime );
+
+	CHECK( eEnergyLog( 0x01, TDF_TIMESTAMP_NONE, NULL, &xStats ) == ERROR_NONE, "log" );
+	CHECK( ( xSummary.period_ms == 100000 ) && ( xSummary.charge == 12000 ), "summary %u ms, %u uC", xSummary.period_ms, xSummary.charge );
+	CHECK( ( xSummary.average_current == 120 ) && ( xSummary.lifetime == 8333 ), "summary %u uA, %u h", xSummary.average_current, xSummary.lifetime );
+	CHECK( iSubsystemTdfs == 3, "%d subsystem TDFs", iSubsystemTdfs );
+	CHECK( ( pxSubsystems[0].subsystem == ENERGY_CPU ) && ( pxSubsystems[0].active_ms == 1000 ) && ( pxSubsystems[0].charge == 4000 ), "CPU TDF" );
+	CHECK( ( pxSubsystems[1].subsystem == ENERGY_RADIO_SCAN ) && ( pxSubsystems[1].active_ms == 1000 ) && ( pxSubsystems[1].charge == 5000 ), "scan TDF" );
+	CHECK( ( pxSubsystems[2].subsystem == ENERGY_RADIO_ADVERTISE ) && ( pxSubsystems[2].events == 50 ) && ( pxSubsystems[2].charge == 1500 ), "advertising TDF" );
+
+	/* Parsed by test_host.py and compared with energy_model.py */
+	printf( "AVERAGE %u LIFETIME %u\n", ulAverage, ulLifetime );
+}
+
+static void prvAccounting( void )
+{
+	xEnergyStats_t xStats;
+
+	/* A duty cycle change applies from the time of the call */
+	prvReset();
+	vEnergyActive( ENERGY_RADIO_SCAN, true );
+	ullRtc += 1000;
+	vEnergyDuty( ENERGY_RADIO_SCAN, 500 );
+	ullRtc += 1000;
+	vEnergyActive( ENERGY_RADIO_SCAN, false );
+	ullRtc += 1000;
+	vEnergyGet( &xStats, false );
+	CHECK( xStats.pullActive[ENERGY_RADIO_SCAN] == 1000 * 1000 + 1000 * 500, "duty change %llu", (unsigned long long) xStats.pullActive[ENERGY_RADIO_SCAN] );
+
+	/* Repeated states are ignored, the first activation and deactivation count */
+	prvReset();
+	vEnergyActive( ENERGY_FLASH, true );
+	ullRtc += 100;
+	vEnergyActive( ENERGY_FLASH, true );
+	ullRtc += 100;
+	vEnergyActive( ENERGY_FLASH, false );
+	ullRtc += 100;
+	vEnergyActive( ENERGY_FLASH, false );
+	vEnergyGet( &xStats, false );
+	CHECK( xStats.pullActive[ENERGY_FLASH] == 200 * ENERGY_DUTY_FULL, "repeated states %llu", (unsigned long long) xStats.pullActive[ENERGY_FLASH] );
+
+	/* The RTC reads backwards while its overflow interrupt is pending, time holds instead */
+	prvReset();
+	ullRtc = 1000;
+	vEnergyActive( ENERGY_FLASH, true );
+	ullRtc = 900;
+	vEnergyGet( &xStats, false );
+	CHECK( xStats.ullElapsed == 1000, "elapsed %llu after the RTC ran backwards", (unsigned long long) xStats.ullElapsed );
+	CHECK( xStats.pullActive[ENERGY_FLASH] == 0, "flash %llu after the RTC ran backwards", (unsigned long long) xStats.pullActive[ENERGY_FLASH] );
+	ullRtc = 2000;
+	vEnergyActive( ENERGY_FLASH, false );
+	vEnergyGet( &xStats, false );
+	CHECK( xStats.pullActive[ENERGY_FLASH] == 1000 * ENERGY_DUTY_FULL, "flash %llu once the RTC recovered", (unsigned long long) xStats.pullActive[ENERGY_FLASH] );
+
+	/* A reset starts a new period, subsystems active over the reset are split between the periods */
+	prvReset();
+	vEnergyActive( ENERGY_FLASH, true );
+	vEnergyEvent( ENERGY_RADIO_ADVERTISE, 3 );
+	ullRtc += 300;
+	vEnergyGet( &xStats, true );
+	CHECK( ( xStats.pullActive[ENERGY_FLASH] == 300 * ENERGY_DUTY_FULL ) && ( xStats.pulEvents[ENERGY_RADIO_ADVERTISE] == 3 ), "before reset" );
+	vEnergyGet( &xStats, false );
+	CHECK( ( xStats.ullElapsed == 0 ) && ( xStats.pullActive[ENERGY_FLASH] == 0 ) && ( xStats.pulEvents[ENERGY_RADIO_ADVERTISE] == 0 ), "after reset" );
+	CHECK( ulEnergyAverageMicroAmps( &xStats ) == 0, "average current of an empty period" );
+	ullRtc += 200;
+	vEnergyActive( ENERGY_FLASH, false );
+	vEnergyGet( &xStats, false );
+	CHECK( ( xStats.ullElapsed == 200 ) && ( xStats.pullActive[ENERGY_FLASH] == 200 * ENERGY_DUTY_FULL ), "period after reset" );
+}
+
+int main( void )
+{
+	prvWorkload();
+	prvAccounting();
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
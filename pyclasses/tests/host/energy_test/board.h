@@ -0,0 +1,11 @@
+/*
+ * Host board interface for energy.c, the harness provides the current model
+ */
+#ifndef __CORE_CSIRO_HOST_BOARD_H__
+#define __CORE_CSIRO_HOST_BOARD_H__
+
+#include "energy.h"
+
+const xEnergyModel_t *pxBoardEnergyModel( void );
+
+#endif /* __CORE_CSIRO_HOST_BOARD_H__ */
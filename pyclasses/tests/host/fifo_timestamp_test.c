@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of FIFO sample timestamp reconstruction
+ *
+ * A simulated sensor produces samples from its own clock, running fast or slow against the
+ * nominal rate. Each burst boundary is observed after a random interrupt latency and quantised
+ * to the 1/32768 second RTC tick, as bRtcGetTdfTime reports it. Reconstructed sample times must
+ * stay within a bound of the true sample times plus the mean latency, must never go backwards,
+ * and must recover after missed FIFO reads and the RTC seconds counter wrapping.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fifo_timestamp.h"
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+/* Times passed to the logger by eFifoTimestampLog */
+static xTdfTime_t pxLogged[256];
+static int		  iLogged;
+
+eModuleError_t eTdfAddMulti( uint8_t ucLoggerMask, eTdfIds_t eTdfType, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxTime, void *pvTdfData )
+{
+	pxLogged[iLogged++] = *pxTime;
+	return ERROR_NONE;
+}
+
+#define RTC_TICK ( 1.0 / 32768 )
+
+typedef struct xScenario_t
+{
+	const char *pcName;
+	uint32_t	ulNominalUs;   /**< Configured sample period */
+	double		dClockError;   /**< Sensor clock rate error, positive runs fast */
+	uint8_t		ucBurst;	   /**< Samples per FIFO interrupt */
+	double		dLatencyMin;   /**< Shortest interrupt latency, seconds */
+	double		dLatencyMax;   /**< Longest interrupt latency, seconds */
+	int			iMissedEvery;  /**< Every Nth read is late, the next read returns two bursts of samples */
+	int			iOverflowEvery; /**< Every Nth read is lost along with its samples, 0 for never */
+	double		dStart;		   /**< Seconds since 2000 of the first sample */
+	double		dBound;		   /**< Allowed error beyond the latency jitter, seconds */
+} xScenario_t;
+
+static double prvTdfSeconds( xTdfTime_t *pxTime )
+{
+	return pxTime->ulSecondsSince2000 + pxTime->usSecondsFraction / 65536.0;
+}
+
+/* Runs a scenario for iBursts reads, returns the worst settled error in seconds */
+static double prvRun( const xScenario_t *pxScenario, int iBursts )
+{
+	const double	 dPeriod	= pxScenario->ulNominalUs * 1e-6 / ( 1.0 + pxScenario->dClockError );
+	const double	 dLatency	= ( pxScenario->dLatencyMin + pxScenario->dLatencyMax ) / 2;
+	const double	 dJitter	= ( pxScenario->dLatencyMax - pxScenario->dLatencyMin ) / 2;
+	xFifoTimestamp_t xState;
+	xTdfTime_t		 xBoundary, xFirst, xSpacing, xSample;
+	double			 dPrevious = -1, dWorst = 0;
+	uint64_t		 ullSample = 0;
+	int				 iSettle   = 0;
+	int				 iBurst;
+	uint8_t			 i, ucNum;
+
+	vFifoTimestampInit( &xState, pxScenario->ulNominalUs );
+	for ( iBurst = 0; iBurst < iBursts; iBurst++ ) {
+		ucNum = pxScenario->ucBurst;
+		if ( ( pxScenario->iOverflowEvery != 0 ) && ( ( iBurst % pxScenario->iOverflowEvery ) == pxScenario->iOverflowEvery - 1 ) ) {
+			/* FIFO overflowed, a burst of samples is lost without a boundary and the driver resets */
+			ullSample += ucNum;
+			vFifoTimestampReset( &xState );
+			iSettle = 0;
+		}
+		else if ( ( pxScenario->iMissedEvery != 0 ) && ( ( iBurst % pxScenario->iMissedEvery ) == pxScenario->iMissedEvery - 1 ) ) {
+			/* Read was missed, the next read finds both bursts in the FIFO */
+			ucNum *= 2;
+		}
+		/* True time of each sample, and the observed boundary of the final one */
+		double dFirst = pxScenario->dStart + ullSample * dPeriod;
+		double dFinal = dFirst + ( ucNum - 1 ) * dPeriod;
+		double dSeen  = floor( ( dFinal + pxScenario->dLatencyMin + ( pxScenario->dLatencyMax - pxScenario->dLatencyMin ) * rand() / RAND_MAX ) / RTC_TICK ) * RTC_TICK;
+		double dWhole = floor( dSeen );
+		xBoundary	 = ( xTdfTime_t ){ (uint32_t) (uint64_t) dWhole, (uint16_t) ( ( dSeen - dWhole ) * 65536 ) };
+
+		vFifoTimestampBurst( &xState, &xBoundary, ucNum, &xFirst, &xSpacing );
+		iLogged = 0;
+		eFifoTimestampLog( 0x01, TDF_ACC_XYZ_SIGNED, &xState, (uint8_t *) pxLogged, ucNum );
+		CHECK( iLogged == ucNum, "%s: logged %d of %d", pxScenario->pcName, iLogged, ucNum );
+		CHECK( memcmp( &pxLogged[0], &xFirst, sizeof( xTdfTime_t ) ) == 0, "%s: first logged time", pxScenario->pcName );
+
+		/* Spacing stays within the configured tolerance of the nominal period */
+		double dSpacing = prvTdfSeconds( &xSpacing );
+		double dNominal = pxScenario->ulNominalUs * 1e-6;
+		CHECK( fabs( dSpacing - dNominal ) <= dNominal / ( 1 << FIFO_TIMESTAMP_TOLERANCE_SHIFT ) + 2 / 65536.0, "%s burst %d: spacing %.6f",
+			   pxScenario->pcName, iBurst, dSpacing );
+
+		for ( i = 0; i < ucNum; i++ ) {
+			vFifoTimestampSample( &xState, i, &xSample );
+			double dTime = prvTdfSeconds( &xSample );
+			/* Seconds wrap to zero, unwrap them for comparison */
+			if ( dTime < pxScenario->dStart - 1 ) {
+				dTime += 4294967296.0;
+			}
+			CHECK( memcmp( &pxLogged[i], &xSample, sizeof( xTdfTime_t ) ) == 0, "%s: logged time %d", pxScenario->pcName, i );
+			CHECK( dTime > dPrevious, "%s burst %d sample %d: time went backwards %.6f to %.6f", pxScenario->pcName, iBurst, i, dPrevious, dTime );
+			dPrevious = dTime;
+			/* The loop needs a few bursts to lock after a reset */
+			if ( iSettle >= 16 ) {
+				double dError = fabs( dTime - ( dFirst + i * dPeriod ) - dLatency );
+				dWorst		  = fmax( dWorst, dError );
+				if ( dError > dJitter + pxScenario->dBound ) {
+					CHECK( 0, "%s burst %d sample %d: error %.1f us", pxScenario->pcName, iBurst, i, 1e6 * dError );
+					return dWorst;
+				}
+			}
+		}
+		ullSample += ucNum;
+		iSettle++;
+	}
+	return dWorst;
+}
+
+int main( void )
+{
+	/* Bounds are beyond half the latency jitter, covering RTC quantisation and the loop's response to jitter */
+	static const xScenario_t pxScenarios[] = {
+		{ "fast clock, 1600 Hz", 625, +0.03, 32, 20e-6, 120e-6, 0, 0, 600000000.0, 40e-6 },
+		{ "slow clock, 1600 Hz", 625, -0.03, 32, 20e-6, 120e-6, 0, 0, 600000000.0, 40e-6 },
+		{ "fast clock, 12.5 Hz", 80000, +0.02, 4, 20e-6, 2e-3, 0, 0, 600000000.0, 500e-6 },
+		{ "slow clock, 12.5 Hz", 80000, -0.02, 4, 20e-6, 2e-3, 0, 0, 600000000.0, 500e-6 },
+		{ "late reads, 100 Hz", 10000, +0.01, 25, 20e-6, 500e-6, 7, 0, 600000000.0, 150e-6 },
+		{ "overflows, 100 Hz", 10000, -0.01, 25, 20e-6, 500e-6, 0, 50, 600000000.0, 150e-6 },
+		{ "seconds wrap, 400 Hz", 2500, +0.005, 32, 20e-6, 200e-6, 0, 0, 4294967296.0 - 20, 60e-6 },
+	};
+	xFifoTimestamp_t xState;
+	xTdfTime_t		 xBoundary = { 1000, 0 }, xFirst, xSpacing;
+	unsigned		 i;
+
+	/* The first burst assumes the nominal period, ending at the boundary */
+	vFifoTimestampInit( &xState, 10000 );
+	vFifoTimestampBurst( &xState, &xBoundary, 5, &xFirst, &xSpacing );
+	CHECK( xFirst.ulSecondsSince2000 == 999 && xFirst.usSecondsFraction == 65536 - 4 * 655 - 1, "first burst start %u.%u", xFirst.ulSecondsSince2000,
+		   xFirst.usSecondsFraction );
+	CHECK( xSpacing.ulSecondsSince2000 == 0 && xSpacing.usSecondsFraction == 655, "first burst spacing %u", xSpacing.usSecondsFraction );
+
+	srand( 1 );
+	for ( i = 0; i < sizeof( pxScenarios ) / sizeof( pxScenarios[0] ); i++ ) {
+		/* Runs long enough for the wrap case to cross zero, and a slow sensor to see many boundaries */
+		double dWorst = prvRun( &pxScenarios[i], 2000 );
+		printf( "%-22s worst error %7.1f us, latency jitter +-%.1f us\n", pxScenarios[i].pcName, 1e6 * dWorst,
+				1e6 * ( pxScenarios[i].dLatencyMax - pxScenarios[i].dLatencyMin ) / 2 );
+	}
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the flash_common write combining cache against a NOR flash model
+ * flash_common.c is included directly so the cache and flash task helpers can be driven without a scheduler.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_common.c"
+
+#define PAGE_SIZE 256
+#define NUM_PAGES 16
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+static uint8_t		  pucMemory[PAGE_SIZE * NUM_PAGES], pucExpected[PAGE_SIZE * NUM_PAGES], pucPage[PAGE_SIZE];
+static int			  iPrograms, iFailPrograms;
+static TickType_t	 xNow;
+static xFlashCache_t  xCache = { .xFlushDeadline = 10 };
+static xFlashDevice_t xDevice;
+
+/* Programming can only clear bits */
+static eModuleError_t prvWriteSubpage( xFlashDevice_t *pxDevice, uint32_t ulPage, uint16_t usOffset, uint8_t *pucData, uint16_t usLen )
+{
+	uint16_t i;
+	iPrograms++;
+	if ( iFailPrograms > 0 ) {
+		iFailPrograms--;
+		return ERROR_TIMEOUT;
+	}
+	for ( i = 0; i < usLen; i++ ) {
+		pucMemory[ulPage * PAGE_SIZE + usOffset + i] &= pucData[i];
+	}
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvReadSubpage( xFlashDevice_t *pxDevice, uint32_t ulPage, uint16_t usOffset, uint8_t *pucData, uint16_t usLen )
+{
+	memcpy( pucData, pucMemory + ulPage * PAGE_SIZE + usOffset, usLen );
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvSleep( xFlashDevice_t *pxDevice )
+{
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvWake( xFlashDevice_t *pxDevice, bool bWasDepowered )
+{
+	return ERROR_NONE;
+}
+
+static void prvWrite( uint32_t ulAddress, uint8_t *pucData, uint32_t ulLen )
+{
+	memcpy( pucExpected + ulAddress, pucData, ulLen );
+	prvFlashIteratePages( &xDevice, prvFlashIterateWrite, pucData, ulAddress / PAGE_SIZE, ulAddress % PAGE_SIZE, ulLen );
+}
+
+static bool prvReadMatches( uint32_t ulAddress, uint32_t ulLen )
+{
+	uint8_t pucData[PAGE_SIZE];
+	prvFlashIteratePages( &xDevice, prvFlashIterateRead, pucData, ulAddress / PAGE_SIZE, ulAddress % PAGE_SIZE, ulLen );
+	return memcmp( pucData, pucExpected + ulAddress, ulLen ) == 0;
+}
+
+/* Scheduler and peripheral stubs, queue waits time out immediately and advance time */
+TickType_t xTaskGetTickCount( void )
+{
+	return xNow;
+}
+
+BaseType_t xQueueReceive( QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait )
+{
+	if ( xTicksToWait == portMAX_DELAY ) {
+		return pdPASS;
+	}
+	xNow += xTicksToWait;
+	return pdFAIL;
+}
+
+void vEnergyActive( eEnergySubsystem_t eSubsystem, bool bActive ) {}
+
+void vCrcStart( eCrcPolynomial_t ePolynomial, uint32_t ulInitial ) {}
+
+uint32_t ulCrcCalculate( uint8_t *pucData, uint32_t ulLen, bool bFinal )
+{
+	return 0;
+}
+
+eModuleError_t eNvmReadData( eNvmKey_t eKey, void *pvData )
+{
+	return ERROR_INVALID_DATA;
+}
+
+eModuleError_t eNvmWriteData( eNvmKey_t eKey, void *pvData )
+{
+	return ERROR_NONE;
+}
+
+eModuleError_t eNvmEraseKey( eNvmKey_t eKey )
+{
+	return ERROR_NONE;
+}
+
+int main( void )
+{
+	static xFlashImplementation_t xImplementation;
+	uint8_t						  pucData[64];
+	xFlashAction_t				  xAction;
+	uint32_t					  ulAddress, ulLen, i;
+	int							  iWrites = 0;
+
+	xImplementation.fnWriteSubpage		= prvWriteSubpage;
+	xImplementation.fnReadSubpage		= prvReadSubpage;
+	xImplementation.fnSleep				= prvSleep;
+	xImplementation.fnWake				= prvWake;
+	xDevice.pxImplementation			= &xImplementation;
+	xDevice.pxCache						= &xCache;
+	xDevice.xSettings.usPageSize		= PAGE_SIZE;
+	xDevice.xSettings.ucPageSizePower   = 8;
+	xDevice.xSettings.usPageOffsetMask  = PAGE_SIZE - 1;
+	xDevice.xSettings.ucEraseByte		= 0xFF;
+	xDevice.xSettings.pucPage			= pucPage;
+	memset( pucMemory, 0xFF, sizeof( pucMemory ) );
+	memset( pucExpected, 0xFF, sizeof( pucExpected ) );
+	eFlashInit( &xDevice );
+
+	/* Contiguous appends are merged into a single program */
+	for ( i = 0; i < 8; i++ ) {
+		memset( pucData, i, 16 );
+		prvWrite( 16 * i, pucData, 16 );
+	}
+	CHECK( iPrograms == 0 && xCache.usDirtyEnd == 128, "appends pending" );
+	CHECK( prvReadMatches( 32, 64 ) && xCache.ulReadHits == 1, "read of pending bytes from the cache" );
+	prvFlashCacheFlush( &xDevice );
+	CHECK( iPrograms == 1 && memcmp( pucMemory, pucExpected, sizeof( pucMemory ) ) == 0, "single program" );
+
+	/* Programmed bytes between two writes are not hidden by the cache */
+	memset( pucData, 0x11, 16 );
+	prvWrite( PAGE_SIZE + 16, pucData, 16 );
+	prvFlashCacheFlush( &xDevice );
+	memset( pucData, 0x22, 8 );
+	prvWrite( PAGE_SIZE, pucData, 8 );
+	prvWrite( PAGE_SIZE + 40, pucData, 8 );
+	CHECK( prvReadMatches( PAGE_SIZE + 16, 16 ), "programmed bytes in a gap read back" );
+	CHECK( prvReadMatches( PAGE_SIZE, 48 ), "page read back" );
+
+	/* A failed deadline program is held for the next operation to report */
+	prvFlashCacheFlush( &xDevice );
+	prvWrite( 2 * PAGE_SIZE, pucData, 8 );
+	iFailPrograms = 1;
+	prvFlashWaitAction( &xDevice, &xAction );
+	CHECK( xCache.ulPage == FLASH_CACHE_NO_PAGE && xCache.eDeferredError == ERROR_TIMEOUT, "deadline program failure held" );
+	memcpy( pucExpected + 2 * PAGE_SIZE, pucMemory + 2 * PAGE_SIZE, 8 );
+
+	/* Random appends, gaps and reads across pages against the expected image */
+	srand( 1 );
+	for ( ulAddress = 3 * PAGE_SIZE; ulAddress < ( PAGE_SIZE * NUM_PAGES ) - 64; ulAddress += ulLen ) {
+		ulLen = 1 + rand() % 40;
+		for ( i = 0; i < ulLen; i++ ) {
+			pucData[i] = rand();
+		}
+		if ( rand() % 5 == 0 ) {
+			ulAddress += rand() % 8;
+		}
+		prvWrite( ulAddress, pucData, ulLen );
+		iWrites++;
+		CHECK( prvReadMatches( ulAddress, ulLen ), "readback at %u", ulAddress );
+		if ( rand() % 4 == 0 ) {
+			CHECK( prvReadMatches( ulAddress - ( ulAddress % PAGE_SIZE ), PAGE_SIZE ), "page readback at %u", ulAddress );
+		}
+		if ( rand() % 50 == 0 ) {
+			prvFlashWaitAction( &xDevice, &xAction );
+		}
+	}
+	prvFlashCacheFlush( &xDevice );
+	CHECK( memcmp( pucMemory, pucExpected, sizeof( pucMemory ) ) == 0, "final image" );
+	printf( "%d writes, %u programs, %u/%u read hits\n", iWrites, xCache.ulPrograms, xCache.ulReadHits, xCache.ulReadHits + xCache.ulReadMisses );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Power loss checks of resumable delta updates in flash_common against a NOR flash model
+ * Arguments are the current image followed by pairs of new image and delta stream files, generated by flash_delta.py.
+ * Power is cut at random during programs, erases and NVM writes, the update is then resumed from its checkpoint
+ * with random chunk sizes, retransmissions and duplicate chunks. Every update must produce an identical image.
+ * flash_common.c is included directly so the flash task can be run synchronously.
+ */
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_common.c"
+
+#define PAGE_SIZE 256
+#define ERASE_PAGES 16
+#define NUM_PAGES 1024
+#define MAX_RESTARTS 200
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+static uint8_t		  pucMemory[PAGE_SIZE * NUM_PAGES], pucPage[PAGE_SIZE];
+static xFlashDevice_t xDevice;
+static jmp_buf		  xPowerLoss;
+/* Operations remaining until power is cut, negative to disable */
+static long lBudget = -1;
+static long lPrograms, lErases, lNvmWrites;
+
+static bool prvPowerCut( void )
+{
+	return ( lBudget > 0 ) && ( --lBudget == 0 );
+}
+
+/* The flash task runs in the context of the caller */
+BaseType_t xQueueSendToBack( QueueHandle_t xQueue, const void *pvItem, TickType_t xTicksToWait )
+{
+	const xFlashAction_t *pxAction = pvItem;
+	configASSERT( pxAction->eCommand == FLASH_ROM_APPLY_DELTA );
+	*pxAction->peResult = prvFlashDeltaApply( &xDevice, (xFlashDelta_t *) pxAction->pucArg1, pxAction->pucArg2, pxAction->ulLength );
+	return pdPASS;
+}
+
+static uint16_t usCrc;
+
+void vCrcStart( eCrcPolynomial_t ePolynomial, uint32_t ulInitial )
+{
+	usCrc = ulInitial;
+}
+
+uint32_t ulCrcCalculate( uint8_t *pucData, uint32_t ulLen, bool bFinal )
+{
+	int i;
+	while ( ulLen-- ) {
+		usCrc ^= (uint16_t) *pucData++ << 8;
+		for ( i = 0; i < 8; i++ ) {
+			usCrc = ( usCrc & 0x8000 ) ? ( usCrc << 1 ) ^ 0x1021 : usCrc << 1;
+		}
+	}
+	return usCrc;
+}
+
+void vEnergyActive( eEnergySubsystem_t eSubsystem, bool bActive ) {}
+
+/* NVM holds the progress record, writes are atomic */
+static xFlashDeltaProgress_t xNvmProgress;
+static bool					 bNvmValid;
+
+eModuleError_t eNvmReadData( eNvmKey_t eKey, void *pvData )
+{
+	if ( !bNvmValid ) {
+		return ERROR_INVALID_DATA;
+	}
+	memcpy( pvData, &xNvmProgress, sizeof( xNvmProgress ) );
+	return ERROR_NONE;
+}
+
+eModuleError_t eNvmWriteData( eNvmKey_t eKey, void *pvData )
+{
+	if ( prvPowerCut() ) {
+		longjmp( xPowerLoss, 1 );
+	}
+	memcpy( &xNvmProgress, pvData, sizeof( xNvmProgress ) );
+	bNvmValid = true;
+	lNvmWrites++;
+	return ERROR_NONE;
+}
+
+eModuleError_t eNvmEraseKey( eNvmKey_t eKey )
+{
+	bNvmValid = false;
+	return ERROR_NONE;
+}
+
+/* Programming can only clear bits, an interrupted program leaves a random prefix partially programmed */
+static eModuleError_t prvWriteSubpage( xFlashDevice_t *pxDevice, uint32_t ulPage, uint16_t usOffset, uint8_t *pucData, uint16_t usLength )
+{
+	uint32_t i, ulProgrammed;
+	configASSERT( ( usOffset + usLength <= PAGE_SIZE ) && ( ulPage < NUM_PAGES ) );
+	lPrograms++;
+	if ( prvPowerCut() ) {
+		ulProgrammed = rand() % ( usLength + 1 );
+		for ( i = 0; i < ulProgrammed; i++ ) {
+			pucMemory[ulPage * PAGE_SIZE + usOffset + i] &= pucData[i] & ( rand() | rand() );
+		}
+		longjmp( xPowerLoss, 1 );
+	}
+	for ( i = 0; i < usLength; i++ ) {
+		pucMemory[ulPage * PAGE_SIZE + usOffset + i] &= pucData[i];
+	}
+	return ERROR_NONE;
+}
+
+/* An interrupted erase leaves random bytes erased */
+static eModuleError_t prvErasePages( xFlashDevice_t *pxDevice, uint32_t ulPage, uint32_t ulNumPages )
+{
+	uint32_t i;
+	configASSERT( ( ulPage % ERASE_PAGES == 0 ) && ( ulNumPages == ERASE_PAGES ) );
+	lErases++;
+	if ( prvPowerCut() ) {
+		for ( i = 0; i < ulNumPages * PAGE_SIZE; i++ ) {
+			if ( rand() & 1 ) {
+				pucMemory[ulPage * PAGE_SIZE + i] = 0xFF;
+			}
+		}
+		longjmp( xPowerLoss, 1 );
+	}
+	memset( pucMemory + ulPage * PAGE_SIZE, 0xFF, ulNumPages * PAGE_SIZE );
+	return ERROR_NONE;
+}
+
+static uint8_t *prvLoad( const char *pcFilename, uint32_t *pulLength )
+{
+	FILE *	 pxFile = fopen( pcFilename, "rb" );
+	uint8_t *pucData;
+	configASSERT( pxFile != NULL );
+	fseek( pxFile, 0, SEEK_END );
+	*pulLength = ftell( pxFile );
+	rewind( pxFile );
+	pucData = malloc( *pulLength );
+	configASSERT( fread( pucData, 1, *pulLength, pxFile ) == *pulLength );
+	fclose( pxFile );
+	return pucData;
+}
+
+/* Apply a complete delta, losing power after a random number of operations up to lCutRate, returns the number of restarts */
+static int prvApply( uint8_t *pucOld, uint32_t ulOldLength, uint8_t *pucDelta, uint32_t ulDeltaLength, uint32_t ulImageId, long lCutRate, uint32_t *pulSent )
+{
+	static xFlashDelta_t xDelta;
+	volatile int		 iRestarts = 0;
+	eModuleError_t		 eError;
+	uint32_t			 ulPosition, ulLength;
+
+	*pulSent = 0;
+	if ( setjmp( xPowerLoss ) != 0 ) {
+		iRestarts++;
+	}
+	if ( iRestarts > MAX_RESTARTS ) {
+		lBudget = -1;
+		CHECK( false, "image %08X: no progress after %d restarts", ulImageId, iRestarts );
+		return iRestarts;
+	}
+	lBudget = ( lCutRate > 0 ) ? 1 + rand() % lCutRate : -1;
+	eError	= eFlashRomDeltaStart( &xDelta, ulImageId, 0, pucOld, ulOldLength );
+	if ( eError == ERROR_NO_CHANGE ) {
+		/* Power was lost after the final checkpoint */
+		lBudget = -1;
+		return iRestarts;
+	}
+	CHECK( eError == ERROR_NONE, "image %08X: start %d", ulImageId, eError );
+	ulPosition = xDelta.ulStreamPosition;
+	/* Senders may retransmit data from before the resume point */
+	if ( ( ulPosition > 0 ) && ( rand() % 2 ) ) {
+		ulPosition -= rand() % ( ( ulPosition < 600 ) ? ulPosition : 600 );
+	}
+	while ( ulPosition < ulDeltaLength ) {
+		ulLength = 1 + rand() % 300;
+		ulLength = ( ulPosition + ulLength > ulDeltaLength ) ? ulDeltaLength - ulPosition : ulLength;
+		eError	 = eFlashRomDeltaApply( &xDevice, &xDelta, ulPosition, pucDelta + ulPosition, ulLength, 0 );
+		if ( eError != ERROR_NONE ) {
+			lBudget = -1;
+			CHECK( false, "image %08X: apply %d at stream offset %u", ulImageId, eError, ulPosition );
+			return iRestarts;
+		}
+		*pulSent += ulLength;
+		/* Occasional duplicate chunk */
+		if ( rand() % 20 == 0 ) {
+			eError = eFlashRomDeltaApply( &xDevice, &xDelta, ulPosition, pucDelta + ulPosition, ulLength, 0 );
+			CHECK( ( eError == ERROR_NONE ) || ( eError == ERROR_INVALID_STATE ), "image %08X: duplicate chunk %d", ulImageId, eError );
+		}
+		ulPosition += ulLength;
+	}
+	lBudget = -1;
+	CHECK( xDelta.xProgress.usFlags & FLASH_DELTA_FLAG_COMPLETE, "image %08X: not complete", ulImageId );
+	CHECK( eFlashRomDeltaStart( &xDelta, ulImageId, 0, pucOld, ulOldLength ) == ERROR_NO_CHANGE, "image %08X: completion not recorded", ulImageId );
+	return iRestarts;
+}
+
+int main( int argc, char **argv )
+{
+	static const long		 plCutRates[] = { 0, 5000, 800, 150 };
+	static xFlashImplementation_t xImplementation;
+	static xFlashDelta_t		  xDelta;
+	uint8_t *					  pucOld, *pucNew, *pucDelta;
+	uint32_t					  ulOldLength, ulNewLength, ulDeltaLength, ulSent, ulPosition, ulLength;
+	int							  iCase, iRate, iTrial, iRestarts;
+	eModuleError_t				  eError;
+
+	configASSERT( ( argc >= 4 ) && ( argc % 2 == 0 ) );
+	xImplementation.fnWriteSubpage		= prvWriteSubpage;
+	xImplementation.fnErasePages		= prvErasePages;
+	xDevice.pxImplementation			= &xImplementation;
+	xDevice.xSettings.usPageSize		= PAGE_SIZE;
+	xDevice.xSettings.ucPageSizePower   = 8;
+	xDevice.xSettings.usPageOffsetMask  = PAGE_SIZE - 1;
+	xDevice.xSettings.usErasePages		= ERASE_PAGES;
+	xDevice.xSettings.ucEraseByte		= 0xFF;
+	xDevice.xSettings.pucPage			= pucPage;
+	xDevice.xSettings.ulNumPages		= NUM_PAGES;
+	pucOld								= prvLoad( argv[1], &ulOldLength );
+	srand( 7 );
+
+	for ( iCase = 0; 2 * iCase + 3 < argc; iCase++ ) {
+		pucNew	 = prvLoad( argv[2 * iCase + 2], &ulNewLength );
+		pucDelta = prvLoad( argv[2 * iCase + 3], &ulDeltaLength );
+		for ( iRate = 0; iRate < 4; iRate++ ) {
+			for ( iTrial = 0; iTrial < ( iRate ? 10 : 1 ); iTrial++ ) {
+				memset( pucMemory, 0x5A, sizeof( pucMemory ) );
+				bNvmValid  = false;
+				lPrograms  = 0;
+				lErases	= 0;
+				lNvmWrites = 0;
+				iRestarts  = prvApply( pucOld, ulOldLength, pucDelta, ulDeltaLength, 0x1000 + iCase * 100 + iRate * 10 + iTrial, plCutRates[iRate], &ulSent );
+				CHECK( memcmp( pucMemory, pucNew, ulNewLength ) == 0, "case %d cut rate %ld trial %d: image mismatch", iCase, plCutRates[iRate], iTrial );
+				if ( iTrial == 0 ) {
+					printf( "case %d, delta %u of %u bytes, cut every %ld operations: %d restarts, %.2fx stream sent, %ld programs %ld erases %ld checkpoints\n",
+							iCase, ulDeltaLength, ulNewLength, plCutRates[iRate], iRestarts, (double) ulSent / ulDeltaLength, lPrograms, lErases, lNvmWrites );
+				}
+			}
+		}
+		/* Corrupt streams are rejected and the checkpoint discarded */
+		pucDelta[ulDeltaLength / 2] ^= 0x40;
+		bNvmValid = false;
+		eFlashRomDeltaStart( &xDelta, 77, 0, pucOld, ulOldLength );
+		eError = ERROR_NONE;
+		for ( ulPosition = 0; ( ulPosition < ulDeltaLength ) && ( eError == ERROR_NONE ); ulPosition += ulLength ) {
+			ulLength = ( ulDeltaLength - ulPosition < 200 ) ? ulDeltaLength - ulPosition : 200;
+			eError	 = eFlashRomDeltaApply( &xDevice, &xDelta, ulPosition, pucDelta + ulPosition, ulLength, 0 );
+		}
+		CHECK( ( eError != ERROR_NONE ) && !bNvmValid, "case %d: corrupt stream accepted, error %d", iCase, eError );
+		free( pucNew );
+		free( pucDelta );
+	}
+	free( pucOld );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Power loss checks and update cost benchmark of flash_kv against a NOR flash model
+ * Programs complete in a random byte order with the final byte partially programmed when power is cut,
+ * interrupted erases leave the sector in an arbitrary state. After every power failure the store must hold
+ * either all or none of an interrupted commit, and every other key must be intact.
+ */
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crc.h"
+#include "flash_kv.h"
+
+#define NUM_SECTORS 8
+#define SECTOR_PAGES 16
+#define PAGE_SIZE 256
+#define SECTOR_SIZE ( SECTOR_PAGES * PAGE_SIZE )
+
+#define NUM_KEYS 24
+#define NUM_COUNTERS 4
+#define COUNTER_KEY 1000
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+static uint8_t pucMemory[NUM_SECTORS * SECTOR_SIZE], pucPage[PAGE_SIZE];
+/* Bytes remaining until power is cut, negative to disable */
+static long	lCountdown = -1;
+static jmp_buf xPowerLoss;
+static long	lProgramBytes, lErases;
+
+static xFlashDevice_t xDevice = {
+	.xSettings = { .ulNumPages = NUM_SECTORS * SECTOR_PAGES, .usPageSize = PAGE_SIZE, .usErasePages = SECTOR_PAGES, .ucEraseByte = 0xFF, .ucPageSizePower = 8, .usPageOffsetMask = PAGE_SIZE - 1, .pucPage = pucPage },
+	.pcName	= "HOST"
+};
+
+eModuleError_t eFlashRead( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout )
+{
+	memcpy( pucData, pucMemory + ullAddress, ulLength );
+	return ERROR_NONE;
+}
+
+eModuleError_t eFlashWrite( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout )
+{
+	uint32_t piOrder[SECTOR_SIZE], i, j, k, ulTemp;
+
+	CHECK( ( ullAddress % 4 == 0 ) && ( ulLength % 4 == 0 ), "unaligned program of %u bytes at %u", ulLength, (uint32_t) ullAddress );
+	for ( i = 0; i < ulLength; i++ ) {
+		piOrder[i] = i;
+	}
+	if ( rand() & 1 ) {
+		for ( i = ulLength - 1; i > 0; i-- ) {
+			j		   = rand() % ( i + 1 );
+			ulTemp	 = piOrder[i];
+			piOrder[i] = piOrder[j];
+			piOrder[j] = ulTemp;
+		}
+	}
+	for ( k = 0; k < ulLength; k++ ) {
+		i = piOrder[k];
+		if ( ( lCountdown > 0 ) && ( --lCountdown == 0 ) ) {
+			pucMemory[ullAddress + i] &= pucData[i] | rand();
+			longjmp( xPowerLoss, 1 );
+		}
+		CHECK( ( pucMemory[ullAddress + i] & pucData[i] ) == pucData[i], "program over unerased byte at %u", (uint32_t) ullAddress + i );
+		pucMemory[ullAddress + i] &= pucData[i];
+	}
+	lProgramBytes += ulLength;
+	return ERROR_NONE;
+}
+
+eModuleError_t eFlashErase( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint32_t ulLength, TickType_t xTimeout )
+{
+	uint32_t i;
+	if ( ( lCountdown > 0 ) && ( ( lCountdown -= 64 ) <= 0 ) ) {
+		/* Interrupted erase leaves the sector in an arbitrary state */
+		for ( i = 0; i < ulLength; i++ ) {
+			if ( rand() & 1 ) {
+				pucMemory[ullAddress + i] = rand();
+			}
+		}
+		longjmp( xPowerLoss, 1 );
+	}
+	memset( pucMemory + ullAddress, 0xFF, ulLength );
+	lErases++;
+	return ERROR_NONE;
+}
+
+/* The store allocates its index on initialisation, which the harness repeats after every power failure */
+static void *pvAllocations[16];
+static int   iAllocations;
+
+void *pvPortMalloc( size_t xSize )
+{
+	pvAllocations[iAllocations] = malloc( xSize );
+	return pvAllocations[iAllocations++];
+}
+
+static void prvFreeAll( void )
+{
+	while ( iAllocations > 0 ) {
+		free( pvAllocations[--iAllocations] );
+	}
+}
+
+static uint16_t usCrc;
+
+void vCrcStart( eCrcPolynomial_t ePolynomial, uint32_t ulInitial )
+{
+	usCrc = ulInitial;
+}
+
+uint32_t ulCrcCalculate( uint8_t *pucData, uint32_t ulLen, bool bFinal )
+{
+	int i;
+	while ( ulLen-- ) {
+		usCrc ^= (uint16_t) *pucData++ << 8;
+		for ( i = 0; i < 8; i++ ) {
+			usCrc = ( usCrc & 0x8000 ) ? ( usCrc << 1 ) ^ 0x1021 : usCrc << 1;
+		}
+	}
+	return usCrc;
+}
+
+/* Reference model, the previous value of keys in an interrupted commit is also valid */
+static uint8_t	pucValue[NUM_KEYS][FLASH_KV_MAX_LENGTH], pucPrevious[NUM_KEYS][FLASH_KV_MAX_LENGTH];
+static uint16_t   pusLength[NUM_KEYS], pusPrevious[NUM_KEYS];
+static bool		  pbInFlight[NUM_KEYS];
+static uint32_t   pulCounterFlash[NUM_COUNTERS], pulCounterRam[NUM_COUNTERS], pulCounterInFlight[NUM_COUNTERS];
+static xFlashKv_t xKv;
+
+static void prvBoot( uint16_t usWriteback )
+{
+	xFlashKv_t xInitial = { .pxDevice = &xDevice, .ulFirstSector = 0, .usNumSectors = NUM_SECTORS, .usMaxKeys = 40, .usCounterWriteback = usWriteback };
+	prvFreeAll();
+	xKv = xInitial;
+	CHECK( eFlashKvInit( &xKv ) == ERROR_NONE, "initialisation" );
+}
+
+static bool prvMatches( eModuleError_t eError, uint8_t *pucData, uint16_t usLength, uint8_t *pucExpected, uint16_t usExpected )
+{
+	if ( usExpected == 0 ) {
+		return eError == ERROR_INVALID_ADDRESS;
+	}
+	return ( eError == ERROR_NONE ) && ( usLength == usExpected ) && ( memcmp( pucData, pucExpected, usLength ) == 0 );
+}
+
+static void prvVerify( int iCrash, bool bCrashed )
+{
+	uint8_t		   pucData[FLASH_KV_MAX_LENGTH];
+	uint16_t	   usLength = 0;
+	uint32_t	   ulValue;
+	int			   iNew = 0, iOld = 0, i;
+	bool		   bNew, bOld;
+	eModuleError_t eError;
+
+	for ( i = 0; i < NUM_KEYS; i++ ) {
+		eError = eFlashKvRead( &xKv, i, pucData, sizeof( pucData ), &usLength );
+		bNew   = prvMatches( eError, pucData, usLength, pucValue[i], pusLength[i] );
+		bOld   = prvMatches( eError, pucData, usLength, pucPrevious[i], pusPrevious[i] );
+		if ( pbInFlight[i] && bCrashed ) {
+			CHECK( bNew || bOld, "crash %d: key %d of interrupted commit corrupt", iCrash, i );
+			iNew += bNew && !bOld;
+			iOld += bOld && !bNew;
+		}
+		else {
+			CHECK( bNew, "crash %d: key %d lost, error %d length %d of %d", iCrash, i, eError, usLength, pusLength[i] );
+		}
+	}
+	CHECK( ( iNew == 0 ) || ( iOld == 0 ), "crash %d: commit torn, %d new %d old", iCrash, iNew, iOld );
+	/* Follow the outcome of the interrupted commit */
+	for ( i = 0; i < NUM_KEYS; i++ ) {
+		if ( pbInFlight[i] && ( iOld > 0 ) ) {
+			memcpy( pucValue[i], pucPrevious[i], FLASH_KV_MAX_LENGTH );
+			pusLength[i] = pusPrevious[i];
+		}
+		pbInFlight[i] = false;
+	}
+	/* Counters hold the last written back value, or the value being written when power was cut */
+	for ( i = 0; i < NUM_COUNTERS; i++ ) {
+		if ( eFlashKvRead( &xKv, COUNTER_KEY + i, &ulValue, sizeof( ulValue ), NULL ) != ERROR_NONE ) {
+			ulValue = 0;
+		}
+		CHECK( ( ulValue == pulCounterFlash[i] ) || ( ulValue == pulCounterInFlight[i] ), "crash %d: counter %d is %u, %u on flash", iCrash, i, ulValue, pulCounterFlash[i] );
+		pulCounterFlash[i]	= ulValue;
+		pulCounterRam[i]	  = ulValue;
+		pulCounterInFlight[i] = ulValue;
+	}
+}
+
+static void prvCommit( void )
+{
+	static uint8_t pucData[4][FLASH_KV_MAX_LENGTH];
+	xFlashKvItem_t pxItems[4];
+	bool		   pbUsed[NUM_KEYS] = { 0 };
+	int			   iNum				= 1 + rand() % 4;
+	int			   i, j, iKey;
+	uint16_t	   usLength;
+
+	for ( i = 0; i < iNum; i++ ) {
+		do {
+			iKey = rand() % NUM_KEYS;
+		} while ( pbUsed[iKey] );
+		pbUsed[iKey] = true;
+		/* Mostly short values, with occasional deletes and maximum length values */
+		usLength = ( rand() % 10 == 0 ) ? 0 : 1 + rand() % ( ( rand() % 8 ) ? 32 : FLASH_KV_MAX_LENGTH );
+		for ( j = 0; j < usLength; j++ ) {
+			pucData[i][j] = rand();
+		}
+		pxItems[i] = ( xFlashKvItem_t ){ iKey, usLength, pucData[i] };
+		memcpy( pucPrevious[iKey], pucValue[iKey], FLASH_KV_MAX_LENGTH );
+		pusPrevious[iKey] = pusLength[iKey];
+		memcpy( pucValue[iKey], pucData[i], usLength );
+		pusLength[iKey]  = usLength;
+		pbInFlight[iKey] = true;
+	}
+	CHECK( eFlashKvCommit( &xKv, pxItems, iNum ) == ERROR_NONE, "commit" );
+	memset( pbInFlight, 0, sizeof( pbInFlight ) );
+}
+
+static void prvIncrement( void )
+{
+	int		 iCounter = rand() % NUM_COUNTERS;
+	uint32_t ulValue;
+	uint16_t i;
+
+	/* The increment that triggers a write back may or may not survive */
+	pulCounterRam[iCounter]++;
+	pulCounterInFlight[iCounter] = pulCounterRam[iCounter];
+	eFlashKvIncrement( &xKv, COUNTER_KEY + iCounter, &ulValue );
+	CHECK( ulValue == pulCounterRam[iCounter], "increment returned %u, expected %u", ulValue, pulCounterRam[iCounter] );
+	for ( i = 0; i < xKv.usNumKeys; i++ ) {
+		if ( ( xKv.pxIndex[i].usKey == COUNTER_KEY + iCounter ) && ( xKv.pxIndex[i].usDirty == 0 ) ) {
+			pulCounterFlash[iCounter] = pulCounterRam[iCounter];
+		}
+	}
+}
+
+static void prvOperation( void )
+{
+	int iOperation = rand() % 100;
+	int i;
+
+	if ( iOperation < 60 ) {
+		prvCommit();
+	}
+	else if ( iOperation < 95 ) {
+		prvIncrement();
+	}
+	else if ( iOperation < 98 ) {
+		for ( i = 0; i < NUM_COUNTERS; i++ ) {
+			pulCounterInFlight[i] = pulCounterRam[i];
+		}
+		eFlashKvFlush( &xKv );
+		for ( i = 0; i < NUM_COUNTERS; i++ ) {
+			pulCounterFlash[i] = pulCounterRam[i];
+		}
+	}
+	else {
+		eFlashKvCollect( &xKv, 3 );
+	}
+}
+
+static void prvPowerLoss( uint16_t usWriteback, int iCrashes )
+{
+	/* Locals modified between setjmp and longjmp are indeterminate unless volatile */
+	static int		  iCrash;
+	volatile uint32_t ulDiscarded = 0;
+
+	memset( pucMemory, 0xFF, sizeof( pucMemory ) );
+	memset( pusLength, 0, sizeof( pusLength ) );
+	memset( pusPrevious, 0, sizeof( pusPrevious ) );
+	memset( pulCounterFlash, 0, sizeof( pulCounterFlash ) );
+	memset( pulCounterRam, 0, sizeof( pulCounterRam ) );
+	memset( pulCounterInFlight, 0, sizeof( pulCounterInFlight ) );
+	srand( 7 + usWriteback );
+	prvBoot( usWriteback );
+	for ( iCrash = 0; iCrash < iCrashes; iCrash++ ) {
+		lCountdown = 1 + rand() % ( SECTOR_SIZE * ( 1 + rand() % 4 ) );
+		if ( setjmp( xPowerLoss ) == 0 ) {
+			for ( ;; ) {
+				prvOperation();
+			}
+		}
+		lCountdown = -1;
+		prvBoot( usWriteback );
+		ulDiscarded += xKv.xStats.ulDiscarded;
+		prvVerify( iCrash, true );
+		/* A clean reboot gives the same answer */
+		prvBoot( usWriteback );
+		prvVerify( iCrash, false );
+	}
+	printf( "counter write back %2d: %d power failures, %u discarded records\n", usWriteback, iCrashes, ulDiscarded );
+}
+
+/* Update cost, timed for nRF52840 internal flash at 41 us per 32 bit word and 85 ms per 4 kB erase */
+#define WORD_US 41.0
+#define ERASE_US 85000.0
+
+static double prvBenchmark( const char *pcName, uint16_t usLength, uint16_t usWriteback, bool bCounters, long lUpdates )
+{
+	uint8_t pucData[FLASH_KV_MAX_LENGTH];
+	double	dErases, dMicroseconds;
+	long	i;
+
+	memset( pucMemory, 0xFF, sizeof( pucMemory ) );
+	prvBoot( usWriteback );
+	/* 30 configuration keys, similar to the device_nvm key table */
+	for ( i = 0; i < 30; i++ ) {
+		memset( pucData, i, usLength );
+		eFlashKvWrite( &xKv, i, pucData, usLength );
+	}
+	lProgramBytes = 0;
+	lErases		  = 0;
+	srand( 1 );
+	for ( i = 0; i < lUpdates; i++ ) {
+		if ( bCounters ) {
+			eFlashKvIncrement( &xKv, 100 + i % 4, NULL );
+		}
+		else {
+			memset( pucData, i, usLength );
+			eFlashKvWrite( &xKv, rand() % 30, pucData, usLength );
+		}
+	}
+	eFlashKvFlush( &xKv );
+	dErases		  = (double) lErases / lUpdates;
+	dMicroseconds = ( lProgramBytes / 4 ) * WORD_US + lErases * ERASE_US;
+	printf( "%-34s %8.4f erases/update %8.0f updates/s\n", pcName, dErases, lUpdates / ( dMicroseconds / 1e6 ) );
+	return dErases;
+}
+
+static void prvBenchmarkRewrite( const char *pcName, uint16_t usLength )
+{
+	/* All keys in a single sector, rewritten on every update */
+	double dMicroseconds = ( 30 * ( usLength + 4 ) / 4 ) * WORD_US + ERASE_US;
+	printf( "%-34s %8.4f erases/update %8.0f updates/s\n", pcName, 1.0, 1e6 / dMicroseconds );
+}
+
+int main( void )
+{
+	prvPowerLoss( 1, 1500 );
+	prvPowerLoss( 16, 1500 );
+
+	/* Appending records must cost a small fraction of an erase per update */
+	prvBenchmarkRewrite( "rewrite whole sector, 4 B values", 4 );
+	CHECK( prvBenchmark( "flash_kv, 4 B values", 4, 1, false, 100000 ) < 0.01, "4 byte value erase rate" );
+	prvBenchmarkRewrite( "rewrite whole sector, 32 B values", 32 );
+	CHECK( prvBenchmark( "flash_kv, 32 B values", 32, 1, false, 100000 ) < 0.02, "32 byte value erase rate" );
+	prvBenchmark( "flash_kv, counters write through", 4, 1, true, 100000 );
+	CHECK( prvBenchmark( "flash_kv, counters write back 16", 4, 16, true, 100000 ) < 0.001, "write back counter erase rate" );
+
+	prvFreeAll();
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,550 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of flash erase suspension for queued reads, through bFlashWaitForRead and vFlashServiceReads
+ *
+ * The MX25R or W25X driver, selected by W25X_DEVICE_ID, erases sectors of a simulated SPI NOR
+ * flash while a reader queues FLASH_READ actions at random times. Every SPI byte is clocked through
+ * the flash model at 1 us per byte for the 8 MHz bus, and the RTOS tick advances with that clock.
+ * The model tracks the busy and suspended state and fails the run on commands the part would
+ * reject, reads of the sector being erased, or suspensions sooner than the driver's minimum erase
+ * progress. Each resume repeats part of the interrupted erase, so a driver that suspends for every
+ * read in a continuous stream never completes the erase.
+ *
+ * Erase times are between the datasheet typical and 1.5 times typical, latencies are relative to
+ * these assumptions rather than measurements of a particular part.
+ *
+ * flash_common.c and the driver are included directly so the driver can be run without the flash task.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_common.c"
+
+#ifdef W25X_DEVICE_ID
+#include "w25x.c"
+#define DRIVER				  xW25xDriver
+#define MIN_ERASE_PROGRESS	W25X_MIN_ERASE_PROGRESS
+#define POLL_DIVISOR		  W25X_POLL_DIVISOR
+#define CMD_WRITE_ENABLE	  W25X_CMD_WRITE_ENABLE
+#define CMD_READ_STATUS		  W25X_CMD_READ_STATUS_1
+#define CMD_READ			  W25X_CMD_READ
+#define CMD_SECTOR_ERASE	  W25X_CMD_ERASE_4K
+#define CMD_SUSPEND			  W25X_CMD_SUSPEND
+#define CMD_RESUME			  W25X_CMD_RESUME
+#define CMD_SUSPEND_STATUS	W25X_CMD_READ_STATUS_2
+#define SUSPEND_STATUS_MASK   W25X_MASK_STATUS2_SUSPENDED
+#define SUSPENDABLE			  ( W25X_DEVICE_ID >= W25X_DEVICE_ID_W25Q64FV )
+#define PART_NAME			  ( SUSPENDABLE ? "W25Q" : "W25X" )
+/* Capacity is 2 ^ ( ID + 1 ) bytes */
+#define FLASH_BYTES ( 1UL << ( W25X_DEVICE_ID + 1 ) )
+typedef xW25xHardware_t xHardware_t;
+#else
+#include "mx25r.c"
+#define DRIVER				  xMX25rDriver
+#define MIN_ERASE_PROGRESS	MX25R_MIN_ERASE_PROGRESS
+#define POLL_DIVISOR		  MX25R_POLL_DIVISOR
+#define CMD_WRITE_ENABLE	  MX25R_COMMAND_WREN
+#define CMD_READ_STATUS		  MX25R_COMMAND_READ_STATUS
+#define CMD_READ			  MX25R_COMMAND_PAGE_READ
+#define CMD_SECTOR_ERASE	  MX25R_COMMAND_SECTOR_ERASE
+#define CMD_SUSPEND			  MX25R_COMMAND_SUSPEND
+#define CMD_RESUME			  MX25R_COMMAND_RESUME
+#define CMD_SUSPEND_STATUS	MX25R_COMMAND_READ_SECURITY
+#define SUSPEND_STATUS_MASK   MX25R_SECURITY_ERASE_SUSPENDED
+#define SUSPENDABLE			  true
+#define PART_NAME			  "MX25R"
+#define FLASH_BYTES			  ( MX25R_PAGE_COUNT * MX25R_PAGE_SIZE )
+typedef xMX25rHardware_t xHardware_t;
+#endif
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+/* Flash timing assumptions, microseconds */
+#define TRANSACTION_US			  3.0	/**< Bus claim and CS overhead of each command */
+#define SUSPEND_US				  20.0   /**< Suspend command to WIP clearing, tESL / tSUS */
+#define ERASE_RESUME_PENALTY_US   1000.0 /**< Erase progress lost on each resume */
+
+#define TICK_US			( 1000000.0 / configTICK_RATE_HZ )
+#define BYTE_US			1.0
+#define SECTOR_BYTES	4096
+#define SECTOR_PAGES	16
+#define TEST_SECTORS	64
+#define READ_LEN		64
+#define NUM_ERASES		200
+#define FLOOD_GAP_US	500.0 /**< Reader queues its next read this long after the previous result */
+
+/* Returned in place of data that is undefined while the sector erases */
+#define UNDEFINED_BYTE 0x5A
+
+typedef struct xFlashModel_t
+{
+	uint8_t *pucMemory;
+	bool	 bCs;
+	bool	 bWel;
+	uint8_t  pucHeader[4];
+	int		 iHeaderLen;
+	uint32_t ulAddress;
+	/* Erase state */
+	bool	 bErasing;
+	bool	 bSuspended;
+	uint32_t ulEraseAddress;
+	double	 dRemainingUs;   /**< Erase time left as of dProgressFrom */
+	double	 dProgressFrom;  /**< Time the erase last started or resumed */
+	double	 dSuspendReady;  /**< Time WIP clears after a suspend */
+	double	 dCompleted;	 /**< Time the last erase finished */
+	/* Counts */
+	uint32_t ulSuspends;
+	uint32_t ulResumes;
+	double	 dSuspendedUs;
+} xFlashModel_t;
+
+typedef struct xReader_t
+{
+	xFlashAction_t xAction;
+	bool		   bQueued;  /**< Read is in the flash command queue */
+	bool		   bFlood;   /**< Queue another read after each result */
+	double		   dArrival; /**< Time the read was queued */
+	double		   dServed;  /**< Time the result was returned, negative while outstanding */
+	eModuleError_t eResult;
+	uint8_t		   pucData[READ_LEN];
+	uint32_t	   ulReads;
+	double		   dWorstUs;
+} xReader_t;
+
+static xFlashModel_t  xFlash;
+static xReader_t	  xReader;
+static double		  dNowUs;
+static xSpiModule_t   xSpi;
+static xHardware_t	xHardware = { .pxInterface = &xSpi };
+static xFlashDevice_t xDevice	= { .pcName = PART_NAME, .pxImplementation = &DRIVER, .pxHardware = (xFlashDefaultHardware_t *) &xHardware };
+
+/*-----------------------------------------------------------*/
+
+/* Simulated time drives the RTOS tick, the only other task is the reader */
+
+TickType_t xTaskGetTickCount( void )
+{
+	return (TickType_t) ( dNowUs / TICK_US );
+}
+
+void vTaskDelay( TickType_t xTicks )
+{
+	dNowUs = ( xTaskGetTickCount() + xTicks ) * TICK_US;
+}
+
+/* Blocks until the reader's action is queued or the timeout expires */
+static BaseType_t prvQueueWait( void *pvBuffer, TickType_t xTicksToWait, bool bRemove )
+{
+	double dDeadline = fmax( dNowUs, ( xTaskGetTickCount() + (double) xTicksToWait ) * TICK_US );
+	if ( xReader.bQueued && ( xReader.dArrival <= dDeadline ) ) {
+		dNowUs = fmax( dNowUs, xReader.dArrival );
+		memcpy( pvBuffer, &xReader.xAction, sizeof( xFlashAction_t ) );
+		xReader.bQueued = !bRemove;
+		return pdPASS;
+	}
+	dNowUs = dDeadline;
+	return pdFAIL;
+}
+
+BaseType_t xQueuePeek( QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait )
+{
+	return prvQueueWait( pvBuffer, xTicksToWait, false );
+}
+
+BaseType_t xQueueReceive( QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait )
+{
+	return prvQueueWait( pvBuffer, xTicksToWait, true );
+}
+
+static void prvReaderQueue( uint32_t ulAddress, double dArrival )
+{
+	xReader.xAction.eCommand		= FLASH_READ;
+	xReader.xAction.ullFlashAddress = ulAddress;
+	xReader.xAction.pucArg1			= xReader.pucData;
+	xReader.xAction.ulLength		= READ_LEN;
+	xReader.xAction.xResponseTask   = &xReader;
+	xReader.xAction.peResult		= &xReader.eResult;
+	xReader.eResult					= ERROR_GENERIC;
+	xReader.bQueued					= true;
+	xReader.dArrival				= dArrival;
+	xReader.dServed					= -1;
+	memset( xReader.pucData, 0, READ_LEN );
+}
+
+/* Result of the reader's action */
+BaseType_t xTaskNotifyGive( TaskHandle_t xTask )
+{
+	uint32_t ulAddress = (uint32_t) xReader.xAction.ullFlashAddress;
+	CHECK( xTask == &xReader, "result sent to the wrong task" );
+	CHECK( xReader.eResult == ERROR_NONE, "read failed %d", xReader.eResult );
+	CHECK( memcmp( xReader.pucData, xFlash.pucMemory + ulAddress, READ_LEN ) == 0, "read of %u returned the wrong data", ulAddress );
+	xReader.dServed  = dNowUs;
+	xReader.dWorstUs = fmax( xReader.dWorstUs, dNowUs - xReader.dArrival );
+	xReader.ulReads++;
+	if ( xReader.bFlood ) {
+		prvReaderQueue( ulAddress, dNowUs + FLOOD_GAP_US );
+	}
+	return pdPASS;
+}
+
+void vGpioSetup( xGpio_t xGpio, eGpioType_t eType, uint32_t ulParam ) {}
+
+void vEnergyActive( eEnergySubsystem_t eSubsystem, bool bActive ) {}
+
+void vCrcStart( eCrcPolynomial_t ePolynomial, uint32_t ulInitial ) {}
+
+uint32_t ulCrcCalculate( uint8_t *pucData, uint32_t ulLen, bool bFinal )
+{
+	return 0;
+}
+
+eModuleError_t eNvmReadData( eNvmKey_t eKey, void *pvData )
+{
+	return ERROR_INVALID_DATA;
+}
+
+eModuleError_t eNvmWriteData( eNvmKey_t eKey, void *pvData )
+{
+	return ERROR_NONE;
+}
+
+eModuleError_t eNvmEraseKey( eNvmKey_t eKey )
+{
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Flash model */
+
+static void prvFlashUpdate( void )
+{
+	if ( xFlash.bErasing && !xFlash.bSuspended && ( dNowUs >= xFlash.dProgressFrom + xFlash.dRemainingUs ) ) {
+		xFlash.bErasing   = false;
+		xFlash.dCompleted = xFlash.dProgressFrom + xFlash.dRemainingUs;
+		memset( xFlash.pucMemory + xFlash.ulEraseAddress, 0xFF, SECTOR_BYTES );
+	}
+}
+
+static bool prvFlashBusy( void )
+{
+	return xFlash.bErasing && ( !xFlash.bSuspended || ( dNowUs < xFlash.dSuspendReady ) );
+}
+
+static bool prvFlashInErase( uint32_t ulAddress )
+{
+	return xFlash.bErasing && ( ulAddress >= xFlash.ulEraseAddress ) && ( ulAddress < xFlash.ulEraseAddress + SECTOR_BYTES );
+}
+
+static void prvFlashSuspend( void )
+{
+	CHECK( SUSPENDABLE, "suspend sent to a part without suspend" );
+	if ( !xFlash.bErasing || xFlash.bSuspended ) {
+		return;
+	}
+	/* The erase has to run between suspensions to make progress */
+	CHECK( dNowUs - xFlash.dProgressFrom >= ( MIN_ERASE_PROGRESS - 1 ) * TICK_US, "suspended %.0f us after the erase resumed", dNowUs - xFlash.dProgressFrom );
+	xFlash.dRemainingUs -= dNowUs - xFlash.dProgressFrom;
+	xFlash.bSuspended	= true;
+	xFlash.dSuspendReady = dNowUs + SUSPEND_US;
+	xFlash.ulSuspends++;
+}
+
+static void prvFlashResume( void )
+{
+	CHECK( xFlash.bErasing && xFlash.bSuspended, "resume without a suspended erase" );
+	xFlash.dSuspendedUs += dNowUs - xFlash.dSuspendReady + SUSPEND_US;
+	xFlash.bSuspended	= false;
+	xFlash.dRemainingUs += ERASE_RESUME_PENALTY_US;
+	xFlash.dProgressFrom = dNowUs;
+	xFlash.ulResumes++;
+}
+
+static void prvFlashEraseStart( uint32_t ulAddress )
+{
+	const double dTypicalUs = 1000.0 * xTimingSectorErase.ulTypicalMs;
+	CHECK( xFlash.bWel, "erase without write enable" );
+	CHECK( !xFlash.bErasing, "erase while another erase is suspended" );
+	CHECK( ( ulAddress % SECTOR_BYTES ) == 0, "erase address %u not sector aligned", ulAddress );
+	xFlash.bWel			  = false;
+	xFlash.bErasing		  = true;
+	xFlash.bSuspended	  = false;
+	xFlash.ulEraseAddress = ulAddress;
+	xFlash.dRemainingUs   = dTypicalUs * ( 1.0 + 0.5 * rand() / RAND_MAX );
+	xFlash.dProgressFrom  = dNowUs;
+}
+
+static uint8_t prvFlashExchange( uint8_t ucMosi )
+{
+	uint8_t ucCommand = xFlash.pucHeader[0];
+	uint8_t ucMiso	= 0xFF;
+
+	prvFlashUpdate();
+	dNowUs += BYTE_US;
+	if ( xFlash.iHeaderLen == 0 ) {
+		xFlash.pucHeader[xFlash.iHeaderLen++] = ucMosi;
+		/* Only status and suspend commands are accepted while the part is busy */
+		if ( prvFlashBusy() ) {
+			CHECK( ( ucMosi == CMD_READ_STATUS ) || ( ucMosi == CMD_SUSPEND ) || ( ucMosi == CMD_SUSPEND_STATUS ), "command 0x%02X while busy", ucMosi );
+		}
+		switch ( ucMosi ) {
+			case CMD_READ_STATUS:
+			case CMD_SUSPEND_STATUS:
+			case CMD_READ:
+			case CMD_SECTOR_ERASE:
+#ifdef W25X_DEVICE_ID
+			case W25X_CMD_DEVICE_ID:
+			case W25X_CMD_DEEP_PWR_DOWN:
+			case W25X_CMD_RELEASE_PWR_DOWN:
+#else
+			case MX25R_COMMAND_READ_IDENTIFICATION:
+			case MX25R_COMMAND_POWER_DOWN:
+#endif
+				break;
+			case CMD_WRITE_ENABLE:
+				xFlash.bWel = true;
+				break;
+			case CMD_SUSPEND:
+				prvFlashSuspend();
+				break;
+			case CMD_RESUME:
+				prvFlashResume();
+				break;
+			default:
+				/* Block and chip erases would remove data outside the requested sector */
+				CHECK( 0, "unexpected command 0x%02X", ucMosi );
+				break;
+		}
+		return ucMiso;
+	}
+	switch ( ucCommand ) {
+		case CMD_READ_STATUS:
+			return ( prvFlashBusy() ? 0x01 : 0x00 ) | ( xFlash.bWel ? 0x02 : 0x00 );
+		case CMD_SUSPEND_STATUS:
+			return ( xFlash.bErasing && xFlash.bSuspended ) ? SUSPEND_STATUS_MASK : 0x00;
+#ifdef W25X_DEVICE_ID
+		case W25X_CMD_DEVICE_ID:
+			if ( xFlash.iHeaderLen < 4 ) {
+				xFlash.iHeaderLen++;
+				return ucMiso;
+			}
+			return ( xFlash.iHeaderLen++ == 4 ) ? 0xEF : W25X_DEVICE_ID;
+#else
+		case MX25R_COMMAND_READ_IDENTIFICATION:
+			return 0xC2;
+#endif
+		case CMD_READ:
+		case CMD_SECTOR_ERASE:
+			if ( xFlash.iHeaderLen < 4 ) {
+				xFlash.pucHeader[xFlash.iHeaderLen++] = ucMosi;
+				xFlash.ulAddress					  = ( xFlash.ulAddress << 8 ) | ucMosi;
+				if ( ( xFlash.iHeaderLen == 4 ) && ( ucCommand == CMD_READ ) ) {
+					CHECK( !prvFlashInErase( xFlash.ulAddress ), "read of %u in the sector being erased", xFlash.ulAddress );
+				}
+				return ucMiso;
+			}
+			if ( ucCommand == CMD_READ ) {
+				ucMiso = prvFlashInErase( xFlash.ulAddress ) ? UNDEFINED_BYTE : xFlash.pucMemory[xFlash.ulAddress % FLASH_BYTES];
+				xFlash.ulAddress++;
+			}
+			return ucMiso;
+		default:
+			return ucMiso;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+/* SPI bus, every transfer is clocked through the flash */
+
+eModuleError_t eSpiBusStart( xSpiModule_t *pxSpi, const xSpiConfig_t *xConfig, TickType_t xTimeout )
+{
+	CHECK( !pxSpi->bBusClaimed, "bus claimed twice" );
+	pxSpi->bBusClaimed	   = true;
+	pxSpi->pxCurrentConfig = xConfig;
+	return ERROR_NONE;
+}
+
+void vSpiBusEnd( xSpiModule_t *pxSpi )
+{
+	CHECK( pxSpi->bBusClaimed, "bus released while not claimed" );
+	CHECK( !xFlash.bCs, "bus released with CS asserted" );
+	pxSpi->bBusClaimed = false;
+}
+
+void vSpiCsAssert( xSpiModule_t *pxSpi )
+{
+	pxSpi->bCsAsserted = true;
+	xFlash.bCs		   = true;
+	xFlash.iHeaderLen  = 0;
+	xFlash.ulAddress   = 0;
+	dNowUs += TRANSACTION_US;
+}
+
+void vSpiCsRelease( xSpiModule_t *pxSpi )
+{
+	pxSpi->bCsAsserted = false;
+	xFlash.bCs		   = false;
+	/* Erases start once CS rises after a complete address */
+	if ( ( xFlash.pucHeader[0] == CMD_SECTOR_ERASE ) && ( xFlash.iHeaderLen == 4 ) ) {
+		prvFlashEraseStart( xFlash.ulAddress );
+	}
+	xFlash.pucHeader[0] = 0x00;
+}
+
+void vSpiTransmit( xSpiModule_t *pxSpi, void *pvBuffer, uint32_t ulBufferLen )
+{
+	CHECK( pxSpi->bBusClaimed, "transmit without the bus" );
+	for ( uint32_t i = 0; i < ulBufferLen; i++ ) {
+		prvFlashExchange( ( (uint8_t *) pvBuffer )[i] );
+	}
+	pxSpi->xPlatform.ulBytes += ulBufferLen;
+}
+
+void vSpiReceive( xSpiModule_t *pxSpi, void *pvBuffer, uint32_t ulBufferLen )
+{
+	CHECK( pxSpi->bBusClaimed, "receive without the bus" );
+	for ( uint32_t i = 0; i < ulBufferLen; i++ ) {
+		( (uint8_t *) pvBuffer )[i] = prvFlashExchange( 0xFF );
+	}
+	pxSpi->xPlatform.ulBytes += ulBufferLen;
+}
+
+/*-----------------------------------------------------------*/
+
+typedef enum eReadPlacement_t {
+	READ_NONE,	/**< No reads during the erase */
+	READ_OUTSIDE, /**< One read of another sector at a random time */
+	READ_INSIDE,  /**< One read of the sector being erased at a random time */
+	READ_FLOOD	/**< Reads of another sector queued continuously */
+} eReadPlacement_t;
+
+typedef struct xResult_t
+{
+	double dEraseUs;	 /**< Mean time in the erase call */
+	double dNoticeUs;	/**< Worst time from completion to the erase call returning */
+	double dLatencyUs;   /**< Mean read latency */
+	double dWorstUs;	 /**< Worst read latency */
+	double dSuspends;	/**< Mean suspensions per erase */
+	uint32_t ulReads;
+} xResult_t;
+
+/* Runs a queued read as the flash task does once the driver returns */
+static void prvServeQueued( void )
+{
+	xFlashSettings_t *pxSettings = &xDevice.xSettings;
+	xFlashAction_t	xAction;
+	if ( !xReader.bQueued ) {
+		return;
+	}
+	configASSERT( xQueueReceive( xDevice.xCommandQueue, &xAction, portMAX_DELAY ) == pdPASS );
+	*xAction.peResult = prvFlashIteratePages( &xDevice, prvFlashIterateRead, xAction.pucArg1, (uint32_t) ( xAction.ullFlashAddress >> pxSettings->ucPageSizePower ),
+											  (uint16_t) ( xAction.ullFlashAddress & pxSettings->usPageOffsetMask ), xAction.ulLength );
+	xTaskNotifyGive( xAction.xResponseTask );
+}
+
+static xResult_t prvRun( eReadPlacement_t ePlacement, uint32_t ulErases )
+{
+	const TickType_t xTypical  = pdMS_TO_TICKS( xTimingSectorErase.ulTypicalMs );
+	const double	 dPollUs   = MAX( 1, xTypical / POLL_DIVISOR ) * TICK_US;
+	xResult_t		 xResult   = { 0 };
+	double			 dLatencyUs = 0;
+	uint32_t		 ulSector, ulReadSector, i;
+
+	memset( &xReader, 0, sizeof( xReader ) );
+	xFlash.ulSuspends   = 0;
+	xFlash.ulResumes	= 0;
+	xFlash.dSuspendedUs = 0;
+	for ( i = 0; i < ulErases; i++ ) {
+		ulSector	 = rand() % TEST_SECTORS;
+		ulReadSector = ( ePlacement == READ_INSIDE ) ? ulSector : ( ulSector + 1 + rand() % ( TEST_SECTORS - 1 ) ) % TEST_SECTORS;
+		/* Sectors hold data before each erase, so reads of erased and unerased data differ */
+		for ( uint32_t j = 0; j < SECTOR_BYTES; j++ ) {
+			xFlash.pucMemory[ulSector * SECTOR_BYTES + j] = rand();
+		}
+		/* Erases start at a random point within a tick */
+		dNowUs += TICK_US * rand() / RAND_MAX;
+		double dStart = dNowUs;
+
+		xReader.bFlood = ( ePlacement == READ_FLOOD );
+		if ( ePlacement != READ_NONE ) {
+			prvReaderQueue( ulReadSector * SECTOR_BYTES + ( rand() % ( SECTOR_BYTES - READ_LEN ) ), dStart + 1.5e3 * xTimingSectorErase.ulTypicalMs * rand() / RAND_MAX );
+		}
+		eModuleError_t eError = DRIVER.fnErasePages( &xDevice, ulSector * SECTOR_PAGES, SECTOR_PAGES );
+		CHECK( eError == ERROR_NONE, "erase of sector %u failed %d", ulSector, eError );
+		CHECK( !xFlash.bErasing, "erase of sector %u returned before completion", ulSector );
+		xResult.dEraseUs += dNowUs - dStart;
+		xResult.dNoticeUs = fmax( xResult.dNoticeUs, dNowUs - xFlash.dCompleted );
+		/* Completion is seen within a poll period once the typical time has passed */
+		CHECK( dNowUs - xFlash.dCompleted <= dPollUs + TICK_US, "erase completion noticed after %.0f us", dNowUs - xFlash.dCompleted );
+
+		xReader.bFlood = false;
+		prvServeQueued();
+		if ( ePlacement == READ_NONE ) {
+			continue;
+		}
+		/* The most recent read of a flood may have been queued after the erase finished */
+		CHECK( xReader.dServed >= 0, "read not serviced" );
+		dLatencyUs += xReader.dServed - xReader.dArrival;
+		if ( ( ePlacement == READ_INSIDE ) || !SUSPENDABLE ) {
+			CHECK( xReader.dServed >= xFlash.dCompleted, "read serviced during the erase" );
+		}
+		else {
+			/* A read waits at most until the erase has run for the minimum progress after starting or resuming */
+			CHECK( xReader.dServed - xReader.dArrival <= ( MIN_ERASE_PROGRESS + 1 ) * TICK_US, "read of sector %u waited %.0f us", ulReadSector,
+				   xReader.dServed - xReader.dArrival );
+		}
+	}
+	xResult.ulReads	= xReader.ulReads;
+	xResult.dEraseUs   = xResult.dEraseUs / ulErases;
+	xResult.dLatencyUs = ( ePlacement == READ_FLOOD ) ? 0 : dLatencyUs / ulErases;
+	xResult.dWorstUs   = xReader.dWorstUs;
+	xResult.dSuspends  = (double) xFlash.ulSuspends / ulErases;
+	CHECK( xFlash.ulSuspends == xFlash.ulResumes, "%u suspends, %u resumes", xFlash.ulSuspends, xFlash.ulResumes );
+	return xResult;
+}
+
+int main( void )
+{
+	xResult_t xNone, xOutside, xInside, xFlood;
+
+	xFlash.pucMemory	  = malloc( FLASH_BYTES );
+	xDevice.xCommandQueue = &xReader;
+	memset( xFlash.pucMemory, 0xFF, FLASH_BYTES );
+	CHECK( DRIVER.fnInit( &xDevice ) == ERROR_NONE, "init" );
+	CHECK( xDevice.xSettings.ulNumPages * xDevice.xSettings.usPageSize == FLASH_BYTES, "%u pages", xDevice.xSettings.ulNumPages );
+
+	srand( 1 );
+	xNone	= prvRun( READ_NONE, NUM_ERASES );
+	xOutside = prvRun( READ_OUTSIDE, NUM_ERASES );
+	xInside  = prvRun( READ_INSIDE, NUM_ERASES );
+	/* Without a minimum progress between suspensions, the erase would never complete */
+	xFlood = prvRun( READ_FLOOD, 20 );
+
+	printf( "%s: %d sector erases, tick %.2f ms, minimum erase progress %u ticks\n", PART_NAME, NUM_ERASES, TICK_US / 1000, (unsigned) MIN_ERASE_PROGRESS );
+	printf( "  read outside the sector: mean %5.2f ms, worst %5.2f ms, %.2f suspends per erase\n", xOutside.dLatencyUs / 1000, xOutside.dWorstUs / 1000,
+			xOutside.dSuspends );
+	printf( "  read inside the sector:  mean %5.2f ms, worst %5.2f ms, %.2f suspends per erase\n", xInside.dLatencyUs / 1000, xInside.dWorstUs / 1000,
+			xInside.dSuspends );
+	printf( "  erase call: %.2f ms without reads, %.2f ms with a read outside, %.2f ms with a read inside, done seen within %.2f ms\n", xNone.dEraseUs / 1000,
+			xOutside.dEraseUs / 1000, xInside.dEraseUs / 1000, fmax( xNone.dNoticeUs, xOutside.dNoticeUs ) / 1000 );
+	printf( "  continuous reads: erase call %.2f ms, %.1f suspends per erase, %u reads, worst %.2f ms\n", xFlood.dEraseUs / 1000, xFlood.dSuspends, xFlood.ulReads,
+			xFlood.dWorstUs / 1000 );
+
+	free( xFlash.pucMemory );
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
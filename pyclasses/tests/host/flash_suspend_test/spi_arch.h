@@ -0,0 +1,21 @@
+/*
+ * Host model of the SPI platform, transfers are clocked through the simulated flash in flash_suspend_test.c
+ */
+#ifndef __CORE_CSIRO_HOST_SPI_ARCH_H__
+#define __CORE_CSIRO_HOST_SPI_ARCH_H__
+
+#include "gpio.h"
+
+#define SPI_MODULE_PLATFORM_PREFIX( NAME )
+#define SPI_MODULE_PLATFORM_SUFFIX( NAME, IRQ )
+#define SPI_MODULE_PLATFORM_DEFAULT( NAME, HANDLE ) \
+	{                                               \
+		0                                           \
+	}
+
+struct _xSpiPlatform_t
+{
+	uint32_t ulBytes; /**< Bytes clocked while the bus was claimed */
+};
+
+#endif /* __CORE_CSIRO_HOST_SPI_ARCH_H__ */
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Accelerated wear simulation of the flash_wear translation layer against a NOR flash model
+ *
+ * Every sector of the model has a random endurance of ENDURANCE_MIN to ENDURANCE_MAX erases,
+ * far below a real part so that sectors wear out in seconds. Erases beyond the endurance fail
+ * and leave the sector unerased, clearing bits still succeeds so worn sectors can be marked retired.
+ *
+ * Each cycle the log is cleared and refilled to REFILL_PERCENT of its capacity from the start,
+ * as a logger does after its data is downloaded and erased, while the first STATIC_SECTORS hold data
+ * that is written once. The workload is run with direct mapping, with dynamic levelling only, and
+ * with dynamic and static levelling, reporting the cycles until the first sector wears out.
+ * Data written through the layer must read back until no usable sectors remain, and the mapping
+ * rebuilt from flash must match the mapping in RAM.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crc.h"
+#include "flash_wear.h"
+
+#define PAGE_SIZE		   256
+#define SECTOR_PAGES	   16
+#define SECTOR_BYTES	   ( SECTOR_PAGES * PAGE_SIZE )
+#define NUM_SECTORS		   64
+#define NUM_SPARES		   8
+#define STATIC_SECTORS	   4
+#define STATIC_THRESHOLD   64
+#define ENDURANCE_MIN	   800
+#define ENDURANCE_MAX	   1200
+#define REFILL_PERCENT	   20
+#define MAX_CYCLES		   50000
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+typedef enum eMapping_t {
+	MAPPING_DIRECT,  /**< Logical sectors are physical sectors */
+	MAPPING_DYNAMIC, /**< flash_wear without static levelling */
+	MAPPING_STATIC   /**< flash_wear with static levelling */
+} eMapping_t;
+
+typedef struct xResult_t
+{
+	uint32_t ulFirstWorn;   /**< Cycle in which the first sector wore out */
+	uint32_t ulCycles;		/**< Cycles completed before no usable sectors remained */
+	uint32_t ulStaticMoves;
+	uint32_t ulRetired;
+} xResult_t;
+
+static uint8_t  pucMemory[NUM_SECTORS * SECTOR_BYTES], pucPage[PAGE_SIZE];
+static uint32_t pulEndurance[NUM_SECTORS], pulErases[NUM_SECTORS];
+static uint32_t ulCycle, ulFirstWorn;
+
+static xFlashDevice_t xDevice = {
+	.xSettings = { .ulNumPages = NUM_SECTORS * SECTOR_PAGES, .usPageSize = PAGE_SIZE, .usErasePages = SECTOR_PAGES, .ucEraseByte = 0xFF, .ucPageSizePower = 8, .usPageOffsetMask = PAGE_SIZE - 1, .pucPage = pucPage },
+	.pcName	= "HOST"
+};
+
+/*-----------------------------------------------------------*/
+
+static bool prvWorn( uint32_t ulSector )
+{
+	return pulErases[ulSector] > pulEndurance[ulSector];
+}
+
+eModuleError_t eFlashRead( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout )
+{
+	memcpy( pucData, pucMemory + ullAddress, ulLength );
+	return ERROR_NONE;
+}
+
+/* Programming can only clear bits */
+eModuleError_t eFlashWrite( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout )
+{
+	uint32_t i;
+	for ( i = 0; i < ulLength; i++ ) {
+		pucMemory[ullAddress + i] &= pucData[i];
+	}
+	return ERROR_NONE;
+}
+
+/* Erases beyond the endurance of a sector fail and leave it unerased */
+eModuleError_t eFlashErase( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint32_t ulLength, TickType_t xTimeout )
+{
+	uint32_t ulSector = ullAddress / SECTOR_BYTES;
+	CHECK( ( ullAddress % SECTOR_BYTES == 0 ) && ( ulLength == SECTOR_BYTES ), "erase of %u bytes at %u", ulLength, (uint32_t) ullAddress );
+	pulErases[ulSector]++;
+	if ( prvWorn( ulSector ) ) {
+		if ( ulFirstWorn == 0 ) {
+			ulFirstWorn = ulCycle;
+		}
+		return ERROR_FLASH_OPERATION_FAIL;
+	}
+	memset( pucMemory + ullAddress, 0xFF, ulLength );
+	return ERROR_NONE;
+}
+
+static uint16_t usCrc;
+
+void vCrcStart( eCrcPolynomial_t ePolynomial, uint32_t ulInitial )
+{
+	usCrc = ulInitial;
+}
+
+uint32_t ulCrcCalculate( uint8_t *pucData, uint32_t ulLen, bool bFinal )
+{
+	int i;
+	while ( ulLen-- ) {
+		usCrc ^= (uint16_t) *pucData++ << 8;
+		for ( i = 0; i < 8; i++ ) {
+			usCrc = ( usCrc & 0x8000 ) ? ( usCrc << 1 ) ^ 0x1021 : usCrc << 1;
+		}
+	}
+	return usCrc;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Contents of a logical page, written in ulCycle */
+static void prvPattern( uint32_t ulPage, uint32_t ulWritten, uint8_t *pucData )
+{
+	uint32_t i;
+	for ( i = 0; i < PAGE_SIZE; i++ ) {
+		pucData[i] = ( ulPage * 31 ) ^ ( ulWritten * 7 ) ^ i;
+	}
+}
+
+/* Logical sector operations through the layer, or directly onto the physical sector */
+static eModuleError_t prvErase( xFlashWear_t *pxWear, uint32_t ulSector )
+{
+	if ( pxWear == NULL ) {
+		return eFlashErase( &xDevice, ulSector * SECTOR_BYTES, SECTOR_BYTES, 0 );
+	}
+	return eFlashWearErase( pxWear, ulSector );
+}
+
+static eModuleError_t prvWrite( xFlashWear_t *pxWear, uint32_t ulPage, uint8_t *pucData )
+{
+	if ( pxWear == NULL ) {
+		return eFlashWrite( &xDevice, ulPage * PAGE_SIZE, pucData, PAGE_SIZE, 0 );
+	}
+	return eFlashWearWrite( pxWear, ulPage, pucData, PAGE_SIZE );
+}
+
+static bool prvReadMatches( xFlashWear_t *pxWear, uint32_t ulPage, uint32_t ulWritten )
+{
+	uint8_t pucExpected[PAGE_SIZE], pucData[PAGE_SIZE];
+	prvPattern( ulPage, ulWritten, pucExpected );
+	if ( pxWear == NULL ) {
+		eFlashRead( &xDevice, ulPage * PAGE_SIZE, pucData, PAGE_SIZE, 0 );
+	}
+	else {
+		eFlashWearRead( pxWear, ulPage, 0, pucData, PAGE_SIZE );
+	}
+	return memcmp( pucData, pucExpected, PAGE_SIZE ) == 0;
+}
+
+/* Fills logical sectors [ulFirst, ulFirst + ulCount) with data from cycle ulWritten */
+static eModuleError_t prvFill( xFlashWear_t *pxWear, uint32_t ulFirst, uint32_t ulCount, uint32_t ulDataPages, uint32_t ulWritten )
+{
+	uint8_t		   pucData[PAGE_SIZE];
+	eModuleError_t eError;
+	uint32_t	   ulSector, ulPage;
+	for ( ulSector = ulFirst; ulSector < ulFirst + ulCount; ulSector++ ) {
+		eError = prvErase( pxWear, ulSector );
+		for ( ulPage = ulSector * ulDataPages; ( eError == ERROR_NONE ) && ( ulPage < ( ulSector + 1 ) * ulDataPages ); ulPage++ ) {
+			prvPattern( ulPage, ulWritten, pucData );
+			eError = prvWrite( pxWear, ulPage, pucData );
+		}
+		if ( eError != ERROR_NONE ) {
+			return eError;
+		}
+	}
+	return ERROR_NONE;
+}
+
+static xResult_t prvRun( eMapping_t eMapping )
+{
+	xFlashWear_t	  xWear		  = { .pxDevice = &xDevice, .ulFirstSector = 0, .usNumSectors = NUM_SECTORS, .usNumSpares = NUM_SPARES };
+	xFlashWear_t *	pxWear	  = ( eMapping == MAPPING_DIRECT ) ? NULL : &xWear;
+	uint32_t		  ulLogical	= ( pxWear == NULL ) ? NUM_SECTORS : NUM_SECTORS - NUM_SPARES;
+	uint32_t		  ulDataPages = ( pxWear == NULL ) ? SECTOR_PAGES : SECTOR_PAGES - 1;
+	uint32_t		  ulRefill	= ( ( ulLogical - STATIC_SECTORS ) * REFILL_PERCENT + 99 ) / 100;
+	xResult_t		  xResult	 = { 0 };
+	xFlashWearStats_t xStats;
+	eModuleError_t	eError;
+	uint32_t		  i, ulPage;
+
+	/* Every run sees the same endurance */
+	srand( 1 );
+	for ( i = 0; i < NUM_SECTORS; i++ ) {
+		pulEndurance[i] = ENDURANCE_MIN + rand() % ( ENDURANCE_MAX - ENDURANCE_MIN + 1 );
+		pulErases[i]	= 0;
+	}
+	memset( pucMemory, 0xFF, sizeof( pucMemory ) );
+	ulFirstWorn = 0;
+	ulCycle		= 0;
+	xWear.ulStaticThreshold = ( eMapping == MAPPING_STATIC ) ? STATIC_THRESHOLD : 0;
+	if ( pxWear != NULL ) {
+		CHECK( eFlashWearInit( pxWear ) == ERROR_NONE, "init" );
+	}
+	CHECK( prvFill( pxWear, 0, STATIC_SECTORS, ulDataPages, 0 ) == ERROR_NONE, "static data" );
+
+	for ( ulCycle = 1; ulCycle <= MAX_CYCLES; ulCycle++ ) {
+		eError = prvFill( pxWear, STATIC_SECTORS, ulRefill, ulDataPages, ulCycle );
+		/* Without the layer the first worn sector loses data */
+		if ( ( eError != ERROR_NONE ) || ( ( pxWear == NULL ) && ( ulFirstWorn != 0 ) ) ) {
+			CHECK( ( pxWear == NULL ) || ( eError == ERROR_DEVICE_FULL ), "cycle %u failed %d", ulCycle, eError );
+			break;
+		}
+		/* Spot check the new data and the static data */
+		ulPage = ( STATIC_SECTORS * ulDataPages ) + rand() % ( ulRefill * ulDataPages );
+		CHECK( prvReadMatches( pxWear, ulPage, ulCycle ), "cycle %u page %u", ulCycle, ulPage );
+		ulPage = rand() % ( STATIC_SECTORS * ulDataPages );
+		CHECK( prvReadMatches( pxWear, ulPage, 0 ), "cycle %u static page %u", ulCycle, ulPage );
+		if ( iErrors ) {
+			break;
+		}
+	}
+	xResult.ulFirstWorn = ulFirstWorn;
+	xResult.ulCycles	= ulCycle - 1;
+	if ( pxWear == NULL ) {
+		return xResult;
+	}
+	vFlashWearStats( pxWear, &xStats );
+	xResult.ulStaticMoves = xStats.ulStaticMoves;
+	xResult.ulRetired	  = xStats.ulRetired;
+
+	/* The mapping rebuilt from flash matches the mapping in RAM, and holds the static data */
+	xFlashWear_t xRebuilt = { .pxDevice = &xDevice, .ulFirstSector = 0, .usNumSectors = NUM_SECTORS, .usNumSpares = NUM_SPARES };
+	CHECK( eFlashWearInit( &xRebuilt ) == ERROR_NONE, "rebuild" );
+	CHECK( xRebuilt.xStats.ulRetired == xStats.ulRetired, "%u retired after rebuild, %u before", xRebuilt.xStats.ulRetired, xStats.ulRetired );
+	CHECK( memcmp( xRebuilt.pusMap, xWear.pusMap, ulLogical * sizeof( uint16_t ) ) == 0, "mapping differs after rebuild" );
+	for ( ulPage = 0; ulPage < STATIC_SECTORS * ulDataPages; ulPage++ ) {
+		CHECK( prvReadMatches( &xRebuilt, ulPage, 0 ), "static page %u after rebuild", ulPage );
+	}
+	for ( i = 0; i < 2; i++ ) {
+		pxWear = ( i == 0 ) ? &xWear : &xRebuilt;
+		vPortFree( pxWear->pusMap );
+		vPortFree( pxWear->pusOwner );
+		vPortFree( pxWear->pulEraseCount );
+		vPortFree( pxWear->pucPage );
+	}
+	return xResult;
+}
+
+int main( void )
+{
+	xResult_t xDirect, xDynamic, xStatic;
+
+	xDirect  = prvRun( MAPPING_DIRECT );
+	xDynamic = prvRun( MAPPING_DYNAMIC );
+	xStatic  = prvRun( MAPPING_STATIC );
+
+	printf( "%d sectors, endurance %d-%d erases, %d static sectors, %d%% of the log refilled each cycle\n", NUM_SECTORS, ENDURANCE_MIN, ENDURANCE_MAX, STATIC_SECTORS,
+			REFILL_PERCENT );
+	printf( "  direct mapping:   first sector worn after %5u cycles\n", xDirect.ulFirstWorn );
+	printf( "  dynamic only:     first sector worn after %5u cycles (%.1fx), %u cycles until no usable sectors, %u retired\n", xDynamic.ulFirstWorn,
+			(double) xDynamic.ulFirstWorn / xDirect.ulFirstWorn, xDynamic.ulCycles, xDynamic.ulRetired );
+	printf( "  dynamic + static: first sector worn after %5u cycles (%.1fx), %u cycles until no usable sectors, %u retired, %u static moves\n", xStatic.ulFirstWorn,
+			(double) xStatic.ulFirstWorn / xDirect.ulFirstWorn, xStatic.ulCycles, xStatic.ulRetired, xStatic.ulStaticMoves );
+
+	/* Direct mapping wears the refilled sectors, levelling spreads the erases over every free sector */
+	CHECK( xDirect.ulFirstWorn >= ENDURANCE_MIN && xDirect.ulFirstWorn <= ENDURANCE_MAX, "direct mapping worn after %u cycles", xDirect.ulFirstWorn );
+	CHECK( xDynamic.ulFirstWorn > 4 * xDirect.ulFirstWorn, "dynamic levelling worn after %u cycles", xDynamic.ulFirstWorn );
+	CHECK( xStatic.ulFirstWorn > xDynamic.ulFirstWorn, "static levelling worn after %u cycles", xStatic.ulFirstWorn );
+	CHECK( xDynamic.ulStaticMoves == 0 && xStatic.ulStaticMoves > 0, "%u and %u static moves", xDynamic.ulStaticMoves, xStatic.ulStaticMoves );
+	/* Retiring worn sectors keeps the layer usable beyond the first worn sector */
+	CHECK( xDynamic.ulCycles > xDynamic.ulFirstWorn && xStatic.ulCycles > xStatic.ulFirstWorn, "no cycles after the first worn sector" );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of eLogMirrorTdf between RAM backed loggers with block footers
+ * TDFs and compressed segments are logged to a flash source, mirrored to destinations of several block sizes,
+ * and both logs are decoded to check every record arrives intact and every destination footer verifies.
+ * The first destination block of the final run is printed so the Python decoder can be checked against it.
+ * Relative timestamps are checked against the most recent global time, and the host throughput of
+ * eLogMirrorTdf and eLogMirror from a flash sized source to an SD sized destination is reported.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crc.h"
+#include "logger.h"
+#include "logger_mirror.h"
+#include "tdf.h"
+#include "tdf_parse.h"
+
+#define MAX_BLOCKS 2048
+#define MAX_BLOCK_SIZE 512
+#define MAX_RECORDS 40000
+#define SRC_ERASE_UNIT 16
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+typedef struct xRecord_t
+{
+	uint16_t   usId;
+	bool	   bTimed;
+	xTdfTime_t xTime;
+	uint8_t	ucLen;
+	uint8_t	pucData[64];
+} xRecord_t;
+
+static uint8_t  pucSrcMemory[MAX_BLOCKS][MAX_BLOCK_SIZE], pucDstMemory[MAX_BLOCKS][MAX_BLOCK_SIZE];
+static uint32_t ulSrcBlocks;
+
+static eModuleError_t prvSrcConfigure( uint16_t usSetting, void *pvParameters )
+{
+	if ( usSetting == LOGGER_CONFIG_GET_NUM_BLOCKS ) {
+		*( (uint32_t *) pvParameters ) = ulSrcBlocks;
+	}
+	if ( usSetting == LOGGER_CONFIG_GET_CLEAR_BYTE ) {
+		*( (uint8_t *) pvParameters ) = 0xFF;
+	}
+	if ( usSetting == LOGGER_CONFIG_GET_ERASE_UNIT ) {
+		*( (uint8_t *) pvParameters ) = SRC_ERASE_UNIT;
+	}
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvDstConfigure( uint16_t usSetting, void *pvParameters )
+{
+	if ( usSetting == LOGGER_CONFIG_GET_NUM_BLOCKS ) {
+		*( (uint32_t *) pvParameters ) = MAX_BLOCKS;
+	}
+	if ( usSetting == LOGGER_CONFIG_GET_CLEAR_BYTE ) {
+		*( (uint8_t *) pvParameters ) = 0xFF;
+	}
+	if ( usSetting == LOGGER_CONFIG_GET_ERASE_UNIT ) {
+		*( (uint8_t *) pvParameters ) = 1;
+	}
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvStatus( uint16_t usType )
+{
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvSrcRead( uint32_t ulBlock, uint16_t usOffset, void *pvData, uint32_t ulLength )
+{
+	memcpy( pvData, &pucSrcMemory[ulBlock][usOffset], ulLength );
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvSrcWrite( uint32_t ulBlock, void *pvData, uint32_t ulLength )
+{
+	memcpy( pucSrcMemory[ulBlock], pvData, ulLength );
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvSrcPrepare( uint32_t ulBlock )
+{
+	uint32_t i;
+	if ( ulBlock % SRC_ERASE_UNIT == 0 ) {
+		for ( i = ulBlock; ( i < ulBlock + SRC_ERASE_UNIT ) && ( i < ulSrcBlocks ); i++ ) {
+			memset( pucSrcMemory[i], 0xFF, MAX_BLOCK_SIZE );
+		}
+	}
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvDstRead( uint32_t ulBlock, uint16_t usOffset, void *pvData, uint32_t ulLength )
+{
+	memcpy( pvData, &pucDstMemory[ulBlock][usOffset], ulLength );
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvDstWrite( uint32_t ulBlock, void *pvData, uint32_t ulLength )
+{
+	memcpy( pucDstMemory[ulBlock], pvData, ulLength );
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvDstPrepare( uint32_t ulBlock )
+{
+	return ERROR_NONE;
+}
+
+LOGGER_DEVICE( xSrcDevice, prvSrcConfigure, prvStatus, prvSrcRead, prvSrcWrite, prvSrcPrepare );
+LOGGER_DEVICE( xDstDevice, prvDstConfigure, prvStatus, prvDstRead, prvDstWrite, prvDstPrepare );
+
+static uint8_t	 pucSrcBuffer[2 * MAX_BLOCK_SIZE], pucDstBuffer[2 * MAX_BLOCK_SIZE];
+static xLogger_t	xSrc, xDst;
+static xTdfLogger_t xSrcTdf;
+const xLoggerDevice_t xNullLoggerDevice;
+TDF_LOGS( &xSrcTdf );
+
+static uint16_t usCrc;
+
+void vCrcStart( eCrcPolynomial_t ePolynomial, uint32_t ulInitial )
+{
+	usCrc = ulInitial;
+}
+
+uint32_t ulCrcCalculate( uint8_t *pucData, uint32_t ulLen, bool bFinal )
+{
+	int i;
+	while ( ulLen-- ) {
+		usCrc ^= (uint16_t) *pucData++ << 8;
+		for ( i = 0; i < 8; i++ ) {
+			usCrc = ( usCrc & 0x8000 ) ? ( usCrc << 1 ) ^ 0x1021 : usCrc << 1;
+		}
+	}
+	return usCrc;
+}
+
+static xRecord_t pxSrcRecords[MAX_RECORDS], pxDstRecords[MAX_RECORDS];
+static uint16_t  pusIds[6];
+static int		 iNumIds;
+
+static void prvInitDst( uint16_t usDstBlockSize )
+{
+	xLogger_t xInitialDst = { 2, "DST", &xDstDevice, usDstBlockSize, 0, 0, 0, 0, LOGGER_LENGTH_REMAINING_BLOCKS, 0xFF, 0, 0, 0, pucDstBuffer, 0 };
+
+	memset( pucDstMemory, 0xFF, sizeof( pucDstMemory ) );
+	xDst = xInitialDst;
+	eLoggerConfigure( &xDst, LOGGER_CONFIG_INIT_DEVICE, NULL );
+	eLoggerConfigure( &xDst, LOGGER_CONFIG_BLOCK_FOOTER, NULL );
+	eLoggerConfigure( &xDst, LOGGER_CONFIG_APPEND_MODE, NULL );
+	eLoggerConfigure( &xDst, LOGGER_CONFIG_CLEAR_UNUSED_BYTES, NULL );
+}
+
+static void prvInit( uint16_t usSrcBlockSize, uint32_t ulBlocks, uint16_t usDstBlockSize )
+{
+	xLogger_t	xInitialSrc = { 1, "SRC", &xSrcDevice, usSrcBlockSize, 0, 0, 0, 0, LOGGER_LENGTH_REMAINING_BLOCKS, 0xFF, 0, 0, 0, pucSrcBuffer, 0 };
+	xTdfLogger_t xInitialTdf = { &xSrc, (void *) 1, { TDF_INVALID_TIME, 0 }, { 0, 0 } };
+
+	ulSrcBlocks = ulBlocks;
+	memset( pucSrcMemory, 0xFF, sizeof( pucSrcMemory ) );
+	xSrc = xInitialSrc;
+	eLoggerConfigure( &xSrc, LOGGER_CONFIG_INIT_DEVICE, NULL );
+	eLoggerConfigure( &xSrc, LOGGER_CONFIG_COMMIT_MARKERS, NULL );
+	eLoggerConfigure( &xSrc, LOGGER_CONFIG_BLOCK_FOOTER, NULL );
+	eLoggerConfigure( &xSrc, LOGGER_CONFIG_WRAP_MODE, NULL );
+	xSrcTdf = xInitialTdf;
+	prvInitDst( usDstBlockSize );
+}
+
+/* Individual TDFs with every timestamp type, and compressed runs of samples */
+static void prvGenerate( int iRecords, int iNumIds )
+{
+	static uint8_t   pucSegment[MAX_BLOCK_SIZE];
+	xTdfTime_t		 xNow = { 600000000, 0 };
+	xTdfCompressor_t xCompressor;
+	uint8_t			 pucData[64];
+	uint32_t		 ulStep, ulFraction;
+	uint16_t		 usId;
+	int				 i, j, k, iType;
+
+	for ( i = 0; i < iRecords; i++ ) {
+		/* Irregular time steps, occasionally large enough to force global timestamps */
+		ulStep					 = ( rand() % 50 == 0 ) ? ( rand() % 200000 ) * 65536u / 1000 : rand() % 40000;
+		ulFraction				 = xNow.usSecondsFraction + ( ulStep & 0xFFFF );
+		xNow.ulSecondsSince2000 += ( ulStep >> 16 ) + ( ulFraction >> 16 );
+		xNow.usSecondsFraction	= ulFraction;
+		usId					 = pusIds[rand() % iNumIds];
+		iType					 = rand() % 100;
+		if ( iType < 10 ) {
+			vTdfCompressStart( &xCompressor, usId, ( rand() % 2 ) ? TDF_TIMESTAMP_GLOBAL : TDF_TIMESTAMP_NONE, pucSegment, ( rand() % 3 ) ? 120 : 200 );
+			memset( pucData, 0, sizeof( pucData ) );
+			for ( j = 1 + rand() % 60; j > 0; j-- ) {
+				for ( k = 0; k < pucTdfStructLengths[usId]; k++ ) {
+					pucData[k] += rand() % 5;
+				}
+				if ( eTdfCompressAdd( &xCompressor, &xNow, pucData ) != ERROR_NONE ) {
+					break;
+				}
+				ulFraction				 = xNow.usSecondsFraction + 3000;
+				xNow.ulSecondsSince2000 += ulFraction >> 16;
+				xNow.usSecondsFraction	= ulFraction;
+			}
+			eTdfAddCompressed( &xSrcTdf, &xCompressor );
+			continue;
+		}
+		for ( k = 0; k < pucTdfStructLengths[usId]; k++ ) {
+			pucData[k] = rand();
+		}
+		eTdfAdd( &xSrcTdf, usId, ( iType < 20 ) ? TDF_TIMESTAMP_NONE : ( iType < 30 ) ? TDF_TIMESTAMP_GLOBAL : ( iType < 40 ) ? TDF_TIMESTAMP_RELATIVE_OFFSET_S : TDF_TIMESTAMP_RELATIVE_OFFSET_MS, &xNow, pucData );
+	}
+	eTdfFlush( &xSrcTdf );
+}
+
+/* Decode the data area of each block, in block order */
+static int prvDecode( xLogger_t *pxLog, uint8_t pucMemory[][MAX_BLOCK_SIZE], uint32_t ulFirst, uint32_t ulCount, xRecord_t *pxRecords )
+{
+	xTdfParser_t xParser;
+	xTdf_t		 xTdf;
+	uint32_t	 i, ulBlock;
+	uint16_t	 usOffset;
+	int			 iNum = 0;
+
+	for ( i = 0; i < ulCount; i++ ) {
+		ulBlock  = ( ulFirst + i ) % pxLog->ulNumBlocks;
+		usOffset = usLoggerBlockHeaderSize( pxLog, ulBlock );
+		vTdfParseStart( &xParser, pucMemory[ulBlock] + usOffset, pxLog->usLogicalBlockSize - usLoggerBlockFooterSize( pxLog ) - usOffset );
+		while ( ( eTdfParse( &xParser, &xTdf ) == ERROR_NONE ) && ( iNum < MAX_RECORDS ) ) {
+			if ( TDF_ID( xTdf.usId ) == TDF_LOST_DATA ) {
+				continue;
+			}
+			pxRecords[iNum].usId   = TDF_ID( xTdf.usId );
+			pxRecords[iNum].bTimed = TDF_TIMESTAMP( xTdf.usId ) != TDF_TIMESTAMP_NONE;
+			pxRecords[iNum].xTime  = xTdf.xTime;
+			pxRecords[iNum].ucLen  = xTdf.ucDataLen;
+			memcpy( pxRecords[iNum].pucData, xTdf.pucData, xTdf.ucDataLen );
+			iNum++;
+		}
+	}
+	return iNum;
+}
+
+static bool prvRecordsMatch( xRecord_t *pxA, xRecord_t *pxB )
+{
+	if ( ( pxA->usId != pxB->usId ) || ( pxA->ucLen != pxB->ucLen ) || ( pxA->bTimed != pxB->bTimed ) || memcmp( pxA->pucData, pxB->pucData, pxA->ucLen ) ) {
+		return false;
+	}
+	return !pxA->bTimed || ( ( pxA->xTime.ulSecondsSince2000 == pxB->xTime.ulSecondsSince2000 ) && ( pxA->xTime.usSecondsFraction == pxB->xTime.usSecondsFraction ) );
+}
+
+static void prvRun( uint16_t usSrcBlockSize, uint32_t ulBlocks, uint16_t usDstBlockSize, int iRecords, int iIds, uint32_t ulChunk )
+{
+	static uint8_t  pucMirrorBuffer[MAX_BLOCK_SIZE], pucRead[MAX_BLOCK_SIZE];
+	xLogMirrorTdf_t xState;
+	eModuleError_t  eError = ERROR_NONE;
+	uint32_t		ulLost, ulBlock, ulCorrupt = 0;
+	int				iSrc, iDst, i, iMismatch = -1;
+
+	prvInit( usSrcBlockSize, ulBlocks, usDstBlockSize );
+	srand( 11 );
+	prvGenerate( iRecords, iIds );
+	ulLost = ulLogMirrorLostSrcPages( xSrc.ulPagesWritten, xSrc.ulNumBlocks, SRC_ERASE_UNIT );
+	iSrc   = prvDecode( &xSrc, pucSrcMemory, ulLost, xSrc.ulPagesWritten - ulLost, pxSrcRecords );
+
+	vLogMirrorTdfInit( &xState, pucMirrorBuffer, sizeof( pucMirrorBuffer ), 0 );
+	while ( ( eError == ERROR_NONE ) && ( xState.ulSrcPagesMirrored < xSrc.ulPagesWritten ) ) {
+		eError = eLogMirrorTdf( &xSrc, &xDst, &xState, ulChunk );
+	}
+	CHECK( eError == ERROR_NONE, "%d -> %d: mirror error %d", usSrcBlockSize, usDstBlockSize, eError );
+	for ( ulBlock = 0; ulBlock < xDst.ulPagesWritten; ulBlock++ ) {
+		ulCorrupt += ( eLoggerReadBlock( &xDst, ulBlock, 0, pucRead ) != ERROR_NONE );
+	}
+	CHECK( ulCorrupt == 0, "%d -> %d: %u destination blocks fail footer verification", usSrcBlockSize, usDstBlockSize, ulCorrupt );
+
+	iDst = prvDecode( &xDst, pucDstMemory, 0, xDst.ulPagesWritten, pxDstRecords );
+	for ( i = 0; ( i < iSrc ) && ( i < iDst ); i++ ) {
+		if ( !prvRecordsMatch( &pxSrcRecords[i], &pxDstRecords[i] ) ) {
+			iMismatch = i;
+			break;
+		}
+	}
+	CHECK( ( iSrc == iDst ) && ( iMismatch < 0 ), "%d -> %d: %d records mirrored as %d, first mismatch %d", usSrcBlockSize, usDstBlockSize, iSrc, iDst, iMismatch );
+	CHECK( xState.ulDropped == 0, "%d -> %d: %u TDFs dropped", usSrcBlockSize, usDstBlockSize, xState.ulDropped );
+	printf( "%3d -> %3d: %5u source pages, %u lost, %5d records -> %5u destination pages, %u segments, %u promoted\n", usSrcBlockSize, usDstBlockSize,
+			xSrc.ulPagesWritten, xState.ulLostPages, iSrc, xDst.ulPagesWritten, xState.ulSegments, xState.ulGlobals );
+}
+
+/* Relative offsets are from the most recent global time, they do not accumulate */
+static void prvRelativeOffsets( void )
+{
+	xTdfTime_t		  pxTimes[4] = { { 600000000, 0 }, { 600000001, 0x8000 }, { 600000002, 0x4000 }, { 600000005, 0x4000 } };
+	eTdfTimestampType_t peTypes[4] = { TDF_TIMESTAMP_GLOBAL, TDF_TIMESTAMP_RELATIVE_OFFSET_MS, TDF_TIMESTAMP_RELATIVE_OFFSET_MS, TDF_TIMESTAMP_RELATIVE_OFFSET_S };
+	uint8_t				pucData[64] = { 0 };
+	int					i, iNum;
+
+	prvInit( 256, MAX_BLOCKS, 256 );
+	for ( i = 0; i < 4; i++ ) {
+		eTdfAdd( &xSrcTdf, pusIds[0], peTypes[i], &pxTimes[i], pucData );
+	}
+	eTdfFlush( &xSrcTdf );
+	iNum = prvDecode( &xSrc, pucSrcMemory, 0, xSrc.ulPagesWritten, pxSrcRecords );
+	CHECK( iNum == 4, "%d relative offset records decoded", iNum );
+	for ( i = 0; i < iNum; i++ ) {
+		CHECK( pxSrcRecords[i].bTimed, "record %d untimed", i );
+		/* TDF_TIMESTAMP_RELATIVE_OFFSET_S drops the fraction of the global time it is relative to */
+		CHECK( pxSrcRecords[i].xTime.ulSecondsSince2000 == pxTimes[i].ulSecondsSince2000, "record %d at %u s, expected %u s", i,
+			   pxSrcRecords[i].xTime.ulSecondsSince2000, pxTimes[i].ulSecondsSince2000 );
+	}
+	CHECK( pxSrcRecords[1].xTime.usSecondsFraction == 0x8000, "record 1 fraction %04x", pxSrcRecords[1].xTime.usSecondsFraction );
+	CHECK( pxSrcRecords[2].xTime.usSecondsFraction == 0x4000, "record 2 fraction %04x", pxSrcRecords[2].xTime.usSecondsFraction );
+}
+
+static double prvSeconds( void )
+{
+	struct timespec xNow;
+	clock_gettime( CLOCK_MONOTONIC, &xNow );
+	return xNow.tv_sec + xNow.tv_nsec * 1e-9;
+}
+
+/* Host throughput from 256 byte flash pages to 512 byte SD sectors, in source megabytes per second */
+#define BENCHMARK_REPEATS 20
+
+static void prvBenchmark( void )
+{
+	static uint8_t  pucMirrorBuffer[MAX_BLOCK_SIZE];
+	xLogMirrorTdf_t xState;
+	double			dStart, dTdf, dRaw, dBytes;
+	int				i;
+
+	prvInit( 256, MAX_BLOCKS, 512 );
+	srand( 11 );
+	prvGenerate( 6000, iNumIds );
+	dBytes = (double) xSrc.ulPagesWritten * xSrc.usLogicalBlockSize * BENCHMARK_REPEATS / 1e6;
+
+	dStart = prvSeconds();
+	for ( i = 0; i < BENCHMARK_REPEATS; i++ ) {
+		prvInitDst( 512 );
+		vLogMirrorTdfInit( &xState, pucMirrorBuffer, sizeof( pucMirrorBuffer ), 0 );
+		CHECK( eLogMirrorTdf( &xSrc, &xDst, &xState, xSrc.ulPagesWritten ) == ERROR_NONE, "benchmark eLogMirrorTdf" );
+	}
+	dTdf = prvSeconds() - dStart;
+
+	dStart = prvSeconds();
+	for ( i = 0; i < BENCHMARK_REPEATS; i++ ) {
+		prvInitDst( 512 );
+		CHECK( eLogMirror( &xSrc, &xDst ) == ERROR_NONE, "benchmark eLogMirror" );
+	}
+	dRaw = prvSeconds() - dStart;
+
+	printf( "flash 256 -> SD 512: %u source pages, eLogMirrorTdf %.1f MB/s, eLogMirror %.1f MB/s\n", xSrc.ulPagesWritten, dBytes / dTdf, dBytes / dRaw );
+}
+
+int main( void )
+{
+	uint16_t i;
+
+	for ( i = 1; ( i < sizeof( pucTdfStructLengths ) ) && ( iNumIds < 6 ); i++ ) {
+		if ( ( pucTdfStructLengths[i] >= 2 ) && ( pucTdfStructLengths[i] <= 40 ) && ( i != TDF_LOST_DATA ) ) {
+			pusIds[iNumIds++] = i;
+		}
+	}
+	prvRun( 256, MAX_BLOCKS, 512, 6000, iNumIds, 64 );
+	prvRun( 256, MAX_BLOCKS, 256, 6000, iNumIds, 1 );
+	prvRun( 512, MAX_BLOCKS, 128, 6000, iNumIds, 64 );
+	prvRun( 512, 64, 256, 6000, iNumIds, 100000 );
+	prvRelativeOffsets();
+	prvBenchmark();
+
+	/* Only TDF_ACC_XYZ_SIGNED, which the Python decoder test knows */
+	pusIds[0] = TDF_ACC_XYZ_SIGNED;
+	prvRun( 256, MAX_BLOCKS, 128, 400, 1, 64 );
+	printf( "BLOCK " );
+	for ( i = 0; i < xDst.usLogicalBlockSize; i++ ) {
+		printf( "%02x", pucDstMemory[0][i] );
+	}
+	printf( " %d\n", prvDecode( &xDst, pucDstMemory, 0, 1, pxDstRecords ) );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Power loss fault injection for logger commit markers
+ * The NOR model programs bits with AND, power is cut partway through a program with the final byte partially programmed,
+ * and half of all programs complete in a random byte order. After every boot the harness checks that every acknowledged
+ * block is intact, that no torn block validates, and that the recovered head and page count match the model.
+ * logger.c is included directly so block validation can be checked from the harness.
+ */
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.c"
+
+#define BLOCK_SIZE 256
+#define MAX_BLOCKS 4096
+#define SECTOR_BLOCKS 4
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+static uint32_t ulNumBlocks;
+static uint8_t  ucClear = 0xFF;
+static uint8_t  pucFlash[MAX_BLOCKS][BLOCK_SIZE];
+/* Contents of every block the logger has been told was written */
+static uint8_t pucAcknowledged[MAX_BLOCKS][BLOCK_SIZE];
+static bool	pbAcknowledged[MAX_BLOCKS];
+/* Bytes remaining until power is cut, negative to disable */
+static long		lCountdown = -1;
+static jmp_buf	xPowerLoss;
+static bool		bRecovering;
+static uint32_t ulReads, ulConsumed;
+
+static void prvProgram( uint8_t *pucByte, uint8_t ucValue )
+{
+	*pucByte = ( ucClear == 0xFF ) ? ( *pucByte & ucValue ) : ( *pucByte | ucValue );
+}
+
+static eModuleError_t prvConfigure( uint16_t usSetting, void *pvParameters )
+{
+	if ( usSetting == LOGGER_CONFIG_GET_NUM_BLOCKS ) {
+		*( (uint32_t *) pvParameters ) = ulNumBlocks;
+	}
+	if ( usSetting == LOGGER_CONFIG_GET_CLEAR_BYTE ) {
+		*( (uint8_t *) pvParameters ) = ucClear;
+	}
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvStatus( uint16_t usType )
+{
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvRead( uint32_t ulBlock, uint16_t usOffset, void *pvData, uint32_t ulLength )
+{
+	ulReads++;
+	memcpy( pvData, &pucFlash[ulBlock][usOffset], ulLength );
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvWrite( uint32_t ulBlock, void *pvData, uint32_t ulLength )
+{
+	uint8_t *pucData = pvData;
+	int		 piOrder[BLOCK_SIZE], i, j, iTemp;
+	uint32_t k;
+	bool	 bTouched = false;
+
+	for ( i = 0; i < BLOCK_SIZE; i++ ) {
+		piOrder[i] = i;
+	}
+	/* Page programs on real parts are not sequential */
+	if ( rand() & 1 ) {
+		for ( i = BLOCK_SIZE - 1; i > 0; i-- ) {
+			j		   = rand() % ( i + 1 );
+			iTemp	  = piOrder[i];
+			piOrder[i] = piOrder[j];
+			piOrder[j] = iTemp;
+		}
+	}
+	for ( k = 0; k < ulLength; k++ ) {
+		i = piOrder[k];
+		if ( ( lCountdown > 0 ) && ( --lCountdown == 0 ) ) {
+			/* Final byte is only partially programmed */
+			prvProgram( &pucFlash[ulBlock][i], ( ucClear == 0xFF ) ? ( pucData[i] | rand() ) : ( pucData[i] & rand() ) );
+			bTouched = bTouched || ( pucFlash[ulBlock][i] != ucClear );
+			if ( !bRecovering && bTouched ) {
+				ulConsumed++;
+			}
+			/* The partial byte may have landed on the right value */
+			pbAcknowledged[ulBlock] = !bRecovering && ( ulLength == BLOCK_SIZE ) && ( memcmp( pucFlash[ulBlock], pucData, BLOCK_SIZE ) == 0 );
+			memcpy( pucAcknowledged[ulBlock], pucFlash[ulBlock], BLOCK_SIZE );
+			longjmp( xPowerLoss, 1 );
+		}
+		prvProgram( &pucFlash[ulBlock][i], pucData[i] );
+		bTouched = bTouched || ( pucFlash[ulBlock][i] != ucClear );
+	}
+	/* Blocks rewritten by recovery are invalid by design */
+	pbAcknowledged[ulBlock] = !bRecovering;
+	if ( !bRecovering ) {
+		ulConsumed++;
+		memcpy( pucAcknowledged[ulBlock], pucFlash[ulBlock], BLOCK_SIZE );
+	}
+	return ERROR_NONE;
+}
+
+static eModuleError_t prvPrepare( uint32_t ulBlock )
+{
+	uint32_t i;
+	if ( ulBlock % SECTOR_BLOCKS == 0 ) {
+		for ( i = ulBlock; i < ulBlock + SECTOR_BLOCKS; i++ ) {
+			memset( pucFlash[i], ucClear, BLOCK_SIZE );
+			pbAcknowledged[i] = false;
+		}
+	}
+	return ERROR_NONE;
+}
+
+LOGGER_DEVICE( xDevice, prvConfigure, prvStatus, prvRead, prvWrite, prvPrepare );
+
+static uint16_t usCrc;
+
+void vCrcStart( eCrcPolynomial_t ePolynomial, uint32_t ulInitial )
+{
+	usCrc = ulInitial;
+}
+
+uint32_t ulCrcCalculate( uint8_t *pucData, uint32_t ulLen, bool bFinal )
+{
+	int i;
+	while ( ulLen-- ) {
+		usCrc ^= (uint16_t) *pucData++ << 8;
+		for ( i = 0; i < 8; i++ ) {
+			usCrc = ( usCrc & 0x8000 ) ? ( usCrc << 1 ) ^ 0x1021 : usCrc << 1;
+		}
+	}
+	return usCrc;
+}
+
+static uint8_t   pucBuffer[2 * BLOCK_SIZE];
+static xLogger_t xLog;
+static bool		 bWrapping;
+static uint32_t  ulMaxReads, ulEstimates;
+
+static void prvBoot( void )
+{
+	xLogger_t xInitial = { 1, "Host", &xDevice, BLOCK_SIZE, 0, 0, 0, 0, LOGGER_LENGTH_REMAINING_BLOCKS, 0x00, 0, 0, 0, pucBuffer, 0 };
+	xLog			   = xInitial;
+	bRecovering		   = true;
+	ulReads			   = 0;
+	eLoggerConfigure( &xLog, LOGGER_CONFIG_INIT_DEVICE, NULL );
+	eLoggerConfigure( &xLog, LOGGER_CONFIG_COMMIT_MARKERS, NULL );
+	eLoggerConfigure( &xLog, bWrapping ? LOGGER_CONFIG_WRAP_MODE : LOGGER_CONFIG_APPEND_MODE, NULL );
+	bRecovering = false;
+	ulMaxReads  = ( ulReads > ulMaxReads ) ? ulReads : ulMaxReads;
+}
+
+static void prvVerify( int iCrash )
+{
+	uint8_t *pucIdle = &pucBuffer[xLog.ucCurrentBuffer ? 0 : BLOCK_SIZE];
+	uint32_t ulWrapPages, ulBlock;
+	bool	 bValid, bEstimated;
+
+	for ( ulBlock = 0; ulBlock < ulNumBlocks; ulBlock++ ) {
+		bValid = prvLoggerBlockValid( &xLog, ulBlock, pucIdle );
+		if ( pbAcknowledged[ulBlock] ) {
+			CHECK( bValid && memcmp( pucAcknowledged[ulBlock], pucFlash[ulBlock], BLOCK_SIZE ) == 0, "crash %d: acknowledged block %u lost", iCrash, ulBlock );
+		}
+		else {
+			CHECK( !bValid, "crash %d: torn block %u validates", iCrash, ulBlock );
+		}
+	}
+	/* Without a checkpoint the count is only known modulo 255 wraps, which must be reported */
+	eLoggerStatus( &xLog, LOGGER_STATUS_PAGES_ESTIMATED, &bEstimated );
+	if ( bEstimated && ( xLog.ulPagesWritten != ulConsumed ) ) {
+		ulWrapPages = 255 * ulNumBlocks;
+		CHECK( xLog.ulPagesWritten % ulWrapPages == ulConsumed % ulWrapPages, "crash %d: estimate %u for %u pages", iCrash, xLog.ulPagesWritten, ulConsumed );
+		ulConsumed = xLog.ulPagesWritten;
+		ulEstimates++;
+	}
+	CHECK( xLog.ulPagesWritten == ulConsumed, "crash %d: %u pages recovered, %u written", iCrash, xLog.ulPagesWritten, ulConsumed );
+	CHECK( xLog.ulCurrentBlockAddress == ( bWrapping ? ulConsumed % ulNumBlocks : ulConsumed ), "crash %d: head %u", iCrash, xLog.ulCurrentBlockAddress );
+}
+
+static void prvRun( uint32_t ulBlocks, bool bWrap, uint8_t ucErase, int iCrashes, int iSpread )
+{
+	static uint32_t ulSequence;
+	static int		iCrash;
+	uint8_t			pucRecord[20];
+	int				i;
+
+	ulNumBlocks = ulBlocks;
+	bWrapping	= bWrap;
+	ucClear		= ucErase;
+	memset( pucFlash, ucClear, sizeof( pucFlash ) );
+	memset( pbAcknowledged, 0, sizeof( pbAcknowledged ) );
+	ulConsumed	= 0;
+	ulSequence	= 0;
+	ulMaxReads	= 0;
+	ulEstimates = 0;
+	srand( 42 );
+	prvBoot();
+	for ( iCrash = 0; iCrash < iCrashes; iCrash++ ) {
+		lCountdown = 1 + rand() % ( BLOCK_SIZE * ( 1 + rand() % iSpread ) );
+		if ( setjmp( xPowerLoss ) == 0 ) {
+			for ( ;; ) {
+				for ( i = 0; i < (int) sizeof( pucRecord ); i++ ) {
+					pucRecord[i] = ulSequence * 7 + i;
+				}
+				memcpy( pucRecord, &ulSequence, sizeof( ulSequence ) );
+				ulSequence++;
+				if ( eLoggerLog( &xLog, sizeof( pucRecord ), pucRecord ) == ERROR_DEVICE_FULL ) {
+					/* Append log is full, start again */
+					memset( pucFlash, ucClear, sizeof( pucFlash ) );
+					memset( pbAcknowledged, 0, sizeof( pbAcknowledged ) );
+					ulConsumed = 0;
+					prvBoot();
+				}
+			}
+		}
+		lCountdown = -1;
+		prvBoot();
+		prvVerify( iCrash );
+	}
+	printf( "%s %4u blocks, erase %02X: %d crashes, %u wraps, %u max reads per boot, %u estimated counts\n",
+			bWrapping ? "wrap  " : "append", ulNumBlocks, ucClear, iCrashes, ulConsumed / ulNumBlocks, ulMaxReads, ulEstimates );
+}
+
+int main( void )
+{
+	prvRun( 4096, false, 0xFF, 500, 20 );
+	prvRun( 64, true, 0xFF, 5000, 20 );
+	prvRun( 64, true, 0xFF, 1000, 100 );
+	prvRun( 1024, true, 0xFF, 500, 20 );
+	prvRun( 64, true, 0x00, 1000, 20 );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of onboard logger commit latency, with and without ONBOARD_LOGGER_ERASE_AHEAD
+ *
+ * The NOR flash model charges simulated time for page programs and sector erases, and is a
+ * single resource shared by the logging task and the erase ahead task. The erase ahead task runs
+ * as a coroutine in the time between commits and while the logging task is blocked. Blocks before
+ * the logger are reserved, as they are for OTA images, and blocks after an explicitly sized logger
+ * belong to someone else, neither may be erased or programmed. Every program must land on erased flash.
+ *
+ * Build time options, set by the test runner:
+ *   ONBOARD_LOGGER_ERASE_AHEAD	Sectors kept erased ahead of the write head, 0 for synchronous erases
+ *   RESERVED_BLOCKS			Blocks before the logger
+ *   LOGGER_BLOCKS				Logger length, LOGGER_LENGTH_REMAINING_BLOCKS for the rest of the device
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include "crc.h"
+#include "logger.h"
+#include "onboard_logger.h"
+
+#ifndef ONBOARD_LOGGER_ERASE_AHEAD
+#define ONBOARD_LOGGER_ERASE_AHEAD 0
+#endif
+#ifndef RESERVED_BLOCKS
+#define RESERVED_BLOCKS 64
+#endif
+#ifndef LOGGER_BLOCKS
+#define LOGGER_BLOCKS LOGGER_LENGTH_REMAINING_BLOCKS
+#endif
+
+#define PAGE_SIZE 256
+#define SECTOR_PAGES 16
+#define NUM_SECTORS 32
+
+/* Assumed flash timings, milliseconds, typical of 4kB sector serial NOR parts */
+#define PROGRAM_MS 0.85
+#define ERASE_MS 40.0
+/* One block is committed every period */
+#define COMMIT_PERIOD_MS 50.0
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+/*-----------------------------------------------------------*/
+
+/* Cooperative model of the erase ahead task */
+
+typedef enum eTaskState_t {
+	TASK_NONE,
+	TASK_READY,	/**< Runnable from dTaskReady */
+	TASK_NOTIFY, /**< Blocked in ulTaskNotifyTake */
+	TASK_FLASH,	 /**< Blocked until its flash operation completes at dTaskReady */
+	TASK_QUEUED	 /**< Flash operation of dTaskPending queued behind the writer */
+} eTaskState_t;
+
+static ucontext_t	  xMainContext, xTaskContext;
+static TaskFunction_t fnTask;
+static eTaskState_t	  eTaskState;
+static bool			  bInTask, bWriterQueued;
+static uint32_t		  ulNotifications;
+static int			  iSemaphore;
+static double		  dMainNow, dTaskNow, dTaskReady, dTaskPending, dFlashFree;
+
+static double prvNow( void )
+{
+	return bInTask ? dTaskNow : dMainNow;
+}
+
+static void prvTaskEntry( void )
+{
+	fnTask( NULL );
+}
+
+static void prvTaskYield( void )
+{
+	bInTask = false;
+	swapcontext( &xTaskContext, &xMainContext );
+	bInTask = true;
+}
+
+/* Runs the task for as long as it has work that starts before dLimit */
+static void prvTaskRun( double dLimit )
+{
+	while ( ( eTaskState == TASK_READY || eTaskState == TASK_FLASH ) && ( dTaskReady <= dLimit ) ) {
+		dTaskNow = ( dTaskReady > dTaskNow ) ? dTaskReady : dTaskNow;
+		bInTask	 = true;
+		swapcontext( &xMainContext, &xTaskContext );
+		bInTask = false;
+	}
+}
+
+TaskHandle_t xTaskCreateStatic( TaskFunction_t fnFunction, const char *pcName, uint32_t ulStackDepth, void *pvParameters, UBaseType_t uxPriority,
+								StackType_t *puxStack, StaticTask_t *pxTask )
+{
+	static uint8_t pucStack[256 * 1024];
+	fnTask = fnFunction;
+	getcontext( &xTaskContext );
+	xTaskContext.uc_stack.ss_sp	  = pucStack;
+	xTaskContext.uc_stack.ss_size = sizeof( pucStack );
+	xTaskContext.uc_link		  = NULL;
+	makecontext( &xTaskContext, prvTaskEntry, 0 );
+	eTaskState = TASK_READY;
+	dTaskReady = dMainNow;
+	return &xTaskContext;
+}
+
+uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit, TickType_t xTicksToWait )
+{
+	if ( ulNotifications == 0 ) {
+		eTaskState = TASK_NOTIFY;
+		prvTaskYield();
+	}
+	ulNotifications = 0;
+	return 1;
+}
+
+BaseType_t xTaskNotifyGive( TaskHandle_t xTask )
+{
+	ulNotifications++;
+	if ( eTaskState == TASK_NOTIFY ) {
+		eTaskState = TASK_READY;
+		dTaskReady = prvNow();
+	}
+	return pdPASS;
+}
+
+/* Only the logging task waits on the erase complete semaphore, time passes until the task gives it */
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore, TickType_t xTicksToWait )
+{
+	while ( iSemaphore == 0 ) {
+		if ( eTaskState != TASK_READY && eTaskState != TASK_FLASH ) {
+			CHECK( 0, "waiting on an erase that will never complete" );
+			return pdFAIL;
+		}
+		dMainNow = ( dTaskReady > dMainNow ) ? dTaskReady : dMainNow;
+		prvTaskRun( dMainNow );
+	}
+	iSemaphore = 0;
+	return pdPASS;
+}
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore )
+{
+	iSemaphore = 1;
+	return pdPASS;
+}
+
+TickType_t xTaskGetTickCount( void )
+{
+	return (TickType_t) ( prvNow() * configTICK_RATE_HZ / 1000 );
+}
+
+/*-----------------------------------------------------------*/
+
+/* NOR flash model, one operation at a time */
+
+static uint8_t pucMemory[NUM_SECTORS * SECTOR_PAGES * PAGE_SIZE], pucPage[PAGE_SIZE];
+static int	   iForeignWrites, iUnerasedWrites, iErases;
+
+static xFlashDevice_t xDevice = {
+	.xSettings = { .ulNumPages = NUM_SECTORS * SECTOR_PAGES, .usPageSize = PAGE_SIZE, .usErasePages = SECTOR_PAGES, .ucEraseByte = 0xFF, .ucPageSizePower = 8, .usPageOffsetMask = PAGE_SIZE - 1, .pucPage = pucPage },
+	.pcName	   = "HOST"
+};
+xFlashDevice_t *const pxOnboardFlash = &xDevice;
+
+static bool prvLoggerOwns( uint64_t ullAddress )
+{
+	uint32_t ulEnd = ( LOGGER_BLOCKS == LOGGER_LENGTH_REMAINING_BLOCKS ) ? NUM_SECTORS * SECTOR_PAGES : RESERVED_BLOCKS + LOGGER_BLOCKS;
+	return ( ullAddress >= RESERVED_BLOCKS * PAGE_SIZE ) && ( ullAddress < (uint64_t) ulEnd * PAGE_SIZE );
+}
+
+/* Operations are serviced in request order, the writer waits for the operation in progress */
+static void prvFlashStart( void )
+{
+	if ( !bInTask ) {
+		dMainNow	  = ( dFlashFree > dMainNow ) ? dFlashFree : dMainNow;
+		bWriterQueued = true;
+		/* The operation in progress completes, the task may queue another behind the writer */
+		prvTaskRun( dMainNow );
+	}
+}
+
+static void prvFlashBusy( double dDuration )
+{
+	if ( bInTask ) {
+		/* The task sleeps until its operation completes */
+		if ( bWriterQueued ) {
+			dTaskPending = dDuration;
+			eTaskState	 = TASK_QUEUED;
+		}
+		else {
+			dFlashFree = ( ( dTaskNow > dFlashFree ) ? dTaskNow : dFlashFree ) + dDuration;
+			eTaskState = TASK_FLASH;
+			dTaskReady = dFlashFree;
+		}
+		prvTaskYield();
+	}
+	else {
+		dFlashFree	  = dMainNow + dDuration;
+		dMainNow	  = dFlashFree;
+		bWriterQueued = false;
+		if ( eTaskState == TASK_QUEUED ) {
+			dFlashFree += dTaskPending;
+			eTaskState = TASK_FLASH;
+			dTaskReady = dFlashFree;
+		}
+	}
+}
+
+eModuleError_t eFlashRead( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout )
+{
+	memcpy( pucData, pucMemory + ullAddress, ulLength );
+	return ERROR_NONE;
+}
+
+/* Programming can only clear bits */
+eModuleError_t eFlashWrite( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout )
+{
+	uint32_t i;
+	prvFlashStart();
+	if ( !prvLoggerOwns( ullAddress ) ) {
+		iForeignWrites++;
+	}
+	for ( i = 0; i < ulLength; i++ ) {
+		iUnerasedWrites += ( pucMemory[ullAddress + i] != 0xFF );
+		pucMemory[ullAddress + i] &= pucData[i];
+	}
+	prvFlashBusy( PROGRAM_MS );
+	return ERROR_NONE;
+}
+
+eModuleError_t eFlashErase( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint32_t ulLength, TickType_t xTimeout )
+{
+	prvFlashStart();
+	if ( !prvLoggerOwns( ullAddress ) ) {
+		iForeignWrites++;
+	}
+	iErases++;
+	prvFlashBusy( ERASE_MS );
+	/* Contents are erased once the operation has completed */
+	memset( pucMemory + ullAddress, 0xFF, ulLength );
+	return ERROR_NONE;
+}
+
+static uint16_t usCrc;
+
+void vCrcStart( eCrcPolynomial_t ePolynomial, uint32_t ulInitial )
+{
+	usCrc = ulInitial;
+}
+
+uint32_t ulCrcCalculate( uint8_t *pucData, uint32_t ulLen, bool bFinal )
+{
+	int i;
+	while ( ulLen-- ) {
+		usCrc ^= (uint16_t) *pucData++ << 8;
+		for ( i = 0; i < 8; i++ ) {
+			usCrc = ( usCrc & 0x8000 ) ? ( usCrc << 1 ) ^ 0x1021 : usCrc << 1;
+		}
+	}
+	return usCrc;
+}
+
+/*-----------------------------------------------------------*/
+
+LOGGER( 0x01, xLog, "Log", &xOnboardLoggerDevice, PAGE_SIZE, RESERVED_BLOCKS, LOGGER_BLOCKS );
+
+int main( void )
+{
+	static uint8_t			   pucOutside[sizeof( pucMemory )];
+	xOnboardLoggerEraseStats_t xStats;
+	uint8_t					   pucRecord[200], pucBlock[PAGE_SIZE];
+	double					   dWorst = 0, dSteady = 0, dTotal = 0, dStart, dLatency;
+	uint32_t				   i, ulCommits;
+
+	/* Everything outside the logger holds data that must survive */
+	for ( i = 0; i < sizeof( pucMemory ); i++ ) {
+		pucMemory[i] = prvLoggerOwns( i ) ? 0xFF : (uint8_t) ( i * 7 );
+	}
+	memcpy( pucOutside, pucMemory, sizeof( pucMemory ) );
+
+	eLoggerConfigure( &xLog, LOGGER_CONFIG_INIT_DEVICE, NULL );
+	eLoggerConfigure( &xLog, LOGGER_CONFIG_WRAP_MODE, NULL );
+	ulCommits = 3 * xLog.ulNumBlocks;
+
+	/* A block per period, wrapping the logger three times */
+	for ( i = 0; i < ulCommits; i++ ) {
+		double dDue = i * COMMIT_PERIOD_MS;
+		/* Erase ahead uses the idle time until the next commit is due */
+		prvTaskRun( dDue );
+		dMainNow = ( dDue > dMainNow ) ? dDue : dMainNow;
+		memset( pucRecord, i, sizeof( pucRecord ) );
+		CHECK( eLoggerLog( &xLog, sizeof( pucRecord ), pucRecord ) == ERROR_NONE, "log %u", i );
+		dStart = dMainNow;
+		CHECK( eLoggerCommit( &xLog ) == ERROR_NONE, "commit %u", i );
+		dLatency = dMainNow - dStart;
+		dWorst	 = ( dLatency > dWorst ) ? dLatency : dWorst;
+		/* The erase ahead window starts empty, it is primed once the first sector has been written */
+		if ( i >= SECTOR_PAGES ) {
+			dSteady = ( dLatency > dSteady ) ? dLatency : dSteady;
+		}
+		dTotal += dLatency;
+	}
+	CHECK( xLog.ucWrapCounter >= 2, "wrap counter %d", xLog.ucWrapCounter );
+
+	/* The most recently committed block reads back */
+	CHECK( eLoggerReadBlock( &xLog, ( xLog.ulCurrentBlockAddress + xLog.ulNumBlocks - 1 ) % xLog.ulNumBlocks, 0, pucBlock ) == ERROR_NONE, "read" );
+	CHECK( memcmp( pucBlock, xLog.pucBuffer + ( xLog.ucCurrentBuffer ? 0 : PAGE_SIZE ), PAGE_SIZE ) == 0, "last block read back" );
+
+	/* Flash outside the logger is untouched, and nothing was programmed over stale data */
+	CHECK( iForeignWrites == 0, "%d erases or programs outside the logger", iForeignWrites );
+	for ( i = 0; i < sizeof( pucMemory ); i++ ) {
+		if ( !prvLoggerOwns( i ) && ( pucMemory[i] != pucOutside[i] ) ) {
+			CHECK( 0, "flash outside the logger modified at %u", i );
+			break;
+		}
+	}
+	CHECK( iUnerasedWrites == 0, "%d bytes programmed without an erase", iUnerasedWrites );
+
+	/* Each logger sector is erased once per pass, plus the window primed ahead of the first block */
+	vOnboardLoggerEraseStats( &xStats );
+	CHECK( iErases <= (int) ( ( ulCommits / SECTOR_PAGES ) + ONBOARD_LOGGER_ERASE_AHEAD + 2 ), "%d erases", iErases );
+	CHECK( ( ONBOARD_LOGGER_ERASE_AHEAD == 0 ) || ( xStats.ulBackgroundErases + xStats.ulStallErases == (uint32_t) iErases ),
+		   "erase stats %u background, %u stalled, %d erases", xStats.ulBackgroundErases, xStats.ulStallErases, iErases );
+	/* Sector erases dominate a commit unless they happen in the background */
+	CHECK( ( ONBOARD_LOGGER_ERASE_AHEAD == 0 ) || ( dSteady < ERASE_MS / 2 ), "worst commit %.2f ms with erase ahead", dSteady );
+
+	printf( "Erase ahead %d, logger blocks [%d, %u): %u commits, worst %.2f ms, worst after the first sector %.2f ms, mean %.2f ms, %d erases, %u stalls\n",
+			ONBOARD_LOGGER_ERASE_AHEAD, RESERVED_BLOCKS, RESERVED_BLOCKS + xLog.ulNumBlocks, ulCommits, dWorst, dSteady, dTotal / ulCommits, iErases,
+			xStats.ulStalls );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the wear levelled onboard logger against a RAM backed NOR flash model
+ * Blocks before the logger are reserved, as they are for OTA images, and must never be erased or programmed.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "crc.h"
+#include "logger.h"
+#include "onboard_logger.h"
+
+#define PAGE_SIZE 256
+#define SECTOR_PAGES 16
+#define NUM_SECTORS 32
+#define RESERVED_BLOCKS 40
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+static uint8_t pucMemory[NUM_SECTORS * SECTOR_PAGES * PAGE_SIZE], pucPage[PAGE_SIZE];
+static int	 iReservedWrites;
+
+static xFlashDevice_t xDevice = {
+	.xSettings = { .ulNumPages = NUM_SECTORS * SECTOR_PAGES, .usPageSize = PAGE_SIZE, .usErasePages = SECTOR_PAGES, .ucEraseByte = 0xFF, .ucPageSizePower = 8, .usPageOffsetMask = PAGE_SIZE - 1, .pucPage = pucPage },
+	.pcName	= "HOST"
+};
+xFlashDevice_t *const pxOnboardFlash = &xDevice;
+
+eModuleError_t eFlashRead( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout )
+{
+	memcpy( pucData, pucMemory + ullAddress, ulLength );
+	return ERROR_NONE;
+}
+
+/* Programming can only clear bits */
+eModuleError_t eFlashWrite( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint8_t *pucData, uint32_t ulLength, TickType_t xTimeout )
+{
+	uint32_t i;
+	if ( ullAddress < RESERVED_BLOCKS * PAGE_SIZE ) {
+		iReservedWrites++;
+	}
+	for ( i = 0; i < ulLength; i++ ) {
+		pucMemory[ullAddress + i] &= pucData[i];
+	}
+	return ERROR_NONE;
+}
+
+eModuleError_t eFlashErase( xFlashDevice_t *pxDevice, uint64_t ullAddress, uint32_t ulLength, TickType_t xTimeout )
+{
+	if ( ullAddress < RESERVED_BLOCKS * PAGE_SIZE ) {
+		iReservedWrites++;
+	}
+	memset( pucMemory + ullAddress, 0xFF, ulLength );
+	return ERROR_NONE;
+}
+
+static uint16_t usCrc;
+
+void vCrcStart( eCrcPolynomial_t ePolynomial, uint32_t ulInitial )
+{
+	usCrc = ulInitial;
+}
+
+uint32_t ulCrcCalculate( uint8_t *pucData, uint32_t ulLen, bool bFinal )
+{
+	int i;
+	while ( ulLen-- ) {
+		usCrc ^= (uint16_t) *pucData++ << 8;
+		for ( i = 0; i < 8; i++ ) {
+			usCrc = ( usCrc & 0x8000 ) ? ( usCrc << 1 ) ^ 0x1021 : usCrc << 1;
+		}
+	}
+	return usCrc;
+}
+
+LOGGER( 0x01, xLog, "Log", &xOnboardLoggerDevice, PAGE_SIZE, RESERVED_BLOCKS, LOGGER_LENGTH_REMAINING_BLOCKS );
+
+int main( void )
+{
+	static uint8_t pucReserved[RESERVED_BLOCKS * PAGE_SIZE];
+	uint8_t		   pucRecord[32], pucBlock[PAGE_SIZE];
+	uint32_t	   i, ulWearStart, ulNumBlocks;
+
+	for ( i = 0; i < sizeof( pucReserved ); i++ ) {
+		pucReserved[i] = i * 7;
+	}
+	memset( pucMemory, 0xFF, sizeof( pucMemory ) );
+	memcpy( pucMemory, pucReserved, sizeof( pucReserved ) );
+
+	/* The wear region starts at the first whole sector after the reserved blocks, the logger sees the remainder */
+	ulWearStart = ( RESERVED_BLOCKS + SECTOR_PAGES - 1 ) / SECTOR_PAGES;
+	ulNumBlocks = ( NUM_SECTORS - ulWearStart - ONBOARD_LOGGER_WEAR_SPARES ) * ( SECTOR_PAGES - 1 );
+	eLoggerConfigure( &xLog, LOGGER_CONFIG_INIT_DEVICE, NULL );
+	eLoggerConfigure( &xLog, LOGGER_CONFIG_WRAP_MODE, NULL );
+	CHECK( xLog.ulNumBlocks == ulNumBlocks, "logger length %u, expected %u", xLog.ulNumBlocks, ulNumBlocks );
+
+	/* Wrap the logger several times */
+	for ( i = 0; i < 3 * ulNumBlocks * ( PAGE_SIZE / sizeof( pucRecord ) ); i++ ) {
+		memset( pucRecord, i, sizeof( pucRecord ) );
+		CHECK( eLoggerLog( &xLog, sizeof( pucRecord ), pucRecord ) == ERROR_NONE, "log %u", i );
+	}
+	CHECK( xLog.ucWrapCounter >= 2, "wrap counter %d", xLog.ucWrapCounter );
+
+	/* The most recently committed block reads back through the wear layer */
+	CHECK( eLoggerReadBlock( &xLog, ( xLog.ulCurrentBlockAddress + ulNumBlocks - 1 ) % ulNumBlocks, 0, pucBlock ) == ERROR_NONE, "read" );
+	CHECK( memcmp( pucBlock, xLog.pucBuffer + ( xLog.ucCurrentBuffer ? 0 : PAGE_SIZE ), PAGE_SIZE ) == 0, "last block read back" );
+
+	/* The reserved region is untouched */
+	CHECK( iReservedWrites == 0, "%d erases or programs in the reserved region", iReservedWrites );
+	CHECK( memcmp( pucMemory, pucReserved, sizeof( pucReserved ) ) == 0, "reserved region modified" );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
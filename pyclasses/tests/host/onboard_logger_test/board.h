@@ -0,0 +1,11 @@
+/*
+ * Host model of the board, the onboard flash is a RAM backed NOR model in the harness
+ */
+#ifndef __CORE_CSIRO_HOST_BOARD_H__
+#define __CORE_CSIRO_HOST_BOARD_H__
+
+#include "flash_interface.h"
+
+extern xFlashDevice_t *const pxOnboardFlash;
+
+#endif /* __CORE_CSIRO_HOST_BOARD_H__ */
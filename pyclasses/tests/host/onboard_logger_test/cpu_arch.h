@@ -0,0 +1 @@
+/* Host stub, critical sections are provided by FreeRTOS.h */
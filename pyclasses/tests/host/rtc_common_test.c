@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the rtc_common epoch and calendar conversions, with timings
+ *
+ * Every day representable in 32 bit seconds from each epoch is converted to a date and back,
+ * both through the day cache and with the cache cleared, and compared against a calendar
+ * walked one day at a time. rtc_common.c is included directly so the cache can be cleared.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "rtc_common.c"
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+bool bRtcGetEpochTime( eTimeEpoch_t eEpoch, uint32_t *pulEpochTime )
+{
+	*pulEpochTime = 0;
+	return false;
+}
+
+uint16_t usRtcSubsecond( void )
+{
+	return 0;
+}
+
+static const xRtcDayCache_t xEmptyCache = { .ulDaysSinceUnixEpoch = UINT32_MAX, .xDate = { .eMonth = RTC_DAY_CACHE_INVALID_MONTH } };
+
+/* Independent calendar, advanced one day at a time */
+static void prvNextDay( xDate_t *pxDate )
+{
+	static const uint8_t pucLengths[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	uint16_t			 usYear			= pxDate->usYear;
+	bool				 bLeap			= ( usYear % 4 == 0 ) && ( ( usYear % 100 != 0 ) || ( usYear % 400 == 0 ) );
+	uint8_t				 ucLength		= pucLengths[pxDate->eMonth - 1] + ( ( pxDate->eMonth == eFebruary ) && bLeap ? 1 : 0 );
+
+	pxDate->eDayOfWeek = ( pxDate->eDayOfWeek + 1 ) % 7;
+	if ( ++pxDate->ucDay <= ucLength ) {
+		return;
+	}
+	pxDate->ucDay = 1;
+	if ( ++pxDate->eMonth <= eDecember ) {
+		return;
+	}
+	pxDate->eMonth = eJanuary;
+	pxDate->usYear++;
+}
+
+static bool prvDateEqual( xDate_t *pxA, xDate_t *pxB )
+{
+	return ( pxA->usYear == pxB->usYear ) && ( pxA->eMonth == pxB->eMonth ) && ( pxA->ucDay == pxB->ucDay ) && ( pxA->eDayOfWeek == pxB->eDayOfWeek );
+}
+
+static double prvSeconds( void )
+{
+	struct timespec xNow;
+	clock_gettime( CLOCK_MONOTONIC, &xNow );
+	return xNow.tv_sec + xNow.tv_nsec * 1e-9;
+}
+
+/* Round trips every day from an epoch until seconds overflow 32 bits, returns the number of days checked */
+static uint32_t prvRoundTripEpoch( eTimeEpoch_t eEpoch, xDate_t xStart )
+{
+	xDate_t		xExpected = xStart;
+	xDateTime_t xDatetime;
+	uint32_t	ulDay, ulSeconds, ulBack;
+	uint32_t	ulFailures = 0;
+
+	for ( ulDay = 0; ulDay <= UINT32_MAX / SECONDS_IN_1_DAY; ulDay++ ) {
+		/* A random time of day, the final day is cut short by the 32 bit limit */
+		ulSeconds = ulDay * SECONDS_IN_1_DAY;
+		ulSeconds += (uint32_t) rand() % ( ( ulDay == UINT32_MAX / SECONDS_IN_1_DAY ) ? ( UINT32_MAX - ulSeconds + 1 ) : SECONDS_IN_1_DAY );
+
+		/* Uncached in both directions */
+		xDayCache = xEmptyCache;
+		vRtcEpochToDateTime( eEpoch, ulSeconds, &xDatetime );
+		bool bDate = prvDateEqual( &xDatetime.xDate, &xExpected ) && ( eRtcDayOfWeek( &xDatetime.xDate ) == xExpected.eDayOfWeek );
+		bool bTime = ( ( xDatetime.xTime.ucHour * 3600 ) + ( xDatetime.xTime.ucMinute * 60 ) + xDatetime.xTime.ucSecond ) == ( ulSeconds % SECONDS_IN_1_DAY );
+		xDayCache  = xEmptyCache;
+		vRtcDateTimeToEpoch( &xDatetime, eEpoch, &ulBack );
+		bool bUncached = ( ulBack == ulSeconds );
+		/* Cached, the first conversion fills the cache for the second */
+		vRtcEpochToDateTime( eEpoch, ulSeconds, &xDatetime );
+		vRtcDateTimeToEpoch( &xDatetime, eEpoch, &ulBack );
+		bool bCached = ( ulBack == ulSeconds ) && prvDateEqual( &xDatetime.xDate, &xExpected );
+
+		if ( !( bDate && bTime && bUncached && bCached ) ) {
+			if ( ulFailures++ == 0 ) {
+				CHECK( 0, "epoch %d second %u: %04d-%02d-%02d day %d, expected %04d-%02d-%02d day %d, time %d, back %u", eEpoch, ulSeconds,
+					   xDatetime.xDate.usYear, xDatetime.xDate.eMonth, xDatetime.xDate.ucDay, xDatetime.xDate.eDayOfWeek, xExpected.usYear,
+					   xExpected.eMonth, xExpected.ucDay, xExpected.eDayOfWeek, bTime, ulBack );
+			}
+		}
+		prvNextDay( &xExpected );
+	}
+	CHECK( ulFailures == 0, "epoch %d: %u of %u days failed", eEpoch, ulFailures, ulDay );
+	return ulDay;
+}
+
+/* Best of 3, stepping by ulStep seconds per conversion so a step of a day misses the cache every time */
+__attribute__( ( noinline, no_sanitize_address ) ) static double prvTimeToDate( uint32_t ulStep )
+{
+	volatile uint32_t ulSink = 0;
+	xDateTime_t		  xDatetime;
+	double			  dBest = 1e9;
+
+	for ( int iRun = 0; iRun < 3; iRun++ ) {
+		double dStart = prvSeconds();
+		for ( uint32_t i = 0; i < 1000000; i++ ) {
+			vRtcEpochToDateTime( e2000Epoch, 600000000 + i * ulStep, &xDatetime );
+			ulSink += xDatetime.xDate.ucDay;
+		}
+		double dElapsed = prvSeconds() - dStart;
+		dBest			= dElapsed < dBest ? dElapsed : dBest;
+	}
+	return 1e3 * dBest;
+}
+
+__attribute__( ( noinline, no_sanitize_address ) ) static double prvTimeToEpoch( uint32_t ulStep )
+{
+	static xDateTime_t pxDatetimes[1024];
+	volatile uint32_t  ulSink = 0;
+	uint32_t		   ulEpoch;
+	double			   dBest = 1e9;
+
+	for ( uint32_t i = 0; i < 1024; i++ ) {
+		vRtcEpochToDateTime( e2000Epoch, 600000000 + i * ulStep, &pxDatetimes[i] );
+	}
+	for ( int iRun = 0; iRun < 3; iRun++ ) {
+		double dStart = prvSeconds();
+		for ( uint32_t i = 0; i < 1000000; i++ ) {
+			vRtcDateTimeToEpoch( &pxDatetimes[i % 1024], e2000Epoch, &ulEpoch );
+			ulSink += ulEpoch;
+		}
+		double dElapsed = prvSeconds() - dStart;
+		dBest			= dElapsed < dBest ? dElapsed : dBest;
+	}
+	return 1e3 * dBest;
+}
+
+int main( void )
+{
+	xDateTime_t xDatetime = { 0 };
+	uint32_t	ulEpoch, ulDays;
+
+	/* An all zero date must not hit the empty cache, it converts the same as with any other cache contents */
+	vRtcDateTimeToEpoch( &xDatetime, eUnixEpoch, &ulEpoch );
+	CHECK( ulEpoch == (uint32_t) DAYS_TO_SECONDS( prvDaysFromCivil( &xDatetime.xDate ) ), "zero date hit the empty cache: %u", ulEpoch );
+
+	/* Known dates */
+	xDatetime = ( xDateTime_t ){ { 2020, eFebruary, 29, eSaturday }, { 12, 34, 56, 0 } };
+	vRtcDateTimeToEpoch( &xDatetime, eUnixEpoch, &ulEpoch );
+	CHECK( ulEpoch == 1582979696, "2020-02-29 12:34:56 unix %u", ulEpoch );
+	vRtcDateTimeToEpoch( &xDatetime, e2000Epoch, &ulEpoch );
+	CHECK( ulEpoch == 1582979696 - 946684800, "2020-02-29 12:34:56 2000 epoch %u", ulEpoch );
+
+	srand( 1 );
+	ulDays = prvRoundTripEpoch( eUnixEpoch, ( xDate_t ){ 1970, eJanuary, 1, eThursday } );
+	ulDays += prvRoundTripEpoch( e2000Epoch, ( xDate_t ){ 2000, eJanuary, 1, eSaturday } );
+	ulDays += prvRoundTripEpoch( e2015Epoch, ( xDate_t ){ 2015, eJanuary, 1, eThursday } );
+	printf( "%u days round tripped, 1970 to 2151\n", ulDays );
+
+	/* Timings, informational only */
+	printf( "Epoch to date: %.1f ns cached, %.1f ns uncached per call\n", prvTimeToDate( 1 ), prvTimeToDate( SECONDS_IN_1_DAY ) );
+	printf( "Date to epoch: %.1f ns cached, %.1f ns uncached per call\n", prvTimeToEpoch( 0 ), prvTimeToEpoch( SECONDS_IN_1_DAY ) );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
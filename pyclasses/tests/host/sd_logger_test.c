@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the SD logger read ahead cache against a RAM backed card model
+ * Built with SD_READ_AHEAD_PAGES 8, writes are injected while a read ahead is in progress.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "sd.h"
+#include "sd_logger.h"
+
+#define NUM_BLOCKS 64
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+static uint8_t pucCard[NUM_BLOCKS][512];
+static int	 iMultiReads, iSingleReads;
+/* Block written by another task while the next multi block read is in progress */
+static uint32_t ulConcurrentWrite = UINT32_MAX;
+
+eModuleError_t eSdParameters( xSdParameters_t *pxParameters )
+{
+	pxParameters->ulBlockSize = 512;
+	pxParameters->ulNumBlocks = NUM_BLOCKS;
+	pxParameters->ucEraseByte = 0x00;
+	return ERROR_NONE;
+}
+
+eModuleError_t eSdBlockRead( uint32_t ulBlockAddress, uint16_t usBlockOffset, uint8_t *pucBuffer, uint16_t usBufferLen, TickType_t xTimeout )
+{
+	iSingleReads++;
+	memcpy( pucBuffer, pucCard[ulBlockAddress] + usBlockOffset, usBufferLen );
+	return ERROR_NONE;
+}
+
+eModuleError_t eSdBlockWrite( uint32_t ulBlockAddress, uint16_t usBlockOffset, uint8_t *pucBuffer, uint16_t usBufferLen, TickType_t xTimeout )
+{
+	memcpy( pucCard[ulBlockAddress] + usBlockOffset, pucBuffer, usBufferLen );
+	return ERROR_NONE;
+}
+
+eModuleError_t eSdMultiBlockRead( uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer, TickType_t xTimeout )
+{
+	uint8_t pucNew[512];
+	iMultiReads++;
+	memcpy( pucBuffer, pucCard[ulBlockAddress], 512 * ulNumBlocks );
+	/* The other task completes its write after the data has been transferred */
+	if ( ulConcurrentWrite != UINT32_MAX ) {
+		memset( pucNew, 0xA5, sizeof( pucNew ) );
+		xSdLoggerDevice.fnWriteBlock( ulConcurrentWrite, pucNew, sizeof( pucNew ) );
+		ulConcurrentWrite = UINT32_MAX;
+	}
+	return ERROR_NONE;
+}
+
+eModuleError_t eSdMultiBlockWrite( uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer, TickType_t xTimeout )
+{
+	memcpy( pucCard[ulBlockAddress], pucBuffer, 512 * ulNumBlocks );
+	return ERROR_NONE;
+}
+
+eModuleError_t eSdEraseBlocks( uint32_t ulFirstBlockAddress, uint32_t ulLastBlockAddress, TickType_t xTimeout )
+{
+	memset( pucCard[ulFirstBlockAddress], 0x00, 512 * ( ulLastBlockAddress - ulFirstBlockAddress + 1 ) );
+	return ERROR_NONE;
+}
+
+static bool prvRead( uint32_t ulBlock, uint8_t *pucExpected )
+{
+	uint8_t pucData[512];
+	xSdLoggerDevice.fnReadBlock( ulBlock, 0, pucData, sizeof( pucData ) );
+	return memcmp( pucData, pucExpected, sizeof( pucData ) ) == 0;
+}
+
+int main( void )
+{
+	uint8_t  pucNew[512];
+	uint32_t i;
+
+	for ( i = 0; i < NUM_BLOCKS; i++ ) {
+		memset( pucCard[i], i, 512 );
+	}
+
+	/* Sequential reads from the start of the card are served by multi block reads of 8 pages */
+	for ( i = 0; i < 9; i++ ) {
+		CHECK( prvRead( i, pucCard[i] ), "sequential block %u", i );
+	}
+	CHECK( iMultiReads == 2 && iSingleReads == 0, "sequential transactions %d multi %d single", iMultiReads, iSingleReads );
+
+	/* Writes and erases of cached blocks are seen by the next read */
+	memset( pucNew, 0x5A, sizeof( pucNew ) );
+	xSdLoggerDevice.fnWriteBlock( 4, pucNew, sizeof( pucNew ) );
+	CHECK( prvRead( 4, pucNew ), "write of cached block" );
+	for ( i = 5; i < 9; i++ ) {
+		CHECK( prvRead( i, pucCard[i] ), "block %u after write", i );
+	}
+	xSdLoggerDevice.fnPrepareBlock( 7 );
+	CHECK( prvRead( 7, pucCard[7] ) && pucCard[7][0] == 0x00, "erase of cached block" );
+
+	/* A write completing during the read ahead must not leave stale data cached */
+	ulConcurrentWrite = 22;
+	CHECK( prvRead( 19, pucCard[19] ), "block 19" );
+	for ( i = 20; i < 26; i++ ) {
+		CHECK( prvRead( i, pucCard[i] ), "block %u after concurrent write", i );
+	}
+	CHECK( pucCard[22][0] == 0xA5, "concurrent write applied" );
+
+	/* Writes outside the cached range keep the cache */
+	iMultiReads  = 0;
+	iSingleReads = 0;
+	CHECK( prvRead( 40, pucCard[40] ), "block 40" );
+	CHECK( prvRead( 41, pucCard[41] ), "block 41" );
+	xSdLoggerDevice.fnWriteBlock( 2, pucNew, sizeof( pucNew ) );
+	CHECK( prvRead( 42, pucCard[42] ), "block 42" );
+	CHECK( iMultiReads == 1, "cache dropped by unrelated write, %d multi reads", iMultiReads );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
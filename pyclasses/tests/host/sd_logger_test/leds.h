@@ -0,0 +1 @@
+/* Host stub, unused by the modules under test */
@@ -0,0 +1,23 @@
+/*
+ * Host model of the SD card driver, backed by RAM
+ */
+#ifndef __CORE_CSIRO_HOST_SD_H__
+#define __CORE_CSIRO_HOST_SD_H__
+
+#include "FreeRTOS.h"
+
+typedef struct xSdParameters_t
+{
+	uint32_t ulBlockSize;
+	uint32_t ulNumBlocks;
+	uint8_t  ucEraseByte;
+} xSdParameters_t;
+
+eModuleError_t eSdParameters( xSdParameters_t *pxParameters );
+eModuleError_t eSdBlockRead( uint32_t ulBlockAddress, uint16_t usBlockOffset, uint8_t *pucBuffer, uint16_t usBufferLen, TickType_t xTimeout );
+eModuleError_t eSdBlockWrite( uint32_t ulBlockAddress, uint16_t usBlockOffset, uint8_t *pucBuffer, uint16_t usBufferLen, TickType_t xTimeout );
+eModuleError_t eSdMultiBlockRead( uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer, TickType_t xTimeout );
+eModuleError_t eSdMultiBlockWrite( uint32_t ulBlockAddress, uint32_t ulNumBlocks, uint8_t *pucBuffer, TickType_t xTimeout );
+eModuleError_t eSdEraseBlocks( uint32_t ulFirstBlockAddress, uint32_t ulLastBlockAddress, TickType_t xTimeout );
+
+#endif /* __CORE_CSIRO_HOST_SD_H__ */
@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the SD card driver, sd.c and sd_ll.c, against a simulated SPI mode card
+ *
+ * Every SPI byte is clocked through a model of the card command, data token and busy
+ * signalling, at 1 us per byte for the 8 MHz bus. The RTOS tick advances with that clock,
+ * so the driver's busy polling and vTaskDelay calls cost what they would on target.
+ * Card timings are representative of an SDHC card and are set below, throughput figures
+ * are relative to these assumptions rather than measurements of a particular card.
+ *
+ * sd.c is included directly so its static command functions can be called without the SD task.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sd.c"
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+/* Card timing assumptions, microseconds */
+#define CARD_SINGLE_READ_ACCESS_US 250 /**< CMD17 command to data token */
+#define CARD_MULTI_READ_ACCESS_US  250 /**< CMD18 command to first data token */
+#define CARD_MULTI_READ_GAP_US	   20  /**< Between data blocks of CMD18 */
+#define CARD_SINGLE_PROGRAM_US	   750 /**< Busy after each CMD24 block */
+#define CARD_MULTI_PROGRAM_US	   150 /**< Busy after each CMD25 block */
+#define CARD_PRE_ERASED_PROGRAM_US 0   /**< Busy after each CMD25 block covered by ACMD23 */
+#define CARD_STOP_BUSY_US		   250 /**< Busy after the CMD25 stop token */
+
+#define CARD_BLOCKS		8192
+#define TICK_US			( 1000000.0 / configTICK_RATE_HZ )
+#define BYTE_US			1.0
+
+typedef enum eCardState_t {
+	CARD_COMMAND,	  /**< Waiting for a command */
+	CARD_READ_STREAM,  /**< Sending CMD18 data blocks until CMD12 */
+	CARD_WRITE_TOKEN,  /**< Waiting for a CMD24 or CMD25 start token */
+	CARD_WRITE_DATA	/**< Receiving a data block */
+} eCardState_t;
+
+typedef struct xCard_t
+{
+	uint8_t		 pucMemory[CARD_BLOCKS * SD_DEFAULT_BLOCK_SIZE];
+	eCardState_t eState;
+	bool		 bCs;
+	bool		 bAppCommand;
+	bool		 bMultiple;
+	bool		 bIdle;
+	uint8_t		 pucCommand[6];
+	int			 iCommandLen;
+	uint8_t		 pucOut[SD_DEFAULT_BLOCK_SIZE + 8];
+	int			 iOutHead, iOutTail;
+	uint8_t		 pucData[SD_DEFAULT_BLOCK_SIZE + SD_DEFAULT_CRC_SIZE];
+	int			 iDataLen;
+	uint32_t	 ulAddress;
+	uint32_t	 ulPreErased;
+	double		 dBusyUntil;
+	double		 dDataReady;
+	/* Behaviour */
+	bool bPreEraseSupported;
+	bool bStuckAfterStop;
+	/* Command counts */
+	uint32_t pulCommands[64];
+	uint32_t pulAppCommands[64];
+	uint32_t ulLastPreErase;
+} xCard_t;
+
+static xCard_t xCard;
+static double  dNowUs;
+
+/*-----------------------------------------------------------*/
+
+/* Simulated time drives the RTOS tick */
+
+TickType_t xTaskGetTickCount( void )
+{
+	return (TickType_t) ( dNowUs / TICK_US );
+}
+
+void vTaskDelay( TickType_t xTicks )
+{
+	dNowUs = ( xTaskGetTickCount() + xTicks ) * TICK_US;
+}
+
+void vGpioSetup( xGpio_t xGpio, eGpioType_t eType, uint32_t ulParam ) {}
+
+void vEnergyActive( eEnergySubsystem_t eSubsystem, bool bActive ) {}
+
+/*-----------------------------------------------------------*/
+
+static void prvCardQueue( const uint8_t *pucBytes, int iLen )
+{
+	configASSERT( xCard.iOutTail + iLen <= (int) sizeof( xCard.pucOut ) );
+	memcpy( xCard.pucOut + xCard.iOutTail, pucBytes, iLen );
+	xCard.iOutTail += iLen;
+}
+
+/* Data token, block and CRC, queued behind any response already waiting */
+static void prvCardQueueBlock( const uint8_t *pucBlock, int iLen )
+{
+	static const uint8_t pucCrc[2] = { 0x12, 0x34 };
+	uint8_t				 ucToken   = 0xFE;
+	prvCardQueue( &ucToken, 1 );
+	prvCardQueue( pucBlock, iLen );
+	prvCardQueue( pucCrc, 2 );
+}
+
+static uint8_t prvCardPop( void )
+{
+	uint8_t ucMiso = xCard.pucOut[xCard.iOutHead++];
+	if ( xCard.iOutHead == xCard.iOutTail ) {
+		xCard.iOutHead = xCard.iOutTail = 0;
+	}
+	return ucMiso;
+}
+
+static void prvCardCommand( void )
+{
+	uint8_t	 ucCommand = xCard.pucCommand[0] & 0x3F;
+	uint32_t ulArg	   = BE_U32_EXTRACT( xCard.pucCommand + 1 );
+	bool	 bApp	   = xCard.bAppCommand;
+	uint8_t	 pucResponse[5];
+	uint8_t	 pucReg[16] = { 0 };
+	int		 iResponse	= 1;
+
+	xCard.bAppCommand = false;
+	pucResponse[0]	  = xCard.bIdle ? SD_RESP_IN_IDLE : 0x00;
+	if ( bApp ) {
+		xCard.pulAppCommands[ucCommand]++;
+	}
+	else {
+		xCard.pulCommands[ucCommand]++;
+	}
+
+	switch ( bApp ? 0x40 | ucCommand : ucCommand ) {
+		case SD_GO_IDLE_STATE:
+			xCard.bIdle	   = true;
+			pucResponse[0] = SD_RESP_IN_IDLE;
+			break;
+		case SD_SEND_IF_COND:
+			pucResponse[1] = 0x00;
+			pucResponse[2] = 0x00;
+			pucResponse[3] = ( ulArg >> 8 ) & 0x0F;
+			pucResponse[4] = ulArg & 0xFF;
+			iResponse	   = 5;
+			break;
+		case SD_READ_OCR:
+			/* Powered up, high capacity, 2.7V - 3.6V */
+			BE_U32_PACK( pucResponse + 1, xCard.bIdle ? SD_OCR_27_36 : ( SD_OCR_POWER_UP_STATUS | SD_OCR_CCS | SD_OCR_27_36 ) );
+			iResponse = 5;
+			break;
+		case SD_APP_CMD:
+			xCard.bAppCommand = true;
+			break;
+		case 0x40 | SD_SEND_OP_COND:
+			xCard.bIdle	   = false;
+			pucResponse[0] = 0x00;
+			break;
+		case SD_SEND_CSD:
+			/* CSD version 2.0, 512 byte blocks, C_SIZE gives CARD_BLOCKS */
+			pucReg[0] = 0x40;
+			pucReg[5] = 0x09;
+			pucReg[9] = ( CARD_BLOCKS / 1024 ) - 1;
+			prvCardQueue( pucResponse, 1 );
+			prvCardQueueBlock( pucReg, 16 );
+			return;
+		case SD_SEND_CID:
+			pucReg[0] = 0x03;
+			memcpy( pucReg + 1, "SDHOST", 6 );
+			prvCardQueue( pucResponse, 1 );
+			prvCardQueueBlock( pucReg, 16 );
+			return;
+		case 0x40 | SD_SEND_SCR:
+			/* SD 3.0, erased blocks read as 0xFF */
+			pucReg[0] = 0x02;
+			pucReg[1] = 0x80;
+			pucReg[2] = 0x80;
+			prvCardQueue( pucResponse, 1 );
+			prvCardQueueBlock( pucReg, 16 );
+			return;
+		case 0x40 | SD_SET_WR_BLK_ERASE_COUNT:
+			if ( xCard.bPreEraseSupported ) {
+				xCard.ulPreErased	 = ulArg & 0x7FFFFF;
+				xCard.ulLastPreErase = xCard.ulPreErased;
+			}
+			else {
+				pucResponse[0] |= SD_RESP_ILLEGAL_COMMAND;
+			}
+			break;
+		case SD_READ_SINGLE_BLOCK:
+		case SD_READ_MULTIPLE_BLOCK:
+			if ( ulArg >= CARD_BLOCKS ) {
+				pucResponse[0] |= SD_RESP_ADDRESS_ERROR;
+				break;
+			}
+			xCard.ulAddress	 = ulArg;
+			xCard.bMultiple	 = ( ucCommand == SD_READ_MULTIPLE_BLOCK );
+			xCard.eState	 = CARD_READ_STREAM;
+			xCard.dDataReady = dNowUs + ( xCard.bMultiple ? CARD_MULTI_READ_ACCESS_US : CARD_SINGLE_READ_ACCESS_US );
+			break;
+		case SD_STOP_TRANSMISSION:
+			/* The byte following CMD12 is discarded before the response */
+			xCard.eState	 = CARD_COMMAND;
+			xCard.dBusyUntil = dNowUs + 2 * BYTE_US;
+			prvCardQueue( (uint8_t[]){ 0xFF }, 1 );
+			break;
+		case SD_WRITE_BLOCK:
+		case SD_WRITE_MULTIPLE_BLOCK:
+			if ( ulArg >= CARD_BLOCKS ) {
+				pucResponse[0] |= SD_RESP_ADDRESS_ERROR;
+				break;
+			}
+			xCard.ulAddress = ulArg;
+			xCard.bMultiple = ( ucCommand == SD_WRITE_MULTIPLE_BLOCK );
+			xCard.eState	= CARD_WRITE_TOKEN;
+			if ( !xCard.bMultiple ) {
+				xCard.ulPreErased = 0;
+			}
+			break;
+		default:
+			pucResponse[0] |= SD_RESP_ILLEGAL_COMMAND;
+			break;
+	}
+	prvCardQueue( pucResponse, iResponse );
+}
+
+/* One byte in each direction, MOSI from the driver and MISO from the card */
+static uint8_t prvCardExchange( uint8_t ucMosi )
+{
+	uint8_t ucMiso = 0xFF;
+
+	dNowUs += BYTE_US;
+	if ( !xCard.bCs ) {
+		return 0xFF;
+	}
+	/* Queued responses and data take priority */
+	if ( xCard.iOutHead < xCard.iOutTail ) {
+		return prvCardPop();
+	}
+	/* Commands are accepted in any state except during a write data block */
+	if ( ( xCard.eState != CARD_WRITE_DATA ) && ( ( xCard.iCommandLen > 0 ) || ( ( ucMosi & 0xC0 ) == 0x40 ) ) ) {
+		xCard.pucCommand[xCard.iCommandLen++] = ucMosi;
+		if ( xCard.iCommandLen == 6 ) {
+			xCard.iCommandLen = 0;
+			prvCardCommand();
+		}
+		return 0xFF;
+	}
+	if ( dNowUs < xCard.dBusyUntil ) {
+		return 0x00;
+	}
+	switch ( xCard.eState ) {
+		case CARD_READ_STREAM:
+			if ( dNowUs >= xCard.dDataReady ) {
+				prvCardQueueBlock( xCard.pucMemory + ( xCard.ulAddress * SD_DEFAULT_BLOCK_SIZE ), SD_DEFAULT_BLOCK_SIZE );
+				if ( xCard.bMultiple ) {
+					xCard.ulAddress	 = ( xCard.ulAddress + 1 ) % CARD_BLOCKS;
+					xCard.dDataReady = dNowUs + ( xCard.iOutTail * BYTE_US ) + CARD_MULTI_READ_GAP_US;
+				}
+				else {
+					xCard.eState = CARD_COMMAND;
+				}
+				ucMiso = prvCardPop();
+			}
+			break;
+		case CARD_WRITE_TOKEN:
+			if ( ( ucMosi == 0xFE && !xCard.bMultiple ) || ( ucMosi == 0xFC && xCard.bMultiple ) ) {
+				xCard.eState   = CARD_WRITE_DATA;
+				xCard.iDataLen = 0;
+			}
+			else if ( ucMosi == 0xFD && xCard.bMultiple ) {
+				xCard.eState	  = CARD_COMMAND;
+				xCard.ulPreErased = 0;
+				xCard.dBusyUntil  = dNowUs + BYTE_US + ( xCard.bStuckAfterStop ? 1e9 : CARD_STOP_BUSY_US );
+			}
+			break;
+		case CARD_WRITE_DATA:
+			xCard.pucData[xCard.iDataLen++] = ucMosi;
+			if ( xCard.iDataLen == SD_DEFAULT_BLOCK_SIZE + SD_DEFAULT_CRC_SIZE ) {
+				uint8_t ucAccepted = 0xE5;
+				double	dProgram   = CARD_SINGLE_PROGRAM_US;
+				memcpy( xCard.pucMemory + ( xCard.ulAddress * SD_DEFAULT_BLOCK_SIZE ), xCard.pucData, SD_DEFAULT_BLOCK_SIZE );
+				if ( xCard.bMultiple ) {
+					dProgram = ( xCard.ulPreErased > 0 ) ? CARD_PRE_ERASED_PROGRAM_US : CARD_MULTI_PROGRAM_US;
+					if ( xCard.ulPreErased > 0 ) {
+						xCard.ulPreErased--;
+					}
+					xCard.ulAddress = ( xCard.ulAddress + 1 ) % CARD_BLOCKS;
+					xCard.eState	= CARD_WRITE_TOKEN;
+				}
+				else {
+					xCard.eState = CARD_COMMAND;
+				}
+				prvCardQueue( &ucAccepted, 1 );
+				xCard.dBusyUntil = dNowUs + BYTE_US + dProgram;
+			}
+			break;
+		default:
+			break;
+	}
+	return ucMiso;
+}
+
+/*-----------------------------------------------------------*/
+
+/* SPI bus, every transfer is clocked through the card */
+
+eModuleError_t eSpiBusStart( xSpiModule_t *pxSpi, const xSpiConfig_t *xConfig, TickType_t xTimeout )
+{
+	CHECK( !pxSpi->bBusClaimed, "bus claimed twice" );
+	pxSpi->bBusClaimed	   = true;
+	pxSpi->pxCurrentConfig = xConfig;
+	return ERROR_NONE;
+}
+
+void vSpiBusEnd( xSpiModule_t *pxSpi )
+{
+	CHECK( pxSpi->bBusClaimed, "bus released while not claimed" );
+	CHECK( !xCard.bCs, "bus released with CS asserted" );
+	pxSpi->bBusClaimed = false;
+}
+
+void vSpiCsAssert( xSpiModule_t *pxSpi )
+{
+	pxSpi->bCsAsserted = true;
+	xCard.bCs		   = true;
+}
+
+void vSpiCsRelease( xSpiModule_t *pxSpi )
+{
+	pxSpi->bCsAsserted = false;
+	xCard.bCs		   = false;
+	/* Responses not clocked out before CS rises are lost */
+	xCard.iOutHead = xCard.iOutTail = 0;
+	xCard.iCommandLen				= 0;
+}
+
+void vSpiTransmit( xSpiModule_t *pxSpi, void *pvBuffer, uint32_t ulBufferLen )
+{
+	CHECK( pxSpi->bBusClaimed, "transmit without the bus" );
+	for ( uint32_t i = 0; i < ulBufferLen; i++ ) {
+		prvCardExchange( ( (uint8_t *) pvBuffer )[i] );
+	}
+	pxSpi->xPlatform.ulBytes += ulBufferLen;
+}
+
+void vSpiReceive( xSpiModule_t *pxSpi, void *pvBuffer, uint32_t ulBufferLen )
+{
+	CHECK( pxSpi->bBusClaimed, "receive without the bus" );
+	for ( uint32_t i = 0; i < ulBufferLen; i++ ) {
+		( (uint8_t *) pvBuffer )[i] = prvCardExchange( 0xFF );
+	}
+	pxSpi->xPlatform.ulBytes += ulBufferLen;
+}
+
+/*-----------------------------------------------------------*/
+
+#define BENCH_BLOCKS 256
+
+static xSpiModule_t	   xSpi;
+static xSdInit_t	   xInit = { &xSpi, { 1 } };
+static xSdParameters_t xParams;
+static uint8_t		   pucWrite[BENCH_BLOCKS * SD_DEFAULT_BLOCK_SIZE];
+static uint8_t		   pucRead[BENCH_BLOCKS * SD_DEFAULT_BLOCK_SIZE];
+
+/* Transfers BENCH_BLOCKS blocks in requests of ulPerRequest blocks, returns MB/s of simulated time */
+static double prvBench( bool bWrite, uint32_t ulPerRequest, uint32_t ulFirstBlock )
+{
+	double		   dStart = dNowUs;
+	eModuleError_t eError = ERROR_NONE;
+
+	for ( uint32_t i = 0; ( i < BENCH_BLOCKS ) && ( eError == ERROR_NONE ); i += ulPerRequest ) {
+		uint8_t *pucBuffer = ( bWrite ? pucWrite : pucRead ) + ( i * SD_DEFAULT_BLOCK_SIZE );
+		if ( bWrite ) {
+			eError = prvSdMultiBlockWrite( &xParams, ulFirstBlock + i, ulPerRequest, pucBuffer );
+		}
+		else {
+			eError = prvSdMultiBlockRead( &xParams, ulFirstBlock + i, ulPerRequest, pucBuffer );
+		}
+	}
+	CHECK( eError == ERROR_NONE, "%s of %u blocks per request failed %d", bWrite ? "write" : "read", ulPerRequest, eError );
+	if ( !bWrite ) {
+		CHECK( memcmp( pucRead, pucWrite, sizeof( pucRead ) ) == 0, "read back of %u blocks per request", ulPerRequest );
+	}
+	return ( BENCH_BLOCKS * SD_DEFAULT_BLOCK_SIZE ) / ( dNowUs - dStart );
+}
+
+int main( void )
+{
+	uint8_t pucBlock[SD_DEFAULT_BLOCK_SIZE];
+	int		i;
+
+	xCard.bPreEraseSupported = true;
+	memset( xCard.pucMemory, 0xFF, sizeof( xCard.pucMemory ) );
+	srand( 1 );
+	for ( i = 0; i < (int) sizeof( pucWrite ); i++ ) {
+		pucWrite[i] = rand();
+	}
+
+	/* Card identification through the driver startup sequence */
+	pxConfig = &xInit;
+	vSdLLInit( &xSpi, xInit.xChipSelect );
+	prvSdStartupSequence( &xParams );
+	CHECK( xParams.eCardType == SDCARD_TYPE_SDHC, "card type %d", xParams.eCardType );
+	CHECK( xParams.ulNumBlocks == CARD_BLOCKS && xParams.ulBlockSize == SD_DEFAULT_BLOCK_SIZE, "card %u blocks of %u", xParams.ulNumBlocks,
+		   xParams.ulBlockSize );
+	CHECK( xParams.ucEraseByte == 0xFF, "erase byte %02X", xParams.ucEraseByte );
+
+	/* Partial single block write and read, the remainder of the block is cleared */
+	CHECK( prvSdBlockWrite( &xParams, 10, 100, pucWrite, 50 ) == ERROR_NONE, "partial block write" );
+	CHECK( memcmp( xCard.pucMemory + ( 10 * 512 ) + 100, pucWrite, 50 ) == 0 && xCard.pucMemory[10 * 512 + 99] == 0xFF, "partial block contents" );
+	CHECK( prvSdBlockRead( &xParams, 10, 100, pucBlock, 50 ) == ERROR_NONE && memcmp( pucBlock, pucWrite, 50 ) == 0, "partial block read" );
+	CHECK( xCard.pulCommands[SD_WRITE_BLOCK] == 1 && xCard.pulCommands[SD_READ_SINGLE_BLOCK] == 1, "single block commands" );
+
+	/* Multiple block transfers use CMD25 with an ACMD23 pre-erase hint, and CMD18 terminated by CMD12 */
+	CHECK( prvSdMultiBlockWrite( &xParams, 100, 64, pucWrite ) == ERROR_NONE, "multiple block write" );
+	CHECK( xCard.pulCommands[SD_WRITE_MULTIPLE_BLOCK] == 1 && xCard.pulAppCommands[SD_SET_WR_BLK_ERASE_COUNT] == 1 && xCard.ulLastPreErase == 64,
+		   "CMD25 %u ACMD23 %u of %u", xCard.pulCommands[SD_WRITE_MULTIPLE_BLOCK], xCard.pulAppCommands[SD_SET_WR_BLK_ERASE_COUNT],
+		   xCard.ulLastPreErase );
+	CHECK( memcmp( xCard.pucMemory + ( 100 * 512 ), pucWrite, 64 * 512 ) == 0, "multiple block contents" );
+	CHECK( prvSdMultiBlockRead( &xParams, 100, 64, pucRead ) == ERROR_NONE && memcmp( pucRead, pucWrite, 64 * 512 ) == 0, "multiple block read" );
+	CHECK( xCard.pulCommands[SD_READ_MULTIPLE_BLOCK] == 1 && xCard.pulCommands[SD_STOP_TRANSMISSION] == 1, "CMD18 %u CMD12 %u",
+		   xCard.pulCommands[SD_READ_MULTIPLE_BLOCK], xCard.pulCommands[SD_STOP_TRANSMISSION] );
+
+	/* A card that rejects the pre-erase hint still completes the write */
+	xCard.bPreEraseSupported = false;
+	CHECK( prvSdMultiBlockWrite( &xParams, 300, 8, pucWrite ) == ERROR_NONE, "write without pre-erase" );
+	CHECK( memcmp( xCard.pucMemory + ( 300 * 512 ), pucWrite, 8 * 512 ) == 0, "write without pre-erase contents" );
+	xCard.bPreEraseSupported = true;
+
+	/* A card that never finishes programming after the stop token fails the write */
+	xCard.bStuckAfterStop = true;
+	CHECK( prvSdMultiBlockWrite( &xParams, 400, 4, pucWrite ) == ERROR_TIMEOUT, "busy after stop token was not reported" );
+	xCard.bStuckAfterStop = false;
+	xCard.dBusyUntil	  = 0;
+
+	/* Throughput in simulated time, informational only */
+	double dSingleWrite = prvBench( true, 1, 1000 );
+	double dSingleRead	= prvBench( false, 1, 1000 );
+	double dMultiWrite	= prvBench( true, 32, 2000 );
+	double dMultiRead	= prvBench( false, 32, 2000 );
+	xCard.bPreEraseSupported = false;
+	double dNoHintWrite		 = prvBench( true, 32, 3000 );
+	printf( "%d KB at 8 MHz SPI with the modelled card timings:\n", BENCH_BLOCKS / 2 );
+	printf( "  single block:          write %.3f MB/s, read %.3f MB/s\n", dSingleWrite, dSingleRead );
+	printf( "  32 block multiple:     write %.3f MB/s, read %.3f MB/s\n", dMultiWrite, dMultiRead );
+	printf( "  32 block, no ACMD23:   write %.3f MB/s\n", dNoHintWrite );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,24 @@
+/*
+ * Host model of the GPIO platform, pins are plain numbers
+ */
+#ifndef __CORE_CSIRO_HOST_GPIO_ARCH_H__
+#define __CORE_CSIRO_HOST_GPIO_ARCH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define UNUSED_GPIO_ARCH ( xGpio_t ){ UINT8_MAX }
+
+#define ASSERT_GPIO_ASSIGNED_ARCH( xGpio ) configASSERT( xGpio.ucPin != UNUSED_GPIO.ucPin )
+
+typedef struct xGpio_t
+{
+	uint8_t ucPin;
+} xGpio_t;
+
+static inline bool bGpioEqual( xGpio_t xGpioA, xGpio_t xGpioB )
+{
+	return ( xGpioA.ucPin == xGpioB.ucPin );
+}
+
+#endif /* __CORE_CSIRO_HOST_GPIO_ARCH_H__ */
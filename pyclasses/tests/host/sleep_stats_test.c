@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the tickless idle sleep accounting, directly and through the nRF52 tickless idle port
+ * Known idle periods are first fed to vSleepStatsRecord, checking the histogram bins, wake counters,
+ * oversleep and undersleep, and the saturation of the logged TDFs.
+ * The nRF52 port is then run against a model of the 24 bit RTC for NUM_PERIODS random idle periods,
+ * starting just before the counter wraps. Every outcome is injected by the model, and the kernel tick
+ * must advance by exactly the modelled time, including over counter wraps and sleeps without a timeout.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "cpu.h"
+#include "csiro_math.h"
+#include "energy.h"
+#include "nrfx_rtc.h"
+#include "sleep_stats.h"
+#include "tdf.h"
+
+#define NUM_PERIODS 200000
+#define UINT24_MASK 0x00FFFFFF
+#define RTC_START ( UINT24_MASK - 5000 )
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+/* Outcome of the next idle period, set by the harness before calling the port */
+typedef struct xPlan_t
+{
+	bool			 bCanSleep;
+	eSleepModeStatus eStatus;
+	uint32_t		 ulSleep;	 /**< Ticks asleep when woken by an interrupt */
+	uint32_t		 ulLatency;   /**< Ticks slept past the wake timer */
+	int32_t			 lIrq;		  /**< Interrupt that ends the sleep, SLEEP_STATS_IRQ_UNKNOWN for the wake timer */
+	bool			 bInterrupt;  /**< Woken by an interrupt rather than the wake timer */
+} xPlan_t;
+
+/* Implemented by RTC_tickless_idle.c */
+void vPortSetupTimerInterrupt( void );
+void portSUPPRESS_TICKS_AND_SLEEP( TickType_t xExpectedIdleTime );
+
+int		  iCriticalDepth;
+NVIC_Type xNvic;
+
+static xPlan_t			  xPlan;
+static uint32_t			  ulRtc, ulCompare, ulPrescaler;
+static bool				  bCompareSet, bTickEnabled, bCpuActive = true;
+static TickType_t		  xTick;
+static nrfx_rtc_handler_t xRtcHandler;
+
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void )
+{
+	return xTick;
+}
+
+void vTaskStepTick( TickType_t xTicksToJump )
+{
+	xTick += xTicksToJump;
+}
+
+BaseType_t xTaskIncrementTick( void )
+{
+	xTick++;
+	return pdFALSE;
+}
+
+eSleepModeStatus eTaskConfirmSleepModeStatus( void )
+{
+	return xPlan.eStatus;
+}
+
+void vPendContextSwitch( void ) {}
+
+bool bBoardCanDeepSleep( void )
+{
+	return xPlan.bCanSleep;
+}
+
+void vBoardDeepSleep( void ) {}
+
+void vEnergyActive( eEnergySubsystem_t eSubsystem, bool bActive )
+{
+	CHECK( ( eSubsystem == ENERGY_CPU ) && ( bActive != bCpuActive ), "CPU energy state %d repeated", bActive );
+	bCpuActive = bActive;
+}
+
+uint32_t nrfx_rtc_init( nrfx_rtc_t const *pxRtc, nrfx_rtc_config_t const *pxConfig, nrfx_rtc_handler_t xHandler )
+{
+	ulPrescaler = pxConfig->prescaler;
+	xRtcHandler = xHandler;
+	return 0;
+}
+
+void nrfx_rtc_enable( nrfx_rtc_t const *pxRtc ) {}
+
+void nrfx_rtc_tick_enable( nrfx_rtc_t const *pxRtc, bool bInterrupt )
+{
+	bTickEnabled = true;
+}
+
+void nrfx_rtc_tick_disable( nrfx_rtc_t const *pxRtc )
+{
+	bTickEnabled = false;
+}
+
+uint32_t nrfx_rtc_cc_set( nrfx_rtc_t const *pxRtc, uint32_t ulChannel, uint32_t ulValue, bool bInterrupt )
+{
+	CHECK( ulValue <= UINT24_MASK, "compare %08x beyond the counter", ulValue );
+	ulCompare   = ulValue;
+	bCompareSet = true;
+	return 0;
+}
+
+uint32_t nrfx_rtc_cc_disable( nrfx_rtc_t const *pxRtc, uint32_t ulChannel )
+{
+	bCompareSet = false;
+	return 0;
+}
+
+uint32_t nrfx_rtc_counter_get( nrfx_rtc_t const *pxRtc )
+{
+	return ulRtc & UINT24_MASK;
+}
+
+/* Sleeps until the planned interrupt, or until the compare plus the wake latency */
+void __WFI( void )
+{
+	uint32_t ulSleep;
+
+	CHECK( iCriticalDepth == 1, "WFI with critical depth %d", iCriticalDepth );
+	CHECK( !bCpuActive && !bTickEnabled, "WFI with the CPU active or the tick running" );
+	if ( xPlan.bInterrupt ) {
+		ulSleep = xPlan.ulSleep;
+		if ( xPlan.lIrq != SLEEP_STATS_IRQ_UNKNOWN ) {
+			xNvic.ISPR[xPlan.lIrq / 32] |= 1UL << ( xPlan.lIrq % 32 );
+		}
+	}
+	else {
+		CHECK( bCompareSet, "timed sleep without a compare" );
+		ulSleep = ( ( ulCompare - ulRtc ) & UINT24_MASK ) + xPlan.ulLatency;
+	}
+	/* The suppressed tick timer is always pending after a sleep */
+	xNvic.ISPR[RTC1_IRQn / 32] |= 1UL << ( RTC1_IRQn % 32 );
+	ulRtc += ulSleep;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t ucTdfs[3][64];
+static int	 iWakeIrqTdfs;
+
+eModuleError_t eTdfAddMulti( uint8_t ucLoggerMask, eTdfIds_t eTdfId, eTdfTimestampType_t eTimestampType, xTdfTime_t *pxGlobalTime, void *pucData )
+{
+	switch ( eTdfId ) {
+		case TDF_SLEEP_STATS:
+			memcpy( ucTdfs[0], pucData, pucTdfStructLengths[eTdfId] );
+			break;
+		case TDF_SLEEP_HISTOGRAM:
+			memcpy( ucTdfs[1], pucData, pucTdfStructLengths[eTdfId] );
+			break;
+		case TDF_SLEEP_WAKE_IRQ:
+			memcpy( ucTdfs[2], pucData, pucTdfStructLengths[eTdfId] );
+			iWakeIrqTdfs++;
+			break;
+		default:
+			CHECK( false, "unexpected TDF %d", eTdfId );
+	}
+	return ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t prvBin( uint32_t ulTicks )
+{
+	uint8_t ucBin = 0;
+	while ( ( ucBin < SLEEP_STATS_HISTOGRAM_BINS - 1 ) && ( ( ulTicks >> ( ucBin + 1 ) ) != 0 ) ) {
+		ucBin++;
+	}
+	return ucBin;
+}
+
+static void prvCompare( const char *pcName, xSleepStats_t *pxStats, xSleepStats_t *pxExpected )
+{
+	int i;
+
+	for ( i = 0; i < SLEEP_WAKE_REASONS; i++ ) {
+		CHECK( pxStats->pulWakes[i] == pxExpected->pulWakes[i], "%s: %u wakes of type %d, expected %u", pcName, pxStats->pulWakes[i], i, pxExpected->pulWakes[i] );
+	}
+	for ( i = 0; i < SLEEP_STATS_HISTOGRAM_BINS; i++ ) {
+		CHECK( pxStats->pulHistogram[i] == pxExpected->pulHistogram[i], "%s: bin %d counts %u, expected %u", pcName, i, pxStats->pulHistogram[i], pxExpected->pulHistogram[i] );
+	}
+	for ( i = 0; i < SLEEP_STATS_NUM_IRQS; i++ ) {
+		CHECK( pxStats->pusWakeIrqs[i] == pxExpected->pusWakeIrqs[i], "%s: irq %d woke %u times, expected %u", pcName, i, pxStats->pusWakeIrqs[i], pxExpected->pusWakeIrqs[i] );
+	}
+	CHECK( pxStats->ulUnknownIrqWakes == pxExpected->ulUnknownIrqWakes, "%s: %u unknown wakes, expected %u", pcName, pxStats->ulUnknownIrqWakes, pxExpected->ulUnknownIrqWakes );
+	CHECK( pxStats->ulSleepTicks == pxExpected->ulSleepTicks, "%s: %u sleep ticks, expected %u", pcName, pxStats->ulSleepTicks, pxExpected->ulSleepTicks );
+	CHECK( pxStats->ulRunTicks == pxExpected->ulRunTicks, "%s: %u run ticks, expected %u", pcName, pxStats->ulRunTicks, pxExpected->ulRunTicks );
+	CHECK( pxStats->ulOversleepTicks == pxExpected->ulOversleepTicks, "%s: %u oversleep, expected %u", pcName, pxStats->ulOversleepTicks, pxExpected->ulOversleepTicks );
+	CHECK( pxStats->ulUndersleepTicks == pxExpected->ulUndersleepTicks, "%s: %u undersleep, expected %u", pcName, pxStats->ulUndersleepTicks, pxExpected->ulUndersleepTicks );
+	CHECK( pxStats->ulMaxOversleep == pxExpected->ulMaxOversleep, "%s: %u max oversleep, expected %u", pcName, pxStats->ulMaxOversleep, pxExpected->ulMaxOversleep );
+}
+
+/* Idle periods with hand computed statistics */
+static void prvDirect( void )
+{
+	xSleepStats_t xStats, xExpected = { 0 };
+
+	vSleepStatsRecord( 100, 50, 50, SLEEP_WAKE_TIMEOUT, SLEEP_STATS_IRQ_UNKNOWN );
+	vSleepStatsRecord( 160, 20, 23, SLEEP_WAKE_TIMEOUT, SLEEP_STATS_IRQ_UNKNOWN );
+	vSleepStatsRecord( 200, 40, 37, SLEEP_WAKE_TIMEOUT, SLEEP_STATS_IRQ_UNKNOWN );
+	vSleepStatsRecord( 300, 100, 1, SLEEP_WAKE_INTERRUPT, 6 );
+	vSleepStatsRecord( 310, 100, 0, SLEEP_WAKE_ABORTED, SLEEP_STATS_IRQ_UNKNOWN );
+	vSleepStatsRecord( 320, 100, 0, SLEEP_WAKE_BLOCKED, SLEEP_STATS_IRQ_UNKNOWN );
+	vSleepStatsRecord( 400, portMAX_DELAY, 1 << 20, SLEEP_WAKE_INTERRUPT, SLEEP_STATS_IRQ_UNKNOWN );
+	vSleepStatsRecord( 400 + ( 1 << 20 ) + 5, 10, 18, SLEEP_WAKE_TIMEOUT, SLEEP_STATS_IRQ_UNKNOWN );
+	vSleepStatsRecord( 400 + ( 1 << 20 ) + 30, 10, 0, SLEEP_WAKE_INTERRUPT, SLEEP_STATS_NUM_IRQS );
+
+	xExpected.pulWakes[SLEEP_WAKE_TIMEOUT]   = 4;
+	xExpected.pulWakes[SLEEP_WAKE_INTERRUPT] = 3;
+	xExpected.pulWakes[SLEEP_WAKE_ABORTED]   = 1;
+	xExpected.pulWakes[SLEEP_WAKE_BLOCKED]   = 1;
+	/* 50, 23, 37, 1, 2^20, 18 and 0 ticks */
+	xExpected.pulHistogram[5]				   = 2;
+	xExpected.pulHistogram[4]				   = 2;
+	xExpected.pulHistogram[0]				   = 2;
+	xExpected.pulHistogram[11]				   = 1;
+	xExpected.pusWakeIrqs[6]				   = 1;
+	xExpected.ulUnknownIrqWakes				   = 2;
+	xExpected.ulSleepTicks					   = 50 + 23 + 37 + 1 + ( 1 << 20 ) + 18;
+	xExpected.ulRunTicks					   = 100 + 10 + 17 + 63 + 9 + 10 + 80 + 5 + 7;
+	/* Only wakes past a kernel timeout oversleep, and only the wake timer undersleeps */
+	xExpected.ulOversleepTicks  = 3 + 8;
+	xExpected.ulMaxOversleep	= 8;
+	xExpected.ulUndersleepTicks = 3;
+
+	vSleepStatsGet( &xStats, true );
+	prvCompare( "direct", &xStats, &xExpected );
+	CHECK( usSleepStatsPermille( &xStats ) == ( 1000ull * xExpected.ulSleepTicks ) / ( xExpected.ulSleepTicks + xExpected.ulRunTicks ), "permille %u", usSleepStatsPermille( &xStats ) );
+
+	/* The reset clears every counter */
+	memset( &xExpected, 0, sizeof( xExpected ) );
+	vSleepStatsGet( &xStats, false );
+	prvCompare( "reset", &xStats, &xExpected );
+	CHECK( usSleepStatsPermille( &xStats ) == 0, "permille %u without any time", usSleepStatsPermille( &xStats ) );
+}
+
+/* Logged TDFs match the generated definitions and saturate rather than wrap */
+static void prvLog( void )
+{
+	tdf_sleep_stats_t	 *pxSleep	 = (tdf_sleep_stats_t *) ucTdfs[0];
+	tdf_sleep_histogram_t *pxHistogram = (tdf_sleep_histogram_t *) ucTdfs[1];
+	tdf_sleep_wake_irq_t * pxWakeIrq   = (tdf_sleep_wake_irq_t *) ucTdfs[2];
+	xSleepStats_t		   xStats	  = { 0 };
+	int					   i;
+
+	CHECK( pucTdfStructLengths[TDF_SLEEP_STATS] == sizeof( tdf_sleep_stats_t ), "TDF_SLEEP_STATS length" );
+	CHECK( pucTdfStructLengths[TDF_SLEEP_HISTOGRAM] == sizeof( tdf_sleep_histogram_t ), "TDF_SLEEP_HISTOGRAM length" );
+	CHECK( pucTdfStructLengths[TDF_SLEEP_WAKE_IRQ] == sizeof( tdf_sleep_wake_irq_t ), "TDF_SLEEP_WAKE_IRQ length" );
+	CHECK( sizeof( pxHistogram->bins ) / sizeof( pxHistogram->bins[0] ) == SLEEP_STATS_HISTOGRAM_BINS, "histogram TDF bins" );
+
+	xStats.pulWakes[SLEEP_WAKE_TIMEOUT]   = 70000;
+	xStats.pulWakes[SLEEP_WAKE_INTERRUPT] = 1234;
+	xStats.ulSleepTicks					  = 0x89ABCDEF;
+	xStats.ulRunTicks					  = 0x01234567;
+	xStats.ulOversleepTicks				  = 100000;
+	xStats.ulMaxOversleep				  = 65535;
+	xStats.ulUndersleepTicks			  = 12;
+	for ( i = 0; i < SLEEP_STATS_HISTOGRAM_BINS; i++ ) {
+		xStats.pulHistogram[i] = 65530 + i;
+	}
+	xStats.pusWakeIrqs[39] = 1234;
+
+	CHECK( eSleepStatsLog( 0x01, TDF_TIMESTAMP_NONE, NULL, &xStats ) == ERROR_NONE, "log" );
+	CHECK( ( pxSleep->sleep_ticks == 0x89ABCDEF ) && ( pxSleep->run_ticks == 0x01234567 ), "logged ticks" );
+	CHECK( ( pxSleep->timeouts == UINT16_MAX ) && ( pxSleep->interrupts == 1234 ) && ( pxSleep->aborted == 0 ), "logged wakes" );
+	CHECK( ( pxSleep->oversleep == UINT16_MAX ) && ( pxSleep->max_oversleep == 65535 ) && ( pxSleep->undersleep == 12 ), "logged oversleep" );
+	for ( i = 0; i < SLEEP_STATS_HISTOGRAM_BINS; i++ ) {
+		CHECK( pxHistogram->bins[i] == ( ( i < 6 ) ? 65530 + i : UINT16_MAX ), "logged bin %d is %u", i, pxHistogram->bins[i] );
+	}
+	CHECK( ( iWakeIrqTdfs == 1 ) && ( pxWakeIrq->irq == 39 ) && ( pxWakeIrq->wakes == 1234 ), "%d wake irq TDFs", iWakeIrqTdfs );
+}
+
+/* Random idle periods through the nRF52 tickless idle port */
+static void prvPort( void )
+{
+	xSleepStats_t xStats, xExpected = { 0 };
+	TickType_t	xExpectedIdle, xTickBefore;
+	eSleepWake_t  eWake;
+	uint32_t	  ulRun, ulSlept, ulWraps = 0, ulNoTimeout = 0;
+	int			  i, iType;
+
+	ulRtc = RTC_START;
+	xTick = 1000000;
+	vPortSetupTimerInterrupt();
+	CHECK( ulPrescaler == ( 32768 / configTICK_RATE_HZ ) - 1, "prescaler %u", ulPrescaler );
+	CHECK( bTickEnabled, "tick not started" );
+	/* Tick interrupts advance the kernel tick, compare interrupts are not ticks */
+	xRtcHandler( NRFX_RTC_INT_TICK );
+	xRtcHandler( NRFX_RTC_INT_COMPARE1 );
+	CHECK( xTick == 1000001, "tick handler" );
+
+	/* Align the run time accounting with the kernel tick */
+	xPlan.bCanSleep = false;
+	portSUPPRESS_TICKS_AND_SLEEP( 1 );
+	vSleepStatsGet( &xStats, true );
+
+	srand( 3 );
+	for ( i = 0; i < NUM_PERIODS; i++ ) {
+		ulRun = rand() % 200;
+		ulRtc += ulRun;
+		xTick += ulRun;
+		xExpected.ulRunTicks += ulRun;
+
+		memset( &xPlan, 0, sizeof( xPlan ) );
+		memset( (void *) xNvic.ISPR, 0, sizeof( xNvic.ISPR ) );
+		xPlan.bCanSleep = true;
+		xPlan.eStatus   = eStandardSleep;
+		xPlan.lIrq		= SLEEP_STATS_IRQ_UNKNOWN;
+		xExpectedIdle   = 2 + rand() % ( 1 << ( 1 + rand() % 14 ) );
+		iType			= rand() % 100;
+		if ( iType < 5 ) {
+			xPlan.bCanSleep = false;
+			eWake			= SLEEP_WAKE_BLOCKED;
+			ulSlept			= 0;
+		}
+		else if ( iType < 10 ) {
+			xPlan.eStatus = eAbortSleep;
+			eWake		  = SLEEP_WAKE_ABORTED;
+			ulSlept		  = 0;
+		}
+		else if ( iType < 15 ) {
+			/* No task has a timeout, the sleep can run for most of a counter period */
+			xPlan.eStatus	= eNoTasksWaitingTimeout;
+			xPlan.bInterrupt = true;
+			xPlan.ulSleep	= rand() % ( 1 << ( rand() % 23 ) );
+			xPlan.lIrq		 = ( rand() % 4 ) ? rand() % 40 : SLEEP_STATS_IRQ_UNKNOWN;
+			eWake			 = SLEEP_WAKE_INTERRUPT;
+			ulSlept			 = xPlan.ulSleep;
+			ulNoTimeout++;
+		}
+		else if ( iType < 60 ) {
+			xPlan.ulLatency = ( rand() % 8 == 0 ) ? rand() % 4 : 0;
+			eWake			= SLEEP_WAKE_TIMEOUT;
+			ulSlept			= xExpectedIdle + xPlan.ulLatency;
+		}
+		else {
+			xPlan.bInterrupt = true;
+			xPlan.ulSleep	= rand() % xExpectedIdle;
+			xPlan.lIrq		 = ( rand() % 4 ) ? rand() % 40 : SLEEP_STATS_IRQ_UNKNOWN;
+			eWake			 = SLEEP_WAKE_INTERRUPT;
+			ulSlept = xPlan.ulSleep;
+		}
+		/* The tick timer is not a wake source while ticks are suppressed */
+		if ( xPlan.lIrq == RTC1_IRQn ) {
+			xPlan.lIrq = SLEEP_STATS_IRQ_UNKNOWN;
+		}
+
+		/* Expected statistics */
+		xExpected.pulWakes[eWake]++;
+		if ( ( eWake == SLEEP_WAKE_TIMEOUT ) || ( eWake == SLEEP_WAKE_INTERRUPT ) ) {
+			xExpected.ulSleepTicks += ulSlept;
+			xExpected.pulHistogram[prvBin( ulSlept )]++;
+		}
+		if ( eWake == SLEEP_WAKE_INTERRUPT ) {
+			if ( xPlan.lIrq == SLEEP_STATS_IRQ_UNKNOWN ) {
+				xExpected.ulUnknownIrqWakes++;
+			}
+			else {
+				xExpected.pusWakeIrqs[xPlan.lIrq]++;
+			}
+		}
+		if ( eWake == SLEEP_WAKE_TIMEOUT ) {
+			xExpected.ulOversleepTicks += xPlan.ulLatency;
+			xExpected.ulMaxOversleep = MAX( xExpected.ulMaxOversleep, xPlan.ulLatency );
+		}
+		if ( ( ( ulRtc & UINT24_MASK ) + ulSlept ) > UINT24_MASK ) {
+			ulWraps++;
+		}
+
+		xTickBefore = xTick;
+		portSUPPRESS_TICKS_AND_SLEEP( ( xPlan.eStatus == eNoTasksWaitingTimeout ) ? portMAX_DELAY : xExpectedIdle );
+		CHECK( xTick == xTickBefore + ulSlept, "period %d: kernel tick stepped by %u, slept %u ticks", i, xTick - xTickBefore, ulSlept );
+		CHECK( ( iCriticalDepth == 0 ) && bTickEnabled && bCpuActive, "period %d: left with critical depth %d, tick %d, CPU %d", i, iCriticalDepth, bTickEnabled, bCpuActive );
+		if ( iErrors > 20 ) {
+			break;
+		}
+	}
+
+	vSleepStatsGet( &xStats, true );
+	prvCompare( "port", &xStats, &xExpected );
+	CHECK( ulWraps > 10, "only %u sleeps over a counter wrap", ulWraps );
+	printf( "%d idle periods, %u over a counter wrap, %u without a timeout, %u.%u%% asleep, %u oversleep, worst %u ticks\n", NUM_PERIODS, ulWraps, ulNoTimeout,
+			usSleepStatsPermille( &xStats ) / 10, usSleepStatsPermille( &xStats ) % 10, xStats.ulOversleepTicks, xStats.ulMaxOversleep );
+}
+
+int main( void )
+{
+	prvDirect();
+	prvLog();
+	prvPort();
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
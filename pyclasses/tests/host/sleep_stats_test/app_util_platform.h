@@ -0,0 +1,12 @@
+/*
+ * Host model of the nRF5 SDK critical region, counted so that the harness can check it is balanced
+ */
+#ifndef __CORE_CSIRO_HOST_APP_UTIL_PLATFORM_H__
+#define __CORE_CSIRO_HOST_APP_UTIL_PLATFORM_H__
+
+extern int iCriticalDepth;
+
+#define CRITICAL_REGION_ENTER() iCriticalDepth++
+#define CRITICAL_REGION_EXIT() iCriticalDepth--
+
+#endif /* __CORE_CSIRO_HOST_APP_UTIL_PLATFORM_H__ */
@@ -0,0 +1,12 @@
+/*
+ * Host model of the board deep sleep control used by the tickless idle port
+ */
+#ifndef __CORE_CSIRO_HOST_BOARD_H__
+#define __CORE_CSIRO_HOST_BOARD_H__
+
+#include <stdbool.h>
+
+bool bBoardCanDeepSleep( void );
+void vBoardDeepSleep( void );
+
+#endif /* __CORE_CSIRO_HOST_BOARD_H__ */
@@ -0,0 +1,32 @@
+/*
+ * Host model of the nRF52 interrupt controller and WFI, the harness decides what ends each sleep
+ */
+#ifndef __CORE_CSIRO_HOST_CPU_ARCH_H__
+#define __CORE_CSIRO_HOST_CPU_ARCH_H__
+
+#include <stdint.h>
+
+typedef int32_t IRQn_Type;
+
+#define RTC1_IRQn 17
+
+typedef struct NVIC_Type
+{
+	volatile uint32_t ISPR[8];
+} NVIC_Type;
+
+extern NVIC_Type xNvic;
+#define NVIC ( &xNvic )
+
+/* From portmacro.h, the harness runs interrupts itself */
+#define portDISABLE_INTERRUPTS()
+#define portENABLE_INTERRUPTS()
+
+void __WFI( void );
+
+static inline uint32_t ulCpuClockFreq( void )
+{
+	return 64000000;
+}
+
+#endif /* __CORE_CSIRO_HOST_CPU_ARCH_H__ */
@@ -0,0 +1,16 @@
+/*
+ * Host model of the nRF52 clock driver, the low frequency clock is always running
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_CLOCK_H__
+#define __CORE_CSIRO_HOST_NRFX_CLOCK_H__
+
+#include <stdint.h>
+
+static inline uint32_t nrfx_clock_init( void *pvHandler )
+{
+	return 0;
+}
+
+static inline void nrfx_clock_lfclk_start( void ) {}
+
+#endif /* __CORE_CSIRO_HOST_NRFX_CLOCK_H__ */
@@ -0,0 +1,47 @@
+/*
+ * Host model of the nRF52 RTC driver used by the tickless idle port, the counter is run by the harness
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_RTC_H__
+#define __CORE_CSIRO_HOST_NRFX_RTC_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct nrfx_rtc_t
+{
+	uint8_t ucInstance;
+} nrfx_rtc_t;
+
+#define NRFX_RTC_INSTANCE( id ) \
+	{                           \
+		.ucInstance = id        \
+	}
+
+typedef enum nrfx_rtc_int_type_t {
+	NRFX_RTC_INT_COMPARE0,
+	NRFX_RTC_INT_COMPARE1,
+	NRFX_RTC_INT_TICK,
+	NRFX_RTC_INT_OVERFLOW
+} nrfx_rtc_int_type_t;
+
+typedef struct nrfx_rtc_config_t
+{
+	uint16_t prescaler;
+} nrfx_rtc_config_t;
+
+#define NRFX_RTC_DEFAULT_CONFIG \
+	{                           \
+		.prescaler = 0          \
+	}
+
+typedef void ( *nrfx_rtc_handler_t )( nrfx_rtc_int_type_t xInterruptType );
+
+uint32_t nrfx_rtc_init( nrfx_rtc_t const *pxRtc, nrfx_rtc_config_t const *pxConfig, nrfx_rtc_handler_t xHandler );
+void	 nrfx_rtc_enable( nrfx_rtc_t const *pxRtc );
+void	 nrfx_rtc_tick_enable( nrfx_rtc_t const *pxRtc, bool bInterrupt );
+void	 nrfx_rtc_tick_disable( nrfx_rtc_t const *pxRtc );
+uint32_t nrfx_rtc_cc_set( nrfx_rtc_t const *pxRtc, uint32_t ulChannel, uint32_t ulValue, bool bInterrupt );
+uint32_t nrfx_rtc_cc_disable( nrfx_rtc_t const *pxRtc, uint32_t ulChannel );
+uint32_t nrfx_rtc_counter_get( nrfx_rtc_t const *pxRtc );
+
+#endif /* __CORE_CSIRO_HOST_NRFX_RTC_H__ */
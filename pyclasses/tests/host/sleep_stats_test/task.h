@@ -0,0 +1,19 @@
+/*
+ * Host stub task.h with the kernel hooks used by the tickless idle port
+ */
+#ifndef __CORE_CSIRO_HOST_TASK_H__
+#define __CORE_CSIRO_HOST_TASK_H__
+
+#include "FreeRTOS.h"
+
+typedef enum eSleepModeStatus {
+	eAbortSleep = 0,
+	eStandardSleep,
+	eNoTasksWaitingTimeout
+} eSleepModeStatus;
+
+eSleepModeStatus eTaskConfirmSleepModeStatus( void );
+void			 vTaskStepTick( TickType_t xTicksToJump );
+BaseType_t		 xTaskIncrementTick( void );
+
+#endif /* __CORE_CSIRO_HOST_TASK_H__ */
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of the task stack monitor, with the kernel overflow check taken from stack_macros.h
+ * Tasks are created through STATIC_TASK_CREATE against a model of xTaskCreateStatic that paints the stack like the kernel.
+ * The harness checks the sampled minimum across repaints and holes in a frame, that an overflow is attributed to a task
+ * whose kernel name was truncated, and reports the cost of the method 2 canary per context switch and of one sample.
+ * stack_monitor.c is included directly so module state can be reset between checks.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "stack_monitor.c"
+
+/* Kernel state used by taskCHECK_FOR_STACK_OVERFLOW */
+#define portSTACK_GROWTH -1
+#define configCHECK_FOR_STACK_OVERFLOW 2
+#define mtCOVERAGE_TEST_MARKER()
+#include "stack_macros.h"
+
+#define STACK_WORDS 128
+#define SWITCHES 20000000UL
+#define SAMPLES 1000000UL
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+typedef struct tskTaskControlBlock
+{
+	StackType_t *pxStack;
+	char		 pcTaskName[configMAX_TASK_NAME_LEN];
+} tskTCB;
+
+static tskTCB			pxTcbs[STACK_MONITOR_MAX_TASKS + 2];
+static uint32_t			ulTcbs;
+static tskTCB *volatile pxCurrentTCB;
+static uint32_t			ulOverflows;
+static volatile uint32_t ulSwitches;
+
+STATIC_TASK_STRUCTURES( pxSensor, STACK_WORDS, 1 );
+STATIC_TASK_STRUCTURES( pxRadio, STACK_WORDS, 1 );
+STATIC_TASK_STRUCTURES( pxLongName, STACK_WORDS, 1 );
+
+/* As the kernel, the stack is filled with tskSTACK_FILL_BYTE and the name truncated */
+TaskHandle_t xTaskCreateStatic( TaskFunction_t fnTask, const char *pcName, uint32_t ulStackDepth, void *pvParameters, UBaseType_t uxPriority, StackType_t *puxStack, StaticTask_t *pxTask )
+{
+	tskTCB *pxTcb = &pxTcbs[ulTcbs++];
+
+	memset( puxStack, 0xA5, ulStackDepth * sizeof( StackType_t ) );
+	pxTcb->pxStack = puxStack;
+	strncpy( pxTcb->pcTaskName, pcName, configMAX_TASK_NAME_LEN - 1 );
+	pxTcb->pcTaskName[configMAX_TASK_NAME_LEN - 1] = '\0';
+	return pxTcb;
+}
+
+void vApplicationStackOverflowHook( TaskHandle_t pxTask, char *pcTaskName )
+{
+	ulOverflows++;
+	vStackMonitorOverflow( pcTaskName );
+}
+
+static void prvTask( void *pvParameters ) {}
+
+static void prvReset( void )
+{
+	memset( pxTasks, 0x00, sizeof( pxTasks ) );
+	ucRegistered   = 0;
+	ucNextSample   = 0;
+	pcOverflowName = NULL;
+	ulTcbs		   = 0;
+}
+
+/* Stacks grow down, a frame reaching ulDepth words from the top */
+static void prvUse( StackType_t *puxStack, uint32_t ulDepth )
+{
+	uint32_t i;
+	for ( i = STACK_WORDS - ulDepth; i < STACK_WORDS; i++ ) {
+		puxStack[i] = i;
+	}
+}
+
+static double prvSeconds( void )
+{
+	struct timespec xNow;
+	clock_gettime( CLOCK_MONOTONIC, &xNow );
+	return xNow.tv_sec + xNow.tv_nsec * 1e-9;
+}
+
+/* Context switch between two tasks without and with the canary, timed without sanitizer instrumentation */
+__attribute__( ( noinline, no_sanitize_address ) ) static void prvSwitchEmpty( void )
+{
+	pxCurrentTCB = &pxTcbs[ulSwitches++ & 1];
+}
+
+__attribute__( ( noinline, no_sanitize_address ) ) static void prvSwitchCanary( void )
+{
+	taskCHECK_FOR_STACK_OVERFLOW();
+	pxCurrentTCB = &pxTcbs[ulSwitches++ & 1];
+}
+
+static double prvTime( void ( *fnSwitch )( void ), uint32_t ulCount )
+{
+	double   dBest = 1e9, dStart;
+	uint32_t i;
+	int		 iRun;
+
+	/* Best of three to exclude preemption of the host process */
+	for ( iRun = 0; iRun < 3; iRun++ ) {
+		dStart = prvSeconds();
+		for ( i = 0; i < ulCount; i++ ) {
+			fnSwitch();
+		}
+		dBest = MIN( dBest, prvSeconds() - dStart );
+	}
+	return dBest * 1e9 / ulCount;
+}
+
+int main( void )
+{
+	xStackMonitorReport_t pxReports[STACK_MONITOR_MAX_TASKS];
+	xStackMonitorReport_t xLowest;
+	StackType_t			  puxExtra[STACK_WORDS];
+	double				  dEmpty, dCanary, dSample;
+	int					  i;
+
+	/* Sampling keeps the minimum across repaints of the stack */
+	prvReset();
+	STATIC_TASK_CREATE( pxSensor, prvTask, "Sensor", NULL );
+	STATIC_TASK_CREATE( pxRadio, prvTask, "Radio", NULL );
+	prvUse( pxSensorStack, 40 );
+	prvUse( pxRadioStack, 20 );
+	vStackMonitorSample();
+	vStackMonitorSample();
+	CHECK( ucStackMonitorReport( pxReports, 2 ) == 2, "report" );
+	CHECK( pxReports[0].usSize == STACK_WORDS * 4 && pxReports[0].usFree == ( STACK_WORDS - 40 ) * 4, "sensor %u/%u", pxReports[0].usFree, pxReports[0].usSize );
+	CHECK( pxReports[1].usFree == ( STACK_WORDS - 20 ) * 4, "radio %u", pxReports[1].usFree );
+	memset( pxSensorStack, 0xA5, sizeof( pxSensorStack ) );
+	prvUse( pxSensorStack, 10 );
+	vStackMonitorSample();
+	ucStackMonitorReport( pxReports, 2 );
+	CHECK( pxReports[0].usFree == ( STACK_WORDS - 40 ) * 4, "minimum lost after repaint, %u", pxReports[0].usFree );
+
+	/* A hole in a frame, such as an unwritten array, does not hide the deepest use */
+	prvUse( pxRadioStack, 90 );
+	for ( i = STACK_WORDS - 89; i < STACK_WORDS - 30; i++ ) {
+		pxRadioStack[i] = STACK_MONITOR_FILL;
+	}
+	vStackMonitorSample();
+	CHECK( bStackMonitorLowest( &xLowest ), "lowest" );
+	CHECK( strcmp( xLowest.pcName, "Radio" ) == 0 && xLowest.usFree == ( STACK_WORDS - 90 ) * 4, "lowest %s %u", xLowest.pcName, xLowest.usFree );
+
+	/* Registrations beyond the limit are dropped */
+	for ( i = 0; i < STACK_MONITOR_MAX_TASKS; i++ ) {
+		vStackMonitorRegister( "Extra", puxExtra, STACK_WORDS );
+	}
+	CHECK( ucRegistered == STACK_MONITOR_MAX_TASKS, "%u registered", ucRegistered );
+
+	/* An overflow of a task whose kernel name is truncated is matched to its registration */
+	prvReset();
+	STATIC_TASK_CREATE( pxSensor, prvTask, "Sensor", NULL );
+	STATIC_TASK_CREATE( pxLongName, prvTask, "LongTaskName", NULL );
+	pxCurrentTCB = pxLongName;
+	taskCHECK_FOR_STACK_OVERFLOW();
+	CHECK( ulOverflows == 0, "canary fired on an unused stack" );
+	pxLongNameStack[1] = 0;
+	taskCHECK_FOR_STACK_OVERFLOW();
+	CHECK( ulOverflows == 1, "overflow not detected" );
+	CHECK( bStackMonitorLowest( &xLowest ), "lowest after overflow" );
+	CHECK( strncmp( xLowest.pcName, "LongTaskName", configMAX_TASK_NAME_LEN - 1 ) == 0 && xLowest.usSize == STACK_WORDS * 4 && xLowest.usFree == 0,
+		   "overflow reported as %s %u/%u", xLowest.pcName, xLowest.usFree, xLowest.usSize );
+
+	/* Cost of the canary per context switch, and of sampling an unused stack */
+	prvReset();
+	STATIC_TASK_CREATE( pxSensor, prvTask, "Sensor", NULL );
+	STATIC_TASK_CREATE( pxRadio, prvTask, "Radio", NULL );
+	ulOverflows = 0;
+	dEmpty		= prvTime( prvSwitchEmpty, SWITCHES );
+	dCanary		= prvTime( prvSwitchCanary, SWITCHES );
+	dSample		= prvTime( vStackMonitorSample, SAMPLES );
+	CHECK( ulOverflows == 0, "canary fired while timing" );
+	printf( "context switch %.2f ns, with canary %.2f ns, sample of %u words %.1f ns\n", dEmpty, dCanary, STACK_WORDS, dSample );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
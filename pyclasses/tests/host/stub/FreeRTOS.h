@@ -0,0 +1,106 @@
+#ifndef STUB_FREERTOS_H
+#define STUB_FREERTOS_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+#include "core_types.h"
+#include "compiler_intrinsics.h"
+#include "freertos_helpers.h"
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t StackType_t;
+typedef void *TaskHandle_t;
+typedef void *xTaskHandle;
+typedef void *QueueHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef void *TimerHandle_t;
+typedef void *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+typedef struct { uint8_t pucDummy[8]; } StaticTask_t, StaticQueue_t, StaticSemaphore_t, StaticTimer_t, StaticEventGroup_t;
+typedef void (*TaskFunction_t)(void *);
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+#define configASSERT(x) assert((x))
+#define configMINIMAL_STACK_SIZE 256
+#define configTICK_RATE_HZ 512
+#define configMAX_TASK_NAME_LEN 10
+#define configMAX_PRIORITIES 6
+#define pdMS_TO_TICKS(x) ((TickType_t)(((uint64_t)(x) * configTICK_RATE_HZ) / 1000))
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define tskIDLE_PRIORITY 0
+#define portENTER_CRITICAL()
+#define portEXIT_CRITICAL()
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define portYIELD_FROM_ISR(x) (void)(x)
+#define CRITICAL_SECTION_DECLARE uint8_t irqState = 0
+#define CRITICAL_SECTION_START() (void)irqState;
+#define CRITICAL_SECTION_STOP() (void)irqState;
+void *pvPortMalloc(size_t);
+void vPortFree(void *);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+void vTaskDelay(TickType_t);
+void vTaskDelayUntil(TickType_t *, TickType_t);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskCreate(TaskFunction_t, const char *, uint16_t, void *, UBaseType_t, TaskHandle_t *);
+TaskHandle_t xTaskCreateStatic(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, StackType_t *, StaticTask_t *);
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t);
+BaseType_t xTaskNotifyGive(TaskHandle_t);
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *);
+BaseType_t xTaskNotifyWait(uint32_t, uint32_t, uint32_t *, TickType_t);
+BaseType_t xTaskNotify(TaskHandle_t, uint32_t, int);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t, uint32_t, int, BaseType_t *);
+void vTaskSuspend(TaskHandle_t);
+void vTaskResume(TaskHandle_t);
+char *pcTaskGetName(TaskHandle_t);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t);
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+#define eSetBits 1
+#define eSetValueWithOverwrite 2
+QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t);
+QueueHandle_t xQueueCreateStatic(UBaseType_t, UBaseType_t, uint8_t *, StaticQueue_t *);
+BaseType_t xQueueSendToBack(QueueHandle_t, const void *, TickType_t);
+BaseType_t xQueueSendToFront(QueueHandle_t, const void *, TickType_t);
+BaseType_t xQueueSend(QueueHandle_t, const void *, TickType_t);
+BaseType_t xQueueSendFromISR(QueueHandle_t, const void *, BaseType_t *);
+BaseType_t xQueueSendToBackFromISR(QueueHandle_t, const void *, BaseType_t *);
+BaseType_t xQueueReceive(QueueHandle_t, void *, TickType_t);
+BaseType_t xQueueReceiveFromISR(QueueHandle_t, void *, BaseType_t *);
+BaseType_t xQueuePeek(QueueHandle_t, void *, TickType_t);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *);
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *);
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t, UBaseType_t, StaticSemaphore_t *);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t, BaseType_t *);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t);
+TimerHandle_t xTimerCreateStatic(const char *, TickType_t, UBaseType_t, void *, TimerCallbackFunction_t, StaticTimer_t *);
+TimerHandle_t xTimerCreate(const char *, TickType_t, UBaseType_t, void *, TimerCallbackFunction_t);
+BaseType_t xTimerStart(TimerHandle_t, TickType_t);
+BaseType_t xTimerStop(TimerHandle_t, TickType_t);
+BaseType_t xTimerReset(TimerHandle_t, TickType_t);
+BaseType_t xTimerChangePeriod(TimerHandle_t, TickType_t, TickType_t);
+BaseType_t xTimerIsTimerActive(TimerHandle_t);
+void *pvTimerGetTimerID(TimerHandle_t);
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t, EventBits_t, BaseType_t, BaseType_t, TickType_t);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t, EventBits_t);
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t, EventBits_t, BaseType_t *);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t, EventBits_t);
+
+/* As included at the end of FreeRTOSConfig.h */
+#include "stack_monitor.h"
+#endif
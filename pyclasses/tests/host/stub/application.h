@@ -0,0 +1,7 @@
+/*
+ * Host stub of the application header, no application specific configuration
+ */
+#ifndef __CORE_CSIRO_HOST_APPLICATION_H__
+#define __CORE_CSIRO_HOST_APPLICATION_H__
+
+#endif /* __CORE_CSIRO_HOST_APPLICATION_H__ */
@@ -0,0 +1,26 @@
+/*
+ * Host model of the board peripheral power control used by flash_common.c, harnesses with their own board model override it
+ */
+#ifndef __CORE_CSIRO_HOST_BOARD_H__
+#define __CORE_CSIRO_HOST_BOARD_H__
+
+#include "core_types.h"
+
+#define PERIPHERAL_ONBOARD_FLASH 0
+
+static inline void vBoardDisablePeripheral( int iPeripheral )
+{
+	(void) iPeripheral;
+}
+
+static inline eModuleError_t eBoardEnablePeripheral( int iPeripheral, bool *pbPowerApplied, uint32_t ulTimeout )
+{
+	(void) iPeripheral;
+	(void) ulTimeout;
+	if ( pbPowerApplied != NULL ) {
+		*pbPowerApplied = false;
+	}
+	return ERROR_NONE;
+}
+
+#endif /* __CORE_CSIRO_HOST_BOARD_H__ */
@@ -0,0 +1,409 @@
+/*
+ * Weak defaults for the FreeRTOS and logging functions declared by the host stubs
+ * Harnesses override any function whose behaviour matters to the module under test.
+ */
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+#include "log.h"
+
+#define WEAK __attribute__( ( weak ) )
+
+static int iHandle;
+
+WEAK void *pvPortMalloc( size_t a0 )
+{
+	return malloc( a0 );
+}
+
+WEAK void vPortFree( void *a0 )
+{
+	free( a0 );
+}
+
+WEAK TickType_t xTaskGetTickCount( void )
+{
+	return 0;
+}
+
+WEAK TickType_t xTaskGetTickCountFromISR( void )
+{
+	return 0;
+}
+
+WEAK void vTaskDelay( TickType_t a0 )
+{
+	(void) a0;
+}
+
+WEAK void vTaskDelayUntil( TickType_t *a0, TickType_t a1 )
+{
+	(void) a0;
+	(void) a1;
+}
+
+WEAK TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+	return &iHandle;
+}
+
+WEAK BaseType_t xTaskCreate( TaskFunction_t a0, const char *a1, uint16_t a2, void *a3, UBaseType_t a4, TaskHandle_t *a5 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	(void) a3;
+	(void) a4;
+	(void) a5;
+	return pdPASS;
+}
+
+WEAK TaskHandle_t xTaskCreateStatic( TaskFunction_t a0, const char *a1, uint32_t a2, void *a3, UBaseType_t a4, StackType_t *a5, StaticTask_t *a6 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	(void) a3;
+	(void) a4;
+	(void) a5;
+	(void) a6;
+	return &iHandle;
+}
+
+WEAK uint32_t ulTaskNotifyTake( BaseType_t a0, TickType_t a1 )
+{
+	(void) a0;
+	(void) a1;
+	return 1;
+}
+
+WEAK BaseType_t xTaskNotifyGive( TaskHandle_t a0 )
+{
+	(void) a0;
+	return pdPASS;
+}
+
+WEAK void vTaskNotifyGiveFromISR( TaskHandle_t a0, BaseType_t *a1 )
+{
+	(void) a0;
+	(void) a1;
+}
+
+WEAK BaseType_t xTaskNotifyWait( uint32_t a0, uint32_t a1, uint32_t *a2, TickType_t a3 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	(void) a3;
+	return pdPASS;
+}
+
+WEAK BaseType_t xTaskNotify( TaskHandle_t a0, uint32_t a1, int a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdPASS;
+}
+
+WEAK BaseType_t xTaskNotifyFromISR( TaskHandle_t a0, uint32_t a1, int a2, BaseType_t *a3 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	(void) a3;
+	return pdPASS;
+}
+
+WEAK void vTaskSuspend( TaskHandle_t a0 )
+{
+	(void) a0;
+}
+
+WEAK void vTaskResume( TaskHandle_t a0 )
+{
+	(void) a0;
+}
+
+WEAK char *pcTaskGetName( TaskHandle_t a0 )
+{
+	(void) a0;
+	return "host";
+}
+
+WEAK UBaseType_t uxTaskGetStackHighWaterMark( TaskHandle_t a0 )
+{
+	(void) a0;
+	return 0;
+}
+
+WEAK void vTaskSuspendAll( void )
+{
+}
+
+WEAK BaseType_t xTaskResumeAll( void )
+{
+	return pdPASS;
+}
+
+WEAK QueueHandle_t xQueueCreate( UBaseType_t a0, UBaseType_t a1 )
+{
+	(void) a0;
+	(void) a1;
+	return &iHandle;
+}
+
+WEAK QueueHandle_t xQueueCreateStatic( UBaseType_t a0, UBaseType_t a1, uint8_t *a2, StaticQueue_t *a3 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	(void) a3;
+	return &iHandle;
+}
+
+WEAK BaseType_t xQueueSendToBack( QueueHandle_t a0, const void *a1, TickType_t a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdPASS;
+}
+
+WEAK BaseType_t xQueueSendToFront( QueueHandle_t a0, const void *a1, TickType_t a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdPASS;
+}
+
+WEAK BaseType_t xQueueSend( QueueHandle_t a0, const void *a1, TickType_t a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdPASS;
+}
+
+WEAK BaseType_t xQueueSendFromISR( QueueHandle_t a0, const void *a1, BaseType_t *a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdPASS;
+}
+
+WEAK BaseType_t xQueueSendToBackFromISR( QueueHandle_t a0, const void *a1, BaseType_t *a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdPASS;
+}
+
+WEAK BaseType_t xQueueReceive( QueueHandle_t a0, void *a1, TickType_t a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdFAIL;
+}
+
+WEAK BaseType_t xQueueReceiveFromISR( QueueHandle_t a0, void *a1, BaseType_t *a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdFAIL;
+}
+
+WEAK BaseType_t xQueuePeek( QueueHandle_t a0, void *a1, TickType_t a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdFAIL;
+}
+
+WEAK UBaseType_t uxQueueMessagesWaiting( QueueHandle_t a0 )
+{
+	(void) a0;
+	return 0;
+}
+
+WEAK SemaphoreHandle_t xSemaphoreCreateMutex( void )
+{
+	return &iHandle;
+}
+
+WEAK SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void )
+{
+	return &iHandle;
+}
+
+WEAK SemaphoreHandle_t xSemaphoreCreateBinary( void )
+{
+	return &iHandle;
+}
+
+WEAK SemaphoreHandle_t xSemaphoreCreateMutexStatic( StaticSemaphore_t *a0 )
+{
+	(void) a0;
+	return &iHandle;
+}
+
+WEAK SemaphoreHandle_t xSemaphoreCreateBinaryStatic( StaticSemaphore_t *a0 )
+{
+	(void) a0;
+	return &iHandle;
+}
+
+WEAK SemaphoreHandle_t xSemaphoreCreateCountingStatic( UBaseType_t a0, UBaseType_t a1, StaticSemaphore_t *a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return &iHandle;
+}
+
+WEAK BaseType_t xSemaphoreTake( SemaphoreHandle_t a0, TickType_t a1 )
+{
+	(void) a0;
+	(void) a1;
+	return pdPASS;
+}
+
+WEAK BaseType_t xSemaphoreGive( SemaphoreHandle_t a0 )
+{
+	(void) a0;
+	return pdPASS;
+}
+
+WEAK BaseType_t xSemaphoreGiveFromISR( SemaphoreHandle_t a0, BaseType_t *a1 )
+{
+	(void) a0;
+	(void) a1;
+	return pdPASS;
+}
+
+WEAK BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t a0, TickType_t a1 )
+{
+	(void) a0;
+	(void) a1;
+	return pdPASS;
+}
+
+WEAK BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t a0 )
+{
+	(void) a0;
+	return pdPASS;
+}
+
+WEAK TimerHandle_t xTimerCreateStatic( const char *a0, TickType_t a1, UBaseType_t a2, void *a3, TimerCallbackFunction_t a4, StaticTimer_t *a5 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	(void) a3;
+	(void) a4;
+	(void) a5;
+	return &iHandle;
+}
+
+WEAK TimerHandle_t xTimerCreate( const char *a0, TickType_t a1, UBaseType_t a2, void *a3, TimerCallbackFunction_t a4 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	(void) a3;
+	(void) a4;
+	return &iHandle;
+}
+
+WEAK BaseType_t xTimerStart( TimerHandle_t a0, TickType_t a1 )
+{
+	(void) a0;
+	(void) a1;
+	return pdPASS;
+}
+
+WEAK BaseType_t xTimerStop( TimerHandle_t a0, TickType_t a1 )
+{
+	(void) a0;
+	(void) a1;
+	return pdPASS;
+}
+
+WEAK BaseType_t xTimerReset( TimerHandle_t a0, TickType_t a1 )
+{
+	(void) a0;
+	(void) a1;
+	return pdPASS;
+}
+
+WEAK BaseType_t xTimerChangePeriod( TimerHandle_t a0, TickType_t a1, TickType_t a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdPASS;
+}
+
+WEAK BaseType_t xTimerIsTimerActive( TimerHandle_t a0 )
+{
+	(void) a0;
+	return pdFALSE;
+}
+
+WEAK void *pvTimerGetTimerID( TimerHandle_t a0 )
+{
+	(void) a0;
+	return NULL;
+}
+
+WEAK EventGroupHandle_t xEventGroupCreateStatic( StaticEventGroup_t *a0 )
+{
+	(void) a0;
+	return &iHandle;
+}
+
+WEAK EventBits_t xEventGroupWaitBits( EventGroupHandle_t a0, EventBits_t a1, BaseType_t a2, BaseType_t a3, TickType_t a4 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	(void) a3;
+	(void) a4;
+	return 0;
+}
+
+WEAK EventBits_t xEventGroupSetBits( EventGroupHandle_t a0, EventBits_t a1 )
+{
+	(void) a0;
+	(void) a1;
+	return 0;
+}
+
+WEAK BaseType_t xEventGroupSetBitsFromISR( EventGroupHandle_t a0, EventBits_t a1, BaseType_t *a2 )
+{
+	(void) a0;
+	(void) a1;
+	(void) a2;
+	return pdPASS;
+}
+
+WEAK EventBits_t xEventGroupClearBits( EventGroupHandle_t a0, EventBits_t a1 )
+{
+	(void) a0;
+	(void) a1;
+	return 0;
+}
+
+WEAK eModuleError_t eLog( SerialLog_t eLog, LogLevel_t eLevel, const char *pcFormat, ... )
+{
+	(void) eLog;
+	(void) eLevel;
+	(void) pcFormat;
+	return ERROR_NONE;
+}
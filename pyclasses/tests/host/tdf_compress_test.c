@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host checks of compressed TDF segments, encoded by tdf.c and decoded by tdf_parse.c
+ * The final segment is printed so the Python decoder can be checked against it.
+ * Also reports the compression ratio and encode/decode cost on accelerometer style data.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "memory_operations.h"
+#include "tdf.h"
+#include "tdf_parse.h"
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+/* Logger stubs, logged bytes are appended to pucLogged */
+static uint8_t  pucLogged[512];
+static uint16_t usLogged;
+
+eModuleError_t eLoggerLog( xLogger_t *pxLog, uint16_t usNumBytes, void *pvData )
+{
+	memcpy( pucLogged + usLogged, pvData, usNumBytes );
+	usLogged += usNumBytes;
+	pxLog->usBufferByteOffset += usNumBytes;
+	return ERROR_NONE;
+}
+
+eModuleError_t eLoggerCommit( xLogger_t *pxLog )
+{
+	pxLog->usBufferByteOffset = 0;
+	return ERROR_NONE;
+}
+
+eModuleError_t eLoggerConfigure( xLogger_t *pxLog, uint16_t usSetting, void *pvValue )
+{
+	return ERROR_NONE;
+}
+
+uint16_t usLoggerBlockFooterSize( xLogger_t *pxLog )
+{
+	return 0;
+}
+
+xTdfLogger_t *const tdf_logs[1];
+uint8_t				TDF_LOGGER_NUM;
+xTdfLogger_t		xNullLog;
+
+#define BENCH_RECORDS 4096
+#define BENCH_SEGMENT 256
+
+static int16_t	pxBenchValues[BENCH_RECORDS][3];
+static xTdfTime_t pxBenchTimes[BENCH_RECORDS];
+static uint8_t	pucBenchLog[BENCH_RECORDS * 16];
+static uint32_t   ulBenchLogged;
+
+static double prvSeconds( void )
+{
+	struct timespec xNow;
+	clock_gettime( CLOCK_MONOTONIC, &xNow );
+	return xNow.tv_sec + xNow.tv_nsec * 1e-9;
+}
+
+/* Packs the benchmark records into as few logical blocks worth of segments as possible */
+__attribute__( ( noinline, no_sanitize_address ) ) static void prvBenchEncode( void )
+{
+	static uint8_t   pucBlock[BENCH_SEGMENT];
+	xTdfCompressor_t xCompressor;
+	int				 i;
+
+	ulBenchLogged = 0;
+	vTdfCompressStart( &xCompressor, TDF_ACC_XYZ_SIGNED, TDF_TIMESTAMP_GLOBAL, pucBlock, sizeof( pucBlock ) );
+	for ( i = 0; i < BENCH_RECORDS; i++ ) {
+		if ( eTdfCompressAdd( &xCompressor, &pxBenchTimes[i], pxBenchValues[i] ) != ERROR_NONE ) {
+			memcpy( pucBenchLog + ulBenchLogged, pucBlock, xCompressor.usBufferOffset );
+			ulBenchLogged += xCompressor.usBufferOffset;
+			vTdfCompressStart( &xCompressor, TDF_ACC_XYZ_SIGNED, TDF_TIMESTAMP_GLOBAL, pucBlock, sizeof( pucBlock ) );
+			eTdfCompressAdd( &xCompressor, &pxBenchTimes[i], pxBenchValues[i] );
+		}
+	}
+	memcpy( pucBenchLog + ulBenchLogged, pucBlock, xCompressor.usBufferOffset );
+	ulBenchLogged += xCompressor.usBufferOffset;
+}
+
+__attribute__( ( noinline, no_sanitize_address ) ) static int prvBenchDecode( void )
+{
+	xTdfParser_t xParser;
+	xTdf_t		 xTdf;
+	int			 iNum = 0;
+
+	vTdfParseStart( &xParser, pucBenchLog, ulBenchLogged );
+	while ( eTdfParse( &xParser, &xTdf ) == ERROR_NONE ) {
+		if ( ( memcmp( xTdf.pucData, pxBenchValues[iNum], 6 ) != 0 ) || ( memcmp( &xTdf.xTime, &pxBenchTimes[iNum], sizeof( xTdfTime_t ) ) != 0 ) ) {
+			break;
+		}
+		iNum++;
+	}
+	return iNum;
+}
+
+/* Accelerometer samples at 32 Hz with noise of iNoise counts, moving with amplitude dAmplitude G */
+static void prvBenchRun( const char *pcName, double dAmplitude, int iNoise )
+{
+	double dEncode = 1e9, dDecode = 1e9, dStart;
+	int	i, iRun, iDecoded = 0;
+
+	srand( 1 );
+	for ( i = 0; i < BENCH_RECORDS; i++ ) {
+		double dPhase			= 2 * M_PI * 1.5 * i / 32.0;
+		pxBenchValues[i][0]		= (int16_t) ( 4096 * dAmplitude * sin( dPhase ) ) + ( rand() % ( 2 * iNoise + 1 ) ) - iNoise;
+		pxBenchValues[i][1]		= (int16_t) ( 2048 * dAmplitude * sin( dPhase / 2 ) ) + ( rand() % ( 2 * iNoise + 1 ) ) - iNoise;
+		pxBenchValues[i][2]		= (int16_t) ( 4096 + 4096 * dAmplitude * cos( 2 * dPhase ) ) + ( rand() % ( 2 * iNoise + 1 ) ) - iNoise;
+		pxBenchTimes[i]			= ( xTdfTime_t ){ 600000000 + i / 32, ( i % 32 ) * 2048 };
+	}
+	for ( iRun = 0; iRun < 3; iRun++ ) {
+		dStart = prvSeconds();
+		for ( i = 0; i < 50; i++ ) {
+			prvBenchEncode();
+		}
+		dEncode = fmin( dEncode, ( prvSeconds() - dStart ) / 50 );
+		dStart	= prvSeconds();
+		for ( i = 0; i < 50; i++ ) {
+			iDecoded = prvBenchDecode();
+		}
+		dDecode = fmin( dDecode, ( prvSeconds() - dStart ) / 50 );
+	}
+	CHECK( iDecoded == BENCH_RECORDS, "%s: decoded %d of %d records", pcName, iDecoded, BENCH_RECORDS );
+	/* Uncompressed records carry a 2 byte header and either a 6 byte global or 2 byte relative timestamp */
+	printf( "%-8s %.2f bytes/record, %.2fx vs global, %.2fx vs relative timestamps, encode %.0f ns, decode %.0f ns per record\n",
+			pcName, (double) ulBenchLogged / BENCH_RECORDS, 14.0 * BENCH_RECORDS / ulBenchLogged, 10.0 * BENCH_RECORDS / ulBenchLogged,
+			1e9 * dEncode / BENCH_RECORDS, 1e9 * dDecode / BENCH_RECORDS );
+}
+
+int main( void )
+{
+	static const int16_t psValues[4][3] = { { 100, -200, 16384 }, { 101, -202, 16384 }, { 99, -200, 16380 }, { -32768, 32767, 0 } };
+	static xTdfTime_t	pxTimes[4]	  = { { 600000000, 0 }, { 600000000, 0x4000 }, { 600000000, 0x8000 }, { 600000001, 0x8000 } };
+	xLogger_t			 xLog			 = { 0 };
+	xTdfLogger_t		 xTdfLog		  = { &xLog, NULL, { TDF_INVALID_TIME, 0 }, { 0, 0 } };
+	xTdfCompressor_t	 xCompressor;
+	xTdfParser_t		 xParser;
+	xTdf_t				 xTdf;
+	uint8_t				 pucSegment[128];
+	xTdfTime_t			 xValidAfter;
+	int					 i;
+
+	xLog.usLogicalBlockSize = 256;
+
+	vTdfCompressStart( &xCompressor, TDF_ACC_XYZ_SIGNED, TDF_TIMESTAMP_GLOBAL, pucSegment, sizeof( pucSegment ) );
+	for ( i = 0; i < 4; i++ ) {
+		CHECK( eTdfCompressAdd( &xCompressor, &pxTimes[i], (void *) psValues[i] ) == ERROR_NONE, "add %d", i );
+	}
+	/* Segments are marked by the reserved ID, the real ID follows the header */
+	CHECK( LE_U16_EXTRACT( pucSegment ) == ( TDF_COMPRESSED_ID | TDF_TIMESTAMP_GLOBAL ), "segment header %04X", LE_U16_EXTRACT( pucSegment ) );
+	CHECK( LE_U16_EXTRACT( pucSegment + 2 ) == TDF_ACC_XYZ_SIGNED, "segment TDF ID" );
+	CHECK( pucSegment[4] == 4, "segment count %d", pucSegment[4] );
+
+	/* Records before the valid time are rejected, as they are for eTdfAdd */
+	xValidAfter.ulSecondsSince2000 = 600000001;
+	xValidAfter.usSecondsFraction  = 0;
+	eTdfLoggerConfigure( &xTdfLog, TDF_LOGGER_CONFIG_CHECK_TIME_NOT_BEFORE, &xValidAfter );
+	CHECK( eTdfAddCompressed( &xTdfLog, &xCompressor ) == ERROR_INVALID_TIME, "segment before valid time" );
+	CHECK( usLogged == 0, "rejected segment was logged" );
+	xValidAfter.ulSecondsSince2000 = 600000000;
+	eTdfLoggerConfigure( &xTdfLog, TDF_LOGGER_CONFIG_CHECK_TIME_NOT_BEFORE, &xValidAfter );
+	CHECK( eTdfAddCompressed( &xTdfLog, &xCompressor ) == ERROR_NONE, "segment at valid time" );
+	CHECK( usLogged == xCompressor.usBufferOffset, "segment logged %d of %d bytes", usLogged, xCompressor.usBufferOffset );
+
+	/* A standard TDF follows the segment, and parses as normal */
+	usLogged += usTdfAddToBuffer( TDF_ACC_XYZ_SIGNED, TDF_TIMESTAMP_NONE, NULL, (void *) psValues[0], 32, pucLogged + usLogged );
+	vTdfParseStart( &xParser, pucLogged, usLogged );
+	for ( i = 0; eTdfParse( &xParser, &xTdf ) == ERROR_NONE; i++ ) {
+		if ( i < 4 ) {
+			CHECK( xTdf.usId == ( TDF_ACC_XYZ_SIGNED | TDF_TIMESTAMP_GLOBAL ), "record %d ID %04X", i, xTdf.usId );
+			CHECK( memcmp( xTdf.pucData, psValues[i], 6 ) == 0, "record %d data", i );
+			CHECK( memcmp( &xTdf.xTime, &pxTimes[i], sizeof( xTdfTime_t ) ) == 0, "record %d time", i );
+		}
+		else {
+			CHECK( xTdf.usId == TDF_ACC_XYZ_SIGNED && memcmp( xTdf.pucData, psValues[0], 6 ) == 0, "trailing TDF" );
+		}
+	}
+	CHECK( i == 5, "parsed %d TDFs", i );
+
+	/* Truncated segments are rejected */
+	vTdfParseStart( &xParser, pucLogged, 7 );
+	CHECK( eTdfParse( &xParser, &xTdf ) == ERROR_INVALID_DATA, "truncated header" );
+
+	/* IDs beyond the length table are rejected, for standard TDFs and inside segments */
+	memcpy( pucSegment + 64, pucLogged, usLogged );
+	LE_U16_PACK( pucSegment + 64 + 2, TDF_ID_MASK - 2 );
+	vTdfParseStart( &xParser, pucSegment + 64, usLogged );
+	CHECK( eTdfParse( &xParser, &xTdf ) == ERROR_INVALID_DATA, "segment with unknown ID" );
+	LE_U16_PACK( pucSegment, 0x0800 | TDF_TIMESTAMP_NONE );
+	vTdfParseStart( &xParser, pucSegment, 64 );
+	CHECK( eTdfParse( &xParser, &xTdf ) == ERROR_INVALID_DATA, "TDF with unknown ID" );
+	vTdfCompressStart( &xCompressor, TDF_ACC_XYZ_SIGNED, TDF_TIMESTAMP_GLOBAL, pucSegment, sizeof( pucSegment ) );
+	for ( i = 0; i < 4; i++ ) {
+		eTdfCompressAdd( &xCompressor, &pxTimes[i], (void *) psValues[i] );
+	}
+
+	printf( "SEGMENT " );
+	for ( i = 0; i < xCompressor.usBufferOffset; i++ ) {
+		printf( "%02x", pucSegment[i] );
+	}
+	printf( "\n" );
+
+	/* Compression benchmark, informational only */
+	prvBenchRun( "resting", 0.0, 8 );
+	prvBenchRun( "walking", 0.3, 8 );
+	prvBenchRun( "running", 1.5, 32 );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
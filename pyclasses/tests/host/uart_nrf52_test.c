@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2020, Commonwealth Scientific and Industrial Research
+ * Organisation (CSIRO) ABN 41 687 119 230.
+ *
+ * Host simulation of the nRF52 UART transmit path, reporting link utilisation under interrupt latency
+ * The UARTE model latches TXD.PTR on STARTTX, completes buffers at the baud rate and fires the PPI chain channel on ENDTX.
+ * Interrupts are run after a random latency with occasional spikes, and the handler is occasionally preempted after it
+ * clears ENDTX, so that a chained buffer can complete before the handler reads TXD.AMOUNT.
+ * Every buffer is filled from its sequence number and checked when it completes, so reordering, repeats and buffers
+ * released before the hardware is done with them are detected, as are semaphore and memory pool over-releases.
+ * Times are in 64 MHz CPU cycles.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "stream_buffer.h"
+
+#include "uart.h"
+
+#define NUM_BUFFERS 6
+#define BUFFER_SIZE 128
+#define TARGET_BUFFERS 20000
+#define PRODUCER_CYCLES 1500
+#define CYCLES_PER_US 64.0
+#define NEVER 1e300
+
+static int iErrors;
+#define CHECK( c, ... )                      \
+	do {                                     \
+		if ( !( c ) ) {                      \
+			iErrors++;                       \
+			printf( "FAIL %d: ", __LINE__ ); \
+			printf( __VA_ARGS__ );           \
+			printf( "\n" );                  \
+		}                                    \
+	} while ( 0 )
+
+void vUartInterruptHandler( xUartModule_t *pxModule );
+void vUartQueueBuffer( xUartModule_t *pxModule, int8_t *pcBuffer, uint32_t ulBufferLen );
+
+/* Kernel objects -------------------------------------------*/
+
+typedef struct xHostQueue_t
+{
+	uint32_t ulItemSize;
+	uint32_t ulLength;
+	uint32_t ulHead;
+	uint32_t ulCount;
+	uint32_t ulMaxCount;
+	uint8_t  pucData[NUM_BUFFERS * sizeof( xPendingTransmit_t )];
+} xHostQueue_t;
+
+static xHostQueue_t pxQueues[8];
+static uint32_t		ulQueues;
+/* Gives beyond the maximum count of a counting semaphore, or takes from an empty one in an interrupt */
+static uint32_t ulSemaphoreErrors;
+
+QueueHandle_t xQueueCreate( UBaseType_t uxQueueLength, UBaseType_t uxItemSize )
+{
+	xHostQueue_t *pxQueue = &pxQueues[ulQueues++];
+
+	configASSERT( uxQueueLength * uxItemSize <= sizeof( pxQueue->pucData ) );
+	memset( pxQueue, 0x00, sizeof( xHostQueue_t ) );
+	pxQueue->ulItemSize = uxItemSize;
+	pxQueue->ulLength	= uxQueueLength;
+	return pxQueue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting( UBaseType_t uxMaxCount, UBaseType_t uxInitialCount )
+{
+	xHostQueue_t *pxQueue = xQueueCreate( 0, 0 );
+
+	pxQueue->ulMaxCount = uxMaxCount;
+	pxQueue->ulCount	= uxInitialCount;
+	return pxQueue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic( UBaseType_t uxMaxCount, UBaseType_t uxInitialCount, StaticSemaphore_t *pxSemaphoreBuffer )
+{
+	return xSemaphoreCreateCounting( uxMaxCount, uxInitialCount );
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary( void )
+{
+	return xSemaphoreCreateCounting( 1, 0 );
+}
+
+BaseType_t xQueueSendToBack( QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait )
+{
+	xHostQueue_t *pxQueue = xQueue;
+
+	/* The driver never queues more buffers than it has */
+	configASSERT( pxQueue->ulCount < pxQueue->ulLength );
+	memcpy( &pxQueue->pucData[( ( pxQueue->ulHead + pxQueue->ulCount ) % pxQueue->ulLength ) * pxQueue->ulItemSize], pvItemToQueue, pxQueue->ulItemSize );
+	pxQueue->ulCount++;
+	return pdTRUE;
+}
+
+BaseType_t xQueueReceiveFromISR( QueueHandle_t xQueue, void *pvBuffer, BaseType_t *pxHigherPriorityTaskWoken )
+{
+	xHostQueue_t *pxQueue = xQueue;
+
+	if ( pxQueue->ulCount == 0 ) {
+		return pdFALSE;
+	}
+	memcpy( pvBuffer, &pxQueue->pucData[pxQueue->ulHead * pxQueue->ulItemSize], pxQueue->ulItemSize );
+	pxQueue->ulHead = ( pxQueue->ulHead + 1 ) % pxQueue->ulLength;
+	pxQueue->ulCount--;
+	return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting( QueueHandle_t xQueue )
+{
+	return ( (xHostQueue_t *) xQueue )->ulCount;
+}
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore, TickType_t xTicksToWait )
+{
+	xHostQueue_t *pxQueue = xSemaphore;
+
+	if ( pxQueue->ulCount == 0 ) {
+		return pdFALSE;
+	}
+	pxQueue->ulCount--;
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeFromISR( SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken )
+{
+	if ( xSemaphoreTake( xSemaphore, 0 ) != pdTRUE ) {
+		ulSemaphoreErrors++;
+		return pdFALSE;
+	}
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore )
+{
+	xHostQueue_t *pxQueue = xSemaphore;
+
+	if ( pxQueue->ulCount >= pxQueue->ulMaxCount ) {
+		/* Expected for the binary transmit done semaphore */
+		if ( pxQueue->ulMaxCount > 1 ) {
+			ulSemaphoreErrors++;
+		}
+		return pdFALSE;
+	}
+	pxQueue->ulCount++;
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR( SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken )
+{
+	return xSemaphoreGive( xSemaphore );
+}
+
+UBaseType_t uxSemaphoreGetCount( SemaphoreHandle_t xSemaphore )
+{
+	return ( (xHostQueue_t *) xSemaphore )->ulCount;
+}
+
+StreamBufferHandle_t xStreamBufferCreate( size_t xBufferSizeBytes, size_t xTriggerLevelBytes )
+{
+	return (StreamBufferHandle_t) 1;
+}
+
+size_t xStreamBufferSendFromISR( StreamBufferHandle_t xStreamBuffer, const void *pvTxData, size_t xDataLengthBytes, BaseType_t *pxHigherPriorityTaskWoken )
+{
+	return xDataLengthBytes;
+}
+
+void vInterruptSetPriority( int32_t IRQn, uint32_t ulPriority ) {}
+
+void vGpioSetup( xGpio_t xGpio, eGpioType_t eType, uint32_t ulParam ) {}
+
+/* Hardware model -------------------------------------------*/
+
+static NRF_UARTE_Type xUarte;
+static NRF_TIMER_Type xTimer;
+
+UART_MODULE_CREATE( SIM, &xUarte, UARTE0_IRQHandler, UNUSED_IRQ, NUM_BUFFERS, BUFFER_SIZE, 64 );
+static xUartModule_t *const pxSim = &UART_MODULE_GET( SIM );
+
+static uint32_t ulPpiEnabled;
+static uint8_t  ucPpiAllocated;
+
+static double	now, dCyclesPerByte, dSpikeCycles, dSpikeChance;
+static bool		bInterrupt, bTxBusy, bFailed;
+static double	dTxEnd, dLastEnd, dGapCycles;
+static uint8_t *pucLatched;
+static uint32_t ulLatched, ulNextSequence, ulCompleted, ulSequenceErrors, ulHwChains, ulLateEnds;
+static uint64_t ullBytes;
+
+nrfx_err_t nrfx_ppi_channel_alloc( nrf_ppi_channel_t *pxChannel )
+{
+	*pxChannel = ucPpiAllocated++;
+	return 0;
+}
+
+nrfx_err_t nrfx_ppi_channel_assign( nrf_ppi_channel_t xChannel, uint32_t ulEvent, uint32_t ulTask )
+{
+	return 0;
+}
+
+nrfx_err_t nrfx_ppi_channel_fork_assign( nrf_ppi_channel_t xChannel, uint32_t ulForkTask )
+{
+	return 0;
+}
+
+nrfx_err_t nrfx_ppi_channel_enable( nrf_ppi_channel_t xChannel )
+{
+	ulPpiEnabled |= 1UL << xChannel;
+	return 0;
+}
+
+nrfx_err_t nrfx_ppi_group_alloc( nrf_ppi_channel_group_t *pxGroup )
+{
+	*pxGroup = 0;
+	return 0;
+}
+
+nrfx_err_t nrfx_ppi_channel_include_in_group( nrf_ppi_channel_t xChannel, nrf_ppi_channel_group_t xGroup )
+{
+	return 0;
+}
+
+uint32_t nrfx_ppi_task_addr_group_disable_get( nrf_ppi_channel_group_t xGroup )
+{
+	return 0;
+}
+
+/* Contents of each buffer, which differ between buffers that can be in flight together */
+static uint8_t prvPattern( uint32_t ulSequence, uint32_t ulIndex )
+{
+	return (uint8_t) ( ulSequence + ulIndex * 31 );
+}
+
+static void prvStartTx( void )
+{
+	if ( bTxBusy ) {
+		CHECK( false, "STARTTX while buffer %u is transmitting", ulNextSequence );
+		bFailed = true;
+		return;
+	}
+	if ( !xUarte.ENABLE ) {
+		return;
+	}
+	pucLatched = (uint8_t *) (uintptr_t) xUarte.TXD.PTR;
+	ulLatched  = xUarte.TXD.MAXCNT;
+	if ( dLastEnd > 0 ) {
+		dGapCycles += now - dLastEnd;
+	}
+	bTxBusy					= true;
+	dTxEnd					= now + ulLatched * dCyclesPerByte;
+	xUarte.EVENTS_TXSTARTED = 1;
+}
+
+static void prvTxEnd( void )
+{
+	const nrf_ppi_channel_t xChain = pxSim->xPlatform.xTxChainChannel;
+	uint32_t				i;
+
+	now		 = dTxEnd;
+	bTxBusy	 = false;
+	dLastEnd = now;
+	/* The buffer must still hold its contents, otherwise it was released early */
+	for ( i = 0; i < ulLatched; i++ ) {
+		if ( pucLatched[i] != prvPattern( ulNextSequence, i ) ) {
+			ulSequenceErrors++;
+			break;
+		}
+	}
+	ulNextSequence++;
+	ulCompleted++;
+	ullBytes += ulLatched;
+	xUarte.TXD.AMOUNT	= ulLatched;
+	xUarte.EVENTS_ENDTX = 1;
+	/* ENDTX to STARTTX, the channel group disables the channel when it fires */
+	if ( ulPpiEnabled & ( 1UL << xChain ) ) {
+		ulPpiEnabled &= ~( 1UL << xChain );
+		ulHwChains++;
+		prvStartTx();
+	}
+}
+
+/* A higher priority interrupt can preempt the handler after it clears ENDTX, the chained buffer may complete meanwhile */
+nrfx_err_t nrfx_ppi_channel_disable( nrf_ppi_channel_t xChannel )
+{
+	double dResume;
+
+	ulPpiEnabled &= ~( 1UL << xChannel );
+	if ( bInterrupt && ( xChannel == pxSim->xPlatform.xTxChainChannel ) && ( ( rand() / (double) RAND_MAX ) < dSpikeChance ) ) {
+		dResume = now + dSpikeCycles;
+		if ( bTxBusy && ( dTxEnd <= dResume ) ) {
+			ulLateEnds++;
+			prvTxEnd();
+		}
+		now = dResume;
+	}
+	return 0;
+}
+
+static void prvTasks( void )
+{
+	if ( xUarte.TASKS_STARTTX ) {
+		xUarte.TASKS_STARTTX = 0;
+		prvStartTx();
+	}
+	if ( xUarte.TASKS_STOPTX ) {
+		xUarte.TASKS_STOPTX		= 0;
+		xUarte.EVENTS_TXSTOPPED = 1;
+	}
+	if ( xUarte.TASKS_STOPRX ) {
+		xUarte.TASKS_STOPRX = 0;
+		if ( xUarte.ENABLE ) {
+			xUarte.EVENTS_RXTO = 1;
+		}
+	}
+	xUarte.TASKS_STARTRX = 0;
+}
+
+static bool bInterruptPending( void )
+{
+	uint32_t ulEvents = ( xUarte.EVENTS_ENDRX ? NRF_UARTE_INT_ENDRX_MASK : 0 ) | ( xUarte.EVENTS_ENDTX ? NRF_UARTE_INT_ENDTX_MASK : 0 ) |
+						( xUarte.EVENTS_ERROR ? NRF_UARTE_INT_ERROR_MASK : 0 ) | ( xUarte.EVENTS_RXTO ? NRF_UARTE_INT_RXTO_MASK : 0 ) |
+						( xUarte.EVENTS_TXSTARTED ? NRF_UARTE_INT_TXSTARTED_MASK : 0 );
+	return ( ulEvents & xUarte.INTEN ) != 0;
+}
+
+static void prvInterrupt( void )
+{
+	bInterrupt = true;
+	vUartInterruptHandler( pxSim );
+	bInterrupt = false;
+	prvTasks();
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvScenario( const char *pcName, uint32_t ulBaud, uint32_t ulMinLen, uint32_t ulMaxLen, double dIsrCost, double dSpikeUs, double dChance, double dMinUtilisation )
+{
+	double   dCpuFree = 0, dInterruptAt = -1, dIsr, dProducer, dHardware, dUtilisation;
+	uint32_t ulSequence = 0, ulLength, ulDrain, i;
+	int8_t * pcBuffer;
+
+	/* Reset the hardware, kernel objects and driver state */
+	memset( &xUarte, 0x00, sizeof( xUarte ) );
+	memset( &pxSim->xPlatform.pxInFlight, 0x00, sizeof( pxSim->xPlatform.pxInFlight ) );
+	memset( &pxSim->xStatistics, 0x00, sizeof( pxSim->xStatistics ) );
+	pxSim->xPlatform.ucInFlight = 0;
+	pxSim->xPlatform.bTxStarted = false;
+	pxSim->xPlatform.pxTimer	= &xTimer;
+	pxSim->ulBaud				= ulBaud;
+	ulQueues = ulSemaphoreErrors = 0;
+	ulPpiEnabled = ucPpiAllocated = 0;
+	now = dLastEnd = dGapCycles = 0;
+	bTxBusy = bFailed = false;
+	ulNextSequence = ulCompleted = ulSequenceErrors = ulHwChains = ulLateEnds = 0;
+	ullBytes	   = 0;
+	dCyclesPerByte = 10.0 * 1e6 * CYCLES_PER_US / ulBaud;
+	dSpikeCycles   = dSpikeUs * CYCLES_PER_US;
+	dSpikeChance   = dChance;
+	srand( 1 );
+	eUartInit( pxSim, false );
+
+	while ( ( ulCompleted < TARGET_BUFFERS ) && !bFailed ) {
+		/* Run whichever of the hardware, the interrupt and the producer is next */
+		if ( bInterruptPending() && ( dInterruptAt < 0 ) ) {
+			dInterruptAt = now + 64 + rand() % 64;
+			if ( ( rand() / (double) RAND_MAX ) < dSpikeChance ) {
+				dInterruptAt += dSpikeCycles;
+			}
+		}
+		dIsr	  = ( dInterruptAt >= 0 ) ? MAX( dInterruptAt, dCpuFree ) : NEVER;
+		dProducer = ( ( ulSequence < TARGET_BUFFERS ) && uxSemaphoreGetCount( pxSim->pxMemPool->xSemaphoreHandle ) ) ? MAX( now, dCpuFree ) : NEVER;
+		dHardware = bTxBusy ? dTxEnd : NEVER;
+		if ( ( dHardware <= dIsr ) && ( dHardware <= dProducer ) && ( dHardware < NEVER ) ) {
+			prvTxEnd();
+		}
+		else if ( ( dIsr <= dProducer ) && ( dIsr < NEVER ) ) {
+			now			 = dIsr;
+			dInterruptAt = -1;
+			prvInterrupt();
+			dCpuFree = now + dIsrCost;
+		}
+		else if ( dProducer < NEVER ) {
+			now		 = dProducer;
+			pcBuffer = pcMemoryPoolClaim( pxSim->pxMemPool, 0 );
+			ulLength = ulMinLen + ( rand() % ( ulMaxLen - ulMinLen + 1 ) );
+			for ( i = 0; i < ulLength; i++ ) {
+				pcBuffer[i] = (int8_t) prvPattern( ulSequence, i );
+			}
+			ulSequence++;
+			vUartQueueBuffer( pxSim, pcBuffer, ulLength );
+			prvTasks();
+			dCpuFree = now + PRODUCER_CYCLES;
+		}
+		else {
+			CHECK( false, "%s: stalled after %u buffers, %u in flight", pcName, ulCompleted, pxSim->xPlatform.ucInFlight );
+			bFailed = true;
+		}
+	}
+	/* Let the driver handle the final completion and return to idle */
+	for ( ulDrain = 0; bInterruptPending() && ( ulDrain < 10 ); ulDrain++ ) {
+		now += 200;
+		prvInterrupt();
+	}
+	dUtilisation = 100.0 * ullBytes * dCyclesPerByte / now;
+
+	CHECK( ulCompleted == TARGET_BUFFERS, "%s: %u buffers completed", pcName, ulCompleted );
+	CHECK( ulSequenceErrors == 0, "%s: %u buffers out of order or released early", pcName, ulSequenceErrors );
+	CHECK( ulSemaphoreErrors == 0, "%s: %u semaphore over-releases", pcName, ulSemaphoreErrors );
+	CHECK( !bInterruptPending() && ( pxSim->xPlatform.ucInFlight == 0 ), "%s: %u buffers in flight after draining", pcName, pxSim->xPlatform.ucInFlight );
+	CHECK( ucMemoryPoolUsedBuffers( pxSim->pxMemPool ) == 0, "%s: %u buffers not returned", pcName, ucMemoryPoolUsedBuffers( pxSim->pxMemPool ) );
+	CHECK( pxSim->xStatistics.ulBuffersSent == TARGET_BUFFERS, "%s: %u buffers counted", pcName, pxSim->xStatistics.ulBuffersSent );
+	CHECK( pxSim->xStatistics.ulChainedStarts == ulHwChains, "%s: %u chained starts counted, %u by the hardware", pcName, pxSim->xStatistics.ulChainedStarts, ulHwChains );
+	CHECK( dUtilisation >= dMinUtilisation, "%s: utilisation %.1f%% below %.1f%%", pcName, dUtilisation, dMinUtilisation );
+	printf( "%-42s utilisation %5.1f%%, gap %6.1f us/buffer, %5u chained, %4u completed in a preempted handler\n", pcName, dUtilisation,
+			dGapCycles / ulCompleted / CYCLES_PER_US, ulHwChains, ulLateEnds );
+}
+
+int main( void )
+{
+	prvScenario( "1 MBaud, 16-48 bytes, 50 us spikes", 1000000, 16, 48, 300, 50, 0.05, 99 );
+	prvScenario( "1 MBaud, 10-20 bytes, 150 us spikes", 1000000, 10, 20, 300, 150, 0.05, 90 );
+	prvScenario( "1 MBaud, 32 bytes, 50 us spikes", 1000000, 32, 32, 300, 50, 0.05, 0 );
+	prvScenario( "115200 Baud, 1-64 bytes, 150 us spikes", 115200, 1, 64, 300, 150, 0.10, 95 );
+	/* Chained buffers shorter than the preemption, so they complete after ENDTX is cleared */
+	prvScenario( "1 MBaud, 2-6 bytes, 20 us spikes", 1000000, 2, 6, 300, 20, 0.10, 0 );
+	CHECK( ulLateEnds > 0, "no buffer completed within the handler" );
+
+	printf( "%s, %d errors\n", iErrors ? "FAILED" : "PASSED", iErrors );
+	return iErrors != 0;
+}
@@ -0,0 +1,23 @@
+/*
+ * Host model of the nRF52 interrupt controller, interrupts are run by the harness
+ */
+#ifndef __CORE_CSIRO_HOST_CPU_ARCH_H__
+#define __CORE_CSIRO_HOST_CPU_ARCH_H__
+
+#include <stdint.h>
+
+typedef int32_t IRQn_Type;
+
+/* From FreeRTOSConfig.h */
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY 5
+
+static inline void NVIC_ClearPendingIRQ( IRQn_Type IRQn ) {}
+static inline void NVIC_EnableIRQ( IRQn_Type IRQn ) {}
+static inline void NVIC_DisableIRQ( IRQn_Type IRQn ) {}
+
+static inline uint32_t ulCpuClockFreq( void )
+{
+	return 64000000;
+}
+
+#endif /* __CORE_CSIRO_HOST_CPU_ARCH_H__ */
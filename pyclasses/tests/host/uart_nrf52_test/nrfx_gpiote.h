@@ -0,0 +1,33 @@
+/*
+ * Host stub of the GPIOTE input used to detect receive activity
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_GPIOTE_H__
+#define __CORE_CSIRO_HOST_NRFX_GPIOTE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct nrfx_gpiote_in_config_t
+{
+	bool bHighAccuracy;
+} nrfx_gpiote_in_config_t;
+
+#define NRFX_GPIOTE_RAW_CONFIG_IN_SENSE_TOGGLE( hi_accu ) \
+	{                                                     \
+		.bHighAccuracy = hi_accu                          \
+	}
+
+static inline uint32_t nrfx_gpiote_in_init( uint8_t ucPin, nrfx_gpiote_in_config_t const *pxConfig, void *pvHandler )
+{
+	return 0;
+}
+
+static inline uint32_t nrfx_gpiote_in_event_addr_get( uint8_t ucPin )
+{
+	return 0;
+}
+
+static inline void nrfx_gpiote_in_event_enable( uint8_t ucPin, bool bInterrupt ) {}
+static inline void nrfx_gpiote_in_event_disable( uint8_t ucPin ) {}
+
+#endif /* __CORE_CSIRO_HOST_NRFX_GPIOTE_H__ */
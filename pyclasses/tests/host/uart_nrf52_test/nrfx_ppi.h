@@ -0,0 +1,24 @@
+/*
+ * Host model of the nRF52 PPI, the harness fires the transmit chain channel at the end of a buffer
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_PPI_H__
+#define __CORE_CSIRO_HOST_NRFX_PPI_H__
+
+#include <stdint.h>
+
+#include "nrfx_uarte.h"
+
+typedef uint8_t nrf_ppi_channel_t;
+typedef uint8_t nrf_ppi_channel_group_t;
+typedef uint32_t nrfx_err_t;
+
+nrfx_err_t nrfx_ppi_channel_alloc( nrf_ppi_channel_t *pxChannel );
+nrfx_err_t nrfx_ppi_channel_assign( nrf_ppi_channel_t xChannel, uint32_t ulEvent, uint32_t ulTask );
+nrfx_err_t nrfx_ppi_channel_fork_assign( nrf_ppi_channel_t xChannel, uint32_t ulForkTask );
+nrfx_err_t nrfx_ppi_channel_enable( nrf_ppi_channel_t xChannel );
+nrfx_err_t nrfx_ppi_channel_disable( nrf_ppi_channel_t xChannel );
+nrfx_err_t nrfx_ppi_group_alloc( nrf_ppi_channel_group_t *pxGroup );
+nrfx_err_t nrfx_ppi_channel_include_in_group( nrf_ppi_channel_t xChannel, nrf_ppi_channel_group_t xGroup );
+uint32_t   nrfx_ppi_task_addr_group_disable_get( nrf_ppi_channel_group_t xGroup );
+
+#endif /* __CORE_CSIRO_HOST_NRFX_PPI_H__ */
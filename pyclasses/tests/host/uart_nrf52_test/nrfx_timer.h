@@ -0,0 +1,45 @@
+/*
+ * Host model of the nRF52 TIMER registers used by the UART receive timeout
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_TIMER_H__
+#define __CORE_CSIRO_HOST_NRFX_TIMER_H__
+
+#include <stdint.h>
+
+typedef struct NRF_TIMER_Type
+{
+	volatile uint32_t EVENTS_COMPARE[4];
+} NRF_TIMER_Type;
+
+#define TIMER_BITMODE_BITMODE_32Bit 3
+#define TIMER_SHORTS_COMPARE1_STOP_Msk 1
+#define TIMER_SHORTS_COMPARE1_CLEAR_Msk 2
+#define TIMER_MODE_MODE_Timer 0
+
+typedef enum nrf_timer_task_t {
+	NRF_TIMER_TASK_START,
+	NRF_TIMER_TASK_CLEAR
+} nrf_timer_task_t;
+
+typedef enum nrf_timer_event_t {
+	NRF_TIMER_EVENT_COMPARE0,
+	NRF_TIMER_EVENT_COMPARE1
+} nrf_timer_event_t;
+
+static inline void nrf_timer_bit_width_set( NRF_TIMER_Type *pxTimer, uint32_t ulWidth ) {}
+static inline void nrf_timer_frequency_set( NRF_TIMER_Type *pxTimer, uint32_t ulFrequency ) {}
+static inline void nrf_timer_shorts_enable( NRF_TIMER_Type *pxTimer, uint32_t ulMask ) {}
+static inline void nrf_timer_mode_set( NRF_TIMER_Type *pxTimer, uint32_t ulMode ) {}
+static inline void nrf_timer_cc_write( NRF_TIMER_Type *pxTimer, uint32_t ulChannel, uint32_t ulValue ) {}
+
+static inline uint32_t nrf_timer_task_address_get( NRF_TIMER_Type *pxTimer, nrf_timer_task_t eTask )
+{
+	return 0;
+}
+
+static inline uint32_t nrf_timer_event_address_get( NRF_TIMER_Type *pxTimer, nrf_timer_event_t eEvent )
+{
+	return 0;
+}
+
+#endif /* __CORE_CSIRO_HOST_NRFX_TIMER_H__ */
@@ -0,0 +1,86 @@
+/*
+ * Host model of the nRF52 UARTE registers, tasks and events are acted on by the harness
+ */
+#ifndef __CORE_CSIRO_HOST_NRFX_UARTE_H__
+#define __CORE_CSIRO_HOST_NRFX_UARTE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrfx_timer.h"
+
+typedef struct NRF_UARTE_Type
+{
+	volatile uint32_t TASKS_STARTRX;
+	volatile uint32_t TASKS_STOPRX;
+	volatile uint32_t TASKS_STARTTX;
+	volatile uint32_t TASKS_STOPTX;
+	volatile uint32_t EVENTS_ENDRX;
+	volatile uint32_t EVENTS_ENDTX;
+	volatile uint32_t EVENTS_ERROR;
+	volatile uint32_t EVENTS_RXTO;
+	volatile uint32_t EVENTS_RXDRDY;
+	volatile uint32_t EVENTS_RXSTARTED;
+	volatile uint32_t EVENTS_TXSTARTED;
+	volatile uint32_t EVENTS_TXSTOPPED;
+	volatile uint32_t INTEN;
+	volatile uint32_t ERRORSRC;
+	volatile uint32_t ENABLE;
+	volatile uint32_t BAUDRATE;
+	volatile uint32_t CONFIG;
+	struct
+	{
+		volatile uint32_t RTS;
+		volatile uint32_t TXD;
+		volatile uint32_t CTS;
+		volatile uint32_t RXD;
+	} PSEL;
+	struct
+	{
+		volatile uint32_t PTR;
+		volatile uint32_t MAXCNT;
+		volatile uint32_t AMOUNT;
+	} RXD, TXD;
+} NRF_UARTE_Type;
+
+#define NRF_UARTE_INT_ENDRX_MASK 0x01
+#define NRF_UARTE_INT_ENDTX_MASK 0x02
+#define NRF_UARTE_INT_ERROR_MASK 0x04
+#define NRF_UARTE_INT_RXTO_MASK 0x08
+#define NRF_UARTE_INT_TXSTARTED_MASK 0x10
+
+#define UARTE_ENABLE_ENABLE_Disabled 0
+#define UARTE_ENABLE_ENABLE_Enabled 8
+#define NRF_UARTE_PSEL_DISCONNECTED 0xFFFFFFFF
+
+typedef enum nrf_uarte_task_t {
+	NRF_UARTE_TASK_STARTRX,
+	NRF_UARTE_TASK_STOPRX,
+	NRF_UARTE_TASK_STARTTX
+} nrf_uarte_task_t;
+
+typedef enum nrf_uarte_event_t {
+	NRF_UARTE_EVENT_ENDTX
+} nrf_uarte_event_t;
+
+static inline uint32_t nrf_uarte_task_address_get( NRF_UARTE_Type *pxUart, nrf_uarte_task_t eTask )
+{
+	return 0;
+}
+
+static inline uint32_t nrf_uarte_event_address_get( NRF_UARTE_Type *pxUart, nrf_uarte_event_t eEvent )
+{
+	return 0;
+}
+
+static inline int32_t nrfx_get_irq_number( void const *pvPeripheral )
+{
+	return 2;
+}
+
+static inline bool nrfx_is_in_ram( void const *pvObject )
+{
+	return true;
+}
+
+#endif /* __CORE_CSIRO_HOST_NRFX_UARTE_H__ */
@@ -0,0 +1,13 @@
+/*
+ * Semaphore functions used by the UART driver beyond those of the shared stubs
+ */
+#ifndef __CORE_CSIRO_HOST_SEMPHR_H__
+#define __CORE_CSIRO_HOST_SEMPHR_H__
+
+#include "FreeRTOS.h"
+
+SemaphoreHandle_t xSemaphoreCreateCounting( UBaseType_t uxMaxCount, UBaseType_t uxInitialCount );
+BaseType_t		  xSemaphoreTakeFromISR( SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken );
+UBaseType_t		  uxSemaphoreGetCount( SemaphoreHandle_t xSemaphore );
+
+#endif /* __CORE_CSIRO_HOST_SEMPHR_H__ */
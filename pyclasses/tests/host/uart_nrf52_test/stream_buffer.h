@@ -0,0 +1,15 @@
+/*
+ * Stream buffer functions used by the UART driver
+ */
+#ifndef __CORE_CSIRO_HOST_STREAM_BUFFER_H__
+#define __CORE_CSIRO_HOST_STREAM_BUFFER_H__
+
+#include "FreeRTOS.h"
+
+typedef void *StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate( size_t xBufferSizeBytes, size_t xTriggerLevelBytes );
+size_t				 xStreamBufferSendFromISR( StreamBufferHandle_t xStreamBuffer, const void *pvTxData, size_t xDataLengthBytes, BaseType_t *pxHigherPriorityTaskWoken );
+size_t				 xStreamBufferReceive( StreamBufferHandle_t xStreamBuffer, void *pvRxData, size_t xBufferLengthBytes, TickType_t xTicksToWait );
+
+#endif /* __CORE_CSIRO_HOST_STREAM_BUFFER_H__ */
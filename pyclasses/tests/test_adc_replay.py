@@ -0,0 +1,51 @@
+import os
+import struct
+import tempfile
+import unittest
+
+import adc_replay
+
+
+class TestAdcReplay(unittest.TestCase):
+
+    def test_load_csv(self):
+        with tempfile.NamedTemporaryFile('w', suffix='.csv', delete=False) as f:
+            f.write('ain0,vdd\n1,2\n\n-3,4\n')
+        try:
+            self.assertEqual(adc_replay.load_csv(f.name), [[1, 2], [-3, 4]])
+        finally:
+            os.remove(f.name)
+
+    def test_load_binary(self):
+        data = struct.pack('<7h', 1, -2, 3, 4, 5, 6, 7)
+        self.assertEqual(adc_replay.load_binary(data, 3), [[1, -2, 3], [4, 5, 6]])
+        self.assertEqual(adc_replay.load_binary(data + b'\x00', 7), [[1, -2, 3, 4, 5, 6, 7]])
+        self.assertRaises(ValueError, adc_replay.load_binary, data, 0)
+
+    def test_decimate(self):
+        scans = [[1, -1], [2, -2], [2, -2], [4, 0]]
+        # Truncated toward zero, as integer division in C
+        self.assertEqual(adc_replay.decimate(scans, 2), [[1, -1], [3, -1]])
+        self.assertEqual(adc_replay.decimate(scans, 4), [[2, -1]])
+        self.assertEqual(adc_replay.decimate(scans, 1), scans)
+        self.assertRaises(ValueError, adc_replay.decimate, scans, 3)
+
+    def test_blocks(self):
+        scans = [[n] for n in range(10)]
+        self.assertEqual(list(adc_replay.blocks(scans, 4)), [[[0], [1], [2], [3]], [[4], [5], [6], [7]]])
+        self.assertEqual(list(adc_replay.blocks(scans, 4, 2)), [[[0], [2]], [[4], [6]]])
+        self.assertRaises(ValueError, list, adc_replay.blocks(scans, 4, 3))
+
+    def test_replay(self):
+        seen = []
+        stats = adc_replay.replay([[n, -n] for n in range(100)], 10, 5, seen.append, 1000)
+        self.assertEqual(stats['blocks'], 10)
+        self.assertEqual(stats['scans'], 100)
+        self.assertAlmostEqual(stats['budget_s'], 0.01)
+        self.assertEqual(seen[0], [[2, -2], [7, -7]])
+        self.assertEqual(adc_replay.channel_means(seen[0]), [4.5, -4.5])
+        self.assertEqual(adc_replay.replay([], 10, 1, seen.append, 1000)['blocks'], 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,134 @@
+import struct
+import unittest
+import zlib
+
+import crash_dump
+import rtos_trace
+
+TEXT_ADDR = 0x1000
+RODATA_ADDR = 0x2000
+
+
+def record(crash_type=3, flags=crash_dump.CALLER_SAVED | crash_dump.CALLEE_SAVED, registers=None, stack=(),
+           log=(), trace=(), task=b'APP', filename=b'', line=0, cfsr=0):
+    registers = registers or [0] * crash_dump.REGISTERS
+    stack = list(stack)
+    body = crash_dump.BODY.pack(crash_type, flags, len(stack), len(log), len(trace), task, 1234, *registers,
+                                0xFFFFFFFD, cfsr, 0, 0x20, filename, line,
+                                *(stack + [0] * (crash_dump.STACK_WORDS - len(stack))))
+    for index in range(crash_dump.LOG_EVENTS):
+        body += crash_dump.LOG_EVENT.pack(*(log[index] if index < len(log) else (0, 0)))
+    for index in range(crash_dump.TRACE_EVENTS):
+        body += rtos_trace.RECORD.pack(*(trace[index] if index < len(trace) else (0, 0, 0, 0)))
+    header = crash_dump.HEADER.pack(crash_dump.KEY, crash_dump.VERSION, crash_dump.RECORD_SIZE, zlib.crc32(body))
+    return header + body
+
+
+def elf():
+    ''' Minimal ELF32 with .text, .rodata, .symtab and .strtab '''
+    text = bytes(0x40)
+    rodata = b'Boot\n\x00Radio timeout %d\n\x00'
+    strtab = b'\x00main\x00vRadioTask\x00pcBuffer\x00'
+    symtab = struct.pack('<IIIBBH', 0, 0, 0, 0, 0, 0)
+    # Thumb function addresses have bit 0 set
+    symtab += struct.pack('<IIIBBH', 1, TEXT_ADDR | 1, 0x20, 0x12, 0, 1)
+    symtab += struct.pack('<IIIBBH', 6, (TEXT_ADDR + 0x20) | 1, 0x20, 0x12, 0, 1)
+    symtab += struct.pack('<IIIBBH', 17, RODATA_ADDR, 6, 0x11, 0, 2)
+    shstrtab = b'\x00.text\x00.rodata\x00.symtab\x00.strtab\x00.shstrtab\x00'
+    contents = [text, rodata, symtab, strtab, shstrtab]
+    offsets = []
+    data = bytearray(52)
+    for content in contents:
+        offsets.append(len(data))
+        data += content
+    shoff = len(data)
+    # name, type, flags, addr, offset, size, link, info, align, entsize
+    sections = [
+        (0, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+        (1, 1, 0x6, TEXT_ADDR, offsets[0], len(text), 0, 0, 4, 0),
+        (7, 1, 0x2, RODATA_ADDR, offsets[1], len(rodata), 0, 0, 4, 0),
+        (15, 2, 0, 0, offsets[2], len(symtab), 4, 1, 4, 16),
+        (23, 3, 0, 0, offsets[3], len(strtab), 0, 0, 1, 0),
+        (31, 3, 0, 0, offsets[4], len(shstrtab), 0, 0, 1, 0),
+    ]
+    for section in sections:
+        data += struct.pack('<10I', *section)
+    header = b'\x7fELF' + bytes([1, 1, 1]) + bytes(9)
+    header += struct.pack('<HHIIIIIHHHHHH', 2, 40, 1, TEXT_ADDR, 0, shoff, 0, 52, 0, 0, 40, len(sections), 5)
+    data[:52] = header
+    return crash_dump.Elf(bytes(data))
+
+
+class TestCrashDump(unittest.TestCase):
+
+    def test_size(self):
+        # Must match the CASSERT on sizeof( xCrashDump_t )
+        self.assertEqual(crash_dump.RECORD_SIZE, 596)
+
+    def test_parse(self):
+        registers = list(range(crash_dump.REGISTERS))
+        parsed = crash_dump.parse(record(registers=registers, stack=[1, 2, 3], log=[(RODATA_ADDR, 5)],
+                                         trace=[(10, rtos_trace.TASK_SWITCH, 2, 0)]))
+        self.assertEqual(parsed['type'], 3)
+        self.assertEqual(parsed['task'], 'APP')
+        self.assertEqual(parsed['tick'], 1234)
+        self.assertEqual(parsed['registers']['r0'], 0)
+        self.assertEqual(parsed['registers']['sp'], 13)
+        self.assertEqual(parsed['registers']['xpsr'], 16)
+        self.assertEqual(parsed['stack'], [1, 2, 3])
+        self.assertEqual(parsed['log'], [(RODATA_ADDR, 5)])
+        self.assertEqual(parsed['trace'], [(10, rtos_trace.TASK_SWITCH, 2, 0)])
+
+    def test_invalid(self):
+        data = bytearray(record())
+        self.assertRaises(ValueError, crash_dump.parse, bytes(data[:-1]))
+        data[40] ^= 0xFF
+        self.assertRaises(ValueError, crash_dump.parse, bytes(data))
+        # The device clears the key once the record has been reported
+        self.assertEqual(crash_dump.parse(bytes(4) + record()[4:])['type'], 3)
+
+    def test_reassemble(self):
+        data = record(stack=[7] * 10)
+        chunks = [(offset, data[offset:offset + crash_dump.CHUNK])
+                  for offset in range(0, len(data), crash_dump.CHUNK)]
+        self.assertEqual(crash_dump.reassemble(reversed(chunks)), data)
+        self.assertRaises(ValueError, crash_dump.reassemble, chunks[1:])
+        text = '\n'.join('{} {}'.format(offset, chunk.hex()) for offset, chunk in chunks)
+        self.assertEqual(crash_dump.reassemble(crash_dump.parse_chunks(text)), data)
+
+    def test_valid_registers(self):
+        parsed = crash_dump.parse(record(crash_type=0x81, flags=0))
+        self.assertEqual(crash_dump.valid_registers(parsed), ['sp', 'lr', 'pc'])
+        parsed = crash_dump.parse(record(crash_type=0x80, flags=crash_dump.CALLER_SAVED))
+        self.assertNotIn('r4', crash_dump.valid_registers(parsed))
+        self.assertIn('r12', crash_dump.valid_registers(parsed))
+
+    def test_symbols(self):
+        symbols = elf()
+        self.assertEqual(symbols.symbol(TEXT_ADDR), 'main')
+        self.assertEqual(symbols.symbol(TEXT_ADDR + 0x26), 'vRadioTask+0x6')
+        self.assertEqual(symbols.symbol(RODATA_ADDR + 2), 'pcBuffer+0x2')
+        self.assertIsNone(symbols.symbol(0x3000))
+        self.assertTrue(symbols.is_code(TEXT_ADDR + 0x27))
+        self.assertFalse(symbols.is_code(RODATA_ADDR))
+        self.assertEqual(symbols.string(RODATA_ADDR + 6), 'Radio timeout %d\n')
+        self.assertIsNone(symbols.string(0x3000))
+
+    def test_report(self):
+        registers = [0] * crash_dump.REGISTERS
+        registers[15] = TEXT_ADDR + 0x24
+        registers[14] = TEXT_ADDR + 0x0B
+        parsed = crash_dump.parse(record(registers=registers, stack=[0x12345678, TEXT_ADDR + 0x11],
+                                         log=[(RODATA_ADDR + 6, 99)], cfsr=(1 << 25) | (1 << 1)))
+        text = crash_dump.report(parsed, elf())
+        self.assertIn('HardFault in APP', text)
+        self.assertIn('DACCVIOL DIVBYZERO', text)
+        self.assertIn('vRadioTask+0x4', text)
+        self.assertIn('main+0xa', text)
+        self.assertIn('sp+0x004', text)
+        self.assertNotIn('sp+0x000', text)
+        self.assertIn("'Radio timeout %d'", text)
+
+
+if __name__ == '__main__':
+    unittest.main()
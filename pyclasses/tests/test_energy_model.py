@@ -0,0 +1,51 @@
+import unittest
+
+import energy_model
+
+MODEL = {
+    'base_uA': 10,
+    'active_uA': {'cpu': 4000, 'radio_scan': 6000},
+    'event_nC': {'radio_advertise': 20000},
+    'battery_mAh': 1000,
+}
+
+
+class TestEnergyModel(unittest.TestCase):
+
+    def test_subsystems(self):
+        self.assertEqual(len(energy_model.SUBSYSTEMS), 8)
+        self.assertEqual(energy_model.SUBSYSTEMS[0], 'cpu')
+
+    def test_duration(self):
+        currents = energy_model.subsystem_currents(MODEL, [
+            {'subsystem': 'cpu', 'period_s': 10, 'duration_s': 0.01},
+            {'subsystem': 'cpu', 'period_s': 1, 'duration_s': 0.001},
+        ])
+        self.assertAlmostEqual(currents['cpu'], 8.0)
+
+    def test_duty_and_events(self):
+        currents = energy_model.subsystem_currents(MODEL, [
+            {'subsystem': 'radio_scan', 'period_s': 60, 'duration_s': 6, 'duty': 100},
+            {'subsystem': 'radio_advertise', 'period_s': 2, 'events': 1},
+        ])
+        self.assertAlmostEqual(currents['radio_scan'], 60.0)
+        self.assertAlmostEqual(currents['radio_advertise'], 10.0)
+
+    def test_project(self):
+        average, _, lifetime = energy_model.project({'model': MODEL, 'activities': [
+            {'subsystem': 'radio_advertise', 'period_s': 1, 'events': 1},
+        ]})
+        self.assertAlmostEqual(average, 30.0)
+        self.assertAlmostEqual(lifetime, 1000 * 1000 / 30.0)
+        _, _, lifetime = energy_model.project({'activities': []})
+        self.assertIsNone(lifetime)
+
+    def test_invalid(self):
+        self.assertRaises(ValueError, energy_model.subsystem_currents, MODEL, [{'subsystem': 'gps', 'period_s': 1}])
+        self.assertRaises(ValueError, energy_model.subsystem_currents, MODEL, [{'subsystem': 'cpu', 'period_s': 0}])
+        self.assertRaises(ValueError, energy_model.subsystem_currents, MODEL,
+                          [{'subsystem': 'cpu', 'period_s': 1, 'duration_s': 2}])
+
+
+if __name__ == '__main__':
+    unittest.main()
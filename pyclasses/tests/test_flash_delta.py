@@ -0,0 +1,59 @@
+import random
+import unittest
+
+import flash_delta
+
+
+class TestFlashDelta(unittest.TestCase):
+
+    def setUp(self):
+        self.random = random.Random(4)
+        self.old = bytes(self.random.getrandbits(8) for _ in range(64 * flash_delta.BLOCK_SIZE + 100))
+
+    def check(self, new):
+        delta = flash_delta.encode(self.old, new)
+        self.assertEqual(flash_delta.apply(self.old, delta), new)
+        return delta
+
+    def test_crc(self):
+        # CRC-16/CCITT-FALSE check value
+        self.assertEqual(flash_delta.crc16_ccitt(b'123456789'), 0x29B1)
+
+    def test_identical(self):
+        delta = self.check(self.old)
+        # 64 blocks copied in a single record, the trailing partial block is a literal
+        self.assertEqual(delta[:8], bytes([flash_delta.DELTA_COPY, 64, 0, 0, 0, 0, 0, 0]))
+        self.assertLess(len(delta), 8 + 4 + 100 + 8 + 1)
+
+    def test_byte_changes(self):
+        new = bytearray(self.old)
+        for offset in self.random.sample(range(len(new)), 40):
+            new[offset] ^= 0x5A
+        delta = self.check(bytes(new))
+        self.assertLess(len(delta), len(new) // 10)
+
+    def test_inserted_code(self):
+        # Code after an insertion moves, but is still copied from the current image
+        insert = bytes(self.random.getrandbits(8) for _ in range(flash_delta.BLOCK_SIZE))
+        new = self.old[:10 * flash_delta.BLOCK_SIZE] + insert + self.old[10 * flash_delta.BLOCK_SIZE:]
+        delta = self.check(new)
+        self.assertLess(len(delta), 2 * flash_delta.BLOCK_SIZE)
+
+    def test_shifted_code(self):
+        # Code that moves by a few bytes is copied from its new byte offset
+        new = self.old[:1000] + b'\x12\x34\x56' + self.old[1000:]
+        delta = self.check(new)
+        self.assertLess(len(delta), 3 * flash_delta.BLOCK_SIZE)
+
+    def test_unrelated(self):
+        new = bytes(self.random.getrandbits(8) for _ in range(3 * flash_delta.BLOCK_SIZE + 7))
+        self.check(new)
+
+    def test_corrupt(self):
+        delta = bytearray(flash_delta.encode(self.old, self.old[:-1] + b'\x00'))
+        delta[-3] ^= 0x01
+        self.assertRaises(ValueError, flash_delta.apply, self.old, bytes(delta))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,233 @@
+''' Host builds of firmware modules, run against stubbed FreeRTOS and peripherals
+
+Each harness in tests/host is compiled with the module sources it exercises and run,
+the harness exits non zero and prints FAIL lines when a check fails. Stubs shared by
+all harnesses are in tests/host/stub, with weak default implementations that harnesses
+override where the behaviour matters. Harness specific hardware models are in
+tests/host/<harness>/ and are searched first.
+'''
+import glob
+import os
+import re
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+HOST = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'host')
+CORE = os.path.join(os.path.dirname(os.path.dirname(HOST)), '..', 'core_csiro')
+CORE = os.path.normpath(CORE)
+
+INCLUDES = ['libraries/inc', 'common/inc', 'interfaces/inc', 'loggers/inc', 'arch/common/*/inc',
+            'peripherals/*/inc', 'platform/common/inc', 'scheduler/*/inc']
+
+CFLAGS = ['-std=gnu99', '-O1', '-g', '-Wall', '-Wno-unused-parameter', '-Wno-missing-field-initializers',
+          '-Wno-unused-function', '-Wno-enum-conversion']
+SANITIZE = ['-fsanitize=address,undefined', '-fno-sanitize-recover=undefined']
+
+
+def compiler():
+    return shutil.which(os.environ.get('CC', 'gcc'))
+
+
+def sanitizers_available(cc, directory):
+    source = os.path.join(directory, 'probe.c')
+    with open(source, 'w') as f:
+        f.write('int main(void) { return 0; }\n')
+    result = subprocess.run([cc] + SANITIZE + ['-o', os.path.join(directory, 'probe'), source],
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    return result.returncode == 0
+
+
+def build_and_run(harness, sources, includes=(), defines=(), args=(), cflags=()):
+    ''' Compile tests/host/<harness>.c with the given core_csiro sources and run it '''
+    cc = compiler()
+    with tempfile.TemporaryDirectory() as directory:
+        flags = list(CFLAGS)
+        if sanitizers_available(cc, directory):
+            flags += SANITIZE
+        paths = [os.path.join(HOST, harness), os.path.join(HOST, 'stub')]
+        paths += [os.path.join(CORE, p) for p in includes]
+        for pattern in INCLUDES:
+            paths += sorted(glob.glob(os.path.join(CORE, pattern)))
+        command = [cc] + flags + list(cflags) + ['-I' + p for p in paths] + ['-D' + d for d in defines]
+        command += ['-o', os.path.join(directory, harness), os.path.join(HOST, harness + '.c')]
+        command += sorted(glob.glob(os.path.join(HOST, 'stub', '*.c')))
+        command += [os.path.join(CORE, s) for s in sources] + ['-lm']
+        build = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+        if build.returncode != 0:
+            raise AssertionError('{} failed to build\n{}'.format(harness, build.stdout))
+        run = subprocess.run([os.path.join(directory, harness)] + list(args), stdout=subprocess.PIPE,
+                             stderr=subprocess.STDOUT, universal_newlines=True, timeout=600)
+        return run.returncode, run.stdout
+
+
+@unittest.skipIf(compiler() is None, 'No host C compiler')
+class TestHostHarnesses(unittest.TestCase):
+
+    def check(self, harness, sources, **kwargs):
+        returncode, output = build_and_run(harness, sources, **kwargs)
+        self.assertEqual(returncode, 0, '{} failed\n{}'.format(harness, output))
+
+    def test_accelerometer_dsp(self):
+        self.check('accelerometer_dsp_test', ['libraries/src/accelerometer_dsp.c', 'libraries/src/stats.c',
+                                              'libraries/src/csiro_math.c', 'libraries/src/memory_operations.c'],
+                   args=[os.path.join(HOST, 'fixtures', 'accelerometer_trace.csv')])
+
+    def test_csiro_math(self):
+        # The square roots are swept over all 2^32 inputs, which is only practical without sanitizers
+        self.check('csiro_math_test', ['libraries/src/csiro_math.c'], cflags=['-O2', '-fno-sanitize=all'])
+
+    def test_rtc_common(self):
+        self.check('rtc_common_test', ['libraries/src/memory_operations.c'], includes=['arch/common/interface/src'])
+
+    def test_fifo_timestamp(self):
+        self.check('fifo_timestamp_test', ['libraries/src/fifo_timestamp.c', 'libraries/src/tdf_auto.c'])
+
+    def test_sd(self):
+        self.check('sd_test', ['peripherals/memory/src/sd_ll.c', 'libraries/src/memory_operations.c'],
+                   includes=['peripherals/memory/src'])
+
+    def test_tdf_compress(self):
+        returncode, output = build_and_run('tdf_compress_test', ['libraries/src/tdf.c', 'libraries/src/tdf_parse.c',
+                                                                 'libraries/src/tdf_auto.c',
+                                                                 'libraries/src/memory_operations.c'])
+        self.assertEqual(returncode, 0, output)
+        # The firmware encoder and the Python decoder agree on the segment layout
+        from tests.test_tdf3 import COMPRESSED_SEGMENT
+        segment = bytes.fromhex(re.search('SEGMENT ([0-9a-f]+)', output).group(1))
+        self.assertEqual(segment, COMPRESSED_SEGMENT)
+
+    def test_sd_logger(self):
+        self.check('sd_logger_test', ['loggers/src/sd_logger.c', 'libraries/src/memory_operations.c',
+                                      'libraries/src/csiro_math.c'],
+                   defines=['SD_READ_AHEAD_PAGES=8'])
+
+    def test_flash_cache(self):
+        self.check('flash_cache_test', ['libraries/src/memory_operations.c', 'libraries/src/csiro_math.c'],
+                   includes=['interfaces/src'])
+
+    def test_flash_suspend(self):
+        # MX25R and W25Q parts suspend erases for reads, the W25X20CL cannot and reads wait for the erase
+        for defines in ([], ['W25X_DEVICE_ID=0x17'], ['W25X_DEVICE_ID=0x11']):
+            with self.subTest(defines=defines):
+                self.check('flash_suspend_test', ['libraries/src/memory_operations.c', 'libraries/src/csiro_math.c'],
+                           includes=['interfaces/src', 'peripherals/memory/src'], defines=defines)
+
+    def test_onboard_logger_wear(self):
+        self.check('onboard_logger_test', ['libraries/src/logger.c', 'loggers/src/onboard_logger.c',
+                                           'interfaces/src/flash_wear.c', 'libraries/src/memory_operations.c',
+                                           'libraries/src/csiro_math.c'],
+                   defines=['ONBOARD_LOGGER_WEAR_LEVELLING=1', 'ONBOARD_LOGGER_WEAR_SPARES=2'])
+
+    def test_flash_wear(self):
+        self.check('flash_wear_test', ['interfaces/src/flash_wear.c', 'libraries/src/memory_operations.c',
+                                       'libraries/src/csiro_math.c'])
+
+    def test_onboard_logger_latency(self):
+        # Synchronous erases and erase ahead, with reserved OTA blocks before the logger and an explicitly sized logger
+        for erase_ahead, logger_blocks in ((0, 'LOGGER_LENGTH_REMAINING_BLOCKS'), (2, 'LOGGER_LENGTH_REMAINING_BLOCKS'), (2, 320)):
+            with self.subTest(erase_ahead=erase_ahead, logger_blocks=logger_blocks):
+                self.check('onboard_logger_latency_test', ['libraries/src/logger.c', 'loggers/src/onboard_logger.c',
+                                                           'libraries/src/memory_operations.c', 'libraries/src/csiro_math.c'],
+                           defines=['ONBOARD_LOGGER_ERASE_AHEAD={}'.format(erase_ahead), 'RESERVED_BLOCKS=64',
+                                    'LOGGER_BLOCKS={}'.format(logger_blocks)])
+
+    def test_logger_power_loss(self):
+        self.check('logger_power_loss_test', ['libraries/src/memory_operations.c'], includes=['libraries/src'])
+
+    def test_flash_kv(self):
+        self.check('flash_kv_test', ['interfaces/src/flash_kv.c', 'libraries/src/memory_operations.c',
+                                     'libraries/src/csiro_math.c'])
+
+    def test_flash_delta_power_loss(self):
+        import random
+        import flash_delta
+        rand = random.Random(9)
+        old = bytes(rand.getrandbits(8) for _ in range(64 * 1024 + 123))
+        # Scattered edits, an insertion and deletion as from a recompiled function, and an unrelated image
+        edited = bytearray(old)
+        for offset in rand.sample(range(len(edited)), 100):
+            edited[offset] ^= rand.getrandbits(8) | 1
+        moved = old[:20000] + bytes(rand.getrandbits(8) for _ in range(700)) + old[20000:40000] + old[41000:]
+        unrelated = bytes(rand.getrandbits(8) for _ in range(48 * 1024 + 7))
+        with tempfile.TemporaryDirectory() as directory:
+            args = [os.path.join(directory, 'old.bin')]
+            with open(args[0], 'wb') as f:
+                f.write(old)
+            for i, new in enumerate([bytes(edited), moved, unrelated]):
+                delta = flash_delta.encode(old, new)
+                self.assertEqual(flash_delta.apply(old, delta), new)
+                for name, data in (('new', new), ('delta', delta)):
+                    args.append(os.path.join(directory, '{}{}.bin'.format(name, i)))
+                    with open(args[-1], 'wb') as f:
+                        f.write(data)
+            self.check('flash_delta_test', ['libraries/src/memory_operations.c', 'libraries/src/csiro_math.c'],
+                       includes=['interfaces/src'], args=args)
+
+    def test_logger_mirror(self):
+        returncode, output = build_and_run('logger_mirror_test', ['libraries/src/logger.c', 'libraries/src/logger_mirror.c',
+                                                                  'libraries/src/tdf.c', 'libraries/src/tdf_parse.c',
+                                                                  'libraries/src/tdf_auto.c',
+                                                                  'libraries/src/memory_operations.c'])
+        self.assertEqual(returncode, 0, output)
+        # Mirrored blocks with footers decode in Python once the footer is skipped
+        from tdf3 import Tdf
+        from tests.test_tdf3 import TDF_DICT
+        match = re.search('BLOCK ([0-9a-f]+) ([0-9]+)', output)
+        block, count = bytes.fromhex(match.group(1)), int(match.group(2))
+        readings = list(Tdf(TDF_DICT).parseLogBlock(block, footer=True, combine=True))
+        self.assertEqual(len(readings), count)
+        self.assertTrue(all(r['sensor'] == 'ACC_XYZ_SIGNED' for r in readings))
+
+    def test_activity_scheduler(self):
+        self.check('activity_scheduler_test', ['libraries/src/csiro_math.c'], includes=['scheduler/activities/src'])
+
+    def test_stack_monitor(self):
+        self.check('stack_monitor_test', ['libraries/src/memory_operations.c'],
+                   includes=['arch/common/FreeRTOS/src', '../core_external/FreeRTOS/Source/include'],
+                   defines=['configUSE_STACK_MONITOR=1'])
+
+    def test_sleep_stats(self):
+        self.check('sleep_stats_test', ['libraries/src/sleep_stats.c', 'arch/nrf52/FreeRTOS/src/RTC_tickless_idle.c',
+                                        'libraries/src/tdf_auto.c', 'libraries/src/memory_operations.c',
+                                        'libraries/src/csiro_math.c'],
+                   defines=['USE_RTC_TICKLESS_IDLE'])
+
+    def test_energy(self):
+        returncode, output = build_and_run('energy_test', ['libraries/src/memory_operations.c'], includes=['libraries/src'])
+        self.assertEqual(returncode, 0, output)
+        # The firmware accounting and the Python projection agree for the harness workload
+        import energy_model
+        config = {
+            'model': {'base_uA': 15, 'active_uA': {'cpu': 4000, 'radio_scan': 5000, 'flash': 1000},
+                      'event_nC': {'radio_advertise': 30000}, 'battery_mAh': 1000},
+            'activities': [
+                {'name': 'wake', 'subsystem': 'cpu', 'period_s': 100, 'duration_s': 1},
+                {'name': 'scan', 'subsystem': 'radio_scan', 'period_s': 100, 'duration_s': 10, 'duty': 100},
+                {'name': 'advertise', 'subsystem': 'radio_advertise', 'period_s': 100, 'events': 50},
+            ]
+        }
+        average, _, lifetime = energy_model.project(config)
+        match = re.search('AVERAGE ([0-9]+) LIFETIME ([0-9]+)', output)
+        self.assertEqual(int(match.group(1)), round(average))
+        self.assertEqual(int(match.group(2)), int(lifetime))
+
+    def test_crash_dump(self):
+        self.check('crash_dump_test', ['libraries/src/memory_operations.c'], includes=['arch/common/cpu/src'])
+
+    def test_uart_nrf52(self):
+        # Buffer addresses are written to 32 bit DMA registers, so statics must be below 4GB
+        self.check('uart_nrf52_test', ['arch/nrf52/interface/src/uart.c'], includes=['arch/nrf52/interface/inc'],
+                   cflags=['-no-pie', '-Wno-pointer-to-int-cast', '-Wno-int-to-pointer-cast'])
+
+    def test_bus_transaction_nrf52(self):
+        self.check('bus_transaction_nrf52_test', ['arch/nrf52/interface/src/spi.c', 'arch/nrf52/interface/src/i2c.c',
+                                                  'arch/common/interface/src/bus_transaction_common.c',
+                                                  'libraries/src/memory_operations.c'],
+                   includes=['arch/nrf52/interface/inc'])
+
+    def test_bus_transaction_efr32(self):
+        # The Gecko SDK is not in the tree, the harness provides the em_* and SPIDRV headers
+        self.check('bus_transaction_efr32_test', ['arch/efr32/interface/src/spi.c', 'arch/efr32/interface/src/i2c.c'],
+                   includes=['arch/efr32/interface/inc'])
@@ -0,0 +1,81 @@
+import struct
+import unittest
+
+import rtos_trace
+
+
+def dump(records, tasks={1: 'IDLE', 2: 'APP'}, hz=1000000, overwritten=0, flags=0):
+    data = rtos_trace.HEADER.pack(rtos_trace.MAGIC, rtos_trace.VERSION, len(tasks), 10, flags, hz, len(records), overwritten,
+                                  40)
+    for number, name in tasks.items():
+        data += struct.pack('<B10s', number, name.encode())
+    for record in records:
+        data += rtos_trace.RECORD.pack(*record)
+    return data
+
+
+class TestRtosTrace(unittest.TestCase):
+
+    def test_header(self):
+        header, tasks, records = rtos_trace.parse(dump([], overwritten=7))
+        self.assertEqual(header['overwritten'], 7)
+        self.assertEqual(header['overhead_cycles'], 40)
+        self.assertEqual(tasks, {1: 'IDLE', 2: 'APP'})
+        self.assertEqual(records, [])
+        self.assertFalse(header['tasks_truncated'])
+
+    def test_tasks_truncated(self):
+        header, tasks, records = rtos_trace.parse(dump([], tasks={}, flags=rtos_trace.FLAG_TASKS_TRUNCATED))
+        self.assertTrue(header['tasks_truncated'])
+        self.assertEqual(tasks, {})
+
+    def test_invalid(self):
+        self.assertRaises(ValueError, rtos_trace.parse, b'XXXX' + dump([])[4:])
+        self.assertRaises(ValueError, rtos_trace.parse, dump([(0, rtos_trace.TASK_SWITCH, 1, 0)])[:-1])
+
+    def test_task_slices(self):
+        trace = rtos_trace.parse(dump([
+            (100, rtos_trace.TASK_SWITCH, 1, 0),
+            (400, rtos_trace.TASK_SWITCH, 2, 0),
+            (500, rtos_trace.TASK_SWITCH, 1, 0),
+            (1100, rtos_trace.TASK_SWITCH, 2, 0),
+        ]))
+        chrome = rtos_trace.to_chrome(*trace)
+        slices = [(e['name'], e['ts'], e['dur']) for e in chrome['traceEvents'] if e['ph'] == 'X']
+        self.assertEqual(slices, [('IDLE', 0, 300), ('APP', 300, 100), ('IDLE', 400, 600), ('APP', 1000, 0)])
+        usage = rtos_trace.cpu_usage(*trace)
+        self.assertAlmostEqual(usage['IDLE'], 0.9)
+        self.assertAlmostEqual(usage['APP'], 0.1)
+
+    def test_timestamp_wrap(self):
+        _, _, records = rtos_trace.parse(dump([
+            (0xFFFFFF00, rtos_trace.TASK_SWITCH, 1, 0),
+            (0x00000100, rtos_trace.TASK_SWITCH, 2, 0),
+        ]))
+        self.assertEqual(records[1][0] - records[0][0], 0x200)
+
+    def test_objects(self):
+        trace = rtos_trace.parse(dump([
+            (0, rtos_trace.TASK_SWITCH, 2, 0),
+            (10, rtos_trace.QUEUE_SEND, 3, 0),
+            (20, rtos_trace.QUEUE_RECEIVE, 4, 1 | rtos_trace.FROM_ISR),
+            (30, rtos_trace.ISR_ENTER, 17, 0),
+            (35, rtos_trace.ISR_EXIT, 17, 0),
+            (40, rtos_trace.SLEEP, 0, 0),
+            (90, rtos_trace.WAKE, 0, 0),
+        ], hz=2000000))
+        events = rtos_trace.to_chrome(*trace)['traceEvents']
+        names = [e['name'] for e in events if e['ph'] in 'iX']
+        self.assertIn('send queue 3', names)
+        self.assertIn('take mutex 4', names)
+        isr = next(e for e in events if e['name'] == 'IRQ 17' and e['ph'] == 'X')
+        self.assertEqual((isr['ts'], isr['dur']), (15, 2.5))
+        sleep = next(e for e in events if e['name'] == 'sleep')
+        self.assertEqual(sleep['dur'], 25)
+        rows = {e['tid']: e['args']['name'] for e in events if e['name'] == 'thread_name'}
+        self.assertEqual(rows[rtos_trace.ISR_TID_BASE + 17], 'IRQ 17')
+        self.assertEqual(rows[rtos_trace.SLEEP_TID], 'Sleep')
+
+
+if __name__ == '__main__':
+    unittest.main()
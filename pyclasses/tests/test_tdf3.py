@@ -0,0 +1,59 @@
+import datetime
+import unittest
+
+from tdf3 import Tdf
+
+# Minimal dictionary for a signed XYZ accelerometer TDF
+TDF_DICT = {
+    '422': {
+        'sensor': 'ACC_XYZ_SIGNED',
+        'bytes': 6,
+        'phenomena': [
+            {'phenomenon': 'x', 'ctype': 'int16', 'bytes': 2},
+            {'phenomenon': 'y', 'ctype': 'int16', 'bytes': 2},
+            {'phenomenon': 'z', 'ctype': 'int16', 'bytes': 2},
+        ]
+    }
+}
+
+# Four records of TDF 422 produced by eTdfCompressAdd, with times
+# 600000000.0, 600000000.25, 600000000.5 and 600000001.5 seconds
+COMPRESSED_SEGMENT = b'\xfe\xcf\xa6\x01\x04\x00\x46\xc3\x23\x00\x00\x64\x00\x38\xff\x00\x40\x80\x80\x01\x02\x02\x03\x00\x03\x04\x07\x80\x80\x04\x01\xba\xfe\x03\xf1\xfc\x03\xf7\xff\x01'
+
+EXPECTED = [
+    (100, -200, 16384),
+    (101, -202, 16384),
+    (99, -200, 16380),
+    (-32768, 32767, 0),
+]
+
+
+class TestTdfCompressed(unittest.TestCase):
+
+    def parse(self, buffer):
+        tdf = Tdf(TDF_DICT)
+        return list(tdf.parseTdf16(buffer, combine=True))
+
+    def test_values(self):
+        readings = self.parse(COMPRESSED_SEGMENT)
+        values = [tuple(r['phenomena'][axis]['raw'] for axis in 'xyz') for r in readings]
+        self.assertEqual(values, EXPECTED)
+
+    def test_timestamps(self):
+        readings = self.parse(COMPRESSED_SEGMENT)
+        offsets = [(r['time'] - readings[0]['time']).total_seconds() for r in readings]
+        self.assertEqual(offsets, [0.0, 0.25, 0.5, 1.5])
+
+    def test_relative_after_segment(self):
+        # A 1 second offset TDF following the segment is relative to the final record
+        relative = b'\xa6\x41\x01\x00' + b'\x00' * 6
+        readings = self.parse(COMPRESSED_SEGMENT + relative)
+        self.assertEqual(len(readings), 5)
+        self.assertEqual(readings[4]['time'] - readings[3]['time'], datetime.timedelta(seconds=1))
+
+    def test_truncated(self):
+        self.assertRaises(Exception, self.parse, COMPRESSED_SEGMENT[:-3])
+
+
+if __name__ == '__main__':
+    unittest.main()